@@ -0,0 +1,39 @@
+/*
+ * Copyright 2026 Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _GNU_FCNTL_H_
+#define _GNU_FCNTL_H_
+
+
+#include_next <fcntl.h>
+
+#include <sys/types.h>
+
+
+#ifdef _GNU_SOURCE
+
+
+/* flags for splice(); they are accepted, but have no effect */
+#define SPLICE_F_MOVE		0x01
+#define SPLICE_F_NONBLOCK	0x02
+#define SPLICE_F_MORE		0x04
+#define SPLICE_F_GIFT		0x08
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern ssize_t splice(int fdIn, off_t* offsetIn, int fdOut, off_t* offsetOut,
+	size_t length, unsigned int flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif
+
+
+#endif  /* _GNU_FCNTL_H_ */
@@ -18,11 +18,12 @@ namespace BHPKG {
 enum {
 	B_HPKG_MAGIC				= 'hpkg',
 	B_HPKG_VERSION				= 2,
-	B_HPKG_MINOR_VERSION		= 1,
+	B_HPKG_MINOR_VERSION		= 2,
 	//
 	B_HPKG_REPO_MAGIC			= 'hpkr',
 	B_HPKG_REPO_VERSION			= 2,
-	B_HPKG_REPO_MINOR_VERSION	= 1
+	B_HPKG_REPO_MINOR_VERSION	= 2
+		// minor version 2: B_HPKG_COMPRESSION_ZSTD_DICTIONARY
 };
 
 
@@ -97,9 +98,13 @@ enum BHPKGAttributeID {
 
 // compression types
 enum {
-	B_HPKG_COMPRESSION_NONE	= 0,
-	B_HPKG_COMPRESSION_ZLIB	= 1,
-	B_HPKG_COMPRESSION_ZSTD	= 2
+	B_HPKG_COMPRESSION_NONE				= 0,
+	B_HPKG_COMPRESSION_ZLIB				= 1,
+	B_HPKG_COMPRESSION_ZSTD				= 2,
+	B_HPKG_COMPRESSION_ZSTD_DICTIONARY	= 3
+		// zstd with a dictionary trained for the heap; the dictionary is
+		// stored at the end of the heap, after the chunk sizes table,
+		// followed by its size as a big endian uint32
 };
 
 
@@ -57,10 +57,15 @@ public:
 			int32				CompressionLevel() const;
 			void				SetCompressionLevel(int32 compressionLevel);
 
+			int32				ThreadCount() const;
+			void				SetThreadCount(int32 threadCount);
+									// 0: one thread per CPU
+
 private:
 			uint32				fFlags;
 			uint32				fCompression;
 			int32				fCompressionLevel;
+			int32				fThreadCount;
 };
 
 
@@ -22,6 +22,9 @@ class BRepositoryInfo;
 namespace BHPKG {
 
 
+class BPackageWriterParameters;
+
+
 namespace BPrivate {
 	class RepositoryWriterImpl;
 }
@@ -58,7 +61,9 @@ public:
 									BRepositoryInfo* repositoryInfo);
 								~BRepositoryWriter();
 
-			status_t			Init(const char* fileName);
+			status_t			Init(const char* fileName,
+									const BPackageWriterParameters* parameters
+										= NULL);
 			status_t			AddPackage(const BEntry& packageEntry);
 			status_t			AddPackageInfo(const BPackageInfo& packageInfo);
 			status_t			Finish();
@@ -50,6 +50,8 @@ class BDirectory : public BNode, public BEntryList {
 		virtual status_t GetNextRef(entry_ref *ref);
 		virtual int32 GetNextDirents(dirent *buf, size_t bufSize,
 			int32 count = INT_MAX);
+		int32 GetNextDirentsWithStats(dirent *buf, size_t bufSize,
+			struct stat *stats, int32 count);
 		virtual status_t Rewind();
 		virtual int32 CountEntries();
 
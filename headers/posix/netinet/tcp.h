@@ -79,5 +79,9 @@ struct tcphdr {
 	/* don't use TH_PUSH */
 #define TCP_NOOPT				0x08
 	/* don't use any TCP options */
+#define TCP_CONGESTION			0x40
+	/* congestion control algorithm, by name */
+
+#define TCP_CA_NAME_MAX			16
 
 #endif	/* NETINET_TCP_H */
@@ -1,5 +1,5 @@
 /*
- * Copyright 2020, Haiku, Inc. All rights reserved.
+ * Copyright 2020-2026, Haiku, Inc. All rights reserved.
  * Distributed under the terms of the MIT License.
  */
 #ifndef _NETINET_UDP_H
@@ -14,4 +14,8 @@ struct udphdr {
 	uint16_t uh_sum;
 };
 
+/* IPPROTO_UDP level socket options */
+#define UDP_SEGMENT	103	/* int: send a buffer as datagrams of this size */
+#define UDP_GRO		104	/* int: receive datagrams of a flow coalesced */
+
 #endif /* _NETINET_UDP_H */
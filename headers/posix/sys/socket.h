@@ -1,5 +1,5 @@
 /*
- * Copyright 2002-2012 Haiku, Inc. All Rights Reserved.
+ * Copyright 2002-2026 Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  */
 #ifndef _SYS_SOCKET_H
@@ -72,6 +72,8 @@ typedef uint8_t sa_family_t;
 #define SO_NONBLOCK		0x40000009
 #define SO_BINDTODEVICE	0x4000000a	/* binds the socket to a specific device index */
 #define SO_PEERCRED		0x4000000b	/* get peer credentials, param: ucred */
+#define SO_ATTACH_FILTER	0x4000000c	/* filter received data, param: bpf_program */
+#define SO_DETACH_FILTER	0x4000000d	/* remove the filter again */
 
 /* Shutdown options */
 #define SHUT_RD			0
@@ -109,6 +111,12 @@ struct msghdr {
 	int			msg_flags;		/* flags */
 };
 
+/* for recvmmsg() and sendmmsg() */
+struct mmsghdr {
+	struct msghdr	msg_hdr;	/* the message */
+	unsigned int	msg_len;	/* number of bytes transferred */
+};
+
 /* Flags for the msghdr.msg_flags field */
 #define MSG_OOB			0x0001	/* process out-of-band data */
 #define MSG_PEEK		0x0002	/* peek at incoming message */
@@ -122,6 +130,7 @@ struct msghdr {
 #define MSG_MCAST		0x0200	/* this message rec'd as multicast */
 #define	MSG_EOF			0x0400	/* data completes connection */
 #define MSG_NOSIGNAL	0x0800	/* don't raise SIGPIPE if socket is closed */
+#define MSG_WAITFORONE	0x1000	/* recvmmsg(): only block for the first one */
 
 struct cmsghdr {
 	socklen_t	cmsg_len;
@@ -157,6 +166,8 @@ struct ucred {
 	gid_t	gid;	/* GID of sender */
 };
 
+struct timespec;
+
 
 #if __cplusplus
 extern "C" {
@@ -178,8 +189,12 @@ ssize_t recv(int socket, void *buffer, size_t length, int flags);
 ssize_t recvfrom(int socket, void *buffer, size_t bufferLength, int flags,
 			struct sockaddr *address, socklen_t *_addressLength);
 ssize_t recvmsg(int socket, struct msghdr *message, int flags);
+int		recvmmsg(int socket, struct mmsghdr *messages, unsigned int count,
+			int flags, struct timespec *timeout);
 ssize_t send(int socket, const void *buffer, size_t length, int flags);
 ssize_t	sendmsg(int socket, const struct msghdr *message, int flags);
+int		sendmmsg(int socket, struct mmsghdr *messages, unsigned int count,
+			int flags);
 ssize_t sendto(int socket, const void *message, size_t length, int flags,
 			const struct sockaddr *address, socklen_t addressLength);
 int     setsockopt(int socket, int level, int option, const void *value,
@@ -1,5 +1,5 @@
 /*
- * Copyright 2002-2012 Haiku, Inc. All Rights Reserved.
+ * Copyright 2002-2026 Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  */
 #ifndef _SYS_SOCKIO_H
@@ -74,6 +74,13 @@
 #define B_SOCKET_SET_ALIAS		8947	/* set interface alias, ifaliasreq */
 #define B_SOCKET_GET_ALIAS		8948	/* get interface alias, ifaliasreq */
 #define B_SOCKET_COUNT_ALIASES	8949	/* count interface aliases */
+#define SIOCSPACKETRING			8950
+	/* Map a packet ring for an interface queue, packet_ring_request */
+#define SIOCCPACKETRING			8951	/* Remove the packet ring again */
+#define SIOCFPACKETRING			8952
+	/* Send the frames in the transmit ring of the packet ring */
+#define SIOCSIFFILTER			8953
+	/* Set the receive filter of a device, ifr_data points to a bpf_program */
 
 #define SIOCEND					9000	/* SIOCEND >= highest SIOC* */
 
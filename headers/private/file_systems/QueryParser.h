@@ -20,6 +20,7 @@
 // are.
 
 #ifdef FS_SHELL
+#	include <algorithm>
 #	include <new>
 
 #	include "fssh_api_wrapper.h"
@@ -77,6 +78,15 @@ template<typename QueryPolicy> class Term;
 template<typename QueryPolicy> class Query;
 
 
+// Limits the number of node IDs that are collected from an index in order
+// to intersect it with the one the query iterates over.
+static const int32 kMaxNodeSetSize = 65536;
+
+// How much more expensive than reading an index entry checking a node's
+// attribute is assumed to be.
+static const int32 kMatchCostFactor = 8;
+
+
 enum ops {
 	OP_NONE,
 
@@ -107,6 +117,37 @@ union value {
 };
 
 
+/*!	A sorted set of node IDs, used to intersect or unite the results of
+	several indices without looking at the nodes themselves.
+*/
+class NodeIDSet {
+public:
+	inline						NodeIDSet();
+	inline						~NodeIDSet();
+
+	inline	status_t			Add(ino_t id);
+	inline	void				Sort();
+
+	inline	bool				Contains(ino_t id) const;
+			int32				Count() const { return fCount; }
+
+	inline	void				IntersectWith(const NodeIDSet& other);
+	inline	status_t			UniteWith(const NodeIDSet& other);
+
+private:
+								NodeIDSet(const NodeIDSet& other);
+								NodeIDSet& operator=(const NodeIDSet& other);
+									// no implementation
+
+	inline	status_t			_Resize(int32 capacity);
+
+private:
+			ino_t*				fIDs;
+			int32				fCount;
+			int32				fCapacity;
+};
+
+
 template<typename QueryPolicy>
 class Query {
 public:
@@ -147,6 +188,8 @@ public:
 
 private:
 			status_t		_GetNextEntry(struct dirent* dirent, size_t size);
+			void			_PlanNodeSets(Equation<QueryPolicy>* equation);
+			void			_ClearNodeSets(Term<QueryPolicy>* term);
 			void			_SendEntryNotification(Entry* entry,
 								status_t (*notify)(port_id, int32, dev_t, ino_t,
 									const char*, ino_t));
@@ -179,8 +222,9 @@ public:
 			typedef typename QueryPolicy::Context Context;
 
 public:
-						Term(int8 op) : fOp(op), fParent(NULL) {}
-	virtual				~Term() {}
+						Term(int8 op)
+							: fOp(op), fParent(NULL), fMatchingNodes(NULL) {}
+	virtual				~Term() { delete fMatchingNodes; }
 
 			int8		Op() const { return fOp; }
 
@@ -188,6 +232,10 @@ public:
 							{ fParent = parent; }
 			Term<QueryPolicy>* Parent() const { return fParent; }
 
+			NodeIDSet*	MatchingNodes() const { return fMatchingNodes; }
+			void		SetMatchingNodes(NodeIDSet* nodes)
+							{ delete fMatchingNodes; fMatchingNodes = nodes; }
+
 	virtual	status_t	Match(Entry* entry, Node* node,
 							const char* attribute = NULL, int32 type = 0,
 							const uint8* key = NULL, size_t size = 0) = 0;
@@ -196,6 +244,10 @@ public:
 	virtual	void		CalculateScore(Index& index) = 0;
 	virtual	int32		Score() const = 0;
 
+	virtual	int64		EstimateMatchCount(Index& index) = 0;
+	virtual	status_t	CollectMatchingNodes(Context* context,
+							NodeIDSet& nodes) = 0;
+
 	virtual	status_t	InitCheck() = 0;
 
 	virtual	bool		NeedsEntry() = 0;
@@ -207,6 +259,7 @@ public:
 protected:
 			int8		fOp;
 			Term<QueryPolicy>* fParent;
+			NodeIDSet*	fMatchingNodes;
 };
 
 
@@ -256,6 +309,10 @@ public:
 	virtual	void		CalculateScore(Index &index);
 	virtual	int32		Score() const { return fScore; }
 
+	virtual	int64		EstimateMatchCount(Index& index);
+	virtual	status_t	CollectMatchingNodes(Context* context,
+							NodeIDSet& nodes);
+
 	virtual	bool		NeedsEntry();
 
 #ifdef DEBUG_QUERY
@@ -267,6 +324,8 @@ private:
 						Equation& operator=(const Equation& other);
 							// no implementation
 
+			status_t	_NextMatchingIndexEntry(IndexIterator* iterator);
+			bool		_MatchesNodeSets(ino_t id);
 			status_t	ConvertValue(type_code type);
 			bool		CompareTo(const uint8* value, size_t size);
 			uint8*		Value() const { return (uint8*)&fValue; }
@@ -311,6 +370,10 @@ public:
 	virtual	void		CalculateScore(Index& index);
 	virtual	int32		Score() const;
 
+	virtual	int64		EstimateMatchCount(Index& index);
+	virtual	status_t	CollectMatchingNodes(Context* context,
+							NodeIDSet& nodes);
+
 	virtual	status_t	InitCheck();
 
 	virtual	bool		NeedsEntry();
@@ -358,6 +421,98 @@ private:
 };
 
 
+//	#pragma mark - NodeIDSet
+
+
+NodeIDSet::NodeIDSet()
+	:
+	fIDs(NULL),
+	fCount(0),
+	fCapacity(0)
+{
+}
+
+
+NodeIDSet::~NodeIDSet()
+{
+	free(fIDs);
+}
+
+
+/*!	Adds \a id to the set. Sort() must be called after the last ID has been
+	added, and before the set is used.
+*/
+status_t
+NodeIDSet::Add(ino_t id)
+{
+	if (fCount == fCapacity) {
+		status_t status = _Resize(fCapacity == 0 ? 64 : fCapacity * 2);
+		if (status != B_OK)
+			return status;
+	}
+
+	fIDs[fCount++] = id;
+	return B_OK;
+}
+
+
+void
+NodeIDSet::Sort()
+{
+	std::sort(fIDs, fIDs + fCount);
+	fCount = std::unique(fIDs, fIDs + fCount) - fIDs;
+}
+
+
+bool
+NodeIDSet::Contains(ino_t id) const
+{
+	return std::binary_search(fIDs, fIDs + fCount, id);
+}
+
+
+void
+NodeIDSet::IntersectWith(const NodeIDSet& other)
+{
+	fCount = std::set_intersection(fIDs, fIDs + fCount, other.fIDs,
+		other.fIDs + other.fCount, fIDs) - fIDs;
+}
+
+
+status_t
+NodeIDSet::UniteWith(const NodeIDSet& other)
+{
+	if (other.fCount == 0)
+		return B_OK;
+
+	int32 capacity = fCount + other.fCount;
+	ino_t* ids = (ino_t*)malloc(capacity * sizeof(ino_t));
+	if (ids == NULL)
+		return B_NO_MEMORY;
+
+	fCount = std::set_union(fIDs, fIDs + fCount, other.fIDs,
+		other.fIDs + other.fCount, ids) - ids;
+	fCapacity = capacity;
+
+	free(fIDs);
+	fIDs = ids;
+	return B_OK;
+}
+
+
+status_t
+NodeIDSet::_Resize(int32 capacity)
+{
+	ino_t* ids = (ino_t*)realloc(fIDs, capacity * sizeof(ino_t));
+	if (ids == NULL)
+		return B_NO_MEMORY;
+
+	fIDs = ids;
+	fCapacity = capacity;
+	return B_OK;
+}
+
+
 //	#pragma mark -
 
 
@@ -886,31 +1041,15 @@ Equation<QueryPolicy>::GetNextMatching(Context* context,
 {
 	while (true) {
 		NodeHolder nodeHolder;
-		union value<QueryPolicy> indexValue;
-		size_t keyLength;
-		size_t duplicate = 0;
 
-		status_t status = QueryPolicy::IndexIteratorFetchNextEntry(iterator,
-			&indexValue, &keyLength, (size_t)sizeof(indexValue), &duplicate);
+		status_t status = _NextMatchingIndexEntry(iterator);
 		if (status != B_OK)
 			return status;
 
-		// only compare against the index entry when this is the correct
-		// index for the equation
-		if (fHasIndex && duplicate < 2 && !CompareTo((uint8*)&indexValue, keyLength)) {
-			// They aren't equal? Let the operation decide what to do. Since
-			// we always start at the beginning of the index (or the correct
-			// position), only some needs to be stopped if the entry doesn't
-			// fit.
-			if (Term<QueryPolicy>::fOp == OP_LESS_THAN
-				|| Term<QueryPolicy>::fOp == OP_LESS_THAN_OR_EQUAL
-				|| (Term<QueryPolicy>::fOp == OP_EQUAL && !fIsPattern))
-				return B_ENTRY_NOT_FOUND;
-
-			if (duplicate > 0)
-				QueryPolicy::IndexIteratorSkipDuplicates(iterator);
+		// If the other side of an &&-operator could be resolved to a set of
+		// nodes, we don't even need to look at the node to rule it out
+		if (!_MatchesNodeSets(QueryPolicy::IndexIteratorGetNodeID(iterator)))
 			continue;
-		}
 
 		Entry* entry = NULL;
 		status = QueryPolicy::IndexIteratorGetEntry(context, iterator,
@@ -955,6 +1094,13 @@ Equation<QueryPolicy>::GetNextMatching(Context* context,
 						"(parent = %p)\n", parent);
 					break;
 				}
+
+				// _MatchesNodeSets() already checked this one
+				if (other->MatchingNodes() != NULL) {
+					term = (Term<QueryPolicy>*)parent;
+					continue;
+				}
+
 				status = other->Match(entry, QueryPolicy::EntryGetNode(entry));
 				if (status < 0) {
 					QUERY_REPORT_ERROR(status);
@@ -995,6 +1141,147 @@ Equation<QueryPolicy>::NeedsEntry()
 }
 
 
+/*!	Returns a rough estimate of how many nodes will match this equation, or
+	-1 if its matching nodes cannot be determined by its index alone.
+*/
+template<typename QueryPolicy>
+int64
+Equation<QueryPolicy>::EstimateMatchCount(Index& index)
+{
+	if (Term<QueryPolicy>::fOp == OP_UNEQUAL
+		|| QueryPolicy::IndexSetTo(index, fAttribute) != B_OK)
+		return -1;
+
+	int64 entries = QueryPolicy::IndexGetEntryCount(index);
+
+	// As with the score, these are only educated guesses
+	if (fIsPattern) {
+		// every known character in front of the first pattern symbol
+		// narrows down the range a bit
+		int32 prefixLength = std::min(getFirstPatternSymbol(fString), 8);
+		if (prefixLength <= 0)
+			return entries;
+
+		return (entries >> prefixLength) + 1;
+	}
+
+	if (Term<QueryPolicy>::fOp == OP_EQUAL)
+		return entries / 64 + 1;
+
+	return entries / 2 + 1;
+}
+
+
+/*!	Adds the IDs of all nodes matching this equation to \a nodes, using its
+	index only. Fails with \c B_BUFFER_OVERFLOW if more than
+	\c kMaxNodeSetSize nodes match.
+*/
+template<typename QueryPolicy>
+status_t
+Equation<QueryPolicy>::CollectMatchingNodes(Context* context, NodeIDSet& nodes)
+{
+	Index index(context);
+	if (Term<QueryPolicy>::fOp == OP_UNEQUAL
+		|| QueryPolicy::IndexSetTo(index, fAttribute) != B_OK)
+		return B_UNSUPPORTED;
+
+	IndexIterator* iterator = NULL;
+	status_t status = PrepareQuery(context, index, &iterator, false);
+	if (status == B_OK && !fHasIndex)
+		status = B_UNSUPPORTED;
+
+	while (status == B_OK) {
+		status = _NextMatchingIndexEntry(iterator);
+		if (status != B_OK)
+			break;
+
+		if (nodes.Count() >= kMaxNodeSetSize) {
+			status = B_BUFFER_OVERFLOW;
+			break;
+		}
+
+		status = nodes.Add(QueryPolicy::IndexIteratorGetNodeID(iterator));
+	}
+
+	QueryPolicy::IndexIteratorDelete(iterator);
+	QueryPolicy::IndexUnset(index);
+
+	if (status != B_ENTRY_NOT_FOUND)
+		return status;
+
+	// we've reached the end of the matching index entries
+	nodes.Sort();
+	return B_OK;
+}
+
+
+/*!	Advances \a iterator to the next index entry that matches this equation,
+	as far as this can be decided by looking at the index alone.
+*/
+template<typename QueryPolicy>
+status_t
+Equation<QueryPolicy>::_NextMatchingIndexEntry(IndexIterator* iterator)
+{
+	while (true) {
+		union value<QueryPolicy> indexValue;
+		size_t keyLength;
+		size_t duplicate = 0;
+
+		status_t status = QueryPolicy::IndexIteratorFetchNextEntry(iterator,
+			&indexValue, &keyLength, (size_t)sizeof(indexValue), &duplicate);
+		if (status != B_OK)
+			return status;
+
+		// only compare against the index entry when this is the correct
+		// index for the equation
+		if (fHasIndex && duplicate < 2
+			&& !CompareTo((uint8*)&indexValue, keyLength)) {
+			// They aren't equal? Let the operation decide what to do. Since
+			// we always start at the beginning of the index (or the correct
+			// position), only some needs to be stopped if the entry doesn't
+			// fit.
+			if (Term<QueryPolicy>::fOp == OP_LESS_THAN
+				|| Term<QueryPolicy>::fOp == OP_LESS_THAN_OR_EQUAL
+				|| (Term<QueryPolicy>::fOp == OP_EQUAL && !fIsPattern))
+				return B_ENTRY_NOT_FOUND;
+
+			if (duplicate > 0)
+				QueryPolicy::IndexIteratorSkipDuplicates(iterator);
+			continue;
+		}
+
+		return B_OK;
+	}
+}
+
+
+/*!	Checks the node against the node sets of the other sides of all
+	&&-operators above this equation.
+*/
+template<typename QueryPolicy>
+bool
+Equation<QueryPolicy>::_MatchesNodeSets(ino_t id)
+{
+	Term<QueryPolicy>* term = this;
+	while (true) {
+		Operator<QueryPolicy>* parent = (Operator<QueryPolicy>*)term->Parent();
+		if (parent == NULL)
+			return true;
+
+		if (parent->Op() == OP_AND) {
+			Term<QueryPolicy>* other = parent->Right();
+			if (other == term)
+				other = parent->Left();
+
+			if (other != NULL && other->MatchingNodes() != NULL
+				&& !other->MatchingNodes()->Contains(id))
+				return false;
+		}
+		term = parent;
+	}
+}
+
+
 //	#pragma mark -
 
 
@@ -1098,6 +1385,51 @@ Operator<QueryPolicy>::Score() const
 }
 
 
+template<typename QueryPolicy>
+int64
+Operator<QueryPolicy>::EstimateMatchCount(Index& index)
+{
+	int64 left = fLeft->EstimateMatchCount(index);
+	int64 right = fRight->EstimateMatchCount(index);
+	if (left < 0 || right < 0)
+		return -1;
+
+	if (Term<QueryPolicy>::fOp == OP_AND)
+		return std::min(left, right);
+
+	return left + right;
+}
+
+
+/*!	Intersects (for OP_AND), or unites (for OP_OR) the node sets of both
+	sides.
+*/
+template<typename QueryPolicy>
+status_t
+Operator<QueryPolicy>::CollectMatchingNodes(Context* context, NodeIDSet& nodes)
+{
+	status_t status = fLeft->CollectMatchingNodes(context, nodes);
+	if (status != B_OK)
+		return status;
+
+	NodeIDSet rightNodes;
+	status = fRight->CollectMatchingNodes(context, rightNodes);
+	if (status != B_OK)
+		return status;
+
+	if (Term<QueryPolicy>::fOp == OP_AND) {
+		nodes.IntersectWith(rightNodes);
+		return B_OK;
+	}
+
+	status = nodes.UniteWith(rightNodes);
+	if (status == B_OK && nodes.Count() > kMaxNodeSetSize)
+		return B_BUFFER_OVERFLOW;
+
+	return status;
+}
+
+
 template<typename QueryPolicy>
 status_t
 Operator<QueryPolicy>::InitCheck()
@@ -1482,6 +1814,9 @@ Query<QueryPolicy>::Rewind()
 	fIterator = NULL;
 	fCurrent = NULL;
 
+	// the node sets only reflect the indices at the time they were built
+	_ClearNodeSets(fExpression->Root());
+
 	// put the whole expression on the stack
 
 	Stack<Term<QueryPolicy>*> stack;
@@ -1656,6 +1991,8 @@ Query<QueryPolicy>::_GetNextEntry(struct dirent* dirent, size_t size)
 
 			if (status != B_OK)
 				return status;
+
+			_PlanNodeSets(fCurrent);
 		}
 		if (fCurrent == NULL)
 			QUERY_RETURN_ERROR(B_ERROR);
@@ -1674,6 +2011,76 @@ Query<QueryPolicy>::_GetNextEntry(struct dirent* dirent, size_t size)
 }
 
 
+/*!	Decides for each &&-operator above \a equation, whose index is going to
+	be iterated, if the other side of the operator should be resolved into a
+	set of nodes from its indices up front. Then the nodes found in the
+	iterated index can be checked against that set instead of having to
+	read their attributes one by one.
+	This is only done if the set is expected to be cheaper to build than
+	checking all nodes found in the iterated index would be.
+*/
+template<typename QueryPolicy>
+void
+Query<QueryPolicy>::_PlanNodeSets(Equation<QueryPolicy>* equation)
+{
+	Index index(fContext);
+
+	int64 candidates = equation->EstimateMatchCount(index);
+	if (candidates < 0) {
+		// we're iterating over an index that doesn't belong to the equation
+		candidates = (int64)kMaxNodeSetSize * kMatchCostFactor;
+	}
+
+	Term<QueryPolicy>* term = equation;
+	while (true) {
+		Operator<QueryPolicy>* parent = (Operator<QueryPolicy>*)term->Parent();
+		if (parent == NULL)
+			break;
+
+		Term<QueryPolicy>* other = parent->Right();
+		if (other == term)
+			other = parent->Left();
+
+		// Terms that need the entry cannot be resolved to a set of nodes, as
+		// a node might have several entries (hard links)
+		if (parent->Op() == OP_AND && other != NULL
+			&& other->MatchingNodes() == NULL && !other->NeedsEntry()) {
+			int64 count = other->EstimateMatchCount(index);
+			if (count >= 0 && count <= kMaxNodeSetSize
+				&& count <= candidates * kMatchCostFactor) {
+				NodeIDSet* nodes = new(std::nothrow) NodeIDSet;
+				if (nodes != NULL
+					&& other->CollectMatchingNodes(fContext, *nodes) == B_OK) {
+					other->SetMatchingNodes(nodes);
+				} else
+					delete nodes;
+			}
+		}
+
+		term = parent;
+	}
+
+	QueryPolicy::IndexUnset(index);
+}
+
+
+template<typename QueryPolicy>
+void
+Query<QueryPolicy>::_ClearNodeSets(Term<QueryPolicy>* term)
+{
+	if (term == NULL)
+		return;
+
+	term->SetMatchingNodes(NULL);
+
+	if (term->Op() < OP_EQUATION) {
+		Operator<QueryPolicy>* op = (Operator<QueryPolicy>*)term;
+		_ClearNodeSets(op->Left());
+		_ClearNodeSets(op->Right());
+	}
+}
+
+
 template<typename QueryPolicy>
 void
 Query<QueryPolicy>::_SendEntryNotification(Entry* entry,
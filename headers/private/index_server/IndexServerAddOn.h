@@ -29,6 +29,12 @@ public:
 	bigtime_t			syncPosition;
 	bigtime_t			watchingStart;
 	bigtime_t			watchingPosition;
+	//! catch up progress: all entries up to catchUpDirectory/catchUpName in
+	//! the order of the catch up, that have not been modified after
+	//! catchUpEnd, are analysed already. 0 if there is no checkpoint.
+	bigtime_t			catchUpEnd;
+	ino_t				catchUpDirectory;
+	BString				catchUpName;
 };
 
 
@@ -57,6 +63,9 @@ public:
 			void				SetSyncPosition(bigtime_t time);
 			void				SetWatchingStart(bigtime_t time);
 			void				SetWatchingPosition(bigtime_t time);
+			void				SetCatchUpCheckpoint(bigtime_t end,
+									const entry_ref& ref);
+			void				ClearCatchUpCheckpoint();
 
 			bool				CatchUpEnabled();
 			bigtime_t			SyncPosition();
@@ -178,6 +178,9 @@ int _user_setrlimit(int resource, const struct rlimit * rlp);
 #endif
 
 
+status_t thread_set_cpu_mask(thread_id id, const CPUSet& mask);
+
+
 /*!	Checks whether the current thread would immediately be interrupted when
 	blocking it with the given wait/interrupt flags.
 
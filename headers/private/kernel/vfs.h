@@ -237,6 +237,9 @@ status_t	_user_setcwd(int fd, const char *path);
 status_t	_user_change_root(const char *path);
 int			_user_open_query(dev_t device, const char *query,
 				size_t queryLength, uint32 flags, port_id port, int32 token);
+ssize_t		_user_read_dir_stat(int fd, struct dirent *buffer,
+				size_t bufferSize, uint32 maxCount, struct stat *stats,
+				size_t statSize);
 
 /* fd user prototypes (implementation located in fd.cpp)  */
 ssize_t		_user_read(int fd, off_t pos, void *buffer, size_t bufferSize);
@@ -269,10 +272,14 @@ ssize_t		_user_recv(int socket, void *data, size_t length, int flags);
 ssize_t		_user_recvfrom(int socket, void *data, size_t length, int flags,
 				struct sockaddr *address, socklen_t *_addressLength);
 ssize_t		_user_recvmsg(int socket, struct msghdr *message, int flags);
+ssize_t		_user_recvmmsg(int socket, struct mmsghdr *messages,
+				unsigned int count, int flags, bigtime_t timeout);
 ssize_t		_user_send(int socket, const void *data, size_t length, int flags);
 ssize_t		_user_sendto(int socket, const void *data, size_t length, int flags,
 				const struct sockaddr *address, socklen_t addressLength);
 ssize_t		_user_sendmsg(int socket, const struct msghdr *message, int flags);
+ssize_t		_user_sendmmsg(int socket, struct mmsghdr *messages,
+				unsigned int count, int flags);
 status_t	_user_getsockopt(int socket, int level, int option, void *value,
 				socklen_t *_length);
 status_t	_user_setsockopt(int socket, int level, int option,
@@ -286,6 +293,9 @@ status_t	_user_socketpair(int family, int type, int protocol,
 				int *socketVector);
 status_t	_user_get_next_socket_stat(int family, uint32 *cookie,
 				struct net_stat *stat);
+ssize_t		_user_sendfile(int socket, int fd, off_t *offset, size_t count);
+ssize_t		_user_splice(int fdIn, off_t *offsetIn, int fdOut, off_t *offsetOut,
+				size_t length, uint32 flags);
 
 #ifdef __cplusplus
 }
@@ -106,6 +106,9 @@ area_id vm_map_physical_memory_vecs(team_id team, const char* name,
 area_id vm_map_file(team_id aid, const char *name, void **address,
 			uint32 addressSpec, addr_t size, uint32 protection, uint32 mapping,
 			bool unmapAddressRange, int fd, off_t offset);
+area_id vm_map_file_etc(team_id aid, const char *name, void **address,
+			uint32 addressSpec, addr_t size, uint32 protection, uint32 mapping,
+			bool unmapAddressRange, int fd, off_t offset, bool kernel);
 struct VMCache *vm_area_get_locked_cache(struct VMArea *area);
 void vm_area_put_locked_cache(struct VMCache *cache);
 area_id vm_create_null_area(team_id team, const char *name, void **address,
@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2010, Haiku, Inc. All Rights Reserved.
+ * Copyright 2006-2026, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  */
 #ifndef NET_UTILITIES_H
@@ -64,18 +64,28 @@ public:
 	}
 
 	inline operator uint16()
+	{
+		uint16 result = Folded();
+		result ^= 0xFFFF;
+		return result;
+	}
+
+	inline uint16 Folded()
 	{
 		while (fSum >> 16) {
 			fSum = (fSum & 0xffff) + (fSum >> 16);
 		}
-		uint16 result = (uint16)fSum;
-		result ^= 0xFFFF;
-		return result;
+		return (uint16)fSum;
 	}
 
 	static uint16 PseudoHeader(net_address_module_info* addressModule,
 		net_buffer_module_info* bufferModule, net_buffer* buffer,
 		uint16 protocol);
+	static uint16 PartialPseudoHeader(
+		net_address_module_info* addressModule, net_buffer* buffer,
+		uint16 protocol);
+	static status_t CompletePartial(net_buffer_module_info* bufferModule,
+		net_buffer* buffer);
 
 private:
 	uint32 fSum;
@@ -95,6 +105,50 @@ Checksum::PseudoHeader(net_address_module_info* addressModule,
 }
 
 
+/*!	Returns the sum of the pseudo header only, as it has to be stored in
+	the checksum field of a buffer marked NET_BUFFER_CHECKSUM_PARTIAL. The
+	buffer must only contain the transport header and its data.
+*/
+inline uint16
+Checksum::PartialPseudoHeader(net_address_module_info* addressModule,
+	net_buffer* buffer, uint16 protocol)
+{
+	Checksum checksum;
+	addressModule->checksum_address(&checksum, buffer->source);
+	addressModule->checksum_address(&checksum, buffer->destination);
+	checksum << (uint16)htons(protocol) << (uint16)htons(buffer->size);
+	return checksum.Folded();
+}
+
+
+/*!	Computes the checksum of a buffer marked NET_BUFFER_CHECKSUM_PARTIAL
+	in software, as its device cannot do it.
+*/
+inline status_t
+Checksum::CompletePartial(net_buffer_module_info* bufferModule,
+	net_buffer* buffer)
+{
+	if ((buffer->offload_flags & NET_BUFFER_CHECKSUM_PARTIAL) == 0)
+		return B_OK;
+
+	uint32 start = buffer->size - buffer->transport_size;
+	int32 checksum = bufferModule->checksum(buffer, start,
+		buffer->transport_size, true);
+	if (checksum < 0)
+		return checksum;
+
+	// the sum of the pseudo header is already in the checksum field; a
+	// result of zero must be sent as 0xffff for UDP
+	uint16 result = checksum != 0 ? (uint16)checksum : 0xffff;
+	status_t status = bufferModule->write(buffer,
+		start + buffer->checksum_offset, &result, sizeof(result));
+	if (status == B_OK)
+		buffer->offload_flags &= ~NET_BUFFER_CHECKSUM_PARTIAL;
+
+	return status;
+}
+
+
 /*!	Helper class that prints an address (and optionally a port) into a buffer
 	that is automatically freed at end of scope.
 */
@@ -139,4 +193,24 @@ private:
 };
 
 
+/*!	Chooses one of \a count sockets that share a port by means of
+	SO_REUSEPORT for the connection between \a local and \a peer. All packets
+	of a connection are given to the same socket.
+*/
+inline uint32
+reuse_port_index(net_address_module_info* module, const sockaddr* local,
+	const sockaddr* peer, uint32 count)
+{
+	// hash_address_pair() just XORs addresses and ports, which leaves the
+	// lower bits equal for many connections
+	uint32 hash = module->hash_address_pair(local, peer);
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+	return hash % count;
+}
+
+
 #endif	// NET_UTILITIES_H
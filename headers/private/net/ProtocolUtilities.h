@@ -1,5 +1,5 @@
 /*
- * Copyright 2007-2013, Haiku, Inc. All Rights Reserved.
+ * Copyright 2007-2026, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -14,6 +14,9 @@
 #include <util/AutoLock.h>
 #include <util/DoublyLinkedList.h>
 
+#include <net/bpf.h>
+#include <sys/socket.h>
+
 #include <AddressUtilities.h>
 #include <net_buffer.h>
 #include <net_protocol.h>
@@ -116,6 +119,9 @@ public:
 			status_t			Enqueue(net_buffer* buffer);
 			status_t			EnqueueClone(net_buffer* buffer);
 
+			status_t			SetFilter(int option, const void* value,
+									int length);
+
 			status_t			Dequeue(uint32 flags, net_buffer** _buffer);
 			net_buffer*			Dequeue(bool clone);
 			status_t			BlockingDequeue(bool peek, bigtime_t timeout,
@@ -151,6 +157,7 @@ protected:
 			sem_id				fNotify;
 			BufferList			fBuffers;
 			size_t				fCurrentBytes;
+			net_filter*			fFilter;
 	mutable	LockType			fLock;
 };
 
@@ -163,7 +170,7 @@ protected:
 DECL_DATAGRAM_SOCKET(inline)::DatagramSocket(const char* name,
 	net_socket* socket)
 	:
-	ProtocolSocket(socket), fCurrentBytes(0)
+	ProtocolSocket(socket), fCurrentBytes(0), fFilter(NULL)
 {
 	status_t status = LockingBase::Init(&fLock, name);
 	if (status != B_OK)
@@ -177,6 +184,8 @@ DECL_DATAGRAM_SOCKET(inline)::~DatagramSocket()
 {
 	_Clear();
 	delete_sem(fNotify);
+	if (fFilter != NULL)
+		ModuleBundle::Stack()->delete_filter(fFilter);
 	LockingBase::Destroy(&fLock);
 }
 
@@ -190,6 +199,18 @@ DECL_DATAGRAM_SOCKET(inline status_t)::InitCheck() const
 DECL_DATAGRAM_SOCKET(inline status_t)::Enqueue(net_buffer* buffer)
 {
 	AutoLocker _(fLock);
+
+	if (fFilter != NULL) {
+		uint32 accepted = ModuleBundle::Stack()->run_filter(fFilter, buffer);
+		if (accepted == 0) {
+			// the socket does not want it, which is not an error
+			ModuleBundle::Buffer()->free(buffer);
+			return B_OK;
+		}
+		if (accepted < buffer->size)
+			ModuleBundle::Buffer()->trim(buffer, accepted);
+	}
+
 	return _Enqueue(buffer);
 }
 
@@ -198,10 +219,20 @@ DECL_DATAGRAM_SOCKET(inline status_t)::EnqueueClone(net_buffer* _buffer)
 {
 	AutoLocker _(fLock);
 
+	uint32 accepted = _buffer->size;
+	if (fFilter != NULL) {
+		accepted = ModuleBundle::Stack()->run_filter(fFilter, _buffer);
+		if (accepted == 0)
+			return B_OK;
+	}
+
 	net_buffer* buffer = ModuleBundle::Buffer()->clone(_buffer, false);
 	if (buffer == NULL)
 		return B_NO_MEMORY;
 
+	if (accepted < buffer->size)
+		ModuleBundle::Buffer()->trim(buffer, accepted);
+
 	status_t status = _Enqueue(buffer);
 	if (status != B_OK)
 		ModuleBundle::Buffer()->free(buffer);
@@ -210,6 +241,37 @@ DECL_DATAGRAM_SOCKET(inline status_t)::EnqueueClone(net_buffer* _buffer)
 }
 
 
+/*!	Handles SO_ATTACH_FILTER, and SO_DETACH_FILTER: the filter decides which
+	of the buffers that are enqueued the socket receives, and how much of
+	them.
+*/
+DECL_DATAGRAM_SOCKET(inline status_t)::SetFilter(int option,
+	const void* value, int length)
+{
+	net_filter* filter = NULL;
+	if (option == SO_ATTACH_FILTER) {
+		if (length != sizeof(struct bpf_program))
+			return B_BAD_VALUE;
+
+		status_t status = ModuleBundle::Stack()->create_filter(
+			(const struct bpf_program*)value, &filter);
+		if (status != B_OK)
+			return status;
+	}
+
+	AutoLocker _(fLock);
+
+	if (filter == NULL && fFilter == NULL)
+		return ENOENT;
+
+	if (fFilter != NULL)
+		ModuleBundle::Stack()->delete_filter(fFilter);
+	fFilter = filter;
+
+	return B_OK;
+}
+
+
 DECL_DATAGRAM_SOCKET(inline status_t)::Dequeue(uint32 flags,
 	net_buffer** _buffer)
 {
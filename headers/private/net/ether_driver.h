@@ -1,5 +1,5 @@
 /*
- * Copyright 2007, Haiku, Inc. All Rights Reserved.
+ * Copyright 2007-2026, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  */
 #ifndef _ETHER_DRIVER_H
@@ -9,6 +9,7 @@
 
 
 #include <Drivers.h>
+#include <OS.h>
 
 
 /* ioctl() opcodes a driver should support */
@@ -23,8 +24,16 @@ enum {
 	ETHER_GETFRAMESIZE,						/* get frame size (required) (int *) */
 	ETHER_SET_LINK_STATE_SEM,
 		/* pass over a semaphore to release on link state changes (sem_id *) */
-	ETHER_GET_LINK_STATE
+	ETHER_GET_LINK_STATE,
 		/* get line speed, quality, duplex mode, etc. (ether_link_state_t *) */
+	ETHER_GET_OFFLOAD,
+		/* get the supported ETHER_OFFLOAD_* capabilities (uint32 *) */
+	ETHER_SET_OFFLOAD,
+		/* enable ETHER_OFFLOAD_* capabilities (uint32 *) */
+	ETHER_ATTACH_PACKET_RING,
+		/* receive into a packet ring (ether_packet_ring *, kernel only) */
+	ETHER_DETACH_PACKET_RING
+		/* stop using the packet ring of a queue (uint32 *, kernel only) */
 };
 
 
@@ -40,4 +49,48 @@ typedef struct ether_link_state {
 	uint64	speed;		/* in bit/s */
 } ether_link_state_t;
 
+/* ETHER_GET_OFFLOAD, ETHER_SET_OFFLOAD */
+#define ETHER_OFFLOAD_RX_CHECKSUM	0x01	/* verifies TCP/UDP checksums */
+#define ETHER_OFFLOAD_TX_CHECKSUM	0x02	/* completes partial checksums */
+#define ETHER_OFFLOAD_TSO4			0x04	/* segments TCP over IPv4 */
+#define ETHER_OFFLOAD_TSO6			0x08	/* segments TCP over IPv6 */
+
+/* Once any offload has been enabled, every frame passed to read() and
+   write() is preceded by this header. It matches the virtio-net header. */
+typedef struct ether_offload_header {
+	uint8	flags;
+	uint8	segmentation;
+	uint16	header_length;		/* link, network, and transport headers */
+	uint16	segment_size;		/* payload per segment */
+	uint16	checksum_start;		/* start of the transport header */
+	uint16	checksum_offset;	/* of the checksum field from there */
+} _PACKED ether_offload_header;
+
+/* ether_offload_header::flags */
+#define ETHER_OFFLOAD_NEEDS_CHECKSUM	0x01
+	/* write: the checksum field holds the pseudo header sum only */
+#define ETHER_OFFLOAD_CHECKSUM_VALID	0x02
+	/* read: the transport checksum has been verified */
+
+/* ether_offload_header::segmentation */
+#define ETHER_OFFLOAD_SEGMENT_NONE		0
+#define ETHER_OFFLOAD_SEGMENT_TCP4		1
+#define ETHER_OFFLOAD_SEGMENT_TCP6		4
+
+/* ETHER_ATTACH_PACKET_RING - the frames of the receive queue are no longer
+   returned by read(), but are put into the descriptors of the ring; a frame
+   stays with the ring until the consumer index has been moved past it. */
+typedef struct ether_packet_ring {
+	uint32	queue;
+	struct packet_ring_descriptor* descriptors;
+	uint32	size;				/* of the ring, a power of two */
+	struct packet_ring_index* index;
+	volatile uint32* dropped;
+	void	(*notify)(void* cookie);
+		/* to be called when frames were added to an empty ring */
+	void*	cookie;
+	area_id	frame_area;
+		/* returned: the descriptor offsets are relative to its start */
+} ether_packet_ring;
+
 #endif	/* _ETHER_DRIVER_H */
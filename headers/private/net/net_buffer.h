@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2010, Haiku, Inc. All Rights Reserved.
+ * Copyright 2006-2026, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  */
 #ifndef NET_BUFFER_H
@@ -35,10 +35,30 @@ typedef struct net_buffer {
 	uint32					flags;
 	uint32					size;
 	uint8					protocol;
+
+	// checksum and segmentation offload
+	uint8					checksum_offset;
+		// of the checksum field within the transport header
+	uint16					offload_flags;
+	uint16					transport_size;
+		// size of the transport header and its data at the end of the buffer
+	uint16					segment_size;
+		// payload size of the segments for NET_BUFFER_SEGMENT_TCP, or of the
+		// datagrams a received UDP buffer has been coalesced from
 } net_buffer;
 
+// net_buffer::offload_flags
+#define NET_BUFFER_CHECKSUM_PARTIAL	0x0001
+	// the checksum field only contains the pseudo header sum
+#define NET_BUFFER_CHECKSUM_VALID	0x0002
+	// the transport checksum has already been verified
+#define NET_BUFFER_SEGMENT_TCP		0x0004
+	// to be cut into TCP segments of segment_size bytes
+
 struct ancillary_data_container;
 
+typedef void (*net_buffer_release_func)(void* cookie);
+
 struct net_buffer_module_info {
 	module_info info;
 
@@ -67,6 +87,9 @@ struct net_buffer_module_info {
 	status_t		(*trim)(net_buffer* buffer, size_t newSize);
 	status_t		(*append_cloned)(net_buffer* buffer, net_buffer* source,
 						uint32 offset, size_t bytes);
+	status_t		(*append_external)(net_buffer* buffer, void* data,
+						size_t bytes, net_buffer_release_func release,
+						void* cookie);
 
 	status_t		(*associate_data)(net_buffer* buffer, void* data);
 
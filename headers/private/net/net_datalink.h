@@ -30,6 +30,10 @@ typedef struct net_domain {
 
 	struct net_protocol_module_info* module;
 	struct net_address_module_info* address_module;
+
+	int32				route_generation;
+		// changes whenever a route is added or removed, so that a route
+		// cached by a protocol can be validated without a lookup
 } net_domain;
 
 typedef struct net_interface_address {
@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2010, Haiku, Inc. All Rights Reserved.
+ * Copyright 2006-2026, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  */
 #ifndef NET_DEVICE_H
@@ -32,11 +32,51 @@ typedef struct net_device {
 	uint32	link_quality;
 	size_t	header_length;
 
+	// Devices with more than one hardware queue implement the
+	// receive_queue_data() and send_queue_data() hooks; 0 means 1.
+	uint32	receive_queue_count;
+	uint32	transmit_queue_count;
+
+	uint32	offload;	// NET_DEVICE_OFFLOAD_*
+
 	struct net_hardware_address address;
 
 	struct ifreq_stats stats;
 } net_device;
 
+// net_device::offload
+#define NET_DEVICE_OFFLOAD_RX_CHECKSUM	0x01
+	// received buffers may be marked NET_BUFFER_CHECKSUM_VALID
+#define NET_DEVICE_OFFLOAD_TX_CHECKSUM	0x02
+	// accepts buffers marked NET_BUFFER_CHECKSUM_PARTIAL
+#define NET_DEVICE_OFFLOAD_TSO4			0x04
+#define NET_DEVICE_OFFLOAD_TSO6			0x08
+	// accepts buffers marked NET_BUFFER_SEGMENT_TCP
+#define NET_DEVICE_OFFLOAD_GSO			0x10
+	// set by the stack: it segments large TCP buffers itself
+#define NET_DEVICE_OFFLOAD_GRO			0x20
+	// set by the stack: it coalesces received TCP segments
+
+/*!	Lets a device put the frames of one of its receive queues into a
+	packet ring directly (see packet_ring.h); the kernel copies of the ring
+	indices and size are passed in, as the ring itself is writable by
+	userland.
+*/
+typedef struct net_device_packet_ring {
+	struct packet_ring_descriptor* descriptors;
+	uint32	size;
+	struct packet_ring_index* index;
+	volatile uint32* dropped;
+
+	void	(*notify)(void* cookie);
+		// to be called when frames were added to an empty ring
+	void*	cookie;
+
+	area_id	frame_area;
+		// set by the device: the descriptor offsets are relative to the
+		// start of this area
+} net_device_packet_ring;
+
 
 struct net_device_module_info {
 	struct module_info info;
@@ -61,6 +101,17 @@ struct net_device_module_info {
 					const struct sockaddr* address);
 	status_t	(*remove_multicast)(net_device* device,
 					const struct sockaddr* address);
+
+	// optional, for devices with multiple queues
+	status_t	(*send_queue_data)(net_device* device, uint32 queue,
+					net_buffer* buffer);
+	status_t	(*receive_queue_data)(net_device* device, uint32 queue,
+					net_buffer** _buffer);
+
+	// optional, for devices that can receive into a packet ring
+	status_t	(*attach_packet_ring)(net_device* device, uint32 queue,
+					net_device_packet_ring* ring);
+	void		(*detach_packet_ring)(net_device* device, uint32 queue);
 };
 
 
@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2010, Haiku, Inc. All Rights Reserved.
+ * Copyright 2006-2026, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  */
 #ifndef NET_STACK_H
@@ -25,6 +25,9 @@ typedef struct net_socket net_socket;
 
 struct net_timer;
 
+struct bpf_program;
+typedef struct net_filter net_filter;
+
 
 typedef struct net_fifo {
 	mutex		lock;
@@ -182,6 +185,12 @@ struct net_stack_module_info {
 					ancillary_data_container* to);
 	void*		(*next_ancillary_data)(ancillary_data_container* container,
 					void* previousData, ancillary_data_header* _header);
+
+	// packet filters
+	status_t	(*create_filter)(const struct bpf_program* program,
+					net_filter** _filter);
+	void		(*delete_filter)(net_filter* filter);
+	uint32		(*run_filter)(net_filter* filter, net_buffer* buffer);
 };
 
 
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef PACKET_RING_H
+#define PACKET_RING_H
+
+
+/*!	A memory mapped packet ring, set up on an AF_LINK socket with
+	SIOCSPACKETRING. The kernel puts the received frames of a device into
+	the receive ring, and sends the frames userland puts into the transmit
+	ring on SIOCFPACKETRING. Neither direction needs a syscall per frame;
+	waiting for frames works with select() and poll() on the socket.
+
+	Each ring is a power of two of descriptors, indexed by free running
+	counters. The kernel produces, and userland consumes the receive ring;
+	it is the other way around for the transmit ring. A descriptor and the
+	frame it points to belong to the consumer until it has moved its index
+	past them.
+*/
+
+
+#include <OS.h>
+
+#include <net/if.h>
+
+
+#define PACKET_RING_VERSION			1
+#define PACKET_RING_MAX_SIZE		32768
+	// the maximum number of descriptors in each ring
+
+
+typedef struct packet_ring_index {
+	volatile uint32	producer;
+	uint32			_reserved0[15];
+	volatile uint32	consumer;
+	uint32			_reserved1[15];
+		// keeps both sides on their own cache line
+} packet_ring_index;
+
+typedef struct packet_ring_descriptor {
+	uint32	offset;
+		// of the frame from the rx_frames, or tx_frames address
+	uint32	length;
+	uint32	flags;
+	uint32	_reserved;
+} packet_ring_descriptor;
+
+// packet_ring_descriptor::flags
+#define PACKET_RING_CHECKSUM_VALID	0x01
+	// the transport checksum of the received frame has been verified
+#define PACKET_RING_TRUNCATED		0x02
+	// the received frame was larger than the frame size
+
+typedef struct packet_ring_header {
+	uint32				version;
+	uint32				flags;
+		// PACKET_RING_ZERO_COPY when the device fills the receive ring
+	uint32				frame_size;
+	uint32				rx_size;
+	uint32				tx_size;
+	uint32				rx_descriptors;
+	uint32				tx_descriptors;
+		// offsets of the descriptor arrays from the start of the header
+	volatile uint32		dropped;
+		// received frames that did not fit into the ring anymore
+	uint32				_reserved[8];
+
+	packet_ring_index	rx;
+	packet_ring_index	tx;
+} packet_ring_header;
+
+// packet_ring_request::flags, packet_ring_header::flags
+#define PACKET_RING_COPY			0x01
+	// frames are copied into the ring by the stack
+#define PACKET_RING_ZERO_COPY		0x02
+	// the device receives into memory shared with the ring
+
+/*!	The argument of SIOCSPACKETRING. Without any flags, the ring uses copy
+	mode; the mode in use is returned in the flags.
+
+	PACKET_RING_ZERO_COPY has to be asked for explicitly, and fails if the
+	device does not support it. It takes the receive queue away from the
+	stack: the frames of that queue only end up in the ring, and are never
+	seen by the network stack, or any other socket, for as long as the ring
+	exists.
+*/
+typedef struct packet_ring_request {
+	char				name[IF_NAMESIZE];
+		// of the device
+	uint32				queue;
+		// the receive queue of the device to bind the ring to
+	uint32				flags;
+	uint32				frame_size;
+	uint32				rx_size;
+	uint32				tx_size;
+
+	// returned
+	packet_ring_header*	ring;
+	void*				rx_frames;
+	void*				tx_frames;
+} packet_ring_request;
+
+
+#endif	// PACKET_RING_H
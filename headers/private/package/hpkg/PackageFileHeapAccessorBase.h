@@ -85,6 +85,8 @@ public:
 									{ return fUncompressedHeapSize; }
 			size_t				ChunkSize() const
 									{ return kChunkSize; }
+			DecompressionAlgorithmOwner* DecompressionAlgorithm() const
+									{ return fDecompressionAlgorithm; }
 
 			// normally used after cloning a PackageFileHeapReader only
 			void				SetErrorOutput(BErrorOutput* errorOutput)
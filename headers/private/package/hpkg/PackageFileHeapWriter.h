@@ -42,7 +42,8 @@ public:
 										decompressionAlgorithm);
 								~PackageFileHeapWriter();
 
-			void				Init();
+			void				Init(int32 threadCount = 1,
+									bool useDictionary = false);
 			void				Reinit(PackageFileHeapReader* heapReader);
 
 			status_t			AddData(BDataReader& dataReader, off_t size,
@@ -63,20 +64,39 @@ private:
 			struct Chunk;
 			struct ChunkSegment;
 			struct ChunkBuffer;
+			struct CompressionJob;
+			struct CompressionPipeline;
+			struct PipelineSuspender;
 
 			friend struct ChunkBuffer;
+			friend struct CompressionPipeline;
+			friend struct PipelineSuspender;
 
 private:
 			void				_Uninit();
 
 			status_t			_FlushPendingData();
+			status_t			_QueuePendingData();
+			status_t			_WriteNextQueuedChunk(bool wait,
+									bool& _written);
+			status_t			_FlushPipeline();
+
 			status_t			_WriteChunk(const void* data, size_t size,
 									bool mayCompress);
-			status_t			_WriteDataCompressed(const void* data,
-									size_t size);
+			status_t			_WriteChunkData(const void* data, size_t size,
+									const void* compressedData,
+									size_t compressedSize,
+									status_t compressionError);
+			status_t			_CompressChunkData(const void* data,
+									size_t size, void* compressedData,
+									size_t& _compressedSize) const;
 			status_t			_WriteDataUncompressed(const void* data,
 									size_t size);
 
+			status_t			_CompressDeferredChunks();
+			status_t			_TrainDictionary();
+			status_t			_WriteDictionary();
+
 			void				_PushChunks(ChunkBuffer& chunkBuffer,
 									uint64 startOffset, uint64 endOffset);
 			void				_UnwriteLastPartialChunk();
@@ -87,6 +107,9 @@ private:
 			size_t				fPendingDataSize;
 			Array<uint64>		fOffsets;
 			CompressionAlgorithmOwner* fCompressionAlgorithm;
+			CompressionPipeline* fPipeline;
+			bool				fUseDictionary;
+			bool				fDeferCompression;
 };
 
 
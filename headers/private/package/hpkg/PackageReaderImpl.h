@@ -41,6 +41,13 @@ public:
 			status_t			ParseContent(BLowLevelPackageContentHandler*
 										contentHandler);
 
+			status_t			ParsePackageAttributes(
+									BPackageContentHandler* contentHandler);
+			status_t			ParseTOC(
+									BPackageContentHandler* contentHandler);
+									// each may be called only once, and
+									// instead of ParseContent()
+
 			BPositionIO*		PackageFile() const;
 
 			uint64				HeapOffset() const;
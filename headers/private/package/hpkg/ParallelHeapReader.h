@@ -0,0 +1,76 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _PACKAGE__HPKG__PRIVATE__PARALLEL_HEAP_READER_H_
+#define _PACKAGE__HPKG__PRIVATE__PARALLEL_HEAP_READER_H_
+
+
+#include <pthread.h>
+
+#include <package/hpkg/DataReader.h>
+
+
+namespace BPackageKit {
+
+namespace BHPKG {
+
+namespace BPrivate {
+
+
+class PackageFileHeapReader;
+
+
+/*!	Reads from a package file heap, decompressing the chunks following the
+	one last read on a number of worker threads. Meant for reading the heap
+	more or less sequentially, like when extracting a package.
+
+	The object does not own the heap reader, whose file must support
+	concurrent ReadAt() calls, like BFile and BFdIO do. It must not be used by
+	more than one thread at a time.
+*/
+class ParallelHeapReader : public BAbstractBufferedDataReader {
+public:
+								ParallelHeapReader(
+									PackageFileHeapReader* heapReader);
+	virtual						~ParallelHeapReader();
+
+			status_t			Init(int32 threadCount);
+									// 0: one thread per CPU
+
+	virtual	status_t			ReadDataToOutput(off_t offset, size_t size,
+									BDataIO* output);
+
+private:
+			struct Slot;
+
+private:
+	static	void*				_Worker(void* data);
+			void				_Work();
+
+			status_t			_GetChunk(size_t chunkIndex, Slot*& _slot);
+			void				_ScheduleReadAhead(size_t chunkIndex);
+
+private:
+			PackageFileHeapReader* fHeapReader;
+			pthread_mutex_t		fLock;
+			pthread_cond_t		fWorkCondition;
+			pthread_cond_t		fDoneCondition;
+			pthread_t*			fThreads;
+			int32				fThreadCount;
+			Slot*				fSlots;
+			int32				fSlotCount;
+			size_t				fChunkCount;
+			void*				fCompressedDataBuffer;
+			bool				fQuitting;
+};
+
+
+}	// namespace BPrivate
+
+}	// namespace BHPKG
+
+}	// namespace BPackageKit
+
+
+#endif	// _PACKAGE__HPKG__PRIVATE__PARALLEL_HEAP_READER_H_
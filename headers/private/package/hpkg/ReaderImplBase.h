@@ -24,6 +24,7 @@
 
 class BCompressionAlgorithm;
 class BDecompressionParameters;
+class BZstdDecompressionParameters;
 
 
 namespace BPackageKit {
@@ -171,6 +172,11 @@ protected:
 private:
 			status_t			_Init(BPositionIO* file, bool keepFile);
 
+			status_t			_ReadHeapDictionary(off_t heapOffset,
+									uint64& _compressedHeapSize,
+									BZstdDecompressionParameters*
+										parameters);
+
 			status_t			_ParseAttributeTree(
 									AttributeHandlerContext* context);
 
@@ -10,6 +10,10 @@
 #include <CompressionAlgorithm.h>
 
 
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+
+
 // compression level
 enum {
 	B_ZSTD_COMPRESSION_NONE		= 0,
@@ -32,9 +36,26 @@ public:
 			size_t				BufferSize() const;
 			void				SetBufferSize(size_t size);
 
+			const void*			Dictionary() const
+									{ return fDictionary; }
+			size_t				DictionarySize() const
+									{ return fDictionarySize; }
+			status_t			SetDictionary(const void* dictionary,
+									size_t size);
+									// CompressBuffer() only
+
+private:
+			friend class BZstdCompressionAlgorithm;
+
+private:
+			status_t			_CreateCompressionDictionary();
+
 private:
 			int32				fCompressionLevel;
 			size_t				fBufferSize;
+			void*				fDictionary;
+			size_t				fDictionarySize;
+			ZSTD_CDict_s*		fCompressionDictionary;
 };
 
 
@@ -46,8 +67,22 @@ public:
 			size_t				BufferSize() const;
 			void				SetBufferSize(size_t size);
 
+			const void*			Dictionary() const
+									{ return fDictionary; }
+			size_t				DictionarySize() const
+									{ return fDictionarySize; }
+			status_t			SetDictionary(const void* dictionary,
+									size_t size);
+									// DecompressBuffer() only
+
+private:
+			friend class BZstdCompressionAlgorithm;
+
 private:
 			size_t				fBufferSize;
+			void*				fDictionary;
+			size_t				fDictionarySize;
+			ZSTD_DDict_s*		fDecompressionDictionary;
 };
 
 
@@ -81,6 +116,15 @@ public:
 									const BDecompressionParameters* parameters
 										= NULL);
 
+	static	status_t			TrainDictionary(const void* samples,
+									const size_t* sampleSizes,
+									uint32 sampleCount, void* dictionary,
+									size_t& _dictionarySize);
+									// _dictionarySize: in: capacity,
+									// out: size
+
+	static	void				FreeCachedContexts();
+
 private:
 			struct CompressionStrategy;
 			struct DecompressionStrategy;
@@ -341,6 +341,9 @@ extern ssize_t		_kern_writev(int fd, off_t pos, const struct iovec *vecs,
 extern status_t		_kern_ioctl(int fd, uint32 cmd, void *data, size_t length);
 extern ssize_t		_kern_read_dir(int fd, struct dirent *buffer,
 						size_t bufferSize, uint32 maxCount);
+extern ssize_t		_kern_read_dir_stat(int fd, struct dirent *buffer,
+						size_t bufferSize, uint32 maxCount, struct stat *stats,
+						size_t statSize);
 extern status_t		_kern_rewind_dir(int fd);
 extern status_t		_kern_read_stat(int fd, const char *path, bool traverseLink,
 						struct stat *stat, size_t statSize);
@@ -373,6 +376,8 @@ extern ssize_t		_kern_recvfrom(int socket, void *data, size_t length,
 						socklen_t *_addressLength);
 extern ssize_t		_kern_recvmsg(int socket, struct msghdr *message,
 						int flags);
+extern ssize_t		_kern_recvmmsg(int socket, struct mmsghdr *messages,
+						unsigned int count, int flags, bigtime_t timeout);
 extern ssize_t		_kern_send(int socket, const void *data, size_t length,
 						int flags);
 extern ssize_t		_kern_sendto(int socket, const void *data, size_t length,
@@ -380,6 +385,8 @@ extern ssize_t		_kern_sendto(int socket, const void *data, size_t length,
 						socklen_t addressLength);
 extern ssize_t		_kern_sendmsg(int socket, const struct msghdr *message,
 						int flags);
+extern ssize_t		_kern_sendmmsg(int socket, struct mmsghdr *messages,
+						unsigned int count, int flags);
 extern status_t		_kern_getsockopt(int socket, int level, int option,
 						void *value, socklen_t *_length);
 extern status_t		_kern_setsockopt(int socket, int level, int option,
@@ -393,6 +400,10 @@ extern status_t		_kern_socketpair(int family, int type, int protocol,
 						int *socketVector);
 extern status_t		_kern_get_next_socket_stat(int family, uint32 *cookie,
 						struct net_stat *stat);
+extern ssize_t		_kern_sendfile(int socket, int fd, off_t *offset,
+						size_t count);
+extern ssize_t		_kern_splice(int fdIn, off_t *offsetIn, int fdOut,
+						off_t *offsetOut, size_t length, uint32 flags);
 
 // node monitor functions
 extern status_t		_kern_stop_notifying(port_id port, uint32 token);
@@ -31,6 +31,18 @@ struct fd_info {
 /* pipe/FIFO buffer capacity */
 #define VFS_FIFO_BUFFER_CAPACITY	(64 * 1024)
 
+/* entry cache statistics, available via the generic syscall */
+#define ENTRY_CACHE_SYSCALLS			"entry cache"
+#define ENTRY_CACHE_GET_STATISTICS		1
+
+struct entry_cache_statistics {
+	int64	hits;
+	int64	negative_hits;
+	int64	misses;
+	int32	entries;
+	int32	max_entries;
+};
+
 // make sure the constant values are sane
 #if VFS_FIFO_ATOMIC_WRITE_SIZE < _POSIX_PIPE_BUF
 #	error VFS_FIFO_ATOMIC_WRITE_SIZE < _POSIX_PIPE_BUF!
@@ -22,7 +22,10 @@ analyser_settings::analyser_settings()
 
 	syncPosition(0),
 	watchingStart(0),
-	watchingPosition(0)
+	watchingPosition(0),
+
+	catchUpEnd(0),
+	catchUpDirectory(0)
 {
 	
 }
@@ -34,6 +37,9 @@ const char* kCatchUpEnabledAttr = "CatchUpEnabled";
 const char* kSyncPositionAttr = "SyncPosition";
 const char* kWatchingStartAttr = "WatchingStart";
 const char* kWatchingPositionAttr = "WatchingPosition";
+const char* kCatchUpEndAttr = "CatchUpEnd";
+const char* kCatchUpDirectoryAttr = "CatchUpDirectory";
+const char* kCatchUpNameAttr = "CatchUpName";
 
 
 AnalyserSettings::AnalyserSettings(const BString& name, const BVolume& volume)
@@ -72,6 +78,18 @@ AnalyserSettings::ReadSettings()
 	file.ReadAttr(kWatchingPositionAttr, B_INT64_TYPE, 0,
 		&fAnalyserSettings.watchingPosition, sizeof(int64));
 
+	fAnalyserSettings.catchUpEnd = 0;
+	int64 directory;
+	if (file.ReadAttr(kCatchUpEndAttr, B_INT64_TYPE, 0,
+			&fAnalyserSettings.catchUpEnd, sizeof(int64)) != sizeof(int64)
+		|| file.ReadAttr(kCatchUpDirectoryAttr, B_INT64_TYPE, 0, &directory,
+			sizeof(int64)) != sizeof(int64)
+		|| file.ReadAttrString(kCatchUpNameAttr,
+			&fAnalyserSettings.catchUpName) != B_OK)
+		fAnalyserSettings.catchUpEnd = 0;
+	else
+		fAnalyserSettings.catchUpDirectory = directory;
+
 	return true;
 }
 
@@ -104,6 +122,19 @@ AnalyserSettings::WriteSettings()
 	file.WriteAttr(kWatchingPositionAttr, B_INT64_TYPE, 0,
 		&fAnalyserSettings.watchingPosition, sizeof(int64));
 
+	if (fAnalyserSettings.catchUpEnd != 0) {
+		int64 directory = fAnalyserSettings.catchUpDirectory;
+		file.WriteAttr(kCatchUpEndAttr, B_INT64_TYPE, 0,
+			&fAnalyserSettings.catchUpEnd, sizeof(int64));
+		file.WriteAttr(kCatchUpDirectoryAttr, B_INT64_TYPE, 0, &directory,
+			sizeof(int64));
+		file.WriteAttrString(kCatchUpNameAttr, &fAnalyserSettings.catchUpName);
+	} else {
+		file.RemoveAttr(kCatchUpEndAttr);
+		file.RemoveAttr(kCatchUpDirectoryAttr);
+		file.RemoveAttr(kCatchUpNameAttr);
+	}
+
 	return true;
 }
 
@@ -153,6 +184,28 @@ AnalyserSettings::SetWatchingPosition(bigtime_t time)
 }
 
 
+void
+AnalyserSettings::SetCatchUpCheckpoint(bigtime_t end, const entry_ref& ref)
+{
+	BAutolock _(fSettingsLock);
+
+	fAnalyserSettings.catchUpEnd = end;
+	fAnalyserSettings.catchUpDirectory = ref.directory;
+	fAnalyserSettings.catchUpName = ref.name;
+}
+
+
+void
+AnalyserSettings::ClearCatchUpCheckpoint()
+{
+	BAutolock _(fSettingsLock);
+
+	fAnalyserSettings.catchUpEnd = 0;
+	fAnalyserSettings.catchUpDirectory = 0;
+	fAnalyserSettings.catchUpName = "";
+}
+
+
 bool
 AnalyserSettings::CatchUpEnabled()
 {
@@ -8,14 +8,16 @@
 #include "FullTextAnalyser.h"
 
 #include <new>
+#include <string.h>
 
 #include <Directory.h>
 #include <String.h>
+#include <StringList.h>
 #include <TranslatorFormats.h>
 #include <TranslatorRoster.h>
 
-#include "CLuceneDataBase.h"
 #include "IndexServerPrivate.h"
+#include "InvertedIndexDataBase.h"
 
 
 #define DEBUG_FULLTEXT_ANALYSER
@@ -40,8 +42,10 @@ FullTextAnalyser::FullTextAnalyser(BString name, const BVolume& volume)
 	fDataBasePath.Append(kIndexServerDirectory);
 	status_t status = fDataBasePath.Append(kFullTextDirectory);
 
-	if (status == B_OK)
-		fWriteDataBase = new CLuceneWriteDataBase(fDataBasePath);
+	if (status == B_OK) {
+		_RemoveCLuceneIndex();
+		fWriteDataBase = new InvertedIndexWriteDataBase(fDataBasePath);
+	}
 }
 
 
@@ -137,6 +141,51 @@ FullTextAnalyser::_IsInIndexDirectory(const entry_ref& ref)
 }
 
 
+/*!	Indices written by the former CLucene based data base cannot be read
+	anymore. Their files are removed, and the whole volume is queued to be
+	indexed again.
+*/
+void
+FullTextAnalyser::_RemoveCLuceneIndex()
+{
+	BDirectory directory(fDataBasePath.Path());
+	if (directory.InitCheck() != B_OK
+		|| (!directory.Contains("segments")
+			&& !directory.Contains("segments.gen")))
+		return;
+
+	STRACE("removing the CLucene index in %s\n", fDataBasePath.Path());
+
+	// Collect the names first, removing entries while iterating the
+	// directory could skip some of them.
+	BStringList names;
+	char name[B_FILE_NAME_LENGTH];
+	BEntry entry;
+	while (directory.GetNextEntry(&entry) == B_OK) {
+		if (entry.GetName(name) != B_OK || entry.IsDirectory())
+			continue;
+
+		// segment files are named "_<n>.<extension>"
+		if (name[0] == '_' || strcmp(name, "segments") == 0
+			|| strcmp(name, "segments.gen") == 0
+			|| strcmp(name, "deletable") == 0
+			|| strcmp(name, "temp_file") == 0)
+			names.Add(name);
+	}
+
+	for (int32 i = 0; i < names.CountStrings(); i++) {
+		if (directory.FindEntry(names.StringAt(i), &entry) == B_OK)
+			entry.Remove();
+	}
+
+	// Start over with the catch up; the new index is empty.
+	AnalyserSettings settings(Name(), Volume());
+	settings.SetSyncPosition(0);
+	settings.ClearCatchUpCheckpoint();
+	settings.WriteSettings();
+}
+
+
 FullTextAddOn::FullTextAddOn(image_id id, const char* name)
 	:
 	IndexServerAddOn(id, name)
@@ -36,6 +36,7 @@ public:
 private:
 	inline	bool				_InterestingEntry(const entry_ref& ref);
 	inline	bool				_IsInIndexDirectory(const entry_ref& ref);
+			void				_RemoveCLuceneIndex();
 
 			TextWriteDataBase*	fWriteDataBase;
 			BPath				fDataBasePath;
@@ -0,0 +1,341 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "FullTextQuery.h"
+
+#include <algorithm>
+#include <math.h>
+#include <new>
+#include <queue>
+#include <string.h>
+
+#include <AutoLocker.h>
+
+#include "InvertedIndex.h"
+#include "Tokenizer.h"
+
+
+static const int32 kDefaultMaxHits = 100;
+
+// Okapi BM25 parameters
+static const float kK1 = 1.2f;
+static const float kB = 0.75f;
+
+
+struct ScoredDocument {
+	float	score;
+	int32	segment;
+	uint32	document;
+};
+
+
+struct ScoreGreater {
+	bool operator()(const ScoredDocument& a, const ScoredDocument& b) const
+	{
+		return a.score > b.score;
+	}
+};
+
+
+typedef std::priority_queue<ScoredDocument, std::vector<ScoredDocument>,
+	ScoreGreater> BestDocuments;
+
+
+FullTextQuery::FullTextQuery()
+	:
+	fIndex(NULL),
+	fMatchAll(true),
+	fMaxHits(kDefaultMaxHits),
+	fFetched(false),
+	fNextHit(0)
+{
+}
+
+
+FullTextQuery::~FullTextQuery()
+{
+}
+
+
+status_t
+FullTextQuery::Clear()
+{
+	fIndex = NULL;
+	fTerms.clear();
+	fMatchAll = true;
+	fMaxHits = kDefaultMaxHits;
+	fFetched = false;
+	fHits.clear();
+	fNextHit = 0;
+	return B_OK;
+}
+
+
+status_t
+FullTextQuery::SetIndex(InvertedIndex* index)
+{
+	if (fFetched)
+		return B_NOT_ALLOWED;
+
+	fIndex = index;
+	return B_OK;
+}
+
+
+/*!	Sets the terms to look for. The string is split into terms the same way
+	the documents are.
+*/
+status_t
+FullTextQuery::SetPredicate(const char* terms)
+{
+	if (fFetched)
+		return B_NOT_ALLOWED;
+	if (terms == NULL)
+		return B_BAD_VALUE;
+
+	fTerms.clear();
+
+	Tokenizer tokenizer(terms, strlen(terms));
+	const char* term;
+	size_t length;
+	while ((term = tokenizer.Next(&length)) != NULL) {
+		BString string(term, length);
+		if (std::find(fTerms.begin(), fTerms.end(), string) == fTerms.end())
+			fTerms.push_back(string);
+	}
+
+	return fTerms.empty() ? B_BAD_VALUE : B_OK;
+}
+
+
+//!	Chooses whether a document has to contain all terms, or just any of them.
+status_t
+FullTextQuery::SetMatchAll(bool matchAll)
+{
+	if (fFetched)
+		return B_NOT_ALLOWED;
+
+	fMatchAll = matchAll;
+	return B_OK;
+}
+
+
+status_t
+FullTextQuery::SetMaxHits(int32 maxHits)
+{
+	if (fFetched)
+		return B_NOT_ALLOWED;
+	if (maxHits <= 0)
+		return B_BAD_VALUE;
+
+	fMaxHits = maxHits;
+	return B_OK;
+}
+
+
+/*!	Runs the query. The posting lists of the terms are walked in parallel,
+	one document at a time, and only the best fMaxHits documents are kept.
+*/
+status_t
+FullTextQuery::Fetch()
+{
+	if (fFetched)
+		return B_NOT_ALLOWED;
+	if (fIndex == NULL || fTerms.empty())
+		return B_NO_INIT;
+
+	AutoLocker<InvertedIndex> locker(fIndex);
+
+	if (!fIndex->IsWritable()) {
+		status_t status = fIndex->Reload();
+		if (status != B_OK)
+			return status;
+	}
+
+	fFetched = true;
+	fHits.clear();
+	fNextHit = 0;
+
+	try {
+		uint32 termCount = fTerms.size();
+		std::vector<PostingIterator> iterators(termCount);
+		std::vector<bool> active(termCount);
+
+		// collect the statistics the ranking needs
+		uint32 documentCount = 0;
+		std::vector<uint32> frequencies(termCount, 0);
+		for (int32 i = 0; i < fIndex->CountSegments(); i++) {
+			IndexSegment* segment = fIndex->SegmentAt(i);
+			documentCount += segment->CountDocuments();
+
+			for (uint32 term = 0; term < termCount; term++) {
+				if (segment->FindTerm(fTerms[term].String(), iterators[term]))
+					frequencies[term] += iterators[term].Count();
+			}
+		}
+		if (documentCount == 0)
+			return B_OK;
+
+		float averageLength = (float)fIndex->TotalLength() / documentCount;
+		if (averageLength <= 0)
+			averageLength = 1;
+
+		std::vector<float> weights(termCount);
+		for (uint32 term = 0; term < termCount; term++) {
+			weights[term] = log(1 + (documentCount - frequencies[term] + 0.5)
+				/ (frequencies[term] + 0.5));
+		}
+
+		BestDocuments best;
+		for (int32 i = 0; i < fIndex->CountSegments(); i++) {
+			IndexSegment* segment = fIndex->SegmentAt(i);
+
+			bool any = false;
+			bool all = true;
+			for (uint32 term = 0; term < termCount; term++) {
+				active[term] = segment->FindTerm(fTerms[term].String(),
+					iterators[term]) && iterators[term].Next();
+				any |= active[term];
+				all &= active[term];
+			}
+			if (fMatchAll ? !all : !any)
+				continue;
+
+			while (true) {
+				uint32 document;
+				if (fMatchAll) {
+					// move all iterators to the same document
+					document = 0;
+					for (uint32 term = 0; term < termCount; term++) {
+						document = std::max(document,
+							iterators[term].Document());
+					}
+
+					bool aligned = true;
+					for (uint32 term = 0; term < termCount && all; term++) {
+						all = iterators[term].SkipTo(document);
+						aligned &= iterators[term].Document() == document;
+					}
+					if (!all)
+						break;
+					if (!aligned)
+						continue;
+				} else {
+					document = kInvalidDocument;
+					for (uint32 term = 0; term < termCount; term++) {
+						if (active[term]) {
+							document = std::min(document,
+								iterators[term].Document());
+						}
+					}
+					if (document == kInvalidDocument)
+						break;
+				}
+
+				if (document < segment->CountDocuments()
+					&& !segment->IsDeleted(document)) {
+					float norm = kK1 * (1 - kB + kB
+						* segment->DocumentLength(document) / averageLength);
+
+					ScoredDocument scored;
+					scored.score = 0;
+					scored.segment = i;
+					scored.document = document;
+					for (uint32 term = 0; term < termCount; term++) {
+						if (!active[term]
+							|| iterators[term].Document() != document)
+							continue;
+
+						float frequency = iterators[term].Frequency();
+						scored.score += weights[term] * frequency * (kK1 + 1)
+							/ (frequency + norm);
+					}
+
+					if ((int32)best.size() < fMaxHits)
+						best.push(scored);
+					else if (scored.score > best.top().score) {
+						best.pop();
+						best.push(scored);
+					}
+				}
+
+				for (uint32 term = 0; term < termCount; term++) {
+					if (active[term] && iterators[term].Document() == document)
+						active[term] = iterators[term].Next();
+					all &= active[term];
+				}
+				if (fMatchAll && !all)
+					break;
+			}
+		}
+
+		fHits.resize(best.size());
+		for (int32 i = best.size() - 1; i >= 0; i--) {
+			const ScoredDocument& scored = best.top();
+			fHits[i].path = fIndex->SegmentAt(scored.segment)->DocumentPath(
+				scored.document);
+			fHits[i].score = scored.score;
+			best.pop();
+		}
+	} catch (std::bad_alloc&) {
+		fHits.clear();
+		return B_NO_MEMORY;
+	}
+
+	return B_OK;
+}
+
+
+status_t
+FullTextQuery::GetNextHit(BString& path, float* _score)
+{
+	if (!fFetched)
+		return B_NO_INIT;
+	if (fNextHit >= (int32)fHits.size())
+		return B_ENTRY_NOT_FOUND;
+
+	const Hit& hit = fHits[fNextHit++];
+	path = hit.path;
+	if (_score != NULL)
+		*_score = hit.score;
+	return B_OK;
+}
+
+
+/*!	Like GetNextHit(), but returns an entry_ref. Documents that no longer
+	exist, but have not been removed from the index yet, are skipped.
+*/
+status_t
+FullTextQuery::GetNextRef(entry_ref* ref, float* _score)
+{
+	BString path;
+	status_t status;
+	while ((status = GetNextHit(path, _score)) == B_OK) {
+		if (get_ref_for_path(path.String(), ref) == B_OK
+			&& BEntry(ref).Exists())
+			return B_OK;
+	}
+
+	return status;
+}
+
+
+status_t
+FullTextQuery::Rewind()
+{
+	if (!fFetched)
+		return B_NO_INIT;
+
+	fNextHit = 0;
+	return B_OK;
+}
+
+
+int32
+FullTextQuery::CountHits() const
+{
+	return fHits.size();
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef FULL_TEXT_QUERY_H
+#define FULL_TEXT_QUERY_H
+
+
+#include <vector>
+
+#include <Entry.h>
+#include <String.h>
+
+
+class InvertedIndex;
+
+
+/*!	A ranked term query on an InvertedIndex, modelled after BQuery: set the
+	index and the terms, Fetch(), and then iterate over the hits with
+	GetNextHit() or GetNextRef(). The hits are ordered by their relevance
+	(Okapi BM25), the best one first.
+*/
+class FullTextQuery {
+public:
+								FullTextQuery();
+								~FullTextQuery();
+
+			status_t			Clear();
+
+			status_t			SetIndex(InvertedIndex* index);
+			status_t			SetPredicate(const char* terms);
+			status_t			SetMatchAll(bool matchAll);
+			status_t			SetMaxHits(int32 maxHits);
+
+			status_t			Fetch();
+
+			status_t			GetNextHit(BString& path,
+									float* _score = NULL);
+			status_t			GetNextRef(entry_ref* ref,
+									float* _score = NULL);
+			status_t			Rewind();
+			int32				CountHits() const;
+
+private:
+			struct Hit {
+				BString			path;
+				float			score;
+			};
+
+			InvertedIndex*		fIndex;
+			std::vector<BString> fTerms;
+			bool				fMatchAll;
+			int32				fMaxHits;
+
+			bool				fFetched;
+			std::vector<Hit>	fHits;
+			int32				fNextHit;
+};
+
+
+#endif	// FULL_TEXT_QUERY_H
@@ -0,0 +1,640 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "IndexSegment.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <AutoDeleter.h>
+
+
+static const size_t kWriteBufferSize = 256 * 1024;
+
+
+struct PathLess {
+	PathLess(const std::vector<char>& strings,
+			const std::vector<segment_document>& documents)
+		:
+		fStrings(strings),
+		fDocuments(documents)
+	{
+	}
+
+	bool operator()(uint32 a, uint32 b) const
+	{
+		return strcmp(&fStrings[fDocuments[a].path],
+			&fStrings[fDocuments[b].path]) < 0;
+	}
+
+private:
+	const std::vector<char>&				fStrings;
+	const std::vector<segment_document>&	fDocuments;
+};
+
+
+// #pragma mark - PostingIterator
+
+
+PostingIterator::PostingIterator()
+{
+	Unset();
+}
+
+
+void
+PostingIterator::SetTo(const uint8* data, const uint8* end, uint32 count)
+{
+	fData = data;
+	fEnd = end;
+	fCount = count;
+	fRemaining = count;
+	fDocument = 0;
+	fFrequency = 0;
+}
+
+
+void
+PostingIterator::Unset()
+{
+	SetTo(NULL, NULL, 0);
+}
+
+
+/*!	Moves on to the next posting. The document IDs are stored as the
+	difference to the previous one, the first one as the difference to 0.
+*/
+bool
+PostingIterator::Next()
+{
+	if (fRemaining == 0)
+		return false;
+
+	uint32 delta;
+	fData = read_varint(fData, fEnd, delta);
+	if (fData != NULL)
+		fData = read_varint(fData, fEnd, fFrequency);
+	if (fData == NULL) {
+		// corrupt posting list
+		fRemaining = 0;
+		return false;
+	}
+
+	fDocument += delta;
+	fRemaining--;
+	return true;
+}
+
+
+/*!	Advances the iterator to the first posting with a document ID of at least
+	\a document. The iterator must already point to a posting.
+*/
+bool
+PostingIterator::SkipTo(uint32 document)
+{
+	while (fDocument < document) {
+		if (!Next())
+			return false;
+	}
+	return true;
+}
+
+
+// #pragma mark - IndexSegment
+
+
+IndexSegment::IndexSegment(uint32 id)
+	:
+	fID(id),
+	fData(NULL),
+	fSize(0),
+	fDocumentCount(0),
+	fTermCount(0),
+	fTotalLength(0),
+	fDeletedCount(0),
+	fDeletionsChanged(false)
+{
+}
+
+
+IndexSegment::~IndexSegment()
+{
+	if (fData != NULL)
+		munmap(fData, fSize);
+}
+
+
+/*!	Maps the segment file read-only into memory, and reads its deletions.
+	The segment is never changed afterwards, so all lookups work directly on
+	the mapped file.
+*/
+status_t
+IndexSegment::Open(const char* directory)
+{
+	BString path = FilePath(directory, fID, "seg");
+	FileDescriptorCloser fd(open(path.String(), O_RDONLY));
+	if (!fd.IsSet())
+		return errno;
+
+	struct stat st;
+	if (fstat(fd.Get(), &st) != 0)
+		return errno;
+	if (st.st_size < (off_t)sizeof(segment_header))
+		return B_BAD_DATA;
+
+	fSize = st.st_size;
+	void* data = mmap(NULL, fSize, PROT_READ, MAP_SHARED, fd.Get(), 0);
+	if (data == MAP_FAILED)
+		return errno;
+	fData = (uint8*)data;
+
+	const segment_header* header = (const segment_header*)fData;
+	if (B_LENDIAN_TO_HOST_INT32(header->magic) != kSegmentMagic
+		|| B_LENDIAN_TO_HOST_INT32(header->version) != kSegmentVersion)
+		return B_BAD_DATA;
+
+	fDocumentCount = B_LENDIAN_TO_HOST_INT32(header->document_count);
+	fTermCount = B_LENDIAN_TO_HOST_INT32(header->term_count);
+	fTotalLength = B_LENDIAN_TO_HOST_INT64(header->total_length);
+
+	uint64 postingsOffset = B_LENDIAN_TO_HOST_INT64(header->postings_offset);
+	uint64 documentsOffset = B_LENDIAN_TO_HOST_INT64(header->documents_offset);
+	uint64 pathIndexOffset = B_LENDIAN_TO_HOST_INT64(
+		header->path_index_offset);
+	uint64 termsOffset = B_LENDIAN_TO_HOST_INT64(header->terms_offset);
+	uint64 stringsOffset = B_LENDIAN_TO_HOST_INT64(header->strings_offset);
+	uint64 stringsSize = B_LENDIAN_TO_HOST_INT64(header->strings_size);
+
+	// the sections follow each other in this order
+	if (postingsOffset < sizeof(segment_header)
+		|| documentsOffset < postingsOffset
+		|| pathIndexOffset != documentsOffset
+			+ (uint64)fDocumentCount * sizeof(segment_document)
+		|| termsOffset != pathIndexOffset + (uint64)fDocumentCount * 4
+		|| stringsOffset != termsOffset
+			+ (uint64)fTermCount * sizeof(segment_term)
+		|| stringsOffset + stringsSize > fSize
+		|| (stringsSize > 0 && fData[stringsOffset + stringsSize - 1] != '\0'))
+		return B_BAD_DATA;
+
+	fPostings = fData + postingsOffset;
+	fPostingsSize = documentsOffset - postingsOffset;
+	fDocuments = (const segment_document*)(fData + documentsOffset);
+	fPathIndex = (const uint32*)(fData + pathIndexOffset);
+	fTerms = (const segment_term*)(fData + termsOffset);
+	fStrings = (const char*)fData + stringsOffset;
+	fStringsSize = stringsSize;
+
+	return ReadDeletions(directory);
+}
+
+
+const char*
+IndexSegment::DocumentPath(uint32 document) const
+{
+	return _String(B_LENDIAN_TO_HOST_INT32(fDocuments[document].path));
+}
+
+
+uint32
+IndexSegment::DocumentLength(uint32 document) const
+{
+	return B_LENDIAN_TO_HOST_INT32(fDocuments[document].length);
+}
+
+
+//!	Returns the ID of the document with the given path, deleted or not.
+uint32
+IndexSegment::FindDocument(const char* path) const
+{
+	uint32 lower = 0;
+	uint32 upper = fDocumentCount;
+	while (lower < upper) {
+		uint32 middle = lower + (upper - lower) / 2;
+		uint32 document = B_LENDIAN_TO_HOST_INT32(fPathIndex[middle]);
+		if (document >= fDocumentCount)
+			return kInvalidDocument;
+
+		int compare = strcmp(DocumentPath(document), path);
+		if (compare == 0)
+			return document;
+		if (compare < 0)
+			lower = middle + 1;
+		else
+			upper = middle;
+	}
+
+	return kInvalidDocument;
+}
+
+
+const char*
+IndexSegment::TermAt(uint32 index) const
+{
+	return _String(B_LENDIAN_TO_HOST_INT32(fTerms[index].term));
+}
+
+
+uint32
+IndexSegment::TermFrequencyAt(uint32 index) const
+{
+	return B_LENDIAN_TO_HOST_INT32(fTerms[index].document_frequency);
+}
+
+
+void
+IndexSegment::GetPostingsAt(uint32 index, PostingIterator& iterator) const
+{
+	uint64 start = B_LENDIAN_TO_HOST_INT64(fTerms[index].postings);
+	uint64 end = index + 1 < fTermCount
+		? B_LENDIAN_TO_HOST_INT64(fTerms[index + 1].postings) : fPostingsSize;
+	if (start > end || end > fPostingsSize) {
+		iterator.Unset();
+		return;
+	}
+
+	iterator.SetTo(fPostings + start, fPostings + end, TermFrequencyAt(index));
+}
+
+
+bool
+IndexSegment::FindTerm(const char* term, PostingIterator& iterator) const
+{
+	uint32 lower = 0;
+	uint32 upper = fTermCount;
+	while (lower < upper) {
+		uint32 middle = lower + (upper - lower) / 2;
+		int compare = strcmp(TermAt(middle), term);
+		if (compare == 0) {
+			GetPostingsAt(middle, iterator);
+			return true;
+		}
+		if (compare < 0)
+			lower = middle + 1;
+		else
+			upper = middle;
+	}
+
+	iterator.Unset();
+	return false;
+}
+
+
+bool
+IndexSegment::IsDeleted(uint32 document) const
+{
+	if (fDeletedCount == 0)
+		return false;
+	return (fDeleted[document / 8] & (1 << (document % 8))) != 0;
+}
+
+
+/*!	Marks the document as deleted. Returns \c true if it had not been deleted
+	before.
+*/
+bool
+IndexSegment::Delete(uint32 document)
+{
+	if (document >= fDocumentCount || IsDeleted(document))
+		return false;
+
+	if (fDeleted.empty())
+		fDeleted.resize((fDocumentCount + 7) / 8, 0);
+
+	fDeleted[document / 8] |= 1 << (document % 8);
+	fDeletedCount++;
+	fDeletionsChanged = true;
+	return true;
+}
+
+
+void
+IndexSegment::GetDeletions(std::vector<uint8>& bitmap) const
+{
+	bitmap = fDeleted;
+	bitmap.resize((fDocumentCount + 7) / 8, 0);
+}
+
+
+status_t
+IndexSegment::ReadDeletions(const char* directory)
+{
+	fDeleted.clear();
+	fDeletedCount = 0;
+	fDeletionsChanged = false;
+
+	BString path = FilePath(directory, fID, "del");
+	FileDescriptorCloser fd(open(path.String(), O_RDONLY));
+	if (!fd.IsSet())
+		return errno == ENOENT ? B_OK : errno;
+
+	fDeleted.resize((fDocumentCount + 7) / 8, 0);
+	ssize_t bytesRead = read(fd.Get(), &fDeleted[0], fDeleted.size());
+	if (bytesRead != (ssize_t)fDeleted.size()) {
+		fDeleted.clear();
+		return bytesRead < 0 ? errno : B_BAD_DATA;
+	}
+
+	for (uint32 document = 0; document < fDocumentCount; document++) {
+		if ((fDeleted[document / 8] & (1 << (document % 8))) != 0)
+			fDeletedCount++;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Writes the deletion bitmap if it has changed. It is written to a
+	temporary file first, so that readers never see a partial bitmap.
+*/
+status_t
+IndexSegment::WriteDeletions(const char* directory)
+{
+	if (!fDeletionsChanged)
+		return B_OK;
+
+	BString path = FilePath(directory, fID, "del");
+	BString tempPath = path;
+	tempPath << ".tmp";
+
+	FileDescriptorCloser fd(open(tempPath.String(),
+		O_WRONLY | O_CREAT | O_TRUNC, 0644));
+	if (!fd.IsSet())
+		return errno;
+
+	ssize_t written = write(fd.Get(), &fDeleted[0], fDeleted.size());
+	if (written != (ssize_t)fDeleted.size() || fsync(fd.Get()) != 0) {
+		status_t status = written < 0 ? errno : B_IO_ERROR;
+		unlink(tempPath.String());
+		return status;
+	}
+	fd.Unset();
+
+	if (rename(tempPath.String(), path.String()) != 0)
+		return errno;
+
+	fDeletionsChanged = false;
+	return B_OK;
+}
+
+
+void
+IndexSegment::RemoveFiles(const char* directory)
+{
+	unlink(FilePath(directory, fID, "seg").String());
+	unlink(FilePath(directory, fID, "del").String());
+}
+
+
+/*static*/ BString
+IndexSegment::FilePath(const char* directory, uint32 id,
+	const char* extension)
+{
+	BString path;
+	path.SetToFormat("%s/segment_%08" B_PRIx32 ".%s", directory, id,
+		extension);
+	return path;
+}
+
+
+const char*
+IndexSegment::_String(uint32 offset) const
+{
+	if (offset >= fStringsSize)
+		return "";
+	return fStrings + offset;
+}
+
+
+// #pragma mark - SegmentWriter
+
+
+SegmentWriter::SegmentWriter()
+	:
+	fFD(-1),
+	fOffset(0),
+	fStatus(B_NO_INIT),
+	fTotalLength(0),
+	fInTerm(false),
+	fTermFrequency(0),
+	fLastDocument(0)
+{
+}
+
+
+SegmentWriter::~SegmentWriter()
+{
+	if (fFD >= 0) {
+		// Finish() has not been called or failed
+		close(fFD);
+		unlink(fPath.String());
+	}
+}
+
+
+status_t
+SegmentWriter::Init(const char* path)
+{
+	fPath = path;
+	fFD = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fFD < 0)
+		return fStatus = errno;
+
+	fBuffer.reserve(kWriteBufferSize);
+
+	// the header is written last
+	fOffset = sizeof(segment_header);
+	if (lseek(fFD, fOffset, SEEK_SET) < 0)
+		return fStatus = errno;
+
+	return fStatus = B_OK;
+}
+
+
+/*!	Adds a document, and returns its ID. All documents have to be added
+	before the first term.
+*/
+uint32
+SegmentWriter::AddDocument(const char* path, uint32 length)
+{
+	segment_document document;
+	document.path = _AddString(path);
+	document.length = length;
+	fDocuments.push_back(document);
+
+	fTotalLength += length;
+	return fDocuments.size() - 1;
+}
+
+
+/*!	Starts the postings of the next term. Terms have to be added in ascending
+	order. A term without postings is dropped.
+*/
+status_t
+SegmentWriter::BeginTerm(const char* term)
+{
+	status_t status = _EndTerm();
+	if (status != B_OK)
+		return status;
+
+	fTerm = term;
+	fInTerm = true;
+	fTermFrequency = 0;
+	fLastDocument = 0;
+	return B_OK;
+}
+
+
+//!	Adds a posting to the current term, in ascending document order.
+status_t
+SegmentWriter::AddPosting(uint32 document, uint32 frequency)
+{
+	if (fStatus != B_OK)
+		return fStatus;
+	if (!fInTerm || document >= fDocuments.size()
+		|| (fTermFrequency > 0 && document <= fLastDocument))
+		return B_BAD_VALUE;
+
+	if (fTermFrequency == 0) {
+		segment_term term;
+		term.term = _AddString(fTerm.String());
+		term.document_frequency = 0;
+		term.postings = fOffset - sizeof(segment_header);
+		fTerms.push_back(term);
+	}
+
+	uint8 buffer[10];
+	uint8* end = write_varint(buffer, document - fLastDocument);
+	end = write_varint(end, frequency);
+
+	fLastDocument = document;
+	fTermFrequency++;
+	return _Write(buffer, end - buffer);
+}
+
+
+status_t
+SegmentWriter::Finish()
+{
+	status_t status = _EndTerm();
+	if (status != B_OK)
+		return status;
+
+	segment_header header;
+	memset(&header, 0, sizeof(header));
+	header.magic = B_HOST_TO_LENDIAN_INT32(kSegmentMagic);
+	header.version = B_HOST_TO_LENDIAN_INT32(kSegmentVersion);
+	header.document_count = B_HOST_TO_LENDIAN_INT32(fDocuments.size());
+	header.term_count = B_HOST_TO_LENDIAN_INT32(fTerms.size());
+	header.total_length = B_HOST_TO_LENDIAN_INT64(fTotalLength);
+	header.postings_offset = B_HOST_TO_LENDIAN_INT64(sizeof(segment_header));
+
+	// documents and the path index
+	std::vector<uint32> pathIndex(fDocuments.size());
+	for (uint32 i = 0; i < pathIndex.size(); i++)
+		pathIndex[i] = i;
+	std::sort(pathIndex.begin(), pathIndex.end(),
+		PathLess(fStrings, fDocuments));
+
+	header.documents_offset = B_HOST_TO_LENDIAN_INT64(fOffset);
+	for (uint32 i = 0; i < fDocuments.size(); i++) {
+		segment_document document;
+		document.path = B_HOST_TO_LENDIAN_INT32(fDocuments[i].path);
+		document.length = B_HOST_TO_LENDIAN_INT32(fDocuments[i].length);
+		_Write(&document, sizeof(document));
+	}
+
+	header.path_index_offset = B_HOST_TO_LENDIAN_INT64(fOffset);
+	for (uint32 i = 0; i < pathIndex.size(); i++) {
+		uint32 document = B_HOST_TO_LENDIAN_INT32(pathIndex[i]);
+		_Write(&document, sizeof(document));
+	}
+
+	// terms and strings
+	header.terms_offset = B_HOST_TO_LENDIAN_INT64(fOffset);
+	for (uint32 i = 0; i < fTerms.size(); i++) {
+		segment_term term;
+		term.term = B_HOST_TO_LENDIAN_INT32(fTerms[i].term);
+		term.document_frequency
+			= B_HOST_TO_LENDIAN_INT32(fTerms[i].document_frequency);
+		term.postings = B_HOST_TO_LENDIAN_INT64(fTerms[i].postings);
+		_Write(&term, sizeof(term));
+	}
+
+	header.strings_offset = B_HOST_TO_LENDIAN_INT64(fOffset);
+	header.strings_size = B_HOST_TO_LENDIAN_INT64(fStrings.size());
+	if (!fStrings.empty())
+		_Write(&fStrings[0], fStrings.size());
+
+	status = _Flush();
+	if (status != B_OK)
+		return status;
+
+	if (pwrite(fFD, &header, sizeof(header), 0) != (ssize_t)sizeof(header)
+		|| fsync(fFD) != 0)
+		return fStatus = errno;
+
+	close(fFD);
+	fFD = -1;
+	return B_OK;
+}
+
+
+uint32
+SegmentWriter::_AddString(const char* string)
+{
+	uint32 offset = fStrings.size();
+	fStrings.insert(fStrings.end(), string, string + strlen(string) + 1);
+	return offset;
+}
+
+
+status_t
+SegmentWriter::_EndTerm()
+{
+	if (fInTerm && fTermFrequency > 0)
+		fTerms.back().document_frequency = fTermFrequency;
+
+	fInTerm = false;
+	return fStatus;
+}
+
+
+status_t
+SegmentWriter::_Write(const void* data, size_t size)
+{
+	if (fStatus != B_OK)
+		return fStatus;
+
+	fBuffer.insert(fBuffer.end(), (const uint8*)data,
+		(const uint8*)data + size);
+	fOffset += size;
+
+	if (fBuffer.size() >= kWriteBufferSize)
+		return _Flush();
+	return B_OK;
+}
+
+
+status_t
+SegmentWriter::_Flush()
+{
+	if (fStatus != B_OK || fBuffer.empty())
+		return fStatus;
+
+	ssize_t written = write(fFD, &fBuffer[0], fBuffer.size());
+	if (written != (ssize_t)fBuffer.size())
+		return fStatus = written < 0 ? errno : B_IO_ERROR;
+
+	fBuffer.clear();
+	return B_OK;
+}
@@ -0,0 +1,224 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef INDEX_SEGMENT_H
+#define INDEX_SEGMENT_H
+
+
+#include <vector>
+
+#include <ByteOrder.h>
+#include <String.h>
+
+
+/*!	On disk, the full-text index consists of a number of immutable segments
+	and a manifest listing them. A segment file looks like this:
+
+		segment_header
+		postings		for every term, a list of (document delta, frequency)
+						pairs, both encoded as varints
+		documents		segment_document for every document
+		path index		document IDs, sorted by the document's path
+		terms			segment_term for every term, sorted by the term
+		strings			the NUL terminated terms and paths
+
+	All fixed size fields are little endian. Documents that are removed after
+	the segment has been written are only marked as deleted in a separate
+	bitmap file next to it; merging segments drops them for good.
+*/
+
+
+static const uint32 kSegmentMagic = 'FTsg';
+static const uint32 kSegmentVersion = 1;
+static const uint32 kInvalidDocument = ~(uint32)0;
+
+struct segment_header {
+	uint32	magic;
+	uint32	version;
+	uint32	document_count;
+	uint32	term_count;
+	uint64	total_length;
+	uint64	postings_offset;
+	uint64	documents_offset;
+	uint64	path_index_offset;
+	uint64	terms_offset;
+	uint64	strings_offset;
+	uint64	strings_size;
+} _PACKED;
+
+struct segment_document {
+	uint32	path;
+	uint32	length;
+} _PACKED;
+
+struct segment_term {
+	uint32	term;
+	uint32	document_frequency;
+	uint64	postings;
+} _PACKED;
+
+
+static inline uint8*
+write_varint(uint8* buffer, uint32 value)
+{
+	while (value >= 0x80) {
+		*buffer++ = (uint8)value | 0x80;
+		value >>= 7;
+	}
+	*buffer++ = (uint8)value;
+	return buffer;
+}
+
+
+static inline const uint8*
+read_varint(const uint8* buffer, const uint8* end, uint32& _value)
+{
+	uint32 value = 0;
+	for (int shift = 0; shift < 35 && buffer < end; shift += 7) {
+		uint8 byte = *buffer++;
+		value |= (uint32)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) {
+			_value = value;
+			return buffer;
+		}
+	}
+
+	return NULL;
+}
+
+
+class PostingIterator {
+public:
+								PostingIterator();
+
+			void				SetTo(const uint8* data, const uint8* end,
+									uint32 count);
+			void				Unset();
+
+			uint32				Count() const { return fCount; }
+			uint32				Document() const { return fDocument; }
+			uint32				Frequency() const { return fFrequency; }
+
+			bool				Next();
+			bool				SkipTo(uint32 document);
+
+private:
+			const uint8*		fData;
+			const uint8*		fEnd;
+			uint32				fCount;
+			uint32				fRemaining;
+			uint32				fDocument;
+			uint32				fFrequency;
+};
+
+
+class IndexSegment {
+public:
+								IndexSegment(uint32 id);
+								~IndexSegment();
+
+			status_t			Open(const char* directory);
+
+			uint32				ID() const { return fID; }
+
+			uint32				CountDocuments() const
+									{ return fDocumentCount; }
+			uint32				CountLiveDocuments() const
+									{ return fDocumentCount - fDeletedCount; }
+			uint32				CountTerms() const { return fTermCount; }
+			uint64				TotalLength() const { return fTotalLength; }
+
+			const char*			DocumentPath(uint32 document) const;
+			uint32				DocumentLength(uint32 document) const;
+			uint32				FindDocument(const char* path) const;
+
+			const char*			TermAt(uint32 index) const;
+			uint32				TermFrequencyAt(uint32 index) const;
+			void				GetPostingsAt(uint32 index,
+									PostingIterator& iterator) const;
+			bool				FindTerm(const char* term,
+									PostingIterator& iterator) const;
+
+			bool				IsDeleted(uint32 document) const;
+			bool				Delete(uint32 document);
+			bool				HasDeletions() const
+									{ return fDeletedCount > 0; }
+			bool				DeletionsChanged() const
+									{ return fDeletionsChanged; }
+			void				GetDeletions(std::vector<uint8>& bitmap) const;
+
+			status_t			ReadDeletions(const char* directory);
+			status_t			WriteDeletions(const char* directory);
+			void				RemoveFiles(const char* directory);
+
+	static	BString				FilePath(const char* directory, uint32 id,
+									const char* extension);
+
+private:
+			const char*			_String(uint32 offset) const;
+
+private:
+			uint32				fID;
+			uint8*				fData;
+			size_t				fSize;
+
+			uint32				fDocumentCount;
+			uint32				fTermCount;
+			uint64				fTotalLength;
+			const uint8*		fPostings;
+			size_t				fPostingsSize;
+			const segment_document* fDocuments;
+			const uint32*		fPathIndex;
+			const segment_term*	fTerms;
+			const char*			fStrings;
+			size_t				fStringsSize;
+
+			std::vector<uint8>	fDeleted;
+			uint32				fDeletedCount;
+			bool				fDeletionsChanged;
+};
+
+
+class SegmentWriter {
+public:
+								SegmentWriter();
+								~SegmentWriter();
+
+			status_t			Init(const char* path);
+
+			uint32				AddDocument(const char* path, uint32 length);
+			uint32				CountDocuments() const
+									{ return fDocuments.size(); }
+
+			status_t			BeginTerm(const char* term);
+			status_t			AddPosting(uint32 document, uint32 frequency);
+
+			status_t			Finish();
+
+private:
+			uint32				_AddString(const char* string);
+			status_t			_EndTerm();
+			status_t			_Write(const void* data, size_t size);
+			status_t			_Flush();
+
+private:
+			int					fFD;
+			BString				fPath;
+			std::vector<uint8>	fBuffer;
+			uint64				fOffset;
+			status_t			fStatus;
+
+			std::vector<segment_document> fDocuments;
+			std::vector<segment_term> fTerms;
+			std::vector<char>	fStrings;
+			uint64				fTotalLength;
+
+			BString				fTerm;
+			bool				fInTerm;
+			uint32				fTermFrequency;
+			uint32				fLastDocument;
+};
+
+
+#endif	// INDEX_SEGMENT_H
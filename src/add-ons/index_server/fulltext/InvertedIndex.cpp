@@ -0,0 +1,881 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "InvertedIndex.h"
+
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <new>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <AutoDeleter.h>
+#include <AutoDeleterPosix.h>
+#include <AutoLocker.h>
+#include <Directory.h>
+
+#include "Tokenizer.h"
+
+
+//#define TRACE_INVERTED_INDEX
+#ifdef TRACE_INVERTED_INDEX
+#	define TRACE(x...) printf("InvertedIndex: " x)
+#else
+#	define TRACE(x...) ;
+#endif
+
+
+static const uint32 kManifestMagic = 'FTmf';
+static const uint32 kManifestVersion = 1;
+static const char* kManifestName = "manifest";
+
+static const size_t kBuilderMemoryLimit = 32 * 1024 * 1024;
+static const uint32 kMergeFactor = 8;
+static const int32 kReloadAttempts = 3;
+
+// rough per entry overhead of the builder's maps
+static const size_t kMapEntryOverhead = 48;
+
+
+struct manifest_header {
+	uint32	magic;
+	uint32	version;
+	uint64	generation;
+	uint32	next_segment;
+	uint32	segment_count;
+} _PACKED;
+
+
+typedef AutoLocker<BLocker> Locker;
+
+
+static uint32
+merge_level(uint32 documents)
+{
+	uint32 level = 0;
+	while (documents >= kMergeFactor) {
+		documents /= kMergeFactor;
+		level++;
+	}
+	return level;
+}
+
+
+struct LiveDocumentsLess {
+	bool operator()(const IndexSegment* a, const IndexSegment* b) const
+	{
+		return a->CountLiveDocuments() < b->CountLiveDocuments();
+	}
+};
+
+
+// #pragma mark - SegmentBuilder
+
+
+SegmentBuilder::SegmentBuilder()
+	:
+	fMemoryUsage(0)
+{
+}
+
+
+/*!	Adds the document to the builder. If there already is a document with
+	that path, it must have been removed before.
+	May throw std::bad_alloc; the document is then left deleted.
+*/
+void
+SegmentBuilder::AddDocument(const char* path, const char* text, size_t length)
+{
+	uint32 document = fDocuments.size();
+
+	Document entry;
+	entry.path = path;
+	entry.length = 0;
+	entry.deleted = true;
+	fDocuments.push_back(entry);
+
+	std::map<std::string, uint32> frequencies;
+	Tokenizer tokenizer(text, length);
+	uint32 termCount = 0;
+	const char* term;
+	size_t termLength;
+	while ((term = tokenizer.Next(&termLength)) != NULL) {
+		frequencies[std::string(term, termLength)]++;
+		termCount++;
+	}
+
+	std::map<std::string, uint32>::const_iterator iterator
+		= frequencies.begin();
+	for (; iterator != frequencies.end(); iterator++) {
+		std::vector<uint32>& postings = fTerms[iterator->first];
+		if (postings.empty())
+			fMemoryUsage += iterator->first.size() + kMapEntryOverhead;
+
+		postings.push_back(document);
+		postings.push_back(iterator->second);
+		fMemoryUsage += 2 * sizeof(uint32);
+	}
+
+	fPaths[path] = document;
+	fDocuments[document].length = termCount;
+	fDocuments[document].deleted = false;
+
+	fMemoryUsage += 2 * (strlen(path) + kMapEntryOverhead);
+}
+
+
+bool
+SegmentBuilder::RemoveDocument(const char* path)
+{
+	PathMap::iterator iterator = fPaths.find(path);
+	if (iterator == fPaths.end())
+		return false;
+
+	// the postings are dropped when the segment is written
+	fDocuments[iterator->second].deleted = true;
+	fPaths.erase(iterator);
+	return true;
+}
+
+
+status_t
+SegmentBuilder::WriteTo(SegmentWriter& writer) const
+{
+	std::vector<uint32> remap(fDocuments.size(), kInvalidDocument);
+	for (uint32 i = 0; i < fDocuments.size(); i++) {
+		if (!fDocuments[i].deleted) {
+			remap[i] = writer.AddDocument(fDocuments[i].path.c_str(),
+				fDocuments[i].length);
+		}
+	}
+
+	TermMap::const_iterator iterator = fTerms.begin();
+	for (; iterator != fTerms.end(); iterator++) {
+		status_t status = writer.BeginTerm(iterator->first.c_str());
+		if (status != B_OK)
+			return status;
+
+		const std::vector<uint32>& postings = iterator->second;
+		for (uint32 i = 0; i < postings.size(); i += 2) {
+			uint32 document = remap[postings[i]];
+			if (document == kInvalidDocument)
+				continue;
+
+			status = writer.AddPosting(document, postings[i + 1]);
+			if (status != B_OK)
+				return status;
+		}
+	}
+
+	return writer.Finish();
+}
+
+
+void
+SegmentBuilder::MakeEmpty()
+{
+	fDocuments.clear();
+	fPaths.clear();
+	fTerms.clear();
+	fMemoryUsage = 0;
+}
+
+
+// #pragma mark - InvertedIndex
+
+
+InvertedIndex::InvertedIndex(const char* directory)
+	:
+	fDirectory(directory),
+	fLock("inverted index"),
+	fWritable(false),
+	fNextSegment(0),
+	fGeneration(0),
+	fManifestNode(-1),
+	fMergeThread(-1),
+	fMergeSem(-1),
+	fQuitting(false)
+{
+	fManifestTime.tv_sec = 0;
+	fManifestTime.tv_nsec = 0;
+}
+
+
+InvertedIndex::~InvertedIndex()
+{
+	if (fMergeThread >= 0) {
+		fQuitting = true;
+		release_sem(fMergeSem);
+
+		status_t result;
+		wait_for_thread(fMergeThread, &result);
+	}
+	if (fMergeSem >= 0)
+		delete_sem(fMergeSem);
+
+	_DeleteSegments();
+}
+
+
+/*!	Opens the index in the directory. An index that is opened writable is
+	created if it doesn't exist yet, and merges its segments in the
+	background.
+*/
+status_t
+InvertedIndex::Open(bool writable)
+{
+	fWritable = writable;
+	if (writable) {
+		status_t status = create_directory(fDirectory.String(), 0755);
+		if (status != B_OK)
+			return status;
+	}
+
+	Locker locker(fLock);
+
+	status_t status = Reload();
+	if (status == B_ENTRY_NOT_FOUND && writable)
+		status = _WriteManifest();
+	if (status != B_OK || !writable)
+		return status;
+
+	_RemoveStaleFiles();
+
+	fMergeSem = create_sem(0, "fulltext merge");
+	if (fMergeSem < 0)
+		return fMergeSem;
+
+	fMergeThread = spawn_thread(&_MergeThread, "fulltext merger",
+		B_LOW_PRIORITY, this);
+	if (fMergeThread < 0)
+		return fMergeThread;
+
+	resume_thread(fMergeThread);
+	release_sem(fMergeSem);
+	return B_OK;
+}
+
+
+/*!	Adds a document, replacing any previous version of it. The document only
+	becomes visible with the next Commit().
+*/
+status_t
+InvertedIndex::AddDocument(const char* path, const char* text, size_t length)
+{
+	if (!fWritable)
+		return B_NOT_ALLOWED;
+
+	Locker locker(fLock);
+
+	RemoveDocument(path);
+
+	try {
+		fBuilder.AddDocument(path, text, length);
+	} catch (std::bad_alloc&) {
+		return B_NO_MEMORY;
+	}
+
+	if (fBuilder.MemoryUsage() >= kBuilderMemoryLimit)
+		return _FlushBuilder();
+	return B_OK;
+}
+
+
+status_t
+InvertedIndex::RemoveDocument(const char* path)
+{
+	if (!fWritable)
+		return B_NOT_ALLOWED;
+
+	Locker locker(fLock);
+
+	fBuilder.RemoveDocument(path);
+
+	for (uint32 i = 0; i < fSegments.size(); i++) {
+		IndexSegment* segment = fSegments[i];
+		uint32 document = segment->FindDocument(path);
+		if (document != kInvalidDocument)
+			segment->Delete(document);
+	}
+
+	return B_OK;
+}
+
+
+/*!	Writes the documents added since the last commit to a new segment, and
+	stores the deletions and the new list of segments.
+*/
+status_t
+InvertedIndex::Commit()
+{
+	if (!fWritable)
+		return B_NOT_ALLOWED;
+
+	Locker locker(fLock);
+
+	status_t status = _FlushBuilder();
+	if (status != B_OK)
+		return status;
+
+	for (uint32 i = 0; i < fSegments.size(); i++) {
+		status = fSegments[i]->WriteDeletions(fDirectory.String());
+		if (status != B_OK)
+			return status;
+	}
+
+	status = _WriteManifest();
+	if (status != B_OK)
+		return status;
+
+	release_sem_etc(fMergeSem, 1, B_DO_NOT_RESCHEDULE);
+	return B_OK;
+}
+
+
+/*!	Brings the index up to date with the manifest on disk, if that has been
+	changed by another team. Segments that are still in use are kept mapped.
+*/
+status_t
+InvertedIndex::Reload()
+{
+	for (int32 attempt = 0;; attempt++) {
+		struct stat st;
+		uint32 nextSegment;
+		std::vector<uint32> ids;
+		status_t status;
+		try {
+			status = _ReadManifest(st, nextSegment, ids);
+		} catch (std::bad_alloc&) {
+			return B_NO_MEMORY;
+		}
+		if (status == B_ENTRY_NOT_FOUND)
+			_DeleteSegments();
+		if (status != B_OK)
+			return status;
+		if (st.st_ino == fManifestNode
+			&& st.st_mtim.tv_sec == fManifestTime.tv_sec
+			&& st.st_mtim.tv_nsec == fManifestTime.tv_nsec)
+			return B_OK;
+
+		std::vector<IndexSegment*> segments;
+		std::vector<IndexSegment*> opened;
+		for (uint32 i = 0; i < ids.size() && status == B_OK; i++) {
+			IndexSegment* segment = NULL;
+			for (uint32 j = 0; j < fSegments.size(); j++) {
+				if (fSegments[j]->ID() == ids[i]) {
+					segment = fSegments[j];
+					break;
+				}
+			}
+
+			if (segment != NULL) {
+				status = segment->ReadDeletions(fDirectory.String());
+			} else {
+				segment = new(std::nothrow) IndexSegment(ids[i]);
+				if (segment == NULL) {
+					status = B_NO_MEMORY;
+					break;
+				}
+				opened.push_back(segment);
+				status = segment->Open(fDirectory.String());
+			}
+			segments.push_back(segment);
+		}
+
+		if (status != B_OK) {
+			for (uint32 i = 0; i < opened.size(); i++)
+				delete opened[i];
+
+			// the segment might have been merged in the mean time
+			if (status == B_ENTRY_NOT_FOUND && attempt < kReloadAttempts)
+				continue;
+			return status;
+		}
+
+		for (uint32 i = 0; i < fSegments.size(); i++) {
+			if (std::find(segments.begin(), segments.end(), fSegments[i])
+					== segments.end())
+				delete fSegments[i];
+		}
+
+		fSegments = segments;
+		fNextSegment = nextSegment;
+		fManifestNode = st.st_ino;
+		fManifestTime = st.st_mtim;
+		return B_OK;
+	}
+}
+
+
+uint32
+InvertedIndex::CountDocuments() const
+{
+	uint32 count = 0;
+	for (uint32 i = 0; i < fSegments.size(); i++)
+		count += fSegments[i]->CountLiveDocuments();
+	return count;
+}
+
+
+uint64
+InvertedIndex::TotalLength() const
+{
+	uint64 length = 0;
+	for (uint32 i = 0; i < fSegments.size(); i++)
+		length += fSegments[i]->TotalLength();
+	return length;
+}
+
+
+status_t
+InvertedIndex::_ReadManifest(struct stat& st, uint32& nextSegment,
+	std::vector<uint32>& segments)
+{
+	BString path;
+	path << fDirectory << "/" << kManifestName;
+
+	FileDescriptorCloser fd(open(path.String(), O_RDONLY));
+	if (!fd.IsSet())
+		return errno;
+	if (fstat(fd.Get(), &st) != 0)
+		return errno;
+
+	manifest_header header;
+	if (read(fd.Get(), &header, sizeof(header)) != (ssize_t)sizeof(header)
+		|| B_LENDIAN_TO_HOST_INT32(header.magic) != kManifestMagic
+		|| B_LENDIAN_TO_HOST_INT32(header.version) != kManifestVersion)
+		return B_BAD_DATA;
+
+	fGeneration = B_LENDIAN_TO_HOST_INT64(header.generation);
+	nextSegment = B_LENDIAN_TO_HOST_INT32(header.next_segment);
+	uint32 count = B_LENDIAN_TO_HOST_INT32(header.segment_count);
+	if ((off_t)(sizeof(header) + count * sizeof(uint32)) != st.st_size)
+		return B_BAD_DATA;
+
+	segments.resize(count);
+	if (count > 0 && read(fd.Get(), &segments[0], count * sizeof(uint32))
+			!= (ssize_t)(count * sizeof(uint32)))
+		return B_BAD_DATA;
+
+	for (uint32 i = 0; i < count; i++)
+		segments[i] = B_LENDIAN_TO_HOST_INT32(segments[i]);
+
+	return B_OK;
+}
+
+
+/*!	Writes the list of segments to a temporary file and renames it over the
+	manifest, so that readers always see a complete index.
+*/
+status_t
+InvertedIndex::_WriteManifest()
+{
+	BString path;
+	path << fDirectory << "/" << kManifestName;
+	BString tempPath = path;
+	tempPath << ".tmp";
+
+	std::vector<uint32> ids(fSegments.size());
+	for (uint32 i = 0; i < fSegments.size(); i++)
+		ids[i] = B_HOST_TO_LENDIAN_INT32(fSegments[i]->ID());
+
+	manifest_header header;
+	header.magic = B_HOST_TO_LENDIAN_INT32(kManifestMagic);
+	header.version = B_HOST_TO_LENDIAN_INT32(kManifestVersion);
+	header.generation = B_HOST_TO_LENDIAN_INT64(fGeneration + 1);
+	header.next_segment = B_HOST_TO_LENDIAN_INT32(fNextSegment);
+	header.segment_count = B_HOST_TO_LENDIAN_INT32(ids.size());
+
+	FileDescriptorCloser fd(open(tempPath.String(),
+		O_WRONLY | O_CREAT | O_TRUNC, 0644));
+	if (!fd.IsSet())
+		return errno;
+
+	if (write(fd.Get(), &header, sizeof(header)) != (ssize_t)sizeof(header)
+		|| (!ids.empty() && write(fd.Get(), &ids[0],
+			ids.size() * sizeof(uint32))
+				!= (ssize_t)(ids.size() * sizeof(uint32)))
+		|| fsync(fd.Get()) != 0) {
+		unlink(tempPath.String());
+		return B_IO_ERROR;
+	}
+	fd.Unset();
+
+	if (rename(tempPath.String(), path.String()) != 0)
+		return errno;
+
+	fGeneration++;
+
+	struct stat st;
+	if (stat(path.String(), &st) == 0) {
+		fManifestNode = st.st_ino;
+		fManifestTime = st.st_mtim;
+	}
+	return B_OK;
+}
+
+
+//!	Removes the segments that were left behind by a crash.
+void
+InvertedIndex::_RemoveStaleFiles()
+{
+	DirCloser dir(opendir(fDirectory.String()));
+	if (!dir.IsSet())
+		return;
+
+	while (dirent* entry = readdir(dir.Get())) {
+		uint32 id;
+		if (sscanf(entry->d_name, "segment_%08" B_SCNx32, &id) != 1)
+			continue;
+
+		bool used = false;
+		for (uint32 i = 0; i < fSegments.size(); i++) {
+			if (fSegments[i]->ID() == id) {
+				used = strstr(entry->d_name, ".tmp") == NULL;
+				break;
+			}
+		}
+		if (used)
+			continue;
+
+		BString path;
+		path << fDirectory << "/" << entry->d_name;
+		TRACE("removing stale file %s\n", path.String());
+		unlink(path.String());
+	}
+}
+
+
+status_t
+InvertedIndex::_FlushBuilder()
+{
+	if (fBuilder.CountDocuments() == 0) {
+		fBuilder.MakeEmpty();
+		return B_OK;
+	}
+
+	uint32 id = fNextSegment++;
+	TRACE("writing segment %" B_PRIu32 " with %" B_PRIu32 " documents\n", id,
+		fBuilder.CountDocuments());
+
+	SegmentWriter writer;
+	status_t status = writer.Init(IndexSegment::FilePath(fDirectory.String(),
+		id, "seg").String());
+	if (status == B_OK) {
+		try {
+			status = fBuilder.WriteTo(writer);
+		} catch (std::bad_alloc&) {
+			status = B_NO_MEMORY;
+		}
+	}
+	if (status != B_OK)
+		return status;
+
+	IndexSegment* segment = new(std::nothrow) IndexSegment(id);
+	if (segment == NULL)
+		return B_NO_MEMORY;
+
+	status = segment->Open(fDirectory.String());
+	if (status != B_OK) {
+		segment->RemoveFiles(fDirectory.String());
+		delete segment;
+		return status;
+	}
+
+	fSegments.push_back(segment);
+	fBuilder.MakeEmpty();
+	return B_OK;
+}
+
+
+void
+InvertedIndex::_DeleteSegments()
+{
+	for (uint32 i = 0; i < fSegments.size(); i++)
+		delete fSegments[i];
+	fSegments.clear();
+}
+
+
+/*static*/ status_t
+InvertedIndex::_MergeThread(void* self)
+{
+	((InvertedIndex*)self)->_MergeLoop();
+	return B_OK;
+}
+
+
+void
+InvertedIndex::_MergeLoop()
+{
+	while (!fQuitting) {
+		status_t status = acquire_sem(fMergeSem);
+		if (status != B_OK && status != B_INTERRUPTED)
+			break;
+
+		while (!fQuitting) {
+			status = _MergeSegments();
+			if (status != B_OK) {
+				if (status != B_ENTRY_NOT_FOUND) {
+					TRACE("merging failed: %s\n", strerror(status));
+				}
+				break;
+			}
+		}
+	}
+}
+
+
+/*!	Picks the segments to merge next: segments are grouped into levels by the
+	number of their documents, and as soon as a level has kMergeFactor
+	segments, these are merged into one of the next level. This way, every
+	document is only rewritten a logarithmic number of times. Segments that
+	have no documents left are always dropped.
+*/
+bool
+InvertedIndex::_SelectMergeSources(std::vector<MergeSource>& sources)
+{
+	std::vector<IndexSegment*> segments = fSegments;
+	std::sort(segments.begin(), segments.end(), LiveDocumentsLess());
+
+	uint32 first = 0;
+	uint32 count = 0;
+	while (first < segments.size()
+		&& segments[first]->CountLiveDocuments() == 0)
+		first++;
+
+	if (first > 0) {
+		count = first;
+		first = 0;
+	} else {
+		for (uint32 i = 0; i < segments.size(); i = first + count) {
+			first = i;
+			uint32 level = merge_level(segments[i]->CountLiveDocuments());
+			count = 1;
+			while (first + count < segments.size()
+				&& merge_level(segments[first + count]->CountLiveDocuments())
+					== level)
+				count++;
+
+			if (count >= kMergeFactor) {
+				count = kMergeFactor;
+				break;
+			}
+		}
+		if (count < kMergeFactor)
+			return false;
+	}
+
+	sources.resize(count);
+	for (uint32 i = 0; i < count; i++) {
+		sources[i].segment = segments[first + i];
+		sources[i].segment->GetDeletions(sources[i].deleted);
+	}
+
+	// keep the segments in their original order
+	for (uint32 i = 0, j = 0; i < fSegments.size(); i++) {
+		for (uint32 k = j; k < count; k++) {
+			if (sources[k].segment == fSegments[i]) {
+				std::swap(sources[j].segment, sources[k].segment);
+				sources[j].deleted.swap(sources[k].deleted);
+				j++;
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+/*!	Writes a segment that contains all documents of the \a sources that had
+	not been deleted when the sources were selected. Runs without holding the
+	lock; the sources are immutable, and only the merge thread ever removes
+	segments.
+*/
+status_t
+InvertedIndex::_WriteMergedSegment(std::vector<MergeSource>& sources,
+	uint32 id)
+{
+	SegmentWriter writer;
+	status_t status = writer.Init(IndexSegment::FilePath(fDirectory.String(),
+		id, "seg").String());
+	if (status != B_OK)
+		return status;
+
+	for (uint32 i = 0; i < sources.size(); i++) {
+		MergeSource& source = sources[i];
+		IndexSegment* segment = source.segment;
+		source.remap.resize(segment->CountDocuments(), kInvalidDocument);
+
+		for (uint32 document = 0; document < segment->CountDocuments();
+				document++) {
+			if ((source.deleted[document / 8] & (1 << (document % 8))) != 0)
+				continue;
+
+			source.remap[document] = writer.AddDocument(
+				segment->DocumentPath(document),
+				segment->DocumentLength(document));
+		}
+	}
+
+	// merge the sorted term lists
+	std::vector<uint32> cursors(sources.size(), 0);
+	while (true) {
+		if (fQuitting)
+			return B_CANCELED;
+
+		const char* term = NULL;
+		for (uint32 i = 0; i < sources.size(); i++) {
+			if (cursors[i] >= sources[i].segment->CountTerms())
+				continue;
+
+			const char* candidate = sources[i].segment->TermAt(cursors[i]);
+			if (term == NULL || strcmp(candidate, term) < 0)
+				term = candidate;
+		}
+		if (term == NULL)
+			break;
+
+		status = writer.BeginTerm(term);
+		if (status != B_OK)
+			return status;
+
+		for (uint32 i = 0; i < sources.size(); i++) {
+			IndexSegment* segment = sources[i].segment;
+			if (cursors[i] >= segment->CountTerms()
+				|| strcmp(segment->TermAt(cursors[i]), term) != 0)
+				continue;
+
+			const std::vector<uint32>& remap = sources[i].remap;
+			PostingIterator iterator;
+			segment->GetPostingsAt(cursors[i]++, iterator);
+			while (iterator.Next()) {
+				if (iterator.Document() >= remap.size()
+					|| remap[iterator.Document()] == kInvalidDocument)
+					continue;
+
+				status = writer.AddPosting(remap[iterator.Document()],
+					iterator.Frequency());
+				if (status != B_OK)
+					return status;
+			}
+		}
+	}
+
+	return writer.Finish();
+}
+
+
+status_t
+InvertedIndex::_MergeSegments()
+{
+	std::vector<MergeSource> sources;
+	uint32 id;
+	uint32 documentCount = 0;
+
+	{
+		Locker locker(fLock);
+		try {
+			if (!_SelectMergeSources(sources))
+				return B_ENTRY_NOT_FOUND;
+		} catch (std::bad_alloc&) {
+			return B_NO_MEMORY;
+		}
+
+		for (uint32 i = 0; i < sources.size(); i++)
+			documentCount += sources[i].segment->CountLiveDocuments();
+
+		id = fNextSegment++;
+	}
+
+	TRACE("merging %" B_PRIuSIZE " segments with %" B_PRIu32 " documents into "
+		"%" B_PRIu32 "\n", sources.size(), documentCount, id);
+
+	IndexSegment* merged = NULL;
+	if (documentCount > 0) {
+		status_t status;
+		try {
+			status = _WriteMergedSegment(sources, id);
+		} catch (std::bad_alloc&) {
+			status = B_NO_MEMORY;
+		}
+
+		if (status == B_OK) {
+			merged = new(std::nothrow) IndexSegment(id);
+			if (merged == NULL)
+				status = B_NO_MEMORY;
+			else
+				status = merged->Open(fDirectory.String());
+		}
+		if (status != B_OK) {
+			delete merged;
+			unlink(IndexSegment::FilePath(fDirectory.String(), id, "seg")
+				.String());
+			return status;
+		}
+	}
+
+	Locker locker(fLock);
+
+	// carry over the deletions that happened while merging
+	for (uint32 i = 0; merged != NULL && i < sources.size(); i++) {
+		MergeSource& source = sources[i];
+		for (uint32 document = 0; document < source.remap.size(); document++) {
+			if (source.remap[document] != kInvalidDocument
+				&& source.segment->IsDeleted(document))
+				merged->Delete(source.remap[document]);
+		}
+	}
+
+	std::vector<IndexSegment*> previous = fSegments;
+	std::vector<IndexSegment*> segments;
+	for (uint32 i = 0; i < fSegments.size(); i++) {
+		bool merging = false;
+		for (uint32 j = 0; j < sources.size(); j++) {
+			if (sources[j].segment == fSegments[i]) {
+				merging = true;
+				break;
+			}
+		}
+
+		if (merging) {
+			if (merged != NULL)
+				segments.push_back(merged);
+			merged = NULL;
+		} else
+			segments.push_back(fSegments[i]);
+	}
+	fSegments = segments;
+
+	status_t status = B_OK;
+	for (uint32 i = 0; i < fSegments.size() && status == B_OK; i++)
+		status = fSegments[i]->WriteDeletions(fDirectory.String());
+	if (status == B_OK)
+		status = _WriteManifest();
+
+	if (status != B_OK) {
+		// keep using the sources
+		fSegments = previous;
+		for (uint32 i = 0; i < segments.size(); i++) {
+			if (segments[i]->ID() == id) {
+				segments[i]->RemoveFiles(fDirectory.String());
+				delete segments[i];
+			}
+		}
+		return status;
+	}
+
+	for (uint32 i = 0; i < sources.size(); i++) {
+		sources[i].segment->RemoveFiles(fDirectory.String());
+		delete sources[i].segment;
+	}
+
+	return B_OK;
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef INVERTED_INDEX_H
+#define INVERTED_INDEX_H
+
+
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+#include <Locker.h>
+#include <OS.h>
+#include <String.h>
+
+#include "IndexSegment.h"
+
+
+/*!	Collects the postings of newly added documents in memory, until they are
+	written out as a new segment.
+*/
+class SegmentBuilder {
+public:
+								SegmentBuilder();
+
+			void				AddDocument(const char* path,
+									const char* text, size_t length);
+			bool				RemoveDocument(const char* path);
+
+			uint32				CountDocuments() const
+									{ return fPaths.size(); }
+			size_t				MemoryUsage() const { return fMemoryUsage; }
+
+			status_t			WriteTo(SegmentWriter& writer) const;
+			void				MakeEmpty();
+
+private:
+			struct Document {
+				std::string		path;
+				uint32			length;
+				bool			deleted;
+			};
+			typedef std::map<std::string, uint32> PathMap;
+			typedef std::map<std::string, std::vector<uint32> > TermMap;
+				// the postings are (document, frequency) pairs
+
+			std::vector<Document> fDocuments;
+			PathMap				fPaths;
+			TermMap				fTerms;
+			size_t				fMemoryUsage;
+};
+
+
+class InvertedIndex {
+public:
+								InvertedIndex(const char* directory);
+								~InvertedIndex();
+
+			status_t			Open(bool writable);
+
+			bool				Lock() { return fLock.Lock(); }
+			void				Unlock() { fLock.Unlock(); }
+
+			const char*			Directory() const
+									{ return fDirectory.String(); }
+			bool				IsWritable() const { return fWritable; }
+
+			// writing, only allowed when opened writable
+			status_t			AddDocument(const char* path,
+									const char* text, size_t length);
+			status_t			RemoveDocument(const char* path);
+			status_t			Commit();
+
+			// reading, the index must be locked
+			status_t			Reload();
+
+			int32				CountSegments() const
+									{ return fSegments.size(); }
+			IndexSegment*		SegmentAt(int32 index) const
+									{ return fSegments[index]; }
+			uint32				CountDocuments() const;
+			uint64				TotalLength() const;
+
+private:
+			struct MergeSource {
+				IndexSegment*		segment;
+				std::vector<uint8>	deleted;
+				std::vector<uint32>	remap;
+			};
+
+			status_t			_ReadManifest(struct stat& st,
+									uint32& nextSegment,
+									std::vector<uint32>& segments);
+			status_t			_WriteManifest();
+			void				_RemoveStaleFiles();
+
+			status_t			_FlushBuilder();
+			void				_DeleteSegments();
+
+	static	status_t			_MergeThread(void* self);
+			void				_MergeLoop();
+			bool				_SelectMergeSources(
+									std::vector<MergeSource>& sources);
+			status_t			_WriteMergedSegment(
+									std::vector<MergeSource>& sources,
+									uint32 id);
+			status_t			_MergeSegments();
+
+private:
+			BString				fDirectory;
+			BLocker				fLock;
+			bool				fWritable;
+
+			std::vector<IndexSegment*> fSegments;
+			uint32				fNextSegment;
+			uint64				fGeneration;
+			ino_t				fManifestNode;
+			timespec			fManifestTime;
+
+			SegmentBuilder		fBuilder;
+
+			thread_id			fMergeThread;
+			sem_id				fMergeSem;
+			volatile bool		fQuitting;
+};
+
+
+#endif	// INVERTED_INDEX_H
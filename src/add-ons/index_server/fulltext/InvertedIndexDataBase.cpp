@@ -0,0 +1,200 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "InvertedIndexDataBase.h"
+
+#include <algorithm>
+#include <map>
+#include <new>
+#include <string.h>
+
+#include <Autolock.h>
+#include <DataIO.h>
+#include <File.h>
+#include <TranslatorFormats.h>
+#include <TranslatorRoster.h>
+
+
+//#define DEBUG_INVERTED_INDEX_DATABASE
+#ifdef DEBUG_INVERTED_INDEX_DATABASE
+#include <stdio.h>
+#	define STRACE(x...) printf("FT: " x)
+#else
+#	define STRACE(x...) ;
+#endif
+
+
+/*!	An index directory can only have one writer. The volume watcher and the
+	catch up workers each have their own analyser, so they share the index.
+*/
+struct SharedIndex {
+	InvertedIndex*	index;
+	int32			referenceCount;
+};
+
+typedef std::map<BString, SharedIndex> SharedIndexMap;
+
+static BLocker sSharedIndexLock("shared inverted indices");
+static SharedIndexMap sSharedIndices;
+
+
+InvertedIndexWriteDataBase::InvertedIndexWriteDataBase(
+	const BPath& databasePath)
+{
+	fIndex = _AcquireIndex(databasePath.Path(), fInitStatus);
+	if (fInitStatus != B_OK) {
+		STRACE("could not open the index in %s: %s\n", databasePath.Path(),
+			strerror(fInitStatus));
+	}
+}
+
+
+InvertedIndexWriteDataBase::~InvertedIndexWriteDataBase()
+{
+	_ReleaseIndex(fIndex);
+}
+
+
+status_t
+InvertedIndexWriteDataBase::InitCheck()
+{
+	return fInitStatus;
+}
+
+
+status_t
+InvertedIndexWriteDataBase::AddDocument(const entry_ref& ref)
+{
+	if (std::find(fAddQueue.begin(), fAddQueue.end(), ref) == fAddQueue.end())
+		fAddQueue.push_back(ref);
+	return B_OK;
+}
+
+
+status_t
+InvertedIndexWriteDataBase::RemoveDocument(const entry_ref& ref)
+{
+	if (std::find(fDeleteQueue.begin(), fDeleteQueue.end(), ref)
+			== fDeleteQueue.end())
+		fDeleteQueue.push_back(ref);
+	return B_OK;
+}
+
+
+status_t
+InvertedIndexWriteDataBase::Commit()
+{
+	if (fInitStatus != B_OK)
+		return fInitStatus;
+	if (fAddQueue.empty() && fDeleteQueue.empty())
+		return B_OK;
+	STRACE("Commit\n");
+
+	for (unsigned int i = 0; i < fDeleteQueue.size(); i++) {
+		BPath path(&fDeleteQueue[i]);
+		if (path.InitCheck() == B_OK)
+			fIndex->RemoveDocument(path.Path());
+	}
+	fDeleteQueue.clear();
+
+	status_t status = B_OK;
+	for (unsigned int i = 0; i < fAddQueue.size(); i++) {
+		status = _IndexDocument(fAddQueue[i]);
+		if (status == B_NO_MEMORY)
+			break;
+	}
+	fAddQueue.clear();
+
+	status_t commitStatus = fIndex->Commit();
+	return commitStatus != B_OK ? commitStatus : status;
+}
+
+
+status_t
+InvertedIndexWriteDataBase::_IndexDocument(const entry_ref& ref)
+{
+	BPath path(&ref);
+	if (path.InitCheck() != B_OK)
+		return path.InitCheck();
+
+	BFile file(&ref, B_READ_ONLY);
+	if (file.InitCheck() != B_OK) {
+		STRACE("Can't open %s\n", path.Path());
+		fIndex->RemoveDocument(path.Path());
+		return file.InitCheck();
+	}
+
+	BMallocIO text;
+	status_t status = BTranslatorRoster::Default()->Translate(&file, NULL,
+		NULL, &text, B_TRANSLATOR_TEXT);
+	if (status != B_OK) {
+		fIndex->RemoveDocument(path.Path());
+		return status;
+	}
+
+	return fIndex->AddDocument(path.Path(), (const char*)text.Buffer(),
+		text.BufferLength());
+}
+
+
+/*static*/ InvertedIndex*
+InvertedIndexWriteDataBase::_AcquireIndex(const char* path, status_t& _status)
+{
+	BAutolock _(sSharedIndexLock);
+
+	SharedIndexMap::iterator found = sSharedIndices.find(path);
+	if (found != sSharedIndices.end()) {
+		found->second.referenceCount++;
+		_status = B_OK;
+		return found->second.index;
+	}
+
+	InvertedIndex* index = new(std::nothrow) InvertedIndex(path);
+	if (index == NULL) {
+		_status = B_NO_MEMORY;
+		return NULL;
+	}
+
+	_status = index->Open(true);
+	if (_status != B_OK) {
+		delete index;
+		return NULL;
+	}
+
+	try {
+		SharedIndex& shared = sSharedIndices[path];
+		shared.index = index;
+		shared.referenceCount = 1;
+	} catch (std::bad_alloc&) {
+		delete index;
+		_status = B_NO_MEMORY;
+		return NULL;
+	}
+
+	return index;
+}
+
+
+/*static*/ void
+InvertedIndexWriteDataBase::_ReleaseIndex(InvertedIndex* index)
+{
+	if (index == NULL)
+		return;
+
+	BAutolock _(sSharedIndexLock);
+
+	SharedIndexMap::iterator iterator = sSharedIndices.begin();
+	for (; iterator != sSharedIndices.end(); iterator++) {
+		if (iterator->second.index != index)
+			continue;
+
+		if (--iterator->second.referenceCount == 0) {
+			sSharedIndices.erase(iterator);
+			delete index;
+		}
+		return;
+	}
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef INVERTED_INDEX_DATA_BASE_H
+#define INVERTED_INDEX_DATA_BASE_H
+
+
+#include <vector>
+
+#include <Path.h>
+
+#include "InvertedIndex.h"
+#include "TextDataBase.h"
+
+
+class InvertedIndexWriteDataBase : public TextWriteDataBase {
+public:
+								InvertedIndexWriteDataBase(
+									const BPath& databasePath);
+								~InvertedIndexWriteDataBase();
+
+			status_t			InitCheck();
+
+			status_t			AddDocument(const entry_ref& ref);
+			status_t			RemoveDocument(const entry_ref& ref);
+			status_t			Commit();
+
+private:
+			status_t			_IndexDocument(const entry_ref& ref);
+
+	static	InvertedIndex*		_AcquireIndex(const char* path,
+									status_t& _status);
+	static	void				_ReleaseIndex(InvertedIndex* index);
+
+			InvertedIndex*		fIndex;
+			status_t			fInitStatus;
+
+			std::vector<entry_ref>	fAddQueue;
+			std::vector<entry_ref>	fDeleteQueue;
+};
+
+#endif	// INVERTED_INDEX_DATA_BASE_H
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+
+#include <SupportDefs.h>
+
+
+static const size_t kMinTermLength = 2;
+static const size_t kMaxTermLength = 64;
+
+
+/*!	Splits UTF-8 text into lower case terms. Everything that is not an ASCII
+	letter or digit separates terms, non-ASCII characters are kept as they
+	are. Terms that are too short or too long are skipped.
+	Both the indexer and the queries use it, so that they agree on what a term
+	is.
+*/
+class Tokenizer {
+public:
+	Tokenizer(const char* text, size_t length)
+		:
+		fText(text),
+		fEnd(text + length)
+	{
+	}
+
+	//! Returns the next term, or \c NULL if there is none left.
+	const char* Next(size_t* _length)
+	{
+		while (fText < fEnd) {
+			while (fText < fEnd && !_IsTermCharacter(*fText))
+				fText++;
+
+			size_t length = 0;
+			while (fText < fEnd && _IsTermCharacter(*fText)) {
+				if (length < kMaxTermLength)
+					fTerm[length] = _ToLower(*fText);
+				length++;
+				fText++;
+			}
+
+			if (length < kMinTermLength || length > kMaxTermLength)
+				continue;
+
+			fTerm[length] = '\0';
+			*_length = length;
+			return fTerm;
+		}
+
+		return NULL;
+	}
+
+private:
+	static bool _IsTermCharacter(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+			|| (c >= '0' && c <= '9') || (uint8)c >= 0x80;
+	}
+
+	static char _ToLower(char c)
+	{
+		return c >= 'A' && c <= 'Z' ? c + 'a' - 'A' : c;
+	}
+
+private:
+	const char*			fText;
+	const char*			fEnd;
+	char				fTerm[kMaxTermLength + 1];
+};
+
+
+#endif	// TOKENIZER_H
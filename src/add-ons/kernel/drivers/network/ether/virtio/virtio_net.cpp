@@ -1,6 +1,7 @@
 /*
  * Copyright 2013, 2018, Jérôme Duval, jerome.duval@gmail.com.
  * Copyright 2017, Philippe Houdoin, philippe.houdoin@gmail.com.
+ * Copyright 2026, Haiku, Inc. All rights reserved.
  * Distributed under the terms of the MIT License.
  */
 
@@ -10,6 +11,7 @@
 
 #include <ethernet.h>
 #include <lock.h>
+#include <packet_ring.h>
 #include <util/DoublyLinkedList.h>
 #include <virtio.h>
 
@@ -24,6 +26,12 @@
 
 #define BUFFER_SIZE	2048
 #define MAX_FRAME_SIZE 1536
+#define TSO_BUFFER_SIZE	(17 * B_PAGE_SIZE)
+	// the header, and the largest IP packet with its link header
+#define MAX_TSO_BUFFERS	32
+#define RING_RELEASE_INTERVAL	1000
+	// how often to check for buffers a packet ring gave back, if the device
+	// has no other reason to wake up the reader
 
 
 struct virtio_net_rx_hdr {
@@ -67,6 +75,7 @@ typedef struct {
 	BufInfo**				rxBufInfos;
 	sem_id					rxDone;
 	area_id					rxArea;
+	char*					rxBase;
 	BufInfoList				rxFullList;
 	mutex					rxLock;
 
@@ -74,6 +83,8 @@ typedef struct {
 	uint16*					txSizes;
 
 	BufInfo**				txBufInfos;
+	uint16					txBufCount;
+	size_t					txBufSize;
 	sem_id					txDone;
 	area_id					txArea;
 	BufInfoList				txFreeList;
@@ -84,8 +95,19 @@ typedef struct {
 	bool					nonblocking;
 	bool					promiscuous;
 	uint32					maxframesize;
+	uint32					offload;
+		// the enabled ETHER_OFFLOAD_* features
 	ether_address_t			macaddr;
 
+	// the packet ring the frames of the receive queue go into, if any
+	bool					ringAttached;
+	ether_packet_ring		ring;
+	BufInfo**				ringBufInfos;
+		// the buffer behind each descriptor of the ring
+	uint32					ringProducer;
+	uint32					ringReleased;
+		// the buffers before this index have been given back to the device
+
 #define MAX_MULTI 128
 	uint32					multiCount;
 	ether_address_t			multi[MAX_MULTI];
@@ -103,6 +125,7 @@ typedef struct {
 #include <stdlib.h>
 
 #include <fs/devfs.h>
+#include <kernel.h>
 
 
 //#define TRACE_VIRTIO_NET
@@ -192,6 +215,73 @@ virtio_net_drain_queues(virtio_net_driver_info* info)
 }
 
 
+static uint32
+virtio_net_supported_offload(virtio_net_driver_info* info)
+{
+	uint32 offload = 0;
+	if ((info->features & VIRTIO_NET_F_GUEST_CSUM) != 0)
+		offload |= ETHER_OFFLOAD_RX_CHECKSUM;
+	if ((info->features & VIRTIO_NET_F_CSUM) != 0) {
+		offload |= ETHER_OFFLOAD_TX_CHECKSUM;
+		if ((info->features & VIRTIO_NET_F_HOST_TSO4) != 0)
+			offload |= ETHER_OFFLOAD_TSO4;
+		if ((info->features & VIRTIO_NET_F_HOST_TSO6) != 0)
+			offload |= ETHER_OFFLOAD_TSO6;
+	}
+	return offload;
+}
+
+
+/*!	Completes the checksum of a received frame, whose checksum field only
+	contains the pseudo header sum.
+*/
+static bool
+virtio_net_complete_checksum(uint8* frame, size_t length, uint16 start,
+	uint16 offset)
+{
+	if ((size_t)start + offset + 2 > length)
+		return false;
+
+	uint32 sum = 0;
+	size_t i = start;
+	for (; i + 1 < length; i += 2)
+		sum += ((uint32)frame[i] << 8) | frame[i + 1];
+	if (i < length)
+		sum += (uint32)frame[i] << 8;
+
+	while ((sum >> 16) != 0)
+		sum = (sum & 0xffff) + (sum >> 16);
+	sum = ~sum & 0xffff;
+	if (sum == 0)
+		sum = 0xffff;
+
+	frame[start + offset] = sum >> 8;
+	frame[start + offset + 1] = sum & 0xff;
+	return true;
+}
+
+
+/*!	Returns the length of the frame received into \a buf, and completes its
+	checksum if necessary.
+*/
+static size_t
+virtio_net_rx_finish_buf(BufInfo* buf)
+{
+	size_t frameLength = buf->rxUsedLength > sizeof(virtio_net_hdr)
+		? buf->rxUsedLength - sizeof(virtio_net_hdr) : 0;
+
+	// a partial checksum is only used between the device and its host, and
+	// is completed here
+	if ((buf->hdr->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM) != 0
+		&& virtio_net_complete_checksum((uint8*)buf->buffer, frameLength,
+			buf->hdr->csum_start, buf->hdr->csum_offset)) {
+		buf->hdr->flags = VIRTIO_NET_HDR_F_DATA_VALID;
+	}
+
+	return frameLength;
+}
+
+
 static status_t
 virtio_net_rx_enqueue_buf(virtio_net_driver_info* info, BufInfo* buf)
 {
@@ -273,6 +363,123 @@ vtnet_set_allmulti(virtio_net_driver_info* info, int value)
 #define ROUND_TO_PAGE_SIZE(x) (((x) + (B_PAGE_SIZE) - 1) & ~((B_PAGE_SIZE) - 1))
 
 
+//	#pragma mark - packet ring
+
+
+/*!	Gives the buffers the consumer of the packet ring is done with back to
+	the device, and puts the frames that have been received since into the
+	ring. The rxLock must be held.
+*/
+static void
+virtio_net_ring_receive(virtio_net_driver_info* info)
+{
+	ether_packet_ring& ring = info->ring;
+	uint32 mask = ring.size - 1;
+
+	// the consumer index is written by userland, and cannot be trusted
+	uint32 consumer = ring.index->consumer;
+	if (consumer - info->ringReleased > info->ringProducer - info->ringReleased)
+		consumer = info->ringReleased;
+
+	while (info->ringReleased != consumer) {
+		virtio_net_rx_enqueue_buf(info,
+			info->ringBufInfos[info->ringReleased & mask]);
+		info->ringReleased++;
+	}
+
+	uint32 producer = info->ringProducer;
+	while (BufInfo* buf = info->rxFullList.RemoveHead()) {
+		size_t frameLength = virtio_net_rx_finish_buf(buf);
+
+		if (producer - info->ringReleased >= ring.size) {
+			// the ring is full
+			atomic_add((int32*)ring.dropped, 1);
+			virtio_net_rx_enqueue_buf(info, buf);
+			continue;
+		}
+
+		packet_ring_descriptor& descriptor = ring.descriptors[producer & mask];
+		descriptor.offset = buf->buffer - info->rxBase;
+		descriptor.length = frameLength;
+		descriptor.flags = (buf->hdr->flags & VIRTIO_NET_HDR_F_DATA_VALID) != 0
+			? PACKET_RING_CHECKSUM_VALID : 0;
+
+		info->ringBufInfos[producer & mask] = buf;
+		producer++;
+	}
+
+	if (producer == info->ringProducer)
+		return;
+
+	// the descriptors need to be visible before the index that covers them
+	memory_write_barrier();
+	ring.index->producer = producer;
+
+	bool wasEmpty = info->ringProducer == consumer;
+	info->ringProducer = producer;
+	if (wasEmpty)
+		ring.notify(ring.cookie);
+}
+
+
+static status_t
+virtio_net_ring_attach(virtio_net_driver_info* info, ether_packet_ring* ring)
+{
+	if (ring->queue >= info->pairsCount)
+		return B_BAD_INDEX;
+	if (ring->size == 0 || (ring->size & (ring->size - 1)) != 0)
+		return B_BAD_VALUE;
+
+	BufInfo** bufInfos = (BufInfo**)malloc(sizeof(BufInfo*) * ring->size);
+	if (bufInfos == NULL)
+		return B_NO_MEMORY;
+
+	mutex_lock(&info->rxLock);
+	if (info->ringAttached) {
+		mutex_unlock(&info->rxLock);
+		free(bufInfos);
+		return B_BUSY;
+	}
+
+	info->ring = *ring;
+	info->ringBufInfos = bufInfos;
+	info->ringProducer = ring->index->producer;
+	info->ringReleased = info->ringProducer;
+	info->ringAttached = true;
+
+	// the frames the stack has not read yet go into the ring as well
+	virtio_net_ring_receive(info);
+	mutex_unlock(&info->rxLock);
+
+	ring->frame_area = info->rxArea;
+	return B_OK;
+}
+
+
+static void
+virtio_net_ring_detach(virtio_net_driver_info* info)
+{
+	mutex_lock(&info->rxLock);
+	if (!info->ringAttached) {
+		mutex_unlock(&info->rxLock);
+		return;
+	}
+
+	// the device gets back all the buffers the ring still holds
+	uint32 mask = info->ring.size - 1;
+	while (info->ringReleased != info->ringProducer) {
+		virtio_net_rx_enqueue_buf(info,
+			info->ringBufInfos[info->ringReleased & mask]);
+		info->ringReleased++;
+	}
+
+	free(info->ringBufInfos);
+	info->ringBufInfos = NULL;
+	info->ringAttached = false;
+	mutex_unlock(&info->rxLock);
+}
+
+
 //	#pragma mark - device module API
 
 
@@ -290,6 +497,8 @@ virtio_net_init_device(void* _info, void** _cookie)
 	info->virtio->negotiate_features(info->virtio_device,
 		VIRTIO_NET_F_STATUS | VIRTIO_NET_F_MAC | VIRTIO_NET_F_MTU
 		| VIRTIO_NET_F_CTRL_VQ | VIRTIO_NET_F_CTRL_RX
+		| VIRTIO_NET_F_CSUM | VIRTIO_NET_F_GUEST_CSUM
+		| VIRTIO_NET_F_HOST_TSO4 | VIRTIO_NET_F_HOST_TSO6
 		/* | VIRTIO_NET_F_MQ */,
 		 &info->features, &get_feature_name);
 
@@ -359,6 +568,7 @@ virtio_net_init_device(void* _info, void** _cookie)
 		status = info->rxArea;
 		goto err3;
 	}
+	info->rxBase = rxBuffer;
 
 	// initialize receive buffer descriptors
 	for (int i = 0; i < info->rxSizes[0]; i++) {
@@ -384,18 +594,36 @@ virtio_net_init_device(void* _info, void** _cookie)
 			goto err4;
 	}
 
-	// create transmit buffer area
-	info->txArea = create_area("virtionet tx buffer", (void**)&txBuffer,
-		B_ANY_KERNEL_BLOCK_ADDRESS, ROUND_TO_PAGE_SIZE(
-			BUFFER_SIZE * info->txSizes[0]),
-		B_FULL_LOCK, B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA);
+	// create transmit buffer area; segmentation needs buffers that can hold
+	// a whole IP packet, and fewer of them will do
+	info->txArea = B_NO_MEMORY;
+	if ((info->features
+			& (VIRTIO_NET_F_HOST_TSO4 | VIRTIO_NET_F_HOST_TSO6)) != 0) {
+		info->txBufSize = TSO_BUFFER_SIZE;
+		info->txBufCount = min_c(info->txSizes[0], MAX_TSO_BUFFERS);
+		info->txArea = create_area("virtionet tx buffer", (void**)&txBuffer,
+			B_ANY_KERNEL_BLOCK_ADDRESS, info->txBufSize * info->txBufCount,
+			B_CONTIGUOUS, B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA);
+		if (info->txArea < B_OK) {
+			info->features &= ~(uint64)(VIRTIO_NET_F_HOST_TSO4
+				| VIRTIO_NET_F_HOST_TSO6);
+		}
+	}
+	if (info->txArea < B_OK) {
+		info->txBufSize = BUFFER_SIZE;
+		info->txBufCount = info->txSizes[0];
+		info->txArea = create_area("virtionet tx buffer", (void**)&txBuffer,
+			B_ANY_KERNEL_BLOCK_ADDRESS, ROUND_TO_PAGE_SIZE(
+				info->txBufSize * info->txBufCount),
+			B_FULL_LOCK, B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA);
+	}
 	if (info->txArea < B_OK) {
 		status = info->txArea;
 		goto err5;
 	}
 
 	// initialize transmit buffer descriptors
-	for (int i = 0; i < info->txSizes[0]; i++) {
+	for (int i = 0; i < info->txBufCount; i++) {
 		BufInfo* buf = new(std::nothrow) BufInfo;
 		if (buf == NULL) {
 			status = B_NO_MEMORY;
@@ -404,11 +632,11 @@ virtio_net_init_device(void* _info, void** _cookie)
 
 		info->txBufInfos[i] = buf;
 		buf->hdr = (struct virtio_net_hdr*)((addr_t)txBuffer
-			+ i * BUFFER_SIZE);
+			+ i * info->txBufSize);
 		buf->buffer = (char*)((addr_t)buf->hdr + sizeof(virtio_net_tx_hdr));
 
 		status = get_memory_map(buf->buffer,
-			BUFFER_SIZE - sizeof(virtio_net_tx_hdr), &buf->entry, 1);
+			info->txBufSize - sizeof(virtio_net_tx_hdr), &buf->entry, 1);
 		if (status != B_OK)
 			goto err6;
 
@@ -527,6 +755,7 @@ virtio_net_open(void* _info, const char* path, int openMode, void** _cookie)
 
 	info->nonblocking = (openMode & O_NONBLOCK) != 0;
 	info->maxframesize = MAX_FRAME_SIZE;
+	info->offload = 0;
 	info->rxDone = create_sem(0, "virtio_net_rx");
 	info->txDone = create_sem(1, "virtio_net_tx");
 	if (info->rxDone < B_OK || info->txDone < B_OK)
@@ -576,6 +805,8 @@ virtio_net_close(void* cookie)
 	CALLED();
 
 	virtio_net_driver_info* info = handle->info;
+	virtio_net_ring_detach(info);
+
 	delete_sem(info->rxDone);
 	delete_sem(info->txDone);
 	info->rxDone = info->txDone = -1;
@@ -621,8 +852,15 @@ virtio_net_read(void* cookie, off_t pos, void* buffer, size_t* _length)
 		if (info->nonblocking)
 			return B_WOULD_BLOCK;
 		TRACE("virtio_net_read: waiting\n");
-		status_t status = acquire_sem(info->rxDone);
-		if (status != B_OK) {
+
+		// while a packet ring holds some of the buffers, it is the only
+		// one to know when they can be used again
+		bigtime_t timeout = info->ringAttached
+				&& info->ringReleased != info->ringProducer
+			? RING_RELEASE_INTERVAL : B_INFINITE_TIMEOUT;
+		status_t status = acquire_sem_etc(info->rxDone, 1, B_RELATIVE_TIMEOUT,
+			timeout);
+		if (status != B_OK && status != B_TIMED_OUT) {
 			ERROR("acquire_sem(rxDone) failed (%s)\n", strerror(status));
 			return status;
 		}
@@ -643,12 +881,31 @@ virtio_net_read(void* cookie, off_t pos, void* buffer, size_t* _length)
 			buf->rxUsedLength = usedLength;
 			info->rxFullList.Add(buf);
 		}
+
+		// as long as there is a packet ring, all frames go there
+		if (info->ringAttached)
+			virtio_net_ring_receive(info);
 		TRACE("virtio_net_read: finished waiting\n");
 	}
 
 	BufInfo* buf = info->rxFullList.RemoveHead();
-	*_length = MIN(buf->rxUsedLength, *_length);
-	memcpy(buffer, buf->buffer, *_length);
+	size_t frameLength = virtio_net_rx_finish_buf(buf);
+
+	size_t headerLength = 0;
+	if (info->offload != 0) {
+		ether_offload_header header;
+		memset(&header, 0, sizeof(header));
+		if ((info->offload & ETHER_OFFLOAD_RX_CHECKSUM) != 0
+			&& (buf->hdr->flags & VIRTIO_NET_HDR_F_DATA_VALID) != 0)
+			header.flags = ETHER_OFFLOAD_CHECKSUM_VALID;
+
+		headerLength = MIN(sizeof(header), *_length);
+		memcpy(buffer, &header, headerLength);
+	}
+
+	*_length = headerLength + MIN(frameLength, *_length - headerLength);
+	memcpy((uint8*)buffer + headerLength, buf->buffer,
+		*_length - headerLength);
 	virtio_net_rx_enqueue_buf(info, buf);
 	mutex_unlock(&info->rxLock);
 	return B_OK;
@@ -703,15 +960,41 @@ virtio_net_write(void* cookie, off_t pos, const void* buffer,
 	}
 	BufInfo* buf = info->txFreeList.RemoveHead();
 
-	TRACE("virtio_net_write: copying %lu\n", MIN(MAX_FRAME_SIZE, *_length));
-	memcpy(buf->buffer, buffer, MIN(MAX_FRAME_SIZE, *_length));
 	memset(buf->hdr, 0, sizeof(virtio_net_hdr));
 
+	size_t maxLength = MAX_FRAME_SIZE;
+	size_t length = *_length;
+	if (info->offload != 0 && length >= sizeof(ether_offload_header)) {
+		// the offload header has the same layout as the virtio one
+		const ether_offload_header* header
+			= (const ether_offload_header*)buffer;
+		if ((header->flags & ETHER_OFFLOAD_NEEDS_CHECKSUM) != 0) {
+			buf->hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+			buf->hdr->csum_start = header->checksum_start;
+			buf->hdr->csum_offset = header->checksum_offset;
+		}
+		if (header->segmentation != ETHER_OFFLOAD_SEGMENT_NONE) {
+			buf->hdr->gso_type = header->segmentation
+					== ETHER_OFFLOAD_SEGMENT_TCP6
+				? VIRTIO_NET_HDR_GSO_TCPV6 : VIRTIO_NET_HDR_GSO_TCPV4;
+			buf->hdr->hdr_len = header->header_length;
+			buf->hdr->gso_size = header->segment_size;
+			maxLength = info->txBufSize - sizeof(virtio_net_tx_hdr);
+		}
+
+		buffer = (const uint8*)buffer + sizeof(ether_offload_header);
+		length -= sizeof(ether_offload_header);
+	}
+	length = MIN(maxLength, length);
+
+	TRACE("virtio_net_write: copying %lu\n", length);
+	memcpy(buf->buffer, buffer, length);
+
 	physical_entry entries[2];
 	entries[0] = buf->hdrEntry;
 	entries[0].size = sizeof(virtio_net_hdr);
 	entries[1] = buf->entry;
-	entries[1].size = MIN(MAX_FRAME_SIZE, *_length);
+	entries[1].size = length;
 
 	// queue the virtio_net_hdr + buffer data
 	status_t status = info->virtio->queue_request_v(info->txQueues[0],
@@ -853,6 +1136,50 @@ virtio_net_ioctl(void* cookie, uint32 op, void* buffer, size_t length)
 			return user_memcpy(buffer, &state, sizeof(ether_link_state_t));
 		}
 
+		case ETHER_GET_OFFLOAD:
+		{
+			TRACE("ioctl: get offload\n");
+			uint32 offload = virtio_net_supported_offload(info);
+			if (length != sizeof(offload))
+				return B_BAD_VALUE;
+			return user_memcpy(buffer, &offload, sizeof(offload));
+		}
+		case ETHER_SET_OFFLOAD:
+		{
+			TRACE("ioctl: set offload\n");
+			uint32 offload;
+			if (length != sizeof(offload))
+				return B_BAD_VALUE;
+			if (user_memcpy(&offload, buffer, sizeof(offload)) != B_OK)
+				return B_BAD_ADDRESS;
+			if ((offload & ~virtio_net_supported_offload(info)) != 0)
+				return B_NOT_SUPPORTED;
+
+			info->offload = offload;
+			return B_OK;
+		}
+
+		case ETHER_ATTACH_PACKET_RING:
+		{
+			TRACE("ioctl: attach packet ring\n");
+			// the ring is handed over by pointers, only the stack can do so
+			if (IS_USER_ADDRESS(buffer))
+				return B_NOT_ALLOWED;
+			if (length != sizeof(ether_packet_ring))
+				return B_BAD_VALUE;
+
+			return virtio_net_ring_attach(info, (ether_packet_ring*)buffer);
+		}
+		case ETHER_DETACH_PACKET_RING:
+		{
+			TRACE("ioctl: detach packet ring\n");
+			if (IS_USER_ADDRESS(buffer))
+				return B_NOT_ALLOWED;
+
+			virtio_net_ring_detach(info);
+			return B_OK;
+		}
+
 		default:
 			ERROR("ioctl: unknown message %" B_PRIx32 "\n", op);
 			break;
@@ -1233,12 +1233,25 @@ BlockAllocator::Trim(uint64 offset, uint64 size, uint64& trimmedSize)
 			}
 		}
 
+		// The free ranges found must be trimmed before the allocator is
+		// unlocked, or they could be in use already when the trim is executed
+		status_t status = _TrimNext(*trimData, kTrimRanges,
+			firstFree << blockShift, freeLength << blockShift, true,
+			trimmedSize);
+		if (status != B_OK)
+			return status;
+
+		// Let waiting allocations in before going on with the next group,
+		// so that trimming the whole disk does not stall them until the end
+		locker.Unlock();
+		locker.Lock();
+
+		freeLength = 0;
 		firstBlock = 0;
 		firstBit = 0;
 	}
 
-	return _TrimNext(*trimData, kTrimRanges, firstFree << blockShift,
-		freeLength << blockShift, true, trimmedSize);
+	return B_OK;
 }
 
 
@@ -1356,7 +1369,7 @@ BlockAllocator::_TrimNext(fs_trim_data& trimData, uint32 maxRanges,
 
 	const bool rangesFilled = _AddTrim(trimData, maxRanges, offset, size);
 
-	if (rangesFilled || force) {
+	if ((rangesFilled || force) && trimData.range_count > 0) {
 		// Trim now
 		trimData.trimmed_size = 0;
 #ifdef DEBUG_TRIM
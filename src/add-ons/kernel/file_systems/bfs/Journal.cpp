@@ -407,10 +407,16 @@ Journal::Journal(Volume* volume)
 	fUsed(0),
 	fUnwrittenTransactions(0),
 	fHasSubtransaction(false),
-	fSeparateSubTransactions(false)
+	fSeparateSubTransactions(false),
+	fSyncWaiters(0),
+	fSyncGeneration(0),
+	fSyncing(false),
+	fSyncStatus(B_OK)
 {
 	recursive_lock_init(&fLock, "bfs journal");
 	mutex_init(&fEntriesLock, "bfs journal entries");
+	mutex_init(&fSyncLock, "bfs journal sync");
+	fSyncWaitSem = create_sem(0, "bfs journal sync waiters");
 
 	fLogFlusherSem = create_sem(0, "bfs log flusher");
 	fLogFlusher = spawn_kernel_thread(&Journal::_LogFlusher, "bfs log flusher",
@@ -426,6 +432,8 @@ Journal::~Journal()
 
 	recursive_lock_destroy(&fLock);
 	mutex_destroy(&fEntriesLock);
+	mutex_destroy(&fSyncLock);
+	delete_sem(fSyncWaitSem);
 
 	sem_id logFlusher = fLogFlusherSem;
 	fLogFlusherSem = -1;
@@ -437,6 +445,9 @@ Journal::~Journal()
 status_t
 Journal::InitCheck()
 {
+	if (fSyncWaitSem < B_OK)
+		return fSyncWaitSem;
+
 	return B_OK;
 }
 
@@ -796,10 +807,11 @@ Journal::_WriteTransactionToLog()
 		}
 	}
 
-	// Write log entries to disk
+	// Write log entries to disk -- all run arrays and their blocks are
+	// written with a single I/O, unless the log wraps around
 
-	int32 maxVecs = runArrays.MaxArrayLength() + 1;
-		// one extra for the index block
+	int32 maxVecs = runArrays.LogEntryLength();
+		// at most one for every block
 
 	BStackOrHeapArray<iovec, 8> vecs(maxVecs);
 	if (!vecs.IsValid()) {
@@ -807,20 +819,20 @@ Journal::_WriteTransactionToLog()
 		return B_NO_MEMORY;
 	}
 
+	int32 index = 0, count = 0;
+	int32 wrap = fLogSize - logStart;
+	uint32 blocksToPut = 0;
+	status = B_OK;
+
 	for (int32 k = 0; k < runArrays.CountArrays(); k++) {
 		run_array* array = runArrays.ArrayAt(k);
-		int32 index = 0, count = 1;
-		int32 wrap = fLogSize - logStart;
-
-		add_to_iovec(vecs, index, maxVecs, (void*)array, fVolume->BlockSize());
 
-		// add block runs
-
-		for (int32 i = 0; i < array->CountRuns(); i++) {
-			const block_run& run = array->RunAt(i);
-			off_t blockNumber = fVolume->ToBlock(run);
+		for (int32 i = -1; i < array->CountRuns(); i++) {
+			// the run array itself precedes its blocks
+			off_t blockNumber = i < 0 ? 0 : fVolume->ToBlock(array->RunAt(i));
+			int32 length = i < 0 ? 1 : array->RunAt(i).Length();
 
-			for (int32 j = 0; j < run.Length(); j++) {
+			for (int32 j = 0; j < length; j++) {
 				if (count >= wrap) {
 					// We need to write back the first half of the entry
 					// directly as the log wraps around
@@ -828,45 +840,62 @@ Journal::_WriteTransactionToLog()
 						+ (logStart << blockShift), vecs, index) < 0)
 						FATAL(("could not write log area!\n"));
 
-					logPosition = logStart + count;
 					logStart = 0;
 					wrap = fLogSize;
 					count = 0;
 					index = 0;
 				}
 
-				// make blocks available in the cache
-				const void* data = block_cache_get(fVolume->BlockCache(),
-					blockNumber + j);
-				if (data == NULL)
-					return B_IO_ERROR;
+				const void* data = array;
+				if (i >= 0) {
+					// make blocks available in the cache
+					data = block_cache_get(fVolume->BlockCache(),
+						blockNumber + j);
+					if (data == NULL) {
+						status = B_IO_ERROR;
+						break;
+					}
+					blocksToPut++;
+				}
 
 				add_to_iovec(vecs, index, maxVecs, data, fVolume->BlockSize());
 				count++;
 			}
-		}
 
-		// write back the rest of the log entry
-		if (count > 0) {
-			logPosition = logStart + count;
-			if (writev_pos(fVolume->Device(), logOffset
-					+ (logStart << blockShift), vecs, index) < 0)
-				FATAL(("could not write log area: %s!\n", strerror(errno)));
+			if (status != B_OK)
+				break;
 		}
 
-		// release blocks again
+		if (status != B_OK)
+			break;
+	}
+
+	// write back the rest of the log entry
+	if (status == B_OK && count > 0) {
+		if (writev_pos(fVolume->Device(), logOffset
+				+ (logStart << blockShift), vecs, index) < 0)
+			FATAL(("could not write log area: %s!\n", strerror(errno)));
+	}
+	logPosition = logStart + count;
+
+	// release blocks again
+	for (int32 k = 0; k < runArrays.CountArrays(); k++) {
+		run_array* array = runArrays.ArrayAt(k);
+
 		for (int32 i = 0; i < array->CountRuns(); i++) {
 			const block_run& run = array->RunAt(i);
 			off_t blockNumber = fVolume->ToBlock(run);
 
-			for (int32 j = 0; j < run.Length(); j++) {
+			for (int32 j = 0; j < run.Length() && blocksToPut > 0; j++) {
 				block_cache_put(fVolume->BlockCache(), blockNumber + j);
+				blocksToPut--;
 			}
 		}
-
-		logStart = logPosition % fLogSize;
 	}
 
+	if (status != B_OK)
+		return status;
+
 	LogEntry* logEntry = new(std::nothrow) LogEntry(this, fVolume->LogEnd(),
 		runArrays.LogEntryLength());
 	if (logEntry == NULL) {
@@ -966,6 +995,58 @@ Journal::FlushLogAndBlocks()
 }
 
 
+/*!	Makes sure all transactions that have been completed before this call
+	are safely stored in the log, without writing back the blocks themselves.
+
+	Callers arriving while the log is being written join the next log write,
+	so that concurrent syncs (as many threads calling fsync() do) are written
+	with a single log entry, and a single drive cache flush, and are
+	acknowledged together.
+*/
+status_t
+Journal::SyncLog()
+{
+	MutexLocker locker(fSyncLock);
+
+	// A log write that is already in progress might not contain the
+	// transactions of the caller anymore, so we have to wait for the
+	// one after it.
+	int64 generation = fSyncGeneration + (fSyncing ? 2 : 1);
+
+	while (fSyncGeneration < generation) {
+		if (!fSyncing) {
+			// nobody is writing the log right now, so it's our turn
+			fSyncing = true;
+			locker.Unlock();
+
+			status_t status = _FlushLog(true, false);
+
+			locker.Lock();
+			fSyncing = false;
+			fSyncGeneration++;
+			fSyncStatus = status;
+
+			if (fSyncWaiters > 0) {
+				release_sem_etc(fSyncWaitSem, fSyncWaiters,
+					B_DO_NOT_RESCHEDULE);
+				fSyncWaiters = 0;
+			}
+			continue;
+		}
+
+		// wait for the current log write to finish
+		fSyncWaiters++;
+		locker.Unlock();
+
+		acquire_sem(fSyncWaitSem);
+
+		locker.Lock();
+	}
+
+	return fSyncStatus;
+}
+
+
 status_t
 Journal::Lock(Transaction* owner, bool separateSubTransactions)
 {
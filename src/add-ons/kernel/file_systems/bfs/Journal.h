@@ -36,6 +36,7 @@ public:
 			bool			CurrentTransactionTooLarge() const;
 
 			status_t		FlushLogAndBlocks();
+			status_t		SyncLog();
 			Volume*			GetVolume() const { return fVolume; }
 			int32			TransactionID() const { return fTransactionID; }
 
@@ -79,6 +80,13 @@ private:
 
 			thread_id		fLogFlusher;
 			sem_id			fLogFlusherSem;
+
+			mutex			fSyncLock;
+			sem_id			fSyncWaitSem;
+			int32			fSyncWaiters;
+			int64			fSyncGeneration;
+			bool			fSyncing;
+			status_t		fSyncStatus;
 };
 
 
@@ -116,6 +116,22 @@ struct Query::QueryPolicy {
 		return score * ((2048 * 1024LL) / index.Node()->Size());
 	}
 
+	static int64 IndexGetEntryCount(Index& index)
+	{
+		// BFS doesn't keep track of the number of entries in its indices, so
+		// we estimate it from the size of the tree, assuming that about three
+		// quarters of each node are filled with keys, their lengths, and
+		// values. Strings are assumed to be 16 bytes long on average.
+		BPlusTree* tree = index.Node()->Tree();
+		size_t keySize = index.KeySize();
+		if (keySize == 0)
+			keySize = 16;
+
+		off_t nodes = index.Node()->Size() / tree->NodeSize();
+		return nodes * (tree->NodeSize() * 3 / 4)
+			/ (keySize + sizeof(uint16) + sizeof(off_t));
+	}
+
 	static type_code IndexGetType(Index& index)
 	{
 		return index.Type();
@@ -179,6 +195,11 @@ struct Query::QueryPolicy {
 		return B_OK;
 	}
 
+	static ino_t IndexIteratorGetNodeID(IndexIterator* iterator)
+	{
+		return iterator->offset;
+	}
+
 	static void IndexIteratorSkipDuplicates(IndexIterator* iterator)
 	{
 		iterator->SkipDuplicates();
@@ -846,8 +846,16 @@ bfs_fsync(fs_volume* _volume, fs_vnode* _node)
 {
 	FUNCTION();
 
+	Volume* volume = (Volume*)_volume->private_volume;
 	Inode* inode = (Inode*)_node->private_node;
-	return inode->Sync();
+
+	status_t status = inode->Sync();
+	if (status != B_OK || volume->IsReadOnly())
+		return status;
+
+	// Make sure the inode's metadata changes are in the log as well; this
+	// joins any log write already in progress for other fsync() callers.
+	return volume->GetJournal(0)->SyncLog();
 }
 
 
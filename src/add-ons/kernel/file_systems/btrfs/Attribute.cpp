@@ -147,7 +147,7 @@ status_t
 Attribute::_Lookup(const char* name, size_t nameLength,
 	btrfs_dir_entry** _entries, uint32* _length)
 {
-	uint32 hash = calculate_crc((uint32)~1, (uint8*)name, nameLength);
+	uint32 hash = calculate_crc32c((uint32)~1, (uint8*)name, nameLength);
 	struct btrfs_key key;
 	key.SetType(BTRFS_KEY_TYPE_XATTR_ITEM);
 	key.SetObjectID(fInode->ID());
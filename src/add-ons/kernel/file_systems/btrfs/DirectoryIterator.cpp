@@ -118,7 +118,7 @@ DirectoryIterator::Lookup(const char* name, size_t nameLength, ino_t* _id)
 		return fInode->FindParent(_id);
 	}
 
-	uint32 hash = calculate_crc((uint32)~1, (uint8*)name, nameLength);
+	uint32 hash = calculate_crc32c((uint32)~1, (uint8*)name, nameLength);
 	btrfs_key key;
 	key.SetType(BTRFS_KEY_TYPE_DIR_ITEM);
 	key.SetObjectID(fInode->ID());
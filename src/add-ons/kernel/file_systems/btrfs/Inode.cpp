@@ -468,7 +468,7 @@ Inode::MakeReference(Transaction& transaction, BTree::Path* path,
 		return status;
 
 	// insert dir_entry
-	uint32 hash = calculate_crc((uint32)~1, (uint8*)name, nameLength);
+	uint32 hash = calculate_crc32c((uint32)~1, (uint8*)name, nameLength);
 	btrfs_dir_entry* directoryEntry =
 		(btrfs_dir_entry*)malloc(sizeof(btrfs_dir_entry) + nameLength);
 	if (directoryEntry == NULL)
@@ -529,7 +529,7 @@ Inode::Dereference(Transaction& transaction, BTree::Path* path, ino_t parentID,
 		return status;
 
 	// remove dir_item
-	uint32 hash = calculate_crc((uint32)~1, (uint8*)name, strlen(name));
+	uint32 hash = calculate_crc32c((uint32)~1, (uint8*)name, strlen(name));
 	key.SetObjectID(parentID);
 	key.SetType(BTRFS_KEY_TYPE_DIR_ITEM);
 	key.SetOffset(hash);
@@ -502,7 +502,7 @@ Volume::FindBlock(off_t logical, off_t& physical)
 status_t
 Volume::WriteSuperBlock()
 {
-	uint32 checksum = calculate_crc((uint32)~1,
+	uint32 checksum = calculate_crc32c((uint32)~1,
 			(uint8 *)(&fSuperBlock + sizeof(fSuperBlock.checksum)),
 			sizeof(fSuperBlock) - sizeof(fSuperBlock.checksum));
 
@@ -103,6 +103,11 @@ struct Query::QueryPolicy {
 			std::min(maxFactor, std::max((int32)1, index.index->CountEntries())));
 	}
 
+	static int64 IndexGetEntryCount(Index& index)
+	{
+		return index.index->CountEntries();
+	}
+
 	static type_code IndexGetType(Index& index)
 	{
 		return index.index->Type();
@@ -161,6 +166,11 @@ struct Query::QueryPolicy {
 		return B_OK;
 	}
 
+	static ino_t IndexIteratorGetNodeID(IndexIterator* indexIterator)
+	{
+		return indexIterator->entry->ID();
+	}
+
 	static void IndexIteratorSkipDuplicates(IndexIterator* indexIterator)
 	{
 		// Nothing to do.
@@ -17,6 +17,7 @@
 #include <slab/Slab.h>
 
 #include <AutoDeleter.h>
+#include <ZstdCompressionAlgorithm.h>
 
 #include <package/hpkg/PackageFileHeapAccessorBase.h>
 
@@ -26,6 +27,7 @@
 #include "Directory.h"
 #include "Query.h"
 #include "PackageFSRoot.h"
+#include "ReadAheadQueue.h"
 #include "StringConstants.h"
 #include "StringPool.h"
 #include "Utils.h"
@@ -1086,9 +1088,23 @@ packagefs_std_ops(int32 op, ...)
 					0, /* magazine capacity, count */ 2, 1, 0, NULL,
 					NULL, NULL, NULL);
 
+			error = ReadAheadQueue::Init();
+			if (error != B_OK) {
+				ERROR("Failed to init read-ahead queue\n");
+				delete_object_cache((object_cache*)
+					PackageFileHeapAccessorBase::sChunkCache);
+				StringConstants::Cleanup();
+				StringPool::Cleanup();
+				exit_debugging();
+				return error;
+			}
+
 			error = PackageFSRoot::GlobalInit();
 			if (error != B_OK) {
 				ERROR("Failed to init PackageFSRoot\n");
+				ReadAheadQueue::Uninit();
+				delete_object_cache((object_cache*)
+					PackageFileHeapAccessorBase::sChunkCache);
 				StringConstants::Cleanup();
 				StringPool::Cleanup();
 				exit_debugging();
@@ -1102,6 +1118,8 @@ packagefs_std_ops(int32 op, ...)
 		{
 			PRINT("package_std_ops(): B_MODULE_UNINIT\n");
 			PackageFSRoot::GlobalUninit();
+			ReadAheadQueue::Uninit();
+			BZstdCompressionAlgorithm::FreeCachedContexts();
 			delete_object_cache((object_cache*)
 				PackageFileHeapAccessorBase::sChunkCache);
 			StringConstants::Cleanup();
@@ -10,11 +10,13 @@
 
 #include <DataIO.h>
 
+#include <low_resource_manager.h>
 #include <util/AutoLock.h>
 #include <vm/VMCache.h>
 #include <vm/vm_page.h>
 
 #include "DebugSupport.h"
+#include "ReadAheadQueue.h"
 
 
 using BPackageKit::BHPKG::BBufferDataReader;
@@ -82,7 +84,10 @@ CachedDataReader::CachedDataReader()
 	:
 	fReader(NULL),
 	fCache(NULL),
-	fCacheLineLockers()
+	fCacheLineLockers(),
+	fLastReadEnd(-1),
+	fReadAheadEnd(0),
+	fReadAheadLines(0)
 {
 	mutex_init(&fLock, "packagefs cached reader");
 }
@@ -90,6 +95,8 @@ CachedDataReader::CachedDataReader()
 
 CachedDataReader::~CachedDataReader()
 {
+	StopReadAhead();
+
 	if (fCache != NULL) {
 		fCache->Lock();
 		fCache->ReleaseRefAndUnlock();
@@ -135,6 +142,8 @@ CachedDataReader::ReadDataToOutput(off_t offset, size_t size,
 	if (size == 0)
 		return B_OK;
 
+	_ScheduleReadAhead(offset, size);
+
 	while (size > 0) {
 		// the start of the current cache line
 		off_t lineOffset = (offset / kCacheLineSize) * kCacheLineSize;
@@ -159,6 +168,94 @@ CachedDataReader::ReadDataToOutput(off_t offset, size_t size,
 }
 
 
+/*!	Makes sure the given cache line is in the cache. Called by the
+	ReadAheadQueue workers.
+*/
+void
+CachedDataReader::ReadAhead(off_t lineOffset)
+{
+	if (low_resource_state(B_KERNEL_RESOURCE_PAGES) != B_NO_LOW_RESOURCE
+		|| !AcquireReadAheadAccess()) {
+		return;
+	}
+
+	off_t lineEnd = std::min(lineOffset + (off_t)kCacheLineSize,
+		fCache->virtual_end);
+	_ReadCacheLine(lineOffset, lineEnd - lineOffset, lineOffset, 0, NULL);
+
+	ReleaseReadAheadAccess();
+}
+
+
+/*!	Cancels all pending read-ahead and waits for the running one. Must be
+	called before the underlying reader goes away.
+*/
+void
+CachedDataReader::StopReadAhead()
+{
+	ReadAheadQueue::Cancel(this);
+}
+
+
+/*!	Called before a read-ahead worker accesses the underlying reader. Derived
+	classes have to make sure that the reader can be used until
+	ReleaseReadAheadAccess() is called, or return \c false.
+*/
+bool
+CachedDataReader::AcquireReadAheadAccess()
+{
+	return true;
+}
+
+
+void
+CachedDataReader::ReleaseReadAheadAccess()
+{
+}
+
+
+/*!	Schedules the cache lines of the request after the first one, so that
+	they are decompressed in parallel. For sequential reads, a growing number
+	of cache lines after the request are read ahead, too.
+*/
+void
+CachedDataReader::_ScheduleReadAhead(off_t offset, size_t size)
+{
+	off_t end = offset + size;
+	off_t readAheadStart = (offset / kCacheLineSize + 1) * kCacheLineSize;
+	off_t readAheadEnd;
+
+	{
+		MutexLocker locker(fLock);
+
+		if (offset >= fLastReadEnd - (off_t)kCacheLineSize
+			&& offset <= fLastReadEnd + (off_t)kCacheLineSize) {
+			fReadAheadLines = std::min(
+				std::max(fReadAheadLines * 2, kMinReadAheadLines),
+				kMaxReadAheadLines);
+		} else {
+			fReadAheadLines = 0;
+			fReadAheadEnd = 0;
+		}
+
+		fLastReadEnd = end;
+
+		readAheadStart = std::max(readAheadStart, fReadAheadEnd);
+		readAheadEnd = (end + (off_t)fReadAheadLines * kCacheLineSize
+			+ kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+		readAheadEnd = std::min(readAheadEnd, fCache->virtual_end);
+		if (readAheadStart >= readAheadEnd)
+			return;
+		fReadAheadEnd = readAheadEnd;
+	}
+
+	for (off_t lineOffset = readAheadStart; lineOffset < readAheadEnd;
+			lineOffset += kCacheLineSize) {
+		ReadAheadQueue::Schedule(this, lineOffset);
+	}
+}
+
+
 status_t
 CachedDataReader::_ReadCacheLine(off_t lineOffset, size_t lineSize,
 	off_t requestOffset, size_t requestLength, BDataIO* output)
@@ -29,6 +29,13 @@ public:
 	virtual	status_t			ReadDataToOutput(off_t offset, size_t size,
 									BDataIO* output);
 
+			void				ReadAhead(off_t lineOffset);
+			void				StopReadAhead();
+
+protected:
+	virtual	bool				AcquireReadAheadAccess();
+	virtual	void				ReleaseReadAheadAccess();
+
 private:
 			class CacheLineLocker
 				: public DoublyLinkedListLinkImpl<CacheLineLocker> {
@@ -116,6 +123,8 @@ private:
 			struct PagesDataOutput;
 
 private:
+			void				_ScheduleReadAhead(off_t offset,
+									size_t size);
 			status_t			_ReadCacheLine(off_t lineOffset,
 									size_t lineSize, off_t requestOffset,
 							 		size_t requestLength, BDataIO* output);
@@ -137,12 +146,17 @@ private:
 			static const size_t kCacheLineSize = 64 * 1024;
 			static const size_t kPagesPerCacheLine
 				= kCacheLineSize / B_PAGE_SIZE;
+			static const uint32 kMinReadAheadLines = 2;
+			static const uint32 kMaxReadAheadLines = 16;
 
 private:
 			mutex				fLock;
 			BAbstractBufferedDataReader* fReader;
 			VMCache*			fCache;
 			LockerTable			fCacheLineLockers;
+			off_t				fLastReadEnd;
+			off_t				fReadAheadEnd;
+			uint32				fReadAheadLines;
 };
 
 
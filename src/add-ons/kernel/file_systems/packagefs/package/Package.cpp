@@ -27,6 +27,7 @@
 #include "DebugSupport.h"
 #include "PackageDirectory.h"
 #include "PackageFile.h"
+#include "PackageNodeCache.h"
 #include "PackagesDirectory.h"
 #include "PackageSettings.h"
 #include "PackageSymlink.h"
@@ -395,14 +396,17 @@ struct Package::HeapReader {
 struct Package::HeapReaderV2 : public HeapReader, public CachedDataReader,
 	private BErrorOutput, private BFdIO {
 public:
-	HeapReaderV2()
+	HeapReaderV2(Package* package)
 		:
+		fPackage(package),
 		fHeapReader(NULL)
 	{
 	}
 
 	~HeapReaderV2()
 	{
+		// the read-ahead workers use the heap reader and the FD
+		StopReadAhead();
 		delete fHeapReader;
 	}
 
@@ -437,6 +441,20 @@ public:
 			.CreatePackageDataReader(this, data.DataV2(), _reader);
 	}
 
+protected:
+	// CachedDataReader
+
+	virtual bool AcquireReadAheadAccess()
+	{
+		// only read ahead while the package file is open anyway
+		return fPackage->KeepOpen();
+	}
+
+	virtual void ReleaseReadAheadAccess()
+	{
+		fPackage->Close();
+	}
+
 private:
 	// BErrorOutput
 
@@ -446,6 +464,7 @@ private:
 	}
 
 private:
+	Package*				fPackage;
 	PackageFileHeapReader*	fHeapReader;
 };
 
@@ -454,9 +473,10 @@ private:
 
 
 struct Package::CachingPackageReader : public PackageReaderImpl {
-	CachingPackageReader(BErrorOutput* errorOutput)
+	CachingPackageReader(BErrorOutput* errorOutput, Package* package)
 		:
 		PackageReaderImpl(errorOutput),
+		fPackage(package),
 		fCachedHeapReader(NULL),
 		fFD(-1)
 	{
@@ -476,7 +496,7 @@ struct Package::CachingPackageReader : public PackageReaderImpl {
 		PackageFileHeapReader* rawHeapReader,
 		BAbstractBufferedDataReader*& _cachedReader)
 	{
-		fCachedHeapReader = new(std::nothrow) HeapReaderV2;
+		fCachedHeapReader = new(std::nothrow) HeapReaderV2(fPackage);
 		if (fCachedHeapReader == NULL)
 			RETURN_ERROR(B_NO_MEMORY);
 
@@ -503,6 +523,7 @@ struct Package::CachingPackageReader : public PackageReaderImpl {
 	}
 
 private:
+	Package*		fPackage;
 	HeapReaderV2*	fCachedHeapReader;
 	int				fFD;
 };
@@ -528,8 +549,12 @@ Package::Package(::Volume* volume, PackagesDirectory* directory, dev_t deviceID,
 	fOpenCount(0),
 	fHeapReader(NULL),
 	fNodeID(nodeID),
-	fDeviceID(deviceID)
+	fDeviceID(deviceID),
+	fFileSize(0)
 {
+	fFileModifiedTime.tv_sec = 0;
+	fFileModifiedTime.tv_nsec = 0;
+
 	mutex_init(&fLock, "packagefs package");
 
 	fPackagesDirectory->AcquireReference();
@@ -568,9 +593,9 @@ Package::Init(const char* fileName)
 
 
 status_t
-Package::Load(const PackageSettings& settings)
+Package::Load(const PackageSettings& settings, PackageNodeCache* nodeCache)
 {
-	status_t error = _Load(settings);
+	status_t error = _Load(settings, nodeCache);
 	if (error != B_OK)
 		return error;
 
@@ -682,6 +707,22 @@ Package::Open()
 }
 
 
+/*!	Like Open(), but only succeeds, if the package file is already open.
+	Returns whether the open count has been incremented; if so, the caller has
+	to call Close().
+*/
+bool
+Package::KeepOpen()
+{
+	MutexLocker locker(fLock);
+	if (fOpenCount == 0)
+		return false;
+
+	fOpenCount++;
+	return true;
+}
+
+
 void
 Package::Close()
 {
@@ -713,7 +754,7 @@ Package::CreateDataReader(const PackageData& data,
 
 
 status_t
-Package::_Load(const PackageSettings& settings)
+Package::_Load(const PackageSettings& settings, PackageNodeCache* nodeCache)
 {
 	// open package file
 	int fd = Open();
@@ -721,12 +762,20 @@ Package::_Load(const PackageSettings& settings)
 		RETURN_ERROR(fd);
 	PackageCloser packageCloser(this);
 
+	// remember the file's size and modification time -- they identify the
+	// file's version in the node cache
+	struct stat st;
+	if (fstat(fd, &st) < 0)
+		RETURN_ERROR(errno);
+	fFileSize = st.st_size;
+	fFileModifiedTime = st.st_mtim;
+
 	// initialize package reader
 	LoaderErrorOutput errorOutput(this);
 
 	// try current package file format version
 	{
-		CachingPackageReader packageReader(&errorOutput);
+		CachingPackageReader packageReader(&errorOutput, this);
 		status_t error = packageReader.Init(fd, false,
 			BHPKG::B_HPKG_READER_DONT_PRINT_VERSION_MISMATCH_MESSAGE);
 		if (error == B_OK) {
@@ -736,10 +785,27 @@ Package::_Load(const PackageSettings& settings)
 			if (error != B_OK)
 				RETURN_ERROR(error);
 
-			error = packageReader.ParseContent(&handler);
+			error = packageReader.ParsePackageAttributes(&handler);
 			if (error != B_OK)
 				RETURN_ERROR(error);
 
+			// Get the nodes from the cache, if possible. Packages with blocked
+			// entries aren't cached, though.
+			bool nodesLoaded = false;
+			if (nodeCache != NULL && settings.PackageItemFor(fName) == NULL) {
+				nodesLoaded = nodeCache->LoadNodes(this) == B_OK;
+				if (!nodesLoaded) {
+					while (PackageNode* node = fNodes.RemoveHead())
+						node->ReleaseReference();
+				}
+			}
+
+			if (!nodesLoaded) {
+				error = packageReader.ParseTOC(&handler);
+				if (error != B_OK)
+					RETURN_ERROR(error);
+			}
+
 			// get the heap reader
 			fHeapReader = packageReader.DetachCachedHeapReader();
 			return B_OK;
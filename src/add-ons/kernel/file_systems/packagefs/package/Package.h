@@ -29,6 +29,7 @@ using BPackageKit::BHPKG::BAbstractBufferedDataReader;
 
 
 class PackageLinkDirectory;
+class PackageNodeCache;
 class PackagesDirectory;
 class PackageSettings;
 class Volume;
@@ -44,7 +45,8 @@ public:
 								~Package();
 
 			status_t			Init(const char* fileName);
-			status_t			Load(const PackageSettings& settings);
+			status_t			Load(const PackageSettings& settings,
+									PackageNodeCache* nodeCache = NULL);
 
 			::Volume*			Volume() const		{ return fVolume; }
 			const String&		FileName() const	{ return fFileName; }
@@ -59,6 +61,10 @@ public:
 									{ return fDeviceID; }
 			ino_t				NodeID() const
 									{ return fNodeID; }
+			off_t				FileSize() const
+									{ return fFileSize; }
+			const timespec&		FileModifiedTime() const
+									{ return fFileModifiedTime; }
 			PackagesDirectory*	Directory() const
 									{ return fPackagesDirectory; }
 
@@ -96,6 +102,7 @@ public:
 			void				AddDependency(Dependency* dependency);
 
 			int					Open();
+			bool				KeepOpen();
 			void				Close();
 
 			status_t			CreateDataReader(const PackageData& data,
@@ -117,7 +124,8 @@ private:
 			struct CachingPackageReader;
 
 private:
-			status_t			_Load(const PackageSettings& settings);
+			status_t			_Load(const PackageSettings& settings,
+									PackageNodeCache* nodeCache);
 			bool				_InitVersionedName();
 
 private:
@@ -138,6 +146,8 @@ private:
 			Package*			fFileNameHashTableNext;
 			ino_t				fNodeID;
 			dev_t				fDeviceID;
+			off_t				fFileSize;
+			timespec			fFileModifiedTime;
 			PackageNodeList		fNodes;
 			ResolvableList		fResolvables;
 			DependencyList		fDependencies;
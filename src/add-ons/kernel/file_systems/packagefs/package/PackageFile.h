@@ -19,6 +19,8 @@ public:
 									const PackageData& data);
 	virtual						~PackageFile();
 
+			const PackageData&	Data() const	{ return fData; }
+
 	virtual	status_t			VFSInit(dev_t deviceID, ino_t nodeID);
 	virtual	void				VFSUninit();
 
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "ReadAheadQueue.h"
+
+#include <algorithm>
+#include <new>
+
+#include <AutoDeleter.h>
+#include <condition_variable.h>
+#include <low_resource_manager.h>
+#include <smp.h>
+#include <thread.h>
+#include <util/AutoLock.h>
+#include <util/DoublyLinkedList.h>
+#include <util/OpenHashTable.h>
+
+#include "CachedDataReader.h"
+#include "DebugSupport.h"
+
+
+static const int32 kMaxWorkers = 4;
+static const int32 kMaxQueuedRequests = 256;
+
+
+struct ReadAheadRequest : DoublyLinkedListLinkImpl<ReadAheadRequest> {
+	CachedDataReader*	reader;
+	off_t				lineOffset;
+	ReadAheadRequest*	hashNext;
+};
+
+typedef DoublyLinkedList<ReadAheadRequest> ReadAheadRequestList;
+
+
+struct ReadAheadRequestKey {
+	CachedDataReader*	reader;
+	off_t				lineOffset;
+};
+
+
+struct ReadAheadRequestHashDefinition {
+	typedef ReadAheadRequestKey	KeyType;
+	typedef	ReadAheadRequest	ValueType;
+
+	size_t HashKey(const ReadAheadRequestKey& key) const
+	{
+		return (size_t)key.reader / 16 + (size_t)(key.lineOffset >> 16);
+	}
+
+	size_t Hash(const ReadAheadRequest* value) const
+	{
+		ReadAheadRequestKey key = { value->reader, value->lineOffset };
+		return HashKey(key);
+	}
+
+	bool Compare(const ReadAheadRequestKey& key,
+		const ReadAheadRequest* value) const
+	{
+		return value->reader == key.reader
+			&& value->lineOffset == key.lineOffset;
+	}
+
+	ReadAheadRequest*& GetLink(ReadAheadRequest* value) const
+	{
+		return value->hashNext;
+	}
+};
+
+typedef BOpenHashTable<ReadAheadRequestHashDefinition> ReadAheadRequestTable;
+
+
+struct ReadAheadState {
+	mutex					lock;
+	ConditionVariable		workCondition;
+	ConditionVariable		idleCondition;
+	ReadAheadRequestList	queue;
+	ReadAheadRequestTable	requests;
+	int32					queuedCount;
+	thread_id				workers[kMaxWorkers];
+	CachedDataReader*		activeReaders[kMaxWorkers];
+	int32					workerCount;
+	bool					quitting;
+};
+
+
+static ReadAheadState* sState = NULL;
+
+
+/*static*/ status_t
+ReadAheadQueue::Init()
+{
+	sState = new(std::nothrow) ReadAheadState;
+	if (sState == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	status_t error = sState->requests.Init();
+	if (error != B_OK) {
+		delete sState;
+		sState = NULL;
+		RETURN_ERROR(error);
+	}
+
+	mutex_init(&sState->lock, "packagefs read-ahead");
+	sState->workCondition.Init(sState, "packagefs read-ahead work");
+	sState->idleCondition.Init(sState->activeReaders,
+		"packagefs read-ahead idle");
+	sState->queuedCount = 0;
+	sState->workerCount = 0;
+	sState->quitting = false;
+
+	// Decompression is CPU bound, so one worker per CPU makes sense, but a
+	// few of them are enough to stay ahead of a reader.
+	int32 workerCount = std::min((int32)smp_get_num_cpus(), kMaxWorkers);
+	for (int32 i = 0; i < workerCount; i++) {
+		thread_id thread = spawn_kernel_thread(&_Worker,
+			"packagefs read-ahead", B_NORMAL_PRIORITY, (void*)(addr_t)i);
+		if (thread < 0)
+			break;
+
+		sState->workers[i] = thread;
+		sState->activeReaders[i] = NULL;
+		sState->workerCount++;
+		resume_thread(thread);
+	}
+
+	error = register_low_resource_handler(&_LowResourceHandler, NULL,
+		B_KERNEL_RESOURCE_PAGES, 0);
+	if (error != B_OK) {
+		Uninit();
+		RETURN_ERROR(error);
+	}
+
+	return B_OK;
+}
+
+
+/*static*/ void
+ReadAheadQueue::Uninit()
+{
+	if (sState == NULL)
+		return;
+
+	unregister_low_resource_handler(&_LowResourceHandler, NULL);
+
+	mutex_lock(&sState->lock);
+	sState->quitting = true;
+	_MakeEmpty(NULL);
+	sState->workCondition.NotifyAll();
+	mutex_unlock(&sState->lock);
+
+	for (int32 i = 0; i < sState->workerCount; i++)
+		wait_for_thread(sState->workers[i], NULL);
+
+	mutex_destroy(&sState->lock);
+	delete sState;
+	sState = NULL;
+}
+
+
+/*static*/ void
+ReadAheadQueue::Schedule(CachedDataReader* reader, off_t lineOffset)
+{
+	if (sState == NULL || sState->workerCount == 0
+		|| low_resource_state(B_KERNEL_RESOURCE_PAGES) != B_NO_LOW_RESOURCE) {
+		return;
+	}
+
+	// Allocate the request before locking, as the low resource handler needs
+	// the lock, too.
+	ObjectDeleter<ReadAheadRequest> request(
+		new(std::nothrow) ReadAheadRequest);
+	if (!request.IsSet())
+		return;
+
+	MutexLocker locker(sState->lock);
+
+	if (sState->quitting || sState->queuedCount >= kMaxQueuedRequests)
+		return;
+
+	ReadAheadRequestKey key = { reader, lineOffset };
+	if (sState->requests.Lookup(key) != NULL)
+		return;
+
+	request->reader = reader;
+	request->lineOffset = lineOffset;
+	sState->queue.Add(request.Get());
+	sState->requests.Insert(request.Detach());
+	sState->queuedCount++;
+
+	sState->workCondition.NotifyOne();
+}
+
+
+/*static*/ void
+ReadAheadQueue::Cancel(CachedDataReader* reader)
+{
+	if (sState == NULL)
+		return;
+
+	MutexLocker locker(sState->lock);
+
+	_MakeEmpty(reader);
+
+	while (true) {
+		bool active = false;
+		for (int32 i = 0; i < sState->workerCount; i++)
+			active |= sState->activeReaders[i] == reader;
+		if (!active)
+			break;
+
+		sState->idleCondition.Wait(&sState->lock);
+	}
+}
+
+
+/*static*/ status_t
+ReadAheadQueue::_Worker(void* data)
+{
+	int32 index = (addr_t)data;
+
+	MutexLocker locker(sState->lock);
+
+	while (!sState->quitting) {
+		ReadAheadRequest* request = sState->queue.RemoveHead();
+		if (request == NULL) {
+			sState->workCondition.Wait(&sState->lock);
+			continue;
+		}
+
+		sState->requests.Remove(request);
+		sState->queuedCount--;
+
+		CachedDataReader* reader = request->reader;
+		off_t lineOffset = request->lineOffset;
+		delete request;
+
+		sState->activeReaders[index] = reader;
+		locker.Unlock();
+
+		reader->ReadAhead(lineOffset);
+
+		locker.Lock();
+		sState->activeReaders[index] = NULL;
+		sState->idleCondition.NotifyAll();
+	}
+
+	return B_OK;
+}
+
+
+/*static*/ void
+ReadAheadQueue::_LowResourceHandler(void* data, uint32 resources,
+	int32 level)
+{
+	if (level == B_NO_LOW_RESOURCE || level == B_LOW_RESOURCE_NOTE)
+		return;
+
+	// the pages are better spent on data that has actually been asked for
+	MutexLocker locker(sState->lock);
+	_MakeEmpty(NULL);
+}
+
+
+/*!	Removes all queued requests of the given reader, or all of them, if
+	\a reader is \c NULL. The lock must be held.
+*/
+/*static*/ void
+ReadAheadQueue::_MakeEmpty(CachedDataReader* reader)
+{
+	ReadAheadRequestList::Iterator it = sState->queue.GetIterator();
+	while (ReadAheadRequest* request = it.Next()) {
+		if (reader != NULL && request->reader != reader)
+			continue;
+
+		it.Remove();
+		sState->requests.Remove(request);
+		sState->queuedCount--;
+		delete request;
+	}
+}
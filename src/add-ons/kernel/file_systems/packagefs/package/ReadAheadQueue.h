@@ -0,0 +1,41 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef READ_AHEAD_QUEUE_H
+#define READ_AHEAD_QUEUE_H
+
+
+#include <SupportDefs.h>
+
+
+class CachedDataReader;
+
+
+/*!	A global pool of worker threads that read and decompress heap cache lines
+	ahead of time, so that the chunks a reader is going to need next are
+	decompressed in parallel, while it is still busy with the current one.
+
+	Read-ahead is best effort: requests are dropped when the queue is full or
+	memory is getting low.
+*/
+class ReadAheadQueue {
+public:
+	static	status_t			Init();
+	static	void				Uninit();
+
+	static	void				Schedule(CachedDataReader* reader,
+									off_t lineOffset);
+	static	void				Cancel(CachedDataReader* reader);
+									// waits until no worker uses the reader
+									// anymore
+
+private:
+	static	status_t			_Worker(void* data);
+	static	void				_LowResourceHandler(void* data,
+									uint32 resources, int32 level);
+	static	void				_MakeEmpty(CachedDataReader* reader);
+};
+
+
+#endif	// READ_AHEAD_QUEUE_H
@@ -11,12 +11,20 @@
 
 static const size_t kInitialStringTableSize = 128;
 
-static char sStringsBuffer[sizeof(StringDataHash)];
+// The pool is split into stripes by hash, each with its own lock, so that
+// threads loading packages in parallel don't contend for a single lock.
+static const uint32 kStripeCount = 16;
 
 StringData StringData::fEmptyString(StringDataKey("", 0));
 
-mutex StringPool::sLock;
-StringDataHash* StringPool::sStrings;
+
+struct StringPool::Stripe {
+	mutex			lock;
+	StringDataHash	strings;
+};
+
+
+StringPool::Stripe* StringPool::sStripes;
 
 
 // #pragma mark - StringData
@@ -35,18 +43,24 @@ StringData::Init()
 /*static*/ status_t
 StringPool::Init()
 {
-	sStrings = new(sStringsBuffer) StringDataHash;
-	status_t error = sStrings->Init(kInitialStringTableSize);
-	if (error != B_OK) {
-		sStrings->~StringDataHash();
-		sStrings = NULL;
-		return error;
+	sStripes = new(std::nothrow) Stripe[kStripeCount];
+	if (sStripes == NULL)
+		return B_NO_MEMORY;
+
+	for (uint32 i = 0; i < kStripeCount; i++) {
+		status_t error = sStripes[i].strings.Init(kInitialStringTableSize);
+		if (error != B_OK) {
+			delete[] sStripes;
+			sStripes = NULL;
+			return error;
+		}
+
+		mutex_init(&sStripes[i].lock, "string pool");
 	}
 
-	mutex_init(&sLock, "string pool");
-
 	StringData::Init();
-	sStrings->Insert(StringData::Empty());
+	_StripeFor(StringData::Empty()->Hash()).strings.Insert(
+		StringData::Empty());
 
 	return B_OK;
 }
@@ -55,25 +69,44 @@ StringPool::Init()
 /*static*/ void
 StringPool::Cleanup()
 {
-	sStrings->Remove(StringData::Empty());
+	_StripeFor(StringData::Empty()->Hash()).strings.Remove(
+		StringData::Empty());
+
+	for (uint32 i = 0; i < kStripeCount; i++)
+		mutex_destroy(&sStripes[i].lock);
+
+	delete[] sStripes;
+	sStripes = NULL;
+}
 
-	sStrings->~StringDataHash();
-	sStrings = NULL;
 
-	mutex_destroy(&sLock);
+/*static*/ inline StringPool::Stripe&
+StringPool::_StripeFor(uint32 hash)
+{
+	// The string hash shifts by only four bits per character, so its high
+	// bits are zero for short names, and its low bits select the bucket
+	// within the stripe's table. Mix all of them before picking the stripe
+	// (this is the finalizer of MurmurHash3).
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+
+	return sStripes[hash % kStripeCount];
 }
 
 
 /*static*/ inline StringData*
-StringPool::_GetLocked(const StringDataKey& key)
+StringPool::_GetLocked(Stripe& stripe, const StringDataKey& key)
 {
-	if (StringData* string = sStrings->Lookup(key)) {
+	if (StringData* string = stripe.strings.Lookup(key)) {
 		if (!string->AcquireReference())
 			return string;
 
 		// The object was fully dereferenced and will be deleted. Remove it
 		// from the hash table, so it isn't in the way.
-		sStrings->Remove(string);
+		stripe.strings.Remove(string);
 	}
 
 	return NULL;
@@ -83,9 +116,11 @@ StringPool::_GetLocked(const StringDataKey& key)
 /*static*/ StringData*
 StringPool::Get(const char* string, size_t length)
 {
-	MutexLocker locker(sLock);
 	StringDataKey key(string, length);
-	StringData* data = _GetLocked(key);
+	Stripe& stripe = _StripeFor(key.Hash());
+
+	MutexLocker locker(stripe.lock);
+	StringData* data = _GetLocked(stripe, key);
 	if (data != NULL)
 		return data;
 
@@ -97,14 +132,14 @@ StringPool::Get(const char* string, size_t length)
 
 	locker.Lock();
 
-	data = _GetLocked(key);
+	data = _GetLocked(stripe, key);
 	if (data != NULL) {
 		locker.Unlock();
 		newString->Delete();
 		return data;
 	}
 
-	sStrings->Insert(newString);
+	stripe.strings.Insert(newString);
 	return newString;
 }
 
@@ -112,8 +147,10 @@ StringPool::Get(const char* string, size_t length)
 /*static*/ void
 StringPool::LastReferenceReleased(StringData* data)
 {
-	MutexLocker locker(sLock);
-	sStrings->Remove(data);
+	Stripe& stripe = _StripeFor(data->Hash());
+
+	MutexLocker locker(stripe.lock);
+	stripe.strings.Remove(data);
 	locker.Unlock();
 	data->Delete();
 }
@@ -127,20 +164,27 @@ StringPool::DumpUsageStatistics()
 	size_t totalStringSize = 0;
 	size_t totalStringSizeWithDuplicates = 0;
 
-	MutexLocker locker(sLock);
-	for (StringDataHash::Iterator it = sStrings->GetIterator(); it.HasNext();) {
-		StringData* data = it.Next();
-		int32 referenceCount = data->CountReferences();
-		totalReferenceCount += referenceCount;
-		if (referenceCount == 1)
-			unsharedStringCount++;
-
-		size_t stringSize = strlen(data->String() + 1);
-		totalStringSize += stringSize;
-		totalStringSizeWithDuplicates += stringSize * referenceCount;
+	size_t stringCount = 0;
+	for (uint32 i = 0; i < kStripeCount; i++) {
+		Stripe& stripe = sStripes[i];
+		MutexLocker locker(stripe.lock);
+
+		for (StringDataHash::Iterator it = stripe.strings.GetIterator();
+				it.HasNext();) {
+			StringData* data = it.Next();
+			int32 referenceCount = data->CountReferences();
+			totalReferenceCount += referenceCount;
+			if (referenceCount == 1)
+				unsharedStringCount++;
+
+			size_t stringSize = strlen(data->String() + 1);
+			totalStringSize += stringSize;
+			totalStringSizeWithDuplicates += stringSize * referenceCount;
+		}
+
+		stringCount += stripe.strings.CountElements();
 	}
 
-	size_t stringCount = sStrings->CountElements();
 	size_t overhead = stringCount * (sizeof(StringData) - 1);
 
 	INFORM("StringPool usage:\n");
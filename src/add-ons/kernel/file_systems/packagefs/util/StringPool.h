@@ -68,11 +68,15 @@ public:
 	static	void				DumpUsageStatistics();
 
 private:
-	static	StringData*			_GetLocked(const StringDataKey& key);
+			struct Stripe;
 
 private:
-	static	mutex				sLock;
-	static	StringDataHash*		sStrings;
+	static	StringData*			_GetLocked(Stripe& stripe,
+									const StringDataKey& key);
+	static	Stripe&				_StripeFor(uint32 hash);
+
+private:
+	static	Stripe*				sStripes;
 };
 
 
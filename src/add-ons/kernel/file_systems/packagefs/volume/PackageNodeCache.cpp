@@ -0,0 +1,844 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "PackageNodeCache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <new>
+
+#include <AutoDeleter.h>
+#include <AutoDeleterPosix.h>
+#include <PackagesDirectoryDefs.h>
+#include <syscalls.h>
+#include <util/OpenHashTable.h>
+
+#include "DebugSupport.h"
+#include "PackageDirectory.h"
+#include "PackageFile.h"
+#include "PackagesDirectory.h"
+#include "PackageSettings.h"
+#include "PackageSymlink.h"
+
+
+static const char* const kNodeCacheFilePath
+	= PACKAGES_DIRECTORY_ADMIN_DIRECTORY "/packagefs-node-cache";
+static const char* const kNodeCacheTempFilePath
+	= PACKAGES_DIRECTORY_ADMIN_DIRECTORY "/packagefs-node-cache.tmp";
+
+static const uint32 kNodeCacheMagic = 'pfnc';
+static const uint32 kNodeCacheVersion = 1;
+
+// sanity limits
+static const size_t kMaxNodeCacheSize = 256 * 1024 * 1024;
+static const uint32 kMaxNodeDepth = 256;
+
+
+// #pragma mark - file format
+
+
+/*!	The cache file consists of the header, the package table sorted by file
+	name, the node table, the attribute table, and the string table, in this
+	order. The data is stored in host byte order; the cache never leaves the
+	machine that wrote it.
+
+	The nodes of a package are stored in pre-order, each with its depth in the
+	package tree. The parent of a node is the last directory before it with a
+	depth one less than its own. A node's attributes follow those of the
+	previous node in the attribute table.
+*/
+struct PackageNodeCache::CacheHeader {
+	uint32	magic;
+	uint32	version;
+	uint32	dataSize;
+		// sizeof(PackageDataV2), guards against layout changes
+	uint32	packageCount;
+	uint64	nodeCount;
+	uint64	attributeCount;
+	uint64	stringsSize;
+};
+
+
+struct PackageNodeCache::CachePackage {
+	uint32	fileName;
+	uint32	maxDepth;
+	int64	deviceID;
+	int64	nodeID;
+	int64	fileSize;
+	int64	modifiedTimeSeconds;
+	int64	modifiedTimeNanoSeconds;
+	uint64	firstNode;
+	uint64	nodeCount;
+	uint64	firstAttribute;
+	uint64	attributeCount;
+};
+
+
+struct PackageNodeCache::CacheNode {
+	uint32	name;
+	uint32	depth;
+	uint32	mode;
+	uint32	attributeCount;
+	int64	modifiedTimeSeconds;
+	int64	modifiedTimeNanoSeconds;
+	uint32	symlinkPath;
+	uint32	reserved;
+	uint8	data[sizeof(PackageDataV2)];
+};
+
+
+struct PackageNodeCache::CacheAttribute {
+	uint32	name;
+	uint32	type;
+	uint8	data[sizeof(PackageDataV2)];
+};
+
+
+// #pragma mark - Buffer
+
+
+struct PackageNodeCache::Buffer {
+	Buffer()
+		:
+		data(NULL),
+		size(0),
+		capacity(0)
+	{
+	}
+
+	~Buffer()
+	{
+		free(data);
+	}
+
+	status_t Append(const void* buffer, size_t length)
+	{
+		if (size + length > capacity) {
+			size_t newCapacity = capacity > 0 ? capacity * 2 : 64 * 1024;
+			while (newCapacity < size + length)
+				newCapacity *= 2;
+			if (newCapacity > kMaxNodeCacheSize)
+				return B_BUFFER_OVERFLOW;
+
+			uint8* newData = (uint8*)realloc(data, newCapacity);
+			if (newData == NULL)
+				return B_NO_MEMORY;
+
+			data = newData;
+			capacity = newCapacity;
+		}
+
+		memcpy(data + size, buffer, length);
+		size += length;
+		return B_OK;
+	}
+
+	uint8*	data;
+	size_t	size;
+	size_t	capacity;
+};
+
+
+// #pragma mark - StringTable
+
+
+/*!	Collects the strings of the cache file. Since packagefs strings are unique
+	in the string pool, they can be told apart by their data pointer.
+*/
+struct PackageNodeCache::StringTable {
+	struct Entry {
+		const char*	string;
+		uint32		offset;
+		Entry*		next;
+	};
+
+	struct EntryHashDefinition {
+		typedef const char*	KeyType;
+		typedef	Entry		ValueType;
+
+		size_t HashKey(const char* key) const
+		{
+			return (addr_t)key / 8;
+		}
+
+		size_t Hash(const Entry* value) const
+		{
+			return HashKey(value->string);
+		}
+
+		bool Compare(const char* key, const Entry* value) const
+		{
+			return value->string == key;
+		}
+
+		Entry*& GetLink(Entry* value) const
+		{
+			return value->next;
+		}
+	};
+
+	~StringTable()
+	{
+		Entry* entry = fEntries.Clear(true);
+		while (entry != NULL) {
+			Entry* next = entry->next;
+			delete entry;
+			entry = next;
+		}
+	}
+
+	status_t Init()
+	{
+		status_t error = fEntries.Init();
+		if (error != B_OK)
+			return error;
+
+		// offset 0 is the empty string
+		return fBuffer.Append("", 1);
+	}
+
+	status_t Add(const String& string, uint32& _offset)
+	{
+		if (string.IsEmpty()) {
+			_offset = 0;
+			return B_OK;
+		}
+
+		Entry* entry = fEntries.Lookup(string.Data());
+		if (entry != NULL) {
+			_offset = entry->offset;
+			return B_OK;
+		}
+
+		entry = new(std::nothrow) Entry;
+		if (entry == NULL)
+			return B_NO_MEMORY;
+
+		entry->string = string.Data();
+		entry->offset = fBuffer.size;
+
+		status_t error = fBuffer.Append(entry->string,
+			strlen(entry->string) + 1);
+		if (error != B_OK) {
+			delete entry;
+			return error;
+		}
+
+		fEntries.Insert(entry);
+		_offset = entry->offset;
+		return B_OK;
+	}
+
+	const Buffer& Data() const
+	{
+		return fBuffer;
+	}
+
+private:
+	BOpenHashTable<EntryHashDefinition>	fEntries;
+	Buffer								fBuffer;
+};
+
+
+// #pragma mark - Writer
+
+
+struct PackageNodeCache::Writer {
+	Writer()
+		:
+		nodeCount(0),
+		attributeCount(0),
+		maxDepth(0)
+	{
+	}
+
+	Buffer		nodes;
+	Buffer		attributes;
+	StringTable	strings;
+	uint64		nodeCount;
+	uint64		attributeCount;
+	uint32		maxDepth;
+};
+
+
+// #pragma mark - PackageNodeCache
+
+
+static int
+compare_package_file_names(const void* a, const void* b)
+{
+	return strcmp((*(Package**)a)->FileName(), (*(Package**)b)->FileName());
+}
+
+
+PackageNodeCache::PackageNodeCache()
+	:
+	fData(NULL),
+	fSize(0),
+	fHeader(NULL),
+	fPackages(NULL),
+	fNodes(NULL),
+	fAttributes(NULL),
+	fStrings(NULL),
+	fHitCount(0),
+	fMissCount(0)
+{
+}
+
+
+PackageNodeCache::~PackageNodeCache()
+{
+	Unset();
+}
+
+
+/*!	Reads the cache file of the given packages directory, if there is a valid
+	one. Even if this fails, the object can be used; it will just not find
+	any packages.
+*/
+status_t
+PackageNodeCache::Init(PackagesDirectory* directory)
+{
+	Unset();
+	fHitCount = 0;
+	fMissCount = 0;
+
+	FileDescriptorCloser fd(openat(directory->DirectoryFD(),
+		kNodeCacheFilePath, O_RDONLY));
+	if (!fd.IsSet())
+		return errno;
+
+	struct stat st;
+	if (fstat(fd.Get(), &st) != 0)
+		RETURN_ERROR(errno);
+
+	if (st.st_size < (off_t)sizeof(CacheHeader)
+		|| st.st_size > (off_t)kMaxNodeCacheSize) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	uint8* data = (uint8*)malloc(st.st_size);
+	if (data == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	MemoryDeleter dataDeleter(data);
+
+	ssize_t bytesRead = read(fd.Get(), data, st.st_size);
+	if (bytesRead < 0)
+		RETURN_ERROR(errno);
+	if (bytesRead != st.st_size)
+		RETURN_ERROR(B_ERROR);
+
+	// check the header and the table sizes
+	const CacheHeader* header = (const CacheHeader*)data;
+	if (header->magic != kNodeCacheMagic
+		|| header->version != kNodeCacheVersion
+		|| header->dataSize != sizeof(PackageDataV2)) {
+		INFORM("Ignoring packagefs node cache of another version.\n");
+		return B_MISMATCHED_VALUES;
+	}
+
+	uint64 size = st.st_size;
+	if (header->packageCount > size / sizeof(CachePackage)
+		|| header->nodeCount > size / sizeof(CacheNode)
+		|| header->attributeCount > size / sizeof(CacheAttribute)
+		|| header->stringsSize == 0 || header->stringsSize > size) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	uint64 packagesOffset = sizeof(CacheHeader);
+	uint64 nodesOffset = packagesOffset
+		+ header->packageCount * sizeof(CachePackage);
+	uint64 attributesOffset = nodesOffset
+		+ header->nodeCount * sizeof(CacheNode);
+	uint64 stringsOffset = attributesOffset
+		+ header->attributeCount * sizeof(CacheAttribute);
+	if (stringsOffset + header->stringsSize != size
+		|| data[size - 1] != '\0') {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	fData = (uint8*)dataDeleter.Detach();
+	fSize = size;
+	fHeader = header;
+	fPackages = (const CachePackage*)(fData + packagesOffset);
+	fNodes = (const CacheNode*)(fData + nodesOffset);
+	fAttributes = (const CacheAttribute*)(fData + attributesOffset);
+	fStrings = (const char*)fData + stringsOffset;
+
+	return B_OK;
+}
+
+
+void
+PackageNodeCache::Unset()
+{
+	free(fData);
+	fData = NULL;
+	fSize = 0;
+	fHeader = NULL;
+	fPackages = NULL;
+	fNodes = NULL;
+	fAttributes = NULL;
+	fStrings = NULL;
+}
+
+
+/*!	Creates the nodes of the given package from the cache and adds them to
+	it. Returns \c B_ENTRY_NOT_FOUND, if the package is not cached or its file
+	has changed. On error, nodes may already have been added to the package.
+*/
+status_t
+PackageNodeCache::LoadNodes(Package* package)
+{
+	const CachePackage* cachePackage = _FindPackage(package->FileName());
+	if (cachePackage == NULL
+		|| cachePackage->deviceID != package->DeviceID()
+		|| cachePackage->nodeID != package->NodeID()
+		|| cachePackage->fileSize != package->FileSize()
+		|| cachePackage->modifiedTimeSeconds
+			!= package->FileModifiedTime().tv_sec
+		|| cachePackage->modifiedTimeNanoSeconds
+			!= package->FileModifiedTime().tv_nsec) {
+		atomic_add(&fMissCount, 1);
+		return B_ENTRY_NOT_FOUND;
+	}
+
+	if (cachePackage->firstNode > fHeader->nodeCount
+		|| cachePackage->nodeCount
+			> fHeader->nodeCount - cachePackage->firstNode
+		|| cachePackage->firstAttribute > fHeader->attributeCount
+		|| cachePackage->attributeCount
+			> fHeader->attributeCount - cachePackage->firstAttribute
+		|| cachePackage->maxDepth > kMaxNodeDepth) {
+		atomic_add(&fMissCount, 1);
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	// the directories on the path to the current node
+	PackageDirectory** directories = (PackageDirectory**)malloc(
+		sizeof(PackageDirectory*) * (cachePackage->maxDepth + 1));
+	if (directories == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	MemoryDeleter directoriesDeleter(directories);
+	uint32 pathDepth = 0;
+
+	const CacheNode* cacheNode = fNodes + cachePackage->firstNode;
+	const CacheNode* nodesEnd = cacheNode + cachePackage->nodeCount;
+	const CacheAttribute* attribute
+		= fAttributes + cachePackage->firstAttribute;
+	const CacheAttribute* attributesEnd
+		= attribute + cachePackage->attributeCount;
+
+	for (; cacheNode < nodesEnd; cacheNode++) {
+		if (cacheNode->depth > pathDepth
+			|| cacheNode->depth > cachePackage->maxDepth
+			|| cacheNode->attributeCount > (size_t)(attributesEnd - attribute)) {
+			atomic_add(&fMissCount, 1);
+			RETURN_ERROR(B_BAD_DATA);
+		}
+
+		PackageDirectory* parent = cacheNode->depth > 0
+			? directories[cacheNode->depth - 1] : NULL;
+
+		PackageNode* node;
+		status_t error = _CreateNode(package, *cacheNode, parent, attribute,
+			node);
+		if (error != B_OK) {
+			atomic_add(&fMissCount, 1);
+			RETURN_ERROR(error);
+		}
+		BReference<PackageNode> nodeReference(node, true);
+
+		if (parent != NULL)
+			parent->AddChild(node);
+		else
+			package->AddNode(node);
+
+		pathDepth = cacheNode->depth;
+		if (PackageDirectory* directory = dynamic_cast<PackageDirectory*>(
+				node)) {
+			directories[pathDepth++] = directory;
+		}
+	}
+
+	atomic_add(&fHitCount, 1);
+	return B_OK;
+}
+
+
+bool
+PackageNodeCache::NeedsStore() const
+{
+	return fMissCount > 0
+		|| fHitCount != (fHeader != NULL ? (int32)fHeader->packageCount : 0);
+}
+
+
+/*!	Writes a new cache file with the nodes of the given packages. The file is
+	written under a temporary name first and then renamed, so that a crash
+	cannot leave a truncated cache behind.
+*/
+status_t
+PackageNodeCache::Store(PackagesDirectory* directory,
+	const PackageFileNameHashTable& packages, const PackageSettings& settings)
+{
+	// collect the cacheable packages, sorted by file name
+	uint32 packageCount = 0;
+	for (PackageFileNameHashTable::Iterator it = packages.GetIterator();
+			Package* package = it.Next();) {
+		if (settings.PackageItemFor(package->Name()) == NULL)
+			packageCount++;
+	}
+
+	Package** sortedPackages = (Package**)malloc(
+		sizeof(Package*) * (packageCount + 1));
+	if (sortedPackages == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	MemoryDeleter sortedPackagesDeleter(sortedPackages);
+
+	uint32 index = 0;
+	for (PackageFileNameHashTable::Iterator it = packages.GetIterator();
+			Package* package = it.Next();) {
+		if (settings.PackageItemFor(package->Name()) == NULL)
+			sortedPackages[index++] = package;
+	}
+
+	qsort(sortedPackages, packageCount, sizeof(Package*),
+		&compare_package_file_names);
+
+	// serialize the packages
+	CachePackage* cachePackages = (CachePackage*)calloc(packageCount + 1,
+		sizeof(CachePackage));
+	if (cachePackages == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	MemoryDeleter cachePackagesDeleter(cachePackages);
+
+	Writer writer;
+	status_t error = writer.strings.Init();
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	for (uint32 i = 0; i < packageCount; i++) {
+		Package* package = sortedPackages[i];
+		CachePackage& cachePackage = cachePackages[i];
+
+		error = writer.strings.Add(package->FileName(), cachePackage.fileName);
+		if (error != B_OK)
+			RETURN_ERROR(error);
+
+		cachePackage.deviceID = package->DeviceID();
+		cachePackage.nodeID = package->NodeID();
+		cachePackage.fileSize = package->FileSize();
+		cachePackage.modifiedTimeSeconds = package->FileModifiedTime().tv_sec;
+		cachePackage.modifiedTimeNanoSeconds
+			= package->FileModifiedTime().tv_nsec;
+		cachePackage.firstNode = writer.nodeCount;
+		cachePackage.firstAttribute = writer.attributeCount;
+
+		writer.maxDepth = 0;
+		error = _WritePackage(writer, package);
+		if (error != B_OK)
+			RETURN_ERROR(error);
+
+		cachePackage.maxDepth = writer.maxDepth;
+		cachePackage.nodeCount = writer.nodeCount - cachePackage.firstNode;
+		cachePackage.attributeCount
+			= writer.attributeCount - cachePackage.firstAttribute;
+	}
+
+	CacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = kNodeCacheMagic;
+	header.version = kNodeCacheVersion;
+	header.dataSize = sizeof(PackageDataV2);
+	header.packageCount = packageCount;
+	header.nodeCount = writer.nodeCount;
+	header.attributeCount = writer.attributeCount;
+	header.stringsSize = writer.strings.Data().size;
+
+	// write the file
+	int dirFD = directory->DirectoryFD();
+	FileDescriptorCloser fd(openat(dirFD, kNodeCacheTempFilePath,
+		O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH));
+	if (!fd.IsSet())
+		RETURN_ERROR(errno);
+
+	error = _WriteFile(fd.Get(), &header, sizeof(header));
+	if (error == B_OK) {
+		error = _WriteFile(fd.Get(), cachePackages,
+			packageCount * sizeof(CachePackage));
+	}
+	if (error == B_OK)
+		error = _WriteFile(fd.Get(), writer.nodes.data, writer.nodes.size);
+	if (error == B_OK) {
+		error = _WriteFile(fd.Get(), writer.attributes.data,
+			writer.attributes.size);
+	}
+	if (error == B_OK) {
+		error = _WriteFile(fd.Get(), writer.strings.Data().data,
+			writer.strings.Data().size);
+	}
+	if (error == B_OK && fsync(fd.Get()) != 0)
+		error = errno;
+
+	fd.Unset();
+
+	if (error == B_OK)
+		error = _kern_rename(dirFD, kNodeCacheTempFilePath, dirFD,
+			kNodeCacheFilePath);
+
+	if (error != B_OK) {
+		unlinkat(dirFD, kNodeCacheTempFilePath, 0);
+		RETURN_ERROR(error);
+	}
+
+	INFORM("Stored packagefs node cache: %" B_PRIu32 " packages, %" B_PRIu64
+		" nodes\n", packageCount, writer.nodeCount);
+	return B_OK;
+}
+
+
+const PackageNodeCache::CachePackage*
+PackageNodeCache::_FindPackage(const char* fileName) const
+{
+	if (fHeader == NULL)
+		return NULL;
+
+	uint32 lower = 0;
+	uint32 upper = fHeader->packageCount;
+	while (lower < upper) {
+		uint32 mid = (lower + upper) / 2;
+		const char* name = _StringAt(fPackages[mid].fileName);
+		if (name == NULL)
+			return NULL;
+
+		int compare = strcmp(fileName, name);
+		if (compare == 0)
+			return &fPackages[mid];
+		if (compare < 0)
+			upper = mid;
+		else
+			lower = mid + 1;
+	}
+
+	return NULL;
+}
+
+
+const char*
+PackageNodeCache::_StringAt(uint32 offset) const
+{
+	// the string table is null-terminated, so any offset within it is fine
+	if (offset >= fHeader->stringsSize)
+		return NULL;
+	return fStrings + offset;
+}
+
+
+/*!	Creates a node and its attributes from the cache. \a attribute is the
+	node's first attribute and is advanced past its last one. On success, the
+	caller gets the node's initial reference.
+*/
+status_t
+PackageNodeCache::_CreateNode(Package* package, const CacheNode& cacheNode,
+	PackageDirectory* parent, const CacheAttribute*& attribute,
+	PackageNode*& _node)
+{
+	mode_t mode = cacheNode.mode;
+
+	PackageNode* node;
+	if (S_ISREG(mode)) {
+		PackageDataV2 data;
+		memcpy(&data, cacheNode.data, sizeof(data));
+		node = new PackageFile(package, mode, PackageData(data));
+	} else if (S_ISLNK(mode)) {
+		const char* symlinkPath = _StringAt(cacheNode.symlinkPath);
+		String path;
+		if (symlinkPath == NULL)
+			RETURN_ERROR(B_BAD_DATA);
+		if (!path.SetTo(symlinkPath))
+			RETURN_ERROR(B_NO_MEMORY);
+
+		PackageSymlink* symlink = new(std::nothrow) PackageSymlink(package,
+			mode);
+		if (symlink == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+
+		symlink->SetSymlinkPath(path);
+		node = symlink;
+	} else if (S_ISDIR(mode)) {
+		node = new PackageDirectory(package, mode);
+	} else
+		RETURN_ERROR(B_BAD_DATA);
+
+	if (node == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	BReference<PackageNode> nodeReference(node, true);
+
+	const char* nameString = _StringAt(cacheNode.name);
+	if (nameString == NULL)
+		RETURN_ERROR(B_BAD_DATA);
+
+	String name;
+	if (!name.SetTo(nameString))
+		RETURN_ERROR(B_NO_MEMORY);
+
+	status_t error = node->Init(parent, name);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	timespec modifiedTime;
+	modifiedTime.tv_sec = cacheNode.modifiedTimeSeconds;
+	modifiedTime.tv_nsec = cacheNode.modifiedTimeNanoSeconds;
+	node->SetModifiedTime(modifiedTime);
+
+	for (uint32 i = 0; i < cacheNode.attributeCount; i++, attribute++) {
+		const char* attributeName = _StringAt(attribute->name);
+		if (attributeName == NULL)
+			RETURN_ERROR(B_BAD_DATA);
+		if (!name.SetTo(attributeName))
+			RETURN_ERROR(B_NO_MEMORY);
+
+		PackageDataV2 data;
+		memcpy(&data, attribute->data, sizeof(data));
+
+		PackageNodeAttribute* nodeAttribute = new PackageNodeAttribute(
+			attribute->type, PackageData(data));
+		if (nodeAttribute == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+
+		nodeAttribute->Init(name);
+		node->AddAttribute(nodeAttribute);
+	}
+
+	_node = nodeReference.Detach();
+	return B_OK;
+}
+
+
+/*static*/ status_t
+PackageNodeCache::_WritePackage(Writer& writer, Package* package)
+{
+	return _WriteNodes(writer, package->Nodes(), 0);
+}
+
+
+/*!	Writes the given nodes and their descendants in pre-order. Since nodes are
+	prepended to their lists when they are added, the nodes are written in
+	reverse list order, so that loading them recreates the lists as they are.
+*/
+/*static*/ status_t
+PackageNodeCache::_WriteNodes(Writer& writer, const PackageNodeList& nodes,
+	uint32 depth)
+{
+	if (depth > kMaxNodeDepth)
+		RETURN_ERROR(B_BAD_DATA);
+	if (depth > writer.maxDepth)
+		writer.maxDepth = depth;
+
+	int32 count = 0;
+	for (PackageNode* node = nodes.First(); node != NULL;
+			node = nodes.GetNext(node)) {
+		count++;
+	}
+
+	PackageNode** array = (PackageNode**)malloc(
+		sizeof(PackageNode*) * (count + 1));
+	if (array == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	MemoryDeleter arrayDeleter(array);
+
+	int32 index = 0;
+	for (PackageNode* node = nodes.First(); node != NULL;
+			node = nodes.GetNext(node)) {
+		array[index++] = node;
+	}
+
+	for (int32 i = count - 1; i >= 0; i--) {
+		PackageNode* node = array[i];
+
+		CacheNode cacheNode;
+		memset(&cacheNode, 0, sizeof(cacheNode));
+
+		status_t error = writer.strings.Add(node->Name(), cacheNode.name);
+		if (error != B_OK)
+			RETURN_ERROR(error);
+
+		cacheNode.depth = depth;
+		cacheNode.mode = node->Mode();
+		cacheNode.modifiedTimeSeconds = node->ModifiedTime().tv_sec;
+		cacheNode.modifiedTimeNanoSeconds = node->ModifiedTime().tv_nsec;
+
+		if (PackageFile* file = dynamic_cast<PackageFile*>(node)) {
+			memcpy(cacheNode.data, &file->Data().DataV2(),
+				sizeof(cacheNode.data));
+		} else if (PackageSymlink* symlink
+				= dynamic_cast<PackageSymlink*>(node)) {
+			error = writer.strings.Add(symlink->SymlinkPath(),
+				cacheNode.symlinkPath);
+			if (error != B_OK)
+				RETURN_ERROR(error);
+		}
+
+		const PackageNodeAttributeList& attributes = node->Attributes();
+		for (PackageNodeAttributeList::ConstIterator it
+				= attributes.GetIterator();
+				PackageNodeAttribute* attribute = it.Next();) {
+			CacheAttribute cacheAttribute;
+			memset(&cacheAttribute, 0, sizeof(cacheAttribute));
+
+			error = writer.strings.Add(attribute->Name(), cacheAttribute.name);
+			if (error != B_OK)
+				RETURN_ERROR(error);
+
+			cacheAttribute.type = attribute->Type();
+			memcpy(cacheAttribute.data, &attribute->Data().DataV2(),
+				sizeof(cacheAttribute.data));
+
+			error = writer.attributes.Append(&cacheAttribute,
+				sizeof(cacheAttribute));
+			if (error != B_OK)
+				RETURN_ERROR(error);
+
+			cacheNode.attributeCount++;
+			writer.attributeCount++;
+		}
+
+		error = writer.nodes.Append(&cacheNode, sizeof(cacheNode));
+		if (error != B_OK)
+			RETURN_ERROR(error);
+		writer.nodeCount++;
+
+		if (PackageDirectory* directory
+				= dynamic_cast<PackageDirectory*>(node)) {
+			error = _WriteNodes(writer, directory->Children(), depth + 1);
+			if (error != B_OK)
+				RETURN_ERROR(error);
+		}
+	}
+
+	return B_OK;
+}
+
+
+/*static*/ status_t
+PackageNodeCache::_WriteFile(int fd, const void* buffer, size_t size)
+{
+	if (size == 0)
+		return B_OK;
+
+	ssize_t bytesWritten = write(fd, buffer, size);
+	if (bytesWritten < 0)
+		return errno;
+	if ((size_t)bytesWritten != size)
+		return B_IO_ERROR;
+	return B_OK;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef PACKAGE_NODE_CACHE_H
+#define PACKAGE_NODE_CACHE_H
+
+
+#include "Package.h"
+
+
+class PackageSettings;
+class PackagesDirectory;
+
+
+/*!	A persistent cache of the packages' node tables.
+
+	Mounting a volume would otherwise have to decompress and parse the TOC of
+	every active package. Instead, the node trees of all packages are stored
+	in one file in the administrative directory, which is read in one go on
+	the next mount. A package's entry is only used, if its file still has the
+	same node ref, size and modification time. Packages that have entries
+	blocked by the package settings are never cached.
+
+	If the set of packages that was loaded differs from the cached one, Store()
+	writes a new cache file.
+*/
+class PackageNodeCache {
+public:
+								PackageNodeCache();
+								~PackageNodeCache();
+
+			status_t			Init(PackagesDirectory* directory);
+			void				Unset();
+
+			status_t			LoadNodes(Package* package);
+									// B_ENTRY_NOT_FOUND, if not cached;
+									// may be called by multiple threads
+
+			bool				NeedsStore() const;
+			status_t			Store(PackagesDirectory* directory,
+									const PackageFileNameHashTable& packages,
+									const PackageSettings& settings);
+
+private:
+			struct CacheHeader;
+			struct CachePackage;
+			struct CacheNode;
+			struct CacheAttribute;
+			struct Buffer;
+			struct StringTable;
+			struct Writer;
+
+private:
+			const CachePackage*	_FindPackage(const char* fileName) const;
+			const char*			_StringAt(uint32 offset) const;
+			status_t			_CreateNode(Package* package,
+									const CacheNode& cacheNode,
+									PackageDirectory* parent,
+									const CacheAttribute*& attribute,
+									PackageNode*& _node);
+
+	static	status_t			_WritePackage(Writer& writer,
+									Package* package);
+	static	status_t			_WriteNodes(Writer& writer,
+									const PackageNodeList& nodes,
+									uint32 depth);
+	static	status_t			_WriteFile(int fd, const void* buffer,
+									size_t size);
+
+private:
+			uint8*				fData;
+			size_t				fSize;
+			const CacheHeader*	fHeader;
+			const CachePackage*	fPackages;
+			const CacheNode*	fNodes;
+			const CacheAttribute* fAttributes;
+			const char*			fStrings;
+			int32				fHitCount;
+			int32				fMissCount;
+};
+
+
+#endif	// PACKAGE_NODE_CACHE_H
@@ -13,6 +13,7 @@
 #include <sys/param.h>
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <new>
 
 #include <AppDefs.h>
@@ -20,6 +21,7 @@
 #include <KernelExport.h>
 #include <NodeMonitor.h>
 #include <package/PackageInfoAttributes.h>
+#include <smp.h>
 
 #include <AutoDeleter.h>
 #include <AutoDeleterPosix.h>
@@ -37,6 +39,7 @@
 #include "PackageFSRoot.h"
 #include "PackageLinkDirectory.h"
 #include "PackageLinksDirectory.h"
+#include "PackageNodeCache.h"
 #include "Resolvable.h"
 #include "SizeIndex.h"
 #include "UnpackingLeafNode.h"
@@ -63,6 +66,9 @@ const size_t kMaxActivationRequestSize = 10 * 1024 * 1024;
 // sanity limit for activation file size
 const size_t kMaxActivationFileSize = 10 * 1024 * 1024;
 
+// maximum number of threads loading packages in parallel
+static const int32 kMaxPackageLoaderThreads = 8;
+
 static const char* const kAdministrativeDirectoryName
 	= PACKAGES_DIRECTORY_ADMIN_DIRECTORY;
 static const char* const kActivationFileName
@@ -161,6 +167,158 @@ private:
 };
 
 
+// #pragma mark - PackageLoader
+
+
+/*!	Loads a list of packages -- i.e. reads their package attributes and TOCs
+	and creates their node trees -- on multiple threads. The results are kept
+	in the order the packages were added, so that the callers can add them to
+	the volume in a deterministic order.
+*/
+struct Volume::PackageLoader {
+public:
+	PackageLoader(Volume* volume, PackagesDirectory* packagesDirectory)
+		:
+		fVolume(volume),
+		fPackagesDirectory(packagesDirectory),
+		fItems(NULL),
+		fCount(0),
+		fCapacity(0),
+		fNextIndex(0),
+		fFailed(0),
+		fStopOnError(false)
+	{
+	}
+
+	~PackageLoader()
+	{
+		for (int32 i = 0; i < fCount; i++) {
+			free(fItems[i].name);
+			if (fItems[i].package != NULL)
+				fItems[i].package->ReleaseReference();
+		}
+
+		free(fItems);
+	}
+
+	status_t AddPackage(const char* name)
+	{
+		if (fCount == fCapacity) {
+			int32 newCapacity = fCapacity > 0 ? fCapacity * 2 : 64;
+			Item* items = (Item*)realloc(fItems, newCapacity * sizeof(Item));
+			if (items == NULL)
+				RETURN_ERROR(B_NO_MEMORY);
+
+			fItems = items;
+			fCapacity = newCapacity;
+		}
+
+		Item& item = fItems[fCount];
+		item.name = strdup(name);
+		if (item.name == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+		item.package = NULL;
+		item.status = B_NO_INIT;
+
+		fCount++;
+		return B_OK;
+	}
+
+	/*!	Loads all packages. If \a stopOnError is \c true, no more packages
+		are loaded after the first failure, and the first error in package
+		order is returned.
+	*/
+	status_t Load(bool stopOnError)
+	{
+		fNextIndex = 0;
+		fFailed = 0;
+		fStopOnError = stopOnError;
+
+		// the calling thread is one of the loaders
+		int32 threadCount = std::min(std::min((int32)smp_get_num_cpus(),
+			kMaxPackageLoaderThreads), fCount);
+		thread_id threads[kMaxPackageLoaderThreads];
+		int32 spawnedCount = 0;
+		for (int32 i = 1; i < threadCount; i++) {
+			thread_id thread = spawn_kernel_thread(&_LoaderThread,
+				"packagefs package loader", B_NORMAL_PRIORITY, this);
+			if (thread < 0)
+				break;
+
+			threads[spawnedCount++] = thread;
+			resume_thread(thread);
+		}
+
+		_Load();
+
+		for (int32 i = 0; i < spawnedCount; i++)
+			wait_for_thread(threads[i], NULL);
+
+		if (stopOnError) {
+			for (int32 i = 0; i < fCount; i++) {
+				if (fItems[i].status != B_OK)
+					return fItems[i].status;
+			}
+		}
+
+		return B_OK;
+	}
+
+	int32 CountPackages() const
+	{
+		return fCount;
+	}
+
+	Package* PackageAt(int32 index) const
+	{
+		return fItems[index].package;
+	}
+
+private:
+	struct Item {
+		char*		name;
+		Package*	package;
+		status_t	status;
+	};
+
+private:
+	static status_t _LoaderThread(void* data)
+	{
+		((PackageLoader*)data)->_Load();
+		return B_OK;
+	}
+
+	void _Load()
+	{
+		while (!fStopOnError || atomic_get(&fFailed) == 0) {
+			int32 index = atomic_add(&fNextIndex, 1);
+			if (index >= fCount)
+				break;
+
+			Item& item = fItems[index];
+			item.status = fVolume->_LoadPackage(fPackagesDirectory, item.name,
+				item.package);
+			if (item.status != B_OK) {
+				item.package = NULL;
+				ERROR("Failed to load package \"%s\": %s\n", item.name,
+					strerror(item.status));
+				atomic_set(&fFailed, 1);
+			}
+		}
+	}
+
+private:
+	Volume*				fVolume;
+	PackagesDirectory*	fPackagesDirectory;
+	Item*				fItems;
+	int32				fCount;
+	int32				fCapacity;
+	int32				fNextIndex;
+	int32				fFailed;
+	bool				fStopOnError;
+};
+
+
 // #pragma mark - Volume
 
 
@@ -173,6 +331,7 @@ Volume::Volume(fs_volume* fsVolume)
 	fPackagesDirectories(),
 	fPackagesDirectoriesByNodeRef(),
 	fPackageSettings(),
+	fNodeCache(NULL),
 	fNextNodeID(kRootDirectoryID + 1)
 {
 	rw_lock_init(&fLock, "packagefs volume");
@@ -748,6 +907,37 @@ Volume::_AddInitialPackages()
 	PackagesDirectory* packagesDirectory = fPackagesDirectories.Last();
 	INFORM("Adding packages from \"%s\"\n", packagesDirectory->Path());
 
+	// Unless we're booting into an old state, get the package nodes from the
+	// node cache where possible, instead of parsing each package's TOC.
+	PackageNodeCache nodeCache;
+	if (packagesDirectory == fPackagesDirectory) {
+		nodeCache.Init(fPackagesDirectory);
+		fNodeCache = &nodeCache;
+	}
+
+	status_t error = _AddInitialPackagesFromStates(packagesDirectory);
+	fNodeCache = NULL;
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	// update the node cache, if the set of packages has changed
+	if (packagesDirectory == fPackagesDirectory && nodeCache.NeedsStore()) {
+		nodeCache.Unset();
+		error = nodeCache.Store(fPackagesDirectory, fPackages,
+			fPackageSettings);
+		if (error != B_OK) {
+			INFORM("Failed to store the package node cache: %s\n",
+				strerror(error));
+		}
+	}
+
+	return B_OK;
+}
+
+
+status_t
+Volume::_AddInitialPackagesFromStates(PackagesDirectory* packagesDirectory)
+{
 	// try reading the activation file of the oldest state
 	status_t error = _AddInitialPackagesFromActivationFile(packagesDirectory);
 	if (error != B_OK && packagesDirectory != fPackagesDirectory) {
@@ -855,6 +1045,7 @@ Volume::_AddInitialPackagesFromActivationFile(
 	fileContent[st.st_size] = '\0';
 
 	// parse the file and add the respective packages
+	PackageLoader loader(this, packagesDirectory);
 	const char* packageName = fileContent;
 	char* const fileContentEnd = fileContent + st.st_size;
 	while (packageName < fileContentEnd) {
@@ -874,15 +1065,14 @@ Volume::_AddInitialPackagesFromActivationFile(
 			RETURN_ERROR(B_BAD_DATA);
 		}
 
-		status_t error = _LoadAndAddInitialPackage(packagesDirectory,
-			packageName);
+		status_t error = loader.AddPackage(packageName);
 		if (error != B_OK)
 			RETURN_ERROR(error);
 
 		packageName = packageNameEnd + 1;
 	}
 
-	return B_OK;
+	return _LoadAndAddInitialPackages(loader, true);
 }
 
 
@@ -903,6 +1093,7 @@ Volume::_AddInitialPackagesFromDirectory()
 		RETURN_ERROR(errno);
 	}
 
+	PackageLoader loader(this, fPackagesDirectory);
 	while (dirent* entry = readdir(dir.Get())) {
 		// skip "." and ".."
 		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
@@ -915,28 +1106,34 @@ Volume::_AddInitialPackagesFromDirectory()
 			continue;
 		}
 
-		_LoadAndAddInitialPackage(fPackagesDirectory, entry->d_name);
+		status_t error = loader.AddPackage(entry->d_name);
+		if (error != B_OK)
+			RETURN_ERROR(error);
 	}
 
-	return B_OK;
+	// packages that fail to load are simply skipped
+	return _LoadAndAddInitialPackages(loader, false);
 }
 
 
+/*!	Loads the packages of the given loader in parallel and adds the ones that
+	could be loaded, in the order they were added to the loader.
+*/
 status_t
-Volume::_LoadAndAddInitialPackage(PackagesDirectory* packagesDirectory,
-	const char* name)
+Volume::_LoadAndAddInitialPackages(PackageLoader& loader, bool stopOnError)
 {
-	Package* package;
-	status_t error = _LoadPackage(packagesDirectory, name, package);
-	if (error != B_OK) {
-		ERROR("Failed to load package \"%s\": %s\n", name, strerror(error));
+	status_t error = loader.Load(stopOnError);
+	if (error != B_OK)
 		RETURN_ERROR(error);
-	}
-	BReference<Package> packageReference(package, true);
 
 	VolumeWriteLocker systemVolumeLocker(_SystemVolumeIfNotSelf());
 	VolumeWriteLocker volumeLocker(this);
-	_AddPackage(package);
+
+	int32 count = loader.CountPackages();
+	for (int32 i = 0; i < count; i++) {
+		if (Package* package = loader.PackageAt(i))
+			_AddPackage(package);
+	}
 
 	return B_OK;
 }
@@ -1501,7 +1698,7 @@ Volume::_LoadPackage(PackagesDirectory* packagesDirectory, const char* name,
 	if (error != B_OK)
 		return error;
 
-	error = package->Load(fPackageSettings);
+	error = package->Load(fPackageSettings, fNodeCache);
 	if (error != B_OK)
 		return error;
 
@@ -1581,7 +1778,7 @@ Volume::_ChangeActivation(ActivationChangeRequest& request)
 			oldPackageReferences);
 
 	// load all new packages
-	int32 newPackageIndex = 0;
+	PackageLoader loader(this, fPackagesDirectory);
 	for (uint32 i = 0; i < itemCount; i++) {
 		PackageFSActivationChangeItem* item = request.ItemAt(i);
 
@@ -1590,17 +1787,20 @@ Volume::_ChangeActivation(ActivationChangeRequest& request)
 			continue;
 		}
 
-		Package* package;
-		status_t error = _LoadPackage(fPackagesDirectory, item->name, package);
-		if (error != B_OK) {
-			ERROR("Volume::_ChangeActivation(): failed to load package "
-				"\"%s\"\n", item->name);
+		status_t error = loader.AddPackage(item->name);
+		if (error != B_OK)
 			RETURN_ERROR(error);
-		}
+	}
 
-		newPackageReferences[newPackageIndex++].SetTo(package, true);
+	status_t loadError = loader.Load(true);
+	if (loadError != B_OK) {
+		ERROR("Volume::_ChangeActivation(): failed to load packages\n");
+		RETURN_ERROR(loadError);
 	}
 
+	for (int32 i = 0; i < newPackageCount; i++)
+		newPackageReferences[i].SetTo(loader.PackageAt(i));
+
 	// apply the changes
 	VolumeWriteLocker systemVolumeLocker(_SystemVolumeIfNotSelf());
 	VolumeWriteLocker volumeLocker(this);
@@ -1631,6 +1831,7 @@ Volume::_ChangeActivation(ActivationChangeRequest& request)
 
 	// add the new packages
 	status_t error = B_OK;
+	int32 newPackageIndex;
 	for (newPackageIndex = 0; newPackageIndex < newPackageCount;
 		newPackageIndex++) {
 		Package* package = newPackageReferences[newPackageIndex];
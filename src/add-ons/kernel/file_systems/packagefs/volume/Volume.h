@@ -28,6 +28,7 @@
 
 class Directory;
 class PackageFSRoot;
+class PackageNodeCache;
 class PackagesDirectory;
 class UnpackingNode;
 
@@ -108,18 +109,20 @@ private:
 private:
 			struct ShineThroughDirectory;
 			struct ActivationChangeRequest;
+			struct PackageLoader;
 
 private:
 			status_t			_LoadOldPackagesStates(
 									const char* packagesState);
 
 			status_t			_AddInitialPackages();
+			status_t			_AddInitialPackagesFromStates(
+									PackagesDirectory* packagesDirectory);
 			status_t			_AddInitialPackagesFromActivationFile(
 									PackagesDirectory* packagesDirectory);
 			status_t			_AddInitialPackagesFromDirectory();
-			status_t			_LoadAndAddInitialPackage(
-									PackagesDirectory* packagesDirectory,
-									const char* name);
+			status_t			_LoadAndAddInitialPackages(
+									PackageLoader& loader, bool stopOnError);
 
 	inline	void				_AddPackage(Package* package);
 	inline	void				_RemovePackage(Package* package);
@@ -189,6 +192,8 @@ private:
 			PackagesDirectoryList fPackagesDirectories;
 			PackagesDirectoryHashTable fPackagesDirectoriesByNodeRef;
 			PackageSettings		fPackageSettings;
+			PackageNodeCache*	fNodeCache;
+									// only while adding the initial packages
 
 			struct {
 				dev_t			deviceID;
@@ -184,6 +184,11 @@ struct Query::QueryPolicy {
 			std::min(maxFactor, std::max((int32)1, index.index->CountEntries())));
 	}
 
+	static int64 IndexGetEntryCount(Index& index)
+	{
+		return index.index->CountEntries();
+	}
+
 	static type_code IndexGetType(Index& index)
 	{
 		return index.index->GetType();
@@ -229,6 +234,11 @@ struct Query::QueryPolicy {
 		return B_OK;
 	}
 
+	static ino_t IndexIteratorGetNodeID(IndexIterator* indexIterator)
+	{
+		return indexIterator->entry->GetNode()->GetID();
+	}
+
 	static void IndexIteratorSkipDuplicates(IndexIterator* indexIterator)
 	{
 		// Nothing to do.
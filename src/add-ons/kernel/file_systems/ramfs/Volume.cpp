@@ -26,6 +26,7 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <fs_cache.h>
 #include <vm/vm_page.h>
 
 #include "DebugSupport.h"
@@ -499,6 +500,9 @@ Volume::EntryAdded(ino_t id, Entry *entry)
 	if (error == B_OK) {
 		error = fDirectoryEntryTable->AddEntry(id, entry);
 		if (error == B_OK) {
+			// the entry might have been cached as missing
+			entry_cache_remove(GetID(), id, entry->GetName());
+
 			// notify listeners
 			// listeners interested in that entry
 			EntryListenerTree::Iterator it;
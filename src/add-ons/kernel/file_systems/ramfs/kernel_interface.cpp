@@ -31,6 +31,7 @@
 #include <stdio.h>
 #include <sys/stat.h>
 
+#include <fs_cache.h>
 #include <fs_index.h>
 #include <fs_info.h>
 #include <fs_interface.h>
@@ -221,6 +222,12 @@ ramfs_lookup(fs_volume* _volume, fs_vnode* _dir, const char* entryName,
 SET_ERROR(error, error);
 			if (error == B_OK)
 				*_vnodeID = node->GetID();
+			else if (error == B_ENTRY_NOT_FOUND) {
+				// Entries are only added with the volume write locked, and
+				// Volume::EntryAdded() removes them from the entry cache.
+				entry_cache_add_missing(volume->GetID(), dir->GetID(),
+					entryName);
+			}
 		}
 
 	} else
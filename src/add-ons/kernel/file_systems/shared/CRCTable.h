@@ -17,3 +17,5 @@ uint32 calculate_crc32c(uint32 crc32c, const unsigned char *buffer,
 	unsigned int length);
 
 
+uint32 calculate_crc32c_portable(uint32 crc32c, const unsigned char *buffer,
+	unsigned int length);
@@ -53,6 +53,17 @@
 #include <stdint.h>
 uint32 calculate_crc32c(uint32 crc32c, const unsigned char *buffer,
 	unsigned int length);
+uint32 calculate_crc32c_portable(uint32 crc32c, const unsigned char *buffer,
+	unsigned int length);
+#endif
+
+#if defined(__x86_64__) || (defined(__i386__) && __GNUC__ > 2)
+#	define CRC32C_HARDWARE
+#	ifdef _KERNEL_MODE
+#		include <cpu.h>
+#	else
+#		include <OS.h>
+#	endif
 #endif
 
 #else
@@ -63,6 +74,8 @@ uint32 calculate_crc32c(uint32 crc32c, const unsigned char *buffer,
 #include "Debug.h"
 uint32 calculate_crc32c(uint32 crc32c, const unsigned char *buffer,
 	unsigned int length);
+uint32 calculate_crc32c_portable(uint32 crc32c, const unsigned char *buffer,
+	unsigned int length);
 
 #endif
 
@@ -761,8 +774,9 @@ multitable_crc32c(uint32 crc32c,
 	return (crc32c_sb8_64_bit(crc32c, buffer, length, to_even_word));
 }
 
+
 uint32
-calculate_crc32c(uint32 crc32c,
+calculate_crc32c_portable(uint32 crc32c,
     const unsigned char *buffer,
     unsigned int length)
 {
@@ -773,3 +787,260 @@ calculate_crc32c(uint32 crc32c,
 	}
 }
 
+
+#ifdef CRC32C_HARDWARE
+
+/*
+ * CRC-32C using the SSE 4.2 crc32 instruction.
+ *
+ * The instruction has a latency of three cycles, but a throughput of one per
+ * cycle, so the buffer is split into three streams that are processed in
+ * parallel. Afterwards, the CRCs of the streams are combined by shifting the
+ * previous one over the length of the next stream, and adding the next one.
+ * The shift is a linear operation, which is done with the tables below.
+ *
+ * Only general purpose registers are used, so this is safe to call from the
+ * kernel as well. Based on the approach by Mark Adler.
+ */
+
+#define CRC32C_POLYNOMIAL	0x82f63b78
+
+#ifdef __x86_64__
+typedef uint64 crc32c_word;
+#else
+typedef uint32 crc32c_word;
+#endif
+
+static const size_t kCrc32cLongBlock = 8192;
+static const size_t kCrc32cShortBlock = 256;
+
+static uint32 sCrc32cLong[4][256];
+static uint32 sCrc32cShort[4][256];
+
+
+static inline uint32
+crc32c_byte(uint32 crc, uint8 value)
+{
+	__asm__("crc32b %1, %0" : "+r" (crc) : "rm" (value));
+	return crc;
+}
+
+
+static inline crc32c_word
+crc32c_word_update(crc32c_word crc, crc32c_word value)
+{
+#ifdef __x86_64__
+	__asm__("crc32q %1, %0" : "+r" (crc) : "rm" (value));
+#else
+	__asm__("crc32l %1, %0" : "+r" (crc) : "rm" (value));
+#endif
+	return crc;
+}
+
+
+static uint32
+gf2_matrix_times(const uint32 *matrix, uint32 vector)
+{
+	uint32 sum = 0;
+	while (vector != 0) {
+		if ((vector & 1) != 0)
+			sum ^= *matrix;
+		vector >>= 1;
+		matrix++;
+	}
+	return sum;
+}
+
+
+static void
+gf2_matrix_square(uint32 *square, const uint32 *matrix)
+{
+	for (int n = 0; n < 32; n++)
+		square[n] = gf2_matrix_times(matrix, matrix[n]);
+}
+
+
+/*!	Builds the operator that applies \a length zero bytes to a CRC. */
+static void
+crc32c_zeros_operator(uint32 *even, size_t length)
+{
+	uint32 odd[32];
+
+	// the operator for one zero bit
+	odd[0] = CRC32C_POLYNOMIAL;
+	uint32 row = 1;
+	for (int n = 1; n < 32; n++) {
+		odd[n] = row;
+		row <<= 1;
+	}
+
+	// two, and four zero bits
+	gf2_matrix_square(even, odd);
+	gf2_matrix_square(odd, even);
+
+	// every further squaring doubles the number of zeros, starting with one
+	// byte; length must be a power of two
+	do {
+		gf2_matrix_square(even, odd);
+		length >>= 1;
+		if (length == 0)
+			return;
+		gf2_matrix_square(odd, even);
+		length >>= 1;
+	} while (length != 0);
+
+	for (int n = 0; n < 32; n++)
+		even[n] = odd[n];
+}
+
+
+static void
+crc32c_zeros(uint32 zeros[][256], size_t length)
+{
+	uint32 op[32];
+	crc32c_zeros_operator(op, length);
+
+	for (uint32 n = 0; n < 256; n++) {
+		zeros[0][n] = gf2_matrix_times(op, n);
+		zeros[1][n] = gf2_matrix_times(op, n << 8);
+		zeros[2][n] = gf2_matrix_times(op, n << 16);
+		zeros[3][n] = gf2_matrix_times(op, n << 24);
+	}
+}
+
+
+static inline uint32
+crc32c_shift(const uint32 zeros[][256], uint32 crc)
+{
+	return zeros[0][crc & 0xff] ^ zeros[1][(crc >> 8) & 0xff]
+		^ zeros[2][(crc >> 16) & 0xff] ^ zeros[3][crc >> 24];
+}
+
+
+static uint32
+hardware_crc32c(uint32 crc32c, const unsigned char *buffer,
+	unsigned int length)
+{
+	const unsigned char *next = buffer;
+	size_t left = length;
+
+	while (left > 0 && ((addr_t)next & (sizeof(crc32c_word) - 1)) != 0) {
+		crc32c = crc32c_byte(crc32c, *next++);
+		left--;
+	}
+
+	crc32c_word crc0 = crc32c;
+
+	while (left >= 3 * kCrc32cLongBlock) {
+		crc32c_word crc1 = 0;
+		crc32c_word crc2 = 0;
+		const unsigned char *end = next + kCrc32cLongBlock;
+		do {
+			crc0 = crc32c_word_update(crc0, *(const crc32c_word *)next);
+			crc1 = crc32c_word_update(crc1,
+				*(const crc32c_word *)(next + kCrc32cLongBlock));
+			crc2 = crc32c_word_update(crc2,
+				*(const crc32c_word *)(next + 2 * kCrc32cLongBlock));
+			next += sizeof(crc32c_word);
+		} while (next < end);
+
+		crc0 = crc32c_shift(sCrc32cLong, (uint32)crc0) ^ crc1;
+		crc0 = crc32c_shift(sCrc32cLong, (uint32)crc0) ^ crc2;
+		next += 2 * kCrc32cLongBlock;
+		left -= 3 * kCrc32cLongBlock;
+	}
+
+	while (left >= 3 * kCrc32cShortBlock) {
+		crc32c_word crc1 = 0;
+		crc32c_word crc2 = 0;
+		const unsigned char *end = next + kCrc32cShortBlock;
+		do {
+			crc0 = crc32c_word_update(crc0, *(const crc32c_word *)next);
+			crc1 = crc32c_word_update(crc1,
+				*(const crc32c_word *)(next + kCrc32cShortBlock));
+			crc2 = crc32c_word_update(crc2,
+				*(const crc32c_word *)(next + 2 * kCrc32cShortBlock));
+			next += sizeof(crc32c_word);
+		} while (next < end);
+
+		crc0 = crc32c_shift(sCrc32cShort, (uint32)crc0) ^ crc1;
+		crc0 = crc32c_shift(sCrc32cShort, (uint32)crc0) ^ crc2;
+		next += 2 * kCrc32cShortBlock;
+		left -= 3 * kCrc32cShortBlock;
+	}
+
+	const unsigned char *end = next + (left & ~(sizeof(crc32c_word) - 1));
+	while (next < end) {
+		crc0 = crc32c_word_update(crc0, *(const crc32c_word *)next);
+		next += sizeof(crc32c_word);
+	}
+	left &= sizeof(crc32c_word) - 1;
+
+	crc32c = (uint32)crc0;
+	while (left-- > 0)
+		crc32c = crc32c_byte(crc32c, *next++);
+
+	return crc32c;
+}
+
+
+static bool
+has_hardware_crc32c()
+{
+#ifdef _KERNEL_MODE
+	return x86_check_feature(IA32_FEATURE_EXT_SSE4_2, FEATURE_EXT);
+#else
+	cpuid_info info;
+	if (get_cpuid(&info, 1, 0) != B_OK)
+		return false;
+	return (info.eax_1.extended_features & (1 << 20)) != 0;
+#endif
+}
+
+#endif	// CRC32C_HARDWARE
+
+
+typedef uint32 (*crc32c_function)(uint32 crc32c, const unsigned char *buffer,
+	unsigned int length);
+
+static crc32c_function sCrc32cFunction = NULL;
+
+
+static crc32c_function
+select_crc32c_function()
+{
+	crc32c_function function = calculate_crc32c_portable;
+
+#ifdef CRC32C_HARDWARE
+	if (has_hardware_crc32c()) {
+		// Concurrent callers may compute the same tables at the same time,
+		// which is harmless; the tables must be complete before anyone can
+		// see the function, though.
+		crc32c_zeros(sCrc32cLong, kCrc32cLongBlock);
+		crc32c_zeros(sCrc32cShort, kCrc32cShortBlock);
+		function = hardware_crc32c;
+	}
+#endif
+
+	__asm__ __volatile__("" : : : "memory");
+	sCrc32cFunction = function;
+	return function;
+}
+
+
+/*!	Calculates the CRC-32C (Castagnoli) of the buffer, continuing from the
+	given \a crc32c. There is neither pre- nor post-inversion, the callers
+	take care of that.
+	Uses the crc32 instruction if the CPU supports it, and falls back to the
+	slicing-by-8 tables otherwise.
+*/
+uint32
+calculate_crc32c(uint32 crc32c, const unsigned char *buffer,
+	unsigned int length)
+{
+	crc32c_function function = sCrc32cFunction;
+	if (function == NULL)
+		function = select_crc32c_function();
+
+	return function(crc32c, buffer, length);
+}
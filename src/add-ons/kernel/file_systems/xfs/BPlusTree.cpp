@@ -781,8 +781,8 @@ TreeDirectory::Lookup(const char* name, size_t length, xfs_ino_t* ino)
 			ExtentDataEntry* entry
 				= (ExtentDataEntry*)(fSingleDirBlock + offset);
 
-			int retVal = strncmp(name, (char*)entry->name, entry->namelen);
-			if (retVal == 0) {
+			if (entry->namelen == length
+				&& memcmp(name, entry->name, length) == 0) {
 				*ino = B_BENDIAN_TO_HOST_INT64(entry->inumber);
 				TRACE("ino:(%" B_PRIu64 ")\n", *ino);
 				return B_OK;
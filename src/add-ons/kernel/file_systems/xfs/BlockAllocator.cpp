@@ -0,0 +1,879 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "BlockAllocator.h"
+
+#include "Checksum.h"
+#include "Inode.h"
+#include "Journal.h"
+#include "ShortBTree.h"
+#include "Volume.h"
+
+
+struct FreeExtent {
+	uint32	start;
+	uint32	count;
+};
+
+
+/*!	The AGF and the AG free list of one allocation group, as seen by a
+	transaction.
+*/
+class AllocationGroup {
+public:
+								AllocationGroup(Transaction& transaction,
+									xfs_agnumber_t number);
+
+			status_t			Init();
+
+			Volume*				GetVolume() const { return fVolume; }
+			Transaction&		GetTransaction() const { return fTransaction; }
+			xfs_agnumber_t		Number() const { return fNumber; }
+
+			uint32				FreeBlocks() const
+									{ return _Get(XFS_AGF_FREEBLKS); }
+			void				SetFreeBlocks(uint32 count)
+									{ _Set(XFS_AGF_FREEBLKS, count); }
+			void				SetLongest(uint32 count)
+									{ _Set(XFS_AGF_LONGEST, count); }
+			uint32				FreeListCount() const
+									{ return _Get(XFS_AGF_FLCOUNT); }
+			uint32				FreeListSize() const
+									{ return _FreeListSize(); }
+
+			xfs_agblock_t		Root(int tree) const
+									{ return _Get(XFS_AGF_ROOTS + 4 * tree); }
+			uint32				Levels(int tree) const
+									{ return _Get(XFS_AGF_LEVELS + 4 * tree); }
+			void				SetRoot(int tree, xfs_agblock_t root,
+									uint32 levels);
+
+			off_t				BlockOffset(xfs_agblock_t block) const;
+
+			status_t			AllocateTreeBlock(xfs_agblock_t& _block);
+			bool				CanFreeTreeBlock() const;
+			status_t			FreeTreeBlock(xfs_agblock_t block);
+			status_t			PutOnFreeList(xfs_agblock_t block);
+
+private:
+			uint32				_Get(uint32 offset) const
+									{ return read32(fAGF->data, offset); }
+			void				_Set(uint32 offset, uint32 value);
+			uint32				_FreeListSize() const;
+			uint32				_FreeListHeaderSize() const;
+			status_t			_GetFreeList(TransactionBuffer*& _buffer);
+
+private:
+			Transaction&		fTransaction;
+			Volume*				fVolume;
+			xfs_agnumber_t		fNumber;
+			TransactionBuffer*	fAGF;
+};
+
+
+/*!	One of the free space B+trees of an allocation group. Blocks for it
+	come from the AG free list.
+*/
+class FreeSpaceTree : public ShortBTree {
+public:
+								FreeSpaceTree(AllocationGroup& group,
+									int tree);
+
+			status_t			Lookup(const FreeExtent& key, lookup_mode mode,
+									bool& _found);
+			status_t			Last(FreeExtent& _record, bool& _found);
+			FreeExtent			Record() const;
+
+			status_t			Update(const FreeExtent& record);
+			status_t			Insert(const FreeExtent& record);
+
+protected:
+	virtual	int					_CompareKeys(const uint8* a,
+									const uint8* b) const;
+	virtual	xfs_agblock_t		_Root() const
+									{ return fAllocationGroup.Root(fTree); }
+	virtual	uint32				_Levels() const
+									{ return fAllocationGroup.Levels(fTree); }
+	virtual	void				_SetRoot(xfs_agblock_t root, uint32 levels)
+									{ fAllocationGroup.SetRoot(fTree, root,
+										levels); }
+	virtual	status_t			_AllocateBlock(xfs_agblock_t& _block)
+									{ return fAllocationGroup
+										.AllocateTreeBlock(_block); }
+	virtual	bool				_CanFreeBlock() const
+									{ return fAllocationGroup
+										.CanFreeTreeBlock(); }
+	virtual	status_t			_FreeBlock(xfs_agblock_t block)
+									{ return fAllocationGroup
+										.FreeTreeBlock(block); }
+
+private:
+	static	void				_ToRecord(const FreeExtent& extent,
+									uint8* record);
+
+private:
+			AllocationGroup&	fAllocationGroup;
+			int					fTree;
+};
+
+
+//	#pragma mark - AllocationGroup
+
+
+AllocationGroup::AllocationGroup(Transaction& transaction,
+	xfs_agnumber_t number)
+	:
+	fTransaction(transaction),
+	fVolume(transaction.GetVolume()),
+	fNumber(number),
+	fAGF(NULL)
+{
+}
+
+
+status_t
+AllocationGroup::Init()
+{
+	bool version5 = fVolume->IsVersion5();
+	uint32 sectorSize = fVolume->SectorSize();
+
+	status_t status = fTransaction.GetBuffer(BlockOffset(0) + sectorSize,
+		sectorSize, XFS_BLFT_AGF_BUF, version5 ? XFS_AGF_CRC : -1,
+		version5 ? XFS_AGF_LSN : -1, fAGF);
+	if (status != B_OK)
+		return status;
+
+	if (fAGF->verified)
+		return B_OK;
+
+	if (_Get(0) != XFS_AGF_MAGIC || _Get(4) != XFS_AGF_VERSION
+		|| _Get(8) != fNumber) {
+		ERROR("AllocationGroup: bad AGF in group %" B_PRIu32 "\n", fNumber);
+		return B_BAD_DATA;
+	}
+	if (version5) {
+		if (!xfs_verify_cksum((const char*)fAGF->data, sectorSize,
+				XFS_AGF_CRC)
+			|| !fVolume->UuidEquals(*(uuid_t*)(fAGF->data + XFS_AGF_UUID))) {
+			ERROR("AllocationGroup: AGF of group %" B_PRIu32 " is corrupted\n",
+				fNumber);
+			return B_BAD_DATA;
+		}
+	}
+	if (Levels(XFS_BTNUM_BNO) == 0
+		|| Levels(XFS_BTNUM_BNO) > XFS_BTREE_MAX_LEVELS
+		|| Levels(XFS_BTNUM_CNT) == 0
+		|| Levels(XFS_BTNUM_CNT) > XFS_BTREE_MAX_LEVELS
+		|| _Get(XFS_AGF_FLCOUNT) > _FreeListSize()) {
+		ERROR("AllocationGroup: bad AGF in group %" B_PRIu32 "\n", fNumber);
+		return B_BAD_DATA;
+	}
+
+	fAGF->verified = true;
+	return B_OK;
+}
+
+
+void
+AllocationGroup::SetRoot(int tree, xfs_agblock_t root, uint32 levels)
+{
+	_Set(XFS_AGF_ROOTS + 4 * tree, root);
+	_Set(XFS_AGF_LEVELS + 4 * tree, levels);
+}
+
+
+off_t
+AllocationGroup::BlockOffset(xfs_agblock_t block) const
+{
+	return ((off_t)fNumber * fVolume->AgBlocks() + block)
+		<< fVolume->BlockLog();
+}
+
+
+/*!	Takes a block off the AG free list, which always holds a few blocks for
+	the free space B+trees to grow.
+*/
+status_t
+AllocationGroup::AllocateTreeBlock(xfs_agblock_t& _block)
+{
+	if (_Get(XFS_AGF_FLCOUNT) == 0) {
+		// the callers make sure there are enough blocks beforehand, as the
+		// trees are already half updated at this point
+		ERROR("AllocationGroup: free list of group %" B_PRIu32 " ran "
+			"empty\n", fNumber);
+		return B_ERROR;
+	}
+
+	TransactionBuffer* freeList;
+	status_t status = _GetFreeList(freeList);
+	if (status != B_OK)
+		return status;
+
+	uint32 first = _Get(XFS_AGF_FLFIRST);
+	xfs_agblock_t block = read32(freeList->data,
+		_FreeListHeaderSize() + first * 4);
+	if (block >= fVolume->AgBlocks())
+		return B_BAD_DATA;
+
+	_Set(XFS_AGF_FLFIRST, (first + 1) % _FreeListSize());
+	_Set(XFS_AGF_FLCOUNT, _Get(XFS_AGF_FLCOUNT) - 1);
+	_Set(XFS_AGF_BTREEBLKS, _Get(XFS_AGF_BTREEBLKS) + 1);
+
+	_block = block;
+	return B_OK;
+}
+
+
+bool
+AllocationGroup::CanFreeTreeBlock() const
+{
+	return _Get(XFS_AGF_FLCOUNT) < _FreeListSize();
+}
+
+
+status_t
+AllocationGroup::FreeTreeBlock(xfs_agblock_t block)
+{
+	status_t status = PutOnFreeList(block);
+	if (status != B_OK)
+		return status;
+
+	_Set(XFS_AGF_BTREEBLKS, _Get(XFS_AGF_BTREEBLKS) - 1);
+	return B_OK;
+}
+
+
+/*!	Appends \a block to the AG free list. The caller is responsible for
+	removing it from wherever it was accounted for before.
+*/
+status_t
+AllocationGroup::PutOnFreeList(xfs_agblock_t block)
+{
+	if (!CanFreeTreeBlock())
+		return B_ERROR;
+
+	TransactionBuffer* freeList;
+	status_t status = _GetFreeList(freeList);
+	if (status != B_OK)
+		return status;
+
+	uint32 last = (_Get(XFS_AGF_FLLAST) + 1) % _FreeListSize();
+	uint32 offset = _FreeListHeaderSize() + last * 4;
+	write32(freeList->data, offset, block);
+	fTransaction.MarkDirty(freeList, offset, 4);
+
+	_Set(XFS_AGF_FLLAST, last);
+	_Set(XFS_AGF_FLCOUNT, _Get(XFS_AGF_FLCOUNT) + 1);
+	return B_OK;
+}
+
+
+void
+AllocationGroup::_Set(uint32 offset, uint32 value)
+{
+	write32(fAGF->data, offset, value);
+	fTransaction.MarkDirty(fAGF, offset, 4);
+}
+
+
+uint32
+AllocationGroup::_FreeListHeaderSize() const
+{
+	return fVolume->IsVersion5() ? XFS_AGFL_HEADER_SIZE : 0;
+}
+
+
+uint32
+AllocationGroup::_FreeListSize() const
+{
+	return (fVolume->SectorSize() - _FreeListHeaderSize()) / 4;
+}
+
+
+status_t
+AllocationGroup::_GetFreeList(TransactionBuffer*& _buffer)
+{
+	bool version5 = fVolume->IsVersion5();
+	uint32 sectorSize = fVolume->SectorSize();
+
+	status_t status = fTransaction.GetBuffer(BlockOffset(0) + 3 * sectorSize,
+		sectorSize, XFS_BLFT_AGFL_BUF, version5 ? XFS_AGFL_CRC : -1,
+		version5 ? XFS_AGFL_LSN : -1, _buffer);
+	if (status != B_OK || _buffer->verified)
+		return status;
+
+	if (version5) {
+		if (read32(_buffer->data, 0) != XFS_AGFL_MAGIC
+			|| read32(_buffer->data, XFS_AGFL_SEQNO) != fNumber
+			|| !xfs_verify_cksum((const char*)_buffer->data, sectorSize,
+				XFS_AGFL_CRC)
+			|| !fVolume->UuidEquals(
+				*(uuid_t*)(_buffer->data + XFS_AGFL_UUID))) {
+			ERROR("AllocationGroup: AGFL of group %" B_PRIu32 " is "
+				"corrupted\n", fNumber);
+			return B_BAD_DATA;
+		}
+	}
+
+	_buffer->verified = true;
+	return B_OK;
+}
+
+
+//	#pragma mark - FreeSpaceTree
+
+
+FreeSpaceTree::FreeSpaceTree(AllocationGroup& group, int tree)
+	:
+	ShortBTree(group.GetTransaction(), group.Number(),
+		group.GetVolume()->IsVersion5()
+			? (tree == XFS_BTNUM_BNO ? XFS_ABTB_CRC_MAGIC : XFS_ABTC_CRC_MAGIC)
+			: (tree == XFS_BTNUM_BNO ? XFS_ABTB_MAGIC : XFS_ABTC_MAGIC),
+		sizeof(FreeExtent), sizeof(FreeExtent)),
+	fAllocationGroup(group),
+	fTree(tree)
+{
+}
+
+
+status_t
+FreeSpaceTree::Lookup(const FreeExtent& key, lookup_mode mode, bool& _found)
+{
+	uint8 record[sizeof(FreeExtent)];
+	_ToRecord(key, record);
+	return ShortBTree::Lookup(record, mode, _found);
+}
+
+
+status_t
+FreeSpaceTree::Last(FreeExtent& _record, bool& _found)
+{
+	status_t status = ShortBTree::Last(_found);
+	if (status == B_OK && _found)
+		_record = Record();
+	return status;
+}
+
+
+FreeExtent
+FreeSpaceTree::Record() const
+{
+	const uint8* record = ShortBTree::Record();
+	FreeExtent extent;
+	extent.start = read32(record, 0);
+	extent.count = read32(record, 4);
+	return extent;
+}
+
+
+status_t
+FreeSpaceTree::Update(const FreeExtent& record)
+{
+	uint8 data[sizeof(FreeExtent)];
+	_ToRecord(record, data);
+	return ShortBTree::Update(data);
+}
+
+
+status_t
+FreeSpaceTree::Insert(const FreeExtent& record)
+{
+	uint8 data[sizeof(FreeExtent)];
+	_ToRecord(record, data);
+	return ShortBTree::Insert(data);
+}
+
+
+int
+FreeSpaceTree::_CompareKeys(const uint8* a, const uint8* b) const
+{
+	uint32 startA = read32(a, 0);
+	uint32 startB = read32(b, 0);
+	if (fTree == XFS_BTNUM_CNT) {
+		uint32 countA = read32(a, 4);
+		uint32 countB = read32(b, 4);
+		if (countA != countB)
+			return countA < countB ? -1 : 1;
+	}
+	if (startA != startB)
+		return startA < startB ? -1 : 1;
+	return 0;
+}
+
+
+/*static*/ void
+FreeSpaceTree::_ToRecord(const FreeExtent& extent, uint8* record)
+{
+	write32(record, 0, extent.start);
+	write32(record, 4, extent.count);
+}
+
+
+//	#pragma mark - BlockAllocator
+
+
+BlockAllocator::BlockAllocator(Volume* volume)
+	:
+	fVolume(volume)
+{
+}
+
+
+BlockAllocator::~BlockAllocator()
+{
+}
+
+
+/*!	Allocates up to \a maxLength blocks, preferably in the allocation group
+	of \a hint. With \a contiguous, the extent should start at \a hint if
+	possible, so that it can be merged with the one before it.
+	The allocated extent may be shorter than requested.
+	B_DEVICE_FULL leaves the transaction consistent, it may still be
+	committed; after any other error, it must not be.
+	Unlike with the other methods, the caller has to account for the blocks
+	in the volume, as they might have been reserved already.
+*/
+status_t
+BlockAllocator::Allocate(Transaction& transaction, xfs_fsblock_t hint,
+	bool contiguous, uint32 maxLength, xfs_fsblock_t& _block, uint32& _length)
+{
+	xfs_agnumber_t groupCount = fVolume->AgCount();
+	xfs_agnumber_t first = FSBLOCKS_TO_AGNO(hint, fVolume);
+	if (first >= groupCount)
+		first = 0;
+
+	for (xfs_agnumber_t i = 0; i < groupCount; i++) {
+		xfs_agnumber_t group = (first + i) % groupCount;
+		int64 target = -1;
+		if (i == 0 && contiguous)
+			target = FSBLOCKS_TO_AGBLOCKNO(hint, fVolume);
+
+		xfs_agblock_t block;
+		status_t status = _AllocateInGroup(transaction, group, target,
+			maxLength, 0, block, _length);
+		if (status == B_OK) {
+			_block = ((xfs_fsblock_t)group << fVolume->AgBlocksLog()) | block;
+			return B_OK;
+		}
+		if (status != B_DEVICE_FULL)
+			return status;
+	}
+
+	return B_DEVICE_FULL;
+}
+
+
+/*!	Returns the extent starting at \a block to the free space of its
+	allocation group, merging it with its free neighbours. An error other
+	than B_DEVICE_FULL leaves the transaction half updated, it must not be
+	committed then.
+*/
+status_t
+BlockAllocator::Free(Transaction& transaction, xfs_fsblock_t block,
+	uint32 length)
+{
+	xfs_agnumber_t number = FSBLOCKS_TO_AGNO(block, fVolume);
+	xfs_agblock_t start = FSBLOCKS_TO_AGBLOCKNO(block, fVolume);
+	if (number >= fVolume->AgCount() || length == 0
+		|| length > fVolume->AgBlocks() - start) {
+		ERROR("BlockAllocator: cannot free bad extent %" B_PRIu64 ", %"
+			B_PRIu32 "\n", block, length);
+		return B_BAD_VALUE;
+	}
+
+	AllocationGroup group(transaction, number);
+	status_t status = group.Init();
+	if (status == B_OK)
+		status = _FillFreeList(group);
+	if (status != B_OK)
+		return status;
+
+	// Merging with both neighbours only removes records; otherwise a new
+	// record might split both trees
+	if (group.FreeListCount() < group.Levels(XFS_BTNUM_BNO)
+			+ group.Levels(XFS_BTNUM_CNT) + 2) {
+		return B_DEVICE_FULL;
+	}
+
+	FreeSpaceTree byBlock(group, XFS_BTNUM_BNO);
+	FreeSpaceTree bySize(group, XFS_BTNUM_CNT);
+
+	// find the free neighbours of the extent
+
+	FreeExtent extent = { start, length };
+	FreeExtent left = { 0, 0 };
+	FreeExtent right = { 0, 0 };
+	bool found;
+	status = byBlock.Lookup(extent, LOOKUP_LE, found);
+	if (status == B_OK && found) {
+		left = byBlock.Record();
+		if (left.start + left.count > start) {
+			ERROR("BlockAllocator: extent %" B_PRIu64 ", %" B_PRIu32 " is "
+				"already free\n", block, length);
+			return B_BAD_DATA;
+		}
+		if (left.start + left.count < start)
+			left.count = 0;
+	}
+	if (status == B_OK) {
+		bool hasLeft = found;
+		status = hasLeft ? byBlock.Next(found)
+			: byBlock.Lookup(extent, LOOKUP_GE, found);
+	}
+	if (status != B_OK)
+		return status;
+	if (found) {
+		right = byBlock.Record();
+		if (right.start < start + length) {
+			ERROR("BlockAllocator: extent %" B_PRIu64 ", %" B_PRIu32 " is "
+				"already free\n", block, length);
+			return B_BAD_DATA;
+		}
+		if (right.start > start + length)
+			right.count = 0;
+	}
+
+	FreeExtent merged = extent;
+	if (left.count > 0) {
+		merged.start = left.start;
+		merged.count += left.count;
+	}
+	merged.count += right.count;
+
+	// update the tree sorted by block number
+
+	if (left.count > 0) {
+		status = byBlock.Lookup(left, LOOKUP_EQ, found);
+		if (status == B_OK)
+			status = byBlock.Update(merged);
+		if (status == B_OK && right.count > 0) {
+			status = byBlock.Lookup(right, LOOKUP_EQ, found);
+			if (status == B_OK)
+				status = byBlock.Delete();
+		}
+	} else if (right.count > 0) {
+		status = byBlock.Lookup(right, LOOKUP_EQ, found);
+		if (status == B_OK)
+			status = byBlock.Update(merged);
+	} else {
+		status = byBlock.Lookup(merged, LOOKUP_LE, found);
+		if (status == B_OK)
+			status = byBlock.Insert(merged);
+	}
+	if (status != B_OK)
+		return status;
+
+	// and the one sorted by size
+
+	for (int32 i = 0; i < 2; i++) {
+		const FreeExtent& neighbour = i == 0 ? left : right;
+		if (neighbour.count == 0)
+			continue;
+
+		status = bySize.Lookup(neighbour, LOOKUP_EQ, found);
+		if (status != B_OK)
+			return status;
+		if (!found) {
+			ERROR("BlockAllocator: free space trees of group %" B_PRIu32 " do "
+				"not match\n", number);
+			return B_BAD_DATA;
+		}
+		status = bySize.Delete();
+		if (status != B_OK)
+			return status;
+	}
+
+	status = bySize.Lookup(merged, LOOKUP_LE, found);
+	if (status == B_OK)
+		status = bySize.Insert(merged);
+	if (status != B_OK)
+		return status;
+
+	// update the AGF
+
+	FreeExtent longest;
+	status = bySize.Last(longest, found);
+	if (status != B_OK)
+		return status;
+
+	group.SetFreeBlocks(group.FreeBlocks() + length);
+	group.SetLongest(found ? longest.count : 0);
+
+	transaction.AdjustCounters(length);
+	return B_OK;
+}
+
+
+/*!	Allocates exactly \a length blocks in the given allocation group, for
+	its own metadata. With an \a alignment, the extent starts at a multiple
+	of it within the group.
+*/
+status_t
+BlockAllocator::AllocateInGroup(Transaction& transaction,
+	xfs_agnumber_t group, uint32 length, uint32 alignment,
+	xfs_agblock_t& _block)
+{
+	if (group >= fVolume->AgCount() || length == 0
+		|| (alignment == 0 && length > 1)) {
+		return B_BAD_VALUE;
+	}
+
+	uint32 allocated;
+	status_t status = _AllocateInGroup(transaction, group, -1, length,
+		alignment, _block, allocated);
+	if (status != B_OK)
+		return status;
+
+	transaction.AdjustCounters(-(int64)allocated);
+	return B_OK;
+}
+
+
+status_t
+BlockAllocator::_AllocateInGroup(Transaction& transaction,
+	xfs_agnumber_t number, int64 target, uint32 maxLength, uint32 alignment,
+	xfs_agblock_t& _block, uint32& _length)
+{
+	AllocationGroup group(transaction, number);
+	status_t status = group.Init();
+	if (status != B_OK)
+		return status;
+
+	// Keep some space in every group for the metadata reservations Linux
+	// makes for its B+trees
+	uint32 reserved = ReservedBlocksPerGroup(fVolume->AgBlocks());
+	uint32 freeBlocks = group.FreeBlocks();
+	if (freeBlocks <= reserved)
+		return B_DEVICE_FULL;
+
+	status = _FillFreeList(group);
+	if (status != B_OK)
+		return status;
+
+	freeBlocks = group.FreeBlocks();
+	if (freeBlocks <= reserved
+		|| (alignment > 0 && freeBlocks - reserved < maxLength)) {
+		return B_DEVICE_FULL;
+	}
+	maxLength = min_c(maxLength, freeBlocks - reserved);
+
+	FreeSpaceTree byBlock(group, XFS_BTNUM_BNO);
+	FreeSpaceTree bySize(group, XFS_BTNUM_CNT);
+
+	// Tree blocks can only be taken from the AG free list; make sure it has
+	// enough blocks for the worst case, so that the trees are not left half
+	// updated. Inserting a record needs one block per level, plus one for
+	// a new root.
+	uint32 splitBlocksByBlock = group.Levels(XFS_BTNUM_BNO) + 1;
+	uint32 splitBlocksBySize = group.Levels(XFS_BTNUM_CNT) + 1;
+	if (group.FreeListCount() < splitBlocksBySize)
+		return B_DEVICE_FULL;
+
+	// find a free extent
+
+	FreeExtent extent;
+	uint32 start = 0;
+	uint32 length = 0;
+	bool found = false;
+
+	if (alignment > 0) {
+		// an extent of this size contains an aligned range wherever it
+		// starts
+		FreeExtent key = { 0, maxLength + alignment - 1 };
+		status = bySize.Lookup(key, LOOKUP_GE, found);
+		if (status != B_OK)
+			return status;
+		if (!found)
+			return B_DEVICE_FULL;
+
+		extent = bySize.Record();
+		start = (extent.start + alignment - 1) / alignment * alignment;
+		length = maxLength;
+		if (start > extent.start
+			&& start + length < extent.start + extent.count
+			&& group.FreeListCount() < splitBlocksBySize * 2
+				+ splitBlocksByBlock) {
+			return B_DEVICE_FULL;
+		}
+	} else if (target >= 0) {
+		FreeExtent key = { (uint32)target, 0 };
+		status = byBlock.Lookup(key, LOOKUP_LE, found);
+		if (status != B_OK)
+			return status;
+
+		if (found) {
+			extent = byBlock.Record();
+			found = extent.start + extent.count > (uint32)target;
+		}
+		if (found) {
+			start = target;
+			length = min_c(maxLength, extent.start + extent.count - start);
+
+			// Carving an extent out of the middle of a free one needs the
+			// most free list blocks, as both trees might have to be split
+			if (start > extent.start
+				&& start + length < extent.start + extent.count
+				&& group.FreeListCount() < splitBlocksBySize * 2
+					+ splitBlocksByBlock) {
+				found = false;
+			}
+		}
+	}
+
+	if (!found) {
+		// the smallest extent that is large enough, or the largest one
+		FreeExtent key = { 0, maxLength };
+		status = bySize.Lookup(key, LOOKUP_GE, found);
+		if (status != B_OK)
+			return status;
+
+		if (found)
+			extent = bySize.Record();
+		else {
+			status = bySize.Last(extent, found);
+			if (status != B_OK)
+				return status;
+			if (!found)
+				return B_DEVICE_FULL;
+		}
+
+		start = extent.start;
+		length = min_c(maxLength, extent.count);
+	}
+
+	if (length == 0)
+		return B_DEVICE_FULL;
+
+	// remove it from the tree sorted by block number
+
+	status = byBlock.Lookup(extent, LOOKUP_EQ, found);
+	if (status != B_OK)
+		return status;
+	if (!found || byBlock.Record().count != extent.count) {
+		ERROR("BlockAllocator: free space trees of group %" B_PRIu32 " do "
+			"not match\n", number);
+		return B_BAD_DATA;
+	}
+
+	uint32 end = start + length;
+	uint32 extentEnd = extent.start + extent.count;
+	FreeExtent head = { extent.start, start - extent.start };
+	FreeExtent tail = { end, extentEnd - end };
+
+	if (head.count == 0 && tail.count == 0)
+		status = byBlock.Delete();
+	else if (head.count == 0)
+		status = byBlock.Update(tail);
+	else {
+		status = byBlock.Update(head);
+		if (status == B_OK && tail.count > 0) {
+			status = byBlock.Lookup(tail, LOOKUP_LE, found);
+			if (status == B_OK)
+				status = byBlock.Insert(tail);
+		}
+	}
+	if (status != B_OK)
+		return status;
+
+	// and from the tree sorted by size
+
+	status = bySize.Lookup(extent, LOOKUP_EQ, found);
+	if (status != B_OK)
+		return status;
+	if (!found) {
+		ERROR("BlockAllocator: free space trees of group %" B_PRIu32 " do "
+			"not match\n", number);
+		return B_BAD_DATA;
+	}
+
+	status = bySize.Delete();
+	for (int32 i = 0; i < 2 && status == B_OK; i++) {
+		const FreeExtent& rest = i == 0 ? head : tail;
+		if (rest.count == 0)
+			continue;
+
+		status = bySize.Lookup(rest, LOOKUP_LE, found);
+		if (status == B_OK)
+			status = bySize.Insert(rest);
+	}
+	if (status != B_OK)
+		return status;
+
+	// update the AGF
+
+	FreeExtent longest;
+	status = bySize.Last(longest, found);
+	if (status != B_OK)
+		return status;
+
+	group.SetFreeBlocks(freeBlocks - length);
+	group.SetLongest(found ? longest.count : 0);
+
+	_block = start;
+	_length = length;
+	return B_OK;
+}
+
+
+/*!	Moves blocks from the end of the largest free extent to the AG free
+	list, so that it can serve a few splits of both free space B+trees.
+	The free list blocks still count as free in the superblock.
+*/
+status_t
+BlockAllocator::_FillFreeList(AllocationGroup& group)
+{
+	uint32 levels = group.Levels(XFS_BTNUM_BNO) + group.Levels(XFS_BTNUM_CNT);
+	uint32 wanted = min_c(2 * (levels + 2), group.FreeListSize());
+	uint32 count = group.FreeListCount();
+	if (count >= wanted / 2)
+		return B_OK;
+
+	// Shortening the largest extent only moves it in the tree sorted by
+	// size, which must not run out of blocks while doing so
+	if (count < group.Levels(XFS_BTNUM_CNT) + 1)
+		return B_OK;
+
+	FreeSpaceTree byBlock(group, XFS_BTNUM_BNO);
+	FreeSpaceTree bySize(group, XFS_BTNUM_CNT);
+
+	FreeExtent extent;
+	bool found;
+	status_t status = bySize.Last(extent, found);
+	if (status != B_OK || !found)
+		return status;
+
+	uint32 length = min_c(wanted - count, extent.count);
+	FreeExtent rest = { extent.start, extent.count - length };
+
+	status = bySize.Delete();
+	if (status == B_OK && rest.count > 0) {
+		status = bySize.Lookup(rest, LOOKUP_LE, found);
+		if (status == B_OK)
+			status = bySize.Insert(rest);
+	}
+	if (status == B_OK) {
+		status = byBlock.Lookup(extent, LOOKUP_EQ, found);
+		if (status == B_OK && (!found || byBlock.Record().count != extent.count))
+			status = B_BAD_DATA;
+	}
+	if (status == B_OK)
+		status = rest.count > 0 ? byBlock.Update(rest) : byBlock.Delete();
+	if (status != B_OK)
+		return status;
+
+	group.SetFreeBlocks(group.FreeBlocks() - length);
+
+	FreeExtent longest;
+	status = bySize.Last(longest, found);
+	if (status != B_OK)
+		return status;
+	group.SetLongest(found ? longest.count : 0);
+
+	for (uint32 i = 0; i < length && status == B_OK; i++)
+		status = group.PutOnFreeList(rest.start + rest.count + i);
+
+	return status;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _XFS_BLOCK_ALLOCATOR_H_
+#define _XFS_BLOCK_ALLOCATOR_H_
+
+
+#include "xfs.h"
+
+
+class AllocationGroup;
+class Transaction;
+class Volume;
+
+
+#define XFS_AGF_MAGIC			0x58414746
+#define XFS_AGFL_MAGIC			0x5841464c
+#define XFS_AGF_VERSION			1
+#define XFS_ABTB_MAGIC			0x41425442
+#define XFS_ABTB_CRC_MAGIC		0x41423342
+#define XFS_ABTC_MAGIC			0x41425443
+#define XFS_ABTC_CRC_MAGIC		0x41423343
+
+#define XFS_BTNUM_BNO			0
+#define XFS_BTNUM_CNT			1
+
+// offsets into the AGF
+#define XFS_AGF_ROOTS			16
+#define XFS_AGF_LEVELS			28
+#define XFS_AGF_FLFIRST			40
+#define XFS_AGF_FLLAST			44
+#define XFS_AGF_FLCOUNT			48
+#define XFS_AGF_FREEBLKS		52
+#define XFS_AGF_LONGEST			56
+#define XFS_AGF_BTREEBLKS		60
+#define XFS_AGF_UUID			64
+#define XFS_AGF_LSN				208
+#define XFS_AGF_CRC				216
+
+// offsets into the AGFL (version 5)
+#define XFS_AGFL_SEQNO			4
+#define XFS_AGFL_UUID			8
+#define XFS_AGFL_LSN			24
+#define XFS_AGFL_CRC			32
+#define XFS_AGFL_HEADER_SIZE	36
+
+
+/*!	Allocates and frees blocks in the free space B+trees of the allocation
+	groups. Each allocation group keeps its free extents twice, sorted by
+	block number, and sorted by size; both trees are updated within the
+	given transaction, together with the AGF. Blocks for growing the trees
+	come from the AG free list, which is refilled from the free space when
+	it runs low.
+*/
+class BlockAllocator {
+public:
+								BlockAllocator(Volume* volume);
+								~BlockAllocator();
+
+			status_t			Allocate(Transaction& transaction,
+									xfs_fsblock_t hint, bool contiguous,
+									uint32 maxLength, xfs_fsblock_t& _block,
+									uint32& _length);
+			status_t			AllocateInGroup(Transaction& transaction,
+									xfs_agnumber_t group, uint32 length,
+									uint32 alignment, xfs_agblock_t& _block);
+			status_t			Free(Transaction& transaction,
+									xfs_fsblock_t block, uint32 length);
+
+	static	uint32				ReservedBlocksPerGroup(
+									xfs_agblock_t groupBlocks)
+								{ return 16 + groupBlocks / 64; }
+									// never handed out, so that Linux
+									// can still grow its B+trees
+
+private:
+			status_t			_AllocateInGroup(Transaction& transaction,
+									xfs_agnumber_t group, int64 target,
+									uint32 maxLength, uint32 alignment,
+									xfs_agblock_t& _block, uint32& _length);
+			status_t			_FillFreeList(AllocationGroup& group);
+
+private:
+			Volume*				fVolume;
+};
+
+
+#endif	// _XFS_BLOCK_ALLOCATOR_H_
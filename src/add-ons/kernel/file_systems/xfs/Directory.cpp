@@ -17,6 +17,34 @@ DirectoryIterator::~DirectoryIterator()
 }
 
 
+/*!	Only short form and block directories can be changed so far. */
+status_t
+DirectoryIterator::AddEntry(Transaction& transaction, const char* name,
+	size_t length, xfs_ino_t id, uint8 fileType)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
+status_t
+DirectoryIterator::RemoveEntry(Transaction& transaction, const char* name,
+	size_t length, xfs_ino_t& _id)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
+/*!	Points the existing entry \a name to another inode. For "..", this
+	changes the parent directory.
+*/
+status_t
+DirectoryIterator::ReplaceEntry(Transaction& transaction, const char* name,
+	size_t length, xfs_ino_t id, uint8 fileType, xfs_ino_t& _oldId)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
 DirectoryIterator*
 DirectoryIterator::Init(Inode* inode)
 {
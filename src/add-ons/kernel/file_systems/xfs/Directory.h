@@ -23,6 +23,18 @@ public:
 			virtual	status_t			Lookup(const char* name, size_t length,
 											xfs_ino_t* id)								=	0;
 
+			// Changing the directory, the caller has to log its inode
+			virtual	status_t			AddEntry(Transaction& transaction,
+											const char* name, size_t length,
+											xfs_ino_t id, uint8 fileType);
+			virtual	status_t			RemoveEntry(Transaction& transaction,
+											const char* name, size_t length,
+											xfs_ino_t& _id);
+			virtual	status_t			ReplaceEntry(Transaction& transaction,
+											const char* name, size_t length,
+											xfs_ino_t id, uint8 fileType,
+											xfs_ino_t& _oldId);
+
 			static DirectoryIterator*	Init(Inode* inode);
 };
 
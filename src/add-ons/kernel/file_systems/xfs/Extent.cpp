@@ -10,16 +10,302 @@
 #include "VerifyHeader.h"
 
 
+/*
+	The helpers below change a directory block in place: data entries and
+	unused regions fill the space after the header, each ending in a tag
+	with its own offset. The leaf entries, sorted by hash, and the tail
+	follow at the end of the block.
+*/
+
+
+static inline uint16
+read_tag(const uint8* block, uint32 offset)
+{
+	return B_BENDIAN_TO_HOST_INT16(*(const uint16*)(block + offset));
+}
+
+
+static inline ExtentBlockTail*
+block_tail(Inode* directory, const uint8* block)
+{
+	return (ExtentBlockTail*)(block + directory->DirBlockSize()
+		- sizeof(ExtentBlockTail));
+}
+
+
+/*!	Returns the offset of the first leaf entry, where the data ends. */
+static uint32
+leaf_start(Inode* directory, const uint8* block)
+{
+	return directory->DirBlockSize() - sizeof(ExtentBlockTail)
+		- B_BENDIAN_TO_HOST_INT32(block_tail(directory, block)->count)
+			* sizeof(ExtentLeafEntry);
+}
+
+
+static inline bool
+is_unused(const uint8* block, uint32 offset)
+{
+	return read_tag(block, offset) == DIR2_FREE_TAG;
+}
+
+
+static uint32
+item_size(Inode* directory, const uint8* block, uint32 offset)
+{
+	if (is_unused(block, offset))
+		return read_tag(block, offset + offsetof(ExtentUnusedEntry, length));
+
+	return Extent::DataEntrySize(directory,
+		((const ExtentDataEntry*)(block + offset))->namelen);
+}
+
+
+static void
+write_unused(uint8* block, uint32 offset, uint32 length)
+{
+	ExtentUnusedEntry* unused = (ExtentUnusedEntry*)(block + offset);
+	unused->freetag = B_HOST_TO_BENDIAN_INT16(DIR2_FREE_TAG);
+	unused->length = B_HOST_TO_BENDIAN_INT16(length);
+	*(uint16*)(block + offset + length - sizeof(uint16))
+		= B_HOST_TO_BENDIAN_INT16(offset);
+}
+
+
+static void
+write_entry(Inode* directory, uint8* block, uint32 offset, const char* name,
+	size_t length, xfs_ino_t id, uint8 fileType)
+{
+	uint32 size = Extent::DataEntrySize(directory, length);
+	memset(block + offset, 0, size);
+
+	ExtentDataEntry* entry = (ExtentDataEntry*)(block + offset);
+	entry->inumber = B_HOST_TO_BENDIAN_INT64(id);
+	entry->namelen = length;
+	memcpy(entry->name, name, length);
+	if (directory->HasFileTypeField())
+		entry->name[length] = fileType;
+	*(uint16*)(block + offset + size - sizeof(uint16))
+		= B_HOST_TO_BENDIAN_INT16(offset);
+}
+
+
+/*!	Makes sure the block can be changed safely: the data entries and unused
+	regions have to add up to the start of the leaf entries, and there have
+	to be as many data entries as live leaf entries.
+*/
+static status_t
+check_block(Inode* directory, const uint8* block)
+{
+	uint32 headerSize = ExtentDataHeader::Size(directory);
+	ExtentBlockTail* tail = block_tail(directory, block);
+	uint32 count = B_BENDIAN_TO_HOST_INT32(tail->count);
+	uint32 stale = B_BENDIAN_TO_HOST_INT32(tail->stale);
+	if (stale > count || headerSize + (uint64)count * sizeof(ExtentLeafEntry)
+			+ sizeof(ExtentBlockTail) > directory->DirBlockSize()) {
+		return B_BAD_DATA;
+	}
+
+	uint32 end = leaf_start(directory, block);
+	uint32 entries = 0;
+	uint32 offset = headerSize;
+	while (offset < end) {
+		uint32 size = item_size(directory, block, offset);
+		if (size == 0 || size % 8 != 0 || offset + size > end
+			|| read_tag(block, offset + size - sizeof(uint16)) != offset) {
+			return B_BAD_DATA;
+		}
+
+		if (!is_unused(block, offset))
+			entries++;
+		offset += size;
+	}
+
+	if (offset != end || entries != count - stale)
+		return B_BAD_DATA;
+
+	return B_OK;
+}
+
+
+/*!	Rebuilds the list of the three largest unused regions in the header.
+	Like Linux, it prefers the first of equally large regions.
+*/
+static void
+update_best_free(Inode* directory, uint8* block)
+{
+	FreeRegion* bestFree = (FreeRegion*)(block + (directory->Version() == 3
+		? offsetof(ExtentDataHeaderV5::OnDiskData, bestfree)
+		: offsetof(ExtentDataHeaderV4::OnDiskData, bestfree)));
+	memset(bestFree, 0, sizeof(FreeRegion) * XFS_DIR2_DATA_FD_COUNT);
+
+	uint32 end = leaf_start(directory, block);
+	uint32 offset = ExtentDataHeader::Size(directory);
+	for (; offset < end; offset += item_size(directory, block, offset)) {
+		if (!is_unused(block, offset))
+			continue;
+
+		uint16 length = item_size(directory, block, offset);
+		int32 index = 0;
+		while (index < XFS_DIR2_DATA_FD_COUNT
+			&& length <= B_BENDIAN_TO_HOST_INT16(bestFree[index].length)) {
+			index++;
+		}
+		if (index == XFS_DIR2_DATA_FD_COUNT)
+			continue;
+
+		memmove(&bestFree[index + 1], &bestFree[index],
+			(XFS_DIR2_DATA_FD_COUNT - 1 - index) * sizeof(FreeRegion));
+		bestFree[index].offset = B_HOST_TO_BENDIAN_INT16(offset);
+		bestFree[index].length = B_HOST_TO_BENDIAN_INT16(length);
+	}
+}
+
+
+static status_t
+find_entry(Inode* directory, const uint8* block, const char* name,
+	size_t length, int32& _leaf)
+{
+	ExtentBlockTail* tail = block_tail(directory, block);
+	ExtentLeafEntry* leaves
+		= (ExtentLeafEntry*)(block + leaf_start(directory, block));
+	int count = B_BENDIAN_TO_HOST_INT32(tail->count);
+	uint32 hash = hashfunction(name, length);
+
+	int left = 0;
+	int right = count;
+	hashLowerBound<ExtentLeafEntry>(leaves, left, right, hash);
+
+	for (; left < count && B_BENDIAN_TO_HOST_INT32(leaves[left].hashval)
+			== hash; left++) {
+		uint32 address = B_BENDIAN_TO_HOST_INT32(leaves[left].address);
+		if (address == 0)
+			continue;
+
+		const ExtentDataEntry* entry = (const ExtentDataEntry*)(block
+			+ ((address << 3) & (directory->DirBlockSize() - 1)));
+		if (entry->namelen == length
+			&& memcmp(name, entry->name, length) == 0) {
+			_leaf = left;
+			return B_OK;
+		}
+	}
+
+	return B_ENTRY_NOT_FOUND;
+}
+
+
+/*!	Removes the stale leaf entries; the space becomes part of the data. */
+static void
+compact_leaves(Inode* directory, uint8* block)
+{
+	ExtentBlockTail* tail = block_tail(directory, block);
+	uint32 count = B_BENDIAN_TO_HOST_INT32(tail->count);
+	uint32 stale = B_BENDIAN_TO_HOST_INT32(tail->stale);
+	uint32 oldStart = leaf_start(directory, block);
+	ExtentLeafEntry* leaves = (ExtentLeafEntry*)(block + oldStart);
+
+	// the live entries keep their order, and move towards the tail
+	uint32 target = count;
+	for (int32 i = count - 1; i >= 0; i--) {
+		if (leaves[i].address != 0)
+			leaves[--target] = leaves[i];
+	}
+
+	tail->count = B_HOST_TO_BENDIAN_INT32(count - stale);
+	tail->stale = 0;
+
+	uint32 start = oldStart;
+	uint16 previous = read_tag(block, oldStart - sizeof(uint16));
+	if (previous < oldStart && is_unused(block, previous)
+		&& previous + item_size(directory, block, previous) == oldStart) {
+		start = previous;
+	}
+	write_unused(block, start, leaf_start(directory, block) - start);
+}
+
+
+static status_t
+add_entry(Inode* directory, uint8* block, const char* name, size_t length,
+	xfs_ino_t id, uint8 fileType)
+{
+	ExtentBlockTail* tail = block_tail(directory, block);
+	if (tail->stale != 0)
+		compact_leaves(directory, block);
+
+	// the new leaf entry takes its space from the end of the data, which
+	// has to be unused
+	uint32 size = Extent::DataEntrySize(directory, length);
+	uint32 end = leaf_start(directory, block);
+	uint32 last = 0;
+	uint32 target = 0;
+	uint32 targetSize = 0;
+	uint32 offset = ExtentDataHeader::Size(directory);
+	for (; offset < end; offset += item_size(directory, block, offset)) {
+		last = offset;
+		if (target != 0 || !is_unused(block, offset))
+			continue;
+
+		uint32 available = item_size(directory, block, offset);
+		if (offset + available == end)
+			available -= sizeof(ExtentLeafEntry);
+		if (available >= size) {
+			target = offset;
+			targetSize = available;
+		}
+	}
+	if (last == 0 || !is_unused(block, last)
+		|| item_size(directory, block, last) < sizeof(ExtentLeafEntry)
+		|| target == 0) {
+		return B_DEVICE_FULL;
+	}
+
+	uint32 lastSize = item_size(directory, block, last)
+		- sizeof(ExtentLeafEntry);
+	if (lastSize > 0)
+		write_unused(block, last, lastSize);
+
+	if (targetSize > size)
+		write_unused(block, target + size, targetSize - size);
+	write_entry(directory, block, target, name, length, id, fileType);
+
+	// insert the leaf entry after those with the same or a lower hash
+	uint32 hash = hashfunction(name, length);
+	uint32 count = B_BENDIAN_TO_HOST_INT32(tail->count);
+	ExtentLeafEntry* leaves = (ExtentLeafEntry*)(block + end);
+	uint32 index = 0;
+	while (index < count
+		&& B_BENDIAN_TO_HOST_INT32(leaves[index].hashval) <= hash) {
+		index++;
+	}
+
+	// the leaf entries before it move down into the space given up by the
+	// data
+	ExtentLeafEntry* newLeaves = leaves - 1;
+	memmove(newLeaves, leaves, index * sizeof(ExtentLeafEntry));
+	newLeaves[index].hashval = B_HOST_TO_BENDIAN_INT32(hash);
+	newLeaves[index].address = B_HOST_TO_BENDIAN_INT32(target >> 3);
+	tail->count = B_HOST_TO_BENDIAN_INT32(count + 1);
+
+	update_best_free(directory, block);
+	return B_OK;
+}
+
+
 Extent::Extent(Inode* inode)
 	:
 	fInode(inode),
-	fOffset(0)
+	fMap(NULL),
+	fOffset(0),
+	fBlockBuffer(NULL)
 {
 }
 
 
 Extent::~Extent()
 {
+	delete fMap;
+	delete[] fBlockBuffer;
 }
 
 
@@ -139,9 +425,17 @@ Extent::IsBlockType()
 int
 Extent::EntrySize(int len) const
 {
-	int entrySize = sizeof(xfs_ino_t) + sizeof(uint8) + len + sizeof(uint16);
+	return DataEntrySize(fInode, len);
+}
+
+
+/*static*/ int
+Extent::DataEntrySize(Inode* inode, int length)
+{
+	int entrySize = sizeof(xfs_ino_t) + sizeof(uint8) + length
+		+ sizeof(uint16);
 			// uint16 is for the tag
-	if (fInode->HasFileTypeField())
+	if (inode->HasFileTypeField())
 		entrySize += sizeof(uint8);
 
 	return (entrySize + 7) & -8;
@@ -232,8 +526,8 @@ Extent::Lookup(const char* name, size_t length, xfs_ino_t* ino)
 		TRACE("offset:(%" B_PRIu32 ")\n", offset);
 		ExtentDataEntry* entry = (ExtentDataEntry*)(fBlockBuffer + offset);
 
-		int retVal = strncmp(name, (char*)entry->name, entry->namelen);
-		if (retVal == 0) {
+		if (entry->namelen == length
+			&& memcmp(name, entry->name, length) == 0) {
 			*ino = B_BENDIAN_TO_HOST_INT64(entry->inumber);
 			TRACE("ino:(%" B_PRIu64 ")\n", *ino);
 			return B_OK;
@@ -244,6 +538,210 @@ Extent::Lookup(const char* name, size_t length, xfs_ino_t* ino)
 	return B_ENTRY_NOT_FOUND;
 }
 
+status_t
+Extent::AddEntry(Transaction& transaction, const char* name, size_t length,
+	xfs_ino_t id, uint8 fileType)
+{
+	TransactionBuffer* buffer;
+	status_t status = _GetBlock(transaction, buffer);
+	if (status != B_OK)
+		return status;
+
+	int32 leaf;
+	if (find_entry(fInode, buffer->data, name, length, leaf) == B_OK)
+		return B_FILE_EXISTS;
+
+	return AddToBlock(transaction, fInode, buffer, name, length, id,
+		fileType);
+}
+
+
+status_t
+Extent::RemoveEntry(Transaction& transaction, const char* name,
+	size_t length, xfs_ino_t& _id)
+{
+	TransactionBuffer* buffer;
+	status_t status = _GetBlock(transaction, buffer);
+	if (status != B_OK)
+		return status;
+
+	uint8* block = buffer->data;
+	int32 leaf;
+	status = find_entry(fInode, block, name, length, leaf);
+	if (status != B_OK)
+		return status;
+
+	ExtentBlockTail* tail = block_tail(fInode, block);
+	ExtentLeafEntry* leaves
+		= (ExtentLeafEntry*)(block + leaf_start(fInode, block));
+	uint32 offset = GetOffsetFromAddress(
+		B_BENDIAN_TO_HOST_INT32(leaves[leaf].address));
+	ExtentDataEntry* entry = (ExtentDataEntry*)(block + offset);
+	_id = B_BENDIAN_TO_HOST_INT64(entry->inumber);
+
+	// the entry becomes unused, together with unused neighbours
+	uint32 end = leaf_start(fInode, block);
+	uint32 start = offset;
+	uint32 next = offset + EntrySize(entry->namelen);
+	if (next < end && is_unused(block, next))
+		next += item_size(fInode, block, next);
+	if (start > ExtentDataHeader::Size(fInode)) {
+		uint16 previous = read_tag(block, start - sizeof(uint16));
+		if (previous < start && is_unused(block, previous)
+			&& previous + item_size(fInode, block, previous) == start) {
+			start = previous;
+		}
+	}
+	write_unused(block, start, next - start);
+
+	// the leaf entry stays until the space is needed
+	leaves[leaf].address = 0;
+	tail->stale = B_HOST_TO_BENDIAN_INT32(
+		B_BENDIAN_TO_HOST_INT32(tail->stale) + 1);
+
+	update_best_free(fInode, block);
+	transaction.MarkDirty(buffer, 0, buffer->size);
+	return B_OK;
+}
+
+
+status_t
+Extent::ReplaceEntry(Transaction& transaction, const char* name,
+	size_t length, xfs_ino_t id, uint8 fileType, xfs_ino_t& _oldId)
+{
+	TransactionBuffer* buffer;
+	status_t status = _GetBlock(transaction, buffer);
+	if (status != B_OK)
+		return status;
+
+	uint8* block = buffer->data;
+	int32 leaf;
+	status = find_entry(fInode, block, name, length, leaf);
+	if (status != B_OK)
+		return status;
+
+	ExtentLeafEntry* leaves
+		= (ExtentLeafEntry*)(block + leaf_start(fInode, block));
+	uint32 offset = GetOffsetFromAddress(
+		B_BENDIAN_TO_HOST_INT32(leaves[leaf].address));
+	ExtentDataEntry* entry = (ExtentDataEntry*)(block + offset);
+	_oldId = B_BENDIAN_TO_HOST_INT64(entry->inumber);
+
+	entry->inumber = B_HOST_TO_BENDIAN_INT64(id);
+	if (fInode->HasFileTypeField())
+		entry->name[entry->namelen] = fileType;
+
+	transaction.MarkDirty(buffer, offset, EntrySize(entry->namelen));
+	return B_OK;
+}
+
+
+/*!	Starts a new directory block at \a block, that only contains the "."
+	and ".." entries.
+*/
+/*static*/ status_t
+Extent::InitBlock(Transaction& transaction, Inode* directory,
+	xfs_fsblock_t block, xfs_ino_t parent, TransactionBuffer*& _buffer)
+{
+	bool version5 = directory->Version() == 3;
+	uint32 blockSize = directory->DirBlockSize();
+	off_t offset = directory->FileSystemBlockToAddr(block);
+
+	status_t status = transaction.GetBuffer(offset, blockSize,
+		XFS_BLFT_DIR_BLOCK_BUF, version5 ? ExtentDataHeader::CRCOffset() : -1,
+		version5 ? offsetof(ExtentDataHeaderV5::OnDiskData, lsn) : -1,
+		_buffer);
+	if (status != B_OK)
+		return status;
+
+	uint8* data = _buffer->data;
+	memset(data, 0, blockSize);
+	if (version5) {
+		ExtentDataHeaderV5::OnDiskData* header
+			= (ExtentDataHeaderV5::OnDiskData*)data;
+		header->magic = B_HOST_TO_BENDIAN_INT32(DIR3_BLOCK_HEADER_MAGIC);
+		header->blkno = B_HOST_TO_BENDIAN_INT64(offset / XFS_MIN_BLOCKSIZE);
+		memcpy(&header->uuid, &directory->GetVolume()->SuperBlock().MetaUuid(),
+			sizeof(uuid_t));
+		header->owner = B_HOST_TO_BENDIAN_INT64(directory->ID());
+	} else {
+		*(uint32*)data = B_HOST_TO_BENDIAN_INT32(DIR2_BLOCK_HEADER_MAGIC);
+	}
+
+	uint32 headerSize = ExtentDataHeader::Size(directory);
+	write_unused(data, headerSize,
+		blockSize - sizeof(ExtentBlockTail) - headerSize);
+
+	_buffer->verified = true;
+
+	status = AddToBlock(transaction, directory, _buffer, ".", 1,
+		directory->ID(), XFS_DIR3_FT_DIR);
+	if (status == B_OK) {
+		status = AddToBlock(transaction, directory, _buffer, "..", 2, parent,
+			XFS_DIR3_FT_DIR);
+	}
+	return status;
+}
+
+
+/*!	Adds an entry to the directory block in \a buffer. Fails with
+	B_NOT_SUPPORTED if it is full, as the directory would have to be
+	converted to the leaf format.
+*/
+/*static*/ status_t
+Extent::AddToBlock(Transaction& transaction, Inode* directory,
+	TransactionBuffer* buffer, const char* name, size_t length,
+	xfs_ino_t id, uint8 fileType)
+{
+	status_t status = add_entry(directory, buffer->data, name, length, id,
+		fileType);
+	if (status == B_DEVICE_FULL) {
+		ERROR("Extent: directory %" B_PRIu64 " is full, leaf directories "
+			"are not supported yet\n", directory->ID());
+		return B_NOT_SUPPORTED;
+	}
+	if (status != B_OK)
+		return status;
+
+	transaction.MarkDirty(buffer, 0, buffer->size);
+	return B_OK;
+}
+
+
+/*!	Returns the directory block as seen by the transaction, after making
+	sure it is intact.
+*/
+status_t
+Extent::_GetBlock(Transaction& transaction, TransactionBuffer*& _buffer)
+{
+	bool version5 = fInode->Version() == 3;
+	status_t status = transaction.GetBuffer(
+		fInode->FileSystemBlockToAddr(fMap->br_startblock),
+		fInode->DirBlockSize(), XFS_BLFT_DIR_BLOCK_BUF,
+		version5 ? ExtentDataHeader::CRCOffset() : -1,
+		version5 ? offsetof(ExtentDataHeaderV5::OnDiskData, lsn) : -1,
+		_buffer);
+	if (status != B_OK || _buffer->verified)
+		return status;
+
+	ExtentDataHeader* header = ExtentDataHeader::Create(fInode,
+		(const char*)_buffer->data);
+	if (header == NULL)
+		return B_NO_MEMORY;
+
+	bool valid = VerifyHeader<ExtentDataHeader>(header,
+		(char*)_buffer->data, fInode, 0, fMap, XFS_BLOCK);
+	delete header;
+	if (!valid || check_block(fInode, _buffer->data) != B_OK) {
+		ERROR("Extent: directory block of %" B_PRIu64 " is corrupted\n",
+			fInode->ID());
+		return B_BAD_DATA;
+	}
+
+	_buffer->verified = true;
+	return B_OK;
+}
+
 
 ExtentDataHeader::~ExtentDataHeader()
 {
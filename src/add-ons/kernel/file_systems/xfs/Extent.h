@@ -169,10 +169,37 @@ public:
 			xfs_ino_t			GetIno();
 			uint32				GetOffsetFromAddress(uint32 address);
 			int					EntrySize(int len) const;
+	static	int					DataEntrySize(Inode* inode, int length);
 			status_t			GetNext(char* name, size_t* length,
 									xfs_ino_t* ino);
 			status_t			Lookup(const char* name, size_t length,
 									xfs_ino_t* id);
+
+			status_t			AddEntry(Transaction& transaction,
+									const char* name, size_t length,
+									xfs_ino_t id, uint8 fileType);
+			status_t			RemoveEntry(Transaction& transaction,
+									const char* name, size_t length,
+									xfs_ino_t& _id);
+			status_t			ReplaceEntry(Transaction& transaction,
+									const char* name, size_t length,
+									xfs_ino_t id, uint8 fileType,
+									xfs_ino_t& _oldId);
+
+	static	status_t			InitBlock(Transaction& transaction,
+									Inode* directory, xfs_fsblock_t block,
+									xfs_ino_t parent,
+									TransactionBuffer*& _buffer);
+	static	status_t			AddToBlock(Transaction& transaction,
+									Inode* directory,
+									TransactionBuffer* buffer,
+									const char* name, size_t length,
+									xfs_ino_t id, uint8 fileType);
+
+private:
+			status_t			_GetBlock(Transaction& transaction,
+									TransactionBuffer*& _buffer);
+
 private:
 			Inode*				fInode;
 			ExtentMapEntry*		fMap;
@@ -8,85 +8,301 @@
 #include "Inode.h"
 
 #include "BPlusTree.h"
+#include "BlockAllocator.h"
+#include "Checksum.h"
+#include "InodeAllocator.h"
+#include "Journal.h"
 #include "VerifyHeader.h"
 
 
+static const int64 kBigtimeEpochOffset = 1LL << 31;
+	// bigtime timestamps start at the lowest 32 bit time_t value
+static const int64 kNanoseconds = 1000000000LL;
+static const uint32 kLogDinodeV2Size = 96;
+	// the log inode core of version 2 inodes ends before di_next_unlinked
+
+
+struct log_dinode_field {
+	uint8	offset;
+	uint8	size;
+};
+
+// the fields of the inode core that need to be swapped to get the log
+// inode core, without the timestamps
+static const log_dinode_field kLogDinodeFields[] = {
+	{0, 2}, {2, 2}, {6, 2}, {8, 4}, {12, 4}, {16, 4}, {20, 2}, {22, 2},
+	{30, 2}, {56, 8}, {64, 8}, {72, 4}, {76, 4}, {80, 2}, {84, 4}, {88, 2},
+	{90, 2}, {92, 4}, {96, 4}, {104, 8}, {112, 8}, {120, 8}, {128, 4},
+	{152, 8}
+};
+static const uint8 kLogDinodeTimestamps[] = {32, 40, 48, 144};
+
+
+/*!	Returns the index of the first extent that ends after \a block. */
+static int32
+find_extent(const ExtentMapEntry* extents, int32 count, xfs_fileoff_t block)
+{
+	int32 low = 0;
+	int32 high = count;
+	while (low < high) {
+		int32 middle = (low + high) / 2;
+		if (extents[middle].br_startoff + extents[middle].br_blockcount
+				<= block) {
+			low = middle + 1;
+		} else
+			high = middle;
+	}
+
+	return low;
+}
+
+
+/*!	Returns how many blocks of the range [\a start, \a end) are holes. */
+static xfs_filblks_t
+count_holes(const ExtentMapEntry* extents, int32 count, xfs_fileoff_t start,
+	xfs_fileoff_t end)
+{
+	xfs_filblks_t holes = end - start;
+	for (int32 i = find_extent(extents, count, start);
+			i < count && extents[i].br_startoff < end; i++) {
+		xfs_fileoff_t first = max_c(start, extents[i].br_startoff);
+		xfs_fileoff_t last = min_c(end,
+			extents[i].br_startoff + extents[i].br_blockcount);
+		holes -= last - first;
+	}
+
+	return holes;
+}
+
+
+static bool
+can_merge_extents(const ExtentMapEntry& first, const ExtentMapEntry& second)
+{
+	return first.br_state == second.br_state
+		&& first.br_startoff + first.br_blockcount == second.br_startoff
+		&& first.br_startblock + first.br_blockcount == second.br_startblock
+		&& first.br_blockcount + second.br_blockcount <= XFS_MAX_EXTENT_LENGTH;
+}
+
+
+/*!	Merges adjacent extents, and returns the new number of extents. */
+static int32
+merge_extents(ExtentMapEntry* extents, int32 count)
+{
+	if (count == 0)
+		return 0;
+
+	int32 last = 0;
+	for (int32 i = 1; i < count; i++) {
+		if (can_merge_extents(extents[last], extents[i]))
+			extents[last].br_blockcount += extents[i].br_blockcount;
+		else
+			extents[++last] = extents[i];
+	}
+
+	return last + 1;
+}
+
+
+/*!	Converts the inode core between the on-disk big-endian format and host
+	order, in either direction.
+*/
 void
-Inode::SwapEndian()
-{
-	fNode->di_magic = B_BENDIAN_TO_HOST_INT16(fNode->di_magic);
-	fNode->di_mode = B_BENDIAN_TO_HOST_INT16(fNode->di_mode);
-	fNode->di_onlink = B_BENDIAN_TO_HOST_INT16(fNode->di_onlink);
-	fNode->di_uid = B_BENDIAN_TO_HOST_INT32(fNode->di_uid);
-	fNode->di_gid = B_BENDIAN_TO_HOST_INT32(fNode->di_gid);
-	fNode->di_nlink = B_BENDIAN_TO_HOST_INT32(fNode->di_nlink);
-	fNode->di_projid = B_BENDIAN_TO_HOST_INT16(fNode->di_projid);
-	fNode->di_flushiter = B_BENDIAN_TO_HOST_INT16(fNode->di_flushiter);
-	fNode->di_atime.t_sec = B_BENDIAN_TO_HOST_INT32(fNode->di_atime.t_sec);
-	fNode->di_atime.t_nsec = B_BENDIAN_TO_HOST_INT32(fNode->di_atime.t_nsec);
-	fNode->di_mtime.t_sec = B_BENDIAN_TO_HOST_INT32(fNode->di_mtime.t_sec);
-	fNode->di_mtime.t_nsec = B_BENDIAN_TO_HOST_INT32(fNode->di_mtime.t_nsec);
-	fNode->di_ctime.t_sec = B_BENDIAN_TO_HOST_INT32(fNode->di_ctime.t_sec);
-	fNode->di_ctime.t_nsec = B_BENDIAN_TO_HOST_INT32(fNode->di_ctime.t_nsec);
-	fNode->di_size = B_BENDIAN_TO_HOST_INT64(fNode->di_size);
-	fNode->di_nblocks = B_BENDIAN_TO_HOST_INT64(fNode->di_nblocks);
-	fNode->di_extsize = B_BENDIAN_TO_HOST_INT32(fNode->di_extsize);
-	fNode->di_nextents = B_BENDIAN_TO_HOST_INT32(fNode->di_nextents);
-	fNode->di_naextents = B_BENDIAN_TO_HOST_INT16(fNode->di_naextents);
-	fNode->di_dmevmask = B_BENDIAN_TO_HOST_INT32(fNode->di_dmevmask);
-	fNode->di_dmstate = B_BENDIAN_TO_HOST_INT16(fNode->di_dmstate);
-	fNode->di_flags = B_BENDIAN_TO_HOST_INT16(fNode->di_flags);
-	fNode->di_gen = B_BENDIAN_TO_HOST_INT32(fNode->di_gen);
-	fNode->di_next_unlinked = B_BENDIAN_TO_HOST_INT32(fNode->di_next_unlinked);
-	fNode->di_changecount = B_BENDIAN_TO_HOST_INT64(fNode->di_changecount);
-	fNode->di_lsn = B_BENDIAN_TO_HOST_INT64(fNode->di_lsn);
-	fNode->di_flags2 = B_BENDIAN_TO_HOST_INT64(fNode->di_flags2);
-	fNode->di_cowextsize = B_BENDIAN_TO_HOST_INT64(fNode->di_cowextsize);
-	fNode->di_crtime.t_sec = B_BENDIAN_TO_HOST_INT32(fNode->di_crtime.t_sec);
-	fNode->di_crtime.t_nsec = B_BENDIAN_TO_HOST_INT32(fNode->di_crtime.t_nsec);
-	fNode->di_ino = B_BENDIAN_TO_HOST_INT64(fNode->di_ino);
+Inode::_SwapEndian(Dinode* node)
+{
+	node->di_magic = B_BENDIAN_TO_HOST_INT16(node->di_magic);
+	node->di_mode = B_BENDIAN_TO_HOST_INT16(node->di_mode);
+	node->di_onlink = B_BENDIAN_TO_HOST_INT16(node->di_onlink);
+	node->di_uid = B_BENDIAN_TO_HOST_INT32(node->di_uid);
+	node->di_gid = B_BENDIAN_TO_HOST_INT32(node->di_gid);
+	node->di_nlink = B_BENDIAN_TO_HOST_INT32(node->di_nlink);
+	node->di_projid = B_BENDIAN_TO_HOST_INT16(node->di_projid);
+	node->di_flushiter = B_BENDIAN_TO_HOST_INT16(node->di_flushiter);
+	node->di_atime.t_sec = B_BENDIAN_TO_HOST_INT32(node->di_atime.t_sec);
+	node->di_atime.t_nsec = B_BENDIAN_TO_HOST_INT32(node->di_atime.t_nsec);
+	node->di_mtime.t_sec = B_BENDIAN_TO_HOST_INT32(node->di_mtime.t_sec);
+	node->di_mtime.t_nsec = B_BENDIAN_TO_HOST_INT32(node->di_mtime.t_nsec);
+	node->di_ctime.t_sec = B_BENDIAN_TO_HOST_INT32(node->di_ctime.t_sec);
+	node->di_ctime.t_nsec = B_BENDIAN_TO_HOST_INT32(node->di_ctime.t_nsec);
+	node->di_size = B_BENDIAN_TO_HOST_INT64(node->di_size);
+	node->di_nblocks = B_BENDIAN_TO_HOST_INT64(node->di_nblocks);
+	node->di_extsize = B_BENDIAN_TO_HOST_INT32(node->di_extsize);
+	node->di_nextents = B_BENDIAN_TO_HOST_INT32(node->di_nextents);
+	node->di_naextents = B_BENDIAN_TO_HOST_INT16(node->di_naextents);
+	node->di_dmevmask = B_BENDIAN_TO_HOST_INT32(node->di_dmevmask);
+	node->di_dmstate = B_BENDIAN_TO_HOST_INT16(node->di_dmstate);
+	node->di_flags = B_BENDIAN_TO_HOST_INT16(node->di_flags);
+	node->di_gen = B_BENDIAN_TO_HOST_INT32(node->di_gen);
+	node->di_next_unlinked
+		= B_BENDIAN_TO_HOST_INT32(node->di_next_unlinked);
+	node->di_changecount = B_BENDIAN_TO_HOST_INT64(node->di_changecount);
+	node->di_lsn = B_BENDIAN_TO_HOST_INT64(node->di_lsn);
+	node->di_flags2 = B_BENDIAN_TO_HOST_INT64(node->di_flags2);
+	node->di_cowextsize = B_BENDIAN_TO_HOST_INT32(node->di_cowextsize);
+	node->di_crtime.t_sec = B_BENDIAN_TO_HOST_INT32(node->di_crtime.t_sec);
+	node->di_crtime.t_nsec = B_BENDIAN_TO_HOST_INT32(node->di_crtime.t_nsec);
+	node->di_ino = B_BENDIAN_TO_HOST_INT64(node->di_ino);
 }
 
 
 void
 Inode::GetModificationTime(struct timespec& stamp) const
 {
-	stamp.tv_sec = fNode->di_mtime.t_sec;
-	stamp.tv_nsec = fNode->di_mtime.t_nsec;
+	_GetTimestamp(fNode->di_mtime, stamp);
 }
 
 
 void
 Inode::GetAccessTime(struct timespec& stamp) const
 {
-	stamp.tv_sec = fNode->di_atime.t_sec;
-	stamp.tv_nsec = fNode->di_atime.t_nsec;
+	_GetTimestamp(fNode->di_atime, stamp);
 }
 
 
 void
 Inode::GetChangeTime(struct timespec& stamp) const
 {
-	stamp.tv_sec = fNode->di_ctime.t_sec;
-	stamp.tv_nsec = fNode->di_ctime.t_nsec;
+	_GetTimestamp(fNode->di_ctime, stamp);
 }
 
 
 void
 Inode::GetCreationTime(struct timespec& stamp) const
 {
-	stamp.tv_sec = fNode->di_crtime.t_sec;
-	stamp.tv_nsec = fNode->di_crtime.t_nsec;
+	_GetTimestamp(fNode->di_crtime, stamp);
+}
+
+
+void
+Inode::SetModificationTime(const struct timespec& stamp)
+{
+	_SetTimestamp(fNode->di_mtime, stamp);
+}
+
+
+void
+Inode::SetAccessTime(const struct timespec& stamp)
+{
+	_SetTimestamp(fNode->di_atime, stamp);
+}
+
+
+void
+Inode::SetChangeTime(const struct timespec& stamp)
+{
+	_SetTimestamp(fNode->di_ctime, stamp);
+}
+
+
+void
+Inode::SetMode(mode_t mode)
+{
+	fNode->di_mode = (fNode->di_mode & S_IFMT) | (mode & ~S_IFMT);
+}
+
+
+void
+Inode::SetLinkCount(uint32 count)
+{
+	fNode->di_nlink = count;
+	fChanged = true;
+}
+
+
+/*!	Only for inodes without a file cache, the size of files is changed by
+	writing to them.
+*/
+void
+Inode::SetSize(xfs_fsize_t size)
+{
+	fNode->di_size = size;
+	fChanged = true;
+}
+
+
+/*!	Changes the format of the data fork; its contents in Buffer() have to
+	be updated by the caller.
+*/
+void
+Inode::SetDataFork(int8 format, xfs_extnum_t extentCount,
+	xfs_rfsblock_t blockCount)
+{
+	fNode->di_format = format;
+	fNode->di_nextents = extentCount;
+	fNode->di_nblocks = blockCount;
+	fChanged = true;
+}
+
+
+/*!	Changes the next pointer of the inode in the unlinked list of its
+	allocation group in memory; the InodeAllocator logs it.
+*/
+void
+Inode::SetNextUnlinked(uint32 next)
+{
+	fNode->di_next_unlinked = next;
+	((Dinode*)fBuffer)->di_next_unlinked = B_HOST_TO_BENDIAN_INT32(next);
+}
+
+
+/*!	With the bigtime feature, timestamps are a 64 bit count of nanoseconds
+	since the lowest 32 bit time_t value. After _SwapEndian(), its upper
+	half is in t_sec, and the lower one in t_nsec.
+*/
+void
+Inode::_GetTimestamp(const xfs_timestamp_t& source,
+	struct timespec& stamp) const
+{
+	if (Version() == 3 && (fNode->di_flags2 & XFS_DIFLAG2_BIGTIME) != 0) {
+		uint64 time = ((uint64)(uint32)source.t_sec << 32)
+			| (uint32)source.t_nsec;
+		stamp.tv_sec = (int64)(time / kNanoseconds) - kBigtimeEpochOffset;
+		stamp.tv_nsec = time % kNanoseconds;
+		return;
+	}
+
+	stamp.tv_sec = source.t_sec;
+	stamp.tv_nsec = source.t_nsec;
+}
+
+
+void
+Inode::_SetTimestamp(xfs_timestamp_t& target, const struct timespec& stamp)
+{
+	if (Version() == 3 && (fNode->di_flags2 & XFS_DIFLAG2_BIGTIME) != 0) {
+		int64 seconds = max_c((int64)stamp.tv_sec, -kBigtimeEpochOffset);
+		uint64 time = (uint64)(seconds + kBigtimeEpochOffset) * kNanoseconds
+			+ stamp.tv_nsec;
+		target.t_sec = (int32)(time >> 32);
+		target.t_nsec = (int32)(uint32)time;
+	} else {
+		target.t_sec = (int32)max_c(min_c((int64)stamp.tv_sec,
+			kBigtimeEpochOffset - 1), -kBigtimeEpochOffset);
+		target.t_nsec = stamp.tv_nsec;
+	}
+
+	fChanged = true;
 }
 
 
 Inode::Inode(Volume* volume, xfs_ino_t id)
 	:
+	fNode(NULL),
 	fId(id),
 	fVolume(volume),
 	fBuffer(NULL),
-	fExtents(NULL)
+	fExtents(NULL),
+	fCache(NULL),
+	fMap(NULL),
+	fDiskSize(0),
+	fReservedBlocks(0),
+	fChanged(false),
+	fSavedNode(NULL),
+	fSavedBuffer(NULL),
+	fSavedDiskSize(0),
+	fSavedChanged(false)
 {
+	rw_lock_init(&fLock, "xfs inode");
 }
 
 
@@ -312,16 +528,162 @@ Inode::Init()
 			status = B_BAD_VALUE;
 		}
 	}
+	if (status != B_OK)
+		return status;
+
+	fDiskSize = Size();
+
+	if (IsFile()) {
+		status = CreateFileCache();
+		if (status != B_OK)
+			return status;
+
+		// the extent list is needed for every access through the cache
+		if (Format() == XFS_DINODE_FMT_EXTENTS
+			|| Format() == XFS_DINODE_FMT_BTREE) {
+			status = ReadExtents();
+			if (status == B_OK && fExtents == NULL)
+				status = B_NO_MEMORY;
+		}
+	}
 
 	return status;
 }
 
 
+/*!	Allocates and initializes a new regular file or directory, and adds it
+	to the transaction; the caller has to link it into \a parent. The file
+	cache of a new file can only be created once its vnode is published.
+	Any error but B_DEVICE_FULL leaves the transaction half updated, it must
+	not be committed then.
+*/
+/*static*/ status_t
+Inode::Create(Transaction& transaction, Inode* parent, mode_t mode,
+	Inode*& _inode)
+{
+	if (!S_ISREG(mode) && !S_ISDIR(mode))
+		return B_NOT_SUPPORTED;
+
+	Volume* volume = parent->GetVolume();
+	xfs_ino_t id;
+	status_t status = volume->GetInodeAllocator()->Allocate(transaction,
+		parent->ID(), id);
+	if (status != B_OK)
+		return status;
+
+	Inode* inode = new(std::nothrow) Inode(volume, id);
+	if (inode == NULL)
+		return B_NO_MEMORY;
+	ObjectDeleter<Inode> inodeDeleter(inode);
+
+	uint16 inodeSize = volume->InodeSize();
+	inode->fNode = new(std::nothrow) Dinode;
+	inode->fBuffer = new(std::nothrow) char[inodeSize];
+	if (inode->fNode == NULL || inode->fBuffer == NULL)
+		return B_NO_MEMORY;
+
+	// the generation number is kept, so that the inode can be told apart
+	// from its previous user
+	status = inode->GetFromDisk();
+	if (status != B_OK)
+		return status;
+
+	Dinode* node = inode->fNode;
+	uint32 generation = node->di_gen;
+	memset(node, 0, sizeof(Dinode));
+	memset(inode->fBuffer, 0, inodeSize);
+
+	node->di_magic = INODE_MAGIC;
+	node->di_mode = mode;
+	node->di_version = volume->IsVersion5() ? 3 : 2;
+	node->di_format = S_ISDIR(mode)
+		? XFS_DINODE_FMT_LOCAL : XFS_DINODE_FMT_EXTENTS;
+	node->di_aformat = XFS_DINODE_FMT_EXTENTS;
+	node->di_uid = geteuid();
+	node->di_gid = getegid();
+	if ((parent->Mode() & S_ISGID) != 0) {
+		node->di_gid = parent->GroupId();
+		if (S_ISDIR(mode))
+			node->di_mode |= S_ISGID;
+	}
+	node->di_nlink = S_ISDIR(mode) ? 2 : 1;
+	node->di_gen = generation;
+	node->di_next_unlinked = NULLAGINO;
+	if (inode->Version() == 3) {
+		node->di_changecount = 1;
+		node->di_ino = id;
+		memcpy(&node->di_uuid, &volume->SuperBlock().MetaUuid(),
+			sizeof(uuid_t));
+		if ((volume->SuperBlock().IncompatFeatures()
+				& XFS_SB_FEAT_INCOMPAT_BIGTIME) != 0) {
+			node->di_flags2 = XFS_DIFLAG2_BIGTIME;
+		}
+	}
+
+	struct timespec now;
+	now.tv_sec = real_time_clock();
+	now.tv_nsec = 0;
+	inode->SetAccessTime(now);
+	inode->SetModificationTime(now);
+	inode->SetChangeTime(now);
+	if (inode->Version() == 3)
+		inode->_SetTimestamp(node->di_crtime, now);
+
+	if (S_ISDIR(mode)) {
+		// an empty short form directory, that only knows its parent
+		uint8* data = (uint8*)DIR_DFORK_PTR(inode->fBuffer,
+			inode->CoreInodeSize());
+		if (parent->ID() > 0xffffffffULL) {
+			data[1] = 1;
+			*(uint64*)(data + 2) = B_HOST_TO_BENDIAN_INT64(parent->ID());
+			node->di_size = 2 + sizeof(uint64);
+		} else {
+			*(uint32*)(data + 2) = B_HOST_TO_BENDIAN_INT32(parent->ID());
+			node->di_size = 2 + sizeof(uint32);
+		}
+	}
+
+	status = inode->WriteBack(transaction);
+	if (status != B_OK)
+		return status;
+
+	_inode = inodeDeleter.Detach();
+	return B_OK;
+}
+
+
 Inode::~Inode()
 {
+	if (fReservedBlocks > 0)
+		fVolume->UnreserveBlocks(fReservedBlocks);
+
+	file_cache_delete(FileCache());
+	file_map_delete(Map());
+	rw_lock_destroy(&fLock);
+
 	delete fNode;
 	delete[] fBuffer;
 	delete[] fExtents;
+	delete fSavedNode;
+	delete[] fSavedBuffer;
+}
+
+
+/*!	Creates the file cache and the file map of a regular file. The VFS must
+	know the vnode already.
+*/
+status_t
+Inode::CreateFileCache()
+{
+	if (fCache != NULL)
+		return B_OK;
+
+	fCache = file_cache_create(fVolume->ID(), ID(), Size());
+	fMap = file_map_create(fVolume->ID(), ID(), Size());
+	if (fCache == NULL || fMap == NULL)
+		return B_NO_MEMORY;
+
+	return B_OK;
 }
 
 
@@ -594,12 +956,6 @@ status_t
 Inode::ReadAt(off_t pos, uint8* buffer, size_t* length)
 {
 	TRACE("Inode::ReadAt: pos:(%" B_PRIdOFF "), *length:(%" B_PRIuSIZE ")\n", pos, *length);
-	status_t status;
-	if (fExtents == NULL) {
-		status = ReadExtents();
-		if (status != B_OK)
-			return status;
-	}
 
 	// set/check boundaries for pos/length
 	if (pos < 0) {
@@ -608,88 +964,16 @@ Inode::ReadAt(off_t pos, uint8* buffer, size_t* length)
 		return B_BAD_VALUE;
 	}
 
-	if (pos >= Size() || length == 0) {
-		TRACE("inode %" B_PRIdINO ": ReadAt 0 (pos %" B_PRIdOFF
-			", length %" B_PRIuSIZE ")\n", ID(), pos, *length);
-		*length = 0;
-		return B_NO_ERROR;
-	}
-
-	uint32 blockNo = BLOCKNO_FROM_POSITION(pos, GetVolume());
-	uint32 offsetIntoBlock = BLOCKOFFSET_FROM_POSITION(pos, this);
-
-	ssize_t lengthOfBlock = BlockSize();
-	char* block = new(std::nothrow) char[lengthOfBlock];
-	if (block == NULL)
-		return B_NO_MEMORY;
-
-	ArrayDeleter<char> blockDeleter(block);
-
-	size_t lengthRead = 0;
-	size_t lengthLeftInFile;
-	size_t lengthLeftInBlock;
-	size_t lengthToRead;
-	TRACE("What is blockLen:(%" B_PRId64 ")\n", lengthOfBlock);
-	while (*length > 0) {
-		TRACE("Inode::ReadAt: pos:(%" B_PRIdOFF "), *length:(%" B_PRIuSIZE ")\n", pos, *length);
-		// As long as you can read full blocks, read.
-		lengthLeftInFile = Size() - pos;
-		lengthLeftInBlock = lengthOfBlock - offsetIntoBlock;
-
-		/*
-			We will read file in blocks of size 4096 bytes, if that
-			is not possible we will read file of remaining bytes.
-			This meathod will change when we will add file cache for xfs.
-		*/
-		if(lengthLeftInFile >= 4096) {
-			*length = 4096;
-		} else {
-			*length = lengthLeftInFile;
-		}
-
-		// We could be almost at the end of the file
-		if (lengthLeftInFile <= lengthLeftInBlock)
-			lengthToRead = lengthLeftInFile;
-		else lengthToRead = lengthLeftInBlock;
-
-		// But we might not be able to read all of the
-		// data because of less buffer length
-		if (lengthToRead > *length)
-			lengthToRead = *length;
-
-		int indexForMap = SearchMapInAllExtent(blockNo);
-		if (indexForMap == -1)
-			return B_BAD_VALUE;
-
-		xfs_daddr_t readPos
-			= FileSystemBlockToAddr(fExtents[indexForMap].br_startblock
-				+ blockNo - fExtents[indexForMap].br_startoff);
-
-		if (read_pos(GetVolume()->Device(), readPos, block, lengthOfBlock)
-			!= lengthOfBlock) {
-			ERROR("TreeDirectory::FillBlockBuffer(): IO Error");
-			return B_IO_ERROR;
-		}
-
-
-		memcpy((void*) (buffer + lengthRead),
-			(void*)(block + offsetIntoBlock), lengthToRead);
-
-		pos += lengthToRead;
-		*length -= lengthToRead;
-		lengthRead += lengthToRead;
-		blockNo = BLOCKNO_FROM_POSITION(pos, GetVolume());
-		offsetIntoBlock = BLOCKOFFSET_FROM_POSITION(pos, this);
-	}
+	if (FileCache() == NULL)
+		return B_BAD_VALUE;
 
-	TRACE("lengthRead:(%" B_PRIuSIZE ")\n", lengthRead);
-	*length = lengthRead;
-	return B_OK;
+	return file_cache_read(FileCache(), NULL, pos, buffer, length);
 }
 
 
-status_t
-Inode::GetFromDisk()
+/*!	Returns the position of the inode on the device. */
+off_t
+Inode::_DiskOffset() const
 {
 	xfs_agnumber_t agNo = INO_TO_AGNO(fId, fVolume);
 		// Get the AG number from the inode
@@ -706,19 +990,25 @@ Inode::GetFromDisk()
 		"AgRelativeBlockNum: (%" B_PRIu32 "),Offset: (%" B_PRId64 "),"
 		"len: (%" B_PRIu32 ")\n", agNo,agRelativeInodeNo, agBlock, offset, len);
 
-	if (agNo > fVolume->AgCount()) {
-		ERROR("Inode::GetFromDisk : AG Number more than number of AGs");
-		return B_ENTRY_NOT_FOUND;
-	}
-
 	xfs_agblock_t numberOfBlocksInAg = fVolume->AgBlocks();
 
 	xfs_fsblock_t blockToRead = FSBLOCKS_TO_BASICBLOCKS(fVolume->BlockLog(),
-		((uint64)(agNo * numberOfBlocksInAg) + agBlock));
+		((uint64)agNo * numberOfBlocksInAg + agBlock));
+
+	return blockToRead * XFS_MIN_BLOCKSIZE + offset * len;
+}
 
-	xfs_daddr_t readPos = blockToRead * XFS_MIN_BLOCKSIZE + offset * len;
 
-	if (read_pos(fVolume->Device(), readPos, fBuffer, len) != len) {
+status_t
+Inode::GetFromDisk()
+{
+	if (INO_TO_AGNO(fId, fVolume) > fVolume->AgCount()) {
+		ERROR("Inode::GetFromDisk : AG Number more than number of AGs");
+		return B_ENTRY_NOT_FOUND;
+	}
+
+	uint32 len = fVolume->InodeSize();
+	if (read_pos(fVolume->Device(), _DiskOffset(), fBuffer, len) != len) {
 		ERROR("Inode::Inode(): IO Error");
 		return B_IO_ERROR;
 	}
@@ -728,7 +1018,7 @@ Inode::GetFromDisk()
 	else
 		memcpy(fNode, fBuffer, INODE_CRC_OFF);
 
-	SwapEndian();
+	_SwapEndian(fNode);
 
 	return B_OK;
 }
@@ -752,14 +1042,974 @@ Inode::FileSystemBlockToAddr(uint64 block)
 }
 
 
+status_t
+Inode::CheckWritable() const
+{
+	if (fVolume->IsReadOnly())
+		return B_READ_ONLY_DEVICE;
+	if (!IsFile() || FileCache() == NULL)
+		return B_BAD_VALUE;
+
+	// Only the extent list in the inode can be changed; files with shared
+	// blocks would need copy on write
+	if (Format() != XFS_DINODE_FMT_EXTENTS
+		|| (Flags() & XFS_DIFLAG_REALTIME) != 0
+		|| (Version() == 3 && (fNode->di_flags2 & XFS_DIFLAG2_REFLINK) != 0))
+		return B_NOT_SUPPORTED;
+	if ((Flags() & (XFS_DIFLAG_IMMUTABLE | XFS_DIFLAG_APPEND)) != 0)
+		return B_NOT_ALLOWED;
+
+	return B_OK;
+}
+
+
+/*!	Writes the data to the file cache. Blocks are only allocated when the
+	cache writes the data back, see AllocateForWrite(); until then, space
+	for them is reserved.
+*/
+status_t
+Inode::WriteAt(off_t pos, const uint8* buffer, size_t* _length)
+{
+	status_t status = CheckWritable();
+	if (status != B_OK)
+		return status;
+
+	size_t length = *_length;
+	if (pos < 0 || pos + (off_t)length < pos)
+		return B_BAD_VALUE;
+	if (length == 0)
+		return B_OK;
+
+	WriteLocker locker(fLock);
+
+	uint32 blockLog = fVolume->BlockLog();
+	xfs_fileoff_t first = pos >> blockLog;
+	xfs_fileoff_t end = (pos + length + BlockSize() - 1) >> blockLog;
+	xfs_filblks_t holes = count_holes(fExtents, DataExtentsCount(), first,
+		end);
+	status = fVolume->ReserveBlocks(holes);
+	if (status != B_OK)
+		return status;
+	fReservedBlocks += holes;
+
+	off_t oldSize = Size();
+	if (pos + (off_t)length > oldSize) {
+		fNode->di_size = pos + length;
+		file_cache_set_size(FileCache(), Size());
+		file_map_set_size(Map(), Size());
+	}
+
+	struct timespec now;
+	now.tv_sec = real_time_clock();
+	now.tv_nsec = 0;
+	SetModificationTime(now);
+	SetChangeTime(now);
+
+	locker.Unlock();
+
+	if (pos > oldSize) {
+		status = _FillGapWithZeros(oldSize, pos);
+		if (status != B_OK)
+			return status;
+	}
+
+	return file_cache_write(FileCache(), NULL, pos, buffer, _length);
+}
+
+
+/*!	Extends the file to \a size; the new part reads as zeros. Use
+	Shrink() to make it smaller.
+*/
+status_t
+Inode::Grow(off_t size)
+{
+	status_t status = CheckWritable();
+	if (status != B_OK)
+		return status;
+
+	WriteLocker locker(fLock);
+
+	off_t oldSize = Size();
+	if (size <= oldSize)
+		return size == oldSize ? B_OK : B_BAD_VALUE;
+
+	fNode->di_size = size;
+	file_cache_set_size(FileCache(), Size());
+	file_map_set_size(Map(), Size());
+
+	locker.Unlock();
+	status = _FillGapWithZeros(oldSize, size);
+	if (status != B_OK)
+		return status;
+	locker.Lock();
+
+	struct timespec now;
+	now.tv_sec = real_time_clock();
+	now.tv_nsec = 0;
+	SetModificationTime(now);
+	SetChangeTime(now);
+
+	// the new part of the file is a hole, so the size can be logged
+	// right away
+	Transaction transaction(fVolume);
+	status = transaction.Start();
+	if (status != B_OK)
+		return status;
+
+	xfs_fsize_t oldDiskSize = fDiskSize;
+	fDiskSize = max_c(fDiskSize, Size());
+
+	status = WriteBack(transaction);
+	if (status == B_OK)
+		status = transaction.Commit();
+	if (status != B_OK) {
+		fDiskSize = oldDiskSize;
+		fChanged = true;
+		_UpdateBuffer();
+	}
+
+	return status;
+}
+
+
+/*!	Cuts the file down to \a size, and frees the blocks after it. The
+	stale data in the rest of the last block is cleared by
+	_FillGapWithZeros() when the file grows again.
+*/
+status_t
+Inode::Shrink(off_t size)
+{
+	status_t status = CheckWritable();
+	if (status != B_OK)
+		return status;
+	if (size < 0)
+		return B_BAD_VALUE;
+
+	WriteLocker locker(fLock);
+
+	off_t oldSize = Size();
+	if (size >= oldSize)
+		return size == oldSize ? B_OK : B_BAD_VALUE;
+
+	fNode->di_size = size;
+	file_cache_set_size(FileCache(), Size());
+	file_map_set_size(Map(), Size());
+
+	struct timespec now;
+	now.tv_sec = real_time_clock();
+	now.tv_nsec = 0;
+	SetModificationTime(now);
+	SetChangeTime(now);
+
+	// only the first extent after the new end can be split
+	uint32 blockLog = fVolume->BlockLog();
+	xfs_fileoff_t end = (size + BlockSize() - 1) >> blockLog;
+	int32 count = DataExtentsCount();
+	int32 index = find_extent(fExtents, count, end);
+
+	ExtentMapEntry* extents = new(std::nothrow) ExtentMapEntry[index + 1];
+	if (extents == NULL)
+		return B_NO_MEMORY;
+
+	memcpy(extents, fExtents, index * sizeof(ExtentMapEntry));
+	int32 newCount = index;
+	if (index < count && fExtents[index].br_startoff < end) {
+		extents[newCount] = fExtents[index];
+		extents[newCount++].br_blockcount
+			= end - fExtents[index].br_startoff;
+	}
+
+	Transaction transaction(fVolume);
+	status = transaction.Start();
+	if (status != B_OK) {
+		delete[] extents;
+		return status;
+	}
+
+	BlockAllocator* allocator = fVolume->GetBlockAllocator();
+	xfs_filblks_t freed = 0;
+	for (int32 i = index; i < count; i++) {
+		const ExtentMapEntry& extent = fExtents[i];
+		xfs_filblks_t kept = 0;
+		if (extent.br_startoff < end)
+			kept = end - extent.br_startoff;
+
+		status = allocator->Free(transaction, extent.br_startblock + kept,
+			extent.br_blockcount - kept);
+		if (status != B_OK) {
+			delete[] extents;
+			return status;
+		}
+		freed += extent.br_blockcount - kept;
+	}
+
+	xfs_fsize_t oldDiskSize = fDiskSize;
+	fDiskSize = min_c(fDiskSize, Size());
+
+	status = _CommitExtents(transaction, extents, newCount,
+		BlockCount() - freed);
+	if (status != B_OK) {
+		// the file keeps its blocks after the end
+		fDiskSize = oldDiskSize;
+		_UpdateBuffer();
+		return status;
+	}
+
+	// the data in the cache that was dropped does not need its blocks
+	xfs_filblks_t holes = count_holes(fExtents, DataExtentsCount(), 0, end);
+	if (fReservedBlocks > holes) {
+		fVolume->UnreserveBlocks(fReservedBlocks - holes);
+		fReservedBlocks = holes;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Allocates unwritten extents for the holes in the given range, which
+	read as zeros, and extends the file if needed.
+*/
+status_t
+Inode::Preallocate(off_t pos, off_t length)
+{
+	status_t status = CheckWritable();
+	if (status != B_OK)
+		return status;
+	if (pos < 0 || length <= 0 || pos + length < pos)
+		return B_BAD_VALUE;
+
+	WriteLocker locker(fLock);
+
+	uint32 blockLog = fVolume->BlockLog();
+	xfs_fileoff_t block = pos >> blockLog;
+	xfs_fileoff_t end = (pos + length + BlockSize() - 1) >> blockLog;
+
+	while (block < end) {
+		int32 count = DataExtentsCount();
+		int32 index = find_extent(fExtents, count, block);
+		if (index < count && fExtents[index].br_startoff <= block) {
+			block = fExtents[index].br_startoff
+				+ fExtents[index].br_blockcount;
+			continue;
+		}
+
+		xfs_fileoff_t holeEnd = end;
+		if (index < count)
+			holeEnd = min_c(end, fExtents[index].br_startoff);
+
+		xfs_filblks_t allocated;
+		status = _AllocateRange(block, holeEnd - block, XFS_EXT_UNWRITTEN,
+			allocated);
+		if (status != B_OK)
+			return status;
+
+		block += allocated;
+	}
+
+	locker.Unlock();
+
+	if (pos + length > Size())
+		return Grow(pos + length);
+
+	return B_OK;
+}
+
+
+/*!	Writes back the file cache, and logs the inode if it has changes that
+	are not on disk yet.
+*/
+status_t
+Inode::Sync()
+{
+	if (FileCache() == NULL)
+		return B_OK;
+
+	status_t status = file_cache_sync(FileCache());
+	if (status != B_OK)
+		return status;
+
+	WriteLocker locker(fLock);
+
+	// all data has blocks now
+	if (fReservedBlocks > 0) {
+		fVolume->UnreserveBlocks(fReservedBlocks);
+		fReservedBlocks = 0;
+	}
+
+	if (fVolume->IsReadOnly() || (!fChanged && fDiskSize == Size()))
+		return B_OK;
+
+	Transaction transaction(fVolume);
+	status = transaction.Start();
+	if (status != B_OK)
+		return status;
+
+	// anything beyond the data written so far is a hole
+	xfs_fsize_t oldDiskSize = fDiskSize;
+	fDiskSize = Size();
+
+	status = WriteBack(transaction);
+	if (status == B_OK)
+		status = transaction.Commit();
+	if (status != B_OK) {
+		fDiskSize = oldDiskSize;
+		fChanged = true;
+		_UpdateBuffer();
+	}
+
+	return status;
+}
+
+
+/*!	Maps the given range of the file to the device. Holes are returned with
+	an offset of -1, as are unwritten extents, unless \a mapUnwritten is
+	set. The caller must hold the inode lock.
+*/
+status_t
+Inode::GetFileMap(off_t offset, size_t size, file_io_vec* vecs,
+	size_t* _count, bool mapUnwritten)
+{
+	uint32 blockLog = fVolume->BlockLog();
+	int32 extentCount = DataExtentsCount();
+	size_t index = 0;
+	size_t maxCount = *_count;
+
+	// the file map asks for everything up to the end of the file with a
+	// size of ~0, which must not overflow
+	off_t end = offset + size;
+	if (!mapUnwritten
+		&& (offset >= Size() || size > (size_t)(Size() - offset))) {
+		end = Size();
+	}
+
+	while (offset < end) {
+		xfs_fileoff_t block = offset >> blockLog;
+		uint32 offsetInBlock = offset & (BlockSize() - 1);
+		int32 i = find_extent(fExtents, extentCount, block);
+
+		off_t vecOffset = -1;
+		off_t length = end - offset;
+		if (i < extentCount && fExtents[i].br_startoff <= block) {
+			const ExtentMapEntry& extent = fExtents[i];
+			length = ((off_t)(extent.br_startoff + extent.br_blockcount
+				- block) << blockLog) - offsetInBlock;
+			if (extent.br_state != XFS_EXT_UNWRITTEN || mapUnwritten) {
+				vecOffset = fVolume->FileSystemBlockToOffset(
+					extent.br_startblock + block - extent.br_startoff)
+					+ offsetInBlock;
+			}
+		} else if (i < extentCount) {
+			// a hole up to the next extent
+			length = ((off_t)(fExtents[i].br_startoff - block) << blockLog)
+				- offsetInBlock;
+		}
+		length = min_c(length, end - offset);
+
+		if (index > 0 && ((vecOffset == -1 && vecs[index - 1].offset == -1)
+				|| (vecOffset != -1 && vecs[index - 1].offset != -1
+					&& vecs[index - 1].offset + vecs[index - 1].length
+						== vecOffset))) {
+			vecs[index - 1].length += length;
+		} else {
+			if (index >= maxCount) {
+				// we're out of file_io_vecs; let's bail out
+				*_count = index;
+				return B_BUFFER_OVERFLOW;
+			}
+
+			vecs[index].offset = vecOffset;
+			vecs[index].length = length;
+			index++;
+		}
+
+		offset += length;
+	}
+
+	*_count = index;
+	return B_OK;
+}
+
+
+/*!	Makes sure the given range has blocks, before the file cache writes it
+	back. This is where delayed allocation happens: a hole is filled with
+	as much of the data the cache holds for it as possible, so that
+	streaming writes end up in large extents. The new extents are
+	unwritten, MarkWritten() converts them once the data is on disk.
+	The caller must hold the inode write lock.
+*/
+status_t
+Inode::AllocateForWrite(off_t pos, size_t length)
+{
+	uint32 blockLog = fVolume->BlockLog();
+	xfs_fileoff_t block = pos >> blockLog;
+	xfs_fileoff_t end = (pos + length + BlockSize() - 1) >> blockLog;
+	xfs_fileoff_t sizeEnd = (Size() + BlockSize() - 1) >> blockLog;
+
+	while (block < end) {
+		int32 count = DataExtentsCount();
+		int32 index = find_extent(fExtents, count, block);
+		if (index < count && fExtents[index].br_startoff <= block) {
+			block = fExtents[index].br_startoff
+				+ fExtents[index].br_blockcount;
+			continue;
+		}
+
+		xfs_fileoff_t holeEnd = max_c(end, sizeEnd);
+		if (index < count)
+			holeEnd = min_c(holeEnd, fExtents[index].br_startoff);
+
+		// the reservations stand for data in the cache that needs blocks
+		xfs_filblks_t wanted = max_c(end - block,
+			min_c(holeEnd - block, fReservedBlocks));
+		wanted = min_c(wanted, holeEnd - block);
+
+		xfs_filblks_t allocated;
+		status_t status = _AllocateRange(block, wanted, XFS_EXT_UNWRITTEN,
+			allocated);
+		if (status != B_OK)
+			return status;
+
+		block += allocated;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Converts the unwritten extents in the given range after the data has
+	been written, and logs the new file size. If splitting the extents
+	would need more extents than fit into the inode, the rest of them is
+	filled with zeros instead.
+	The caller must hold the inode write lock.
+*/
+status_t
+Inode::MarkWritten(off_t pos, size_t length)
+{
+	uint32 blockLog = fVolume->BlockLog();
+	xfs_fileoff_t first = pos >> blockLog;
+	xfs_fileoff_t end = (pos + length + BlockSize() - 1) >> blockLog;
+	xfs_fsize_t diskSize = max_c(fDiskSize,
+		min_c(Size(), pos + (off_t)length));
+
+	int32 count = DataExtentsCount();
+	int32 firstIndex = find_extent(fExtents, count, first);
+	bool hasUnwritten = false;
+	for (int32 i = firstIndex; i < count && fExtents[i].br_startoff < end;
+			i++) {
+		if (fExtents[i].br_state == XFS_EXT_UNWRITTEN)
+			hasUnwritten = true;
+	}
+	if (!hasUnwritten && diskSize == fDiskSize)
+		return B_OK;
+
+	// only the first and the last extent of the range can be split
+	ExtentMapEntry* extents = new(std::nothrow) ExtentMapEntry[count + 2];
+	if (extents == NULL)
+		return B_NO_MEMORY;
+
+	int32 newCount = 0;
+	for (int pass = 0; pass < 2; pass++) {
+		bool fillWithZeros = pass == 1;
+		newCount = 0;
+
+		for (int32 i = 0; i < count; i++) {
+			const ExtentMapEntry& extent = fExtents[i];
+			xfs_fileoff_t extentEnd = extent.br_startoff
+				+ extent.br_blockcount;
+			if (extent.br_state != XFS_EXT_UNWRITTEN
+				|| extentEnd <= first || extent.br_startoff >= end) {
+				extents[newCount++] = extent;
+				continue;
+			}
+
+			xfs_fileoff_t start = max_c(first, extent.br_startoff);
+			xfs_fileoff_t stop = min_c(end, extentEnd);
+			if (fillWithZeros) {
+				status_t status = B_OK;
+				if (start > extent.br_startoff) {
+					status = _ZeroBlocks(extent.br_startblock,
+						start - extent.br_startoff);
+				}
+				if (status == B_OK && stop < extentEnd) {
+					status = _ZeroBlocks(extent.br_startblock
+						+ (stop - extent.br_startoff), extentEnd - stop);
+				}
+				if (status != B_OK) {
+					delete[] extents;
+					return status;
+				}
+
+				extents[newCount] = extent;
+				extents[newCount++].br_state = XFS_EXT_NORM;
+				continue;
+			}
+
+			if (start > extent.br_startoff) {
+				extents[newCount] = extent;
+				extents[newCount++].br_blockcount = start - extent.br_startoff;
+			}
+
+			ExtentMapEntry& written = extents[newCount++];
+			written.br_startoff = start;
+			written.br_startblock = extent.br_startblock
+				+ (start - extent.br_startoff);
+			written.br_blockcount = stop - start;
+			written.br_state = XFS_EXT_NORM;
+
+			if (stop < extentEnd) {
+				ExtentMapEntry& rest = extents[newCount++];
+				rest.br_startoff = stop;
+				rest.br_startblock = extent.br_startblock
+					+ (stop - extent.br_startoff);
+				rest.br_blockcount = extentEnd - stop;
+				rest.br_state = XFS_EXT_UNWRITTEN;
+			}
+		}
+
+		newCount = merge_extents(extents, newCount);
+		if (newCount <= _MaxDataExtents())
+			break;
+	}
+
+	Transaction transaction(fVolume);
+	status_t status = transaction.Start();
+	if (status != B_OK) {
+		delete[] extents;
+		return status;
+	}
+
+	xfs_fsize_t oldDiskSize = fDiskSize;
+	fDiskSize = diskSize;
+
+	status = _CommitExtents(transaction, extents, newCount, BlockCount());
+	if (status != B_OK) {
+		fDiskSize = oldDiskSize;
+		_UpdateBuffer();
+		return status;
+	}
+
+	// the blocks are no longer read as zeros
+	file_map_invalidate(Map(), (off_t)first << blockLog,
+		(off_t)(end - first) << blockLog);
+	return B_OK;
+}
+
+
+/*!	Returns an error if the inode cannot be freed here, once its last link
+	is gone. This is checked before removing it, so that no blocks are lost.
+*/
+status_t
+Inode::CheckRemovable() const
+{
+	// only the extent list in the inode is understood; an attribute fork
+	// outside of the inode, or shared blocks would be lost
+	if ((Format() != XFS_DINODE_FMT_EXTENTS
+			&& Format() != XFS_DINODE_FMT_LOCAL
+			&& Format() != XFS_DINODE_FMT_DEV)
+		|| (ForkOffset() != 0 && AttrFormat() != XFS_DINODE_FMT_LOCAL)
+		|| (Flags() & XFS_DIFLAG_REALTIME) != 0
+		|| (Version() == 3 && (fNode->di_flags2 & XFS_DIFLAG2_REFLINK) != 0))
+		return B_NOT_SUPPORTED;
+	if ((Flags() & (XFS_DIFLAG_IMMUTABLE | XFS_DIFLAG_APPEND)) != 0)
+		return B_NOT_ALLOWED;
+
+	return B_OK;
+}
+
+
+/*!	Frees the blocks of the inode, and then the inode itself, once it has
+	no links left and is no longer used. Any error leaves the transaction
+	half updated, it must not be committed then.
+*/
+status_t
+Inode::Free(Transaction& transaction)
+{
+	status_t status = CheckRemovable();
+	if (status != B_OK)
+		return status;
+
+	if (FileCache() != NULL) {
+		// nothing in the cache must be written to the freed blocks anymore
+		file_cache_set_size(FileCache(), 0);
+		file_map_set_size(Map(), 0);
+	}
+
+	if (Format() == XFS_DINODE_FMT_EXTENTS && DataExtentsCount() > 0) {
+		if (fExtents == NULL) {
+			status = ReadExtents();
+			if (status == B_OK && fExtents == NULL)
+				status = B_NO_MEMORY;
+			if (status != B_OK)
+				return status;
+		}
+
+		BlockAllocator* allocator = fVolume->GetBlockAllocator();
+		for (int32 i = 0; i < DataExtentsCount(); i++) {
+			status = allocator->Free(transaction, fExtents[i].br_startblock,
+				fExtents[i].br_blockcount);
+			if (status != B_OK)
+				return status;
+		}
+	}
+
+	status = fVolume->GetInodeAllocator()->Free(transaction, fId);
+	if (status != B_OK)
+		return status;
+
+	// an unused inode, only its generation number is kept
+	fNode->di_mode = 0;
+	fNode->di_format = XFS_DINODE_FMT_EXTENTS;
+	fNode->di_aformat = XFS_DINODE_FMT_EXTENTS;
+	fNode->di_forkoff = 0;
+	fNode->di_flags = 0;
+	fNode->di_flags2 &= XFS_DIFLAG2_BIGTIME;
+	fNode->di_size = 0;
+	fNode->di_nblocks = 0;
+	fNode->di_nextents = 0;
+	fNode->di_naextents = 0;
+	fNode->di_gen++;
+	fDiskSize = 0;
+	memset(fBuffer + CoreInodeSize(), 0,
+		fVolume->InodeSize() - CoreInodeSize());
+	fChanged = true;
+
+	return WriteBack(transaction);
+}
+
+
+/*!	Remembers the inode as it is, and restores it if the transaction is not
+	committed. Has to be called before the inode is changed within the
+	transaction, unless the caller reverts the changes itself.
+*/
+status_t
+Inode::SaveState(Transaction& transaction)
+{
+	if (fSavedNode != NULL)
+		return B_OK;
+
+	uint16 inodeSize = fVolume->InodeSize();
+	fSavedNode = new(std::nothrow) Dinode;
+	fSavedBuffer = new(std::nothrow) char[inodeSize];
+	if (fSavedNode == NULL || fSavedBuffer == NULL) {
+		delete fSavedNode;
+		delete[] fSavedBuffer;
+		fSavedNode = NULL;
+		fSavedBuffer = NULL;
+		return B_NO_MEMORY;
+	}
+
+	*fSavedNode = *fNode;
+	memcpy(fSavedBuffer, fBuffer, inodeSize);
+	fSavedDiskSize = fDiskSize;
+	fSavedChanged = fChanged;
+
+	transaction.AddListener(this);
+	return B_OK;
+}
+
+
+void
+Inode::TransactionDone(bool success)
+{
+	if (!success && fSavedNode != NULL) {
+		*fNode = *fSavedNode;
+		memcpy(fBuffer, fSavedBuffer, fVolume->InodeSize());
+		fDiskSize = fSavedDiskSize;
+		fChanged = fSavedChanged;
+	}
+
+	delete fSavedNode;
+	delete[] fSavedBuffer;
+	fSavedNode = NULL;
+	fSavedBuffer = NULL;
+}
+
+
+/*!	Updates the on-disk inode image and adds it to the transaction. */
+status_t
+Inode::WriteBack(Transaction& transaction)
+{
+	_UpdateBuffer();
+	fChanged = false;
+	return transaction.AddInode(this);
+}
+
+
+/*!	Copies the inode core to \a buffer the way it is logged: in host byte
+	order. Returns its size.
+*/
+uint32
+Inode::CopyToLogDinode(uint8* buffer) const
+{
+	uint32 size = Version() == 3 ? sizeof(Dinode) : kLogDinodeV2Size;
+	memcpy(buffer, fBuffer, size);
+
+	uint32 fieldCount = sizeof(kLogDinodeFields) / sizeof(kLogDinodeFields[0]);
+	for (uint32 i = 0; i < fieldCount; i++) {
+		const log_dinode_field& field = kLogDinodeFields[i];
+		if (field.offset >= size)
+			continue;
+
+		uint8* data = buffer + field.offset;
+		switch (field.size) {
+			case 2:
+				*(uint16*)data = B_BENDIAN_TO_HOST_INT16(*(uint16*)data);
+				break;
+			case 4:
+				*(uint32*)data = B_BENDIAN_TO_HOST_INT32(*(uint32*)data);
+				break;
+			case 8:
+				*(uint64*)data = B_BENDIAN_TO_HOST_INT64(*(uint64*)data);
+				break;
+		}
+	}
+
+	bool bigtime = Version() == 3
+		&& (fNode->di_flags2 & XFS_DIFLAG2_BIGTIME) != 0;
+	for (uint32 i = 0; i < sizeof(kLogDinodeTimestamps); i++) {
+		if (kLogDinodeTimestamps[i] >= size)
+			continue;
+
+		uint8* data = buffer + kLogDinodeTimestamps[i];
+		if (bigtime) {
+			*(uint64*)data = B_BENDIAN_TO_HOST_INT64(*(uint64*)data);
+		} else {
+			*(uint32*)data = B_BENDIAN_TO_HOST_INT32(*(uint32*)data);
+			*(uint32*)(data + 4) = B_BENDIAN_TO_HOST_INT32(
+				*(uint32*)(data + 4));
+		}
+	}
+
+	return size;
+}
+
+
+const uint8*
+Inode::DataFork() const
+{
+	return (const uint8*)DIR_DFORK_PTR(fBuffer, CoreInodeSize());
+}
+
+
+/*!	Writes the inode in place, after its log record has reached the disk. */
+status_t
+Inode::WriteToDisk(xfs_lsn_t lsn)
+{
+	uint32 length = fVolume->InodeSize();
+	if (Version() == 3) {
+		*(uint64*)(fBuffer + INODE_LSN_OFF) = B_HOST_TO_BENDIAN_INT64(lsn);
+		xfs_update_cksum(fBuffer, length, INODE_CRC_OFF);
+	}
+
+	if (write_pos(fVolume->Device(), _DiskOffset(), fBuffer, length)
+			!= (ssize_t)length) {
+		ERROR("Inode::WriteToDisk(): IO Error");
+		return B_IO_ERROR;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Rebuilds the on-disk image of the inode core and its extent list. The
+	logged size of a file is the one up to which the data has been written.
+*/
+void
+Inode::_UpdateBuffer()
+{
+	Dinode node = *fNode;
+	if (IsFile())
+		node.di_size = fDiskSize;
+	_SwapEndian(&node);
+	memcpy(fBuffer, &node, Version() == 3 ? sizeof(Dinode) : INODE_CRC_OFF);
+
+	if (Format() != XFS_DINODE_FMT_EXTENTS || fExtents == NULL)
+		return;
+
+	uint64* data = (uint64*)DIR_DFORK_PTR(fBuffer, CoreInodeSize());
+	for (int32 i = 0; i < DataExtentsCount(); i++) {
+		const ExtentMapEntry& extent = fExtents[i];
+		uint64 first = ((uint64)extent.br_state << 63)
+			| (extent.br_startoff << 9) | (extent.br_startblock >> 43);
+		uint64 second = (extent.br_startblock << 21) | extent.br_blockcount;
+		data[2 * i] = B_HOST_TO_BENDIAN_INT64(first);
+		data[2 * i + 1] = B_HOST_TO_BENDIAN_INT64(second);
+	}
+}
+
+
+int32
+Inode::_MaxDataExtents() const
+{
+	return DFORK_MAXEXT(fNode, fVolume, XFS_DATA_FORK);
+}
+
+
+/*!	Allocates blocks for the hole at \a start in one transaction, up to
+	\a count of them, and adds them to the extent list in \a state.
+	Tries to continue the extent before the hole on disk.
+*/
+status_t
+Inode::_AllocateRange(xfs_fileoff_t start, xfs_filblks_t count, uint8 state,
+	xfs_filblks_t& _allocated)
+{
+	// do not take blocks that were reserved for other files
+	count = min_c(count, fReservedBlocks + fVolume->FreeBlocks());
+	count = min_c(count, (xfs_filblks_t)XFS_MAX_EXTENT_LENGTH);
+	if (count == 0)
+		return B_DEVICE_FULL;
+
+	int32 extentCount = DataExtentsCount();
+	int32 index = find_extent(fExtents, extentCount, start);
+	const ExtentMapEntry* previous = index > 0 ? &fExtents[index - 1] : NULL;
+
+	xfs_fsblock_t hint;
+	if (previous != NULL)
+		hint = previous->br_startblock + previous->br_blockcount;
+	else
+		hint = (xfs_fsblock_t)INO_TO_AGNO(fId, fVolume) << fVolume->AgBlocksLog();
+
+	Transaction transaction(fVolume);
+	status_t status = transaction.Start();
+	if (status != B_OK)
+		return status;
+
+	xfs_fsblock_t block;
+	uint32 length;
+	status = fVolume->GetBlockAllocator()->Allocate(transaction, hint,
+		previous != NULL, count, block, length);
+	if (status != B_OK)
+		return status;
+
+	ExtentMapEntry extent;
+	extent.br_startoff = start;
+	extent.br_startblock = block;
+	extent.br_blockcount = length;
+	extent.br_state = state;
+
+	bool merge = previous != NULL && can_merge_extents(*previous, extent);
+	int32 newCount = extentCount + (merge ? 0 : 1);
+	if (newCount > _MaxDataExtents()) {
+		// the extent list would need to be converted to a B+tree
+		return B_DEVICE_FULL;
+	}
+
+	ExtentMapEntry* extents = new(std::nothrow) ExtentMapEntry[newCount];
+	if (extents == NULL)
+		return B_NO_MEMORY;
+
+	memcpy(extents, fExtents, index * sizeof(ExtentMapEntry));
+	if (merge) {
+		extents[index - 1].br_blockcount += length;
+		memcpy(extents + index, fExtents + index,
+			(extentCount - index) * sizeof(ExtentMapEntry));
+	} else {
+		extents[index] = extent;
+		memcpy(extents + index + 1, fExtents + index,
+			(extentCount - index) * sizeof(ExtentMapEntry));
+	}
+
+	status = _CommitExtents(transaction, extents, newCount,
+		BlockCount() + length);
+	if (status != B_OK)
+		return status;
+
+	xfs_filblks_t reserved = min_c((xfs_filblks_t)length, fReservedBlocks);
+	fReservedBlocks -= reserved;
+	fVolume->BlocksAllocated(length, reserved);
+
+	_allocated = length;
+	return B_OK;
+}
+
+
+/*!	Writes zeros to the given blocks, bypassing the file cache. */
+status_t
+Inode::_ZeroBlocks(xfs_fsblock_t block, xfs_filblks_t count)
+{
+	const size_t kBufferSize = 65536;
+	uint8* buffer = (uint8*)calloc(1, kBufferSize);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter bufferDeleter(buffer);
+
+	off_t offset = fVolume->FileSystemBlockToOffset(block);
+	off_t length = (off_t)count << fVolume->BlockLog();
+	while (length > 0) {
+		size_t bytes = min_c(length, (off_t)kBufferSize);
+		if (write_pos(fVolume->Device(), offset, buffer, bytes)
+				!= (ssize_t)bytes) {
+			return B_IO_ERROR;
+		}
+
+		offset += bytes;
+		length -= bytes;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Replaces the extent list and block count, and commits the transaction.
+	On failure, the previous state is restored, and \a extents deleted.
+*/
+status_t
+Inode::_CommitExtents(Transaction& transaction, ExtentMapEntry* extents,
+	int32 count, xfs_rfsblock_t blockCount)
+{
+	ExtentMapEntry* oldExtents = fExtents;
+	xfs_extnum_t oldCount = fNode->di_nextents;
+	xfs_rfsblock_t oldBlockCount = fNode->di_nblocks;
+
+	fExtents = extents;
+	fNode->di_nextents = count;
+	fNode->di_nblocks = blockCount;
+
+	status_t status = WriteBack(transaction);
+	if (status == B_OK)
+		status = transaction.Commit();
+	if (status != B_OK) {
+		fExtents = oldExtents;
+		fNode->di_nextents = oldCount;
+		fNode->di_nblocks = oldBlockCount;
+		fChanged = true;
+		_UpdateBuffer();
+		delete[] extents;
+		return status;
+	}
+
+	delete[] oldExtents;
+	return B_OK;
+}
+
+
+/*!	The rest of the last page before \a oldSize may contain stale data on
+	disk; it becomes part of the file when it grows, and is cleared here.
+	The blocks after it are holes, or unwritten, and read as zeros anyway.
+*/
+status_t
+Inode::_FillGapWithZeros(off_t oldSize, off_t newSize)
+{
+	off_t end = min_c(newSize,
+		(oldSize + B_PAGE_SIZE - 1) & ~(off_t)(B_PAGE_SIZE - 1));
+	if (end <= oldSize)
+		return B_OK;
+
+	size_t length = end - oldSize;
+	return file_cache_write(FileCache(), NULL, oldSize, NULL, &length);
+}
+
+
 /*
  * Basically take 4 characters at a time as long as you can, and xor with
  * previous hashVal after rotating 4 bits of hashVal. Likewise, continue
  * xor and rotating. This is quite a generic hash function.
 */
 uint32
-hashfunction(const char* name, int length)
+hashfunction(const char* _name, int length)
 {
+	// names are hashed as unsigned bytes, like Linux does
+	const uint8* name = (const uint8*)_name;
 	uint32 hashVal = 0;
 	int lengthCovered = 0;
 	int index = 0;
@@ -8,6 +8,7 @@
 
 
 #include "system_dependencies.h"
+#include "Journal.h"
 #include "Volume.h"
 #include "xfs_types.h"
 
@@ -18,6 +19,7 @@
 #define INODE_MIN_SIZE	(1 << INODE_MINSIZE_LOG)
 #define INODE_MAX_SIZE	(1 << INODE_MAXSIZE_LOG)
 #define INODE_CRC_OFF offsetof(Inode::Dinode, di_crc)
+#define INODE_LSN_OFF offsetof(Inode::Dinode, di_lsn)
 #define MAXAEXTNUM	((xfs_aextnum_t) 0x7fff)
 #define MAXEXTNUM	((xfs_extnum_t) 0x7fffffff)
 
@@ -83,6 +85,19 @@
 #define DFORK_MAXEXT(ino, volume, w) \
 	(DFORK_SIZE(ino, volume, w) / (2 * sizeof(uint64)))
 
+// di_flags
+#define XFS_DIFLAG_REALTIME		0x0001
+#define XFS_DIFLAG_IMMUTABLE	0x0008
+#define XFS_DIFLAG_APPEND		0x0010
+
+// di_flags2
+#define XFS_DIFLAG2_REFLINK		(1 << 1)
+#define XFS_DIFLAG2_BIGTIME		(1 << 3)
+
+#define XFS_EXT_NORM			0
+#define XFS_EXT_UNWRITTEN		1
+#define XFS_MAX_EXTENT_LENGTH	((1 << 21) - 1)
+
 
 struct LongBlock;  // Forward declaration to remove cyclic dependency
 
@@ -182,7 +197,7 @@ enum xfs_dinode_fmt_t {
  * The dinode is the same for all types of inodes, the data and attribute
  * fork might be different and that is to be handled accordingly.
  */
-class Inode {
+class Inode : public TransactionListener {
 public:
 	typedef struct Dinode{
 	public:
@@ -240,9 +255,12 @@ public:
 	};
 
 								Inode(Volume* volume, xfs_ino_t id);
-								~Inode();
+	virtual						~Inode();
 
 			status_t			Init();
+	static	status_t			Create(Transaction& transaction,
+									Inode* parent, mode_t mode,
+									Inode*& _inode);
 
 			xfs_ino_t			ID() const { return fId; }
 
@@ -273,6 +291,7 @@ public:
 									{ return Format() == XFS_DINODE_FMT_LOCAL; }
 
 			uint32				NLink() const { return fNode->di_nlink; }
+			void				SetLinkCount(uint32 count);
 
 			int8				Version() const { return fNode->di_version; }
 
@@ -284,6 +303,12 @@ public:
 			int16				Flags() const { return fNode->di_flags; }
 
 			xfs_fsize_t			Size() const { return fNode->di_size; }
+			void				SetSize(xfs_fsize_t size);
+
+			rw_lock*			Lock() { return &fLock; }
+			void*				FileCache() const { return fCache; }
+			void*				Map() const { return fMap; }
+			status_t			CreateFileCache();
 
 			uint32				DirBlockSize() const
 									{ return fVolume->DirBlockSize(); }
@@ -301,6 +326,14 @@ public:
 
 			void				GetCreationTime(struct timespec& timestamp) const;
 
+			void				SetModificationTime(
+									const struct timespec& timestamp);
+			void				SetAccessTime(const struct timespec& timestamp);
+			void				SetChangeTime(const struct timespec& timestamp);
+			void				SetMode(mode_t mode);
+			void				SetUserId(uint32 id) { fNode->di_uid = id; }
+			void				SetGroupId(uint32 id) { fNode->di_gid = id; }
+
 			unsigned char		XfsModeToFtype() const;
 			status_t			CheckPermissions(int accessMode) const;
 			uint32				UserId() const { return fNode->di_uid; }
@@ -313,8 +346,40 @@ public:
 			uint64				FileSystemBlockToAddr(uint64 block);
 			uint8				ForkOffset() const
 									{ return fNode->di_forkoff; }
+			uint32				DataForkSize() const
+									{ return DFORK_DSIZE(fNode, fVolume); }
+			void				SetDataFork(int8 format,
+									xfs_extnum_t extentCount,
+									xfs_rfsblock_t blockCount);
+			uint32				NextUnlinked() const
+									{ return fNode->di_next_unlinked; }
+			void				SetNextUnlinked(uint32 next);
 			status_t			ReadExtents();
 			status_t			ReadAt(off_t pos, uint8* buffer, size_t* length);
+			status_t			WriteAt(off_t pos, const uint8* buffer,
+									size_t* length);
+			status_t			Grow(off_t size);
+			status_t			Shrink(off_t size);
+			status_t			Preallocate(off_t pos, off_t length);
+			status_t			Sync();
+
+			status_t			CheckWritable() const;
+			status_t			GetFileMap(off_t offset, size_t size,
+									file_io_vec* vecs, size_t* _count,
+									bool mapUnwritten);
+			status_t			AllocateForWrite(off_t pos, size_t length);
+			status_t			MarkWritten(off_t pos, size_t length);
+
+			status_t			CheckRemovable() const;
+			status_t			Free(Transaction& transaction);
+
+			status_t			SaveState(Transaction& transaction);
+	virtual	void				TransactionDone(bool success);
+
+			status_t			WriteBack(Transaction& transaction);
+			uint32				CopyToLogDinode(uint8* buffer) const;
+			const uint8*		DataFork() const;
+			status_t			WriteToDisk(xfs_lsn_t lsn);
 			status_t			GetNodefromTree(uint16& levelsInTree,
 									Volume* volume, ssize_t& len,
 									size_t DirBlockSize, char* block);
@@ -332,7 +397,24 @@ public:
 			size_t				GetPtrOffsetIntoNode(int pos);
 			uint32				SizeOfLongBlock();
 private:
-			void				SwapEndian();
+	static	void				_SwapEndian(Dinode* node);
+			void				_GetTimestamp(const xfs_timestamp_t& source,
+									struct timespec& timestamp) const;
+			void				_SetTimestamp(xfs_timestamp_t& target,
+									const struct timespec& timestamp);
+			off_t				_DiskOffset() const;
+			void				_UpdateBuffer();
+			int32				_MaxDataExtents() const;
+			status_t			_AllocateRange(xfs_fileoff_t start,
+									xfs_filblks_t count, uint8 state,
+									xfs_filblks_t& _allocated);
+			status_t			_ZeroBlocks(xfs_fsblock_t block,
+									xfs_filblks_t count);
+			status_t			_CommitExtents(Transaction& transaction,
+									ExtentMapEntry* extents, int32 count,
+									xfs_rfsblock_t blockCount);
+			status_t			_FillGapWithZeros(off_t oldSize,
+									off_t newSize);
 private:
 			status_t			GetFromDisk();
 			Dinode*				fNode;
@@ -341,6 +423,22 @@ private:
 			char*				fBuffer;
 				// Contains the disk inode in BE format
 			ExtentMapEntry*		fExtents;
+			rw_lock				fLock;
+			void*				fCache;
+			void*				fMap;
+			xfs_fsize_t			fDiskSize;
+				// the size that has been logged, data beyond it may not
+				// have been written yet
+			xfs_filblks_t		fReservedBlocks;
+				// for data in the file cache that has no blocks yet
+			bool				fChanged;
+				// the inode core has changes that are not logged yet
+			Dinode*				fSavedNode;
+			char*				fSavedBuffer;
+			xfs_fsize_t			fSavedDiskSize;
+			bool				fSavedChanged;
+				// the state before the current transaction, see
+				// SaveState()
 };
 
 
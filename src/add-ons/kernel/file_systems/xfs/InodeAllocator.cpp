@@ -0,0 +1,1013 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "InodeAllocator.h"
+
+#include "BlockAllocator.h"
+#include "Checksum.h"
+#include "Inode.h"
+#include "Journal.h"
+#include "ShortBTree.h"
+#include "Volume.h"
+
+
+struct InodeChunk {
+	uint32	start;
+	uint16	holeMask;
+		// one bit for every XFS_INODES_PER_HOLEMASK_BIT inodes
+	uint8	count;
+	uint8	freeCount;
+	uint64	free;
+		// holes are marked free, too
+
+	uint64	Holes() const;
+};
+
+
+/*!	The AGI of one allocation group, as seen by a transaction. */
+class InodeGroup {
+public:
+								InodeGroup(Transaction& transaction,
+									xfs_agnumber_t number);
+
+			status_t			Init();
+
+			Volume*				GetVolume() const { return fVolume; }
+			Transaction&		GetTransaction() const { return fTransaction; }
+			xfs_agnumber_t		Number() const { return fNumber; }
+
+			bool				HasFreeInodeTree() const;
+			bool				HasSparseChunks() const;
+
+			uint32				Count() const
+									{ return _Get(XFS_AGI_COUNT); }
+			uint32				FreeCount() const
+									{ return _Get(XFS_AGI_FREECOUNT); }
+			void				AddInodes(int32 count, int32 freeCount);
+			void				SetNewInode(uint32 inode)
+									{ _Set(XFS_AGI_NEWINO, inode); }
+			uint32				Unlinked(uint32 bucket) const
+									{ return _Get(XFS_AGI_UNLINKED
+										+ bucket * sizeof(uint32)); }
+			void				SetUnlinked(uint32 bucket, uint32 inode)
+									{ _Set(XFS_AGI_UNLINKED
+										+ bucket * sizeof(uint32), inode); }
+
+			xfs_agblock_t		Root(int tree) const;
+			uint32				Levels(int tree) const;
+			void				SetRoot(int tree, xfs_agblock_t root,
+									uint32 levels);
+
+			status_t			AllocateTreeBlock(int tree,
+									xfs_agblock_t& _block);
+			status_t			FreeTreeBlock(int tree, xfs_agblock_t block);
+
+private:
+			uint32				_Get(uint32 offset) const
+									{ return read32(fAGI->data, offset); }
+			void				_Set(uint32 offset, uint32 value);
+			void				_AddTreeBlocks(int tree, int32 count);
+
+private:
+			Transaction&		fTransaction;
+			Volume*				fVolume;
+			xfs_agnumber_t		fNumber;
+			TransactionBuffer*	fAGI;
+};
+
+
+/*!	The inode B+tree or the free inode B+tree of an allocation group. Blocks
+	for them come from the free space of the group.
+*/
+class InodeTree : public ShortBTree {
+public:
+								InodeTree(InodeGroup& group, int tree);
+
+			status_t			Lookup(uint32 start, lookup_mode mode,
+									bool& _found);
+			InodeChunk			Chunk() const;
+
+			status_t			Update(const InodeChunk& chunk);
+			status_t			Insert(const InodeChunk& chunk);
+
+protected:
+	virtual	int					_CompareKeys(const uint8* a,
+									const uint8* b) const;
+	virtual	xfs_agblock_t		_Root() const
+									{ return fInodeGroup.Root(fTree); }
+	virtual	uint32				_Levels() const
+									{ return fInodeGroup.Levels(fTree); }
+	virtual	void				_SetRoot(xfs_agblock_t root, uint32 levels)
+									{ fInodeGroup.SetRoot(fTree, root,
+										levels); }
+	virtual	status_t			_AllocateBlock(xfs_agblock_t& _block)
+									{ return fInodeGroup
+										.AllocateTreeBlock(fTree, _block); }
+	virtual	bool				_CanFreeBlock() const
+									{ return true; }
+	virtual	status_t			_FreeBlock(xfs_agblock_t block)
+									{ return fInodeGroup
+										.FreeTreeBlock(fTree, block); }
+
+private:
+			void				_ToRecord(const InodeChunk& chunk,
+									uint8* record) const;
+
+private:
+			InodeGroup&			fInodeGroup;
+			int					fTree;
+};
+
+
+struct InodeAllocator::UndoEntry {
+	Inode*	inode;
+	int32	action;
+	uint32	next;
+};
+
+enum {
+	kUndoNext,
+		// restore the next pointer of the inode
+	kUndoAdd,
+		// forget about the inode again
+	kUndoRemove
+		// remember the inode again
+};
+
+
+static const uint32 kInodeRecordSize = 16;
+
+
+uint64
+InodeChunk::Holes() const
+{
+	uint64 holes = 0;
+	for (uint32 i = 0; i < XFS_INODES_PER_CHUNK / XFS_INODES_PER_HOLEMASK_BIT;
+			i++) {
+		if ((holeMask & (1 << i)) != 0)
+			holes |= 0xfULL << (i * XFS_INODES_PER_HOLEMASK_BIT);
+	}
+	return holes;
+}
+
+
+//	#pragma mark - InodeGroup
+
+
+InodeGroup::InodeGroup(Transaction& transaction, xfs_agnumber_t number)
+	:
+	fTransaction(transaction),
+	fVolume(transaction.GetVolume()),
+	fNumber(number),
+	fAGI(NULL)
+{
+}
+
+
+status_t
+InodeGroup::Init()
+{
+	bool version5 = fVolume->IsVersion5();
+	uint32 sectorSize = fVolume->SectorSize();
+	off_t offset = (((off_t)fNumber * fVolume->AgBlocks())
+		<< fVolume->BlockLog()) + 2 * sectorSize;
+
+	status_t status = fTransaction.GetBuffer(offset, sectorSize,
+		XFS_BLFT_AGI_BUF, version5 ? XFS_AGI_CRC : -1,
+		version5 ? XFS_AGI_LSN : -1, fAGI);
+	if (status != B_OK)
+		return status;
+
+	if (fAGI->verified)
+		return B_OK;
+
+	if (_Get(0) != XFS_AGI_MAGIC || _Get(4) != XFS_AGI_VERSION
+		|| _Get(XFS_AGI_SEQNO) != fNumber) {
+		ERROR("InodeGroup: bad AGI in group %" B_PRIu32 "\n", fNumber);
+		return B_BAD_DATA;
+	}
+	if (version5) {
+		if (!xfs_verify_cksum((const char*)fAGI->data, sectorSize,
+				XFS_AGI_CRC)
+			|| !fVolume->UuidEquals(*(uuid_t*)(fAGI->data + XFS_AGI_UUID))) {
+			ERROR("InodeGroup: AGI of group %" B_PRIu32 " is corrupted\n",
+				fNumber);
+			return B_BAD_DATA;
+		}
+	}
+	if (Levels(XFS_BTNUM_INO) == 0
+		|| Levels(XFS_BTNUM_INO) > XFS_BTREE_MAX_LEVELS
+		|| (HasFreeInodeTree() && (Levels(XFS_BTNUM_FINO) == 0
+			|| Levels(XFS_BTNUM_FINO) > XFS_BTREE_MAX_LEVELS))
+		|| FreeCount() > _Get(XFS_AGI_COUNT)) {
+		ERROR("InodeGroup: bad AGI in group %" B_PRIu32 "\n", fNumber);
+		return B_BAD_DATA;
+	}
+
+	fAGI->verified = true;
+	return B_OK;
+}
+
+
+bool
+InodeGroup::HasFreeInodeTree() const
+{
+	return (fVolume->SuperBlock().ReadOnlyCompatFeatures()
+		& XFS_SB_FEAT_RO_COMPAT_FINOBT) != 0;
+}
+
+
+bool
+InodeGroup::HasSparseChunks() const
+{
+	return (fVolume->SuperBlock().IncompatFeatures()
+		& XFS_SB_FEAT_INCOMPAT_SPINODES) != 0;
+}
+
+
+void
+InodeGroup::AddInodes(int32 count, int32 freeCount)
+{
+	if (count != 0)
+		_Set(XFS_AGI_COUNT, _Get(XFS_AGI_COUNT) + count);
+	_Set(XFS_AGI_FREECOUNT, FreeCount() + freeCount);
+}
+
+
+xfs_agblock_t
+InodeGroup::Root(int tree) const
+{
+	return _Get(tree == XFS_BTNUM_INO ? XFS_AGI_ROOT : XFS_AGI_FREE_ROOT);
+}
+
+
+uint32
+InodeGroup::Levels(int tree) const
+{
+	return _Get(tree == XFS_BTNUM_INO ? XFS_AGI_LEVEL : XFS_AGI_FREE_LEVEL);
+}
+
+
+void
+InodeGroup::SetRoot(int tree, xfs_agblock_t root, uint32 levels)
+{
+	_Set(tree == XFS_BTNUM_INO ? XFS_AGI_ROOT : XFS_AGI_FREE_ROOT, root);
+	_Set(tree == XFS_BTNUM_INO ? XFS_AGI_LEVEL : XFS_AGI_FREE_LEVEL, levels);
+}
+
+
+status_t
+InodeGroup::AllocateTreeBlock(int tree, xfs_agblock_t& _block)
+{
+	status_t status = fVolume->GetBlockAllocator()->AllocateInGroup(
+		fTransaction, fNumber, 1, 0, _block);
+	if (status == B_DEVICE_FULL) {
+		// the tree is already half updated at this point, the transaction
+		// must not be committed
+		ERROR("InodeGroup: no space left for the inode B+tree in group %"
+			B_PRIu32 "\n", fNumber);
+		return B_ERROR;
+	}
+	if (status != B_OK)
+		return status;
+
+	_AddTreeBlocks(tree, 1);
+	return B_OK;
+}
+
+
+status_t
+InodeGroup::FreeTreeBlock(int tree, xfs_agblock_t block)
+{
+	status_t status = fVolume->GetBlockAllocator()->Free(fTransaction,
+		((xfs_fsblock_t)fNumber << fVolume->AgBlocksLog()) | block, 1);
+	if (status == B_DEVICE_FULL)
+		return B_ERROR;
+	if (status != B_OK)
+		return status;
+
+	_AddTreeBlocks(tree, -1);
+	return B_OK;
+}
+
+
+void
+InodeGroup::_Set(uint32 offset, uint32 value)
+{
+	write32(fAGI->data, offset, value);
+	fTransaction.MarkDirty(fAGI, offset, 4);
+}
+
+
+void
+InodeGroup::_AddTreeBlocks(int tree, int32 count)
+{
+	if ((fVolume->SuperBlock().ReadOnlyCompatFeatures()
+			& XFS_SB_FEAT_RO_COMPAT_INOBTCNT) == 0) {
+		return;
+	}
+
+	uint32 offset = tree == XFS_BTNUM_INO ? XFS_AGI_IBLOCKS : XFS_AGI_FBLOCKS;
+	_Set(offset, _Get(offset) + count);
+}
+
+
+//	#pragma mark - InodeTree
+
+
+InodeTree::InodeTree(InodeGroup& group, int tree)
+	:
+	ShortBTree(group.GetTransaction(), group.Number(),
+		group.GetVolume()->IsVersion5()
+			? (tree == XFS_BTNUM_INO ? XFS_IBT_CRC_MAGIC : XFS_FIBT_CRC_MAGIC)
+			: (tree == XFS_BTNUM_INO ? XFS_IBT_MAGIC : XFS_FIBT_MAGIC),
+		kInodeRecordSize, sizeof(uint32)),
+	fInodeGroup(group),
+	fTree(tree)
+{
+}
+
+
+status_t
+InodeTree::Lookup(uint32 start, lookup_mode mode, bool& _found)
+{
+	uint8 key[sizeof(uint32)];
+	write32(key, 0, start);
+	return ShortBTree::Lookup(key, mode, _found);
+}
+
+
+InodeChunk
+InodeTree::Chunk() const
+{
+	const uint8* record = ShortBTree::Record();
+	InodeChunk chunk;
+	chunk.start = read32(record, 0);
+	if (fInodeGroup.HasSparseChunks()) {
+		chunk.holeMask = read16(record, 4);
+		chunk.count = record[6];
+		chunk.freeCount = record[7];
+	} else {
+		chunk.holeMask = 0;
+		chunk.count = XFS_INODES_PER_CHUNK;
+		chunk.freeCount = read32(record, 4);
+	}
+	chunk.free = B_BENDIAN_TO_HOST_INT64(*(const uint64*)(record + 8));
+	return chunk;
+}
+
+
+status_t
+InodeTree::Update(const InodeChunk& chunk)
+{
+	uint8 record[kInodeRecordSize];
+	_ToRecord(chunk, record);
+	return ShortBTree::Update(record);
+}
+
+
+status_t
+InodeTree::Insert(const InodeChunk& chunk)
+{
+	uint8 record[kInodeRecordSize];
+	_ToRecord(chunk, record);
+	return ShortBTree::Insert(record);
+}
+
+
+int
+InodeTree::_CompareKeys(const uint8* a, const uint8* b) const
+{
+	uint32 startA = read32(a, 0);
+	uint32 startB = read32(b, 0);
+	if (startA != startB)
+		return startA < startB ? -1 : 1;
+	return 0;
+}
+
+
+void
+InodeTree::_ToRecord(const InodeChunk& chunk, uint8* record) const
+{
+	write32(record, 0, chunk.start);
+	if (fInodeGroup.HasSparseChunks()) {
+		write16(record, 4, chunk.holeMask);
+		record[6] = chunk.count;
+		record[7] = chunk.freeCount;
+	} else
+		write32(record, 4, chunk.freeCount);
+	*(uint64*)(record + 8) = B_HOST_TO_BENDIAN_INT64(chunk.free);
+}
+
+
+//	#pragma mark - InodeAllocator
+
+
+InodeAllocator::InodeAllocator(Volume* volume)
+	:
+	fVolume(volume),
+	fUnlinked(NULL),
+	fUnlinkedCount(0),
+	fUnlinkedCapacity(0),
+	fUndo(NULL),
+	fUndoCount(0),
+	fUndoCapacity(0)
+{
+}
+
+
+InodeAllocator::~InodeAllocator()
+{
+	free(fUnlinked);
+	free(fUndo);
+}
+
+
+/*!	Returns B_BUSY if any allocation group still has inodes in its unlinked
+	lists. Linux frees them after a crash; until it has done so, the lists
+	must not be changed here.
+*/
+status_t
+InodeAllocator::CheckUnlinked()
+{
+	// nothing is changed, the transaction is only used for reading
+	Transaction transaction(fVolume);
+	status_t status = transaction.Start();
+	if (status != B_OK)
+		return status;
+
+	for (xfs_agnumber_t number = 0; number < fVolume->AgCount(); number++) {
+		InodeGroup group(transaction, number);
+		status = group.Init();
+		if (status != B_OK)
+			return status;
+
+		for (uint32 bucket = 0; bucket < XFS_AGI_UNLINKED_BUCKETS;
+				bucket++) {
+			if (group.Unlinked(bucket) != NULLAGINO)
+				return B_BUSY;
+		}
+	}
+
+	return B_OK;
+}
+
+
+/*!	Allocates an inode, preferably in the allocation group of \a parent.
+	Free inodes in any group are used before a new chunk is added.
+	B_DEVICE_FULL leaves the transaction consistent, it may still be
+	committed; after any other error, it must not be.
+	The caller has to initialize the inode itself.
+*/
+status_t
+InodeAllocator::Allocate(Transaction& transaction, xfs_ino_t parent,
+	xfs_ino_t& _id)
+{
+	xfs_agnumber_t groupCount = fVolume->AgCount();
+	xfs_agnumber_t first = INO_TO_AGNO(parent, fVolume);
+	if (first >= groupCount)
+		first = 0;
+
+	for (int pass = 0; pass < 2; pass++) {
+		for (xfs_agnumber_t i = 0; i < groupCount; i++) {
+			status_t status = _AllocateInGroup(transaction,
+				(first + i) % groupCount, pass == 1, _id);
+			if (status != B_DEVICE_FULL)
+				return status;
+		}
+	}
+
+	return B_DEVICE_FULL;
+}
+
+
+/*!	Marks the inode \a id free again. The caller must have cleared it
+	already. Any error leaves the transaction half updated, it must not be
+	committed then.
+*/
+status_t
+InodeAllocator::Free(Transaction& transaction, xfs_ino_t id)
+{
+	xfs_agnumber_t number = INO_TO_AGNO(id, fVolume);
+	uint32 inode = INO_TO_AGINO(id, fVolume->AgInodeBits());
+	if (number >= fVolume->AgCount()) {
+		ERROR("InodeAllocator: cannot free bad inode %" B_PRIu64 "\n", id);
+		return B_BAD_VALUE;
+	}
+
+	InodeGroup group(transaction, number);
+	status_t status = group.Init();
+	if (status != B_OK)
+		return status;
+
+	InodeTree inodes(group, XFS_BTNUM_INO);
+	bool found;
+	status = inodes.Lookup(inode, LOOKUP_LE, found);
+	if (status != B_OK)
+		return status;
+
+	InodeChunk chunk;
+	uint64 mask = 0;
+	if (found) {
+		chunk = inodes.Chunk();
+		if (inode - chunk.start < XFS_INODES_PER_CHUNK)
+			mask = 1ULL << (inode - chunk.start);
+	}
+	if (mask == 0 || (chunk.free & mask) != 0) {
+		ERROR("InodeAllocator: inode %" B_PRIu64 " is not in use\n", id);
+		return B_BAD_DATA;
+	}
+
+	chunk.free |= mask;
+	chunk.freeCount++;
+	status = inodes.Update(chunk);
+	if (status != B_OK)
+		return status;
+
+	if (group.HasFreeInodeTree()) {
+		InodeTree freeInodes(group, XFS_BTNUM_FINO);
+		lookup_mode mode = chunk.freeCount == 1 ? LOOKUP_LE : LOOKUP_EQ;
+		status = freeInodes.Lookup(chunk.start, mode, found);
+		if (status == B_OK && mode == LOOKUP_EQ && !found)
+			status = B_BAD_DATA;
+		if (status == B_OK) {
+			if (mode == LOOKUP_LE)
+				status = freeInodes.Insert(chunk);
+			else
+				status = freeInodes.Update(chunk);
+		}
+		if (status != B_OK)
+			return status;
+	}
+
+	group.AddInodes(0, 1);
+	transaction.AdjustCounters(0, 0, 1);
+	return B_OK;
+}
+
+
+/*!	Adds the inode to the unlinked list of its allocation group, once its
+	last link is gone but it is still open. It is remembered until
+	RemoveUnlinked() or ForgetUnlinked() is called for it.
+	Any error leaves the transaction half updated, it must not be committed
+	then.
+*/
+status_t
+InodeAllocator::AddUnlinked(Transaction& transaction, Inode* inode)
+{
+	xfs_ino_t id = inode->ID();
+	xfs_agnumber_t number = INO_TO_AGNO(id, fVolume);
+	uint32 agInode = INO_TO_AGINO(id, fVolume->AgInodeBits());
+	uint32 bucket = agInode % XFS_AGI_UNLINKED_BUCKETS;
+
+	InodeGroup group(transaction, number);
+	status_t status = group.Init();
+	if (status != B_OK)
+		return status;
+
+	if (fUnlinkedCount == fUnlinkedCapacity) {
+		int32 capacity = max_c(8, fUnlinkedCapacity * 2);
+		Inode** unlinked = (Inode**)realloc(fUnlinked,
+			capacity * sizeof(Inode*));
+		if (unlinked == NULL)
+			return B_NO_MEMORY;
+
+		fUnlinked = unlinked;
+		fUnlinkedCapacity = capacity;
+	}
+
+	status = _AddUndo(transaction, inode, kUndoAdd);
+	if (status != B_OK)
+		return status;
+	fUnlinked[fUnlinkedCount++] = inode;
+
+	// the inode becomes the new head of the list
+	status = _SetNextUnlinked(transaction, id, group.Unlinked(bucket));
+	if (status != B_OK)
+		return status;
+
+	group.SetUnlinked(bucket, agInode);
+	return B_OK;
+}
+
+
+/*!	Removes the inode from the unlinked list of its allocation group, before
+	it is freed. Any error leaves the transaction half updated, it must not
+	be committed then.
+*/
+status_t
+InodeAllocator::RemoveUnlinked(Transaction& transaction, Inode* inode)
+{
+	xfs_ino_t id = inode->ID();
+	xfs_agnumber_t number = INO_TO_AGNO(id, fVolume);
+	uint32 agInode = INO_TO_AGINO(id, fVolume->AgInodeBits());
+	uint32 bucket = agInode % XFS_AGI_UNLINKED_BUCKETS;
+	xfs_ino_t groupStart = (xfs_ino_t)number << fVolume->AgInodeBits();
+
+	InodeGroup group(transaction, number);
+	status_t status = group.Init();
+	if (status != B_OK)
+		return status;
+
+	uint32 next;
+	status = _GetNextUnlinked(transaction, id, next);
+	if (status != B_OK)
+		return status;
+
+	if (group.Unlinked(bucket) == agInode)
+		group.SetUnlinked(bucket, next);
+	else {
+		// the list is singly linked, the inode before it has to be found
+		uint32 current = group.Unlinked(bucket);
+		for (uint32 count = 0; ; count++) {
+			if (current == NULLAGINO || count > group.Count()) {
+				ERROR("InodeAllocator: inode %" B_PRIu64 " is not in its "
+					"unlinked list\n", id);
+				return B_BAD_DATA;
+			}
+
+			uint32 currentNext;
+			status = _GetNextUnlinked(transaction, groupStart | current,
+				currentNext);
+			if (status != B_OK)
+				return status;
+
+			if (currentNext == agInode) {
+				status = _SetNextUnlinked(transaction, groupStart | current,
+					next);
+				if (status != B_OK)
+					return status;
+				break;
+			}
+
+			current = currentNext;
+		}
+	}
+
+	status = _SetNextUnlinked(transaction, id, NULLAGINO);
+	if (status != B_OK)
+		return status;
+
+	int32 index = _FindUnlinked(id);
+	if (index >= 0) {
+		status = _AddUndo(transaction, inode, kUndoRemove);
+		if (status != B_OK)
+			return status;
+		fUnlinked[index] = fUnlinked[--fUnlinkedCount];
+	}
+
+	return B_OK;
+}
+
+
+/*!	Forgets about the inode without removing it from its unlinked list, when
+	it could not be freed. Linux will do so after the next crash or mount.
+	Has to be called within a started transaction; not the failed one
+	though, as reverting that one would add the inode back.
+*/
+void
+InodeAllocator::ForgetUnlinked(Inode* inode)
+{
+	int32 index = _FindUnlinked(inode->ID());
+	if (index >= 0)
+		fUnlinked[index] = fUnlinked[--fUnlinkedCount];
+}
+
+
+void
+InodeAllocator::TransactionDone(bool success)
+{
+	if (!success) {
+		for (int32 i = fUndoCount - 1; i >= 0; i--) {
+			const UndoEntry& entry = fUndo[i];
+			switch (entry.action) {
+				case kUndoNext:
+					entry.inode->SetNextUnlinked(entry.next);
+					break;
+				case kUndoAdd:
+					ForgetUnlinked(entry.inode);
+					break;
+				case kUndoRemove:
+					// there is still room for it
+					fUnlinked[fUnlinkedCount++] = entry.inode;
+					break;
+			}
+		}
+	}
+
+	fUndoCount = 0;
+}
+
+
+status_t
+InodeAllocator::_AllocateInGroup(Transaction& transaction,
+	xfs_agnumber_t number, bool addChunk, xfs_ino_t& _id)
+{
+	InodeGroup group(transaction, number);
+	status_t status = group.Init();
+	if (status != B_OK)
+		return status;
+
+	InodeChunk chunk;
+	if (group.FreeCount() > 0)
+		status = _FindFreeChunk(group, chunk);
+	else if (addChunk)
+		status = _AddChunk(group, chunk);
+	else
+		return B_DEVICE_FULL;
+	if (status != B_OK)
+		return status;
+
+	uint64 free = chunk.free & ~chunk.Holes();
+	if (free == 0 || chunk.freeCount == 0) {
+		ERROR("InodeAllocator: chunk %" B_PRIu32 " in group %" B_PRIu32
+			" has no free inodes\n", chunk.start, number);
+		return B_BAD_DATA;
+	}
+
+	uint32 index = 0;
+	while ((free & (1ULL << index)) == 0)
+		index++;
+
+	chunk.free &= ~(1ULL << index);
+	chunk.freeCount--;
+
+	InodeTree inodes(group, XFS_BTNUM_INO);
+	bool found;
+	status = inodes.Lookup(chunk.start, LOOKUP_EQ, found);
+	if (status == B_OK && !found)
+		status = B_BAD_DATA;
+	if (status == B_OK)
+		status = inodes.Update(chunk);
+
+	if (status == B_OK && group.HasFreeInodeTree()) {
+		InodeTree freeInodes(group, XFS_BTNUM_FINO);
+		status = freeInodes.Lookup(chunk.start, LOOKUP_EQ, found);
+		if (status == B_OK && !found)
+			status = B_BAD_DATA;
+		if (status == B_OK) {
+			if (chunk.freeCount == 0)
+				status = freeInodes.Delete();
+			else
+				status = freeInodes.Update(chunk);
+		}
+	}
+	if (status != B_OK)
+		return status;
+
+	group.AddInodes(0, -1);
+	transaction.AdjustCounters(0, 0, -1);
+
+	_id = ((xfs_ino_t)number << fVolume->AgInodeBits())
+		| (chunk.start + index);
+	return B_OK;
+}
+
+
+status_t
+InodeAllocator::_FindFreeChunk(InodeGroup& group, InodeChunk& _chunk)
+{
+	// without a free inode B+tree, all chunks have to be searched
+	InodeTree tree(group, group.HasFreeInodeTree()
+		? XFS_BTNUM_FINO : XFS_BTNUM_INO);
+
+	bool found;
+	status_t status = tree.Lookup(0, LOOKUP_GE, found);
+	while (status == B_OK && found) {
+		_chunk = tree.Chunk();
+		if (_chunk.freeCount > 0)
+			return B_OK;
+
+		status = tree.Next(found);
+	}
+	if (status != B_OK)
+		return status;
+
+	ERROR("InodeAllocator: free inode count of group %" B_PRIu32
+		" is wrong\n", group.Number());
+	return B_BAD_DATA;
+}
+
+
+/*!	Allocates a new chunk of inodes, and adds it to the inode B+trees.
+	The chunk is always allocated in full, even if the volume supports
+	sparse chunks.
+*/
+status_t
+InodeAllocator::_AddChunk(InodeGroup& group, InodeChunk& _chunk)
+{
+	XfsSuperBlock& superBlock = fVolume->SuperBlock();
+	uint32 inodesPerBlock = superBlock.InodesPerBlock();
+	if (inodesPerBlock > XFS_INODES_PER_CHUNK)
+		return B_NOT_SUPPORTED;
+
+	uint32 alignment = 1;
+	if (superBlock.HasAlign() && superBlock.InodeAlignment() > 0)
+		alignment = superBlock.InodeAlignment();
+
+	xfs_agblock_t block;
+	status_t status = fVolume->GetBlockAllocator()->AllocateInGroup(
+		group.GetTransaction(), group.Number(),
+		XFS_INODES_PER_CHUNK / inodesPerBlock, alignment, block);
+	if (status != B_OK)
+		return status;
+
+	_chunk.start = block << fVolume->InodesPerBlkLog();
+	_chunk.holeMask = 0;
+	_chunk.count = XFS_INODES_PER_CHUNK;
+	_chunk.freeCount = XFS_INODES_PER_CHUNK;
+	_chunk.free = ~0ULL;
+
+	status = _InitChunk(group, _chunk.start);
+	if (status != B_OK)
+		return status;
+
+	InodeTree inodes(group, XFS_BTNUM_INO);
+	bool found;
+	status = inodes.Lookup(_chunk.start, LOOKUP_LE, found);
+	if (status == B_OK)
+		status = inodes.Insert(_chunk);
+
+	if (status == B_OK && group.HasFreeInodeTree()) {
+		InodeTree freeInodes(group, XFS_BTNUM_FINO);
+		status = freeInodes.Lookup(_chunk.start, LOOKUP_LE, found);
+		if (status == B_OK)
+			status = freeInodes.Insert(_chunk);
+	}
+	if (status != B_OK)
+		return status;
+
+	group.AddInodes(XFS_INODES_PER_CHUNK, XFS_INODES_PER_CHUNK);
+	group.SetNewInode(_chunk.start);
+	group.GetTransaction().AdjustCounters(0, XFS_INODES_PER_CHUNK,
+		XFS_INODES_PER_CHUNK);
+	return B_OK;
+}
+
+
+/*!	Writes empty inodes to the new chunk starting at \a start, through the
+	same cluster buffers that are used to read them later on.
+*/
+status_t
+InodeAllocator::_InitChunk(InodeGroup& group, uint32 start)
+{
+	Transaction& transaction = group.GetTransaction();
+	bool version5 = fVolume->IsVersion5();
+	uint32 inodeSize = fVolume->InodeSize();
+	xfs_ino_t first = ((xfs_ino_t)group.Number() << fVolume->AgInodeBits())
+		| start;
+
+	for (uint32 i = 0; i < XFS_INODES_PER_CHUNK; i++) {
+		int64 blockNumber;
+		int32 length;
+		int32 offset;
+		fVolume->GetInodeClusterLocation(first + i, blockNumber, length,
+			offset);
+
+		TransactionBuffer* buffer;
+		status_t status = transaction.GetBuffer(blockNumber << XLOG_BB_SHIFT,
+			length << XLOG_BB_SHIFT, XFS_BLFT_DINO_BUF, -1, -1, buffer);
+		if (status != B_OK)
+			return status;
+
+		// the whole inode is logged
+		buffer->flags &= ~XFS_BLF_INODE_BUF;
+
+		Inode::Dinode* node = (Inode::Dinode*)(buffer->data + offset);
+		memset(node, 0, inodeSize);
+		node->di_magic = B_HOST_TO_BENDIAN_INT16(INODE_MAGIC);
+		node->di_version = version5 ? 3 : 2;
+		node->di_next_unlinked = B_HOST_TO_BENDIAN_INT32(NULLAGINO);
+		if (version5) {
+			node->di_ino = B_HOST_TO_BENDIAN_INT64(first + i);
+			memcpy(&node->di_uuid, &fVolume->SuperBlock().MetaUuid(),
+				sizeof(uuid_t));
+			xfs_update_cksum((const char*)node, inodeSize, INODE_CRC_OFF);
+		}
+
+		transaction.MarkDirty(buffer, offset, inodeSize);
+	}
+
+	return B_OK;
+}
+
+
+/*!	Reads the next pointer of the inode in its unlinked list from disk, as
+	seen by the transaction.
+*/
+status_t
+InodeAllocator::_GetNextUnlinked(Transaction& transaction, xfs_ino_t id,
+	uint32& _next)
+{
+	int64 blockNumber;
+	int32 length;
+	int32 offset;
+	fVolume->GetInodeClusterLocation(id, blockNumber, length, offset);
+
+	TransactionBuffer* buffer;
+	status_t status = transaction.GetBuffer(blockNumber << XLOG_BB_SHIFT,
+		length << XLOG_BB_SHIFT, XFS_BLFT_DINO_BUF, -1, -1, buffer);
+	if (status != B_OK)
+		return status;
+
+	const Inode::Dinode* node = (const Inode::Dinode*)(buffer->data + offset);
+	if (B_BENDIAN_TO_HOST_INT16(node->di_magic) != INODE_MAGIC) {
+		ERROR("InodeAllocator: bad inode %" B_PRIu64 " in unlinked list\n",
+			id);
+		return B_BAD_DATA;
+	}
+
+	_next = B_BENDIAN_TO_HOST_INT32(node->di_next_unlinked);
+	return B_OK;
+}
+
+
+/*!	Changes the next pointer of the inode in its unlinked list. Only that
+	field of the inode cluster buffer is logged, the rest of the inode may
+	be logged separately in the same transaction.
+	An open inode is updated in memory, too.
+*/
+status_t
+InodeAllocator::_SetNextUnlinked(Transaction& transaction, xfs_ino_t id,
+	uint32 next)
+{
+	uint32 inodeSize = fVolume->InodeSize();
+	int64 blockNumber;
+	int32 length;
+	int32 offset;
+	fVolume->GetInodeClusterLocation(id, blockNumber, length, offset);
+
+	TransactionBuffer* buffer;
+	status_t status = transaction.GetBuffer(blockNumber << XLOG_BB_SHIFT,
+		length << XLOG_BB_SHIFT, XFS_BLFT_DINO_BUF, -1, -1, buffer);
+	if (status != B_OK)
+		return status;
+
+	int32 index = _FindUnlinked(id);
+	if (index >= 0) {
+		Inode* inode = fUnlinked[index];
+		status = _AddUndo(transaction, inode, kUndoNext,
+			inode->NextUnlinked());
+		if (status != B_OK)
+			return status;
+
+		inode->SetNextUnlinked(next);
+	}
+
+	if (!buffer->dirty)
+		buffer->flags |= XFS_BLF_INODE_BUF;
+
+	Inode::Dinode* node = (Inode::Dinode*)(buffer->data + offset);
+	node->di_next_unlinked = B_HOST_TO_BENDIAN_INT32(next);
+
+	// the checksum directly follows the pointer
+	uint32 changed = sizeof(uint32);
+	if (fVolume->IsVersion5()) {
+		xfs_update_cksum((const char*)node, inodeSize, INODE_CRC_OFF);
+		changed += sizeof(uint32);
+	}
+
+	transaction.MarkDirty(buffer,
+		offset + offsetof(Inode::Dinode, di_next_unlinked), changed);
+	return B_OK;
+}
+
+
+int32
+InodeAllocator::_FindUnlinked(xfs_ino_t id) const
+{
+	for (int32 i = 0; i < fUnlinkedCount; i++) {
+		if (fUnlinked[i]->ID() == id)
+			return i;
+	}
+
+	return -1;
+}
+
+
+status_t
+InodeAllocator::_AddUndo(Transaction& transaction, Inode* inode,
+	int32 action, uint32 next)
+{
+	if (fUndoCount == fUndoCapacity) {
+		int32 capacity = max_c(4, fUndoCapacity * 2);
+		UndoEntry* undo = (UndoEntry*)realloc(fUndo,
+			capacity * sizeof(UndoEntry));
+		if (undo == NULL)
+			return B_NO_MEMORY;
+
+		fUndo = undo;
+		fUndoCapacity = capacity;
+	}
+
+	UndoEntry& entry = fUndo[fUndoCount++];
+	entry.inode = inode;
+	entry.action = action;
+	entry.next = next;
+
+	transaction.AddListener(this);
+	return B_OK;
+}
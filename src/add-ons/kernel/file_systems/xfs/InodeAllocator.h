@@ -0,0 +1,115 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _XFS_INODE_ALLOCATOR_H_
+#define _XFS_INODE_ALLOCATOR_H_
+
+
+#include "Journal.h"
+
+
+class Inode;
+class InodeGroup;
+class Volume;
+struct InodeChunk;
+
+
+#define XFS_AGI_MAGIC			0x58414749
+#define XFS_AGI_VERSION			1
+#define XFS_IBT_MAGIC			0x49414254
+#define XFS_IBT_CRC_MAGIC		0x49414233
+#define XFS_FIBT_MAGIC			0x46494254
+#define XFS_FIBT_CRC_MAGIC		0x46494233
+
+#define XFS_BTNUM_INO			0
+#define XFS_BTNUM_FINO			1
+
+#define NULLAGINO				((uint32)-1)
+#define XFS_INODES_PER_CHUNK	64
+#define XFS_INODES_PER_HOLEMASK_BIT	4
+#define XFS_AGI_UNLINKED_BUCKETS	64
+
+// offsets into the AGI
+#define XFS_AGI_SEQNO			8
+#define XFS_AGI_COUNT			16
+#define XFS_AGI_ROOT			20
+#define XFS_AGI_LEVEL			24
+#define XFS_AGI_FREECOUNT		28
+#define XFS_AGI_NEWINO			32
+#define XFS_AGI_UNLINKED		40
+#define XFS_AGI_UUID			296
+#define XFS_AGI_CRC				312
+#define XFS_AGI_LSN				320
+#define XFS_AGI_FREE_ROOT		328
+#define XFS_AGI_FREE_LEVEL		332
+#define XFS_AGI_IBLOCKS			336
+#define XFS_AGI_FBLOCKS			340
+
+
+/*!	Allocates and frees inodes. Each allocation group keeps track of its
+	inode chunks of 64 inodes in the inode B+tree; the chunks that still
+	have free inodes are also kept in the free inode B+tree, if the volume
+	has one. Both trees are updated within the given transaction, together
+	with the AGI. New chunks are allocated when no free inode is left, but
+	they are never freed again.
+	Inodes that are still open after their last link was removed are kept
+	in the unlinked lists of the AGI until they are freed, so that Linux
+	would free them after a crash.
+*/
+class InodeAllocator : public TransactionListener {
+public:
+								InodeAllocator(Volume* volume);
+	virtual						~InodeAllocator();
+
+			status_t			CheckUnlinked();
+
+			status_t			Allocate(Transaction& transaction,
+									xfs_ino_t parent, xfs_ino_t& _id);
+			status_t			Free(Transaction& transaction,
+									xfs_ino_t id);
+
+			status_t			AddUnlinked(Transaction& transaction,
+									Inode* inode);
+			status_t			RemoveUnlinked(Transaction& transaction,
+									Inode* inode);
+			void				ForgetUnlinked(Inode* inode);
+
+	virtual	void				TransactionDone(bool success);
+
+private:
+			struct UndoEntry;
+
+			status_t			_AllocateInGroup(Transaction& transaction,
+									xfs_agnumber_t group, bool addChunk,
+									xfs_ino_t& _id);
+			status_t			_FindFreeChunk(InodeGroup& group,
+									InodeChunk& _chunk);
+			status_t			_AddChunk(InodeGroup& group,
+									InodeChunk& _chunk);
+			status_t			_InitChunk(InodeGroup& group,
+									uint32 start);
+
+			status_t			_GetNextUnlinked(Transaction& transaction,
+									xfs_ino_t id, uint32& _next);
+			status_t			_SetNextUnlinked(Transaction& transaction,
+									xfs_ino_t id, uint32 next);
+			int32				_FindUnlinked(xfs_ino_t id) const;
+			status_t			_AddUndo(Transaction& transaction,
+									Inode* inode, int32 action,
+									uint32 next = 0);
+
+private:
+			Volume*				fVolume;
+			Inode**				fUnlinked;
+				// the inodes in the unlinked lists that are still open
+			int32				fUnlinkedCount;
+			int32				fUnlinkedCapacity;
+			UndoEntry*			fUndo;
+				// how to revert the above, if the transaction fails
+			int32				fUndoCount;
+			int32				fUndoCapacity;
+};
+
+
+#endif	// _XFS_INODE_ALLOCATOR_H_
@@ -0,0 +1,878 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "Journal.h"
+
+#include "Checksum.h"
+#include "Inode.h"
+#include "Volume.h"
+
+
+static const uint32 kMaxRecordSize = XLOG_HEADER_CYCLE_SIZE;
+	// we never need extended record headers this way
+static const uint32 kMaxRecordData = kMaxRecordSize - XLOG_BB_SIZE;
+static const uint32 kMaxRegionChunks = 16384 / XFS_BLF_CHUNK;
+static const uint32 kMaxHeaderSearch = 2048;
+	// how many blocks to look back for the last record header
+
+
+struct Journal::RecordWriter {
+	RecordWriter(Journal* journal, uint32 transactionID, uint8 clientID)
+		:
+		fJournal(journal),
+		fRecord(NULL),
+		fLength(0),
+		fOpCount(0),
+		fTransactionID(transactionID),
+		fClientID(clientID),
+		fFirstLSN(0)
+	{
+	}
+
+	~RecordWriter()
+	{
+		free(fRecord);
+	}
+
+	status_t Init()
+	{
+		fRecord = (uint8*)malloc(kMaxRecordSize);
+		if (fRecord == NULL)
+			return B_NO_MEMORY;
+		return B_OK;
+	}
+
+	status_t AddOp(uint8 flags, const void* data, uint32 length)
+	{
+		if (sizeof(LogOpHeader) + length > kMaxRecordData)
+			return B_BUFFER_OVERFLOW;
+
+		if (fLength + sizeof(LogOpHeader) + length > kMaxRecordData) {
+			status_t status = Flush();
+			if (status != B_OK)
+				return status;
+		}
+
+		uint8* op = fRecord + XLOG_BB_SIZE + fLength;
+		LogOpHeader* header = (LogOpHeader*)op;
+		header->oh_tid = B_HOST_TO_BENDIAN_INT32(fTransactionID);
+		header->oh_len = B_HOST_TO_BENDIAN_INT32(length);
+		header->oh_clientid = fClientID;
+		header->oh_flags = flags;
+		header->oh_res2 = 0;
+		if (length > 0)
+			memcpy(op + sizeof(LogOpHeader), data, length);
+
+		fLength += sizeof(LogOpHeader) + length;
+		fOpCount++;
+		return B_OK;
+	}
+
+	status_t Flush()
+	{
+		if (fOpCount == 0)
+			return B_OK;
+
+		// all records of a transaction point back to its first one, so that
+		// log recovery would see all of it
+		if (fFirstLSN == 0)
+			fFirstLSN = LSN(fJournal->fCycle, fJournal->fHeadBlock);
+
+		status_t status = fJournal->_WriteRecord(fRecord, fLength, fOpCount,
+			fFirstLSN);
+
+		fLength = 0;
+		fOpCount = 0;
+		return status;
+	}
+
+	xfs_lsn_t FirstLSN() const
+	{
+		return fFirstLSN;
+	}
+
+private:
+	Journal*	fJournal;
+	uint8*		fRecord;
+	uint32		fLength;
+	uint32		fOpCount;
+	uint32		fTransactionID;
+	uint8		fClientID;
+	xfs_lsn_t	fFirstLSN;
+};
+
+
+//	#pragma mark - Journal
+
+
+Journal::Journal(Volume* volume)
+	:
+	fVolume(volume),
+	fOwner(NULL),
+	fStart(0),
+	fBlockCount(0),
+	fRoundOff(XLOG_BB_SIZE),
+	fHeadBlock(0),
+	fCycle(0),
+	fPreviousBlock(0),
+	fTransactionID((uint32)system_time()),
+	fClean(false),
+	fWritten(false)
+{
+	mutex_init(&fLock, "xfs journal");
+}
+
+
+Journal::~Journal()
+{
+	mutex_destroy(&fLock);
+}
+
+
+/*!	Locates the head of the log, and checks if the last record written to it
+	is an unmount record. Only then, the journal may be written to, as we
+	cannot replay a dirty log.
+*/
+status_t
+Journal::Init()
+{
+	XfsSuperBlock& superBlock = fVolume->SuperBlock();
+
+	if (superBlock.LogStart() == 0) {
+		ERROR("Journal::Init(): external logs are not supported\n");
+		return B_NOT_SUPPORTED;
+	}
+
+	fStart = fVolume->FileSystemBlockToOffset(superBlock.LogStart());
+	fBlockCount = (uint32)superBlock.LogBlocks()
+		<< (fVolume->BlockLog() - XLOG_BB_SHIFT);
+
+	if (superBlock.HasLogV2() && superBlock.LogStripeUnit() > 1)
+		fRoundOff = superBlock.LogStripeUnit();
+	if (superBlock.LogSectorSize() > fRoundOff)
+		fRoundOff = superBlock.LogSectorSize();
+	if (fRoundOff > kMaxRecordSize || (kMaxRecordSize % fRoundOff) != 0) {
+		ERROR("Journal::Init(): log stripe unit of %" B_PRIu32 " bytes is "
+			"not supported\n", fRoundOff);
+		return B_NOT_SUPPORTED;
+	}
+
+	status_t status = _FindHead();
+	if (status != B_OK)
+		return status;
+
+	status = _CheckUnmountRecord();
+	if (status != B_OK)
+		return status;
+
+	TRACE("Journal::Init(): head at %" B_PRIu32 ", cycle %" B_PRIu32
+		", clean %d\n", fHeadBlock, fCycle, fClean);
+	return B_OK;
+}
+
+
+status_t
+Journal::Lock(Transaction* owner)
+{
+	status_t status = mutex_lock(&fLock);
+	if (status != B_OK)
+		return status;
+
+	fOwner = owner;
+	return B_OK;
+}
+
+
+void
+Journal::Unlock(Transaction* owner)
+{
+	ASSERT(fOwner == owner);
+	fOwner = NULL;
+	mutex_unlock(&fLock);
+}
+
+
+/*!	Writes all changes of the transaction to the log, and returns the LSN
+	of the checkpoint. Afterwards, the changed metadata may be written to
+	its final location.
+*/
+status_t
+Journal::WriteTransaction(Transaction* transaction, xfs_lsn_t& _lsn)
+{
+	ASSERT(fOwner == transaction);
+
+	if (!fClean)
+		return B_READ_ONLY_DEVICE;
+
+	// Everything the transaction relies on -- the data written to newly
+	// allocated blocks, and the metadata of the previous transactions --
+	// must be on disk before the log claims it is
+	ioctl(fVolume->Device(), B_FLUSH_DRIVE_CACHE);
+
+	uint32 transactionID = _NextTransactionID();
+	RecordWriter writer(this, transactionID, XFS_TRANSACTION);
+	status_t status = writer.Init();
+	if (status != B_OK)
+		return status;
+
+	uint32 itemCount = transaction->fInodeCount;
+	TransactionBufferList::Iterator iterator
+		= transaction->fBuffers.GetIterator();
+	while (TransactionBuffer* buffer = iterator.Next()) {
+		if (buffer->dirty)
+			itemCount++;
+	}
+
+	TransactionHeader header;
+	header.th_magic = XFS_TRANS_HEADER_MAGIC;
+	header.th_type = XFS_TRANS_CHECKPOINT;
+	header.th_tid = transactionID;
+	header.th_num_items = itemCount;
+
+	status = writer.AddOp(XLOG_START_TRANS, NULL, 0);
+	if (status == B_OK)
+		status = writer.AddOp(0, &header, sizeof(header));
+
+	// buffer items, one region per run of dirty chunks
+
+	iterator = transaction->fBuffers.GetIterator();
+	while (TransactionBuffer* buffer = iterator.Next()) {
+		if (status != B_OK)
+			break;
+		if (!buffer->dirty)
+			continue;
+
+		uint32 chunks = buffer->size >> XFS_BLF_SHIFT;
+		uint32 mapSize = (chunks + 31) / 32;
+
+		BufferLogFormat format;
+		memset(&format, 0, sizeof(format));
+		memcpy(format.blf_data_map, buffer->dirtyMap,
+			mapSize * sizeof(uint32));
+
+		uint32 regionCount = 0;
+		for (uint32 chunk = 0; chunk < chunks; chunk++) {
+			if ((buffer->dirtyMap[chunk / 32] & (1UL << (chunk % 32))) != 0
+				&& (chunk % kMaxRegionChunks == 0 || chunk == 0
+					|| (buffer->dirtyMap[(chunk - 1) / 32]
+						& (1UL << ((chunk - 1) % 32))) == 0)) {
+				regionCount++;
+			}
+		}
+
+		format.blf_type = XFS_LI_BUF;
+		format.blf_size = 1 + regionCount;
+		format.blf_flags = buffer->type << XFS_BLFT_SHIFT | buffer->flags;
+		format.blf_len = buffer->size >> XLOG_BB_SHIFT;
+		format.blf_blkno = buffer->offset >> XLOG_BB_SHIFT;
+		format.blf_map_size = mapSize;
+
+		status = writer.AddOp(0, &format, BUFFER_LOG_FORMAT_SIZE(mapSize));
+
+		uint32 chunk = 0;
+		while (status == B_OK && chunk < chunks) {
+			if ((buffer->dirtyMap[chunk / 32] & (1UL << (chunk % 32))) == 0) {
+				chunk++;
+				continue;
+			}
+
+			uint32 start = chunk;
+			do {
+				chunk++;
+			} while (chunk < chunks && chunk % kMaxRegionChunks != 0
+				&& (buffer->dirtyMap[chunk / 32] & (1UL << (chunk % 32)))
+					!= 0);
+
+			status = writer.AddOp(0, buffer->data + (start << XFS_BLF_SHIFT),
+				(chunk - start) << XFS_BLF_SHIFT);
+		}
+	}
+
+	// inode items: the inode core, and the extent list or the local data
+	// of the data fork
+
+	uint8 dinode[sizeof(Inode::Dinode)];
+	for (int32 i = 0; status == B_OK && i < transaction->fInodeCount; i++) {
+		Inode* inode = transaction->fInodes[i];
+
+		uint32 forkSize = 0;
+		uint32 forkField = 0;
+		if (inode->Format() == XFS_DINODE_FMT_EXTENTS) {
+			forkSize = inode->DataExtentsCount() * 2 * sizeof(uint64);
+			forkField = XFS_ILOG_DEXT;
+		} else if (inode->Format() == XFS_DINODE_FMT_LOCAL) {
+			forkSize = ROUNDUP(inode->Size(), 4);
+			forkField = XFS_ILOG_DDATA;
+		}
+
+		InodeLogFormat format;
+		memset(&format, 0, sizeof(format));
+		format.ilf_type = XFS_LI_INODE;
+		format.ilf_size = forkSize > 0 ? 3 : 2;
+		format.ilf_fields = XFS_ILOG_CORE | (forkSize > 0 ? forkField : 0);
+		format.ilf_dsize = forkSize;
+		format.ilf_ino = inode->ID();
+		int64 blockNumber;
+		int32 length;
+		int32 offset;
+		fVolume->GetInodeClusterLocation(inode->ID(), blockNumber, length,
+			offset);
+		format.ilf_blkno = blockNumber;
+		format.ilf_len = length;
+		format.ilf_boffset = offset;
+
+		uint32 coreSize = inode->CopyToLogDinode(dinode);
+
+		status = writer.AddOp(0, &format, sizeof(format));
+		if (status == B_OK)
+			status = writer.AddOp(0, dinode, coreSize);
+		if (status == B_OK && forkSize > 0)
+			status = writer.AddOp(0, inode->DataFork(), forkSize);
+	}
+
+	if (status == B_OK)
+		status = writer.AddOp(XLOG_COMMIT_TRANS, NULL, 0);
+	if (status == B_OK)
+		status = writer.Flush();
+	if (status != B_OK) {
+		ERROR("Journal::WriteTransaction(): failed: %s\n", strerror(status));
+		return status;
+	}
+
+	ioctl(fVolume->Device(), B_FLUSH_DRIVE_CACHE);
+
+	_lsn = writer.FirstLSN();
+	return B_OK;
+}
+
+
+/*!	Marks the log clean, so that the volume can be mounted without log
+	recovery.
+*/
+status_t
+Journal::WriteUnmountRecord()
+{
+	MutexLocker locker(fLock);
+
+	if (!fClean)
+		return B_READ_ONLY_DEVICE;
+
+	ioctl(fVolume->Device(), B_FLUSH_DRIVE_CACHE);
+
+	RecordWriter writer(this, _NextTransactionID(), XFS_LOG);
+	status_t status = writer.Init();
+	if (status != B_OK)
+		return status;
+
+	UnmountLogFormat format;
+	format.magic = XLOG_UNMOUNT_TYPE;
+	format.pad1 = 0;
+	format.pad2 = 0;
+
+	status = writer.AddOp(XLOG_UNMOUNT_TRANS, &format, sizeof(format));
+	if (status == B_OK)
+		status = writer.Flush();
+
+	ioctl(fVolume->Device(), B_FLUSH_DRIVE_CACHE);
+	return status;
+}
+
+
+status_t
+Journal::_ReadBlock(off_t block, uint8* buffer)
+{
+	ssize_t bytesRead = read_pos(fVolume->Device(),
+		fStart + (block << XLOG_BB_SHIFT), buffer, XLOG_BB_SIZE);
+	if (bytesRead != XLOG_BB_SIZE)
+		return bytesRead < 0 ? bytesRead : B_IO_ERROR;
+
+	return B_OK;
+}
+
+
+/*!	Returns the cycle number of the given log block. Record headers begin
+	with the magic number, followed by the cycle, while all other blocks
+	have it stamped on their first word.
+*/
+uint32
+Journal::_CycleAt(off_t block, status_t& status)
+{
+	uint32 buffer[XLOG_BB_SIZE / sizeof(uint32)];
+	status = _ReadBlock(block, (uint8*)buffer);
+	if (status != B_OK)
+		return 0;
+
+	if (B_BENDIAN_TO_HOST_INT32(buffer[0]) == XLOG_HEADER_MAGIC)
+		return B_BENDIAN_TO_HOST_INT32(buffer[1]);
+	return B_BENDIAN_TO_HOST_INT32(buffer[0]);
+}
+
+
+/*!	The log is written circularly, and every pass uses a new cycle number.
+	The head is where the cycle number drops, which is found with a binary
+	search.
+*/
+status_t
+Journal::_FindHead()
+{
+	status_t status;
+	uint32 firstCycle = _CycleAt(0, status);
+	if (status != B_OK)
+		return status;
+	uint32 lastCycle = _CycleAt(fBlockCount - 1, status);
+	if (status != B_OK)
+		return status;
+
+	if (firstCycle == lastCycle) {
+		// the last pass ended exactly at the end of the log
+		fHeadBlock = 0;
+		fCycle = firstCycle + 1;
+		if (fCycle == XLOG_HEADER_MAGIC)
+			fCycle++;
+		return B_OK;
+	}
+
+	uint32 low = 0;
+	uint32 high = fBlockCount - 1;
+	while (high - low > 1) {
+		uint32 middle = low + (high - low) / 2;
+		uint32 cycle = _CycleAt(middle, status);
+		if (status != B_OK)
+			return status;
+
+		if (cycle == firstCycle)
+			low = middle;
+		else
+			high = middle;
+	}
+
+	fHeadBlock = high;
+	fCycle = firstCycle;
+	return B_OK;
+}
+
+
+status_t
+Journal::_CheckUnmountRecord()
+{
+	fClean = false;
+
+	uint32 buffer[XLOG_BB_SIZE / sizeof(uint32)];
+	uint32 searchCount = min_c(fBlockCount, kMaxHeaderSearch);
+	for (uint32 i = 1; i <= searchCount; i++) {
+		uint32 block = (fHeadBlock + fBlockCount - i) % fBlockCount;
+		status_t status = _ReadBlock(block, (uint8*)buffer);
+		if (status != B_OK)
+			return status;
+
+		LogRecordHeader* header = (LogRecordHeader*)buffer;
+		if (B_BENDIAN_TO_HOST_INT32(header->h_magicno) != XLOG_HEADER_MAGIC)
+			continue;
+
+		uint32 expectedCycle = block < fHeadBlock ? fCycle : fCycle - 1;
+		if (B_BENDIAN_TO_HOST_INT32(header->h_cycle) != expectedCycle)
+			break;
+
+		fPreviousBlock = block;
+
+		uint32 headerBlocks = 1;
+		uint32 size = B_BENDIAN_TO_HOST_INT32(header->h_size);
+		if (B_BENDIAN_TO_HOST_INT32(header->h_version) == XLOG_VERSION_2
+			&& size > XLOG_HEADER_CYCLE_SIZE) {
+			headerBlocks = (size + XLOG_HEADER_CYCLE_SIZE - 1)
+				/ XLOG_HEADER_CYCLE_SIZE;
+		}
+		uint32 length = B_BENDIAN_TO_HOST_INT32(header->h_len);
+		uint32 end = (block + headerBlocks
+			+ (length + XLOG_BB_SIZE - 1) / XLOG_BB_SIZE) % fBlockCount;
+
+		if (end != fHeadBlock
+			|| B_BENDIAN_TO_HOST_INT32(header->h_num_logops) != 1) {
+			break;
+		}
+
+		status = _ReadBlock((block + headerBlocks) % fBlockCount,
+			(uint8*)buffer);
+		if (status != B_OK)
+			return status;
+
+		LogOpHeader* op = (LogOpHeader*)buffer;
+		fClean = (op->oh_flags & XLOG_UNMOUNT_TRANS) != 0;
+		break;
+	}
+
+	if (!fClean)
+		ERROR("Journal: the log is dirty, mount the volume on Linux first\n");
+
+	return B_OK;
+}
+
+
+/*!	Writes a log record at the head of the log. \a record points to a buffer
+	of kMaxRecordSize bytes; the record header is created in the first
+	block, and the \a length bytes of log operations follow it.
+*/
+status_t
+Journal::_WriteRecord(uint8* record, uint32 length, uint32 numOps,
+	xfs_lsn_t tailLSN)
+{
+	XfsSuperBlock& superBlock = fVolume->SuperBlock();
+	bool version2 = superBlock.HasLogV2();
+
+	uint32 total = ROUNDUP(XLOG_BB_SIZE + length, fRoundOff);
+	uint32 blocks = total >> XLOG_BB_SHIFT;
+	uint32 dataLength = total - XLOG_BB_SIZE;
+	uint8* data = record + XLOG_BB_SIZE;
+	memset(data + length, 0, dataLength - length);
+	if (version2)
+		length = dataLength;
+
+	xfs_lsn_t lsn = LSN(fCycle, fHeadBlock);
+
+	LogRecordHeader* header = (LogRecordHeader*)record;
+	memset(header, 0, XLOG_BB_SIZE);
+	header->h_magicno = B_HOST_TO_BENDIAN_INT32(XLOG_HEADER_MAGIC);
+	header->h_cycle = B_HOST_TO_BENDIAN_INT32(fCycle);
+	header->h_version = B_HOST_TO_BENDIAN_INT32(
+		version2 ? XLOG_VERSION_2 : XLOG_VERSION_1);
+	header->h_len = B_HOST_TO_BENDIAN_INT32(length);
+	header->h_lsn = B_HOST_TO_BENDIAN_INT64(lsn);
+	header->h_tail_lsn = B_HOST_TO_BENDIAN_INT64(tailLSN);
+	header->h_prev_block = B_HOST_TO_BENDIAN_INT32(fPreviousBlock);
+	header->h_num_logops = B_HOST_TO_BENDIAN_INT32(numOps);
+	header->h_fmt = B_HOST_TO_BENDIAN_INT32(XLOG_FMT_LINUX_LE);
+	memcpy(header->h_fs_uuid, superBlock.Uuid(), sizeof(uuid_t));
+	header->h_size = B_HOST_TO_BENDIAN_INT32(XLOG_HEADER_CYCLE_SIZE);
+
+	// stamp the cycle on every block, so that torn writes can be detected
+	for (uint32 i = 0; i < blocks - 1; i++) {
+		uint32* word = (uint32*)(data + i * XLOG_BB_SIZE);
+		header->h_cycle_data[i] = *word;
+		*word = B_HOST_TO_BENDIAN_INT32(fCycle);
+	}
+
+	// the part that wraps around to the start of the log is in the next
+	// cycle already
+	uint32 firstBlocks = min_c(blocks, fBlockCount - fHeadBlock);
+	uint32 nextCycle = fCycle + 1;
+	if (nextCycle == XLOG_HEADER_MAGIC)
+		nextCycle++;
+	for (uint32 i = firstBlocks; i < blocks; i++) {
+		*(uint32*)(record + i * XLOG_BB_SIZE)
+			= B_HOST_TO_BENDIAN_INT32(nextCycle);
+	}
+
+	uint32 crc = calculate_crc32c(XFS_CRC_SEED, record,
+		XLOG_RECORD_HEADER_CRC_SIZE);
+	crc = calculate_crc32c(crc, data, length);
+	header->h_crc = B_HOST_TO_LENDIAN_INT32(~crc);
+
+	ssize_t written = write_pos(fVolume->Device(),
+		fStart + ((off_t)fHeadBlock << XLOG_BB_SHIFT), record,
+		firstBlocks << XLOG_BB_SHIFT);
+	if (written == (ssize_t)(firstBlocks << XLOG_BB_SHIFT)
+		&& firstBlocks < blocks) {
+		written = write_pos(fVolume->Device(), fStart,
+			record + (firstBlocks << XLOG_BB_SHIFT),
+			(blocks - firstBlocks) << XLOG_BB_SHIFT);
+		if (written == (ssize_t)((blocks - firstBlocks) << XLOG_BB_SHIFT))
+			written = firstBlocks << XLOG_BB_SHIFT;
+	}
+	if (written != (ssize_t)(firstBlocks << XLOG_BB_SHIFT)) {
+		// we don't know what is on disk now
+		fClean = false;
+		return written < 0 ? written : B_IO_ERROR;
+	}
+
+	fPreviousBlock = fHeadBlock;
+	fHeadBlock += blocks;
+	if (fHeadBlock >= fBlockCount) {
+		fHeadBlock -= fBlockCount;
+		fCycle = nextCycle;
+	}
+	fWritten = true;
+	return B_OK;
+}
+
+
+uint32
+Journal::_NextTransactionID()
+{
+	if (++fTransactionID == 0)
+		fTransactionID++;
+	return fTransactionID;
+}
+
+
+//	#pragma mark - TransactionListener
+
+
+TransactionListener::~TransactionListener()
+{
+}
+
+
+//	#pragma mark - Transaction
+
+
+Transaction::Transaction(Volume* volume)
+	:
+	fVolume(volume),
+	fJournal(volume->GetJournal()),
+	fInodes(NULL),
+	fInodeCount(0),
+	fInodeCapacity(0),
+	fFreeBlocksDelta(0),
+	fInodesDelta(0),
+	fFreeInodesDelta(0),
+	fStarted(false)
+{
+}
+
+
+Transaction::~Transaction()
+{
+	if (fStarted) {
+		// the changes are discarded
+		_NotifyListeners(false);
+		_Reset();
+		fJournal->Unlock(this);
+	}
+	free(fInodes);
+}
+
+
+status_t
+Transaction::Start()
+{
+	if (fJournal == NULL || fVolume->IsReadOnly())
+		return B_READ_ONLY_DEVICE;
+
+	status_t status = fJournal->Lock(this);
+	if (status != B_OK)
+		return status;
+
+	fStarted = true;
+	return B_OK;
+}
+
+
+status_t
+Transaction::Commit()
+{
+	if (!fStarted)
+		return B_BAD_VALUE;
+
+	bool hasChanges = fInodeCount > 0;
+	TransactionBufferList::Iterator iterator = fBuffers.GetIterator();
+	while (TransactionBuffer* buffer = iterator.Next())
+		hasChanges |= buffer->dirty;
+
+	status_t status = B_OK;
+	if (hasChanges) {
+		xfs_lsn_t lsn;
+		status = fJournal->WriteTransaction(this, lsn);
+		if (status == B_OK) {
+			fVolume->AdjustCounters(fFreeBlocksDelta, fInodesDelta,
+				fFreeInodesDelta);
+			status = _WriteBuffers(lsn);
+		}
+	}
+
+	_NotifyListeners(status == B_OK);
+	_Reset();
+	fStarted = false;
+	fJournal->Unlock(this);
+	return status;
+}
+
+
+/*!	Returns the metadata block at the given device offset. It is read from
+	disk on first access; later calls within the same transaction return the
+	same, possibly modified, buffer.
+*/
+status_t
+Transaction::GetBuffer(off_t offset, uint32 size, uint16 type,
+	int32 crcOffset, int32 lsnOffset, TransactionBuffer*& _buffer)
+{
+	ASSERT(fStarted);
+
+	TransactionBufferList::Iterator iterator = fBuffers.GetIterator();
+	while (TransactionBuffer* buffer = iterator.Next()) {
+		if (buffer->offset == offset) {
+			if (buffer->size != size)
+				return B_BAD_VALUE;
+			_buffer = buffer;
+			return B_OK;
+		}
+	}
+
+	TransactionBuffer* buffer = new(std::nothrow) TransactionBuffer;
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+
+	buffer->data = (uint8*)malloc(size);
+	if (buffer->data == NULL) {
+		delete buffer;
+		return B_NO_MEMORY;
+	}
+
+	if (read_pos(fVolume->Device(), offset, buffer->data, size)
+			!= (ssize_t)size) {
+		free(buffer->data);
+		delete buffer;
+		return B_IO_ERROR;
+	}
+
+	buffer->offset = offset;
+	buffer->size = size;
+	buffer->type = type;
+	buffer->flags = 0;
+	buffer->crcOffset = crcOffset;
+	buffer->lsnOffset = lsnOffset;
+	memset(buffer->dirtyMap, 0, sizeof(buffer->dirtyMap));
+	buffer->dirty = false;
+	buffer->verified = false;
+
+	fBuffers.Add(buffer);
+	_buffer = buffer;
+	return B_OK;
+}
+
+
+void
+Transaction::MarkDirty(TransactionBuffer* buffer, uint32 offset,
+	uint32 length)
+{
+	if (length == 0)
+		return;
+
+	uint32 first = offset >> XFS_BLF_SHIFT;
+	uint32 last = (offset + length - 1) >> XFS_BLF_SHIFT;
+	for (uint32 chunk = first; chunk <= last; chunk++)
+		buffer->dirtyMap[chunk / 32] |= 1UL << (chunk % 32);
+
+	buffer->dirty = true;
+}
+
+
+/*!	Adds the inode to the transaction; its core and data fork are logged
+	as they are when the transaction is committed.
+*/
+status_t
+Transaction::AddInode(Inode* inode)
+{
+	ASSERT(fStarted);
+
+	for (int32 i = 0; i < fInodeCount; i++) {
+		if (fInodes[i] == inode)
+			return B_OK;
+	}
+
+	if (fInodeCount == fInodeCapacity) {
+		int32 capacity = max_c(4, fInodeCapacity * 2);
+		Inode** inodes = (Inode**)realloc(fInodes, capacity * sizeof(Inode*));
+		if (inodes == NULL)
+			return B_NO_MEMORY;
+
+		fInodes = inodes;
+		fInodeCapacity = capacity;
+	}
+
+	fInodes[fInodeCount++] = inode;
+	return B_OK;
+}
+
+
+/*!	Records a change of the superblock counters, which only takes effect
+	if the transaction is committed.
+*/
+void
+Transaction::AdjustCounters(int64 freeBlocks, int64 inodes, int64 freeInodes)
+{
+	fFreeBlocksDelta += freeBlocks;
+	fInodesDelta += inodes;
+	fFreeInodesDelta += freeInodes;
+}
+
+
+/*!	The listener is notified when the transaction is committed or
+	discarded. Adding it more than once has no effect.
+*/
+void
+Transaction::AddListener(TransactionListener* listener)
+{
+	ASSERT(fStarted);
+
+	TransactionListenerList::Iterator iterator = fListeners.GetIterator();
+	while (TransactionListener* other = iterator.Next()) {
+		if (other == listener)
+			return;
+	}
+
+	fListeners.Add(listener);
+}
+
+
+void
+Transaction::_NotifyListeners(bool success)
+{
+	while (TransactionListener* listener = fListeners.RemoveHead())
+		listener->TransactionDone(success);
+}
+
+
+void
+Transaction::_Reset()
+{
+	while (TransactionBuffer* buffer = fBuffers.RemoveHead()) {
+		free(buffer->data);
+		delete buffer;
+	}
+
+	fInodeCount = 0;
+	fFreeBlocksDelta = 0;
+	fInodesDelta = 0;
+	fFreeInodesDelta = 0;
+}
+
+
+/*!	Writes the changed blocks and inodes in place, stamped with the LSN of
+	the transaction, so that log recovery can tell they are up to date.
+*/
+status_t
+Transaction::_WriteBuffers(xfs_lsn_t lsn)
+{
+	TransactionBufferList::Iterator iterator = fBuffers.GetIterator();
+	while (TransactionBuffer* buffer = iterator.Next()) {
+		if (!buffer->dirty)
+			continue;
+
+		if (buffer->lsnOffset >= 0) {
+			*(uint64*)(buffer->data + buffer->lsnOffset)
+				= B_HOST_TO_BENDIAN_INT64(lsn);
+		}
+		if (buffer->crcOffset >= 0) {
+			xfs_update_cksum((const char*)buffer->data, buffer->size,
+				buffer->crcOffset);
+		}
+
+		if (write_pos(fVolume->Device(), buffer->offset, buffer->data,
+				buffer->size) != (ssize_t)buffer->size) {
+			ERROR("Transaction: could not write block at %" B_PRIdOFF "\n",
+				buffer->offset);
+			return B_IO_ERROR;
+		}
+	}
+
+	for (int32 i = 0; i < fInodeCount; i++) {
+		status_t status = fInodes[i]->WriteToDisk(lsn);
+		if (status != B_OK)
+			return status;
+	}
+
+	return B_OK;
+}
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _XFS_JOURNAL_H_
+#define _XFS_JOURNAL_H_
+
+
+#include "xfs.h"
+
+
+class Inode;
+class Transaction;
+class Volume;
+
+
+/*
+	Log record and log item formats, see chapter 14 "Journaling Log" of the
+	XFS Algorithms & Data Structures documentation.
+	The record header is big-endian, the log items are in host order.
+*/
+#define XLOG_HEADER_MAGIC		0xfeedbabe
+#define XLOG_VERSION_1			1
+#define XLOG_VERSION_2			2
+#define XLOG_FMT_LINUX_LE		1
+#define XLOG_HEADER_CYCLE_SIZE	(32 * 1024)
+#define XLOG_BB_SIZE			512
+#define XLOG_BB_SHIFT			9
+
+#define XLOG_START_TRANS		0x01
+#define XLOG_COMMIT_TRANS		0x02
+#define XLOG_UNMOUNT_TRANS		0x20
+
+#define XFS_TRANSACTION			0x69
+#define XFS_LOG					0xaa
+
+#define XFS_TRANS_HEADER_MAGIC	0x5452414e
+#define XFS_TRANS_CHECKPOINT	40
+#define XLOG_UNMOUNT_TYPE		0x556e
+
+#define XFS_LI_INODE			0x123b
+#define XFS_LI_BUF				0x123c
+
+#define XFS_ILOG_CORE			0x001
+#define XFS_ILOG_DDATA			0x002
+#define XFS_ILOG_DEXT			0x004
+
+#define XFS_BLF_CHUNK			128
+#define XFS_BLF_SHIFT			7
+#define XFS_BLF_DATAMAP_SIZE	(XFS_MAX_BLOCKSIZE / XFS_BLF_CHUNK / 32)
+#define XFS_BLFT_SHIFT			11
+
+#define XFS_BLF_INODE_BUF		0x1
+	// only the di_next_unlinked fields of the inodes are replayed
+
+// buffer types, these tell log recovery which verifier to use
+#define XFS_BLFT_BTREE_BUF		4
+#define XFS_BLFT_AGF_BUF		5
+#define XFS_BLFT_AGFL_BUF		6
+#define XFS_BLFT_AGI_BUF		7
+#define XFS_BLFT_DINO_BUF		8
+#define XFS_BLFT_DIR_BLOCK_BUF	10
+#define XFS_BLFT_SB_BUF			18
+
+#define LSN(cycle, block)		(((xfs_lsn_t)(cycle) << 32) | (block))
+
+
+struct LogRecordHeader {
+			uint32				h_magicno;
+			uint32				h_cycle;
+			uint32				h_version;
+			uint32				h_len;
+			xfs_lsn_t			h_lsn;
+			xfs_lsn_t			h_tail_lsn;
+			uint32				h_crc;
+				// little-endian
+			uint32				h_prev_block;
+			uint32				h_num_logops;
+			uint32				h_cycle_data[XLOG_HEADER_CYCLE_SIZE
+									/ XLOG_BB_SIZE];
+			uint32				h_fmt;
+			uuid_t				h_fs_uuid;
+			uint32				h_size;
+} _PACKED;
+
+#define XLOG_RECORD_HEADER_CRC_SIZE	328
+	// the size Linux checksums on 64 bit architectures, including the
+	// padding at the end of the structure
+
+
+struct LogOpHeader {
+			uint32				oh_tid;
+			uint32				oh_len;
+			uint8				oh_clientid;
+			uint8				oh_flags;
+			uint16				oh_res2;
+} _PACKED;
+
+
+struct TransactionHeader {
+			uint32				th_magic;
+			uint32				th_type;
+			int32				th_tid;
+			uint32				th_num_items;
+} _PACKED;
+
+
+struct BufferLogFormat {
+			uint16				blf_type;
+			uint16				blf_size;
+				// number of regions, including this one
+			uint16				blf_flags;
+			uint16				blf_len;
+				// in basic blocks
+			int64				blf_blkno;
+			uint32				blf_map_size;
+			uint32				blf_data_map[XFS_BLF_DATAMAP_SIZE];
+} _PACKED;
+
+#define BUFFER_LOG_FORMAT_SIZE(mapSize) \
+	(offsetof(BufferLogFormat, blf_data_map) + (mapSize) * sizeof(uint32))
+
+
+struct InodeLogFormat {
+			uint16				ilf_type;
+			uint16				ilf_size;
+			uint32				ilf_fields;
+			uint16				ilf_asize;
+			uint16				ilf_dsize;
+			uint32				ilf_pad;
+			uint64				ilf_ino;
+			uint8				ilf_u[16];
+			int64				ilf_blkno;
+			int32				ilf_len;
+			int32				ilf_boffset;
+} _PACKED;
+
+
+struct UnmountLogFormat {
+			uint16				magic;
+			uint16				pad1;
+			uint32				pad2;
+} _PACKED;
+
+
+/*!	A metadata block that is read and possibly modified within a
+	transaction. The \c dirtyMap has one bit for every XFS_BLF_CHUNK bytes
+	of the buffer, just like the buffer log item that will describe it.
+*/
+struct TransactionBuffer : DoublyLinkedListLinkImpl<TransactionBuffer> {
+			off_t				offset;
+			uint32				size;
+			uint16				type;
+			uint16				flags;
+				// XFS_BLF_* flags of the buffer log item
+			int32				crcOffset;
+				// -1, if the block has no checksum
+			int32				lsnOffset;
+			uint8*				data;
+			uint32				dirtyMap[XFS_BLF_DATAMAP_SIZE];
+			bool				dirty;
+			bool				verified;
+				// for the owner to keep track of
+};
+
+typedef DoublyLinkedList<TransactionBuffer> TransactionBufferList;
+
+
+/*!	Is notified once the transaction it was added to is done, so that
+	in-memory state that was changed along with the transaction can be
+	reverted if it was not committed.
+*/
+class TransactionListener
+	: public DoublyLinkedListLinkImpl<TransactionListener> {
+public:
+	virtual						~TransactionListener();
+
+	virtual	void				TransactionDone(bool success) = 0;
+};
+
+typedef DoublyLinkedList<TransactionListener> TransactionListenerList;
+
+
+class Journal {
+public:
+								Journal(Volume* volume);
+								~Journal();
+
+			status_t			Init();
+			bool				IsClean() const { return fClean; }
+			bool				HasWritten() const { return fWritten; }
+
+			status_t			Lock(Transaction* owner);
+			void				Unlock(Transaction* owner);
+
+			status_t			WriteTransaction(Transaction* transaction,
+									xfs_lsn_t& _lsn);
+			status_t			WriteUnmountRecord();
+
+private:
+			struct RecordWriter;
+
+			uint32				_CycleAt(off_t block, status_t& status);
+			status_t			_ReadBlock(off_t block, uint8* buffer);
+			status_t			_FindHead();
+			status_t			_CheckUnmountRecord();
+			status_t			_WriteRecord(uint8* record,
+									uint32 length, uint32 numOps,
+									xfs_lsn_t tailLSN);
+
+			uint32				_NextTransactionID();
+
+private:
+			Volume*				fVolume;
+			mutex				fLock;
+			Transaction*		fOwner;
+			off_t				fStart;
+				// offset of the log on the device
+			uint32				fBlockCount;
+				// size of the log in basic blocks
+			uint32				fRoundOff;
+			uint32				fHeadBlock;
+			uint32				fCycle;
+			uint32				fPreviousBlock;
+			uint32				fTransactionID;
+			bool				fClean;
+			bool				fWritten;
+};
+
+
+/*!	A set of metadata changes that is written to the log as one
+	checkpoint. The journal is locked between Start() and Commit() (or the
+	destruction of an uncommitted transaction, which discards all changes).
+	After the log record has reached the disk, Commit() writes the changed
+	blocks and inodes to their final location.
+*/
+class Transaction {
+public:
+								Transaction(Volume* volume);
+								~Transaction();
+
+			status_t			Start();
+			status_t			Commit();
+			bool				IsStarted() const { return fStarted; }
+
+			Volume*				GetVolume() const { return fVolume; }
+
+			status_t			GetBuffer(off_t offset, uint32 size,
+									uint16 type, int32 crcOffset,
+									int32 lsnOffset,
+									TransactionBuffer*& _buffer);
+			void				MarkDirty(TransactionBuffer* buffer,
+									uint32 offset, uint32 length);
+
+			status_t			AddInode(Inode* inode);
+			void				AdjustCounters(int64 freeBlocks,
+									int64 inodes = 0, int64 freeInodes = 0);
+			void				AddListener(TransactionListener* listener);
+
+private:
+	friend class Journal;
+
+			void				_Reset();
+			void				_NotifyListeners(bool success);
+			status_t			_WriteBuffers(xfs_lsn_t lsn);
+
+private:
+			Volume*				fVolume;
+			Journal*			fJournal;
+			TransactionBufferList fBuffers;
+			TransactionListenerList fListeners;
+			Inode**				fInodes;
+			int32				fInodeCount;
+			int32				fInodeCapacity;
+			int64				fFreeBlocksDelta;
+			int64				fInodesDelta;
+			int64				fFreeInodesDelta;
+				// applied to the volume once committed
+			bool				fStarted;
+};
+
+
+#endif	// _XFS_JOURNAL_H_
@@ -430,8 +430,8 @@ NodeDirectory::Lookup(const char* name, size_t length, xfs_ino_t* ino)
 			TRACE("offset:(%" B_PRIu32 ")\n", offset);
 			ExtentDataEntry* entry = (ExtentDataEntry*)(fDataBuffer + offset);
 
-			int retVal = strncmp(name, (char*)entry->name, entry->namelen);
-			if (retVal == 0) {
+			if (entry->namelen == length
+				&& memcmp(name, entry->name, length) == 0) {
 				*ino = B_BENDIAN_TO_HOST_INT64(entry->inumber);
 				TRACE("ino:(%" B_PRIu64 ")\n", *ino);
 				return B_OK;
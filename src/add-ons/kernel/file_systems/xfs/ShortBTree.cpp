@@ -0,0 +1,657 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "ShortBTree.h"
+
+#include "Checksum.h"
+#include "Journal.h"
+#include "Volume.h"
+
+
+ShortBTree::ShortBTree(Transaction& transaction, xfs_agnumber_t group,
+	uint32 magic, uint32 recordSize, uint32 keySize)
+	:
+	fTransaction(transaction),
+	fVolume(transaction.GetVolume()),
+	fGroup(group),
+	fMagic(magic),
+	fRecordSize(recordSize),
+	fKeySize(keySize),
+	fLevels(0)
+{
+	fHeaderSize = fVolume->IsVersion5()
+		? XFS_BTREE_SBLOCK_CRC_SIZE : XFS_BTREE_SBLOCK_SIZE;
+
+	// leaves hold records, nodes hold keys and pointers
+	fLeafMax = (fVolume->BlockSize() - fHeaderSize) / fRecordSize;
+	fNodeMax = (fVolume->BlockSize() - fHeaderSize) / (fKeySize + 4);
+}
+
+
+ShortBTree::~ShortBTree()
+{
+}
+
+
+/*!	Positions the cursor on the last record whose key is less or equal than
+	\a key, on the first one that is greater or equal than it, or on the
+	one that is equal to it, depending on \a mode.
+*/
+status_t
+ShortBTree::Lookup(const uint8* key, lookup_mode mode, bool& _found)
+{
+	fLevels = _Levels();
+	xfs_agblock_t block = _Root();
+	_found = false;
+
+	for (int level = fLevels - 1; level >= 0; level--) {
+		status_t status = _ReadBlock(level, block, fBuffers[level]);
+		if (status != B_OK)
+			return status;
+		fBlocks[level] = block;
+
+		int32 index = _Search(fBuffers[level], level, key);
+		if (level > 0) {
+			if (_Count(fBuffers[level]) == 0)
+				return B_BAD_DATA;
+			if (index < 0)
+				index = 0;
+			block = _Pointer(fBuffers[level], index);
+		}
+		fIndex[level] = index;
+	}
+
+	int32 index = fIndex[0];
+	bool equal = index >= 0 && _CompareKeys(Record(), key) == 0;
+
+	switch (mode) {
+		case LOOKUP_LE:
+			_found = index >= 0;
+			break;
+		case LOOKUP_EQ:
+			_found = equal;
+			break;
+		case LOOKUP_GE:
+			if (equal) {
+				_found = true;
+				break;
+			}
+			return Next(_found);
+	}
+
+	return B_OK;
+}
+
+
+/*!	Moves the cursor to the next record, which may be in the next leaf. */
+status_t
+ShortBTree::Next(bool& _found)
+{
+	_found = false;
+
+	if (++fIndex[0] < _Count(fBuffers[0])) {
+		_found = true;
+		return B_OK;
+	}
+
+	int level = 1;
+	while (level < fLevels && fIndex[level] + 1 >= _Count(fBuffers[level]))
+		level++;
+	if (level == fLevels)
+		return B_OK;
+
+	fIndex[level]++;
+	for (; level > 0; level--) {
+		xfs_agblock_t block = _Pointer(fBuffers[level], fIndex[level]);
+		status_t status = _ReadBlock(level - 1, block, fBuffers[level - 1]);
+		if (status != B_OK)
+			return status;
+		fBlocks[level - 1] = block;
+		fIndex[level - 1] = 0;
+	}
+
+	_found = _Count(fBuffers[0]) > 0;
+	return B_OK;
+}
+
+
+/*!	Positions the cursor on the last record of the tree. */
+status_t
+ShortBTree::Last(bool& _found)
+{
+	fLevels = _Levels();
+	xfs_agblock_t block = _Root();
+
+	for (int level = fLevels - 1; level >= 0; level--) {
+		status_t status = _ReadBlock(level, block, fBuffers[level]);
+		if (status != B_OK)
+			return status;
+		fBlocks[level] = block;
+		fIndex[level] = (int32)_Count(fBuffers[level]) - 1;
+
+		if (level > 0) {
+			if (fIndex[level] < 0)
+				return B_BAD_DATA;
+			block = _Pointer(fBuffers[level], fIndex[level]);
+		}
+	}
+
+	_found = fIndex[0] >= 0;
+	return B_OK;
+}
+
+
+const uint8*
+ShortBTree::Record() const
+{
+	return _Key(fBuffers[0], 0, fIndex[0]);
+}
+
+
+/*!	Replaces the record at the cursor position; its key must not change
+	its position in the tree.
+*/
+status_t
+ShortBTree::Update(const uint8* record)
+{
+	_SetEntry(fBuffers[0], 0, fIndex[0], record, 0);
+	if (fIndex[0] == 0)
+		return _UpdateParentKeys(0);
+	return B_OK;
+}
+
+
+/*!	Inserts the record after the cursor position, which must have been
+	determined by a LOOKUP_LE lookup of the record.
+*/
+status_t
+ShortBTree::Insert(const uint8* record)
+{
+	return _InsertAt(0, fIndex[0] + 1, record, 0);
+}
+
+
+status_t
+ShortBTree::Delete()
+{
+	return _DeleteAt(0, fIndex[0]);
+}
+
+
+status_t
+ShortBTree::_GetBlock(xfs_agblock_t block, TransactionBuffer*& _buffer)
+{
+	if (block >= fVolume->AgBlocks())
+		return B_BAD_DATA;
+
+	bool version5 = fVolume->IsVersion5();
+	off_t offset = ((off_t)fGroup * fVolume->AgBlocks() + block)
+		<< fVolume->BlockLog();
+	return fTransaction.GetBuffer(offset, fVolume->BlockSize(),
+		XFS_BLFT_BTREE_BUF, version5 ? XFS_BTREE_SBLOCK_CRC : -1,
+		version5 ? XFS_BTREE_SBLOCK_LSN : -1, _buffer);
+}
+
+
+status_t
+ShortBTree::_ReadBlock(int level, xfs_agblock_t block,
+	TransactionBuffer*& _buffer)
+{
+	status_t status = _GetBlock(block, _buffer);
+	if (status != B_OK)
+		return status;
+
+	uint8* data = _buffer->data;
+	if (read32(data, 0) != fMagic || read16(data, 4) != level
+		|| read16(data, 6) > _MaxRecords(level)) {
+		ERROR("ShortBTree: bad block %" B_PRIu32 " in group %" B_PRIu32 "\n",
+			block, fGroup);
+		return B_BAD_DATA;
+	}
+
+	if (_buffer->verified)
+		return B_OK;
+
+	if (fVolume->IsVersion5()) {
+		uint64 blockNumber = B_BENDIAN_TO_HOST_INT64(
+			*(uint64*)(data + XFS_BTREE_SBLOCK_BLKNO));
+		if (blockNumber != (uint64)(_buffer->offset >> XLOG_BB_SHIFT)
+			|| read32(data, XFS_BTREE_SBLOCK_OWNER) != fGroup
+			|| !fVolume->UuidEquals(*(uuid_t*)(data + XFS_BTREE_SBLOCK_UUID))
+			|| !xfs_verify_cksum((const char*)data, _buffer->size,
+				XFS_BTREE_SBLOCK_CRC)) {
+			ERROR("ShortBTree: block %" B_PRIu32 " in group %" B_PRIu32
+				" is corrupted\n", block, fGroup);
+			return B_BAD_DATA;
+		}
+	}
+
+	_buffer->verified = true;
+	return B_OK;
+}
+
+
+status_t
+ShortBTree::_InitBlock(int level, xfs_agblock_t block,
+	TransactionBuffer*& _buffer)
+{
+	status_t status = _GetBlock(block, _buffer);
+	if (status != B_OK)
+		return status;
+
+	uint8* data = _buffer->data;
+	memset(data, 0, _buffer->size);
+	write32(data, 0, fMagic);
+	write16(data, 4, level);
+	write16(data, 6, 0);
+	write32(data, 8, NULLAGBLOCK);
+	write32(data, 12, NULLAGBLOCK);
+
+	if (fVolume->IsVersion5()) {
+		*(uint64*)(data + XFS_BTREE_SBLOCK_BLKNO)
+			= B_HOST_TO_BENDIAN_INT64(_buffer->offset >> XLOG_BB_SHIFT);
+		memcpy(data + XFS_BTREE_SBLOCK_UUID, fVolume->SuperBlock().MetaUuid(),
+			sizeof(uuid_t));
+		write32(data, XFS_BTREE_SBLOCK_OWNER, fGroup);
+	}
+
+	_buffer->verified = true;
+	fTransaction.MarkDirty(_buffer, 0, _buffer->size);
+	return B_OK;
+}
+
+
+/*!	Returns the index of the last entry whose key is less or equal than
+	\a key, or -1 if there is none.
+*/
+int32
+ShortBTree::_Search(TransactionBuffer* buffer, int level,
+	const uint8* key) const
+{
+	int32 low = 0;
+	int32 high = (int32)_Count(buffer) - 1;
+	while (low <= high) {
+		int32 middle = (low + high) / 2;
+		if (_CompareKeys(_Key(buffer, level, middle), key) <= 0)
+			low = middle + 1;
+		else
+			high = middle - 1;
+	}
+
+	return high;
+}
+
+
+uint16
+ShortBTree::_Count(TransactionBuffer* buffer) const
+{
+	return read16(buffer->data, 6);
+}
+
+
+void
+ShortBTree::_SetCount(TransactionBuffer* buffer, uint16 count)
+{
+	write16(buffer->data, 6, count);
+	fTransaction.MarkDirty(buffer, 6, 2);
+}
+
+
+xfs_agblock_t
+ShortBTree::_Left(TransactionBuffer* buffer) const
+{
+	return read32(buffer->data, 8);
+}
+
+
+xfs_agblock_t
+ShortBTree::_Right(TransactionBuffer* buffer) const
+{
+	return read32(buffer->data, 12);
+}
+
+
+void
+ShortBTree::_SetSibling(TransactionBuffer* buffer, bool right,
+	xfs_agblock_t block)
+{
+	uint32 offset = right ? 12 : 8;
+	write32(buffer->data, offset, block);
+	fTransaction.MarkDirty(buffer, offset, 4);
+}
+
+
+/*!	Sets the left or right sibling pointer of \a block, if there is one. */
+status_t
+ShortBTree::_SetSiblingOf(int level, xfs_agblock_t block, bool right,
+	xfs_agblock_t sibling)
+{
+	if (block == NULLAGBLOCK)
+		return B_OK;
+
+	TransactionBuffer* buffer;
+	status_t status = _ReadBlock(level, block, buffer);
+	if (status != B_OK)
+		return status;
+
+	_SetSibling(buffer, right, sibling);
+	return B_OK;
+}
+
+
+/*!	Returns the key of a node entry, or the record of a leaf entry, which
+	starts with its key.
+*/
+const uint8*
+ShortBTree::_Key(TransactionBuffer* buffer, int level, uint32 index) const
+{
+	return buffer->data + fHeaderSize + index * _EntrySize(level);
+}
+
+
+xfs_agblock_t
+ShortBTree::_Pointer(TransactionBuffer* buffer, uint32 index) const
+{
+	return read32(buffer->data, fHeaderSize + fNodeMax * fKeySize + index * 4);
+}
+
+
+void
+ShortBTree::_SetEntry(TransactionBuffer* buffer, int level, uint32 index,
+	const uint8* entry, xfs_agblock_t pointer)
+{
+	uint32 size = _EntrySize(level);
+	uint32 offset = fHeaderSize + index * size;
+	memmove(buffer->data + offset, entry, size);
+	fTransaction.MarkDirty(buffer, offset, size);
+
+	if (level > 0) {
+		offset = fHeaderSize + fNodeMax * fKeySize + index * 4;
+		write32(buffer->data, offset, pointer);
+		fTransaction.MarkDirty(buffer, offset, 4);
+	}
+}
+
+
+/*!	Moves \a count entries within a block from index \a from to \a to. */
+void
+ShortBTree::_MoveEntries(TransactionBuffer* buffer, int level, uint32 from,
+	uint32 to, uint32 count)
+{
+	if (count == 0)
+		return;
+
+	uint32 size = _EntrySize(level);
+	uint8* entries = buffer->data + fHeaderSize;
+	memmove(entries + to * size, entries + from * size, count * size);
+	fTransaction.MarkDirty(buffer, fHeaderSize + to * size, count * size);
+
+	if (level > 0) {
+		uint32 pointerOffset = fHeaderSize + fNodeMax * fKeySize;
+		uint8* pointers = buffer->data + pointerOffset;
+		memmove(pointers + to * 4, pointers + from * 4, count * 4);
+		fTransaction.MarkDirty(buffer, pointerOffset + to * 4, count * 4);
+	}
+}
+
+
+/*!	The key of a node entry is the first key of the block it points to;
+	propagates a change of the first key of the block at \a level upwards.
+*/
+status_t
+ShortBTree::_UpdateParentKeys(int level)
+{
+	if (_Count(fBuffers[level]) == 0)
+		return B_OK;
+
+	const uint8* key = _Key(fBuffers[level], level, 0);
+	for (int parent = level + 1; parent < fLevels; parent++) {
+		_SetEntry(fBuffers[parent], parent, fIndex[parent], key,
+			fBlocks[parent - 1]);
+		if (fIndex[parent] != 0)
+			break;
+	}
+
+	return B_OK;
+}
+
+
+status_t
+ShortBTree::_InsertAt(int level, uint32 index, const uint8* entry,
+	xfs_agblock_t pointer)
+{
+	TransactionBuffer* buffer = fBuffers[level];
+	uint32 count = _Count(buffer);
+
+	if (count < _MaxRecords(level)) {
+		_MoveEntries(buffer, level, index, index + 1, count - index);
+		_SetEntry(buffer, level, index, entry, pointer);
+		_SetCount(buffer, count + 1);
+
+		if (index == 0)
+			return _UpdateParentKeys(level);
+		return B_OK;
+	}
+
+	// The block is full, split it in two halves, and insert the new
+	// right half into the parent
+
+	if (level == fLevels - 1 && fLevels == XFS_BTREE_MAX_LEVELS)
+		return B_BAD_DATA;
+
+	xfs_agblock_t rightBlock;
+	status_t status = _AllocateBlock(rightBlock);
+	if (status != B_OK)
+		return status;
+
+	TransactionBuffer* right;
+	status = _InitBlock(level, rightBlock, right);
+	if (status != B_OK)
+		return status;
+
+	uint32 leftCount = (count + 1) / 2;
+	uint32 rightCount = count + 1 - leftCount;
+
+	if (index < leftCount) {
+		// the new entry goes into the left block, its last entries are
+		// moved to the right one
+		uint32 moved = count - (leftCount - 1);
+		for (uint32 i = 0; i < moved; i++) {
+			uint32 from = leftCount - 1 + i;
+			_SetEntry(right, level, i, _Key(buffer, level, from),
+				level > 0 ? _Pointer(buffer, from) : 0);
+		}
+		_MoveEntries(buffer, level, index, index + 1, leftCount - 1 - index);
+		_SetEntry(buffer, level, index, entry, pointer);
+	} else {
+		// the new entry goes into the right block
+		for (uint32 i = 0, from = leftCount; i < rightCount; i++) {
+			if (i == index - leftCount) {
+				_SetEntry(right, level, i, entry, pointer);
+				continue;
+			}
+			_SetEntry(right, level, i, _Key(buffer, level, from),
+				level > 0 ? _Pointer(buffer, from) : 0);
+			from++;
+		}
+	}
+	_SetCount(buffer, leftCount);
+	_SetCount(right, rightCount);
+
+	// link the new block in
+	xfs_agblock_t oldRight = _Right(buffer);
+	_SetSibling(right, false, fBlocks[level]);
+	_SetSibling(right, true, oldRight);
+	_SetSibling(buffer, true, rightBlock);
+	status = _SetSiblingOf(level, oldRight, false, rightBlock);
+	if (status != B_OK)
+		return status;
+
+	uint8 rightKey[XFS_BTREE_MAX_KEY_SIZE];
+	memcpy(rightKey, _Key(right, level, 0), fKeySize);
+
+	if (level == fLevels - 1) {
+		// the root was split, add a new one on top
+		xfs_agblock_t rootBlock;
+		status = _AllocateBlock(rootBlock);
+		if (status != B_OK)
+			return status;
+
+		TransactionBuffer* root;
+		status = _InitBlock(level + 1, rootBlock, root);
+		if (status != B_OK)
+			return status;
+
+		_SetEntry(root, level + 1, 0, _Key(buffer, level, 0), fBlocks[level]);
+		_SetEntry(root, level + 1, 1, rightKey, rightBlock);
+		_SetCount(root, 2);
+
+		_SetRoot(rootBlock, fLevels + 1);
+		fLevels++;
+		return B_OK;
+	}
+
+	if (index == 0) {
+		status = _UpdateParentKeys(level);
+		if (status != B_OK)
+			return status;
+	}
+
+	return _InsertAt(level + 1, fIndex[level + 1] + 1, rightKey, rightBlock);
+}
+
+
+status_t
+ShortBTree::_DeleteAt(int level, uint32 index)
+{
+	TransactionBuffer* buffer = fBuffers[level];
+	uint32 count = _Count(buffer) - 1;
+
+	_MoveEntries(buffer, level, index + 1, index, count - index);
+	_SetCount(buffer, count);
+
+	if (level == fLevels - 1) {
+		if (level > 0 && count == 1 && _CanFreeBlock()) {
+			// the root has only one child left, which becomes the new root
+			_SetRoot(_Pointer(buffer, 0), fLevels - 1);
+			fLevels--;
+			return _FreeBlock(fBlocks[level]);
+		}
+		return B_OK;
+	}
+
+	status_t status;
+	if (index == 0 && count > 0) {
+		status = _UpdateParentKeys(level);
+		if (status != B_OK)
+			return status;
+	}
+
+	if (count >= _MinRecords(level))
+		return B_OK;
+
+	// The block is underfull now, take an entry from one of its siblings,
+	// or merge it with one of them
+
+	TransactionBuffer* parent = fBuffers[level + 1];
+	uint32 parentIndex = fIndex[level + 1];
+	uint32 parentCount = _Count(parent);
+
+	TransactionBuffer* right = NULL;
+	xfs_agblock_t rightBlock = NULLAGBLOCK;
+	if (parentIndex + 1 < parentCount) {
+		rightBlock = _Pointer(parent, parentIndex + 1);
+		status = _ReadBlock(level, rightBlock, right);
+		if (status != B_OK)
+			return status;
+
+		uint32 rightCount = _Count(right);
+		if (rightCount > _MinRecords(level)) {
+			_SetEntry(buffer, level, count, _Key(right, level, 0),
+				level > 0 ? _Pointer(right, 0) : 0);
+			_SetCount(buffer, count + 1);
+			_MoveEntries(right, level, 1, 0, rightCount - 1);
+			_SetCount(right, rightCount - 1);
+
+			_SetEntry(parent, level + 1, parentIndex + 1,
+				_Key(right, level, 0), rightBlock);
+			if (count == 0)
+				return _UpdateParentKeys(level);
+			return B_OK;
+		}
+	}
+
+	TransactionBuffer* left = NULL;
+	xfs_agblock_t leftBlock = NULLAGBLOCK;
+	if (parentIndex > 0) {
+		leftBlock = _Pointer(parent, parentIndex - 1);
+		status = _ReadBlock(level, leftBlock, left);
+		if (status != B_OK)
+			return status;
+
+		uint32 leftCount = _Count(left);
+		if (leftCount > _MinRecords(level)) {
+			_MoveEntries(buffer, level, 0, 1, count);
+			_SetEntry(buffer, level, 0, _Key(left, level, leftCount - 1),
+				level > 0 ? _Pointer(left, leftCount - 1) : 0);
+			_SetCount(buffer, count + 1);
+			_SetCount(left, leftCount - 1);
+			return _UpdateParentKeys(level);
+		}
+	}
+
+	if (!_CanFreeBlock()) {
+		// leave it underfull, this is still a valid tree
+		return B_OK;
+	}
+
+	if (right != NULL) {
+		// merge the right sibling into this block
+		uint32 rightCount = _Count(right);
+		for (uint32 i = 0; i < rightCount; i++) {
+			_SetEntry(buffer, level, count + i, _Key(right, level, i),
+				level > 0 ? _Pointer(right, i) : 0);
+		}
+		_SetCount(buffer, count + rightCount);
+		if (count == 0) {
+			status = _UpdateParentKeys(level);
+			if (status != B_OK)
+				return status;
+		}
+
+		xfs_agblock_t next = _Right(right);
+		_SetSibling(buffer, true, next);
+		status = _SetSiblingOf(level, next, false, fBlocks[level]);
+		if (status == B_OK)
+			status = _FreeBlock(rightBlock);
+		if (status != B_OK)
+			return status;
+
+		return _DeleteAt(level + 1, parentIndex + 1);
+	}
+
+	if (left != NULL) {
+		// merge this block into its left sibling
+		uint32 leftCount = _Count(left);
+		for (uint32 i = 0; i < count; i++) {
+			_SetEntry(left, level, leftCount + i, _Key(buffer, level, i),
+				level > 0 ? _Pointer(buffer, i) : 0);
+		}
+		_SetCount(left, leftCount + count);
+
+		xfs_agblock_t next = _Right(buffer);
+		_SetSibling(left, true, next);
+		status = _SetSiblingOf(level, next, false, leftBlock);
+		if (status == B_OK)
+			status = _FreeBlock(fBlocks[level]);
+		if (status != B_OK)
+			return status;
+
+		return _DeleteAt(level + 1, parentIndex);
+	}
+
+	return B_OK;
+}
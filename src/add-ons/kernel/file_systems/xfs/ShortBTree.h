@@ -0,0 +1,167 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _XFS_SHORT_BTREE_H_
+#define _XFS_SHORT_BTREE_H_
+
+
+#include "xfs.h"
+
+
+class Transaction;
+class Volume;
+struct TransactionBuffer;
+
+
+#define NULLAGBLOCK				((xfs_agblock_t)-1)
+
+// offsets into short form B+tree blocks
+#define XFS_BTREE_SBLOCK_SIZE		16
+#define XFS_BTREE_SBLOCK_CRC_SIZE	56
+#define XFS_BTREE_SBLOCK_BLKNO		16
+#define XFS_BTREE_SBLOCK_LSN		24
+#define XFS_BTREE_SBLOCK_UUID		32
+#define XFS_BTREE_SBLOCK_OWNER		48
+#define XFS_BTREE_SBLOCK_CRC		52
+
+#define XFS_BTREE_MAX_LEVELS		8
+#define XFS_BTREE_MAX_KEY_SIZE		8
+#define XFS_BTREE_MAX_RECORD_SIZE	16
+
+
+static inline uint32
+read32(const uint8* data, uint32 offset)
+{
+	return B_BENDIAN_TO_HOST_INT32(*(const uint32*)(data + offset));
+}
+
+
+static inline void
+write32(uint8* data, uint32 offset, uint32 value)
+{
+	*(uint32*)(data + offset) = B_HOST_TO_BENDIAN_INT32(value);
+}
+
+
+static inline uint16
+read16(const uint8* data, uint32 offset)
+{
+	return B_BENDIAN_TO_HOST_INT16(*(const uint16*)(data + offset));
+}
+
+
+static inline void
+write16(uint8* data, uint32 offset, uint16 value)
+{
+	*(uint16*)(data + offset) = B_HOST_TO_BENDIAN_INT16(value);
+}
+
+
+enum lookup_mode {
+	LOOKUP_LE,
+	LOOKUP_EQ,
+	LOOKUP_GE
+};
+
+
+/*!	A cursor into one of the B+trees of an allocation group, which all use
+	short form blocks. Records are kept in their big-endian on-disk form;
+	the key of a record is made of its first bytes. Subclasses define how
+	keys compare, where the root is kept, and where blocks come from.
+	Any modification invalidates the cursor; it has to be positioned with
+	Lookup() again before it can be used.
+*/
+class ShortBTree {
+public:
+								ShortBTree(Transaction& transaction,
+									xfs_agnumber_t group, uint32 magic,
+									uint32 recordSize, uint32 keySize);
+	virtual						~ShortBTree();
+
+			status_t			Lookup(const uint8* key, lookup_mode mode,
+									bool& _found);
+			status_t			Next(bool& _found);
+			status_t			Last(bool& _found);
+			const uint8*		Record() const;
+
+			status_t			Update(const uint8* record);
+			status_t			Insert(const uint8* record);
+			status_t			Delete();
+
+protected:
+	virtual	int					_CompareKeys(const uint8* a,
+									const uint8* b) const = 0;
+	virtual	xfs_agblock_t		_Root() const = 0;
+	virtual	uint32				_Levels() const = 0;
+	virtual	void				_SetRoot(xfs_agblock_t root,
+									uint32 levels) = 0;
+	virtual	status_t			_AllocateBlock(xfs_agblock_t& _block) = 0;
+	virtual	bool				_CanFreeBlock() const = 0;
+	virtual	status_t			_FreeBlock(xfs_agblock_t block) = 0;
+
+private:
+			uint32				_EntrySize(int level) const
+									{ return level > 0 ? fKeySize
+										: fRecordSize; }
+			uint32				_MaxRecords(int level) const
+									{ return level > 0 ? fNodeMax : fLeafMax; }
+			uint32				_MinRecords(int level) const
+									{ return _MaxRecords(level) / 2; }
+
+			status_t			_GetBlock(xfs_agblock_t block,
+									TransactionBuffer*& _buffer);
+			status_t			_ReadBlock(int level, xfs_agblock_t block,
+									TransactionBuffer*& _buffer);
+			status_t			_InitBlock(int level, xfs_agblock_t block,
+									TransactionBuffer*& _buffer);
+			int32				_Search(TransactionBuffer* buffer, int level,
+									const uint8* key) const;
+
+			uint16				_Count(TransactionBuffer* buffer) const;
+			void				_SetCount(TransactionBuffer* buffer,
+									uint16 count);
+			xfs_agblock_t		_Left(TransactionBuffer* buffer) const;
+			xfs_agblock_t		_Right(TransactionBuffer* buffer) const;
+			void				_SetSibling(TransactionBuffer* buffer,
+									bool right, xfs_agblock_t block);
+			status_t			_SetSiblingOf(int level, xfs_agblock_t block,
+									bool right, xfs_agblock_t sibling);
+
+			const uint8*		_Key(TransactionBuffer* buffer, int level,
+									uint32 index) const;
+			xfs_agblock_t		_Pointer(TransactionBuffer* buffer,
+									uint32 index) const;
+			void				_SetEntry(TransactionBuffer* buffer, int level,
+									uint32 index, const uint8* entry,
+									xfs_agblock_t pointer);
+			void				_MoveEntries(TransactionBuffer* buffer,
+									int level, uint32 from, uint32 to,
+									uint32 count);
+
+			status_t			_UpdateParentKeys(int level);
+			status_t			_InsertAt(int level, uint32 index,
+									const uint8* entry,
+									xfs_agblock_t pointer);
+			status_t			_DeleteAt(int level, uint32 index);
+
+protected:
+			Transaction&		fTransaction;
+			Volume*				fVolume;
+			xfs_agnumber_t		fGroup;
+
+private:
+			uint32				fMagic;
+			uint32				fRecordSize;
+			uint32				fKeySize;
+			uint32				fHeaderSize;
+			uint32				fLeafMax;
+			uint32				fNodeMax;
+			int					fLevels;
+			TransactionBuffer*	fBuffers[XFS_BTREE_MAX_LEVELS];
+			xfs_agblock_t		fBlocks[XFS_BTREE_MAX_LEVELS];
+			int32				fIndex[XFS_BTREE_MAX_LEVELS];
+};
+
+
+#endif	// _XFS_SHORT_BTREE_H_
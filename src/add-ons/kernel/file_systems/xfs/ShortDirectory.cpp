@@ -6,6 +6,19 @@
 
 #include "ShortDirectory.h"
 
+#include "BlockAllocator.h"
+#include "Extent.h"
+
+
+struct ShortDirectory::EntryData {
+	const uint8*	name;
+	uint8			length;
+	uint16			offset;
+		// where the entry would be in a directory block
+	uint8			fileType;
+	xfs_ino_t		id;
+};
+
 
 ShortDirectory::ShortDirectory(Inode* inode)
 	:
@@ -82,6 +95,10 @@ ShortDirectory::Lookup(const char* name, size_t length, xfs_ino_t* ino)
 {
 	TRACE("ShortDirectory::Lookup\n");
 
+	// the directory might have been converted to the block format
+	if (!fInode->IsLocal())
+		return B_ENTRY_NOT_FOUND;
+
 	if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
 		xfs_ino_t rootIno = fInode->GetVolume()->Root();
 		if (strcmp(name, ".") == 0 || (rootIno == fInode->ID())) {
@@ -98,10 +115,9 @@ ShortDirectory::Lookup(const char* name, size_t length, xfs_ino_t* ino)
 	TRACE("Length of first entry: (%" B_PRIu8 "),offset of first entry:"
 		"(%" B_PRIu16 ")\n", entry->namelen, B_BENDIAN_TO_HOST_INT16(entry->offset.i));
 
-	int status;
 	for (int i = 0; i < fHeader->count; i++) {
-		status = strncmp(name, (char*)entry->name, entry->namelen);
-		if (status == 0) {
+		if (entry->namelen == length
+			&& memcmp(name, entry->name, length) == 0) {
 			*ino = GetEntryIno(entry);
 			return B_OK;
 		}
@@ -116,6 +132,9 @@ ShortDirectory::Lookup(const char* name, size_t length, xfs_ino_t* ino)
 status_t
 ShortDirectory::GetNext(char* name, size_t* length, xfs_ino_t* ino)
 {
+	if (!fInode->IsLocal())
+		return B_ENTRY_NOT_FOUND;
+
 	if (fTrack == 0) {
 		// Return '.'
 		if (*length < 2)
@@ -164,3 +183,297 @@ ShortDirectory::GetNext(char* name, size_t* length, xfs_ino_t* ino)
 
 	return B_ENTRY_NOT_FOUND;
 }
+
+
+status_t
+ShortDirectory::AddEntry(Transaction& transaction, const char* name,
+	size_t length, xfs_ino_t id, uint8 fileType)
+{
+	if (!fInode->IsLocal())
+		return B_BAD_VALUE;
+
+	EntryData* entries;
+	uint8* names;
+	status_t status = _ReadEntries(entries, names);
+	if (status != B_OK)
+		return status;
+	MemoryDeleter entriesDeleter(entries);
+	MemoryDeleter namesDeleter(names);
+
+	int32 count = fHeader->count;
+	if (_FindEntry(entries, count, name, length) >= 0)
+		return B_FILE_EXISTS;
+
+	// the new entry goes after all others, like it would in a block
+	uint32 firstOffset = ExtentDataHeader::Size(fInode)
+		+ Extent::DataEntrySize(fInode, 1) + Extent::DataEntrySize(fInode, 2);
+	uint32 offset = firstOffset;
+	for (int32 i = 0; i < count; i++) {
+		offset = max_c(offset, (uint32)entries[i].offset
+			+ Extent::DataEntrySize(fInode, entries[i].length));
+	}
+
+	EntryData& entry = entries[count];
+	entry.name = (const uint8*)name;
+	entry.length = length;
+	entry.offset = offset;
+	entry.fileType = fileType;
+	entry.id = id;
+	count++;
+
+	// the entries, their leaf entries including "." and "..", and the tail
+	// always have to fit into a block; if there are gaps, they are closed
+	uint32 end = offset + Extent::DataEntrySize(fInode, length);
+	if (end + (count + 2) * sizeof(ExtentLeafEntry) + sizeof(ExtentBlockTail)
+			> fInode->DirBlockSize()) {
+		offset = firstOffset;
+		for (int32 i = 0; i < count; i++) {
+			entries[i].offset = offset;
+			offset += Extent::DataEntrySize(fInode, entries[i].length);
+		}
+	}
+
+	return _WriteEntries(transaction, GetIno(&fHeader->parent), entries,
+		count);
+}
+
+
+status_t
+ShortDirectory::RemoveEntry(Transaction& transaction, const char* name,
+	size_t length, xfs_ino_t& _id)
+{
+	if (!fInode->IsLocal())
+		return B_BAD_VALUE;
+
+	EntryData* entries;
+	uint8* names;
+	status_t status = _ReadEntries(entries, names);
+	if (status != B_OK)
+		return status;
+	MemoryDeleter entriesDeleter(entries);
+	MemoryDeleter namesDeleter(names);
+
+	int32 count = fHeader->count;
+	int32 index = _FindEntry(entries, count, name, length);
+	if (index < 0)
+		return B_ENTRY_NOT_FOUND;
+
+	_id = entries[index].id;
+	memmove(&entries[index], &entries[index + 1],
+		(count - index - 1) * sizeof(EntryData));
+
+	return _WriteEntries(transaction, GetIno(&fHeader->parent), entries,
+		count - 1);
+}
+
+
+status_t
+ShortDirectory::ReplaceEntry(Transaction& transaction, const char* name,
+	size_t length, xfs_ino_t id, uint8 fileType, xfs_ino_t& _oldId)
+{
+	if (!fInode->IsLocal())
+		return B_BAD_VALUE;
+
+	EntryData* entries;
+	uint8* names;
+	status_t status = _ReadEntries(entries, names);
+	if (status != B_OK)
+		return status;
+	MemoryDeleter entriesDeleter(entries);
+	MemoryDeleter namesDeleter(names);
+
+	int32 count = fHeader->count;
+	xfs_ino_t parent = GetIno(&fHeader->parent);
+	if (length == 2 && memcmp(name, "..", 2) == 0) {
+		// the parent is only kept in the header
+		_oldId = parent;
+		parent = id;
+	} else {
+		int32 index = _FindEntry(entries, count, name, length);
+		if (index < 0)
+			return B_ENTRY_NOT_FOUND;
+
+		_oldId = entries[index].id;
+		entries[index].id = id;
+		entries[index].fileType = fileType;
+	}
+
+	return _WriteEntries(transaction, parent, entries, count);
+}
+
+
+/*!	Copies the entries, with room for one more. Their names point into
+	\a _names, as the directory itself is going to be overwritten.
+*/
+status_t
+ShortDirectory::_ReadEntries(EntryData*& _entries, uint8*& _names)
+{
+	uint32 size = fInode->Size();
+	if (size < HeaderSize() || size > fInode->DataForkSize())
+		return B_BAD_DATA;
+
+	uint8* names = (uint8*)malloc(size);
+	EntryData* entries = (EntryData*)malloc(
+		(fHeader->count + 1) * sizeof(EntryData));
+	if (names == NULL || entries == NULL) {
+		free(names);
+		free(entries);
+		return B_NO_MEMORY;
+	}
+	memcpy(names, fHeader, size);
+
+	ShortFormEntry* entry = FirstEntry();
+	for (int32 i = 0; i < fHeader->count; i++) {
+		if ((uint8*)entry + EntrySize(entry->namelen)
+				> (uint8*)fHeader + size) {
+			ERROR("ShortDirectory: directory %" B_PRIu64 " is corrupted\n",
+				fInode->ID());
+			free(names);
+			free(entries);
+			return B_BAD_DATA;
+		}
+
+		entries[i].name = names + (entry->name - (uint8*)fHeader);
+		entries[i].length = entry->namelen;
+		entries[i].offset = B_BENDIAN_TO_HOST_INT16(entry->offset.i);
+		entries[i].fileType = fInode->HasFileTypeField()
+			? GetFileType(entry) : XFS_DIR3_FT_UNKNOWN;
+		entries[i].id = GetEntryIno(entry);
+
+		entry = (ShortFormEntry*)((char*)entry + EntrySize(entry->namelen));
+	}
+
+	_entries = entries;
+	_names = names;
+	return B_OK;
+}
+
+
+int32
+ShortDirectory::_FindEntry(const EntryData* entries, int32 count,
+	const char* name, size_t length)
+{
+	for (int32 i = 0; i < count; i++) {
+		if (entries[i].length == length
+			&& memcmp(entries[i].name, name, length) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+
+/*!	Replaces the contents of the directory, and converts it to the block
+	format if they no longer fit into the inode.
+*/
+status_t
+ShortDirectory::_WriteEntries(Transaction& transaction, xfs_ino_t parent,
+	EntryData* entries, int32 count)
+{
+	status_t status = _Write(parent, entries, count);
+	if (status == B_DEVICE_FULL)
+		return _ConvertToBlock(transaction, parent, entries, count);
+
+	return status;
+}
+
+
+status_t
+ShortDirectory::_Write(xfs_ino_t parent, const EntryData* entries,
+	int32 count)
+{
+	if (count > UINT8_MAX)
+		return B_DEVICE_FULL;
+
+	// all inode numbers are 64 bit wide as soon as one of them needs it
+	uint8 longCount = parent > UINT32_MAX ? 1 : 0;
+	for (int32 i = 0; i < count; i++) {
+		if (entries[i].id > UINT32_MAX)
+			longCount++;
+	}
+	uint32 idSize = longCount > 0 ? sizeof(uint64) : sizeof(uint32);
+	uint32 typeSize = fInode->HasFileTypeField() ? sizeof(uint8) : 0;
+
+	uint32 size = 2 + idSize;
+	for (int32 i = 0; i < count; i++)
+		size += sizeof(ShortFormEntry) + entries[i].length + typeSize + idSize;
+	if (size > fInode->DataForkSize())
+		return B_DEVICE_FULL;
+
+	uint8* data = (uint8*)fHeader;
+	memset(data, 0, fInode->DataForkSize());
+	fHeader->count = count;
+	fHeader->i8count = longCount;
+	if (longCount > 0)
+		fHeader->parent.i8 = B_HOST_TO_BENDIAN_INT64(parent);
+	else
+		fHeader->parent.i4 = B_HOST_TO_BENDIAN_INT32(parent);
+
+	uint8* position = (uint8*)FirstEntry();
+	for (int32 i = 0; i < count; i++) {
+		const EntryData& entry = entries[i];
+		ShortFormEntry* shortEntry = (ShortFormEntry*)position;
+		shortEntry->namelen = entry.length;
+		shortEntry->offset.i = B_HOST_TO_BENDIAN_INT16(entry.offset);
+		memcpy(shortEntry->name, entry.name, entry.length);
+		position = shortEntry->name + entry.length;
+		if (typeSize > 0)
+			*position++ = entry.fileType;
+
+		ShortFormInodeUnion* id = (ShortFormInodeUnion*)position;
+		if (longCount > 0)
+			id->i8 = B_HOST_TO_BENDIAN_INT64(entry.id);
+		else
+			id->i4 = B_HOST_TO_BENDIAN_INT32(entry.id);
+		position += idSize;
+	}
+
+	fInode->SetSize(size);
+	return B_OK;
+}
+
+
+/*!	Moves the entries to a new directory block. Only directory blocks of a
+	single file system block are supported.
+*/
+status_t
+ShortDirectory::_ConvertToBlock(Transaction& transaction, xfs_ino_t parent,
+	const EntryData* entries, int32 count)
+{
+	Volume* volume = fInode->GetVolume();
+	if (volume->DirBlockLog() != 0)
+		return B_NOT_SUPPORTED;
+	if (volume->FreeBlocks() == 0)
+		return B_DEVICE_FULL;
+
+	xfs_fsblock_t hint = (xfs_fsblock_t)INO_TO_AGNO(fInode->ID(), volume)
+		<< volume->AgBlocksLog();
+	xfs_fsblock_t block;
+	uint32 length;
+	status_t status = volume->GetBlockAllocator()->Allocate(transaction, hint,
+		false, 1, block, length);
+	if (status != B_OK)
+		return status;
+	transaction.AdjustCounters(-1);
+
+	TransactionBuffer* buffer;
+	status = Extent::InitBlock(transaction, fInode, block, parent, buffer);
+	for (int32 i = 0; status == B_OK && i < count; i++) {
+		status = Extent::AddToBlock(transaction, fInode, buffer,
+			(const char*)entries[i].name, entries[i].length, entries[i].id,
+			entries[i].fileType);
+	}
+	if (status != B_OK)
+		return status;
+
+	// the data fork now only maps the block
+	uint64* map = (uint64*)fHeader;
+	memset(map, 0, fInode->DataForkSize());
+	map[0] = B_HOST_TO_BENDIAN_INT64(block >> 43);
+	map[1] = B_HOST_TO_BENDIAN_INT64((block << 21) | 1);
+
+	fInode->SetDataFork(XFS_DINODE_FMT_EXTENTS, 1, fInode->BlockCount() + 1);
+	fInode->SetSize(fInode->DirBlockSize());
+	return B_OK;
+}
@@ -65,6 +65,34 @@ public:
 									xfs_ino_t* ino);
 			status_t			Lookup(const char* name, size_t length,
 									xfs_ino_t* id);
+
+			status_t			AddEntry(Transaction& transaction,
+									const char* name, size_t length,
+									xfs_ino_t id, uint8 fileType);
+			status_t			RemoveEntry(Transaction& transaction,
+									const char* name, size_t length,
+									xfs_ino_t& _id);
+			status_t			ReplaceEntry(Transaction& transaction,
+									const char* name, size_t length,
+									xfs_ino_t id, uint8 fileType,
+									xfs_ino_t& _oldId);
+private:
+			struct EntryData;
+
+			status_t			_ReadEntries(EntryData*& _entries,
+									uint8*& _names);
+			int32				_FindEntry(const EntryData* entries,
+									int32 count, const char* name,
+									size_t length);
+			status_t			_WriteEntries(Transaction& transaction,
+									xfs_ino_t parent,
+									EntryData* entries, int32 count);
+			status_t			_Write(xfs_ino_t parent,
+									const EntryData* entries, int32 count);
+			status_t			_ConvertToBlock(Transaction& transaction,
+									xfs_ino_t parent,
+									const EntryData* entries, int32 count);
+
 private:
 			Inode*				fInode;
 			ShortFormHeader*	fHeader;
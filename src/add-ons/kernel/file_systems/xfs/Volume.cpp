@@ -7,22 +7,37 @@
 
 #include "Volume.h"
 
+#include "BlockAllocator.h"
 #include "Checksum.h"
 #include "Inode.h"
+#include "InodeAllocator.h"
+#include "Journal.h"
 
 
 Volume::Volume(fs_volume *volume)
-	: fFSVolume(volume)
+	: fFSVolume(volume),
+	fJournal(NULL),
+	fBlockAllocator(NULL),
+	fInodeAllocator(NULL),
+	fFreeBlocks(0),
+	fReservedBlocks(0),
+	fInodeCount(0),
+	fFreeInodes(0)
 {
 	fFlags = 0;
 	mutex_init(&fLock, "xfs volume");
+	mutex_init(&fDirectoryLock, "xfs directories");
 	TRACE("Volume::Volume() : Initialising volume");
 }
 
 
 Volume::~Volume()
 {
+	delete fBlockAllocator;
+	delete fInodeAllocator;
+	delete fJournal;
 	mutex_destroy(&fLock);
+	mutex_destroy(&fDirectoryLock);
 	TRACE("Volume::Destructor : Removing Volume");
 }
 
@@ -73,12 +88,25 @@ Volume::Identify(int fd, XfsSuperBlock *superBlock)
 }
 
 
+/*!	Write support is still new, the volume is only mounted writable if
+	the "write" parameter asks for it.
+*/
 status_t
-Volume::Mount(const char *deviceName, uint32 flags)
+Volume::Mount(const char *deviceName, uint32 flags, const char *parameters)
 {
 	TRACE("Volume::Mount() : Mounting in progress");
 
-	flags |= B_MOUNT_READ_ONLY;
+	bool allowWrites = false;
+	if (parameters != NULL) {
+		void* handle = parse_driver_settings_string(parameters);
+		if (handle != NULL) {
+			allowWrites = get_driver_boolean_parameter(handle, "write", false,
+				true);
+			unload_driver_settings(handle);
+		}
+	}
+	if (!allowWrites)
+		flags |= B_MOUNT_READ_ONLY;
 
 	if ((flags & B_MOUNT_READ_ONLY) != 0) {
 		TRACE("Volume::Mount(): Read only\n");
@@ -118,6 +146,43 @@ Volume::Mount(const char *deviceName, uint32 flags)
 		return B_ERROR;
 	}
 
+	if (!IsReadOnly() && !_CanWrite())
+		fFlags |= VOLUME_READ_ONLY;
+
+	if (!IsReadOnly()) {
+		fJournal = new(std::nothrow) Journal(this);
+		fBlockAllocator = new(std::nothrow) BlockAllocator(this);
+		fInodeAllocator = new(std::nothrow) InodeAllocator(this);
+		if (fJournal == NULL || fBlockAllocator == NULL
+			|| fInodeAllocator == NULL) {
+			return B_NO_MEMORY;
+		}
+
+		status = fJournal->Init();
+		if (status == B_OK && fJournal->IsClean()) {
+			// inodes left over from a crash would have to be freed first
+			status = fInodeAllocator->CheckUnlinked();
+		} else if (status == B_OK)
+			status = B_BUSY;
+		if (status != B_OK) {
+			// We cannot replay the log, leave that to Linux
+			ERROR("Volume::Mount(): log needs recovery, unlinked inodes "
+				"are left, or the log is not supported, mounting "
+				"read-only\n");
+			delete fJournal;
+			fJournal = NULL;
+			delete fBlockAllocator;
+			fBlockAllocator = NULL;
+			delete fInodeAllocator;
+			fInodeAllocator = NULL;
+			fFlags |= VOLUME_READ_ONLY;
+		}
+	}
+
+	fFreeBlocks = fSuperBlock.FreeBlocks();
+	fInodeCount = fSuperBlock.InodeCount();
+	fFreeInodes = fSuperBlock.FreeInodes();
+
 	opener.Keep();
 
 	//publish the root inode
@@ -143,8 +208,207 @@ Volume::Unmount()
 {
 	TRACE("Volume::Unmount(): Unmounting");
 
+	status_t status = B_OK;
+	if (fJournal != NULL && fJournal->HasWritten()) {
+		// with lazy counters, the block and inode counts in the superblock
+		// are only correct after a clean unmount
+		status = _WriteSuperBlock();
+		if (status == B_OK)
+			status = fJournal->WriteUnmountRecord();
+		if (status != B_OK) {
+			ERROR("Volume::Unmount(): could not mark the log clean: %s\n",
+				strerror(status));
+		}
+	}
+
 	TRACE("Volume::Unmount(): Closing device");
 	close(fDevice);
 
+	return status;
+}
+
+
+off_t
+Volume::FileSystemBlockToOffset(xfs_fsblock_t block) const
+{
+	xfs_agnumber_t agNo = FSBLOCKS_TO_AGNO(block, this);
+	xfs_agblock_t agBlockNo = FSBLOCKS_TO_AGBLOCKNO(block, this);
+
+	return ((off_t)agNo * AgBlocks() + agBlockNo) << BlockLog();
+}
+
+
+/*!	Returns the location of the inode cluster buffer that contains the
+	given inode, in the form log recovery expects it for inode log items:
+	the start and length in basic blocks, and the offset of the inode within
+	the cluster in bytes.
+*/
+void
+Volume::GetInodeClusterLocation(xfs_ino_t id, int64& _blockNumber,
+	int32& _length, int32& _offset) const
+{
+	xfs_agnumber_t agNo = INO_TO_AGNO(id, this);
+	uint32 agRelativeInodeNo = INO_TO_AGINO(id, AgInodeBits());
+	xfs_agblock_t agBlock = INO_TO_AGBLOCK(agRelativeInodeNo, this);
+	uint32 offset = INO_TO_BLOCKOFFSET(id, this);
+
+	uint32 clusterSize = 8192;
+	if (IsVersion5()) {
+		uint32 scaledSize = clusterSize * (InodeSize() / 256);
+		if (fSuperBlock.InodeAlignment() >= (scaledSize >> BlockLog()))
+			clusterSize = scaledSize;
+	}
+	uint32 blocksPerCluster = max_c(1, clusterSize >> BlockLog());
+
+	xfs_agblock_t clusterBlock = agBlock;
+	if (fSuperBlock.HasAlign()
+		&& fSuperBlock.InodeAlignment() >= blocksPerCluster) {
+		// chunks are aligned, and made of whole clusters
+		xfs_agblock_t chunkBlock
+			= agBlock & ~(fSuperBlock.InodeAlignment() - 1);
+		clusterBlock = chunkBlock
+			+ (agBlock - chunkBlock) / blocksPerCluster * blocksPerCluster;
+	} else
+		blocksPerCluster = 1;
+
+	_blockNumber = (((off_t)agNo * AgBlocks() + clusterBlock) << BlockLog())
+		>> XLOG_BB_SHIFT;
+	_length = blocksPerCluster << (BlockLog() - XLOG_BB_SHIFT);
+	_offset = ((agBlock - clusterBlock) * fSuperBlock.InodesPerBlock()
+		+ offset) << fSuperBlock.InodeLog();
+}
+
+
+/*!	Returns the number of blocks that can still be allocated. Some blocks
+	in each allocation group are always kept free, see
+	BlockAllocator::ReservedBlocksPerGroup().
+*/
+uint64
+Volume::FreeBlocks()
+{
+	MutexLocker locker(fLock);
+
+	uint64 setAside = (uint64)AgCount() * BlockAllocator::ReservedBlocksPerGroup(
+		AgBlocks());
+	if (fFreeBlocks < fReservedBlocks + setAside)
+		return 0;
+	return fFreeBlocks - fReservedBlocks - setAside;
+}
+
+
+/*!	Reserves space for data that has been written to the file cache, but
+	does not have blocks allocated yet.
+*/
+status_t
+Volume::ReserveBlocks(uint64 count)
+{
+	if (count == 0)
+		return B_OK;
+
+	uint64 freeBlocks = FreeBlocks();
+
+	MutexLocker locker(fLock);
+	if (count > freeBlocks)
+		return B_DEVICE_FULL;
+
+	fReservedBlocks += count;
 	return B_OK;
 }
+
+
+void
+Volume::UnreserveBlocks(uint64 count)
+{
+	MutexLocker locker(fLock);
+	fReservedBlocks -= min_c(count, fReservedBlocks);
+}
+
+
+/*!	Accounts for \a count blocks that have been allocated, \a reserved of
+	which had been reserved before.
+*/
+void
+Volume::BlocksAllocated(uint64 count, uint64 reserved)
+{
+	MutexLocker locker(fLock);
+	fFreeBlocks -= min_c(count, fFreeBlocks);
+	fReservedBlocks -= min_c(reserved, fReservedBlocks);
+}
+
+
+/*!	Applies the changes of a committed transaction to the counters that
+	are written to the superblock on unmount.
+*/
+void
+Volume::AdjustCounters(int64 freeBlocks, int64 inodes, int64 freeInodes)
+{
+	MutexLocker locker(fLock);
+	fFreeBlocks += freeBlocks;
+	fInodeCount += inodes;
+	fFreeInodes += freeInodes;
+}
+
+
+/*!	Returns whether the driver knows how to keep this file system
+	consistent. Everything else is mounted read-only.
+*/
+bool
+Volume::_CanWrite() const
+{
+	if ((fSuperBlock.ReadOnlyCompatFeatures()
+			& ~(XFS_SB_FEAT_RO_COMPAT_FINOBT | XFS_SB_FEAT_RO_COMPAT_REFLINK
+				| XFS_SB_FEAT_RO_COMPAT_INOBTCNT)) != 0
+		|| fSuperBlock.LogIncompatFeatures() != 0) {
+		ERROR("Volume: reverse mapping or unknown compatible features, "
+			"mounting read-only\n");
+		return false;
+	}
+	if (fSuperBlock.LogStart() == 0 || fSuperBlock.RealtimeBlocks() != 0
+		|| (fSuperBlock.QuotaFlags() & XFS_ALL_QUOTA_ACCT) != 0) {
+		ERROR("Volume: external log, realtime volume or quota accounting, "
+			"mounting read-only\n");
+		return false;
+	}
+	if (!fSuperBlock.HasLazyCounters() || BlockSize() > B_PAGE_SIZE
+		|| fSuperBlock.LogStripeUnit() > XLOG_HEADER_CYCLE_SIZE) {
+		ERROR("Volume: unsupported geometry, mounting read-only\n");
+		return false;
+	}
+
+	return true;
+}
+
+
+status_t
+Volume::_WriteSuperBlock()
+{
+	Transaction transaction(this);
+	status_t status = transaction.Start();
+	if (status != B_OK)
+		return status;
+
+	bool version5 = IsVersion5();
+	TransactionBuffer* buffer;
+	status = transaction.GetBuffer(0, SectorSize(), XFS_BLFT_SB_BUF,
+		version5 ? XfsSuperBlock::Offset_crc() : -1,
+		version5 ? XfsSuperBlock::Offset_lsn() : -1, buffer);
+	if (status != B_OK)
+		return status;
+
+	mutex_lock(&fLock);
+	fSuperBlock.SetFreeBlocks(fFreeBlocks);
+	fSuperBlock.SetInodeCounts(fInodeCount, fFreeInodes);
+	mutex_unlock(&fLock);
+
+	// the inode counts come right before the free block count
+	uint64* counters = (uint64*)(buffer->data + XfsSuperBlock::Offset_icount());
+	counters[0] = B_HOST_TO_BENDIAN_INT64(fSuperBlock.InodeCount());
+	counters[1] = B_HOST_TO_BENDIAN_INT64(fSuperBlock.FreeInodes());
+	*(uint64*)(buffer->data + XfsSuperBlock::Offset_fdblocks())
+		= B_HOST_TO_BENDIAN_INT64(fSuperBlock.FreeBlocks());
+	transaction.MarkDirty(buffer, XfsSuperBlock::Offset_icount(),
+		XfsSuperBlock::Offset_fdblocks() + sizeof(uint64)
+			- XfsSuperBlock::Offset_icount());
+
+	return transaction.Commit();
+}
@@ -11,6 +11,10 @@
 #include "xfs.h"
 
 
+class BlockAllocator;
+class InodeAllocator;
+class Journal;
+
 #define FSBLOCK_SHIFT(fsBlockLog) (fsBlockLog - XFS_MIN_BLOCKSIZE_LOG);
 #define FSBLOCKS_TO_BASICBLOCKS(fsBlockLog, x) x << FSBLOCK_SHIFT(fsBlockLog);
 	// Converting the FS Blocks to Basic Blocks
@@ -25,7 +29,8 @@ public:
 								Volume(fs_volume *volume);
 								~Volume();
 
-			status_t			Mount(const char *device, uint32 flags);
+			status_t			Mount(const char *device, uint32 flags,
+									const char *parameters);
 			status_t			Unmount();
 			status_t 			Initialize(int fd, const char *label,
 									uint32 blockSize, uint32 sectorSize);
@@ -93,11 +98,39 @@ public:
 			bool				UuidEquals(const uuid_t& u1)
 									{ return fSuperBlock.UuidEquals(u1); }
 
+			uint16				SectorSize() const
+									{ return fSuperBlock.SectorSize(); }
+
+			off_t				FileSystemBlockToOffset(
+									xfs_fsblock_t block) const;
+			void				GetInodeClusterLocation(xfs_ino_t id,
+									int64& _blockNumber, int32& _length,
+									int32& _offset) const;
+
+			Journal*			GetJournal() const { return fJournal; }
+			BlockAllocator*		GetBlockAllocator() const
+									{ return fBlockAllocator; }
+			InodeAllocator*		GetInodeAllocator() const
+									{ return fInodeAllocator; }
+			mutex*				DirectoryLock() { return &fDirectoryLock; }
+
+			uint64				FreeBlocks();
+			status_t			ReserveBlocks(uint64 count);
+			void				UnreserveBlocks(uint64 count);
+			void				BlocksAllocated(uint64 count,
+									uint64 reserved);
+			void				AdjustCounters(int64 freeBlocks,
+									int64 inodes, int64 freeInodes);
+
 	#if 0
 			off_t				NumBlocks() const
 									{ return fSuperBlock.NumBlocks(); }
 	#endif
 
+private:
+			bool				_CanWrite() const;
+			status_t			_WriteSuperBlock();
+
 protected:
 			fs_volume*			fFSVolume;
 			int					fDevice;
@@ -107,8 +140,20 @@ protected:
 
 			uint32				fDeviceBlockSize;
 			mutex 				fLock;
+			mutex				fDirectoryLock;
+				// serializes all changes to directories, as they can
+				// involve more than one of them
 
 			uint32				fFlags;
+
+			Journal*			fJournal;
+			BlockAllocator*		fBlockAllocator;
+			InodeAllocator*		fInodeAllocator;
+			uint64				fFreeBlocks;
+			uint64				fReservedBlocks;
+				// for delayed allocations, protected by fLock
+			uint64				fInodeCount;
+			uint64				fFreeInodes;
 };
 
 #endif
@@ -7,7 +7,9 @@
 
 #include "system_dependencies.h"
 #include "Directory.h"
+#include "Journal.h"
 #include "Inode.h"
+#include "InodeAllocator.h"
 #include "ShortAttribute.h"
 #include "Symlink.h"
 #include "Volume.h"
@@ -16,6 +18,7 @@
 
 
 #define XFS_IO_SIZE	65536
+#define INODE_NOTIFICATION_INTERVAL	10000000LL
 
 struct identify_cookie {
 	/*	super_block_struct super_block;
@@ -65,7 +68,7 @@ xfs_mount(fs_volume *_volume, const char *device, uint32 flags,
 	_volume->private_volume = volume;
 	_volume->ops = &gxfsVolumeOps;
 
-	status_t status = volume->Mount(device, flags);
+	status_t status = volume->Mount(device, flags, args);
 	if (status != B_OK) {
 		ERROR("Failed mounting the volume. Error: %s\n", strerror(status));
 		delete volume;
@@ -96,13 +99,14 @@ xfs_read_fs_info(fs_volume *_volume, struct fs_info *info)
 	TRACE("XFS_READ_FS_INFO:\n");
 	Volume* volume = (Volume*)_volume->private_volume;
 
-	info->flags = B_FS_IS_READONLY
-					| B_FS_HAS_ATTR | B_FS_IS_PERSISTENT;
+	info->flags = B_FS_HAS_ATTR | B_FS_IS_PERSISTENT;
+	if (volume->IsReadOnly())
+		info->flags |= B_FS_IS_READONLY;
 
 	info->io_size = XFS_IO_SIZE;
 	info->block_size = volume->SuperBlock().BlockSize();
 	info->total_blocks = volume->SuperBlock().TotalBlocks();
-	info->free_blocks = volume->SuperBlock().FreeBlocks();
+	info->free_blocks = volume->FreeBlocks();
 
 	// Volume name
 	strlcpy(info->volume_name, volume->Name(), sizeof(info->volume_name));
@@ -156,10 +160,47 @@ xfs_put_vnode(fs_volume *_volume, fs_vnode *_node, bool reenter)
 }
 
 
+static status_t
+xfs_remove_vnode(fs_volume *_volume, fs_vnode *_node, bool reenter)
+{
+	TRACE("XFS_REMOVE_VNODE:\n");
+	Volume* volume = (Volume*)_volume->private_volume;
+	Inode* inode = (Inode*)_node->private_node;
+	InodeAllocator* allocator = volume->GetInodeAllocator();
+
+	status_t status;
+	{
+		Transaction transaction(volume);
+		status = transaction.Start();
+		if (status == B_OK)
+			status = inode->SaveState(transaction);
+		if (status == B_OK)
+			status = allocator->RemoveUnlinked(transaction, inode);
+		if (status == B_OK)
+			status = inode->Free(transaction);
+		if (status == B_OK)
+			status = transaction.Commit();
+	}
+
+	if (status != B_OK) {
+		// it stays in its unlinked list, Linux will free it
+		ERROR("remove_vnode: could not free inode %" B_PRIu64 ": %s\n",
+			inode->ID(), strerror(status));
+
+		Transaction transaction(volume);
+		if (transaction.Start() == B_OK)
+			allocator->ForgetUnlinked(inode);
+	}
+
+	delete inode;
+	return B_OK;
+}
+
+
 static bool
 xfs_can_page(fs_volume *_volume, fs_vnode *_node, void *_cookie)
 {
-	return B_NOT_SUPPORTED;
+	return true;
 }
 
 
@@ -167,15 +208,101 @@ static status_t
 xfs_read_pages(fs_volume *_volume, fs_vnode *_node, void *_cookie,
 	off_t pos, const iovec *vecs, size_t count, size_t *_numBytes)
 {
-	return B_NOT_SUPPORTED;
+	Volume* volume = (Volume*)_volume->private_volume;
+	Inode* inode = (Inode*)_node->private_node;
+
+	if (inode->FileCache() == NULL)
+		return B_BAD_VALUE;
+
+	ReadLocker locker(inode->Lock());
+
+	uint32 vecIndex = 0;
+	size_t vecOffset = 0;
+	size_t bytesLeft = *_numBytes;
+	status_t status;
+
+	while (true) {
+		file_io_vec fileVecs[8];
+		size_t fileVecCount = 8;
+
+		status = file_map_translate(inode->Map(), pos, bytesLeft, fileVecs,
+			&fileVecCount, 0);
+		if (status != B_OK && status != B_BUFFER_OVERFLOW)
+			break;
+
+		bool bufferOverflow = status == B_BUFFER_OVERFLOW;
+
+		size_t bytes = bytesLeft;
+		status = read_file_io_vec_pages(volume->Device(), fileVecs,
+			fileVecCount, vecs, count, &vecIndex, &vecOffset, &bytes);
+		if (status != B_OK || !bufferOverflow)
+			break;
+
+		pos += bytes;
+		bytesLeft -= bytes;
+	}
+
+	return status;
 }
 
 
+/*!	The blocks for the pages are allocated here, as unwritten extents; they
+	are only converted after the data has been written, so that a crash in
+	between cannot expose stale blocks.
+*/
 static status_t
-xfs_io(fs_volume *_volume, fs_vnode *_node, void *_cookie,
-	io_request *request)
+xfs_write_pages(fs_volume *_volume, fs_vnode *_node, void *_cookie,
+	off_t pos, const iovec *vecs, size_t count, size_t *_numBytes)
 {
-	return B_NOT_SUPPORTED;
+	Volume* volume = (Volume*)_volume->private_volume;
+	Inode* inode = (Inode*)_node->private_node;
+
+	if (volume->IsReadOnly())
+		return B_READ_ONLY_DEVICE;
+	if (inode->FileCache() == NULL)
+		return B_BAD_VALUE;
+
+	WriteLocker locker(inode->Lock());
+
+	// the file may have been shrunk in the mean time
+	if (pos >= inode->Size())
+		return B_OK;
+
+	size_t length = *_numBytes;
+	status_t status = inode->AllocateForWrite(pos, length);
+	if (status != B_OK)
+		return status;
+
+	uint32 vecIndex = 0;
+	size_t vecOffset = 0;
+	off_t offset = pos;
+	size_t bytesLeft = length;
+
+	while (true) {
+		file_io_vec fileVecs[8];
+		size_t fileVecCount = 8;
+
+		status = inode->GetFileMap(offset, bytesLeft, fileVecs,
+			&fileVecCount, true);
+		if (status != B_OK && status != B_BUFFER_OVERFLOW)
+			break;
+
+		bool bufferOverflow = status == B_BUFFER_OVERFLOW;
+
+		size_t bytes = bytesLeft;
+		status = write_file_io_vec_pages(volume->Device(), fileVecs,
+			fileVecCount, vecs, count, &vecIndex, &vecOffset, &bytes);
+		if (status != B_OK || !bufferOverflow)
+			break;
+
+		offset += bytes;
+		bytesLeft -= bytes;
+	}
+
+	if (status == B_OK)
+		status = inode->MarkWritten(pos, length);
+
+	return status;
 }
 
 
@@ -183,7 +310,11 @@ static status_t
 xfs_get_file_map(fs_volume *_volume, fs_vnode *_node, off_t offset,
 	size_t size, struct file_io_vec *vecs, size_t *_count)
 {
-	return B_NOT_SUPPORTED;
+	Inode* inode = (Inode*)_node->private_node;
+	if (inode->FileCache() == NULL)
+		return B_BAD_VALUE;
+
+	return inode->GetFileMap(offset, size, vecs, _count, false);
 }
 
 
@@ -205,15 +336,16 @@ xfs_lookup(fs_volume *_volume, fs_vnode *_directory, const char *name,
 	if (status < B_OK)
 		return status;
 
+	ReadLocker locker(directory->Lock());
+
 	DirectoryIterator* iterator = DirectoryIterator::Init(directory);
 	if (iterator == NULL)
 		return B_BAD_VALUE;
+	ObjectDeleter<DirectoryIterator> iteratorDeleter(iterator);
 
 	status = iterator->Lookup(name, strlen(name), (xfs_ino_t*)_vnodeID);
-	if (status != B_OK) {
-		delete iterator;
+	if (status != B_OK)
 		return status;
-	}
 
 	TRACE("XFS_LOOKUP: ID: (%ld)\n", *_vnodeID);
 	status = get_vnode(volume->FSVolume(), *_vnodeID, NULL);
@@ -230,6 +362,14 @@ xfs_ioctl(fs_volume *_volume, fs_vnode *_node, void *_cookie, uint32 cmd,
 }
 
 
+static status_t
+xfs_fsync(fs_volume *_volume, fs_vnode *_node)
+{
+	Inode* inode = (Inode*)_node->private_node;
+	return inode->Sync();
+}
+
+
 static status_t
 xfs_read_stat(fs_volume *_volume, fs_vnode *_node, struct stat *stat)
 {
@@ -237,7 +377,7 @@ xfs_read_stat(fs_volume *_volume, fs_vnode *_node, struct stat *stat)
 	TRACE("XFS_READ_STAT: id: (%ld)\n", inode->ID());
 	stat->st_dev = inode->GetVolume()->ID();
 	stat->st_ino = inode->ID();
-	stat->st_nlink = 1;
+	stat->st_nlink = inode->NLink();
 	stat->st_blksize = XFS_IO_SIZE;
 
 	stat->st_uid = inode->UserId();
@@ -263,10 +403,114 @@ xfs_read_stat(fs_volume *_volume, fs_vnode *_node, struct stat *stat)
 
 
 static status_t
-xfs_open(fs_volume * /*_volume*/, fs_vnode *_node, int openMode,
+xfs_write_stat(fs_volume *_volume, fs_vnode *_node, const struct stat *stat,
+	uint32 mask)
+{
+	TRACE("XFS_WRITE_STAT:\n");
+	Volume* volume = (Volume*)_volume->private_volume;
+	Inode* inode = (Inode*)_node->private_node;
+
+	if (volume->IsReadOnly())
+		return B_READ_ONLY_DEVICE;
+
+	uid_t uid = geteuid();
+	bool isOwnerOrRoot = uid == 0 || uid == (uid_t)inode->UserId();
+	bool hasWriteAccess = inode->CheckPermissions(W_OK) == B_OK;
+
+	if ((mask & B_STAT_SIZE) != 0 && inode->Size() != stat->st_size) {
+		if (inode->IsDirectory())
+			return B_IS_A_DIRECTORY;
+		if (!inode->IsFile())
+			return B_BAD_VALUE;
+		if (!hasWriteAccess)
+			return B_NOT_ALLOWED;
+
+		// a new part of the file is a hole
+		status_t status = stat->st_size > inode->Size()
+			? inode->Grow(stat->st_size) : inode->Shrink(stat->st_size);
+		if (status != B_OK)
+			return status;
+
+		mask &= ~B_STAT_SIZE;
+		notify_stat_changed(volume->ID(), -1, inode->ID(),
+			B_STAT_SIZE | B_STAT_MODIFICATION_TIME);
+	}
+
+	if ((mask & (B_STAT_MODE | B_STAT_GID)) != 0 && !isOwnerOrRoot)
+		return B_NOT_ALLOWED;
+	if ((mask & B_STAT_UID) != 0 && uid != 0)
+		return B_NOT_ALLOWED;
+	if ((mask & (B_STAT_MODIFICATION_TIME | B_STAT_ACCESS_TIME)) != 0
+		&& !isOwnerOrRoot && !hasWriteAccess)
+		return B_NOT_ALLOWED;
+
+	mask &= B_STAT_MODE | B_STAT_UID | B_STAT_GID | B_STAT_MODIFICATION_TIME
+		| B_STAT_ACCESS_TIME;
+	if (mask == 0)
+		return B_OK;
+
+	WriteLocker locker(inode->Lock());
+
+	Transaction transaction(volume);
+	status_t status = transaction.Start();
+	if (status != B_OK)
+		return status;
+
+	if ((mask & B_STAT_MODE) != 0)
+		inode->SetMode(stat->st_mode);
+	if ((mask & B_STAT_UID) != 0)
+		inode->SetUserId(stat->st_uid);
+	if ((mask & B_STAT_GID) != 0)
+		inode->SetGroupId(stat->st_gid);
+	if ((mask & B_STAT_MODIFICATION_TIME) != 0)
+		inode->SetModificationTime(stat->st_mtim);
+	if ((mask & B_STAT_ACCESS_TIME) != 0)
+		inode->SetAccessTime(stat->st_atim);
+
+	struct timespec now;
+	now.tv_sec = real_time_clock();
+	now.tv_nsec = 0;
+	inode->SetChangeTime(now);
+
+	status = inode->WriteBack(transaction);
+	if (status == B_OK)
+		status = transaction.Commit();
+	if (status == B_OK)
+		notify_stat_changed(volume->ID(), -1, inode->ID(), mask);
+
+	return status;
+}
+
+
+static status_t
+xfs_preallocate(fs_volume *_volume, fs_vnode *_node, off_t pos, off_t length)
+{
+	Inode* inode = (Inode*)_node->private_node;
+	if (inode->IsDirectory())
+		return B_IS_A_DIRECTORY;
+
+	status_t status = inode->CheckPermissions(W_OK);
+	if (status != B_OK)
+		return status;
+
+	off_t oldSize = inode->Size();
+	status = inode->Preallocate(pos, length);
+	if (status == B_OK && inode->Size() != oldSize) {
+		Volume* volume = (Volume*)_volume->private_volume;
+		notify_stat_changed(volume->ID(), -1, inode->ID(),
+			B_STAT_SIZE | B_STAT_MODIFICATION_TIME);
+	}
+
+	return status;
+}
+
+
+static status_t
+xfs_open(fs_volume *_volume, fs_vnode *_node, int openMode,
 	void **_cookie)
 {
 	TRACE("XFS_OPEN:\n");
+	Volume* volume = (Volume*)_volume->private_volume;
 	Inode* inode = (Inode*)_node->private_node;
 
 	// opening a directory read-only is allowed, although you can't read
@@ -279,6 +523,15 @@ xfs_open(fs_volume * /*_volume*/, fs_vnode *_node, int openMode,
 	if (status != B_OK)
 		return status;
 
+	if ((openMode & O_TRUNC) != 0 && inode->IsFile() && inode->Size() > 0) {
+		status = inode->Shrink(0);
+		if (status != B_OK)
+			return status;
+
+		notify_stat_changed(volume->ID(), -1, inode->ID(),
+			B_STAT_SIZE | B_STAT_MODIFICATION_TIME);
+	}
+
 	// Prepare the cookie
 	file_cookie* cookie = new(std::nothrow) file_cookie;
 	if (cookie == NULL)
@@ -312,6 +565,37 @@ xfs_read(fs_volume *_volume, fs_vnode *_node, void *_cookie, off_t pos,
 }
 
 
+static status_t
+xfs_write(fs_volume *_volume, fs_vnode *_node, void *_cookie, off_t pos,
+	const void *buffer, size_t *_length)
+{
+	TRACE("XFS_WRITE: pos:(%ld), *length:(%ld)\n", pos, *_length);
+	Volume* volume = (Volume*)_volume->private_volume;
+	Inode* inode = (Inode*)_node->private_node;
+	file_cookie* cookie = (file_cookie*)_cookie;
+
+	if (inode->IsDirectory()) {
+		*_length = 0;
+		return B_IS_A_DIRECTORY;
+	}
+
+	if ((cookie->open_mode & O_APPEND) != 0)
+		pos = inode->Size();
+
+	status_t status = inode->WriteAt(pos, (const uint8*)buffer, _length);
+	if (status == B_OK && cookie->last_size != inode->Size()
+		&& system_time() > cookie->last_notification
+			+ INODE_NOTIFICATION_INTERVAL) {
+		notify_stat_changed(volume->ID(), -1, inode->ID(),
+			B_STAT_MODIFICATION_TIME | B_STAT_SIZE | B_STAT_INTERIM_UPDATE);
+		cookie->last_size = inode->Size();
+		cookie->last_notification = system_time();
+	}
+
+	return status;
+}
+
+
 static status_t
 xfs_close(fs_volume *_volume, fs_vnode *_node, void *_cookie)
 {
@@ -362,10 +646,556 @@ xfs_read_link(fs_volume *_volume, fs_vnode *_node, char *buffer,
 }
 
 
-status_t
+static struct timespec
+current_time()
+{
+	struct timespec now;
+	now.tv_sec = real_time_clock();
+	now.tv_nsec = 0;
+	return now;
+}
+
+
+/*!	Checks the name of a new entry; "." and ".." exist in every directory
+	and cannot be changed.
+*/
+static status_t
+check_entry_name(const char* name)
+{
+	if (name[0] == '\0' || strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+		return B_NOT_ALLOWED;
+	if (strlen(name) >= B_FILE_NAME_LENGTH)
+		return B_NAME_TOO_LONG;
+
+	return B_OK;
+}
+
+
+/*!	Checks that \a directory has no entries besides "." and "..". */
+static status_t
+check_empty(Inode* directory)
+{
+	DirectoryIterator* iterator = DirectoryIterator::Init(directory);
+	if (iterator == NULL)
+		return B_BAD_VALUE;
+	ObjectDeleter<DirectoryIterator> iteratorDeleter(iterator);
+
+	char name[B_FILE_NAME_LENGTH];
+	while (true) {
+		size_t length = sizeof(name);
+		xfs_ino_t id;
+		status_t status = iterator->GetNext(name, &length, &id);
+		if (status == B_ENTRY_NOT_FOUND)
+			return B_OK;
+		if (status != B_OK)
+			return status;
+
+		if (strcmp(name, ".") != 0 && strcmp(name, "..") != 0)
+			return B_DIRECTORY_NOT_EMPTY;
+	}
+}
+
+
+/*!	Checks that \a directory is neither the directory \a id, nor inside of
+	it, by following the ".." entries up to the root.
+*/
+static status_t
+check_not_inside(Volume* volume, Inode* directory, xfs_ino_t id)
+{
+	xfs_ino_t current = directory->ID();
+	while (current != (xfs_ino_t)volume->Root()) {
+		if (current == id)
+			return B_BAD_VALUE;
+
+		Inode* inode;
+		status_t status = get_vnode(volume->FSVolume(), current,
+			(void**)&inode);
+		if (status != B_OK)
+			return status;
+
+		xfs_ino_t parent;
+		DirectoryIterator* iterator = DirectoryIterator::Init(inode);
+		status = iterator != NULL
+			? iterator->Lookup("..", 2, &parent) : B_BAD_VALUE;
+		delete iterator;
+		put_vnode(volume->FSVolume(), current);
+
+		if (status != B_OK)
+			return status;
+		if (parent == current)
+			return B_BAD_DATA;
+
+		current = parent;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Drops the link \a directory holds on \a inode. A directory also loses
+	its "." entry, and \a directory the ".." entry in it. Once there is no
+	link left, the inode is put into its unlinked list, until it is freed.
+*/
+static status_t
+drop_link(Transaction& transaction, Inode* directory, Inode* inode)
+{
+	if (inode->IsDirectory()) {
+		inode->SetLinkCount(0);
+		directory->SetLinkCount(directory->NLink() - 1);
+	} else if (inode->NLink() > 0)
+		inode->SetLinkCount(inode->NLink() - 1);
+
+	if (inode->NLink() > 0)
+		return B_OK;
+
+	return inode->GetVolume()->GetInodeAllocator()->AddUnlinked(transaction,
+		inode);
+}
+
+
+/*!	Creates a new inode, and adds it to \a directory under \a name. The
+	caller has to hold the locks of the volume's directories, and of
+	\a directory.
+*/
+static status_t
+create_inode(Volume* volume, Inode* directory, DirectoryIterator* iterator,
+	const char* name, mode_t mode, Inode*& _inode)
+{
+	Inode* inode = NULL;
+	status_t status;
+	{
+		Transaction transaction(volume);
+		status = transaction.Start();
+		if (status == B_OK)
+			status = directory->SaveState(transaction);
+		if (status == B_OK)
+			status = Inode::Create(transaction, directory, mode, inode);
+		if (status == B_OK) {
+			status = iterator->AddEntry(transaction, name, strlen(name),
+				inode->ID(), inode->XfsModeToFtype());
+		}
+		if (status == B_OK) {
+			// the ".." entry of a new directory
+			if (inode->IsDirectory())
+				directory->SetLinkCount(directory->NLink() + 1);
+
+			struct timespec now = current_time();
+			directory->SetModificationTime(now);
+			directory->SetChangeTime(now);
+			status = directory->WriteBack(transaction);
+		}
+		if (status == B_OK)
+			status = transaction.Commit();
+	}
+
+	if (status != B_OK) {
+		// the transaction is gone, it can no longer refer to the inode
+		delete inode;
+		return status;
+	}
+
+	_inode = inode;
+	return B_OK;
+}
+
+
+/*!	Removes the entry \a name of \a inode from \a directory; the caller has
+	to hold the locks of the volume's directories, and of \a directory.
+*/
+static status_t
+unlink_inode(Volume* volume, Inode* directory, DirectoryIterator* iterator,
+	const char* name, Inode* inode, bool isDirectory)
+{
+	if (isDirectory && !inode->IsDirectory())
+		return B_NOT_A_DIRECTORY;
+	if (!isDirectory && inode->IsDirectory())
+		return B_IS_A_DIRECTORY;
+
+	status_t status = inode->CheckRemovable();
+	if (status == B_OK && isDirectory)
+		status = check_empty(inode);
+	if (status != B_OK)
+		return status;
+
+	WriteLocker locker(inode->Lock());
+
+	Transaction transaction(volume);
+	status = transaction.Start();
+	if (status == B_OK)
+		status = directory->SaveState(transaction);
+	if (status == B_OK)
+		status = inode->SaveState(transaction);
+	if (status != B_OK)
+		return status;
+
+	xfs_ino_t id;
+	status = iterator->RemoveEntry(transaction, name, strlen(name), id);
+	if (status == B_OK)
+		status = drop_link(transaction, directory, inode);
+	if (status != B_OK)
+		return status;
+
+	struct timespec now = current_time();
+	directory->SetModificationTime(now);
+	directory->SetChangeTime(now);
+	inode->SetChangeTime(now);
+
+	status = inode->WriteBack(transaction);
+	if (status == B_OK)
+		status = directory->WriteBack(transaction);
+	if (status == B_OK)
+		status = transaction.Commit();
+
+	return status;
+}
+
+
+static status_t
+remove_entry(Volume* volume, Inode* directory, const char* name,
+	bool isDirectory)
+{
+	if (!directory->IsDirectory())
+		return B_NOT_A_DIRECTORY;
+	if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+		return B_NOT_ALLOWED;
+
+	status_t status = directory->CheckPermissions(W_OK | X_OK);
+	if (status != B_OK)
+		return status;
+
+	MutexLocker directoryLocker(volume->DirectoryLock());
+	WriteLocker locker(directory->Lock());
+
+	DirectoryIterator* iterator = DirectoryIterator::Init(directory);
+	if (iterator == NULL)
+		return B_BAD_VALUE;
+	ObjectDeleter<DirectoryIterator> iteratorDeleter(iterator);
+
+	xfs_ino_t id;
+	status = iterator->Lookup(name, strlen(name), &id);
+	if (status != B_OK)
+		return status;
+
+	Inode* inode;
+	status = get_vnode(volume->FSVolume(), id, (void**)&inode);
+	if (status != B_OK)
+		return status;
+
+	status = unlink_inode(volume, directory, iterator, name, inode,
+		isDirectory);
+
+	// the inode is freed once it is no longer in use
+	if (status == B_OK && inode->NLink() == 0)
+		remove_vnode(volume->FSVolume(), id);
+	put_vnode(volume->FSVolume(), id);
+
+	if (status == B_OK)
+		notify_entry_removed(volume->ID(), directory->ID(), name, id);
+
+	return status;
+}
+
+
+/*!	Moves the entry \a oldName of \a inode to \a newName, replacing the
+	entry of \a clobbered, if there is one. The caller has to hold the locks
+	of the volume's directories, and of both directories.
+*/
+static status_t
+move_inode(Volume* volume, Inode* oldDirectory, DirectoryIterator* oldIterator,
+	const char* oldName, Inode* newDirectory, DirectoryIterator* newIterator,
+	const char* newName, Inode* inode, Inode* clobbered)
+{
+	status_t status;
+	if (clobbered != NULL) {
+		if (clobbered->IsDirectory() && !inode->IsDirectory())
+			return B_IS_A_DIRECTORY;
+		if (!clobbered->IsDirectory() && inode->IsDirectory())
+			return B_NOT_A_DIRECTORY;
+
+		status = clobbered->CheckRemovable();
+		if (status == B_OK && clobbered->IsDirectory())
+			status = check_empty(clobbered);
+		if (status != B_OK)
+			return status;
+	}
+
+	// a directory that changes its parent has to update its ".." entry
+	DirectoryIterator* iterator = NULL;
+	if (inode->IsDirectory() && oldDirectory != newDirectory) {
+		status = check_not_inside(volume, newDirectory, inode->ID());
+		if (status != B_OK)
+			return status;
+
+		iterator = DirectoryIterator::Init(inode);
+		if (iterator == NULL)
+			return B_BAD_VALUE;
+	}
+	ObjectDeleter<DirectoryIterator> iteratorDeleter(iterator);
+
+	WriteLocker locker(inode->Lock());
+	WriteLocker clobberedLocker;
+	if (clobbered != NULL)
+		clobberedLocker.SetTo(clobbered->Lock(), false);
+
+	Transaction transaction(volume);
+	status = transaction.Start();
+	if (status == B_OK)
+		status = oldDirectory->SaveState(transaction);
+	if (status == B_OK)
+		status = newDirectory->SaveState(transaction);
+	if (status == B_OK)
+		status = inode->SaveState(transaction);
+	if (status == B_OK && clobbered != NULL)
+		status = clobbered->SaveState(transaction);
+	if (status != B_OK)
+		return status;
+
+	xfs_ino_t id;
+	status = oldIterator->RemoveEntry(transaction, oldName, strlen(oldName),
+		id);
+	if (status != B_OK)
+		return status;
+
+	struct timespec now = current_time();
+	if (clobbered != NULL) {
+		status = newIterator->ReplaceEntry(transaction, newName,
+			strlen(newName), inode->ID(), inode->XfsModeToFtype(), id);
+		if (status == B_OK)
+			status = drop_link(transaction, newDirectory, clobbered);
+		if (status == B_OK) {
+			clobbered->SetChangeTime(now);
+			status = clobbered->WriteBack(transaction);
+		}
+	} else {
+		status = newIterator->AddEntry(transaction, newName, strlen(newName),
+			inode->ID(), inode->XfsModeToFtype());
+	}
+	if (status != B_OK)
+		return status;
+
+	if (iterator != NULL) {
+		status = iterator->ReplaceEntry(transaction, "..", 2,
+			newDirectory->ID(), XFS_DIR3_FT_DIR, id);
+		if (status != B_OK)
+			return status;
+
+		oldDirectory->SetLinkCount(oldDirectory->NLink() - 1);
+		newDirectory->SetLinkCount(newDirectory->NLink() + 1);
+	}
+
+	oldDirectory->SetModificationTime(now);
+	oldDirectory->SetChangeTime(now);
+	newDirectory->SetModificationTime(now);
+	newDirectory->SetChangeTime(now);
+	inode->SetChangeTime(now);
+
+	status = inode->WriteBack(transaction);
+	if (status == B_OK)
+		status = oldDirectory->WriteBack(transaction);
+	if (status == B_OK)
+		status = newDirectory->WriteBack(transaction);
+	if (status == B_OK)
+		status = transaction.Commit();
+
+	return status;
+}
+
+
+static status_t
+xfs_create(fs_volume *_volume, fs_vnode *_directory, const char *name,
+	int openMode, int perms, void **_cookie, ino_t *_vnodeID)
+{
+	TRACE("XFS_CREATE: %s\n", name);
+	Volume* volume = (Volume*)_volume->private_volume;
+	Inode* directory = (Inode*)_directory->private_node;
+
+	if (!directory->IsDirectory())
+		return B_NOT_A_DIRECTORY;
+
+	status_t status = check_entry_name(name);
+	if (status == B_OK)
+		status = directory->CheckPermissions(X_OK);
+	if (status != B_OK)
+		return status;
+
+	MutexLocker directoryLocker(volume->DirectoryLock());
+	WriteLocker locker(directory->Lock());
+
+	DirectoryIterator* iterator = DirectoryIterator::Init(directory);
+	if (iterator == NULL)
+		return B_BAD_VALUE;
+	ObjectDeleter<DirectoryIterator> iteratorDeleter(iterator);
+
+	xfs_ino_t id;
+	status = iterator->Lookup(name, strlen(name), &id);
+	if (status == B_OK) {
+		if ((openMode & O_EXCL) != 0)
+			return B_FILE_EXISTS;
+
+		// the existing file is opened instead
+		Inode* inode;
+		status = get_vnode(volume->FSVolume(), id, (void**)&inode);
+		if (status != B_OK)
+			return status;
+
+		fs_vnode node;
+		node.private_node = inode;
+		node.ops = &gxfsVnodeOps;
+		status = inode->IsDirectory()
+			? B_IS_A_DIRECTORY : xfs_open(_volume, &node, openMode, _cookie);
+		if (status != B_OK) {
+			put_vnode(volume->FSVolume(), id);
+			return status;
+		}
+
+		*_vnodeID = id;
+		return B_OK;
+	}
+	if (status != B_ENTRY_NOT_FOUND)
+		return status;
+
+	status = directory->CheckPermissions(W_OK);
+	if (status != B_OK)
+		return status;
+
+	// the new file can always be written to through this cookie, no matter
+	// its permissions
+	file_cookie* cookie = new(std::nothrow) file_cookie;
+	if (cookie == NULL)
+		return B_NO_MEMORY;
+	ObjectDeleter<file_cookie> cookieDeleter(cookie);
+
+	Inode* inode;
+	status = create_inode(volume, directory, iterator, name,
+		S_IFREG | (perms & S_IUMSK), inode);
+	if (status != B_OK)
+		return status;
+
+	id = inode->ID();
+	status = publish_vnode(volume->FSVolume(), id, inode, &gxfsVnodeOps,
+		inode->Mode(), 0);
+	if (status != B_OK) {
+		ERROR("create: could not publish inode %" B_PRIu64 ": %s\n", id,
+			strerror(status));
+		delete inode;
+		return status;
+	}
+
+	status = inode->CreateFileCache();
+	if (status != B_OK) {
+		put_vnode(volume->FSVolume(), id);
+		return status;
+	}
+
+	cookie->open_mode = openMode & XFS_OPEN_MODE_USER_MASK;
+	cookie->last_size = 0;
+	cookie->last_notification = system_time();
+
+	*_cookie = cookieDeleter.Detach();
+	*_vnodeID = id;
+
+	notify_entry_created(volume->ID(), directory->ID(), name, id);
+	return B_OK;
+}
+
+
+static status_t
 xfs_unlink(fs_volume *_volume, fs_vnode *_directory, const char *name)
 {
-	return B_NOT_SUPPORTED;
+	TRACE("XFS_UNLINK: %s\n", name);
+	Volume* volume = (Volume*)_volume->private_volume;
+	Inode* directory = (Inode*)_directory->private_node;
+
+	return remove_entry(volume, directory, name, false);
+}
+
+
+static status_t
+xfs_rename(fs_volume *_volume, fs_vnode *_oldDir, const char *oldName,
+	fs_vnode *_newDir, const char *newName)
+{
+	TRACE("XFS_RENAME: %s -> %s\n", oldName, newName);
+	Volume* volume = (Volume*)_volume->private_volume;
+	Inode* oldDirectory = (Inode*)_oldDir->private_node;
+	Inode* newDirectory = (Inode*)_newDir->private_node;
+
+	if (!oldDirectory->IsDirectory() || !newDirectory->IsDirectory())
+		return B_NOT_A_DIRECTORY;
+	if (strcmp(oldName, ".") == 0 || strcmp(oldName, "..") == 0)
+		return B_NOT_ALLOWED;
+
+	status_t status = check_entry_name(newName);
+	if (status == B_OK)
+		status = oldDirectory->CheckPermissions(W_OK | X_OK);
+	if (status == B_OK)
+		status = newDirectory->CheckPermissions(W_OK | X_OK);
+	if (status != B_OK)
+		return status;
+
+	MutexLocker directoryLocker(volume->DirectoryLock());
+	WriteLocker oldLocker(oldDirectory->Lock());
+	WriteLocker newLocker;
+	if (newDirectory != oldDirectory)
+		newLocker.SetTo(newDirectory->Lock(), false);
+
+	DirectoryIterator* oldIterator = DirectoryIterator::Init(oldDirectory);
+	DirectoryIterator* newIterator = DirectoryIterator::Init(newDirectory);
+	ObjectDeleter<DirectoryIterator> oldIteratorDeleter(oldIterator);
+	ObjectDeleter<DirectoryIterator> newIteratorDeleter(newIterator);
+	if (oldIterator == NULL || newIterator == NULL)
+		return B_BAD_VALUE;
+
+	xfs_ino_t id;
+	status = oldIterator->Lookup(oldName, strlen(oldName), &id);
+	if (status != B_OK)
+		return status;
+
+	xfs_ino_t clobberedID;
+	status = newIterator->Lookup(newName, strlen(newName), &clobberedID);
+	if (status == B_ENTRY_NOT_FOUND)
+		clobberedID = 0;
+	else if (status != B_OK)
+		return status;
+	else if (clobberedID == id) {
+		// both entries refer to the same inode already
+		return B_OK;
+	}
+
+	Inode* inode;
+	status = get_vnode(volume->FSVolume(), id, (void**)&inode);
+	if (status != B_OK)
+		return status;
+
+	Inode* clobbered = NULL;
+	if (clobberedID != 0) {
+		status = get_vnode(volume->FSVolume(), clobberedID,
+			(void**)&clobbered);
+		if (status != B_OK) {
+			put_vnode(volume->FSVolume(), id);
+			return status;
+		}
+	}
+
+	status = move_inode(volume, oldDirectory, oldIterator, oldName,
+		newDirectory, newIterator, newName, inode, clobbered);
+
+	if (clobbered != NULL) {
+		if (status == B_OK && clobbered->NLink() == 0)
+			remove_vnode(volume->FSVolume(), clobberedID);
+		put_vnode(volume->FSVolume(), clobberedID);
+	}
+	put_vnode(volume->FSVolume(), id);
+
+	if (status == B_OK) {
+		if (clobbered != NULL) {
+			notify_entry_removed(volume->ID(), newDirectory->ID(), newName,
+				clobberedID);
+		}
+		notify_entry_moved(volume->ID(), oldDirectory->ID(), oldName,
+			newDirectory->ID(), newName, id);
+	}
+
+	return status;
 }
 
 
@@ -376,14 +1206,56 @@ static status_t
 xfs_create_dir(fs_volume *_volume, fs_vnode *_directory, const char *name,
 	int mode)
 {
-	return B_NOT_SUPPORTED;
+	TRACE("XFS_CREATE_DIR: %s\n", name);
+	Volume* volume = (Volume*)_volume->private_volume;
+	Inode* directory = (Inode*)_directory->private_node;
+
+	if (!directory->IsDirectory())
+		return B_NOT_A_DIRECTORY;
+
+	status_t status = check_entry_name(name);
+	if (status == B_OK)
+		status = directory->CheckPermissions(W_OK | X_OK);
+	if (status != B_OK)
+		return status;
+
+	MutexLocker directoryLocker(volume->DirectoryLock());
+	WriteLocker locker(directory->Lock());
+
+	DirectoryIterator* iterator = DirectoryIterator::Init(directory);
+	if (iterator == NULL)
+		return B_BAD_VALUE;
+	ObjectDeleter<DirectoryIterator> iteratorDeleter(iterator);
+
+	xfs_ino_t id;
+	status = iterator->Lookup(name, strlen(name), &id);
+	if (status == B_OK)
+		return B_FILE_EXISTS;
+	if (status != B_ENTRY_NOT_FOUND)
+		return status;
+
+	Inode* inode;
+	status = create_inode(volume, directory, iterator, name,
+		S_IFDIR | (mode & S_IUMSK), inode);
+	if (status != B_OK)
+		return status;
+
+	notify_entry_created(volume->ID(), directory->ID(), name, inode->ID());
+
+	// it has not been published, it is read again once it is used
+	delete inode;
+	return B_OK;
 }
 
 
 static status_t
 xfs_remove_dir(fs_volume *_volume, fs_vnode *_directory, const char *name)
 {
-	return B_NOT_SUPPORTED;
+	TRACE("XFS_REMOVE_DIR: %s\n", name);
+	Volume* volume = (Volume*)_volume->private_volume;
+	Inode* directory = (Inode*)_directory->private_node;
+
+	return remove_entry(volume, directory, name, true);
 }
 
 
@@ -416,6 +1288,9 @@ xfs_read_dir(fs_volume *_volume, fs_vnode *_node, void *_cookie,
 	TRACE("XFS_READ_DIR\n");
 	DirectoryIterator* iterator = (DirectoryIterator*)_cookie;
 	Volume* volume = (Volume*)_volume->private_volume;
+	Inode* inode = (Inode*)_node->private_node;
+
+	ReadLocker locker(inode->Lock());
 
 	uint32 maxCount = *_num;
 	uint32 count = 0;
@@ -728,14 +1603,14 @@ fs_vnode_ops gxfsVnodeOps = {
 	NULL,				// xfs_get_vnode_name- optional, and we can't do better
 						// than the fallback implementation, so leave as NULL.
 	&xfs_put_vnode,
-	NULL, 				// xfs_remove_vnode,
+	&xfs_remove_vnode,
 
 	/* VM file access */
 	&xfs_can_page,
 	&xfs_read_pages,
-	NULL,				// xfs_write_pages,
+	&xfs_write_pages,
 
-	&xfs_io,			// io()
+	NULL,				// io()
 	NULL,				// cancel_io()
 
 	&xfs_get_file_map,
@@ -744,27 +1619,27 @@ fs_vnode_ops gxfsVnodeOps = {
 	NULL,
 	NULL,				// fs_select
 	NULL,				// fs_deselect
-	NULL,				// fs_fsync,
+	&xfs_fsync,
 
 	&xfs_read_link,
 	NULL,				// fs_create_symlink,
 
 	NULL,				// fs_link,
 	&xfs_unlink,
-	NULL,				// fs_rename,
+	&xfs_rename,
 
 	&xfs_access,
 	&xfs_read_stat,
-	NULL,				// fs_write_stat,
-	NULL,				// fs_preallocate
+	&xfs_write_stat,
+	&xfs_preallocate,
 
 	/* file operations */
-	NULL,				// fs_create,
+	&xfs_create,
 	&xfs_open,
 	&xfs_close,
 	&xfs_free_cookie,
 	&xfs_read,
-	NULL,				// fs_write,
+	&xfs_write,
 
 	/* directory operations */
 	&xfs_create_dir,
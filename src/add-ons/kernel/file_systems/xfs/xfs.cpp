@@ -269,6 +269,20 @@ XfsSuperBlock::FreeBlocks() const
 }
 
 
+uint64
+XfsSuperBlock::InodeCount() const
+{
+	return sb_icount;
+}
+
+
+uint64
+XfsSuperBlock::FreeInodes() const
+{
+	return sb_ifree;
+}
+
+
 uint64
 XfsSuperBlock::UsedBlocks() const
 {
@@ -318,6 +332,152 @@ XfsSuperBlock::MagicNum() const
 }
 
 
+uint16
+XfsSuperBlock::SectorSize() const
+{
+	return sb_sectsize;
+}
+
+
+xfs_fsblock_t
+XfsSuperBlock::LogStart() const
+{
+	return sb_logstart;
+}
+
+
+xfs_extlen_t
+XfsSuperBlock::LogBlocks() const
+{
+	return sb_logblocks;
+}
+
+
+uint16
+XfsSuperBlock::LogSectorSize() const
+{
+	return sb_logsectsize;
+}
+
+
+uint32
+XfsSuperBlock::LogStripeUnit() const
+{
+	return sb_logsunit;
+}
+
+
+bool
+XfsSuperBlock::HasLogV2() const
+{
+	return IsVersion5() || (Version() & XFS_SB_VERSION_LOGV2BIT) != 0;
+}
+
+
+bool
+XfsSuperBlock::HasAlign() const
+{
+	return IsVersion5() || (Version() & XFS_SB_VERSION_ALIGNBIT) != 0;
+}
+
+
+bool
+XfsSuperBlock::HasLazyCounters() const
+{
+	if (IsVersion5())
+		return true;
+	return (Version() & XFS_SB_VERSION_MOREBITSBIT) != 0
+		&& (Features2() & XFS_SB_VERSION2_LAZYSBCOUNTBIT) != 0;
+}
+
+
+xfs_extlen_t
+XfsSuperBlock::InodeAlignment() const
+{
+	return sb_inoalignmt;
+}
+
+
+uint16
+XfsSuperBlock::InodesPerBlock() const
+{
+	return sb_inopblock;
+}
+
+
+uint8
+XfsSuperBlock::InodeLog() const
+{
+	return sb_inodelog;
+}
+
+
+uint16
+XfsSuperBlock::QuotaFlags() const
+{
+	return sb_qflags;
+}
+
+
+xfs_rfsblock_t
+XfsSuperBlock::RealtimeBlocks() const
+{
+	return sb_rblocks;
+}
+
+
+uint32
+XfsSuperBlock::ReadOnlyCompatFeatures() const
+{
+	return IsVersion5() ? sb_features_ro_compat : 0;
+}
+
+
+uint32
+XfsSuperBlock::IncompatFeatures() const
+{
+	return IsVersion5() ? sb_features_incompat : 0;
+}
+
+
+uint32
+XfsSuperBlock::LogIncompatFeatures() const
+{
+	return IsVersion5() ? sb_features_log_incompat : 0;
+}
+
+
+const uuid_t&
+XfsSuperBlock::Uuid() const
+{
+	return sb_uuid;
+}
+
+
+const uuid_t&
+XfsSuperBlock::MetaUuid() const
+{
+	if ((sb_features_incompat & XFS_SB_FEAT_INCOMPAT_META_UUID) != 0)
+		return sb_meta_uuid;
+	return sb_uuid;
+}
+
+
+void
+XfsSuperBlock::SetFreeBlocks(uint64 count)
+{
+	sb_fdblocks = count;
+}
+
+
+void
+XfsSuperBlock::SetInodeCounts(uint64 count, uint64 free)
+{
+	sb_icount = count;
+	sb_ifree = free;
+}
+
+
 bool
 XfsSuperBlock::UuidEquals(const uuid_t& u1)
 {
@@ -78,6 +78,8 @@ public:
 			xfs_rfsblock_t		TotalBlocks() const;
 			xfs_rfsblock_t		TotalBlocksWithLog() const;
 			uint64				FreeBlocks() const;
+			uint64				InodeCount() const;
+			uint64				FreeInodes() const;
 			uint64				UsedBlocks() const;
 			uint32				Size() const;
 			uint16				InodeSize() const;
@@ -90,8 +92,37 @@ public:
 			uint32				Features2() const;
 			uint32				Crc() const;
 			uint32				MagicNum() const;
+			uint16				SectorSize() const;
+			xfs_fsblock_t		LogStart() const;
+				// 0 for an external log
+			xfs_extlen_t		LogBlocks() const;
+			uint16				LogSectorSize() const;
+			uint32				LogStripeUnit() const;
+			bool				HasLogV2() const;
+			bool				HasAlign() const;
+			bool				HasLazyCounters() const;
+			xfs_extlen_t		InodeAlignment() const;
+			uint16				InodesPerBlock() const;
+			uint8				InodeLog() const;
+			uint16				QuotaFlags() const;
+			xfs_rfsblock_t		RealtimeBlocks() const;
+			uint32				ReadOnlyCompatFeatures() const;
+			uint32				IncompatFeatures() const;
+			uint32				LogIncompatFeatures() const;
+			const uuid_t&		Uuid() const;
+			const uuid_t&		MetaUuid() const;
+				// the UUID stamped into metadata blocks
+			void				SetFreeBlocks(uint64 count);
+			void				SetInodeCounts(uint64 count,
+									uint64 free);
 	static size_t				Offset_crc()
 								{ return offsetof(XfsSuperBlock, sb_crc);}
+	static size_t				Offset_fdblocks()
+								{ return offsetof(XfsSuperBlock, sb_fdblocks);}
+	static size_t				Offset_icount()
+								{ return offsetof(XfsSuperBlock, sb_icount);}
+	static size_t				Offset_lsn()
+								{ return offsetof(XfsSuperBlock, sb_lsn);}
 private:
 
 			uint32				sb_magicnum;
@@ -165,7 +196,9 @@ private:
 */
 
 
+#define XFS_SB_VERSION_ALIGNBIT 0x0080
 #define XFS_SB_VERSION_SHAREDBIT 0x0200
+#define XFS_SB_VERSION_LOGV2BIT 0x0400
 #define XFS_SB_VERSION_EXTFLGBIT 0x1000
 #define XFS_SB_VERSION_DIRV2BIT 0x2000
 #define XFS_SB_VERSION_MOREBITSBIT 0x4000
@@ -184,6 +217,11 @@ Superblock quota flags - sb_qflags
 #define XFS_GQUOTA_CHKD 0x0100
 #define XFS_PQUOTA_ENFD 0x0200
 #define XFS_PQUOTA_CHKD 0x0400
+#define XFS_UQUOTA_ACCT 0x0001
+#define XFS_GQUOTA_ACCT 0x0040
+#define XFS_PQUOTA_ACCT 0x0008
+#define XFS_ALL_QUOTA_ACCT \
+	(XFS_UQUOTA_ACCT | XFS_GQUOTA_ACCT | XFS_PQUOTA_ACCT)
 
 
 /*
@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2009, Haiku, Inc. All Rights Reserved.
+ * Copyright 2006-2026, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -25,6 +25,7 @@
 #include <net/if_dl.h>
 #include <net/if_media.h>
 #include <net/if_types.h>
+#include <netinet/ip.h>
 #include <new>
 #include <stdlib.h>
 #include <string.h>
@@ -39,6 +40,8 @@ struct ethernet_device : net_device, DoublyLinkedListLinkImpl<ethernet_device> {
 
 	int		fd;
 	uint32	frame_size;
+	uint32	driver_offload;
+		// the ETHER_OFFLOAD_* features enabled in the driver
 
 	void* read_buffer, *write_buffer;
 	mutex read_buffer_lock, write_buffer_lock;
@@ -46,6 +49,8 @@ struct ethernet_device : net_device, DoublyLinkedListLinkImpl<ethernet_device> {
 
 static const bigtime_t kLinkCheckInterval = 1000000;
 	// 1 second
+static const size_t kMaxSegmentationFrameSize = sizeof(ether_offload_header)
+	+ ETHER_HEADER_LENGTH + IP_MAXPACKET;
 
 net_buffer_module_info *gBufferModule;
 static net_stack_module_info *sStackModule;
@@ -127,6 +132,136 @@ ethernet_link_checker(void *)
 }
 
 
+static inline size_t
+offload_header_length(ethernet_device *device)
+{
+	return device->driver_offload != 0 ? sizeof(ether_offload_header) : 0;
+}
+
+
+/*!	Enables the checksum and segmentation offloads the driver supports, and
+	announces them to the stack.
+*/
+static void
+negotiate_offload(ethernet_device *device)
+{
+	// the generic offloads the stack implements itself are kept
+	device->driver_offload = 0;
+	device->offload &= ~(NET_DEVICE_OFFLOAD_RX_CHECKSUM
+		| NET_DEVICE_OFFLOAD_TX_CHECKSUM | NET_DEVICE_OFFLOAD_TSO4
+		| NET_DEVICE_OFFLOAD_TSO6);
+
+	uint32 offload;
+	if (ioctl(device->fd, ETHER_GET_OFFLOAD, &offload, sizeof(offload)) < 0)
+		return;
+
+	// the segments need their checksums computed by the driver as well
+	if ((offload & ETHER_OFFLOAD_TX_CHECKSUM) == 0)
+		offload &= ~(ETHER_OFFLOAD_TSO4 | ETHER_OFFLOAD_TSO6);
+	if (offload == 0
+		|| ioctl(device->fd, ETHER_SET_OFFLOAD, &offload, sizeof(offload)) < 0)
+		return;
+
+	device->driver_offload = offload;
+
+	if ((offload & ETHER_OFFLOAD_RX_CHECKSUM) != 0)
+		device->offload |= NET_DEVICE_OFFLOAD_RX_CHECKSUM;
+	if ((offload & ETHER_OFFLOAD_TX_CHECKSUM) != 0)
+		device->offload |= NET_DEVICE_OFFLOAD_TX_CHECKSUM;
+	if ((offload & ETHER_OFFLOAD_TSO4) != 0)
+		device->offload |= NET_DEVICE_OFFLOAD_TSO4;
+	if ((offload & ETHER_OFFLOAD_TSO6) != 0)
+		device->offload |= NET_DEVICE_OFFLOAD_TSO6;
+}
+
+
+/*!	Prepends the header that tells the driver which checksum and
+	segmentation work is left to it.
+*/
+static status_t
+prepend_offload_header(net_buffer *buffer)
+{
+	ether_offload_header header;
+	memset(&header, 0, sizeof(header));
+
+	if ((buffer->offload_flags & NET_BUFFER_CHECKSUM_PARTIAL) != 0) {
+		header.flags = ETHER_OFFLOAD_NEEDS_CHECKSUM;
+		header.checksum_start = buffer->size - buffer->transport_size;
+		header.checksum_offset = buffer->checksum_offset;
+	}
+
+	if ((buffer->offload_flags & NET_BUFFER_SEGMENT_TCP) != 0) {
+		uint8 version;
+		uint8 transportHeaderLength;
+		if (gBufferModule->read(buffer, ETHER_HEADER_LENGTH, &version,
+				sizeof(version)) != B_OK
+			|| gBufferModule->read(buffer, header.checksum_start + 12,
+				&transportHeaderLength, sizeof(transportHeaderLength))
+					!= B_OK)
+			return B_BAD_DATA;
+
+		header.segmentation = (version >> 4) == 6
+			? ETHER_OFFLOAD_SEGMENT_TCP6 : ETHER_OFFLOAD_SEGMENT_TCP4;
+		header.header_length = header.checksum_start
+			+ ((transportHeaderLength >> 4) << 2);
+		header.segment_size = buffer->segment_size;
+	}
+
+	return gBufferModule->prepend(buffer, &header, sizeof(header));
+}
+
+
+/*!	Writes the buffer to the driver; it is left to the caller either way.
+*/
+static status_t
+write_frame(ethernet_device *device, net_buffer *buffer)
+{
+	net_buffer *allocated = NULL;
+	net_buffer *original = buffer;
+
+	MutexLocker bufferLocker;
+	struct iovec iovec;
+	if (gBufferModule->count_iovecs(buffer) > 1) {
+		if (device->write_buffer != NULL) {
+			bufferLocker.SetTo(device->write_buffer_lock, false);
+
+			status_t status = gBufferModule->read(buffer, 0,
+				device->write_buffer, buffer->size);
+			if (status != B_OK)
+				return status;
+			iovec.iov_base = device->write_buffer;
+			iovec.iov_len = buffer->size;
+		} else {
+			// Fall back to creating a new buffer.
+			allocated = gBufferModule->duplicate(original);
+			if (allocated == NULL)
+				return ENOBUFS;
+
+			buffer = allocated;
+
+			if (gBufferModule->count_iovecs(allocated) > 1) {
+				dprintf("ethernet_send_data: no write buffer, cannot perform scatter I/O\n");
+				gBufferModule->free(allocated);
+				return EMSGSIZE;
+			}
+
+			gBufferModule->get_iovecs(buffer, &iovec, 1);
+		}
+	} else {
+		gBufferModule->get_iovecs(buffer, &iovec, 1);
+	}
+
+//dump_block((const char *)iovec.iov_base, buffer->size, "  ");
+	ssize_t bytesWritten = write(device->fd, iovec.iov_base, iovec.iov_len);
+//dprintf("sent: %ld\n", bytesWritten);
+
+	status_t status = bytesWritten < 0 ? errno : B_OK;
+	if (allocated)
+		gBufferModule->free(allocated);
+	return status;
+}
+
+
 //	#pragma mark -
 
 
@@ -225,12 +360,21 @@ ethernet_up(net_device *_device)
 		sCheckList.Add(device);
 	}
 
-	if (device->frame_size > ETHER_MAX_FRAME_SIZE) {
+	negotiate_offload(device);
+
+	if (device->frame_size > ETHER_MAX_FRAME_SIZE
+		|| device->driver_offload != 0) {
 		free(device->read_buffer);
 		free(device->write_buffer);
 
-		device->read_buffer = malloc(device->frame_size);
-		device->write_buffer = malloc(device->frame_size);
+		size_t writeSize = device->frame_size + offload_header_length(device);
+		if ((device->driver_offload
+				& (ETHER_OFFLOAD_TSO4 | ETHER_OFFLOAD_TSO6)) != 0)
+			writeSize = kMaxSegmentationFrameSize;
+
+		device->read_buffer = malloc(device->frame_size
+			+ offload_header_length(device));
+		device->write_buffer = malloc(writeSize);
 
 		if (device->read_buffer == NULL || device->write_buffer == NULL) {
 			errno = B_NO_MEMORY;
@@ -284,57 +428,27 @@ ethernet_send_data(net_device *_device, net_buffer *buffer)
 	ethernet_device *device = (ethernet_device *)_device;
 
 //dprintf("try to send ethernet packet of %lu bytes (flags %ld):\n", buffer->size, buffer->flags);
-	if (buffer->size > device->frame_size || buffer->size < ETHER_HEADER_LENGTH)
+	uint32 maxSize = device->frame_size;
+	if ((buffer->offload_flags & NET_BUFFER_SEGMENT_TCP) != 0)
+		maxSize = kMaxSegmentationFrameSize - sizeof(ether_offload_header);
+	if (buffer->size > maxSize || buffer->size < ETHER_HEADER_LENGTH)
 		return B_BAD_VALUE;
 
-	net_buffer *allocated = NULL;
-	net_buffer *original = buffer;
-
-	MutexLocker bufferLocker;
-	struct iovec iovec;
-	if (gBufferModule->count_iovecs(buffer) > 1) {
-		if (device->write_buffer != NULL) {
-			bufferLocker.SetTo(device->write_buffer_lock, false);
-
-			status_t status = gBufferModule->read(buffer, 0,
-				device->write_buffer, buffer->size);
-			if (status != B_OK)
-				return status;
-			iovec.iov_base = device->write_buffer;
-			iovec.iov_len = buffer->size;
-		} else {
-			// Fall back to creating a new buffer.
-			allocated = gBufferModule->duplicate(original);
-			if (allocated == NULL)
-				return ENOBUFS;
-
-			buffer = allocated;
-
-			if (gBufferModule->count_iovecs(allocated) > 1) {
-				dprintf("ethernet_send_data: no write buffer, cannot perform scatter I/O\n");
-				gBufferModule->free(allocated);
-				return EMSGSIZE;
-			}
-
-			gBufferModule->get_iovecs(buffer, &iovec, 1);
-		}
-	} else {
-		gBufferModule->get_iovecs(buffer, &iovec, 1);
+	if (device->driver_offload != 0) {
+		status_t status = prepend_offload_header(buffer);
+		if (status != B_OK)
+			return status;
 	}
 
-//dump_block((const char *)iovec.iov_base, buffer->size, "  ");
-	ssize_t bytesWritten = write(device->fd, iovec.iov_base, iovec.iov_len);
-//dprintf("sent: %ld\n", bytesWritten);
-
-	if (bytesWritten < 0) {
-		if (allocated)
-			gBufferModule->free(allocated);
-		return errno;
+	status_t status = write_frame(device, buffer);
+	if (status != B_OK) {
+		// the caller still owns the buffer
+		if (device->driver_offload != 0)
+			gBufferModule->remove_header(buffer, sizeof(ether_offload_header));
+		return status;
 	}
 
-	gBufferModule->free(original);
-	if (allocated)
-		gBufferModule->free(allocated);
+	gBufferModule->free(buffer);
 	return B_OK;
 }
 
@@ -360,7 +474,7 @@ ethernet_receive_data(net_device *_device, net_buffer **_buffer)
 		bufferLocker.SetTo(device->read_buffer_lock, false);
 
 		iovec.iov_base = device->read_buffer;
-		iovec.iov_len = device->frame_size;
+		iovec.iov_len = device->frame_size + offload_header_length(device);
 	} else {
 		void *data;
 		status = gBufferModule->append_size(buffer, device->frame_size, &data);
@@ -382,7 +496,24 @@ ethernet_receive_data(net_device *_device, net_buffer **_buffer)
 	}
 //dump_block((const char *)data, bytesRead, "rcv: ");
 
-	if (iovec.iov_base == device->read_buffer)
+	if (device->driver_offload != 0) {
+		// the read buffer always exists in this case
+		const ether_offload_header *header
+			= (const ether_offload_header *)iovec.iov_base;
+		if (bytesRead < (ssize_t)sizeof(ether_offload_header)) {
+			status = B_BAD_DATA;
+			goto err;
+		}
+
+		if ((header->flags & ETHER_OFFLOAD_CHECKSUM_VALID) != 0)
+			buffer->offload_flags |= NET_BUFFER_CHECKSUM_VALID;
+
+		iovec.iov_base = (uint8 *)iovec.iov_base
+			+ sizeof(ether_offload_header);
+		bytesRead -= sizeof(ether_offload_header);
+	}
+
+	if (device->read_buffer != NULL)
 		status = gBufferModule->append(buffer, iovec.iov_base, bytesRead);
 	else
 		status = gBufferModule->trim(buffer, bytesRead);
@@ -470,6 +601,41 @@ ethernet_remove_multicast(struct net_device *_device, const sockaddr *_address)
 }
 
 
+status_t
+ethernet_attach_packet_ring(net_device *_device, uint32 queue,
+	net_device_packet_ring *ring)
+{
+	ethernet_device *device = (ethernet_device *)_device;
+
+	// the driver puts raw frames into the ring, without any offload header
+	ether_packet_ring driverRing;
+	driverRing.queue = queue;
+	driverRing.descriptors = ring->descriptors;
+	driverRing.size = ring->size;
+	driverRing.index = ring->index;
+	driverRing.dropped = ring->dropped;
+	driverRing.notify = ring->notify;
+	driverRing.cookie = ring->cookie;
+	driverRing.frame_area = -1;
+
+	if (ioctl(device->fd, ETHER_ATTACH_PACKET_RING, &driverRing,
+			sizeof(driverRing)) < 0)
+		return errno == B_DEV_INVALID_IOCTL ? B_NOT_SUPPORTED : errno;
+
+	ring->frame_area = driverRing.frame_area;
+	return B_OK;
+}
+
+
+void
+ethernet_detach_packet_ring(net_device *_device, uint32 queue)
+{
+	ethernet_device *device = (ethernet_device *)_device;
+
+	ioctl(device->fd, ETHER_DETACH_PACKET_RING, &queue, sizeof(queue));
+}
+
+
 static status_t
 ethernet_std_ops(int32 op, ...)
 {
@@ -533,6 +699,10 @@ net_device_module_info sEthernetModule = {
 	ethernet_set_media,
 	ethernet_add_multicast,
 	ethernet_remove_multicast,
+	NULL,	// send_queue_data
+	NULL,	// receive_queue_data
+	ethernet_attach_packet_ring,
+	ethernet_detach_packet_ring,
 };
 
 module_info *modules[] = {
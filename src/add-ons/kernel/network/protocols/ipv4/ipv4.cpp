@@ -1421,6 +1421,10 @@ ipv4_setsockopt(net_protocol* _protocol, int level, int option,
 		return ENOPROTOOPT;
 	}
 
+	if (level == SOL_SOCKET && protocol->raw != NULL
+		&& (option == SO_ATTACH_FILTER || option == SO_DETACH_FILTER))
+		return protocol->raw->SetFilter(option, value, length);
+
 	return sSocketModule->set_option(protocol->socket, level, option,
 		value, length);
 }
@@ -1568,6 +1572,11 @@ ipv4_send_routed_data(net_protocol* _protocol, struct net_route* route,
 		net_buffer *loopbackBuffer = gBufferModule->duplicate(buffer);
 		if (loopbackBuffer == NULL)
 			return B_NO_MEMORY;
+		if ((loopbackBuffer->offload_flags & NET_BUFFER_CHECKSUM_PARTIAL)
+				!= 0) {
+			// the checksum is left to the device, but not needed locally
+			loopbackBuffer->offload_flags = NET_BUFFER_CHECKSUM_VALID;
+		}
 		status_t status = B_ERROR;
 
 		// get the IPv4 loopback address
@@ -1599,7 +1608,8 @@ ipv4_send_routed_data(net_protocol* _protocol, struct net_route* route,
 		ntohl(destination.sin_addr.s_addr));
 
 	uint32 mtu = route->mtu ? route->mtu : interface->device->mtu;
-	if (buffer->size > mtu) {
+	if (buffer->size > mtu
+		&& (buffer->offload_flags & NET_BUFFER_SEGMENT_TCP) == 0) {
 		// we need to fragment the packet
 		return send_fragments(protocol, route, buffer, mtu);
 	}
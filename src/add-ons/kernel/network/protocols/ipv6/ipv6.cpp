@@ -1191,6 +1191,10 @@ ipv6_setsockopt(net_protocol* _protocol, int level, int option,
 		return ENOPROTOOPT;
 	}
 
+	if (level == SOL_SOCKET && protocol->raw != NULL
+		&& (option == SO_ATTACH_FILTER || option == SO_DETACH_FILTER))
+		return protocol->raw->SetFilter(option, value, length);
+
 	return sSocketModule->set_option(protocol->socket, level, option,
 		value, length);
 }
@@ -1343,7 +1347,8 @@ ipv6_send_routed_data(net_protocol* _protocol, struct net_route* route,
 	TRACE_SK(protocol, "  SendRoutedData(): destination: %s", addrbuf);
 
 	uint32 mtu = route->mtu ? route->mtu : interface->device->mtu;
-	if (buffer->size > mtu) {
+	if (buffer->size > mtu
+		&& (buffer->offload_flags & NET_BUFFER_SEGMENT_TCP) == 0) {
 		// we need to fragment the packet
 		return send_fragments(protocol, route, buffer, mtu);
 	}
@@ -0,0 +1,350 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "BBRCongestionControl.h"
+
+#include <string.h>
+
+#include <KernelExport.h>
+
+
+// References:
+//	- Cardwell et al., "BBR: Congestion-Based Congestion Control",
+//	  ACM Queue, vol. 14, no. 5, 2016
+//	- draft-cardwell-iccrg-bbr-congestion-control-00
+//
+// Differences to the published algorithm, as there is neither pacing nor
+// per packet delivery information:
+//	- The delivery rate is sampled once per round trip, as the data
+//	  delivered during the round divided by its duration.
+//	- The gains are applied to the window only; in PROBE_BW, the pacing gain
+//	  cycle modulates the window gain of 2.
+//	- Application limited rounds are not detected.
+
+static const uint32 kHighGain = 289;
+	// 2 / ln(2), in percent; doubles the delivery rate each round trip
+static const uint32 kWindowGain = 200;
+static const uint32 kCycleGains[] = {125, 75, 100, 100, 100, 100, 100, 100};
+static const int32 kCycleLength = sizeof(kCycleGains) / sizeof(kCycleGains[0]);
+static const int32 kFullBandwidthRounds = 3;
+static const uint32 kMinWindowSegments = 4;
+static const bigtime_t kMinRoundTripTimeExpiry = 10000000;
+static const bigtime_t kProbeRoundTripTimeDuration = 200000;
+static const bigtime_t kMinRoundTripTimeResolution = 1000;
+	// TCP times are only measured in milliseconds
+
+
+BBRCongestionControl::BBRCongestionControl(uint32& window, uint32& threshold)
+	:
+	CongestionControl(window, threshold),
+	fMode(STARTUP),
+	fFullBandwidth(0),
+	fFullBandwidthCount(0),
+	fFilledPipe(false),
+	fLastDelivered(0),
+	fDelivered(0),
+	fRoundStartDelivered(0),
+	fNextRoundDelivered(0),
+	fRoundStart(0),
+	fRoundCount(0),
+	fMinRoundTripTime(0),
+	fMinRoundTripTimeStamp(0),
+	fProbeRoundTripTimeDone(0),
+	fProbeRoundTripTimeRoundDone(false),
+	fCycleIndex(0),
+	fCycleStart(0),
+	fPriorWindow(0)
+{
+	memset(fBandwidthSamples, 0, sizeof(fBandwidthSamples));
+}
+
+
+const char*
+BBRCongestionControl::Name() const
+{
+	return "bbr";
+}
+
+
+void
+BBRCongestionControl::Start()
+{
+	CongestionControl::Start();
+
+	// the slow start threshold has no meaning for BBR
+	fThreshold = UINT32_MAX;
+}
+
+
+void
+BBRCongestionControl::Acknowledged(uint32 bytesAcknowledged,
+	uint32 flightSize, bigtime_t now)
+{
+	if (fMode == PROBE_RTT) {
+		fWindow = min_c(fWindow, _MinWindow());
+		return;
+	}
+
+	uint32 target = TargetWindow();
+	if (target == 0) {
+		// there is no model of the path yet
+		fWindow += bytesAcknowledged;
+		return;
+	}
+
+	if (fFilledPipe)
+		fWindow = min_c(fWindow + bytesAcknowledged, target);
+	else if (fWindow < target)
+		fWindow += bytesAcknowledged;
+
+	fWindow = max_c(fWindow, _MinWindow());
+}
+
+
+void
+BBRCongestionControl::Delivered(uint32 delivered, uint32 flightSize,
+	bigtime_t now)
+{
+	if (fRoundStart == 0) {
+		fLastDelivered = delivered;
+		fRoundStart = now;
+		fNextRoundDelivered = flightSize;
+		return;
+	}
+
+	int32 newlyDelivered = (int32)(delivered - fLastDelivered);
+	fLastDelivered = delivered;
+	if (newlyDelivered <= 0) {
+		// nothing new, or the SACK information has been discarded
+		return;
+	}
+
+	fDelivered += newlyDelivered;
+	if (fDelivered >= fNextRoundDelivered)
+		_RoundTripEnded(flightSize, now);
+
+	_UpdateMode(flightSize, now);
+}
+
+
+void
+BBRCongestionControl::RoundTripTimeSample(bigtime_t roundTripTime,
+	bigtime_t now)
+{
+	if (roundTripTime < kMinRoundTripTimeResolution)
+		roundTripTime = kMinRoundTripTimeResolution;
+
+	bool expired = fMinRoundTripTimeStamp != 0
+		&& now - fMinRoundTripTimeStamp > kMinRoundTripTimeExpiry;
+	if (expired && fMode != PROBE_RTT)
+		_EnterProbeRoundTripTime(now);
+
+	if (fMinRoundTripTime == 0 || roundTripTime <= fMinRoundTripTime
+		|| expired) {
+		fMinRoundTripTime = roundTripTime;
+		fMinRoundTripTimeStamp = now;
+	}
+}
+
+
+void
+BBRCongestionControl::LossDetected(uint32 flightSize, bigtime_t now)
+{
+	// losses don't change the model; just keep the data in flight that
+	// has not been lost
+	fPriorWindow = fWindow;
+	fThreshold = max_c(flightSize, _MinWindow());
+}
+
+
+void
+BBRCongestionControl::RecoveryFinished(uint32 flightSize)
+{
+	fWindow = max_c(fWindow, fPriorWindow);
+	fThreshold = UINT32_MAX;
+}
+
+
+void
+BBRCongestionControl::RetransmitTimeout(uint32 flightSize)
+{
+	fPriorWindow = fWindow;
+	fWindow = fMaxSegmentSize;
+}
+
+
+void
+BBRCongestionControl::Dump() const
+{
+	static const char* kModes[] = {"startup", "drain", "probe bw",
+		"probe rtt"};
+
+	CongestionControl::Dump();
+	kprintf("    mode: %s%s, round %" B_PRIu32 ", cycle %" B_PRId32 "\n",
+		kModes[fMode], fFilledPipe ? " (filled pipe)" : "", fRoundCount,
+		fCycleIndex);
+	kprintf("    bandwidth: %" B_PRIu64 " bytes/s, min rtt: %" B_PRIdBIGTIME
+		" usecs, target window: %" B_PRIu32 "\n", Bandwidth(),
+		fMinRoundTripTime, TargetWindow());
+}
+
+
+/*!	Returns the estimated bottleneck bandwidth in bytes per second. */
+uint64
+BBRCongestionControl::Bandwidth() const
+{
+	uint64 bandwidth = 0;
+	for (int32 i = 0; i < kBandwidthRounds; i++) {
+		if (fBandwidthSamples[i] > bandwidth)
+			bandwidth = fBandwidthSamples[i];
+	}
+
+	return bandwidth;
+}
+
+
+/*!	Returns the window the current mode aims for, or 0 if the path has not
+	been measured yet.
+*/
+uint32
+BBRCongestionControl::TargetWindow() const
+{
+	if (fMode == PROBE_RTT)
+		return _MinWindow();
+
+	uint64 bandwidth = Bandwidth();
+	if (bandwidth == 0 || fMinRoundTripTime == 0)
+		return 0;
+
+	uint64 gain;
+	switch (fMode) {
+		case STARTUP:
+			gain = kHighGain;
+			break;
+		case DRAIN:
+			gain = 100;
+			break;
+		default:
+			gain = kWindowGain * kCycleGains[fCycleIndex] / 100;
+			break;
+	}
+
+	uint64 target = bandwidth * fMinRoundTripTime / 1000000 * gain / 100;
+	if (target < _MinWindow())
+		return _MinWindow();
+	if (target > UINT32_MAX)
+		return UINT32_MAX;
+
+	return (uint32)target;
+}
+
+
+void
+BBRCongestionControl::_RoundTripEnded(uint32 flightSize, bigtime_t now)
+{
+	bigtime_t elapsed = now - fRoundStart;
+	if (elapsed > 0) {
+		fBandwidthSamples[fRoundCount % kBandwidthRounds]
+			= (fDelivered - fRoundStartDelivered) * 1000000 / elapsed;
+	}
+
+	fRoundCount++;
+	fRoundStart = now;
+	fRoundStartDelivered = fDelivered;
+	fNextRoundDelivered = fDelivered + flightSize;
+
+	if (!fFilledPipe)
+		_CheckFullPipe();
+	if (fMode == PROBE_RTT && fProbeRoundTripTimeDone != 0)
+		fProbeRoundTripTimeRoundDone = true;
+}
+
+
+/*!	The pipe is considered full once the bandwidth did not grow by at least
+	25% over three round trips.
+*/
+void
+BBRCongestionControl::_CheckFullPipe()
+{
+	uint64 bandwidth = Bandwidth();
+	if (bandwidth >= fFullBandwidth * 5 / 4) {
+		fFullBandwidth = bandwidth;
+		fFullBandwidthCount = 0;
+		return;
+	}
+
+	if (++fFullBandwidthCount >= kFullBandwidthRounds)
+		fFilledPipe = true;
+}
+
+
+void
+BBRCongestionControl::_UpdateMode(uint32 flightSize, bigtime_t now)
+{
+	if (fMode == STARTUP && fFilledPipe)
+		fMode = DRAIN;
+
+	if (fMode == DRAIN) {
+		// leave once the queue built up during startup has drained
+		uint64 bandwidthDelayProduct
+			= Bandwidth() * fMinRoundTripTime / 1000000;
+		if (flightSize <= bandwidthDelayProduct)
+			_EnterProbeBandwidth(now);
+	} else if (fMode == PROBE_BW) {
+		if (now - fCycleStart > fMinRoundTripTime) {
+			fCycleIndex = (fCycleIndex + 1) % kCycleLength;
+			fCycleStart = now;
+		}
+	} else if (fMode == PROBE_RTT) {
+		if (fProbeRoundTripTimeDone == 0) {
+			if (flightSize <= _MinWindow()) {
+				// hold the window for at least 200 ms, and a round trip
+				fProbeRoundTripTimeDone = now + kProbeRoundTripTimeDuration;
+				fProbeRoundTripTimeRoundDone = false;
+				fNextRoundDelivered = fDelivered;
+			}
+		} else if (fProbeRoundTripTimeRoundDone
+			&& now >= fProbeRoundTripTimeDone) {
+			fMinRoundTripTimeStamp = now;
+			fWindow = max_c(fWindow, fPriorWindow);
+			if (fFilledPipe)
+				_EnterProbeBandwidth(now);
+			else
+				fMode = STARTUP;
+		}
+	}
+}
+
+
+void
+BBRCongestionControl::_EnterProbeBandwidth(bigtime_t now)
+{
+	fMode = PROBE_BW;
+	// start in one of the phases that neither probe nor drain
+	fCycleIndex = 2 + fRoundCount % (kCycleLength - 2);
+	fCycleStart = now;
+}
+
+
+/*!	Reduces the window to a minimum for a short moment, so that the queue
+	at the bottleneck drains, and the propagation delay can be measured
+	again.
+*/
+void
+BBRCongestionControl::_EnterProbeRoundTripTime(bigtime_t now)
+{
+	fMode = PROBE_RTT;
+	fPriorWindow = fWindow;
+	fWindow = min_c(fWindow, _MinWindow());
+	fProbeRoundTripTimeDone = 0;
+}
+
+
+uint32
+BBRCongestionControl::_MinWindow() const
+{
+	return kMinWindowSegments * fMaxSegmentSize;
+}
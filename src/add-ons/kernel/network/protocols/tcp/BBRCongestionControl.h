@@ -0,0 +1,90 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef BBR_CONGESTION_CONTROL_H
+#define BBR_CONGESTION_CONTROL_H
+
+
+#include "CongestionControl.h"
+
+
+/*!	BBR version 1: instead of reacting to losses, it models the path by its
+	bottleneck bandwidth (the maximum delivery rate seen over the last ten
+	round trips), and its round trip propagation delay (the minimum round
+	trip time seen over the last ten seconds), and keeps their product in
+	flight.
+
+	The stack has no packet pacing, so the window is the only control; the
+	pacing gain cycle of PROBE_BW is applied to the window instead.
+*/
+class BBRCongestionControl : public CongestionControl {
+public:
+								BBRCongestionControl(uint32& window,
+									uint32& threshold);
+
+	virtual	const char*			Name() const;
+
+	virtual	void				Start();
+	virtual	void				Acknowledged(uint32 bytesAcknowledged,
+									uint32 flightSize, bigtime_t now);
+	virtual	void				Delivered(uint32 delivered,
+									uint32 flightSize, bigtime_t now);
+	virtual	void				RoundTripTimeSample(bigtime_t roundTripTime,
+									bigtime_t now);
+	virtual	void				LossDetected(uint32 flightSize,
+									bigtime_t now);
+	virtual	void				RecoveryFinished(uint32 flightSize);
+	virtual	void				RetransmitTimeout(uint32 flightSize);
+
+	virtual	void				Dump() const;
+
+			uint64				Bandwidth() const;
+			bigtime_t			MinRoundTripTime() const
+									{ return fMinRoundTripTime; }
+			uint32				TargetWindow() const;
+
+private:
+			enum mode {
+				STARTUP,
+				DRAIN,
+				PROBE_BW,
+				PROBE_RTT
+			};
+
+			void				_RoundTripEnded(uint32 flightSize,
+									bigtime_t now);
+			void				_CheckFullPipe();
+			void				_UpdateMode(uint32 flightSize, bigtime_t now);
+			void				_EnterProbeBandwidth(bigtime_t now);
+			void				_EnterProbeRoundTripTime(bigtime_t now);
+			uint32				_MinWindow() const;
+
+	static	const int32			kBandwidthRounds = 10;
+
+			mode				fMode;
+			uint64				fBandwidthSamples[kBandwidthRounds];
+				// bytes per second, one sample per round trip
+			uint64				fFullBandwidth;
+			int32				fFullBandwidthCount;
+			bool				fFilledPipe;
+
+			uint32				fLastDelivered;
+			uint64				fDelivered;
+			uint64				fRoundStartDelivered;
+			uint64				fNextRoundDelivered;
+			bigtime_t			fRoundStart;
+			uint32				fRoundCount;
+
+			bigtime_t			fMinRoundTripTime;
+			bigtime_t			fMinRoundTripTimeStamp;
+			bigtime_t			fProbeRoundTripTimeDone;
+			bool				fProbeRoundTripTimeRoundDone;
+
+			int32				fCycleIndex;
+			bigtime_t			fCycleStart;
+			uint32				fPriorWindow;
+};
+
+
+#endif	// BBR_CONGESTION_CONTROL_H
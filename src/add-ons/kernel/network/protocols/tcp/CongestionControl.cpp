@@ -0,0 +1,220 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "CongestionControl.h"
+
+#include <new>
+#include <string.h>
+
+#include <KernelExport.h>
+
+#include "BBRCongestionControl.h"
+#include "CubicCongestionControl.h"
+
+
+template<typename Algorithm>
+static CongestionControl*
+create_algorithm(uint32& window, uint32& threshold)
+{
+	return new(std::nothrow) Algorithm(window, threshold);
+}
+
+
+struct congestion_control_algorithm {
+	const char*			name;
+	CongestionControl*	(*create)(uint32& window, uint32& threshold);
+};
+
+static const congestion_control_algorithm kAlgorithms[] = {
+	{"reno", &create_algorithm<RenoCongestionControl>},
+	{"cubic", &create_algorithm<CubicCongestionControl>},
+	{"bbr", &create_algorithm<BBRCongestionControl>},
+};
+static const int32 kAlgorithmCount
+	= sizeof(kAlgorithms) / sizeof(kAlgorithms[0]);
+
+static const congestion_control_algorithm* sDefaultAlgorithm = &kAlgorithms[0];
+
+
+static const congestion_control_algorithm*
+find_algorithm(const char* name)
+{
+	for (int32 i = 0; i < kAlgorithmCount; i++) {
+		if (strcmp(kAlgorithms[i].name, name) == 0)
+			return &kAlgorithms[i];
+	}
+
+	return NULL;
+}
+
+
+//	#pragma mark -
+
+
+CongestionControl::CongestionControl(uint32& window, uint32& threshold)
+	:
+	fWindow(window),
+	fThreshold(threshold),
+	fMaxSegmentSize(TCP_DEFAULT_MAX_SEGMENT_SIZE)
+{
+}
+
+
+CongestionControl::~CongestionControl()
+{
+}
+
+
+/*!	Sets the initial window as specified in RFC 3390. */
+void
+CongestionControl::Start()
+{
+	if (fMaxSegmentSize > 2190)
+		fWindow = 2 * fMaxSegmentSize;
+	else if (fMaxSegmentSize > 1095)
+		fWindow = 3 * fMaxSegmentSize;
+	else
+		fWindow = 4 * fMaxSegmentSize;
+}
+
+
+void
+CongestionControl::Delivered(uint32 delivered, uint32 flightSize,
+	bigtime_t now)
+{
+}
+
+
+void
+CongestionControl::RoundTripTimeSample(bigtime_t roundTripTime, bigtime_t now)
+{
+}
+
+
+void
+CongestionControl::LossDetected(uint32 flightSize, bigtime_t now)
+{
+	fThreshold = _HalvedFlightSize(flightSize);
+}
+
+
+/*!	Leaves fast recovery as described in RFC 6582, without a burst of data
+	in case the flight size has shrunk below the threshold meanwhile.
+*/
+void
+CongestionControl::RecoveryFinished(uint32 flightSize)
+{
+	fWindow = min_c(fThreshold, max_c(flightSize, fMaxSegmentSize)
+		+ fMaxSegmentSize);
+}
+
+
+void
+CongestionControl::RetransmitTimeout(uint32 flightSize)
+{
+	fThreshold = _HalvedFlightSize(flightSize);
+	fWindow = fMaxSegmentSize;
+}
+
+
+void
+CongestionControl::Dump() const
+{
+	kprintf("  congestion control: %s\n", Name());
+}
+
+
+uint32
+CongestionControl::_HalvedFlightSize(uint32 flightSize) const
+{
+	return max_c(flightSize / 2, 2 * fMaxSegmentSize);
+}
+
+
+//	#pragma mark - Reno
+
+
+RenoCongestionControl::RenoCongestionControl(uint32& window,
+	uint32& threshold)
+	:
+	CongestionControl(window, threshold)
+{
+}
+
+
+const char*
+RenoCongestionControl::Name() const
+{
+	return "reno";
+}
+
+
+void
+RenoCongestionControl::Acknowledged(uint32 bytesAcknowledged,
+	uint32 flightSize, bigtime_t now)
+{
+	if (fWindow < fThreshold) {
+		fWindow += min_c(bytesAcknowledged, fMaxSegmentSize);
+		return;
+	}
+
+	uint32 increment = fMaxSegmentSize * fMaxSegmentSize;
+
+	if (increment < fWindow)
+		increment = 1;
+	else
+		increment /= fWindow;
+
+	fWindow += increment;
+}
+
+
+//	#pragma mark -
+
+
+/*!	Creates the congestion control algorithm of the given \a name, or the
+	system wide default, if \a name is \c NULL.
+*/
+status_t
+create_congestion_control(const char* name, uint32& window, uint32& threshold,
+	CongestionControl** _control)
+{
+	const congestion_control_algorithm* algorithm = sDefaultAlgorithm;
+	if (name != NULL) {
+		algorithm = find_algorithm(name);
+		if (algorithm == NULL)
+			return B_ENTRY_NOT_FOUND;
+	}
+
+	CongestionControl* control = algorithm->create(window, threshold);
+	if (control == NULL)
+		return B_NO_MEMORY;
+
+	*_control = control;
+	return B_OK;
+}
+
+
+/*!	Chooses the algorithm new connections use. Must only be called while no
+	connection can be created, ie. during initialization of the module.
+*/
+status_t
+set_default_congestion_control(const char* name)
+{
+	const congestion_control_algorithm* algorithm = find_algorithm(name);
+	if (algorithm == NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	sDefaultAlgorithm = algorithm;
+	return B_OK;
+}
+
+
+const char*
+default_congestion_control()
+{
+	return sDefaultAlgorithm->name;
+}
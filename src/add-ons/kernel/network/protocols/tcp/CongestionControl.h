@@ -0,0 +1,84 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef CONGESTION_CONTROL_H
+#define CONGESTION_CONTROL_H
+
+
+#include "tcp.h"
+
+
+/*!	The congestion control algorithm of a TCP connection. It owns the
+	congestion window and the slow start threshold of the endpoint it
+	belongs to, and adjusts them as the endpoint reports its events.
+	Detecting and repairing losses (fast retransmit, NewReno, SACK recovery)
+	remains the job of the endpoint; the algorithm only decides how fast to
+	send.
+
+	All sizes are in bytes, all times in microseconds. The methods are
+	called with the endpoint lock held.
+*/
+class CongestionControl {
+public:
+								CongestionControl(uint32& window,
+									uint32& threshold);
+	virtual						~CongestionControl();
+
+	virtual	const char*			Name() const = 0;
+
+			void				SetMaxSegmentSize(uint32 maxSegmentSize)
+									{ fMaxSegmentSize = maxSegmentSize; }
+
+	// the connection has been established
+	virtual	void				Start();
+
+	// new data has been acknowledged cumulatively outside of SACK recovery
+	virtual	void				Acknowledged(uint32 bytesAcknowledged,
+									uint32 flightSize, bigtime_t now) = 0;
+	// an acknowledgement arrived; \a delivered counts all bytes the peer
+	// has acknowledged or SACKed so far (modulo 2^32)
+	virtual	void				Delivered(uint32 delivered,
+									uint32 flightSize, bigtime_t now);
+	virtual	void				RoundTripTimeSample(bigtime_t roundTripTime,
+									bigtime_t now);
+
+	// a loss was detected, and fast recovery is entered; only sets the
+	// slow start threshold, the window is then derived by the endpoint
+	virtual	void				LossDetected(uint32 flightSize,
+									bigtime_t now);
+	virtual	void				RecoveryFinished(uint32 flightSize);
+	virtual	void				RetransmitTimeout(uint32 flightSize);
+
+	virtual	void				Dump() const;
+
+protected:
+			uint32				_HalvedFlightSize(uint32 flightSize) const;
+
+protected:
+			uint32&				fWindow;
+			uint32&				fThreshold;
+			uint32				fMaxSegmentSize;
+};
+
+
+/*!	Slow start and congestion avoidance as described in RFC 5681. */
+class RenoCongestionControl : public CongestionControl {
+public:
+								RenoCongestionControl(uint32& window,
+									uint32& threshold);
+
+	virtual	const char*			Name() const;
+
+	virtual	void				Acknowledged(uint32 bytesAcknowledged,
+									uint32 flightSize, bigtime_t now);
+};
+
+
+status_t create_congestion_control(const char* name, uint32& window,
+	uint32& threshold, CongestionControl** _control);
+status_t set_default_congestion_control(const char* name);
+const char* default_congestion_control();
+
+
+#endif	// CONGESTION_CONTROL_H
@@ -0,0 +1,199 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "CubicCongestionControl.h"
+
+#include <KernelExport.h>
+
+
+// References:
+//	- RFC 9438 - CUBIC for Fast and Long-Distance Networks
+//
+// The window function is W(t) = C * (t - K)^3 + W_max, with W in segments
+// and t in seconds. Everything is computed in integer arithmetic with t in
+// milliseconds, and W in bytes.
+
+static const uint32 kBetaPercent = 70;
+	// multiplicative decrease factor
+static const uint32 kFastConvergencePercent = (100 + kBetaPercent) / 2;
+static const uint64 kInverseScaledC = 2500000000ULL;
+	// 1 / C with C = 0.4, scaled by 10^9 for time in milliseconds
+
+
+CubicCongestionControl::CubicCongestionControl(uint32& window,
+	uint32& threshold)
+	:
+	CongestionControl(window, threshold),
+	fMaxWindow(0),
+	fEstimatedWindow(0),
+	fEpochStart(0),
+	fPeriod(0),
+	fMinRoundTripTime(0)
+{
+}
+
+
+const char*
+CubicCongestionControl::Name() const
+{
+	return "cubic";
+}
+
+
+void
+CubicCongestionControl::Acknowledged(uint32 bytesAcknowledged,
+	uint32 flightSize, bigtime_t now)
+{
+	if (fWindow < fThreshold) {
+		// slow start
+		fWindow += min_c(bytesAcknowledged, fMaxSegmentSize);
+		fEpochStart = 0;
+		return;
+	}
+
+	if (fEpochStart == 0)
+		_StartEpoch(now);
+
+	// the window the cubic function wants to reach within one round trip,
+	// but never more than half the current window beyond it
+	uint32 target = _CubicWindow(now - fEpochStart + fMinRoundTripTime);
+	if (target > fWindow + fWindow / 2)
+		target = fWindow + fWindow / 2;
+
+	uint32 window = fWindow;
+	if (target > fWindow) {
+		window += (uint32)((uint64)(target - fWindow) * bytesAcknowledged
+			/ fWindow);
+	}
+
+	// Reno with an additive increase of 3 * (1 - beta) / (1 + beta) segments
+	// per round trip, so that CUBIC is not slower than Reno
+	fEstimatedWindow += (uint32)((uint64)fMaxSegmentSize * bytesAcknowledged
+		* 3 * (100 - kBetaPercent) / ((100 + kBetaPercent) * (uint64)fWindow));
+	if (fEstimatedWindow > window)
+		window = fEstimatedWindow;
+
+	fWindow = window;
+}
+
+
+void
+CubicCongestionControl::RoundTripTimeSample(bigtime_t roundTripTime,
+	bigtime_t now)
+{
+	if (fMinRoundTripTime == 0 || roundTripTime < fMinRoundTripTime)
+		fMinRoundTripTime = roundTripTime;
+}
+
+
+void
+CubicCongestionControl::LossDetected(uint32 flightSize, bigtime_t now)
+{
+	_ReduceWindow(flightSize);
+}
+
+
+void
+CubicCongestionControl::RecoveryFinished(uint32 flightSize)
+{
+	CongestionControl::RecoveryFinished(flightSize);
+	fEpochStart = 0;
+}
+
+
+void
+CubicCongestionControl::RetransmitTimeout(uint32 flightSize)
+{
+	_ReduceWindow(flightSize);
+	fWindow = fMaxSegmentSize;
+}
+
+
+void
+CubicCongestionControl::Dump() const
+{
+	CongestionControl::Dump();
+	kprintf("    max window: %" B_PRIu32 ", estimated Reno window: %" B_PRIu32
+		"\n", fMaxWindow, fEstimatedWindow);
+	kprintf("    epoch start: %" B_PRIdBIGTIME ", K: %" B_PRIdBIGTIME " ms\n",
+		fEpochStart, fPeriod);
+}
+
+
+/*!	Returns the integer cube root of \a value, rounded down. */
+/*static*/ uint32
+CubicCongestionControl::CubeRoot(uint64 value)
+{
+	uint64 root = 0;
+	for (int shift = 63; shift >= 0; shift -= 3) {
+		root <<= 1;
+		uint64 bit = 3 * root * (root + 1) + 1;
+		if ((value >> shift) >= bit) {
+			value -= bit << shift;
+			root++;
+		}
+	}
+
+	return (uint32)root;
+}
+
+
+void
+CubicCongestionControl::_ReduceWindow(uint32 flightSize)
+{
+	// fast convergence: if the window didn't reach the previous maximum,
+	// release some more bandwidth for other flows
+	if (fWindow < fMaxWindow)
+		fMaxWindow = (uint32)((uint64)fWindow * kFastConvergencePercent / 100);
+	else
+		fMaxWindow = fWindow;
+
+	fThreshold = max_c((uint32)((uint64)flightSize * kBetaPercent / 100),
+		2 * fMaxSegmentSize);
+	fEstimatedWindow = fThreshold;
+	fEpochStart = 0;
+}
+
+
+void
+CubicCongestionControl::_StartEpoch(bigtime_t now)
+{
+	fEpochStart = now;
+	if (fEstimatedWindow < fWindow)
+		fEstimatedWindow = fWindow;
+
+	if (fWindow < fMaxWindow) {
+		fPeriod = CubeRoot((uint64)(fMaxWindow - fWindow) * kInverseScaledC
+			/ fMaxSegmentSize);
+	} else {
+		// there is no known limit to return to, start probing right away
+		fPeriod = 0;
+		fMaxWindow = fWindow;
+	}
+}
+
+
+/*!	Returns W(t) for the given time since the start of the epoch. */
+uint32
+CubicCongestionControl::_CubicWindow(bigtime_t time) const
+{
+	int64 offset = time / 1000 - fPeriod;
+	// keep the cube in range; this is more than 17 minutes
+	if (offset > (1 << 20))
+		offset = 1 << 20;
+	else if (offset < -(1 << 20))
+		offset = -(1 << 20);
+
+	int64 delta = offset * offset * offset / 1000000 * fMaxSegmentSize
+		/ (int64)(kInverseScaledC / 1000000);
+	int64 window = (int64)fMaxWindow + delta;
+	if (window < 0)
+		return 0;
+	if (window > UINT32_MAX)
+		return UINT32_MAX;
+
+	return (uint32)window;
+}
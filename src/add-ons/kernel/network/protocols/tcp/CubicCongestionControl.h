@@ -0,0 +1,58 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef CUBIC_CONGESTION_CONTROL_H
+#define CUBIC_CONGESTION_CONTROL_H
+
+
+#include "CongestionControl.h"
+
+
+/*!	CUBIC as specified in RFC 9438: after a loss, the window grows along a
+	cubic function of the time passed, which is concave until it reaches
+	the window the loss happened at, and convex when probing beyond it.
+	On paths with a small bandwidth-delay product, it grows at least as
+	fast as Reno would.
+
+	HyStart is not implemented; slow start is the same as Reno's.
+*/
+class CubicCongestionControl : public CongestionControl {
+public:
+								CubicCongestionControl(uint32& window,
+									uint32& threshold);
+
+	virtual	const char*			Name() const;
+
+	virtual	void				Acknowledged(uint32 bytesAcknowledged,
+									uint32 flightSize, bigtime_t now);
+	virtual	void				RoundTripTimeSample(bigtime_t roundTripTime,
+									bigtime_t now);
+	virtual	void				LossDetected(uint32 flightSize,
+									bigtime_t now);
+	virtual	void				RecoveryFinished(uint32 flightSize);
+	virtual	void				RetransmitTimeout(uint32 flightSize);
+
+	virtual	void				Dump() const;
+
+	static	uint32				CubeRoot(uint64 value);
+
+private:
+			void				_ReduceWindow(uint32 flightSize);
+			void				_StartEpoch(bigtime_t now);
+			uint32				_CubicWindow(bigtime_t time) const;
+
+private:
+			uint32				fMaxWindow;
+				// W_max, the window before the last reduction
+			uint32				fEstimatedWindow;
+				// W_est, the window Reno would have
+			bigtime_t			fEpochStart;
+			bigtime_t			fPeriod;
+				// K, the time in ms it takes to grow back to
+				// fMaxWindow
+			bigtime_t			fMinRoundTripTime;
+};
+
+
+#endif	// CUBIC_CONGESTION_CONTROL_H
@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2009, Haiku, Inc. All Rights Reserved.
+ * Copyright 2006-2026, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -134,6 +134,39 @@ static const uint16 kLastReservedPort = 1023;
 static const uint16 kFirstEphemeralPort = 40000;
 
 
+/*!	Returns whether \a endpoint may share its address with \a user by means
+	of SO_REUSEPORT. Both must ask for it, and belong to the same effective
+	user, so that no one can steal the connections of another user.
+*/
+static bool
+may_share_port(TCPEndpoint* user, TCPEndpoint* endpoint)
+{
+	return (user->socket->options & SO_REUSEPORT) != 0
+		&& (endpoint->socket->options & SO_REUSEPORT) != 0
+		&& user->Owner() == endpoint->Owner();
+}
+
+
+/*!	Listeners that share their local address by means of SO_REUSEPORT. Only
+	one of them is in the connection hash; new connections are spread over
+	all of them.
+*/
+struct ReusePortGroup {
+	typedef DoublyLinkedList<TCPEndpoint,
+		DoublyLinkedListMemberGetLink<TCPEndpoint,
+			&TCPEndpoint::fReusePortLink> > EndpointList;
+
+	ReusePortGroup()
+		:
+		count(0)
+	{
+	}
+
+	EndpointList	members;
+	uint32			count;
+};
+
+
 ConnectionHashDefinition::ConnectionHashDefinition(EndpointManager* manager)
 	:
 	fManager(manager)
@@ -319,8 +352,15 @@ EndpointManager::SetPassive(TCPEndpoint* endpoint)
 	SocketAddressStorage passive(AddressModule());
 	passive.SetToEmpty();
 
-	if (_LookupConnection(*endpoint->LocalAddress(), *passive))
-		return EADDRINUSE;
+	TCPEndpoint* listener = _LookupConnection(*endpoint->LocalAddress(),
+		*passive);
+	if (listener != NULL) {
+		if (!may_share_port(listener, endpoint))
+			return EADDRINUSE;
+
+		endpoint->PeerAddress().SetTo(*passive);
+		return _JoinReusePortGroup(listener, endpoint);
+	}
 
 	endpoint->PeerAddress().SetTo(*passive);
 	fConnectionHash.Insert(endpoint);
@@ -350,6 +390,7 @@ EndpointManager::FindConnection(sockaddr* local, sockaddr* peer)
 	if (endpoint != NULL) {
 		TRACE(("TCP: Received packet corresponds to wildcard endpoint %p\n",
 			endpoint));
+		endpoint = _SelectListener(endpoint, local, peer);
 		if (gSocketModule->acquire_socket(endpoint->socket))
 			return endpoint;
 	}
@@ -362,6 +403,7 @@ EndpointManager::FindConnection(sockaddr* local, sockaddr* peer)
 	if (endpoint != NULL) {
 		TRACE(("TCP: Received packet corresponds to local wildcard endpoint "
 			"%p\n", endpoint));
+		endpoint = _SelectListener(endpoint, local, peer);
 		if (gSocketModule->acquire_socket(endpoint->socket))
 			return endpoint;
 	}
@@ -373,6 +415,96 @@ EndpointManager::FindConnection(sockaddr* local, sockaddr* peer)
 }
 
 
+/*!	If \a listener is part of a reuse port group, this returns the member
+	that is responsible for the connection between \a local and \a peer.
+	You must hold the manager's lock when calling this method.
+*/
+TCPEndpoint*
+EndpointManager::_SelectListener(TCPEndpoint* listener, const sockaddr* local,
+	const sockaddr* peer)
+{
+	ReusePortGroup* group = listener->fReusePortGroup;
+	if (group == NULL)
+		return listener;
+
+	uint32 index = reuse_port_index(AddressModule(), local, peer,
+		group->count);
+
+	ReusePortGroup::EndpointList::Iterator iterator
+		= group->members.GetIterator();
+	TCPEndpoint* endpoint = iterator.Next();
+	while (index-- > 0)
+		endpoint = iterator.Next();
+
+	// A member that has been closed stays in the group until it is freed;
+	// pass its connections on to the next one still listening.
+	for (uint32 i = 0; i < group->count; i++) {
+		if (endpoint->State() == LISTEN)
+			return endpoint;
+
+		endpoint = group->members.GetNext(endpoint);
+		if (endpoint == NULL)
+			endpoint = group->members.Head();
+	}
+
+	return listener;
+}
+
+
+/*!	Adds \a endpoint to the reuse port group of \a listener, creating the
+	group if necessary.
+	You must have fLock write locked when calling this method.
+*/
+status_t
+EndpointManager::_JoinReusePortGroup(TCPEndpoint* listener,
+	TCPEndpoint* endpoint)
+{
+	ReusePortGroup* group = listener->fReusePortGroup;
+	if (group == NULL) {
+		group = new(std::nothrow) ReusePortGroup;
+		if (group == NULL)
+			return B_NO_MEMORY;
+
+		group->members.Add(listener);
+		group->count++;
+		listener->fReusePortGroup = group;
+	}
+
+	group->members.Add(endpoint);
+	group->count++;
+	endpoint->fReusePortGroup = group;
+	return B_OK;
+}
+
+
+/*!	Removes \a endpoint from its reuse port group. If it was the member in
+	the connection hash, another one takes its place.
+	You must have fLock write locked when calling this method.
+*/
+void
+EndpointManager::_LeaveReusePortGroup(TCPEndpoint* endpoint)
+{
+	ReusePortGroup* group = endpoint->fReusePortGroup;
+	if (group == NULL)
+		return;
+
+	group->members.Remove(endpoint);
+	group->count--;
+	endpoint->fReusePortGroup = NULL;
+
+	if (_LookupConnection(*endpoint->LocalAddress(), *endpoint->PeerAddress())
+			== endpoint) {
+		fConnectionHash.RemoveUnchecked(endpoint);
+		fConnectionHash.Insert(group->members.Head());
+	}
+
+	if (group->count == 1) {
+		group->members.Head()->fReusePortGroup = NULL;
+		delete group;
+	}
+}
+
+
 //	#pragma mark - endpoints
 
 
@@ -448,6 +580,12 @@ EndpointManager::_BindToAddress(WriteLocker& locker, TCPEndpoint* endpoint,
 					break;
 				}
 
+				// sockets that all ask for it may share the very same address
+				if (may_share_port(user, endpoint)
+					&& address.EqualTo(*user->LocalAddress(), false)) {
+					continue;
+				}
+
 				if ((endpoint->socket->options & SO_REUSEADDR) == 0)
 					return EADDRINUSE;
 
@@ -537,7 +675,10 @@ EndpointManager::Unbind(TCPEndpoint* endpoint)
 	if (!fEndpointHash.Remove(endpoint))
 		panic("bound endpoint %p not in hash!", endpoint);
 
-	fConnectionHash.Remove(endpoint);
+	if (endpoint->fReusePortGroup != NULL)
+		_LeaveReusePortGroup(endpoint);
+	else
+		fConnectionHash.Remove(endpoint);
 
 	(*endpoint->LocalAddress())->sa_len = 0;
 
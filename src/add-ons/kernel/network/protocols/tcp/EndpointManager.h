@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2009, Haiku, Inc. All Rights Reserved.
+ * Copyright 2006-2026, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -27,6 +27,7 @@ struct net_address_module_info;
 struct net_domain;
 class EndpointManager;
 class TCPEndpoint;
+struct ReusePortGroup;
 
 
 struct ConnectionHashDefinition {
@@ -98,6 +99,11 @@ public:
 private:
 			TCPEndpoint*	_LookupConnection(const sockaddr* local,
 								const sockaddr* peer);
+			TCPEndpoint*	_SelectListener(TCPEndpoint* listener,
+								const sockaddr* local, const sockaddr* peer);
+			status_t		_JoinReusePortGroup(TCPEndpoint* listener,
+								TCPEndpoint* endpoint);
+			void			_LeaveReusePortGroup(TCPEndpoint* endpoint);
 			status_t		_Bind(TCPEndpoint* endpoint,
 								const sockaddr* address);
 			status_t		_BindToAddress(WriteLocker& locker,
@@ -0,0 +1,322 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "SackScoreboard.h"
+
+#include <KernelExport.h>
+
+
+//#define TRACE_SACK_SCOREBOARD
+#ifdef TRACE_SACK_SCOREBOARD
+#	define TRACE(x) dprintf x
+#else
+#	define TRACE(x)
+#endif
+
+
+static const int32 kDuplicateThreshold = 3;
+	// DupThresh of RFC 6675
+
+
+SackScoreboard::SackScoreboard()
+	:
+	fCount(0),
+	fSackedBytes(0),
+	fLostBelow(0),
+	fHasLostBelow(false)
+{
+}
+
+
+void
+SackScoreboard::Reset()
+{
+	fCount = 0;
+	fSackedBytes = 0;
+	fHasLostBelow = false;
+}
+
+
+/*!	Records the SACK blocks of an incoming acknowledgement. Blocks that are
+	at or below \a acknowledge (D-SACKs, RFC 2883), or that reach beyond
+	the data sent so far, are ignored.
+	Returns whether any data was SACKed that wasn't before.
+*/
+bool
+SackScoreboard::Update(tcp_sequence acknowledge, tcp_sequence sendMax,
+	const tcp_sack* sacks, int count)
+{
+	bool sackedNewData = false;
+
+	for (int i = 0; i < count; i++) {
+		tcp_sequence left = sacks[i].left_edge;
+		tcp_sequence right = sacks[i].right_edge;
+
+		if (right <= left || right <= acknowledge || right > sendMax)
+			continue;
+		if (left < acknowledge)
+			left = acknowledge;
+
+		if (_Add(left, right))
+			sackedNewData = true;
+	}
+
+	TRACE(("SackScoreboard::Update(): %" B_PRId32 " blocks, %" B_PRIu32
+		" bytes SACKed\n", fCount, fSackedBytes));
+	return sackedNewData;
+}
+
+
+/*!	Forgets about everything below \a sequence, as it has been acknowledged
+	cumulatively.
+*/
+void
+SackScoreboard::RemoveUntil(tcp_sequence sequence)
+{
+	int32 removed = 0;
+	while (removed < fCount && fBlocks[removed].right <= sequence) {
+		fSackedBytes -= (fBlocks[removed].right
+			- fBlocks[removed].left).Number();
+		removed++;
+	}
+
+	if (removed > 0) {
+		fCount -= removed;
+		for (int32 i = 0; i < fCount; i++)
+			fBlocks[i] = fBlocks[i + removed];
+	}
+
+	if (fCount > 0 && fBlocks[0].left < sequence) {
+		fSackedBytes -= (sequence - fBlocks[0].left).Number();
+		fBlocks[0].left = sequence;
+	}
+
+	if (fHasLostBelow && fLostBelow <= sequence)
+		fHasLostBelow = false;
+}
+
+
+/*!	Marks all data below \a sequence that has not been SACKed as lost. */
+void
+SackScoreboard::MarkLostBelow(tcp_sequence sequence)
+{
+	if (!fHasLostBelow || fLostBelow < sequence) {
+		fLostBelow = sequence;
+		fHasLostBelow = true;
+	}
+}
+
+
+bool
+SackScoreboard::IsSacked(tcp_sequence sequence) const
+{
+	for (int32 i = 0; i < fCount; i++) {
+		if (sequence < fBlocks[i].left)
+			return false;
+		if (sequence < fBlocks[i].right)
+			return true;
+	}
+
+	return false;
+}
+
+
+/*!	Implements IsLost() of RFC 6675: the byte at \a sequence is considered
+	lost if enough discontiguous blocks, or enough data, has been SACKed
+	above it, or if it was marked lost.
+*/
+bool
+SackScoreboard::IsLost(tcp_sequence sequence, uint32 maxSegmentSize) const
+{
+	if (IsSacked(sequence))
+		return false;
+	if (_LostByTime(sequence, sequence + 1) != 0)
+		return true;
+
+	int32 blocksAbove = 0;
+	uint32 bytesAbove = 0;
+	for (int32 i = fCount - 1; i >= 0 && fBlocks[i].right > sequence; i--) {
+		if (fBlocks[i].left <= sequence) {
+			// SACKed data is never lost
+			return false;
+		}
+
+		blocksAbove++;
+		bytesAbove += (fBlocks[i].right - fBlocks[i].left).Number();
+	}
+
+	return _IsLost(blocksAbove, bytesAbove, maxSegmentSize);
+}
+
+
+/*!	Implements SetPipe() of RFC 6675: estimates how many bytes are still in
+	the network. Every byte that is neither SACKed nor lost is counted, and
+	every byte that has been retransmitted (is below \a highRetransmitted)
+	is counted once more.
+*/
+uint32
+SackScoreboard::Pipe(tcp_sequence unacknowledged, tcp_sequence sendMax,
+	tcp_sequence highRetransmitted, uint32 maxSegmentSize) const
+{
+	int32 blocksAbove = fCount;
+	uint32 bytesAbove = fSackedBytes;
+	tcp_sequence position = unacknowledged;
+	uint32 pipe = 0;
+
+	for (int32 i = 0; i <= fCount; i++) {
+		tcp_sequence holeEnd = i < fCount ? fBlocks[i].left : sendMax;
+		if (holeEnd > position) {
+			uint32 length = (holeEnd - position).Number();
+			uint32 retransmitted = 0;
+			if (highRetransmitted > position) {
+				retransmitted = min_c(length,
+					(highRetransmitted - position).Number());
+			}
+
+			pipe += retransmitted;
+			if (!_IsLost(blocksAbove, bytesAbove, maxSegmentSize))
+				pipe += length - _LostByTime(position, holeEnd);
+		}
+
+		if (i < fCount) {
+			blocksAbove--;
+			bytesAbove -= (fBlocks[i].right - fBlocks[i].left).Number();
+			position = fBlocks[i].right;
+		}
+	}
+
+	return pipe;
+}
+
+
+/*!	Implements rule (1) of NextSeg() of RFC 6675: finds the first range of
+	lost data that has not yet been retransmitted, of at most
+	\a maxSegmentSize bytes.
+*/
+bool
+SackScoreboard::NextLost(tcp_sequence unacknowledged,
+	tcp_sequence highRetransmitted, uint32 maxSegmentSize,
+	tcp_sequence& _start, uint32& _length) const
+{
+	int32 blocksAbove = fCount;
+	uint32 bytesAbove = fSackedBytes;
+	tcp_sequence position = unacknowledged;
+
+	// Only the holes below the highest SACKed block can be lost
+	for (int32 i = 0; i < fCount; i++) {
+		tcp_sequence start = position;
+		if (highRetransmitted > start)
+			start = highRetransmitted;
+
+		if (fBlocks[i].left > start) {
+			uint32 length = (fBlocks[i].left - start).Number();
+			if (!_IsLost(blocksAbove, bytesAbove, maxSegmentSize)) {
+				// only the start of the hole may be lost by time
+				length = _LostByTime(start, fBlocks[i].left);
+				if (length == 0) {
+					// and every following hole is lost even less
+					return false;
+				}
+			}
+
+			_start = start;
+			_length = min_c(length, maxSegmentSize);
+			return true;
+		}
+
+		blocksAbove--;
+		bytesAbove -= (fBlocks[i].right - fBlocks[i].left).Number();
+		position = fBlocks[i].right;
+	}
+
+	return false;
+}
+
+
+void
+SackScoreboard::Dump() const
+{
+	kprintf("    SACK scoreboard: %" B_PRIu32 " bytes\n", fSackedBytes);
+	if (fHasLostBelow)
+		kprintf("      lost below %" B_PRIu32 "\n", fLostBelow.Number());
+	for (int32 i = 0; i < fCount; i++) {
+		kprintf("      %" B_PRIu32 " - %" B_PRIu32 "\n",
+			fBlocks[i].left.Number(), fBlocks[i].right.Number());
+	}
+}
+
+
+/*!	Returns how many bytes at the start of the range from \a start to
+	\a end were marked lost.
+*/
+uint32
+SackScoreboard::_LostByTime(tcp_sequence start, tcp_sequence end) const
+{
+	if (!fHasLostBelow || fLostBelow <= start)
+		return 0;
+	if (fLostBelow >= end)
+		return (end - start).Number();
+
+	return (fLostBelow - start).Number();
+}
+
+
+/*static*/ bool
+SackScoreboard::_IsLost(int32 blocksAbove, uint32 bytesAbove,
+	uint32 maxSegmentSize)
+{
+	return blocksAbove >= kDuplicateThreshold
+		|| bytesAbove > (kDuplicateThreshold - 1) * maxSegmentSize;
+}
+
+
+/*!	Adds the range to the sorted block list, merging it with any block it
+	overlaps or touches. If the list is full, a block that cannot be merged
+	is dropped, which only makes the loss detection more conservative.
+	Returns whether the range contained data that wasn't SACKed yet.
+*/
+bool
+SackScoreboard::_Add(tcp_sequence left, tcp_sequence right)
+{
+	int32 first = 0;
+	while (first < fCount && fBlocks[first].right < left)
+		first++;
+
+	int32 last = first;
+	uint32 mergedBytes = 0;
+	while (last < fCount && fBlocks[last].left <= right) {
+		if (fBlocks[last].left < left)
+			left = fBlocks[last].left;
+		if (fBlocks[last].right > right)
+			right = fBlocks[last].right;
+
+		mergedBytes += (fBlocks[last].right - fBlocks[last].left).Number();
+		last++;
+	}
+
+	uint32 bytes = (right - left).Number();
+	if (bytes == mergedBytes)
+		return false;
+
+	if (first == last) {
+		if (fCount == kMaxBlocks)
+			return false;
+
+		for (int32 i = fCount; i > first; i--)
+			fBlocks[i] = fBlocks[i - 1];
+		fCount++;
+	} else if (last - first > 1) {
+		int32 removed = last - first - 1;
+		for (int32 i = first + 1; i + removed < fCount; i++)
+			fBlocks[i] = fBlocks[i + removed];
+		fCount -= removed;
+	}
+
+	fBlocks[first].left = left;
+	fBlocks[first].right = right;
+	fSackedBytes += bytes - mergedBytes;
+	return true;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef SACK_SCOREBOARD_H
+#define SACK_SCOREBOARD_H
+
+
+#include "tcp.h"
+
+
+/*!	The sender side record of the data the peer has selectively acknowledged
+	(RFC 2018), and the loss recovery queries of RFC 6675 on top of it.
+
+	Only the SACKed ranges above the cumulative acknowledgement are stored;
+	the holes between them are the data that is still missing at the
+	receiver. Besides the rules of RFC 6675, data can be marked lost by time
+	based loss detection (see TransmitTimeline).
+*/
+class SackScoreboard {
+public:
+								SackScoreboard();
+
+			void				Reset();
+			bool				IsEmpty() const { return fCount == 0; }
+
+			bool				Update(tcp_sequence acknowledge,
+									tcp_sequence sendMax,
+									const tcp_sack* sacks, int count);
+			void				RemoveUntil(tcp_sequence sequence);
+			void				MarkLostBelow(tcp_sequence sequence);
+
+			uint32				SackedBytes() const { return fSackedBytes; }
+			tcp_sequence		HighestSacked() const
+									{ return fBlocks[fCount - 1].right; }
+			bool				IsSacked(tcp_sequence sequence) const;
+			bool				IsLost(tcp_sequence sequence,
+									uint32 maxSegmentSize) const;
+
+			uint32				Pipe(tcp_sequence unacknowledged,
+									tcp_sequence sendMax,
+									tcp_sequence highRetransmitted,
+									uint32 maxSegmentSize) const;
+			bool				NextLost(tcp_sequence unacknowledged,
+									tcp_sequence highRetransmitted,
+									uint32 maxSegmentSize,
+									tcp_sequence& _start,
+									uint32& _length) const;
+
+			void				Dump() const;
+
+private:
+			struct Block {
+				tcp_sequence	left;
+				tcp_sequence	right;
+			};
+
+	static	bool				_IsLost(int32 blocksAbove, uint32 bytesAbove,
+									uint32 maxSegmentSize);
+			uint32				_LostByTime(tcp_sequence start,
+									tcp_sequence end) const;
+			bool				_Add(tcp_sequence left, tcp_sequence right);
+
+	static	const int32			kMaxBlocks = 32;
+
+			Block				fBlocks[kMaxBlocks];
+			int32				fCount;
+			uint32				fSackedBytes;
+			tcp_sequence		fLostBelow;
+			bool				fHasLostBelow;
+};
+
+
+#endif	// SACK_SCOREBOARD_H
@@ -19,12 +19,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <unistd.h>
 
 #include <KernelExport.h>
 #include <Select.h>
 
 #include <net_buffer.h>
 #include <net_datalink.h>
+#include <net_device.h>
 #include <net_stat.h>
 #include <NetBufferUtilities.h>
 #include <NetUtilities.h>
@@ -41,12 +43,17 @@
 //	- RFC 793 - Transmission Control Protocol
 //	- RFC 813 - Window and Acknowledgement Strategy in TCP
 //	- RFC 1337 - TIME_WAIT Assassination Hazards in TCP
+//	- RFC 6675 - A Conservative Loss Recovery Algorithm Based on Selective
+//	  Acknowledgment (SACK) for TCP
+//	- RFC 8985 - The RACK-TLP Loss Detection Algorithm for TCP (time based
+//	  loss marking from the SACKed data, and tail loss probes only)
 //
 // Things incomplete in this implementation:
 //	- TCP Extensions for High Performance, RFC 1323 - RTTM, PAWS
 //	- Congestion Control, RFC 5681
 //	- Limited Transit, RFC 3042
-//	- SACK, Selective Acknowledgment; RFC 2018, RFC 2883, RFC 6675
+//	- SACK, Selective Acknowledgment; RFC 2018, RFC 2883 (no D-SACK, no
+//	  rescue retransmission)
 //	- NewReno Modification to TCP's Fast Recovery, RFC 2582
 //
 // Things this implementation currently doesn't implement:
@@ -321,11 +328,16 @@ enum {
 	FLAG_LOCAL					= 0x20,
 	FLAG_RECOVERY				= 0x40,
 	FLAG_OPTION_SACK_PERMITTED	= 0x80,
+	FLAG_TAIL_LOSS_PROBE		= 0x100,
 };
 
 
 static const int kTimestampFactor = 1000;
 	// conversion factor between usec system time and msec tcp time
+static const bigtime_t kMinReorderWindow = 1000;
+static const bigtime_t kMinTailLossProbeTimeout = 10000;
+static const bigtime_t kMaxAcknowledgeDelay = 200000;
+	// the longest a peer may delay acknowledging a single segment
 
 
 static inline bigtime_t
@@ -419,6 +431,8 @@ state_needs_finish(int32 state)
 TCPEndpoint::TCPEndpoint(net_socket* socket)
 	:
 	ProtocolSocket(socket),
+	fReusePortGroup(NULL),
+	fOwner(geteuid()),
 	fManager(NULL),
 	fOptions(0),
 	fSendWindowShift(0),
@@ -437,7 +451,11 @@ TCPEndpoint::TCPEndpoint(net_socket* socket)
 	fDuplicateAcknowledgeCount(0),
 	fPreviousFlightSize(0),
 	fRecover(0),
+	fHighRetransmitted(0),
+	fTailLossProbeEnd(0),
+	fTailLossProbeTime(0),
 	fRoute(NULL),
+	fRouteGeneration(0),
 	fReceiveNext(0),
 	fReceiveMaxAdvertised(0),
 	fReceiveWindow(socket->receive.buffer_size),
@@ -448,9 +466,11 @@ TCPEndpoint::TCPEndpoint(net_socket* socket)
 	fSendTime(0),
 	fRoundTripStartSequence(0),
 	fRetransmitTimeout(TCP_INITIAL_RTT),
+	fMinRoundTripTime(0),
 	fReceivedTimestamp(0),
 	fCongestionWindow(0),
 	fSlowStartThreshold(0),
+	fCongestionControl(NULL),
 	fState(CLOSED),
 	fFlags(FLAG_OPTION_WINDOW_SCALE | FLAG_OPTION_TIMESTAMP | FLAG_OPTION_SACK_PERMITTED)
 {
@@ -467,6 +487,11 @@ TCPEndpoint::TCPEndpoint(net_socket* socket)
 		TCPEndpoint::_DelayedAcknowledgeTimer, this);
 	gStackModule->init_timer(&fTimeWaitTimer, TCPEndpoint::_TimeWaitTimer,
 		this);
+	gStackModule->init_timer(&fTailLossProbeTimer,
+		TCPEndpoint::_TailLossProbeTimer, this);
+
+	create_congestion_control(NULL, fCongestionWindow, fSlowStartThreshold,
+		&fCongestionControl);
 
 	T(APICall(this, "constructor"));
 }
@@ -494,14 +519,20 @@ TCPEndpoint::~TCPEndpoint()
 	gStackModule->wait_for_timer(&fPersistTimer);
 	gStackModule->wait_for_timer(&fDelayedAcknowledgeTimer);
 	gStackModule->wait_for_timer(&fTimeWaitTimer);
+	gStackModule->wait_for_timer(&fTailLossProbeTimer);
 
 	gDatalinkModule->put_route(Domain(), fRoute);
+
+	delete fCongestionControl;
 }
 
 
 status_t
 TCPEndpoint::InitCheck() const
 {
+	if (fCongestionControl == NULL)
+		return B_NO_MEMORY;
+
 	return B_OK;
 }
 
@@ -1072,6 +1103,18 @@ TCPEndpoint::SetReceiveBufferSize(size_t length)
 status_t
 TCPEndpoint::GetOption(int option, void* _value, int* _length)
 {
+	if (option == TCP_CONGESTION) {
+		MutexLocker _(fLock);
+		const char* name = fCongestionControl->Name();
+		int length = strlen(name) + 1;
+		if (*_length < length)
+			return B_BAD_VALUE;
+
+		memcpy(_value, name, length);
+		*_length = length;
+		return B_OK;
+	}
+
 	if (*_length != sizeof(int))
 		return B_BAD_VALUE;
 
@@ -1098,6 +1141,20 @@ TCPEndpoint::GetOption(int option, void* _value, int* _length)
 status_t
 TCPEndpoint::SetOption(int option, const void* _value, int length)
 {
+	if (option == TCP_CONGESTION) {
+		// the name does not need to be null terminated
+		char name[TCP_CA_NAME_MAX];
+		if (length <= 0)
+			return B_BAD_VALUE;
+
+		length = min_c(length, TCP_CA_NAME_MAX - 1);
+		memcpy(name, _value, length);
+		name[length] = '\0';
+
+		MutexLocker _(fLock);
+		return _SetCongestionControl(name);
+	}
+
 	if (option != TCP_NODELAY)
 		return B_BAD_VALUE;
 
@@ -1192,6 +1249,8 @@ TCPEndpoint::_CancelConnectionTimers()
 	T(TimerSet(this, "persist", -1));
 	gStackModule->cancel_timer(&fDelayedAcknowledgeTimer);
 	T(TimerSet(this, "delayed ack", -1));
+	gStackModule->cancel_timer(&fTailLossProbeTimer);
+	T(TimerSet(this, "tail loss probe", -1));
 }
 
 
@@ -1294,10 +1353,28 @@ TCPEndpoint::_HandleReset(status_t error)
 void
 TCPEndpoint::_DuplicateAcknowledge(tcp_segment_header &segment)
 {
+	if (_IsSackEnabled() && (fFlags & FLAG_RECOVERY) != 0) {
+		// the acknowledgement may have freed room in the pipe
+		_SendSackRecovery();
+		return;
+	}
+
 	if (fDuplicateAcknowledgeCount == 0)
 		fPreviousFlightSize = (fSendMax - fSendUnacknowledged).Number();
 
-	if (++fDuplicateAcknowledgeCount < 3) {
+	// With SACK, the loss may also be detected by the amount of data that
+	// arrived above the first unacknowledged byte
+	bool lost = ++fDuplicateAcknowledgeCount >= 3
+		|| (_IsSackEnabled() && fSackScoreboard.IsLost(fSendUnacknowledged,
+			fSendMaxSegmentSize));
+
+	if (_IsSackEnabled() && lost) {
+		if (tcp_sequence(fSendUnacknowledged - 1) > tcp_sequence(fRecover))
+			_EnterSackRecovery();
+		return;
+	}
+
+	if (fDuplicateAcknowledgeCount < 3) {
 		if (fSendQueue.Available(fSendMax) != 0  && fSendWindow != 0) {
 			fSendNext = fSendMax;
 			fCongestionWindow += fDuplicateAcknowledgeCount * fSendMaxSegmentSize;
@@ -1307,12 +1384,15 @@ TCPEndpoint::_DuplicateAcknowledge(tcp_segment_header &segment)
 		}
 	}
 
+	if (_IsSackEnabled())
+		return;
+
 	if (fDuplicateAcknowledgeCount == 3) {
 		if ((segment.acknowledge - 1) > fRecover || (fCongestionWindow > fSendMaxSegmentSize &&
 			(fSendUnacknowledged - fPreviousHighestAcknowledge) <= 4 * fSendMaxSegmentSize)) {
 			fFlags |= FLAG_RECOVERY;
 			fRecover = fSendMax.Number() - 1;
-			fSlowStartThreshold = max_c(fPreviousFlightSize / 2, 2 * fSendMaxSegmentSize);
+			fCongestionControl->LossDetected(fPreviousFlightSize, system_time());
 			fCongestionWindow = fSlowStartThreshold + 3 * fSendMaxSegmentSize;
 			fSendNext = segment.acknowledge;
 			_SendQueued();
@@ -1330,6 +1410,247 @@ TCPEndpoint::_DuplicateAcknowledge(tcp_segment_header &segment)
 }
 
 
+bool
+TCPEndpoint::_IsSackEnabled() const
+{
+	return (fFlags & FLAG_OPTION_SACK_PERMITTED) != 0
+		&& (fOptions & TCP_NOOPT) == 0;
+}
+
+
+/*!	Enters SACK based loss recovery as described in RFC 6675: the first
+	unacknowledged segment is retransmitted right away, everything else is
+	sent as the pipe allows.
+*/
+void
+TCPEndpoint::_EnterSackRecovery()
+{
+	TRACE("_EnterSackRecovery(): una %" B_PRIu32 ", max %" B_PRIu32
+		", %" B_PRIu32 " bytes SACKed", fSendUnacknowledged.Number(),
+		fSendMax.Number(), fSackScoreboard.SackedBytes());
+
+	fFlags |= FLAG_RECOVERY;
+	fRecover = fSendMax.Number() - 1;
+	fCongestionControl->LossDetected(fPreviousFlightSize, system_time());
+	fCongestionWindow = fSlowStartThreshold;
+
+	fHighRetransmitted = fSendUnacknowledged;
+
+	uint32 sent;
+	if (_SendSegmentAt(fSendUnacknowledged, fSendMaxSegmentSize, sent) == B_OK)
+		fHighRetransmitted = fSendUnacknowledged + sent;
+
+	_SendSackRecovery();
+}
+
+
+/*!	Sends segments as long as the congestion window has room for them,
+	using the NextSeg() rules (1) and (2) of RFC 6675: lost data is
+	retransmitted first, then new data is sent.
+*/
+void
+TCPEndpoint::_SendSackRecovery()
+{
+	if (fHighRetransmitted < fSendUnacknowledged)
+		fHighRetransmitted = fSendUnacknowledged;
+
+	while (true) {
+		uint32 pipe = fSackScoreboard.Pipe(fSendUnacknowledged, fSendMax,
+			fHighRetransmitted, fSendMaxSegmentSize);
+		if (pipe + fSendMaxSegmentSize > fCongestionWindow)
+			break;
+
+		tcp_sequence start;
+		uint32 length;
+		uint32 sent = 0;
+		if (fSackScoreboard.NextLost(fSendUnacknowledged, fHighRetransmitted,
+				fSendMaxSegmentSize, start, length)) {
+			if (_SendSegmentAt(start, length, sent) != B_OK)
+				break;
+
+			fHighRetransmitted = start + sent;
+		} else {
+			uint32 flightSize = (fSendMax - fSendUnacknowledged).Number();
+			if (flightSize >= fSendWindow)
+				break;
+
+			length = min_c(fSendQueue.Available(fSendMax),
+				fSendWindow - flightSize);
+			if (length == 0)
+				break;
+
+			if (_SendSegmentAt(fSendMax, length, sent) != B_OK)
+				break;
+		}
+
+		if (sent == 0)
+			break;
+	}
+}
+
+
+/*!	Sends a single segment with up to \a length bytes starting at
+	\a sequence, independent of fSendNext.
+*/
+status_t
+TCPEndpoint::_SendSegmentAt(tcp_sequence sequence, uint32 length,
+	uint32& _sent)
+{
+	if (fRoute == NULL || fState < ESTABLISHED)
+		return B_ERROR;
+
+	tcp_segment_header segment = _PrepareSendSegment();
+	length = min_c(length, fSendMaxSegmentSize - tcp_options_length(segment));
+
+	if (sequence + length == fSendQueue.LastSequence()) {
+		if (state_needs_finish(fState))
+			segment.flags |= TCP_FLAG_FINISH;
+		if (length > 0)
+			segment.flags |= TCP_FLAG_PUSH;
+	}
+
+	net_buffer* buffer = gBufferModule->create(256);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = fSendQueue.Get(buffer, sequence, length);
+	if (status != B_OK) {
+		gBufferModule->free(buffer);
+		return status;
+	}
+
+	tcp_sequence sendNext = fSendNext;
+	fSendNext = sequence;
+
+	status = _PrepareAndSend(segment, buffer, sequence < fSendMax);
+
+	// only new data moves fSendNext forward
+	if (fSendNext < sendNext)
+		fSendNext = sendNext;
+	if (status != B_OK)
+		return status;
+
+	if (!gStackModule->is_timer_active(&fRetransmitTimer)) {
+		gStackModule->set_timer(&fRetransmitTimer, fRetransmitTimeout);
+		T(TimerSet(this, "retransmit", fRetransmitTimeout));
+	}
+
+	_sent = length;
+	return B_OK;
+}
+
+
+/*!	Marks data as lost the way RACK (RFC 8985) does: once data is SACKed,
+	all data that was sent more than a reordering window before it must have
+	been lost, no matter how little has been SACKed above it.
+*/
+void
+TCPEndpoint::_DetectLostByTime()
+{
+	bigtime_t deliveredTime = 0;
+	if (!fTransmitTimeline.TimeOf(fSackScoreboard.HighestSacked() - 1,
+			deliveredTime)) {
+		deliveredTime = 0;
+	}
+
+	// a retransmitted tail loss probe is newer than anything else
+	if ((fFlags & FLAG_TAIL_LOSS_PROBE) != 0
+		&& fTailLossProbeTime > deliveredTime
+		&& fSackScoreboard.IsSacked(fTailLossProbeEnd - 1)) {
+		deliveredTime = fTailLossProbeTime;
+	}
+
+	if (deliveredTime == 0)
+		return;
+
+	bigtime_t reorderWindow = max_c(fMinRoundTripTime / 4, kMinReorderWindow);
+	tcp_sequence lostBelow;
+	if (fTransmitTimeline.SentBefore(deliveredTime - reorderWindow, lostBelow))
+		fSackScoreboard.MarkLostBelow(lostBelow);
+}
+
+
+/*!	Schedules a tail loss probe (RFC 8985): if the last segments of a flight
+	are lost, no acknowledgements arrive that could trigger a fast
+	retransmit, so a segment is sent after about two round trips to provoke
+	one, instead of waiting for the retransmit timeout.
+*/
+void
+TCPEndpoint::_ArmTailLossProbe()
+{
+	if (!_IsSackEnabled() || fSmoothedRoundTripTime == 0
+		|| (fFlags & (FLAG_RECOVERY | FLAG_TAIL_LOSS_PROBE)) != 0
+		|| fSendUnacknowledged == fSendMax)
+		return;
+
+	bigtime_t timeout = 2 * (bigtime_t)fSmoothedRoundTripTime
+		* kTimestampFactor;
+	if ((fSendMax - fSendUnacknowledged).Number() <= fSendMaxSegmentSize) {
+		// the peer might delay acknowledging a single segment
+		timeout += kMaxAcknowledgeDelay;
+	}
+	if (timeout < kMinTailLossProbeTimeout)
+		timeout = kMinTailLossProbeTimeout;
+
+	if (timeout >= fRetransmitTimeout) {
+		gStackModule->cancel_timer(&fTailLossProbeTimer);
+		return;
+	}
+
+	gStackModule->set_timer(&fTailLossProbeTimer, timeout);
+	T(TimerSet(this, "tail loss probe", timeout));
+}
+
+
+/*!	Sends new data if there is any, or retransmits the last segment, and
+	restarts the retransmit timer. At most one probe is sent until new
+	data is acknowledged.
+*/
+void
+TCPEndpoint::_SendTailLossProbe()
+{
+	if ((fFlags & (FLAG_RECOVERY | FLAG_TAIL_LOSS_PROBE)) != 0
+		|| fSendUnacknowledged == fSendMax)
+		return;
+
+	TRACE("_SendTailLossProbe(): una %" B_PRIu32 ", max %" B_PRIu32,
+		fSendUnacknowledged.Number(), fSendMax.Number());
+
+	uint32 flightSize = (fSendMax - fSendUnacknowledged).Number();
+	uint32 available = fSendQueue.Available(fSendMax);
+	uint32 sent = 0;
+	fTailLossProbeTime = 0;
+
+	if (available > 0 && flightSize < fSendWindow) {
+		_SendSegmentAt(fSendMax, min_c(available, fSendWindow - flightSize),
+			sent);
+	}
+
+	if (sent == 0) {
+		tcp_sequence end = fSendQueue.LastSequence();
+		if (end > fSendMax)
+			end = fSendMax;
+
+		tcp_sequence start = fSendUnacknowledged;
+		if ((end - start).Number() > fSendMaxSegmentSize)
+			start = end - fSendMaxSegmentSize;
+
+		if (_SendSegmentAt(start, (end - start).Number(), sent) != B_OK)
+			return;
+
+		if (sent > 0) {
+			fTailLossProbeEnd = start + sent;
+			fTailLossProbeTime = system_time();
+		}
+	}
+
+	fFlags |= FLAG_TAIL_LOSS_PROBE;
+
+	gStackModule->set_timer(&fRetransmitTimer, fRetransmitTimeout);
+	T(TimerSet(this, "retransmit", fRetransmitTimeout));
+}
+
+
 void
 TCPEndpoint::_UpdateTimestamps(tcp_segment_header& segment,
 	size_t segmentLength)
@@ -1442,15 +1763,11 @@ TCPEndpoint::_PrepareReceivePath(tcp_segment_header& segment)
 			fFlags &= ~FLAG_OPTION_SACK_PERMITTED;
 	}
 
-	if (fSendMaxSegmentSize > 2190)
-		fCongestionWindow = 2 * fSendMaxSegmentSize;
-	else if (fSendMaxSegmentSize > 1095)
-		fCongestionWindow = 3 * fSendMaxSegmentSize;
-	else
-		fCongestionWindow = 4 * fSendMaxSegmentSize;
+	fSlowStartThreshold = (uint32)segment.advertised_window << fSendWindowShift;
+	fCongestionControl->SetMaxSegmentSize(fSendMaxSegmentSize);
+	fCongestionControl->Start();
 
 	fSendMaxSegments = fCongestionWindow / fSendMaxSegmentSize;
-	fSlowStartThreshold = (uint32)segment.advertised_window << fSendWindowShift;
 }
 
 
@@ -1483,6 +1800,7 @@ TCPEndpoint::_Spawn(TCPEndpoint* parent, tcp_segment_header& segment,
 	T(Spawn(parent, this));
 
 	fManager = parent->fManager;
+	fOwner = parent->fOwner;
 
 	if (fManager->BindChild(this, buffer->destination) != B_OK) {
 		T(Error(this, "binding failed", __LINE__));
@@ -1597,6 +1915,8 @@ TCPEndpoint::_Receive(tcp_segment_header& segment, net_buffer* buffer)
 
 	if (fState == ESTABLISHED
 		&& segment.AcknowledgeOnly()
+		&& (segment.options & TCP_HAS_SACK) == 0
+		&& (fFlags & FLAG_RECOVERY) == 0
 		&& fReceiveNext == segment.sequence
 		&& advertisedWindow > 0 && advertisedWindow == fSendWindow
 		&& fSendNext == fSendMax) {
@@ -1751,8 +2071,28 @@ TCPEndpoint::_Receive(tcp_segment_header& segment, net_buffer* buffer)
 		if (fSendMax < segment.acknowledge)
 			return DROP | IMMEDIATE_ACKNOWLEDGE;
 
+		// With SACK, an acknowledgement counts as duplicate if it SACKs
+		// new data, no matter what else it does (RFC 6675)
+		bool sackedNewData = false;
+		if (_IsSackEnabled() && (segment.options & TCP_HAS_SACK) != 0
+			&& segment.acknowledge >= fSendUnacknowledged) {
+			sackedNewData = fSackScoreboard.Update(segment.acknowledge,
+				fSendMax, segment.sacks, segment.sackCount);
+			if (sackedNewData) {
+				_DetectLostByTime();
+				if (segment.acknowledge == fSendUnacknowledged)
+					_ReportDelivery();
+			}
+		}
+
 		if (segment.acknowledge == fSendUnacknowledged) {
-			if (buffer->size == 0 && advertisedWindow == fSendWindow
+			if (_IsSackEnabled()) {
+				if (fSendUnacknowledged != fSendMax
+					&& (sackedNewData || (fFlags & FLAG_RECOVERY) != 0)) {
+					TRACE("Receive(): duplicate ack!");
+					_DuplicateAcknowledge(segment);
+				}
+			} else if (buffer->size == 0 && advertisedWindow == fSendWindow
 				&& (segment.flags & TCP_FLAG_FINISH) == 0 && fSendUnacknowledged != fSendMax) {
 				TRACE("Receive(): duplicate ack!");
 				_DuplicateAcknowledge(segment);
@@ -1762,12 +2102,11 @@ TCPEndpoint::_Receive(tcp_segment_header& segment, net_buffer* buffer)
 		} else {
 			// this segment acknowledges in flight data
 
-			if (fDuplicateAcknowledgeCount >= 3) {
+			if (fDuplicateAcknowledgeCount >= 3 && !_IsSackEnabled()) {
 				// deflate the window.
 				if (segment.acknowledge > fRecover) {
 					uint32 flightSize = (fSendMax - fSendUnacknowledged).Number();
-					fCongestionWindow = min_c(fSlowStartThreshold,
-						max_c(flightSize, fSendMaxSegmentSize) + fSendMaxSegmentSize);
+					fCongestionControl->RecoveryFinished(flightSize);
 					fFlags &= ~FLAG_RECOVERY;
 				}
 			}
@@ -1801,6 +2140,9 @@ TCPEndpoint::_Receive(tcp_segment_header& segment, net_buffer* buffer)
 			if (fState != CLOSED) {
 				tcp_sequence last = fLastAcknowledgeSent;
 				_Acknowledged(segment);
+				if (sackedNewData && (fFlags & FLAG_RECOVERY) == 0
+					&& fSendUnacknowledged != fSendMax)
+					_DuplicateAcknowledge(segment);
 				// we just sent an acknowledge, remove from action
 				if (last < fLastAcknowledgeSent)
 					action &= ~IMMEDIATE_ACKNOWLEDGE;
@@ -2008,7 +2350,7 @@ TCPEndpoint::_PrepareSendSegment()
 				&& (fFlags & FLAG_OPTION_SACK_PERMITTED) != 0) {
 			segment.options |= TCP_HAS_SACK;
 			int maxSackCount = MAX_SACK_BLKS
-				- ((fFlags & FLAG_OPTION_TIMESTAMP) != 0) ? 1 : 0;
+				- ((fFlags & FLAG_OPTION_TIMESTAMP) != 0 ? 1 : 0);
 			memset(segment.sacks, 0, sizeof(segment.sacks));
 			segment.sackCount = fReceiveQueue.PopulateSackInfo(fReceiveNext,
 				maxSackCount, segment.sacks);
@@ -2042,6 +2384,8 @@ status_t
 TCPEndpoint::_PrepareAndSend(tcp_segment_header& segment, net_buffer* buffer,
 	bool isRetransmit)
 {
+	_UpdateRoute();
+
 	LocalAddress().CopyTo(buffer->source);
 	PeerAddress().CopyTo(buffer->destination);
 
@@ -2063,6 +2407,14 @@ TCPEndpoint::_PrepareAndSend(tcp_segment_header& segment, net_buffer* buffer,
 
 	PROBE(buffer, sendWindow);
 
+	uint32 segmentCount = 1;
+	if ((buffer->offload_flags & NET_BUFFER_SEGMENT_TCP) != 0) {
+		segmentCount = (segmentLength + buffer->segment_size - 1)
+			/ buffer->segment_size;
+		buffer->offload_flags |= NET_BUFFER_CHECKSUM_PARTIAL;
+	} else if ((_DeviceOffload() & NET_DEVICE_OFFLOAD_TX_CHECKSUM) != 0)
+		buffer->offload_flags |= NET_BUFFER_CHECKSUM_PARTIAL;
+
 	status_t status = add_tcp_header(AddressModule(), segment, buffer);
 	if (status != B_OK) {
 		gBufferModule->free(buffer);
@@ -2088,10 +2440,13 @@ TCPEndpoint::_PrepareAndSend(tcp_segment_header& segment, net_buffer* buffer,
 	if (fSendMax < fSendNext)
 		fSendMax = fSendNext;
 
+	if (segmentLength != 0 && !isRetransmit)
+		fTransmitTimeline.Sent(fSendNext, system_time());
+
 	fReceiveMaxAdvertised = fReceiveNext + segment.AdvertisedWindow(fReceiveWindowShift);
 
 	if (segmentLength != 0 && fState == ESTABLISHED)
-		--fSendMaxSegments;
+		fSendMaxSegments -= min_c(segmentCount, fSendMaxSegments);
 
 	if (fSendTime == 0 && !isRetransmit
 			&& (segmentLength != 0 || (segment.flags & TCP_FLAG_SYNCHRONIZE) != 0)) {
@@ -2122,7 +2477,7 @@ TCPEndpoint::_ShouldSendSegment(tcp_segment_header& segment, uint32 length,
 		// - the buffer is at least larger than half of the maximum send window,
 		//   or
 		// - we're retransmitting data
-		if (length == segmentMaxSize
+		if (length >= segmentMaxSize
 			|| (fOptions & TCP_NODELAY) != 0
 			|| tcp_sequence(fSendNext + length) == fSendQueue.LastSequence()
 			|| (fSendMaxWindow > 0 && length >= fSendMaxWindow / 2))
@@ -2222,16 +2577,34 @@ TCPEndpoint::_SendQueued(bool force)
 
 	bool shouldStartRetransmitTimer = fSendNext == fSendUnacknowledged;
 	bool retransmit = fSendNext < fSendMax;
+	bool sentData = false;
 
 	if (fDuplicateAcknowledgeCount != 0) {
 		// send at most 1 SMSS of data when under limited transmit, fast transmit/recovery
 		length = min_c(length, fSendMaxSegmentSize);
 	}
 
+	// new data can be handed over in several segments at once, if the device
+	// (or the stack right in front of it) cuts them
+	bool offloadSegmentation = !retransmit && (_DeviceOffload()
+		& (NET_DEVICE_OFFLOAD_TSO4 | NET_DEVICE_OFFLOAD_TSO6
+			| NET_DEVICE_OFFLOAD_GSO)) != 0;
+
 	do {
 		uint32 segmentMaxSize = fSendMaxSegmentSize
 			- tcp_options_length(segment);
 		uint32 segmentLength = min_c(length, segmentMaxSize);
+		uint32 segmentCount = 1;
+
+		if (offloadSegmentation && length >= 2 * segmentMaxSize
+			&& fSendUrgentOffset <= fSendNext) {
+			segmentCount = min_c(length, TCP_MAX_OFFLOAD_SIZE) / segmentMaxSize;
+			if (fState == ESTABLISHED) {
+				segmentCount = max_c(min_c(segmentCount, fSendMaxSegments),
+					1);
+			}
+			segmentLength = segmentCount * segmentMaxSize;
+		}
 
 		if ((fSendNext + segmentLength) == fSendQueue.LastSequence() && !force) {
 			if (state_needs_finish(fState))
@@ -2254,6 +2627,11 @@ TCPEndpoint::_SendQueued(bool force)
 		if (buffer == NULL)
 			return B_NO_MEMORY;
 
+		if (segmentCount > 1) {
+			buffer->offload_flags = NET_BUFFER_SEGMENT_TCP;
+			buffer->segment_size = segmentMaxSize;
+		}
+
 		status_t status = B_OK;
 		if (segmentLength > 0)
 			status = fSendQueue.Get(buffer, fSendNext, segmentLength);
@@ -2268,6 +2646,9 @@ TCPEndpoint::_SendQueued(bool force)
 		if (status != B_OK)
 			return status;
 
+		if (segmentLength > 0)
+			sentData = true;
+
 		if (shouldStartRetransmitTimer) {
 			TRACE("starting initial retransmit timer of: %" B_PRIdBIGTIME,
 				fRetransmitTimeout);
@@ -2285,10 +2666,78 @@ TCPEndpoint::_SendQueued(bool force)
 
 	} while (length > 0);
 
+	if (sentData && !retransmit)
+		_ArmTailLossProbe();
+
 	return B_OK;
 }
 
 
+/*!	Replaces the congestion control algorithm; a connection in progress
+	keeps its current window.
+*/
+status_t
+TCPEndpoint::_SetCongestionControl(const char* name)
+{
+	CongestionControl* control;
+	status_t status = create_congestion_control(name, fCongestionWindow,
+		fSlowStartThreshold, &control);
+	if (status != B_OK)
+		return status;
+
+	control->SetMaxSegmentSize(fSendMaxSegmentSize);
+
+	delete fCongestionControl;
+	fCongestionControl = control;
+	return B_OK;
+}
+
+
+/*!	Looks up the route to the peer again if the routing table has changed
+	since it was cached. If there is no route anymore, the connection keeps
+	using the one it has.
+*/
+void
+TCPEndpoint::_UpdateRoute()
+{
+	int32 generation = atomic_get(&Domain()->route_generation);
+	if (generation == fRouteGeneration || (fFlags & FLAG_LOCAL) != 0)
+		return;
+
+	fRouteGeneration = generation;
+
+	net_route* route = gDatalinkModule->get_route(Domain(), *PeerAddress());
+	if (route == NULL)
+		return;
+
+	gDatalinkModule->put_route(Domain(), fRoute);
+	fRoute = route;
+}
+
+
+/*!	Returns the NET_DEVICE_OFFLOAD_* capabilities of the device the
+	connection is routed over that apply to its address family.
+*/
+uint32
+TCPEndpoint::_DeviceOffload() const
+{
+	if (fRoute == NULL || (fFlags & FLAG_LOCAL) != 0)
+		return 0;
+
+	net_interface* interface = fRoute->interface_address->interface;
+	if (interface == NULL || interface->device == NULL)
+		return 0;
+
+	uint32 offload = interface->device->offload;
+	if (Domain()->family == AF_INET6)
+		offload &= ~NET_DEVICE_OFFLOAD_TSO4;
+	else
+		offload &= ~NET_DEVICE_OFFLOAD_TSO6;
+
+	return offload;
+}
+
+
 int
 TCPEndpoint::_MaxSegmentSize(const sockaddr* address) const
 {
@@ -2300,6 +2749,7 @@ status_t
 TCPEndpoint::_PrepareSendPath(const sockaddr* peer)
 {
 	if (fRoute == NULL) {
+		fRouteGeneration = atomic_get(&Domain()->route_generation);
 		fRoute = gDatalinkModule->get_route(Domain(), peer);
 		if (fRoute == NULL)
 			return ENETUNREACH;
@@ -2347,8 +2797,13 @@ TCPEndpoint::_Acknowledged(tcp_segment_header& segment)
 
 	ASSERT(fSendUnacknowledged <= segment.acknowledge);
 
+	bool sackRecovery = _IsSackEnabled() && (fFlags & FLAG_RECOVERY) != 0;
+
 	if (fSendUnacknowledged < segment.acknowledge) {
 		fSendQueue.RemoveUntil(segment.acknowledge);
+		fSackScoreboard.RemoveUntil(segment.acknowledge);
+		fTransmitTimeline.RemoveUntil(segment.acknowledge);
+		fFlags &= ~FLAG_TAIL_LOSS_PROBE;
 
 		uint32 bytesAcknowledged = segment.acknowledge - fSendUnacknowledged.Number();
 		fPreviousHighestAcknowledge = fSendUnacknowledged;
@@ -2361,25 +2816,27 @@ TCPEndpoint::_Acknowledged(tcp_segment_header& segment)
 			fRecover = segment.acknowledge - 1;
 		}
 
-		// the acknowledgment of the SYN/ACK MUST NOT increase the size of the congestion window
-		if (fSendUnacknowledged != fInitialSendSequence) {
-			if (fCongestionWindow < fSlowStartThreshold)
-				fCongestionWindow += min_c(bytesAcknowledged, fSendMaxSegmentSize);
-			else {
-				uint32 increment = fSendMaxSegmentSize * fSendMaxSegmentSize;
-
-				if (increment < fCongestionWindow)
-					increment = 1;
-				else
-					increment /= fCongestionWindow;
-
-				fCongestionWindow += increment;
-			}
+		if (fState >= ESTABLISHED)
+			_ReportDelivery();
 
+		// the acknowledgment of the SYN/ACK MUST NOT increase the size of the
+		// congestion window, and neither does SACK based loss recovery
+		if (fSendUnacknowledged != fInitialSendSequence && !sackRecovery) {
+			fCongestionControl->Acknowledged(bytesAcknowledged, flightSize,
+				system_time());
 			fSendMaxSegments = UINT32_MAX;
 		}
 
-		if ((fFlags & FLAG_RECOVERY) != 0) {
+		if (sackRecovery) {
+			if (segment.acknowledge > fRecover) {
+				// all data outstanding when the loss was detected arrived
+				fCongestionControl->RecoveryFinished(flightSize);
+				fFlags &= ~FLAG_RECOVERY;
+				fDuplicateAcknowledgeCount = 0;
+				sackRecovery = false;
+			} else
+				_SendSackRecovery();
+		} else if ((fFlags & FLAG_RECOVERY) != 0) {
 			fSendNext = fSendUnacknowledged;
 			_SendQueued();
 			fCongestionWindow -= bytesAcknowledged;
@@ -2406,11 +2863,14 @@ TCPEndpoint::_Acknowledged(tcp_segment_header& segment)
 			TRACE("all acknowledged, cancelling retransmission timer.");
 			gStackModule->cancel_timer(&fRetransmitTimer);
 			T(TimerSet(this, "retransmit", -1));
+			gStackModule->cancel_timer(&fTailLossProbeTimer);
+			T(TimerSet(this, "tail loss probe", -1));
 		} else {
 			TRACE("data acknowledged, resetting retransmission timer to: %"
 				B_PRIdBIGTIME, fRetransmitTimeout);
 			gStackModule->set_timer(&fRetransmitTimer, fRetransmitTimeout);
 			T(TimerSet(this, "retransmit", fRetransmitTimeout));
+			_ArmTailLossProbe();
 		}
 
 		if (is_writable(fState)) {
@@ -2421,7 +2881,7 @@ TCPEndpoint::_Acknowledged(tcp_segment_header& segment)
 	}
 
 	// if there is data left to be sent, send it now
-	if (fSendQueue.Used() > 0)
+	if (fSendQueue.Used() > 0 && !sackRecovery)
 		_SendQueued();
 }
 
@@ -2435,7 +2895,8 @@ TCPEndpoint::_Retransmit()
 		fRetransmitTimeout = TCP_SYN_RETRANSMIT_TIMEOUT;
 		fCongestionWindow = fSendMaxSegmentSize;
 	} else {
-		_ResetSlowStart();
+		fCongestionControl->RetransmitTimeout(
+			(fSendMax - fSendUnacknowledged).Number());
 		fDuplicateAcknowledgeCount = 0;
 		// Do exponential back off of the retransmit timeout
 		fRetransmitTimeout *= 2;
@@ -2443,6 +2904,12 @@ TCPEndpoint::_Retransmit()
 			fRetransmitTimeout = TCP_MAX_RETRANSMIT_TIMEOUT;
 	}
 
+	// the receiver is allowed to discard data it has SACKed (RFC 2018)
+	fSackScoreboard.Reset();
+	fTransmitTimeline.Reset();
+	fFlags &= ~FLAG_TAIL_LOSS_PROBE;
+	gStackModule->cancel_timer(&fTailLossProbeTimer);
+
 	fSendNext = fSendUnacknowledged;
 	_SendQueued();
 
@@ -2476,17 +2943,28 @@ TCPEndpoint::_UpdateRoundTripTime(int32 roundTripTime, int32 expectedSamples)
 	if (fRetransmitTimeout < TCP_MIN_RETRANSMIT_TIMEOUT)
 		fRetransmitTimeout = TCP_MIN_RETRANSMIT_TIMEOUT;
 
+	bigtime_t sample = (bigtime_t)roundTripTime * kTimestampFactor;
+	if (fMinRoundTripTime == 0 || sample < fMinRoundTripTime)
+		fMinRoundTripTime = sample;
+	fCongestionControl->RoundTripTimeSample(sample, system_time());
+
 	TRACE("  RTO is now %" B_PRIdBIGTIME " (after rtt %" B_PRId32 "ms)",
 		fRetransmitTimeout, roundTripTime);
 }
 
 
+/*!	Tells the congestion control how much data has been delivered to the
+	peer so far, either cumulatively acknowledged, or SACKed.
+*/
 void
-TCPEndpoint::_ResetSlowStart()
+TCPEndpoint::_ReportDelivery()
 {
-	fSlowStartThreshold = max_c((fSendMax - fSendUnacknowledged).Number() / 2,
-		2 * fSendMaxSegmentSize);
-	fCongestionWindow = fSendMaxSegmentSize;
+	uint32 delivered = (fSendUnacknowledged - fInitialSendSequence).Number()
+		+ fSackScoreboard.SackedBytes();
+	uint32 flightSize = (fSendMax - fSendUnacknowledged).Number()
+		- fSackScoreboard.SackedBytes();
+
+	fCongestionControl->Delivered(delivered, flightSize, system_time());
 }
 
 
@@ -2543,6 +3021,24 @@ TCPEndpoint::_DelayedAcknowledgeTimer(net_timer* timer, void* _endpoint)
 }
 
 
+/*static*/ void
+TCPEndpoint::_TailLossProbeTimer(net_timer* timer, void* _endpoint)
+{
+	TCPEndpoint* endpoint = (TCPEndpoint*)_endpoint;
+	T(TimerTriggered(endpoint, "tail loss probe"));
+
+	MutexLocker locker(endpoint->fLock);
+	if (!locker.IsLocked() || gStackModule->is_timer_active(timer))
+		return;
+
+	// the timer might not have been canceled early enough
+	if (endpoint->State() == CLOSED)
+		return;
+
+	endpoint->_SendTailLossProbe();
+}
+
+
 /*static*/ void
 TCPEndpoint::_TimeWaitTimer(net_timer* timer, void* _endpoint)
 {
@@ -2628,10 +3124,15 @@ TCPEndpoint::Dump() const
 		fInitialReceiveSequence.Number());
 	kprintf("    duplicate acknowledge count: %" B_PRIu32 "\n",
 		fDuplicateAcknowledgeCount);
+	kprintf("    high retransmitted: %" B_PRIu32 "\n",
+		fHighRetransmitted.Number());
+	fSackScoreboard.Dump();
 	kprintf("  smoothed round trip time: %" B_PRId32 " (deviation %" B_PRId32 ")\n",
 		fSmoothedRoundTripTime, fRoundTripVariation);
+	kprintf("  min round trip time: %" B_PRIdBIGTIME "\n", fMinRoundTripTime);
 	kprintf("  retransmit timeout: %" B_PRId64 "\n", fRetransmitTimeout);
 	kprintf("  congestion window: %" B_PRIu32 "\n", fCongestionWindow);
 	kprintf("  slow start threshold: %" B_PRIu32 "\n", fSlowStartThreshold);
+	fCongestionControl->Dump();
 }
 
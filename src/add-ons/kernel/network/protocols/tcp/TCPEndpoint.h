@@ -12,7 +12,10 @@
 
 
 #include "BufferQueue.h"
+#include "CongestionControl.h"
 #include "EndpointManager.h"
+#include "SackScoreboard.h"
+#include "TransmitTimeline.h"
 #include "tcp.h"
 
 #include <ProtocolUtilities.h>
@@ -57,6 +60,7 @@ public:
 			status_t	SetOption(int option, const void* value, int length);
 
 			tcp_state	State() const { return fState; }
+			uid_t		Owner() const { return fOwner; }
 			bool		IsBound() const;
 			bool		IsLocal() const;
 
@@ -82,6 +86,7 @@ private:
 							bool isRetransmit);
 			status_t	_SendAcknowledge(bool force = false);
 			status_t	_SendQueued(bool force = false);
+			status_t	_SetCongestionControl(const char* name);
 
 			status_t	_Disconnect(bool closing);
 			ssize_t		_AvailableData() const;
@@ -108,17 +113,29 @@ private:
 			int			_MaxSegmentSize(const struct sockaddr* address) const;
 			void		_PrepareReceivePath(tcp_segment_header& segment);
 			status_t	_PrepareSendPath(const sockaddr* peer);
+			void		_UpdateRoute();
+			uint32		_DeviceOffload() const;
 			void		_Acknowledged(tcp_segment_header& segment);
 			void		_Retransmit();
 			void		_UpdateRoundTripTime(int32 roundTripTime, int32 expectedSamples);
-			void		_ResetSlowStart();
+			void		_ReportDelivery();
 			void		_DuplicateAcknowledge(tcp_segment_header& segment);
+			bool		_IsSackEnabled() const;
+			void		_EnterSackRecovery();
+			void		_SendSackRecovery();
+			status_t	_SendSegmentAt(tcp_sequence sequence, uint32 length,
+							uint32& _sent);
+			void		_DetectLostByTime();
+			void		_ArmTailLossProbe();
+			void		_SendTailLossProbe();
 
 	static	void		_TimeWaitTimer(net_timer* timer, void* _endpoint);
 	static	void		_RetransmitTimer(net_timer* timer, void* _endpoint);
 	static	void		_PersistTimer(net_timer* timer, void* _endpoint);
 	static	void		_DelayedAcknowledgeTimer(net_timer* timer,
 							void* _endpoint);
+	static	void		_TailLossProbeTimer(net_timer* timer,
+							void* _endpoint);
 
 	static	status_t	_WaitForCondition(ConditionVariable& condition,
 							MutexLocker& locker, bigtime_t timeout);
@@ -126,9 +143,13 @@ private:
 private:
 	TCPEndpoint*	fConnectionHashLink;
 	TCPEndpoint*	fEndpointHashLink;
+	DoublyLinkedListLink<TCPEndpoint> fReusePortLink;
+	ReusePortGroup*	fReusePortGroup;
+	uid_t			fOwner;
 	friend class	EndpointManager;
 	friend struct	ConnectionHashDefinition;
 	friend class	EndpointHashDefinition;
+	friend struct	ReusePortGroup;
 
 	mutex			fLock;
 	EndpointManager* fManager;
@@ -157,10 +178,16 @@ private:
 	uint32			fDuplicateAcknowledgeCount;
 	uint32			fPreviousFlightSize;
 	uint32			fRecover;
+	SackScoreboard	fSackScoreboard;
+	tcp_sequence	fHighRetransmitted;
+	TransmitTimeline fTransmitTimeline;
+	tcp_sequence	fTailLossProbeEnd;
+	bigtime_t		fTailLossProbeTime;
 
 	net_route		*fRoute;
-		// TODO: don't use a net_route, but a net_route_info!!!
-		// (the latter will automatically adapt to routing changes)
+	int32			fRouteGeneration;
+		// the route is looked up again when the domain's route generation
+		// no longer matches
 
 	tcp_sequence	fReceiveNext;
 	tcp_sequence	fReceiveMaxAdvertised;
@@ -177,11 +204,13 @@ private:
 	uint32			fSendTime;
 	tcp_sequence	fRoundTripStartSequence;
 	bigtime_t		fRetransmitTimeout;
+	bigtime_t		fMinRoundTripTime;
 
 	uint32			fReceivedTimestamp;
 
 	uint32			fCongestionWindow;
 	uint32			fSlowStartThreshold;
+	CongestionControl* fCongestionControl;
 
 	tcp_state		fState;
 	uint32			fFlags;
@@ -191,6 +220,7 @@ private:
 	net_timer		fPersistTimer;
 	net_timer		fDelayedAcknowledgeTimer;
 	net_timer		fTimeWaitTimer;
+	net_timer		fTailLossProbeTimer;
 };
 
 #endif	// TCP_ENDPOINT_H
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "TransmitTimeline.h"
+
+
+TransmitTimeline::TransmitTimeline()
+	:
+	fFirst(0),
+	fCount(0)
+{
+}
+
+
+void
+TransmitTimeline::Reset()
+{
+	fFirst = 0;
+	fCount = 0;
+}
+
+
+/*!	Records that the data up to \a end has been sent at \a time. The data
+	must follow the data recorded before.
+	A record always carries the time its last byte was sent, so that no byte
+	is considered older than it is.
+*/
+void
+TransmitTimeline::Sent(tcp_sequence end, bigtime_t time)
+{
+	if (fCount > 0) {
+		Record& last = _RecordAt(fCount - 1);
+		if (end <= last.end)
+			return;
+
+		if (time - last.time < kCoalesceTime) {
+			last.end = end;
+			last.time = time;
+			return;
+		}
+	}
+
+	if (fCount == kMaxRecords) {
+		// forget the oldest record
+		fFirst = (fFirst + 1) % kMaxRecords;
+		fCount--;
+	}
+
+	Record& record = _RecordAt(fCount++);
+	record.end = end;
+	record.time = time;
+}
+
+
+/*!	Forgets about everything below \a sequence, as it has been acknowledged
+	cumulatively.
+*/
+void
+TransmitTimeline::RemoveUntil(tcp_sequence sequence)
+{
+	while (fCount > 0 && _RecordAt(0).end <= sequence) {
+		fFirst = (fFirst + 1) % kMaxRecords;
+		fCount--;
+	}
+}
+
+
+/*!	Retrieves the time the byte at \a sequence was sent. */
+bool
+TransmitTimeline::TimeOf(tcp_sequence sequence, bigtime_t& _time) const
+{
+	for (int32 i = 0; i < fCount; i++) {
+		const Record& record = _RecordAt(i);
+		if (sequence < record.end) {
+			if (i == 0 && fCount == kMaxRecords) {
+				// the start of the oldest record is unknown
+				return false;
+			}
+
+			_time = record.time;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/*!	Retrieves the end of the data that was completely sent at or before
+	\a time.
+*/
+bool
+TransmitTimeline::SentBefore(bigtime_t time, tcp_sequence& _end) const
+{
+	for (int32 i = fCount - 1; i >= 0; i--) {
+		const Record& record = _RecordAt(i);
+		if (record.time <= time) {
+			_end = record.end;
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef TRANSMIT_TIMELINE_H
+#define TRANSMIT_TIMELINE_H
+
+
+#include "tcp.h"
+
+
+/*!	Remembers when the data in flight was first sent, so that losses can be
+	detected by time instead of by counting duplicate acknowledgements, as
+	RACK (RFC 8985) does: once data is delivered, everything that was sent
+	sufficiently long before it must have been lost.
+
+	Only original transmissions are recorded, and only for the most recent
+	kMaxRecords bursts; older data is left to the other loss detection
+	mechanisms.
+*/
+class TransmitTimeline {
+public:
+								TransmitTimeline();
+
+			void				Reset();
+			bool				IsEmpty() const { return fCount == 0; }
+
+			void				Sent(tcp_sequence end, bigtime_t time);
+			void				RemoveUntil(tcp_sequence sequence);
+
+			bool				TimeOf(tcp_sequence sequence,
+									bigtime_t& _time) const;
+			bool				SentBefore(bigtime_t time,
+									tcp_sequence& _end) const;
+
+private:
+			struct Record {
+				tcp_sequence	end;
+				bigtime_t		time;
+			};
+
+			Record&				_RecordAt(int32 index)
+									{ return fRecords[(fFirst + index)
+										% kMaxRecords]; }
+			const Record&		_RecordAt(int32 index) const
+									{ return fRecords[(fFirst + index)
+										% kMaxRecords]; }
+
+	static	const int32			kMaxRecords = 64;
+	static	const bigtime_t		kCoalesceTime = 500;
+				// data sent this close together shares a record
+
+			Record				fRecords[kMaxRecords];
+			int32				fFirst;
+			int32				fCount;
+};
+
+
+#endif	// TRANSMIT_TIMELINE_H
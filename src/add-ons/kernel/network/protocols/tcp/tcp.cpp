@@ -9,6 +9,7 @@
  */
 
 
+#include "CongestionControl.h"
 #include "EndpointManager.h"
 #include "TCPEndpoint.h"
 #include "tcp.h"
@@ -17,6 +18,7 @@
 #include <net_stat.h>
 
 #include <KernelExport.h>
+#include <driver_settings.h>
 #include <util/list.h>
 
 #include <netinet/in.h>
@@ -433,8 +435,16 @@ add_tcp_header(net_address_module_info* addressModule,
 		"win %u\n", buffer, segment.flags, segment.sequence,
 		segment.acknowledge, segment.urgent_offset, segment.advertised_window));
 
-	*TCPChecksumField(buffer) = Checksum::PseudoHeader(addressModule,
-		gBufferModule, buffer, IPPROTO_TCP);
+	if ((buffer->offload_flags & NET_BUFFER_CHECKSUM_PARTIAL) != 0) {
+		// the device, or the stack right in front of it, will complete it
+		buffer->checksum_offset = offsetof(tcp_header, checksum);
+		buffer->transport_size = buffer->size;
+		*TCPChecksumField(buffer) = Checksum::PartialPseudoHeader(
+			addressModule, buffer, IPPROTO_TCP);
+	} else {
+		*TCPChecksumField(buffer) = Checksum::PseudoHeader(addressModule,
+			gBufferModule, buffer, IPPROTO_TCP);
+	}
 
 	return B_OK;
 }
@@ -698,7 +708,8 @@ tcp_receive_data(net_buffer* buffer)
 	if (headerLength < sizeof(tcp_header))
 		return B_BAD_DATA;
 
-	if (Checksum::PseudoHeader(addressModule, gBufferModule, buffer,
+	if ((buffer->offload_flags & NET_BUFFER_CHECKSUM_VALID) == 0
+		&& Checksum::PseudoHeader(addressModule, gBufferModule, buffer,
 			IPPROTO_TCP) != 0)
 		return B_BAD_DATA;
 
@@ -817,6 +828,18 @@ tcp_init()
 	if (status < B_OK)
 		return status;
 
+	// the system wide default congestion control algorithm, which sockets
+	// can override with the TCP_CONGESTION option
+	void* settings = load_driver_settings("tcp");
+	if (settings != NULL) {
+		const char* name = get_driver_parameter(settings,
+			"congestion_control", NULL, NULL);
+		if (name != NULL && set_default_congestion_control(name) != B_OK)
+			dprintf("tcp: unknown congestion control \"%s\"\n", name);
+
+		unload_driver_settings(settings);
+	}
+
 	add_debugger_command("tcp_endpoints", dump_endpoints,
 		"lists all open TCP endpoints");
 	add_debugger_command("tcp_endpoint", dump_endpoint,
@@ -186,6 +186,9 @@ operator==(tcp_sequence a, tcp_sequence b)
 #define TCP_MAX_WINDOW					65535
 #define TCP_MAX_SEGMENT_LIFETIME		60000000	// 60 secs
 #define TCP_PERSIST_TIMEOUT				1000000		// 1 sec
+#define TCP_MAX_OFFLOAD_SIZE			65415
+	// the data of a segment to be cut by the device: 64 KB minus the largest
+	// IP and TCP headers
 
 // Initial estimate for packet round trip time (RTT)
 #define TCP_INITIAL_RTT					2000000		// 2 secs
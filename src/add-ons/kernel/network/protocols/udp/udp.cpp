@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2021, Haiku, Inc. All Rights Reserved.
+ * Copyright 2006-2026, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -10,6 +10,7 @@
 
 #include <net_buffer.h>
 #include <net_datalink.h>
+#include <net_device.h>
 #include <net_protocol.h>
 #include <net_stack.h>
 
@@ -28,9 +29,11 @@
 #include <algorithm>
 #include <netinet/in.h>
 #include <netinet/ip.h>
+#include <netinet/udp.h>
 #include <new>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <utility>
 
 
@@ -73,11 +76,17 @@ struct udp_header {
 typedef NetBufferField<uint16, offsetof(udp_header, udp_checksum)>
 	UDPChecksumField;
 
+static const uint32 kMaxNetworkHeaderSize = 60;
+	// of IPv4 with options, to decide whether a datagram is fragmented
+static const uint32 kMaxSegments = 64;
+	// datagrams that may be sent from, or received into a single buffer
+
 class UdpDomainSupport;
 
 class UdpEndpoint : public net_protocol, public DatagramSocket<> {
 public:
 								UdpEndpoint(net_socket* socket);
+								~UdpEndpoint();
 
 			status_t			Bind(const sockaddr* newAddr);
 			status_t			Unbind(sockaddr* newAddr);
@@ -91,6 +100,12 @@ public:
 									net_route* route);
 			status_t			SendData(net_buffer* buffer);
 
+			void				InvalidateRoute();
+
+			status_t			GetOption(int option, void* value, int* _length);
+			status_t			SetOption(int option, const void* value,
+									int length);
+
 			ssize_t				BytesAvailable();
 			status_t			FetchData(size_t numBytes, uint32 flags,
 									net_buffer** _buffer);
@@ -98,6 +113,9 @@ public:
 			status_t			StoreData(net_buffer* buffer);
 			status_t			DeliverData(net_buffer* buffer);
 
+			ssize_t				ProcessAncillaryData(net_buffer* buffer,
+									void* data, size_t dataSize);
+
 			// only the domain support will change/check the Active flag so
 			// we don't really need to protect it with the socket lock.
 			bool				IsActive() const { return fActive; }
@@ -105,9 +123,20 @@ public:
 
 			UdpEndpoint*&		HashTableLink() { return fLink; }
 
+			uid_t				Owner() const { return fOwner; }
+
 			void				Dump() const;
 
 private:
+			bool				_CanOffloadChecksum(net_buffer* buffer,
+									net_route* route) const;
+			status_t			_SendDatagram(net_buffer* buffer,
+									net_route* route);
+			status_t			_SendConnectedData(net_buffer* buffer);
+			void				_UpdateRoute();
+			void				_CoalesceReceived(net_buffer* buffer,
+									size_t numBytes);
+
 			UdpDomainSupport*	fManager;
 			bool				fActive;
 									// an active UdpEndpoint is part of the
@@ -115,6 +144,17 @@ private:
 									// optionally connected)
 
 			UdpEndpoint*		fLink;
+			uid_t				fOwner;
+
+			rw_lock				fRouteLock;
+			net_route*			fRoute;
+			int32				fRouteGeneration;
+									// the route to the peer of a connected
+									// endpoint, valid as long as the
+									// domain's route generation matches
+
+			uint16				fSegmentSize;
+			bool				fCoalesceReceived;
 };
 
 
@@ -192,6 +232,9 @@ private:
 
 	UdpEndpoint *_FindActiveEndpoint(const sockaddr *ourAddress,
 		const sockaddr *peerAddress, uint32 index = 0);
+	UdpEndpoint *_SelectReusePortEndpoint(UdpEndpoint *endpoint,
+		const sockaddr *ourAddress, const sockaddr *peerAddress,
+		uint32 index);
 	status_t _DemuxBroadcast(net_buffer *buffer);
 	status_t _DemuxUnicast(net_buffer *buffer);
 
@@ -352,6 +395,7 @@ UdpDomainSupport::ConnectEndpoint(UdpEndpoint *endpoint,
 		// [Stevens-UNP1, p226]: specifying AF_UNSPEC requests a "disconnect",
 		// so we reset the peer address:
 		endpoint->PeerAddress().SetToEmpty();
+		endpoint->InvalidateRoute();
 	} else {
 		if (!AddressModule()->is_same_family(address))
 			return EAFNOSUPPORT;
@@ -369,6 +413,9 @@ UdpDomainSupport::ConnectEndpoint(UdpEndpoint *endpoint,
 		status_t status = endpoint->PeerAddress().SetTo(address);
 		if (status < B_OK)
 			return status;
+
+		endpoint->InvalidateRoute();
+
 		struct net_route *routeToDestination
 			= gDatalinkModule->get_route(fDomain, address);
 		if (routeToDestination) {
@@ -456,10 +503,12 @@ UdpDomainSupport::_Bind(UdpEndpoint *endpoint, const sockaddr *address)
 				|| (socketOptions & (SO_REUSEADDR | SO_REUSEPORT)) == 0)
 				return EADDRINUSE;
 
-			// if both addresses are the same, SO_REUSEPORT is required:
+			// if both addresses are the same, SO_REUSEPORT is required, and
+			// both endpoints must belong to the same user:
 			if (otherEndpoint->LocalAddress().EqualTo(address, false)
 				&& ((otherEndpoint->Socket()->options & SO_REUSEPORT) == 0
-					|| (socketOptions & SO_REUSEPORT) == 0))
+					|| (socketOptions & SO_REUSEPORT) == 0
+					|| otherEndpoint->Owner() != endpoint->Owner()))
 				return EADDRINUSE;
 		}
 	}
@@ -528,6 +577,54 @@ UdpDomainSupport::_FindActiveEndpoint(const sockaddr *ourAddress,
 }
 
 
+/*!	Returns whether \a other shares the address of \a endpoint by means
+	of SO_REUSEPORT, and may receive datagrams from interface \a index.
+*/
+static bool
+is_reuse_port_member(UdpEndpoint* endpoint, UdpEndpoint* other, uint32 index)
+{
+	return (other->Socket()->options & SO_REUSEPORT) != 0
+		&& other->Owner() == endpoint->Owner()
+		&& (other->socket->bound_to_device == 0 || index == 0
+			|| other->socket->bound_to_device == index)
+		&& other->LocalAddress().EqualTo(*endpoint->LocalAddress(), true)
+		&& other->PeerAddress().EqualTo(*endpoint->PeerAddress(), true);
+}
+
+
+/*!	If \a endpoint is bound with SO_REUSEPORT, this spreads the datagrams
+	over all endpoints bound to the same address, keeping those of a peer
+	together. As _FindActiveEndpoint() returns the first matching endpoint,
+	all others follow it in its hash bucket.
+*/
+UdpEndpoint *
+UdpDomainSupport::_SelectReusePortEndpoint(UdpEndpoint *endpoint,
+	const sockaddr *ourAddress, const sockaddr *peerAddress, uint32 index)
+{
+	if ((endpoint->Socket()->options & SO_REUSEPORT) == 0)
+		return endpoint;
+
+	uint32 count = 0;
+	for (UdpEndpoint* other = endpoint; other != NULL;
+			other = other->HashTableLink()) {
+		if (is_reuse_port_member(endpoint, other, index))
+			count++;
+	}
+	if (count <= 1)
+		return endpoint;
+
+	uint32 selected = reuse_port_index(AddressModule(), ourAddress,
+		peerAddress, count);
+	for (UdpEndpoint* other = endpoint; other != NULL;
+			other = other->HashTableLink()) {
+		if (is_reuse_port_member(endpoint, other, index) && selected-- == 0)
+			return other;
+	}
+
+	return endpoint;
+}
+
+
 status_t
 UdpDomainSupport::_DemuxBroadcast(net_buffer* buffer)
 {
@@ -609,6 +706,8 @@ UdpDomainSupport::_DemuxUnicast(net_buffer* buffer)
 		return B_NAME_NOT_FOUND;
 	}
 
+	endpoint = _SelectReusePortEndpoint(endpoint, localAddress, peerAddress,
+		buffer->index);
 	endpoint->StoreData(buffer);
 	return B_OK;
 }
@@ -828,7 +927,8 @@ UdpEndpointManager::Deframe(net_buffer* buffer)
 	if (buffer->size > udpLength)
 		gBufferModule->trim(buffer, udpLength);
 
-	if (header.udp_checksum != 0) {
+	if (header.udp_checksum != 0
+		&& (buffer->offload_flags & NET_BUFFER_CHECKSUM_VALID) == 0) {
 		// check UDP-checksum (simulating a so-called "pseudo-header"):
 		uint16 sum = Checksum::PseudoHeader(addressModule, gBufferModule,
 			buffer, IPPROTO_UDP);
@@ -939,8 +1039,20 @@ UdpEndpointManager::_GetDomainSupport(net_buffer* buffer)
 UdpEndpoint::UdpEndpoint(net_socket *socket)
 	:
 	DatagramSocket<>("udp endpoint", socket),
-	fActive(false)
+	fActive(false),
+	fOwner(geteuid()),
+	fRoute(NULL),
+	fRouteGeneration(0),
+	fSegmentSize(0),
+	fCoalesceReceived(false)
 {
+	rw_lock_init(&fRouteLock, "udp endpoint route");
+}
+
+
+UdpEndpoint::~UdpEndpoint()
+{
+	rw_lock_destroy(&fRouteLock);
 }
 
 
@@ -1005,19 +1117,101 @@ UdpEndpoint::Free()
 {
 	TRACE_EP("Free()");
 	fManager->UnbindEndpoint(this);
+	InvalidateRoute();
 	return sUdpEndpointManager->FreeEndpoint(fManager);
 }
 
 
+// #pragma mark - options
+
+
+status_t
+UdpEndpoint::GetOption(int option, void *_value, int *_length)
+{
+	if (*_length != sizeof(int))
+		return B_BAD_VALUE;
+
+	int* value = (int*)_value;
+
+	switch (option) {
+		case UDP_SEGMENT:
+			*value = fSegmentSize;
+			return B_OK;
+
+		case UDP_GRO:
+			*value = fCoalesceReceived ? 1 : 0;
+			return B_OK;
+	}
+
+	return B_BAD_VALUE;
+}
+
+
+status_t
+UdpEndpoint::SetOption(int option, const void *_value, int length)
+{
+	if (length != sizeof(int))
+		return B_BAD_VALUE;
+
+	int value = *(const int*)_value;
+
+	switch (option) {
+		case UDP_SEGMENT:
+			if (value < 0 || value > int(0xffff - sizeof(udp_header)))
+				return B_BAD_VALUE;
+
+			fSegmentSize = value;
+			return B_OK;
+
+		case UDP_GRO:
+			fCoalesceReceived = value != 0;
+			return B_OK;
+	}
+
+	return B_BAD_VALUE;
+}
+
+
 // #pragma mark - outbound
 
 
+/*!	Sends \a buffer as a single datagram, or, if a segment size has been
+	set with \c UDP_SEGMENT, as a train of datagrams of that size; only the
+	last one may be shorter.
+*/
 status_t
 UdpEndpoint::SendRoutedData(net_buffer *buffer, net_route *route)
 {
 	TRACE_EP("SendRoutedData(%p [%" B_PRIu32 " bytes], %p)", buffer,
 		buffer->size, route);
 
+	uint32 segmentSize = fSegmentSize;
+	if (segmentSize == 0 || buffer->size <= segmentSize)
+		return _SendDatagram(buffer, route);
+
+	if (buffer->size > segmentSize * kMaxSegments)
+		return B_BAD_VALUE;
+
+	// the caller keeps the buffer, which is left with the last segment
+	while (buffer->size > segmentSize) {
+		net_buffer* segment = gBufferModule->split(buffer, segmentSize);
+		if (segment == NULL)
+			return B_NO_MEMORY;
+
+		status_t status = _SendDatagram(segment, route);
+		if (status != B_OK) {
+			gBufferModule->free(segment);
+			return status;
+		}
+	}
+
+	return _SendDatagram(buffer, route);
+}
+
+
+status_t
+UdpEndpoint::_SendDatagram(net_buffer *buffer, net_route *route)
+{
 	if (buffer->size > (0xffff - sizeof(udp_header)))
 		return EMSGSIZE;
 
@@ -1036,26 +1230,121 @@ UdpEndpoint::SendRoutedData(net_buffer *buffer, net_route *route)
 
 	header.Sync();
 
-	uint16 calculatedChecksum = Checksum::PseudoHeader(AddressModule(),
-		gBufferModule, buffer, IPPROTO_UDP);
-	if (calculatedChecksum == 0)
-		calculatedChecksum = 0xffff;
+	if (_CanOffloadChecksum(buffer, route)) {
+		buffer->offload_flags |= NET_BUFFER_CHECKSUM_PARTIAL;
+		buffer->checksum_offset = offsetof(udp_header, udp_checksum);
+		buffer->transport_size = buffer->size;
+		*UDPChecksumField(buffer) = Checksum::PartialPseudoHeader(
+			AddressModule(), buffer, IPPROTO_UDP);
+	} else {
+		uint16 calculatedChecksum = Checksum::PseudoHeader(AddressModule(),
+			gBufferModule, buffer, IPPROTO_UDP);
+		if (calculatedChecksum == 0)
+			calculatedChecksum = 0xffff;
 
-	*UDPChecksumField(buffer) = calculatedChecksum;
+		*UDPChecksumField(buffer) = calculatedChecksum;
+	}
 
 	return next->module->send_routed_data(next, route, buffer);
 }
 
 
+/*!	Returns whether the device can compute the checksum of \a buffer;
+	datagrams that will be fragmented have to be checksummed up front.
+*/
+bool
+UdpEndpoint::_CanOffloadChecksum(net_buffer *buffer, net_route *route) const
+{
+	net_interface *interface = route->interface_address->interface;
+	if ((route->flags & RTF_LOCAL) != 0 || interface == NULL
+		|| interface->device == NULL
+		|| (interface->device->offload & NET_DEVICE_OFFLOAD_TX_CHECKSUM) == 0)
+		return false;
+
+	uint32 mtu = route->mtu != 0 ? route->mtu : interface->device->mtu;
+	return buffer->size + kMaxNetworkHeaderSize <= mtu;
+}
+
+
 status_t
 UdpEndpoint::SendData(net_buffer *buffer)
 {
 	TRACE_EP("SendData(%p [%" B_PRIu32 " bytes])", buffer, buffer->size);
 
+	if (fSocket->bound_to_device == 0 && !PeerAddress().IsEmpty(true)
+		&& AddressModule()->equal_addresses_and_ports(buffer->destination,
+			*PeerAddress())) {
+		return _SendConnectedData(buffer);
+	}
+
 	return gDatalinkModule->send_data(this, NULL, buffer);
 }
 
 
+/*!	Releases the route cached for the peer; the next datagram sent to the
+	peer will look it up again.
+*/
+void
+UdpEndpoint::InvalidateRoute()
+{
+	WriteLocker _(fRouteLock);
+
+	if (fRoute != NULL) {
+		gDatalinkModule->put_route(Domain(), fRoute);
+		fRoute = NULL;
+	}
+}
+
+
+/*!	Sends \a buffer to the peer of a connected endpoint over the cached
+	route, which spares the routing table lookup for every datagram.
+	The route lock is only held for reading while sending, so concurrent
+	senders do not serialize on it; the socket lock is not held at all, as
+	multicast datagrams may be looped back to this endpoint synchronously.
+*/
+status_t
+UdpEndpoint::_SendConnectedData(net_buffer *buffer)
+{
+	ReadLocker locker(fRouteLock);
+
+	if (fRoute == NULL
+		|| fRouteGeneration != atomic_get(&Domain()->route_generation)) {
+		locker.Unlock();
+		_UpdateRoute();
+		locker.Lock();
+
+		if (fRoute == NULL)
+			return ENETUNREACH;
+	}
+
+	// update the source address, as get_buffer_route() would
+	if (fRoute->interface_address != NULL
+		&& fRoute->interface_address->local != NULL) {
+		status_t status = AddressModule()->update_to(buffer->source,
+			fRoute->interface_address->local);
+		if (status != B_OK)
+			return status;
+	}
+
+	return SendRoutedData(buffer, fRoute);
+}
+
+
+void
+UdpEndpoint::_UpdateRoute()
+{
+	WriteLocker _(fRouteLock);
+
+	int32 generation = atomic_get(&Domain()->route_generation);
+	if (fRoute != NULL && fRouteGeneration == generation)
+		return;
+
+	gDatalinkModule->put_route(Domain(), fRoute);
+	fRoute = gDatalinkModule->get_route(Domain(), *PeerAddress());
+	fRouteGeneration = generation;
+}
+
+
 // #pragma mark - inbound
 
 
@@ -1078,12 +1367,65 @@ UdpEndpoint::FetchData(size_t numBytes, uint32 flags, net_buffer **_buffer)
 	if (status != B_OK)
 		return status;
 
+	if (fCoalesceReceived) {
+		if ((flags & MSG_PEEK) == 0)
+			_CoalesceReceived(*_buffer, numBytes);
+		else
+			(*_buffer)->segment_size = 0;
+	}
+
 	TRACE_EP("  FetchData(): returns buffer with %" B_PRIu32 " bytes",
 		(*_buffer)->size);
 	return B_OK;
 }
 
 
+/*!	Appends the datagrams that follow \a buffer in the queue to it, as long
+	as they are from the same sender, have the same size, and fit into
+	\a numBytes. A shorter datagram ends the train, as it would when it had
+	been sent with \c UDP_SEGMENT. The datagram size is left in the
+	buffer's \c segment_size, or zero if there was nothing to coalesce.
+*/
+void
+UdpEndpoint::_CoalesceReceived(net_buffer *buffer, size_t numBytes)
+{
+	uint32 segmentSize = buffer->size;
+	uint32 segments = 1;
+	buffer->segment_size = 0;
+
+	AutoLocker _(fLock);
+
+	while (segments < kMaxSegments && !fBuffers.IsEmpty()) {
+		net_buffer* next = fBuffers.Head();
+		if (next->size == 0 || next->size > segmentSize
+			|| buffer->size + next->size > numBytes
+			|| buffer->size + next->size > 0xffff - sizeof(udp_header)
+			|| !AddressModule()->equal_addresses_and_ports(next->source,
+				buffer->source)
+			|| !AddressModule()->equal_addresses(next->destination,
+				buffer->destination)) {
+			break;
+		}
+
+		fBuffers.RemoveHead();
+		fCurrentBytes -= next->size;
+
+		uint32 size = next->size;
+		if (gBufferModule->merge(buffer, next, true) != B_OK) {
+			// put it back in line
+			fBuffers.InsertBefore(fBuffers.Head(), next);
+			fCurrentBytes += next->size;
+			break;
+		}
+
+		buffer->segment_size = segmentSize;
+		segments++;
+		if (size < segmentSize)
+			break;
+	}
+}
+
+
 status_t
 UdpEndpoint::StoreData(net_buffer *buffer)
 {
@@ -1112,6 +1454,33 @@ UdpEndpoint::DeliverData(net_buffer *_buffer)
 }
 
 
+/*!	Adds the \c UDP_GRO control message for datagrams that have been
+	coalesced, after the ones of the network protocol.
+*/
+ssize_t
+UdpEndpoint::ProcessAncillaryData(net_buffer *buffer, void *data,
+	size_t dataSize)
+{
+	ssize_t bytesWritten = next->module->process_ancillary_data_no_container(
+		this, buffer, data, dataSize);
+	if (bytesWritten < 0 || !fCoalesceReceived || buffer->segment_size == 0)
+		return bytesWritten;
+
+	if (dataSize - bytesWritten < CMSG_SPACE(sizeof(int)))
+		return B_NO_MEMORY;
+
+	cmsghdr* header = (cmsghdr*)((uint8*)data + bytesWritten);
+	header->cmsg_len = CMSG_LEN(sizeof(int));
+	header->cmsg_level = IPPROTO_UDP;
+	header->cmsg_type = UDP_GRO;
+
+	int segmentSize = buffer->segment_size;
+	memcpy(CMSG_DATA(header), &segmentSize, sizeof(int));
+
+	return bytesWritten + CMSG_SPACE(sizeof(int));
+}
+
+
 void
 UdpEndpoint::Dump() const
 {
@@ -1198,6 +1567,9 @@ status_t
 udp_getsockopt(net_protocol *protocol, int level, int option, void *value,
 	int *length)
 {
+	if (level == IPPROTO_UDP)
+		return ((UdpEndpoint *)protocol)->GetOption(option, value, length);
+
 	return protocol->next->module->getsockopt(protocol->next, level, option,
 		value, length);
 }
@@ -1207,6 +1579,12 @@ status_t
 udp_setsockopt(net_protocol *protocol, int level, int option,
 	const void *value, int length)
 {
+	if (level == IPPROTO_UDP)
+		return ((UdpEndpoint *)protocol)->SetOption(option, value, length);
+	if (level == SOL_SOCKET
+		&& (option == SO_ATTACH_FILTER || option == SO_DETACH_FILTER))
+		return ((UdpEndpoint *)protocol)->SetFilter(option, value, length);
+
 	return protocol->next->module->setsockopt(protocol->next, level, option,
 		value, length);
 }
@@ -1354,8 +1732,8 @@ ssize_t
 udp_process_ancillary_data_no_container(net_protocol *protocol,
 	net_buffer* buffer, void *data, size_t dataSize)
 {
-	return protocol->next->module->process_ancillary_data_no_container(
-		protocol, buffer, data, dataSize);
+	return ((UdpEndpoint *)protocol)->ProcessAncillaryData(buffer, data,
+		dataSize);
 }
 
 
@@ -0,0 +1,391 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	The verifier, and the interpreter of classic BPF filter programs. */
+
+
+#include "bpf.h"
+
+#include <stdlib.h>
+
+
+static inline uint32
+read_big_endian(const uint8* data, uint32 size)
+{
+	switch (size) {
+		case 4:
+			return ((uint32)data[0] << 24) | ((uint32)data[1] << 16)
+				| ((uint32)data[2] << 8) | data[3];
+		case 2:
+			return ((uint32)data[0] << 8) | data[1];
+		default:
+			return data[0];
+	}
+}
+
+
+/*!	Loads \a size bytes at \a offset from the packet. Fails if they are
+	not part of it; the filter does not accept the packet then.
+*/
+static inline bool
+load_packet(const bpf_packet* packet, uint64 offset, uint32 size,
+	uint32& value)
+{
+	if (offset + size <= packet->data_length) {
+		value = read_big_endian(packet->data + offset, size);
+		return true;
+	}
+	if (offset > UINT32_MAX)
+		return false;
+
+	int64 result = bpf_load_slow(packet, offset, size);
+	if (result < 0)
+		return false;
+
+	value = result;
+	return true;
+}
+
+
+/*!	Checks that the \a instructions form a program that can be run safely:
+	all of them must be known, jumps must stay within the program, it
+	must end with a return, and the scratch memory must not be read before
+	it is written on every path that leads there. As jumps only ever go
+	forward, every program terminates.
+*/
+status_t
+bpf_validate(const bpf_insn* instructions, uint32 count)
+{
+	if (count == 0 || count > BPF_MAXINSNS
+		|| BPF_CLASS(instructions[count - 1].code) != BPF_RET)
+		return B_BAD_VALUE;
+
+	// the scratch memory words that are known to be written when an
+	// instruction is reached through a jump
+	uint16* written = (uint16*)malloc(count * sizeof(uint16));
+	if (written == NULL)
+		return B_NO_MEMORY;
+
+	for (uint32 i = 0; i < count; i++)
+		written[i] = 0xffff;
+
+	status_t status = B_OK;
+	uint16 memory = 0;
+
+	for (uint32 pc = 0; pc < count && status == B_OK; pc++) {
+		const bpf_insn& instruction = instructions[pc];
+		uint32 remaining = count - pc - 1;
+		memory &= written[pc];
+
+		switch (instruction.code) {
+			case BPF_LD | BPF_W | BPF_IMM:
+			case BPF_LD | BPF_W | BPF_ABS:
+			case BPF_LD | BPF_H | BPF_ABS:
+			case BPF_LD | BPF_B | BPF_ABS:
+			case BPF_LD | BPF_W | BPF_IND:
+			case BPF_LD | BPF_H | BPF_IND:
+			case BPF_LD | BPF_B | BPF_IND:
+			case BPF_LD | BPF_W | BPF_LEN:
+			case BPF_LDX | BPF_W | BPF_IMM:
+			case BPF_LDX | BPF_W | BPF_LEN:
+			case BPF_LDX | BPF_B | BPF_MSH:
+			case BPF_ALU | BPF_ADD | BPF_K:
+			case BPF_ALU | BPF_SUB | BPF_K:
+			case BPF_ALU | BPF_MUL | BPF_K:
+			case BPF_ALU | BPF_OR | BPF_K:
+			case BPF_ALU | BPF_AND | BPF_K:
+			case BPF_ALU | BPF_XOR | BPF_K:
+			case BPF_ALU | BPF_NEG:
+			case BPF_ALU | BPF_ADD | BPF_X:
+			case BPF_ALU | BPF_SUB | BPF_X:
+			case BPF_ALU | BPF_MUL | BPF_X:
+			case BPF_ALU | BPF_DIV | BPF_X:
+			case BPF_ALU | BPF_MOD | BPF_X:
+			case BPF_ALU | BPF_OR | BPF_X:
+			case BPF_ALU | BPF_AND | BPF_X:
+			case BPF_ALU | BPF_XOR | BPF_X:
+			case BPF_ALU | BPF_LSH | BPF_X:
+			case BPF_ALU | BPF_RSH | BPF_X:
+			case BPF_MISC | BPF_TAX:
+			case BPF_MISC | BPF_TXA:
+				break;
+
+			case BPF_LD | BPF_W | BPF_MEM:
+			case BPF_LDX | BPF_W | BPF_MEM:
+				if (instruction.k >= BPF_MEMWORDS
+					|| (memory & (1 << instruction.k)) == 0)
+					status = B_BAD_VALUE;
+				break;
+
+			case BPF_ST:
+			case BPF_STX:
+				if (instruction.k >= BPF_MEMWORDS)
+					status = B_BAD_VALUE;
+				else
+					memory |= 1 << instruction.k;
+				break;
+
+			case BPF_ALU | BPF_DIV | BPF_K:
+			case BPF_ALU | BPF_MOD | BPF_K:
+				if (instruction.k == 0)
+					status = B_BAD_VALUE;
+				break;
+
+			case BPF_ALU | BPF_LSH | BPF_K:
+			case BPF_ALU | BPF_RSH | BPF_K:
+				if (instruction.k >= 32)
+					status = B_BAD_VALUE;
+				break;
+
+			case BPF_JMP | BPF_JA:
+				if (instruction.k >= remaining) {
+					status = B_BAD_VALUE;
+					break;
+				}
+				written[pc + 1 + instruction.k] &= memory;
+				memory = 0xffff;
+				break;
+
+			case BPF_JMP | BPF_JEQ | BPF_K:
+			case BPF_JMP | BPF_JGT | BPF_K:
+			case BPF_JMP | BPF_JGE | BPF_K:
+			case BPF_JMP | BPF_JSET | BPF_K:
+			case BPF_JMP | BPF_JEQ | BPF_X:
+			case BPF_JMP | BPF_JGT | BPF_X:
+			case BPF_JMP | BPF_JGE | BPF_X:
+			case BPF_JMP | BPF_JSET | BPF_X:
+				if (instruction.jt >= remaining
+					|| instruction.jf >= remaining) {
+					status = B_BAD_VALUE;
+					break;
+				}
+				written[pc + 1 + instruction.jt] &= memory;
+				written[pc + 1 + instruction.jf] &= memory;
+				memory = 0xffff;
+				break;
+
+			case BPF_RET | BPF_K:
+			case BPF_RET | BPF_A:
+				memory = 0xffff;
+				break;
+
+			default:
+				status = B_BAD_VALUE;
+				break;
+		}
+	}
+
+	free(written);
+	return status;
+}
+
+
+/*!	Runs the validated filter program \a instructions on the \a packet,
+	and returns its result: the number of bytes of the packet to accept.
+*/
+uint32
+bpf_interpret(const bpf_insn* instructions, const bpf_packet* packet)
+{
+	uint32 a = 0;
+	uint32 x = 0;
+	uint32 memory[BPF_MEMWORDS];
+	const bpf_insn* pc = instructions;
+
+	while (true) {
+		uint32 k = pc->k;
+
+		switch (pc->code) {
+			case BPF_RET | BPF_K:
+				return k;
+			case BPF_RET | BPF_A:
+				return a;
+
+			case BPF_LD | BPF_W | BPF_ABS:
+				if (!load_packet(packet, k, 4, a))
+					return 0;
+				break;
+			case BPF_LD | BPF_H | BPF_ABS:
+				if (!load_packet(packet, k, 2, a))
+					return 0;
+				break;
+			case BPF_LD | BPF_B | BPF_ABS:
+				if (!load_packet(packet, k, 1, a))
+					return 0;
+				break;
+			case BPF_LD | BPF_W | BPF_IND:
+				if (!load_packet(packet, (uint64)x + k, 4, a))
+					return 0;
+				break;
+			case BPF_LD | BPF_H | BPF_IND:
+				if (!load_packet(packet, (uint64)x + k, 2, a))
+					return 0;
+				break;
+			case BPF_LD | BPF_B | BPF_IND:
+				if (!load_packet(packet, (uint64)x + k, 1, a))
+					return 0;
+				break;
+			case BPF_LDX | BPF_B | BPF_MSH:
+				if (!load_packet(packet, k, 1, x))
+					return 0;
+				x = (x & 0xf) << 2;
+				break;
+
+			case BPF_LD | BPF_W | BPF_LEN:
+				a = packet->length;
+				break;
+			case BPF_LDX | BPF_W | BPF_LEN:
+				x = packet->length;
+				break;
+			case BPF_LD | BPF_W | BPF_IMM:
+				a = k;
+				break;
+			case BPF_LDX | BPF_W | BPF_IMM:
+				x = k;
+				break;
+			case BPF_LD | BPF_W | BPF_MEM:
+				a = memory[k];
+				break;
+			case BPF_LDX | BPF_W | BPF_MEM:
+				x = memory[k];
+				break;
+			case BPF_ST:
+				memory[k] = a;
+				break;
+			case BPF_STX:
+				memory[k] = x;
+				break;
+
+			case BPF_JMP | BPF_JA:
+				pc += k;
+				break;
+			case BPF_JMP | BPF_JEQ | BPF_K:
+				pc += a == k ? pc->jt : pc->jf;
+				break;
+			case BPF_JMP | BPF_JGT | BPF_K:
+				pc += a > k ? pc->jt : pc->jf;
+				break;
+			case BPF_JMP | BPF_JGE | BPF_K:
+				pc += a >= k ? pc->jt : pc->jf;
+				break;
+			case BPF_JMP | BPF_JSET | BPF_K:
+				pc += (a & k) != 0 ? pc->jt : pc->jf;
+				break;
+			case BPF_JMP | BPF_JEQ | BPF_X:
+				pc += a == x ? pc->jt : pc->jf;
+				break;
+			case BPF_JMP | BPF_JGT | BPF_X:
+				pc += a > x ? pc->jt : pc->jf;
+				break;
+			case BPF_JMP | BPF_JGE | BPF_X:
+				pc += a >= x ? pc->jt : pc->jf;
+				break;
+			case BPF_JMP | BPF_JSET | BPF_X:
+				pc += (a & x) != 0 ? pc->jt : pc->jf;
+				break;
+
+			case BPF_ALU | BPF_ADD | BPF_K:
+				a += k;
+				break;
+			case BPF_ALU | BPF_SUB | BPF_K:
+				a -= k;
+				break;
+			case BPF_ALU | BPF_MUL | BPF_K:
+				a *= k;
+				break;
+			case BPF_ALU | BPF_DIV | BPF_K:
+				a /= k;
+				break;
+			case BPF_ALU | BPF_MOD | BPF_K:
+				a %= k;
+				break;
+			case BPF_ALU | BPF_OR | BPF_K:
+				a |= k;
+				break;
+			case BPF_ALU | BPF_AND | BPF_K:
+				a &= k;
+				break;
+			case BPF_ALU | BPF_XOR | BPF_K:
+				a ^= k;
+				break;
+			case BPF_ALU | BPF_LSH | BPF_K:
+				a <<= k;
+				break;
+			case BPF_ALU | BPF_RSH | BPF_K:
+				a >>= k;
+				break;
+			case BPF_ALU | BPF_NEG:
+				a = -a;
+				break;
+
+			case BPF_ALU | BPF_ADD | BPF_X:
+				a += x;
+				break;
+			case BPF_ALU | BPF_SUB | BPF_X:
+				a -= x;
+				break;
+			case BPF_ALU | BPF_MUL | BPF_X:
+				a *= x;
+				break;
+			case BPF_ALU | BPF_DIV | BPF_X:
+				if (x == 0)
+					return 0;
+				a /= x;
+				break;
+			case BPF_ALU | BPF_MOD | BPF_X:
+				if (x == 0)
+					return 0;
+				a %= x;
+				break;
+			case BPF_ALU | BPF_OR | BPF_X:
+				a |= x;
+				break;
+			case BPF_ALU | BPF_AND | BPF_X:
+				a &= x;
+				break;
+			case BPF_ALU | BPF_XOR | BPF_X:
+				a ^= x;
+				break;
+			case BPF_ALU | BPF_LSH | BPF_X:
+				// like the shift instructions of the CPU do
+				a <<= x & 31;
+				break;
+			case BPF_ALU | BPF_RSH | BPF_X:
+				a >>= x & 31;
+				break;
+
+			case BPF_MISC | BPF_TAX:
+				x = a;
+				break;
+			case BPF_MISC | BPF_TXA:
+				a = x;
+				break;
+
+			default:
+				// cannot happen with a validated program
+				return 0;
+		}
+
+		pc++;
+	}
+}
+
+
+/*!	Loads what is not part of the contiguous data of the \a packet. Returns
+	the value, or -1 if it is not part of the packet at all.
+*/
+int64
+bpf_load_slow(const bpf_packet* packet, uint32 offset, uint32 size)
+{
+	if (packet->read == NULL || offset > packet->length
+		|| size > packet->length - offset)
+		return -1;
+
+	uint8 data[4];
+	if (packet->read(packet->cookie, offset, data, size) != B_OK)
+		return -1;
+
+	return read_big_endian(data, size);
+}
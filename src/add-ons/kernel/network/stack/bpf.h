@@ -0,0 +1,41 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef STACK_BPF_H
+#define STACK_BPF_H
+
+
+#include <SupportDefs.h>
+
+#include <net/bpf.h>
+
+
+/*!	The packet a filter runs on. The loads that are not covered by the
+	contiguous \c data are satisfied by \c read, if there is one.
+	This does not depend on the rest of the stack, so that the filter engine
+	can be tested, and benchmarked in userland as well.
+*/
+struct bpf_packet {
+	const uint8*	data;
+	uint32			data_length;
+	uint32			length;
+		// of the whole packet
+	status_t		(*read)(void* cookie, uint32 offset, void* data,
+						size_t size);
+	void*			cookie;
+};
+
+typedef uint32 (*bpf_jit_function)(const bpf_packet* packet);
+
+
+status_t bpf_validate(const bpf_insn* instructions, uint32 count);
+uint32 bpf_interpret(const bpf_insn* instructions,
+	const bpf_packet* packet);
+int64 bpf_load_slow(const bpf_packet* packet, uint32 offset, uint32 size);
+
+status_t bpf_jit_compile(const bpf_insn* instructions, uint32 count,
+	uint8* code, size_t* _size);
+
+
+#endif	// STACK_BPF_H
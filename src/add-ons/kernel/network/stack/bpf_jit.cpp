@@ -0,0 +1,600 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Translates classic BPF filter programs into machine code. Only x86_64
+	is supported so far; everywhere else, filters are interpreted.
+*/
+
+
+#include "bpf.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+
+#if defined(__x86_64__)
+
+
+/*	The generated function follows the System V calling convention:
+
+		uint32 filter(const bpf_packet* packet);
+
+	A lives in eax, X in ebx, the packet data in r12, its contiguous length
+	in r13, and the packet in r14. The scratch memory is on the stack, below
+	the saved registers, followed by a slot to keep A in while calling out.
+	All jumps use 32 bit displacements, so that the size of the code of an
+	instruction never depends on where it jumps to.
+*/
+
+
+static const int8 kMemoryOffset = -112;
+	// relative to rbp
+static const int8 kSaveOffset = kMemoryOffset + 4 * BPF_MEMWORDS;
+static const uint8 kFrameSize = 80;
+	// keeps the stack 16 byte aligned for calls
+
+
+class CodeEmitter {
+public:
+	CodeEmitter(uint8* code)
+		:
+		fCode(code),
+		fPosition(0)
+	{
+	}
+
+	size_t Position() const
+	{
+		return fPosition;
+	}
+
+	void Byte(uint8 value)
+	{
+		if (fCode != NULL)
+			fCode[fPosition] = value;
+		fPosition++;
+	}
+
+	void Bytes(const uint8* bytes, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+			Byte(bytes[i]);
+	}
+
+	void Int32(uint32 value)
+	{
+		for (int i = 0; i < 4; i++)
+			Byte(value >> (i * 8));
+	}
+
+	void Int64(uint64 value)
+	{
+		for (int i = 0; i < 8; i++)
+			Byte(value >> (i * 8));
+	}
+
+	void Jump(uint32 target)
+	{
+		Byte(0xe9);
+		_Displacement(target);
+	}
+
+	void JumpIf(uint8 condition, uint32 target)
+	{
+		Byte(0x0f);
+		Byte(0x80 | condition);
+		_Displacement(target);
+	}
+
+private:
+	void _Displacement(uint32 target)
+	{
+		Int32(target - (fPosition + 4));
+	}
+
+private:
+	uint8*	fCode;
+	size_t	fPosition;
+};
+
+
+// the condition codes of the jcc instructions
+enum {
+	CONDITION_BELOW				= 0x2,
+	CONDITION_ABOVE_OR_EQUAL	= 0x3,
+	CONDITION_EQUAL				= 0x4,
+	CONDITION_NOT_EQUAL			= 0x5,
+	CONDITION_BELOW_OR_EQUAL	= 0x6,
+	CONDITION_ABOVE				= 0x7,
+	CONDITION_SIGN				= 0x8
+};
+
+
+static void
+emit_prologue(CodeEmitter& emitter)
+{
+	static const uint8 kPrologue[] = {
+		0x55,					// push rbp
+		0x48, 0x89, 0xe5,		// mov rbp, rsp
+		0x53,					// push rbx
+		0x41, 0x54,				// push r12
+		0x41, 0x55,				// push r13
+		0x41, 0x56,				// push r14
+		0x48, 0x83, 0xec, kFrameSize,
+								// sub rsp, kFrameSize
+		0x49, 0x89, 0xfe,		// mov r14, rdi
+		0x4c, 0x8b, 0x67, offsetof(bpf_packet, data),
+								// mov r12, [rdi + data]
+		0x44, 0x8b, 0x6f, offsetof(bpf_packet, data_length),
+								// mov r13d, [rdi + data_length]
+		0x31, 0xc0,				// xor eax, eax
+		0x31, 0xdb				// xor ebx, ebx
+	};
+	emitter.Bytes(kPrologue, sizeof(kPrologue));
+}
+
+
+static void
+emit_epilogue(CodeEmitter& emitter)
+{
+	static const uint8 kEpilogue[] = {
+		0x48, 0x8d, 0x65, 0xe0,	// lea rsp, [rbp - 32]
+		0x41, 0x5e,				// pop r14
+		0x41, 0x5d,				// pop r13
+		0x41, 0x5c,				// pop r12
+		0x5b,					// pop rbx
+		0x5d,					// pop rbp
+		0xc3					// ret
+	};
+	emitter.Bytes(kEpilogue, sizeof(kEpilogue));
+}
+
+
+/*!	Loads \a size bytes from the packet at the offset in esi into A, or,
+	for BPF_MSH, into X.
+*/
+static void
+emit_packet_load(CodeEmitter& emitter, uint32 size, bool msh,
+	uint32 returnZero)
+{
+	// lea rcx, [rsi + size]; cmp rcx, r13; ja slow
+	static const uint8 kCheck[] = { 0x48, 0x8d, 0x4e };
+	emitter.Bytes(kCheck, sizeof(kCheck));
+	emitter.Byte(size);
+	static const uint8 kCompare[] = { 0x4c, 0x39, 0xe9 };
+	emitter.Bytes(kCompare, sizeof(kCompare));
+
+	// the code size of the fast path, after the jump to the slow path
+	uint32 fastSize = 5;
+	if (msh)
+		fastSize += 5 + 3 + 3;
+	else if (size == 4)
+		fastSize += 4 + 2;
+	else if (size == 2)
+		fastSize += 5 + 4;
+	else
+		fastSize += 5;
+
+	uint32 slowSize = 3 + 5 + 10 + 2 + 3 + 6;
+	if (msh)
+		slowSize += 3 + 2 + 3 + 3 + 3;
+
+	emitter.JumpIf(CONDITION_ABOVE, emitter.Position() + 6 + fastSize);
+
+	// fast path: the data is contiguous
+	if (msh) {
+		// movzx ebx, byte [r12 + rsi]; and ebx, 0xf; shl ebx, 2
+		static const uint8 kLoad[] = { 0x41, 0x0f, 0xb6, 0x1c, 0x34,
+			0x83, 0xe3, 0x0f, 0xc1, 0xe3, 0x02 };
+		emitter.Bytes(kLoad, sizeof(kLoad));
+	} else if (size == 4) {
+		// mov eax, [r12 + rsi]; bswap eax
+		static const uint8 kLoad[] = { 0x41, 0x8b, 0x04, 0x34, 0x0f, 0xc8 };
+		emitter.Bytes(kLoad, sizeof(kLoad));
+	} else if (size == 2) {
+		// movzx eax, word [r12 + rsi]; rol ax, 8
+		static const uint8 kLoad[] = { 0x41, 0x0f, 0xb7, 0x04, 0x34,
+			0x66, 0xc1, 0xc0, 0x08 };
+		emitter.Bytes(kLoad, sizeof(kLoad));
+	} else {
+		// movzx eax, byte [r12 + rsi]
+		static const uint8 kLoad[] = { 0x41, 0x0f, 0xb6, 0x04, 0x34 };
+		emitter.Bytes(kLoad, sizeof(kLoad));
+	}
+	emitter.Jump(emitter.Position() + 5 + slowSize);
+
+	// slow path: let bpf_load_slow() do it
+	if (msh) {
+		// mov [rbp + kSaveOffset], eax
+		emitter.Byte(0x89);
+		emitter.Byte(0x45);
+		emitter.Byte(kSaveOffset);
+	}
+	static const uint8 kArguments[] = { 0x4c, 0x89, 0xf7 };
+		// mov rdi, r14
+	emitter.Bytes(kArguments, sizeof(kArguments));
+	emitter.Byte(0xba);
+		// mov edx, size
+	emitter.Int32(size);
+	emitter.Byte(0x48);
+	emitter.Byte(0xb8);
+		// mov rax, bpf_load_slow
+	emitter.Int64((addr_t)&bpf_load_slow);
+	emitter.Byte(0xff);
+	emitter.Byte(0xd0);
+		// call rax
+	static const uint8 kTest[] = { 0x48, 0x85, 0xc0 };
+		// test rax, rax
+	emitter.Bytes(kTest, sizeof(kTest));
+	emitter.JumpIf(CONDITION_SIGN, returnZero);
+
+	if (msh) {
+		// mov ebx, eax; and ebx, 0xf; shl ebx, 2; mov eax, [rbp + kSaveOffset]
+		static const uint8 kResult[] = { 0x89, 0xc3, 0x83, 0xe3, 0x0f,
+			0xc1, 0xe3, 0x02, 0x8b, 0x45 };
+		emitter.Bytes(kResult, sizeof(kResult));
+		emitter.Byte(kSaveOffset);
+	}
+}
+
+
+static void
+emit_instruction(CodeEmitter& emitter, const bpf_insn& instruction,
+	const uint32* offsets, uint32 pc, uint32 returnZero, uint32 exit)
+{
+	uint32 k = instruction.k;
+	uint8 memory = kMemoryOffset + 4 * (k % BPF_MEMWORDS);
+
+	switch (instruction.code) {
+		case BPF_RET | BPF_K:
+			emitter.Byte(0xb8);
+				// mov eax, k
+			emitter.Int32(k);
+			emitter.Jump(exit);
+			break;
+		case BPF_RET | BPF_A:
+			emitter.Jump(exit);
+			break;
+
+		case BPF_LD | BPF_W | BPF_ABS:
+		case BPF_LD | BPF_H | BPF_ABS:
+		case BPF_LD | BPF_B | BPF_ABS:
+		case BPF_LDX | BPF_B | BPF_MSH:
+			emitter.Byte(0xbe);
+				// mov esi, k
+			emitter.Int32(k);
+			emit_packet_load(emitter, BPF_SIZE(instruction.code) == BPF_W ? 4
+					: BPF_SIZE(instruction.code) == BPF_H ? 2 : 1,
+				BPF_MODE(instruction.code) == BPF_MSH, returnZero);
+			break;
+
+		case BPF_LD | BPF_W | BPF_IND:
+		case BPF_LD | BPF_H | BPF_IND:
+		case BPF_LD | BPF_B | BPF_IND:
+		{
+			// mov esi, ebx; add esi, k; jc returnZero
+			static const uint8 kOffset[] = { 0x89, 0xde, 0x81, 0xc6 };
+			emitter.Bytes(kOffset, sizeof(kOffset));
+			emitter.Int32(k);
+			emitter.JumpIf(CONDITION_BELOW, returnZero);
+			emit_packet_load(emitter, BPF_SIZE(instruction.code) == BPF_W ? 4
+					: BPF_SIZE(instruction.code) == BPF_H ? 2 : 1,
+				false, returnZero);
+			break;
+		}
+
+		case BPF_LD | BPF_W | BPF_LEN:
+		{
+			// mov eax, [r14 + length]
+			static const uint8 kLoad[] = { 0x41, 0x8b, 0x46,
+				offsetof(bpf_packet, length) };
+			emitter.Bytes(kLoad, sizeof(kLoad));
+			break;
+		}
+		case BPF_LDX | BPF_W | BPF_LEN:
+		{
+			// mov ebx, [r14 + length]
+			static const uint8 kLoad[] = { 0x41, 0x8b, 0x5e,
+				offsetof(bpf_packet, length) };
+			emitter.Bytes(kLoad, sizeof(kLoad));
+			break;
+		}
+		case BPF_LD | BPF_W | BPF_IMM:
+			emitter.Byte(0xb8);
+				// mov eax, k
+			emitter.Int32(k);
+			break;
+		case BPF_LDX | BPF_W | BPF_IMM:
+			emitter.Byte(0xbb);
+				// mov ebx, k
+			emitter.Int32(k);
+			break;
+
+		case BPF_LD | BPF_W | BPF_MEM:
+			// mov eax, [rbp + memory]
+			emitter.Byte(0x8b);
+			emitter.Byte(0x45);
+			emitter.Byte(memory);
+			break;
+		case BPF_LDX | BPF_W | BPF_MEM:
+			// mov ebx, [rbp + memory]
+			emitter.Byte(0x8b);
+			emitter.Byte(0x5d);
+			emitter.Byte(memory);
+			break;
+		case BPF_ST:
+			// mov [rbp + memory], eax
+			emitter.Byte(0x89);
+			emitter.Byte(0x45);
+			emitter.Byte(memory);
+			break;
+		case BPF_STX:
+			// mov [rbp + memory], ebx
+			emitter.Byte(0x89);
+			emitter.Byte(0x5d);
+			emitter.Byte(memory);
+			break;
+
+		case BPF_JMP | BPF_JA:
+			emitter.Jump(offsets[pc + 1 + k]);
+			break;
+
+		case BPF_JMP | BPF_JEQ | BPF_K:
+		case BPF_JMP | BPF_JGT | BPF_K:
+		case BPF_JMP | BPF_JGE | BPF_K:
+		case BPF_JMP | BPF_JSET | BPF_K:
+		case BPF_JMP | BPF_JEQ | BPF_X:
+		case BPF_JMP | BPF_JGT | BPF_X:
+		case BPF_JMP | BPF_JGE | BPF_X:
+		case BPF_JMP | BPF_JSET | BPF_X:
+		{
+			bool test = BPF_OP(instruction.code) == BPF_JSET;
+			if (BPF_SRC(instruction.code) == BPF_K) {
+				// test eax, k, or cmp eax, k
+				emitter.Byte(test ? 0xa9 : 0x3d);
+				emitter.Int32(k);
+			} else {
+				// test eax, ebx, or cmp eax, ebx
+				emitter.Byte(test ? 0x85 : 0x39);
+				emitter.Byte(0xd8);
+			}
+
+			uint8 condition;
+			uint8 inverse;
+			switch (BPF_OP(instruction.code)) {
+				case BPF_JEQ:
+					condition = CONDITION_EQUAL;
+					inverse = CONDITION_NOT_EQUAL;
+					break;
+				case BPF_JGT:
+					condition = CONDITION_ABOVE;
+					inverse = CONDITION_BELOW_OR_EQUAL;
+					break;
+				case BPF_JGE:
+					condition = CONDITION_ABOVE_OR_EQUAL;
+					inverse = CONDITION_BELOW;
+					break;
+				default:
+					condition = CONDITION_NOT_EQUAL;
+					inverse = CONDITION_EQUAL;
+					break;
+			}
+
+			uint32 trueTarget = offsets[pc + 1 + instruction.jt];
+			uint32 falseTarget = offsets[pc + 1 + instruction.jf];
+			if (instruction.jt == instruction.jf) {
+				if (instruction.jt != 0)
+					emitter.Jump(trueTarget);
+			} else if (instruction.jt == 0)
+				emitter.JumpIf(inverse, falseTarget);
+			else {
+				emitter.JumpIf(condition, trueTarget);
+				if (instruction.jf != 0)
+					emitter.Jump(falseTarget);
+			}
+			break;
+		}
+
+		case BPF_ALU | BPF_ADD | BPF_K:
+			emitter.Byte(0x05);
+				// add eax, k
+			emitter.Int32(k);
+			break;
+		case BPF_ALU | BPF_SUB | BPF_K:
+			emitter.Byte(0x2d);
+				// sub eax, k
+			emitter.Int32(k);
+			break;
+		case BPF_ALU | BPF_MUL | BPF_K:
+			emitter.Byte(0x69);
+			emitter.Byte(0xc0);
+				// imul eax, eax, k
+			emitter.Int32(k);
+			break;
+		case BPF_ALU | BPF_DIV | BPF_K:
+		case BPF_ALU | BPF_MOD | BPF_K:
+			emitter.Byte(0x31);
+			emitter.Byte(0xd2);
+				// xor edx, edx
+			emitter.Byte(0xb9);
+				// mov ecx, k
+			emitter.Int32(k);
+			emitter.Byte(0xf7);
+			emitter.Byte(0xf1);
+				// div ecx
+			if (BPF_OP(instruction.code) == BPF_MOD) {
+				emitter.Byte(0x89);
+				emitter.Byte(0xd0);
+					// mov eax, edx
+			}
+			break;
+		case BPF_ALU | BPF_OR | BPF_K:
+			emitter.Byte(0x0d);
+				// or eax, k
+			emitter.Int32(k);
+			break;
+		case BPF_ALU | BPF_AND | BPF_K:
+			emitter.Byte(0x25);
+				// and eax, k
+			emitter.Int32(k);
+			break;
+		case BPF_ALU | BPF_XOR | BPF_K:
+			emitter.Byte(0x35);
+				// xor eax, k
+			emitter.Int32(k);
+			break;
+		case BPF_ALU | BPF_LSH | BPF_K:
+			emitter.Byte(0xc1);
+			emitter.Byte(0xe0);
+				// shl eax, k
+			emitter.Byte(k);
+			break;
+		case BPF_ALU | BPF_RSH | BPF_K:
+			emitter.Byte(0xc1);
+			emitter.Byte(0xe8);
+				// shr eax, k
+			emitter.Byte(k);
+			break;
+		case BPF_ALU | BPF_NEG:
+			emitter.Byte(0xf7);
+			emitter.Byte(0xd8);
+				// neg eax
+			break;
+
+		case BPF_ALU | BPF_ADD | BPF_X:
+			emitter.Byte(0x01);
+			emitter.Byte(0xd8);
+				// add eax, ebx
+			break;
+		case BPF_ALU | BPF_SUB | BPF_X:
+			emitter.Byte(0x29);
+			emitter.Byte(0xd8);
+				// sub eax, ebx
+			break;
+		case BPF_ALU | BPF_MUL | BPF_X:
+			emitter.Byte(0x0f);
+			emitter.Byte(0xaf);
+			emitter.Byte(0xc3);
+				// imul eax, ebx
+			break;
+		case BPF_ALU | BPF_DIV | BPF_X:
+		case BPF_ALU | BPF_MOD | BPF_X:
+			emitter.Byte(0x85);
+			emitter.Byte(0xdb);
+				// test ebx, ebx
+			emitter.JumpIf(CONDITION_EQUAL, returnZero);
+			emitter.Byte(0x31);
+			emitter.Byte(0xd2);
+				// xor edx, edx
+			emitter.Byte(0xf7);
+			emitter.Byte(0xf3);
+				// div ebx
+			if (BPF_OP(instruction.code) == BPF_MOD) {
+				emitter.Byte(0x89);
+				emitter.Byte(0xd0);
+					// mov eax, edx
+			}
+			break;
+		case BPF_ALU | BPF_OR | BPF_X:
+			emitter.Byte(0x09);
+			emitter.Byte(0xd8);
+				// or eax, ebx
+			break;
+		case BPF_ALU | BPF_AND | BPF_X:
+			emitter.Byte(0x21);
+			emitter.Byte(0xd8);
+				// and eax, ebx
+			break;
+		case BPF_ALU | BPF_XOR | BPF_X:
+			emitter.Byte(0x31);
+			emitter.Byte(0xd8);
+				// xor eax, ebx
+			break;
+		case BPF_ALU | BPF_LSH | BPF_X:
+		case BPF_ALU | BPF_RSH | BPF_X:
+			emitter.Byte(0x89);
+			emitter.Byte(0xd9);
+				// mov ecx, ebx
+			emitter.Byte(0xd3);
+			emitter.Byte(BPF_OP(instruction.code) == BPF_LSH ? 0xe0 : 0xe8);
+				// shl eax, cl, or shr eax, cl
+			break;
+
+		case BPF_MISC | BPF_TAX:
+			emitter.Byte(0x89);
+			emitter.Byte(0xc3);
+				// mov ebx, eax
+			break;
+		case BPF_MISC | BPF_TXA:
+			emitter.Byte(0x89);
+			emitter.Byte(0xd8);
+				// mov eax, ebx
+			break;
+	}
+}
+
+
+/*!	Translates the validated filter program \a instructions into a
+	bpf_jit_function. Without \a code, only the size of the code is
+	returned in \a _size; otherwise, \a code must be at least that large.
+*/
+status_t
+bpf_jit_compile(const bpf_insn* instructions, uint32 count, uint8* code,
+	size_t* _size)
+{
+	// where the code of each instruction starts, and where it ends
+	uint32* offsets = (uint32*)calloc(count + 1, sizeof(uint32));
+	if (offsets == NULL)
+		return B_NO_MEMORY;
+
+	// The first pass only determines the offsets, the second one emits the
+	// code with the jumps resolved.
+	size_t size = 0;
+	for (int pass = 0; pass < 2; pass++) {
+		CodeEmitter emitter(pass == 0 ? NULL : code);
+		emit_prologue(emitter);
+
+		uint32 returnZero = pass == 0 ? 0 : offsets[count];
+		uint32 exit = returnZero + 2;
+
+		for (uint32 pc = 0; pc < count; pc++) {
+			if (pass == 0)
+				offsets[pc] = emitter.Position();
+			emit_instruction(emitter, instructions[pc], offsets, pc,
+				returnZero, exit);
+		}
+
+		if (pass == 0)
+			offsets[count] = emitter.Position();
+
+		emitter.Byte(0x31);
+		emitter.Byte(0xc0);
+			// returnZero: xor eax, eax
+		emit_epilogue(emitter);
+
+		size = emitter.Position();
+		if (code == NULL)
+			break;
+	}
+
+	free(offsets);
+	*_size = size;
+	return B_OK;
+}
+
+
+#else	// !__x86_64__
+
+
+status_t
+bpf_jit_compile(const bpf_insn* instructions, uint32 count, uint8* code,
+	size_t* _size)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
+#endif	// !__x86_64__
@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2010, Haiku, Inc. All Rights Reserved.
+ * Copyright 2006-2026, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -8,6 +8,7 @@
  */
 
 
+#include <net/bpf.h>
 #include <net/if.h>
 #include <net/if_dl.h>
 #include <net/if_media.h>
@@ -17,9 +18,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/sockio.h>
+#include <unistd.h>
 
 #include <KernelExport.h>
 
+#include <kernel.h>
 #include <net_datalink.h>
 #include <net_device.h>
 #include <NetUtilities.h>
@@ -27,6 +30,8 @@
 #include "device_interfaces.h"
 #include "domains.h"
 #include "interfaces.h"
+#include "offload.h"
+#include "packet_filter.h"
 #include "routes.h"
 #include "stack_private.h"
 #include "utility.h"
@@ -94,6 +99,7 @@ option_to_string(int32 option)
 
 		CODE(SIOCSPACKETCAP)	/* Start capturing packets on an interface */
 		CODE(SIOCCPACKETCAP)	/* Stop capturing packets on an interface */
+		CODE(SIOCSIFFILTER)		/* set the receive filter of a device */
 
 		CODE(SIOCSHIWAT)		/* set high watermark */
 		CODE(SIOCGHIWAT)		/* get high watermark */
@@ -206,6 +212,47 @@ update_device_send_stats(struct net_device* device, status_t status, size_t pack
 }
 
 
+/*!	Sets the receive filter of a device to the program that \c ifr_data of
+	the ifreq at \a value points to, or removes it, if that is \c NULL.
+*/
+static status_t
+set_device_filter(void* value)
+{
+	// Only root is allowed to filter the packets of a device
+	if (geteuid() != 0)
+		return B_NOT_ALLOWED;
+
+	struct ifreq request;
+	if (user_memcpy(&request, value, sizeof(struct ifreq)) != B_OK)
+		return B_BAD_ADDRESS;
+
+	net_filter* filter = NULL;
+	if (request.ifr_data != NULL) {
+		struct bpf_program program;
+		if (!IS_USER_ADDRESS(request.ifr_data)
+			|| user_memcpy(&program, request.ifr_data, sizeof(program))
+				!= B_OK) {
+			return B_BAD_ADDRESS;
+		}
+
+		status_t status = create_filter(&program, &filter);
+		if (status != B_OK)
+			return status;
+	}
+
+	net_device_interface* interface
+		= get_device_interface(request.ifr_name, false);
+	if (interface == NULL) {
+		delete_filter(filter);
+		return B_DEVICE_NOT_FOUND;
+	}
+
+	set_device_interface_filter(interface, filter);
+	put_device_interface(interface);
+	return B_OK;
+}
+
+
 //	#pragma mark - datalink module
 
 
@@ -216,6 +263,11 @@ datalink_control(net_domain* _domain, int32 option, void* value,
 	TRACE("%s(domain %p, option %s, value %p, length %zu)\n", __FUNCTION__,
 		_domain, option_to_string(option), value, *_length);
 
+	if (option == SIOCSIFFILTER) {
+		// the filter belongs to the device, no matter the domain
+		return set_device_filter(value);
+	}
+
 	net_domain_private* domain = (net_domain_private*)_domain;
 	if (domain == NULL || domain->family == AF_LINK) {
 		// the AF_LINK family is already handled completely in the link protocol
@@ -394,10 +446,14 @@ datalink_send_routed_data(struct net_route* route, net_buffer* buffer)
 		if (atomic_get(&interface->DeviceInterface()->monitor_count) > 0)
 			device_interface_monitor_receive(interface->DeviceInterface(), buffer);
 
+		// checksums left to the device are not needed here
+		if ((buffer->offload_flags & NET_BUFFER_CHECKSUM_PARTIAL) != 0)
+			buffer->offload_flags = NET_BUFFER_CHECKSUM_VALID;
+
 		// this one goes back to the domain directly
 		const size_t packetSize = buffer->size;
-		status_t status = fifo_enqueue_buffer(
-			&interface->DeviceInterface()->receive_queue, buffer);
+		status_t status = device_interface_enqueue_buffer(
+			interface->DeviceInterface(), buffer);
 		update_device_send_stats(interface->DeviceInterface()->device,
 			status, packetSize);
 		return status;
@@ -697,6 +753,40 @@ interface_protocol_uninit(net_datalink_protocol* protocol)
 }
 
 
+/*!	Hands \a buffer over to the device, after doing in software what it
+	cannot offload.
+*/
+static status_t
+send_to_device(interface_protocol* protocol, net_buffer* buffer)
+{
+	net_device* device = protocol->device;
+	const size_t packetSize = buffer->size;
+	status_t status;
+
+	if ((buffer->offload_flags & NET_BUFFER_CHECKSUM_PARTIAL) != 0
+		&& (device->offload & NET_DEVICE_OFFLOAD_TX_CHECKSUM) == 0) {
+		status = complete_checksum(buffer);
+		if (status != B_OK) {
+			update_device_send_stats(device, status, packetSize);
+			return status;
+		}
+	}
+
+	if (device->transmit_queue_count > 1
+		&& protocol->device_module->send_queue_data != NULL) {
+		// keep each flow on one queue, so that it's not reordered
+		uint32 queue = device_interface_flow_hash(buffer,
+			device->header_length) % device->transmit_queue_count;
+		status = protocol->device_module->send_queue_data(device, queue,
+			buffer);
+	} else
+		status = protocol->device_module->send_data(device, buffer);
+
+	update_device_send_stats(device, status, packetSize);
+	return status;
+}
+
+
 static status_t
 interface_protocol_send_data(net_datalink_protocol* _protocol,
 	net_buffer* buffer)
@@ -709,9 +799,28 @@ interface_protocol_send_data(net_datalink_protocol* _protocol,
 	if (atomic_get(&interface->DeviceInterface()->monitor_count) > 0)
 		device_interface_monitor_receive(interface->DeviceInterface(), buffer);
 
-	const size_t packetSize = buffer->size;
-	status_t status = protocol->device_module->send_data(protocol->device, buffer);
-	update_device_send_stats(protocol->device, status, packetSize);
+	if (!needs_software_segmentation(protocol->device, buffer))
+		return send_to_device(protocol, buffer);
+
+	// the device cannot cut the buffer into TCP segments itself
+	struct list segments;
+	list_init(&segments);
+
+	status_t status = segment_buffer(protocol->device, buffer, &segments);
+	while (true) {
+		net_buffer* segment = (net_buffer*)list_remove_head_item(&segments);
+		if (segment == NULL)
+			break;
+
+		if (status == B_OK)
+			status = send_to_device(protocol, segment);
+		if (status != B_OK)
+			gNetBufferModule.free(segment);
+	}
+
+	if (status == B_OK)
+		gNetBufferModule.free(buffer);
+
 	return status;
 }
 
@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2017, Haiku, Inc. All Rights Reserved.
+ * Copyright 2006-2026, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -10,18 +10,25 @@
 #include "device_interfaces.h"
 #include "domains.h"
 #include "interfaces.h"
+#include "offload.h"
+#include "packet_filter.h"
 #include "stack_private.h"
 #include "utility.h"
 
 #include <net_device.h>
 
 #include <lock.h>
+#include <smp.h>
+#include <thread.h>
 #include <util/AutoLock.h>
+#include <util/Random.h>
 
 #include <KernelExport.h>
 
 #include <net/if_dl.h>
+#include <net/if_types.h>
 #include <netinet/in.h>
+#include <netinet/ip.h>
 #include <new>
 #include <stdio.h>
 #include <stdlib.h>
@@ -36,25 +43,104 @@
 #endif
 
 
+static const size_t kReceiveQueueSize = 16 * 1024 * 1024;
+	// shared by all consumers of a device
+static const size_t kMinConsumerQueueSize = 1024 * 1024;
+
 static mutex sLock;
 static DeviceInterfaceList sInterfaces;
 static uint32 sDeviceIndex;
+static uint32 sFlowHashSeed;
+
+
+static inline uint32
+flow_hash_add(uint32 hash, uint32 value)
+{
+	// the mixing step of MurmurHash3
+	value *= 0xcc9e2d51;
+	value = (value << 15) | (value >> 17);
+	value *= 0x1b873593;
+
+	hash ^= value;
+	hash = (hash << 13) | (hash >> 19);
+	return hash * 5 + 0xe6546b64;
+}
+
+
+static inline uint32
+flow_hash_finish(uint32 hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	return hash ^ (hash >> 16);
+}
+
+
+static void
+pin_thread_to_cpu(thread_id thread, int32 cpu)
+{
+	CPUSet mask;
+	mask.SetBit(cpu);
+	thread_set_cpu_mask(thread, mask);
+}
+
+
+/*!	Puts a received \a buffer into the receive queue of the consumer that
+	handles its flow. With multiple hardware queues, the device already
+	distributed the flows, and \a hardwareQueue selects the consumer;
+	otherwise, the buffer is hashed in software, as RPS does.
+*/
+static status_t
+enqueue_received_buffer(net_device_interface* interface, net_buffer* buffer,
+	int32 hardwareQueue)
+{
+	uint32 index = 0;
+	if (hardwareQueue >= 0)
+		index = hardwareQueue % interface->consumer_count;
+	else if (interface->consumer_count > 1) {
+		index = device_interface_flow_hash(buffer, 0)
+			% interface->consumer_count;
+	}
+
+	return fifo_enqueue_buffer(&interface->consumers[index].queue, buffer);
+}
 
 
-/*!	A service thread for each device interface. It just reads as many packets
-	as available, deframes them, and puts them into the receive queue of the
-	device interface.
+/*!	Runs the receive filter of the \a interface, if any, on the \a buffer
+	as it came from the device.
+*/
+static bool
+filter_received_buffer(net_device_interface* interface, net_buffer* buffer)
+{
+	ReadLocker locker(interface->filter_lock);
+
+	net_filter* filter = interface->receive_filter;
+	return filter == NULL || run_filter(filter, buffer) != 0;
+}
+
+
+/*!	A service thread for each receive queue of a device interface. It just
+	reads as many packets as available, deframes them, and puts them into the
+	receive queue of one of the consumers of the device interface.
 */
 static status_t
-device_reader_thread(void* _interface)
+device_reader_thread(void* _reader)
 {
-	net_device_interface* interface = (net_device_interface*)_interface;
+	net_device_reader* reader = (net_device_reader*)_reader;
+	net_device_interface* interface = reader->interface;
 	net_device* device = interface->device;
+	bool multiQueue = interface->reader_count > 1;
 	status_t status = B_OK;
 
 	while ((device->flags & IFF_UP) != 0) {
 		net_buffer* buffer;
-		status = device->module->receive_data(device, &buffer);
+		if (multiQueue) {
+			status = device->module->receive_queue_data(device, reader->queue,
+				&buffer);
+		} else
+			status = device->module->receive_data(device, &buffer);
 		if (status == B_OK) {
 			// feed device monitors
 			if (atomic_get(&interface->monitor_count) > 0)
@@ -62,6 +148,13 @@ device_reader_thread(void* _interface)
 
 			ASSERT(buffer->interface_address == NULL);
 
+			if (interface->receive_filter != NULL
+				&& !filter_received_buffer(interface, buffer)) {
+				gNetBufferModule.free(buffer);
+				atomic_add((int32*)&device->stats.receive.dropped, 1);
+				continue;
+			}
+
 			if (interface->deframe_func(interface->device, buffer) != B_OK) {
 				gNetBufferModule.free(buffer);
 				atomic_add((int32*)&device->stats.receive.dropped, 1);
@@ -69,7 +162,8 @@ device_reader_thread(void* _interface)
 			}
 
 			const size_t packetSize = buffer->size;
-			status = fifo_enqueue_buffer(&interface->receive_queue, buffer);
+			status = enqueue_received_buffer(interface, buffer,
+				multiQueue ? (int32)reader->queue : -1);
 			if (status == B_OK) {
 				atomic_add((int32*)&device->stats.receive.packets, 1);
 				atomic_add64((int64*)&device->stats.receive.bytes, packetSize);
@@ -94,19 +188,32 @@ device_reader_thread(void* _interface)
 
 
 static status_t
-device_consumer_thread(void* _interface)
+device_consumer_thread(void* _consumer)
 {
-	net_device_interface* interface = (net_device_interface*)_interface;
+	net_device_consumer* consumer = (net_device_consumer*)_consumer;
+	net_device_interface* interface = consumer->interface;
 	net_device* device = interface->device;
-	net_buffer* buffer;
+	net_buffer* pending = NULL;
 
 	while (atomic_get(&interface->ref_count) > 0) {
-		ssize_t status = fifo_dequeue_buffer(&interface->receive_queue, 0,
-			B_INFINITE_TIMEOUT, &buffer);
-		if (status != B_OK) {
-			if (status == B_INTERRUPTED)
-				continue;
-			break;
+		net_buffer* buffer = pending;
+		pending = NULL;
+
+		if (buffer == NULL) {
+			ssize_t status = fifo_dequeue_buffer(&consumer->queue, 0,
+				B_INFINITE_TIMEOUT, &buffer);
+			if (status != B_OK) {
+				if (status == B_INTERRUPTED)
+					continue;
+				break;
+			}
+		}
+
+		if ((device->offload & NET_DEVICE_OFFLOAD_GRO) != 0
+			&& buffer->interface_address == NULL) {
+			// the segments of a flow that arrived in a burst are passed on
+			// as one
+			pending = coalesce_received_buffers(&consumer->queue, buffer);
 		}
 
 		if (buffer->interface_address != NULL) {
@@ -145,6 +252,9 @@ device_consumer_thread(void* _interface)
 			gNetBufferModule.free(buffer);
 	}
 
+	if (pending != NULL)
+		gNetBufferModule.free(pending);
+
 	return B_OK;
 }
 
@@ -176,6 +286,73 @@ find_device_interface(const char* name)
 }
 
 
+/*!	Stops and deletes the first \a count consumers of the \a interface;
+	their threads leave as soon as their queue is gone.
+*/
+static void
+delete_consumers(net_device_interface* interface, uint32 count)
+{
+	for (uint32 i = 0; i < count; i++)
+		uninit_fifo(&interface->consumers[i].queue);
+	for (uint32 i = 0; i < count; i++)
+		wait_for_thread(interface->consumers[i].thread, NULL);
+
+	delete[] interface->consumers;
+	interface->consumers = NULL;
+}
+
+
+/*!	Creates a consumer thread for each CPU, bound to it. The receive queue
+	of a device is split between them.
+*/
+static status_t
+create_consumers(net_device_interface* interface)
+{
+	net_device* device = interface->device;
+	uint32 count = smp_get_num_cpus();
+
+	interface->consumers = new(std::nothrow) net_device_consumer[count];
+	if (interface->consumers == NULL)
+		return B_NO_MEMORY;
+
+	size_t queueSize = max_c(kReceiveQueueSize / count, kMinConsumerQueueSize);
+
+	for (uint32 i = 0; i < count; i++) {
+		net_device_consumer& consumer = interface->consumers[i];
+		consumer.interface = interface;
+		consumer.cpu = count > 1 ? (int32)i : -1;
+
+		char name[B_OS_NAME_LENGTH];
+		snprintf(name, sizeof(name), "%s receive queue %" B_PRIu32,
+			device->name, i);
+
+		status_t status = init_fifo(&consumer.queue, name, queueSize);
+		if (status == B_OK) {
+			snprintf(name, sizeof(name), "%s consumer %" B_PRIu32,
+				device->name, i);
+
+			consumer.thread = spawn_kernel_thread(device_consumer_thread,
+				name, B_DISPLAY_PRIORITY, &consumer);
+			if (consumer.thread < B_OK) {
+				status = consumer.thread;
+				uninit_fifo(&consumer.queue);
+			}
+		}
+		if (status != B_OK) {
+			delete_consumers(interface, i);
+			return status;
+		}
+
+		if (consumer.cpu >= 0)
+			pin_thread_to_cpu(consumer.thread, consumer.cpu);
+		resume_thread(consumer.thread);
+	}
+
+	interface->consumer_count = count;
+	return B_OK;
+}
+
+
 static net_device_interface*
 allocate_device_interface(net_device* device, net_device_module_info* module)
 {
@@ -185,29 +362,42 @@ allocate_device_interface(net_device* device, net_device_module_info* module)
 
 	recursive_lock_init(&interface->receive_lock, "device interface receive");
 	recursive_lock_init(&interface->monitor_lock, "device interface monitors");
-
-	char name[128];
-	snprintf(name, sizeof(name), "%s receive queue", device->name);
-
-	if (init_fifo(&interface->receive_queue, name, 16 * 1024 * 1024) < B_OK)
-		goto error1;
+	rw_lock_init(&interface->filter_lock, "device interface filter");
 
 	interface->device = device;
 	interface->up_count = 0;
+
+	// the stack segments and coalesces TCP itself on real networks
+	if (device->type == IFT_ETHER)
+		device->offload |= NET_DEVICE_OFFLOAD_GSO | NET_DEVICE_OFFLOAD_GRO;
+
 	interface->ref_count = 1;
 	interface->busy = false;
 	interface->monitor_count = 0;
 	interface->deframe_func = NULL;
 	interface->deframe_ref_count = 0;
+	interface->receive_filter = NULL;
+	interface->consumer_count = 0;
+	interface->consumers = NULL;
+
+	// a reader for each hardware receive queue
+	interface->reader_count = 1;
+	if (module->receive_queue_data != NULL && device->receive_queue_count > 1)
+		interface->reader_count = device->receive_queue_count;
+
+	interface->readers
+		= new(std::nothrow) net_device_reader[interface->reader_count];
+	if (interface->readers == NULL)
+		goto error1;
 
-	snprintf(name, sizeof(name), "%s consumer", device->name);
+	for (uint32 i = 0; i < interface->reader_count; i++) {
+		interface->readers[i].interface = interface;
+		interface->readers[i].queue = i;
+		interface->readers[i].thread = -1;
+	}
 
-	interface->reader_thread   = -1;
-	interface->consumer_thread = spawn_kernel_thread(device_consumer_thread,
-		name, B_DISPLAY_PRIORITY, interface);
-	if (interface->consumer_thread < B_OK)
+	if (create_consumers(interface) != B_OK)
 		goto error2;
-	resume_thread(interface->consumer_thread);
 
 	// TODO: proper interface index allocation
 	device->index = ++sDeviceIndex;
@@ -217,10 +407,11 @@ allocate_device_interface(net_device* device, net_device_module_info* module)
 	return interface;
 
 error2:
-	uninit_fifo(&interface->receive_queue);
+	delete[] interface->readers;
 error1:
 	recursive_lock_destroy(&interface->receive_lock);
 	recursive_lock_destroy(&interface->monitor_lock);
+	rw_lock_destroy(&interface->filter_lock);
 	delete interface;
 
 	return NULL;
@@ -256,12 +447,23 @@ dump_device_interface(int argc, char** argv)
 		= (net_device_interface*)parse_expression(argv[1]);
 
 	kprintf("device:            %p\n", interface->device);
-	kprintf("reader_thread:     %" B_PRId32 "\n", interface->reader_thread);
+	kprintf("offload:           %#" B_PRIx32 "\n", interface->device->offload);
+	kprintf("readers:\n");
+	for (uint32 i = 0; i < interface->reader_count; i++) {
+		kprintf("  queue %" B_PRIu32 ": thread %" B_PRId32 "\n", i,
+			interface->readers[i].thread);
+	}
 	kprintf("up_count:          %" B_PRIu32 "\n", interface->up_count);
 	kprintf("ref_count:         %" B_PRId32 "\n", interface->ref_count);
 	kprintf("deframe_func:      %p\n", interface->deframe_func);
 	kprintf("deframe_ref_count: %" B_PRId32 "\n", interface->ref_count);
-	kprintf("consumer_thread:   %" B_PRId32 "\n", interface->consumer_thread);
+	kprintf("consumers:\n");
+	for (uint32 i = 0; i < interface->consumer_count; i++) {
+		net_device_consumer& consumer = interface->consumers[i];
+		kprintf("  cpu %" B_PRId32 ": thread %" B_PRId32 ", queue %p (%"
+			B_PRIuSIZE " bytes)\n", consumer.cpu, consumer.thread,
+			&consumer.queue, consumer.queue.current_bytes);
+	}
 
 	kprintf("monitor_count:     %" B_PRId32 "\n", interface->monitor_count);
 	kprintf("monitor_lock:      %p\n", &interface->monitor_lock);
@@ -271,8 +473,8 @@ dump_device_interface(int argc, char** argv)
 	while (monitorIterator.HasNext())
 		kprintf("  %p\n", monitorIterator.Next());
 
+	kprintf("receive_filter:    %p\n", interface->receive_filter);
 	kprintf("receive_lock:      %p\n", &interface->receive_lock);
-	kprintf("receive_queue:     %p\n", &interface->receive_queue);
 	kprintf("receive_funcs:\n");
 	DeviceHandlerList::Iterator handlerIterator
 		= interface->receive_funcs.GetIterator();
@@ -400,8 +602,8 @@ put_device_interface(struct net_device_interface* interface)
 	sInterfaces.Remove(interface);
 	locker.Unlock();
 
-	uninit_fifo(&interface->receive_queue);
-	wait_for_thread(interface->consumer_thread, NULL);
+	delete_consumers(interface, interface->consumer_count);
+	delete[] interface->readers;
 
 	net_device* device = interface->device;
 	const char* moduleName = device->module->info.name;
@@ -409,8 +611,11 @@ put_device_interface(struct net_device_interface* interface)
 	device->module->uninit_device(device);
 	put_module(moduleName);
 
+	delete_filter(interface->receive_filter);
+
 	recursive_lock_destroy(&interface->monitor_lock);
 	recursive_lock_destroy(&interface->receive_lock);
+	rw_lock_destroy(&interface->filter_lock);
 	delete interface;
 }
 
@@ -514,6 +719,102 @@ device_interface_monitor_receive(net_device_interface* interface,
 }
 
 
+/*!	Hands a \a buffer that has been deframed already to the consumer that
+	handles its flow.
+*/
+status_t
+device_interface_enqueue_buffer(net_device_interface* interface,
+	net_buffer* buffer)
+{
+	return enqueue_received_buffer(interface, buffer, -1);
+}
+
+
+/*!	Replaces the receive filter of the \a interface with \a filter, which
+	may be \c NULL to remove it. The interface owns the filter from now on.
+*/
+void
+set_device_interface_filter(net_device_interface* interface,
+	net_filter* filter)
+{
+	WriteLocker locker(interface->filter_lock);
+
+	net_filter* previous = interface->receive_filter;
+	interface->receive_filter = filter;
+	locker.Unlock();
+
+	delete_filter(previous);
+}
+
+
+/*!	Computes a hash over the addresses and ports of the IPv4 or IPv6 packet
+	that starts at \a offset in the \a buffer, so that all packets of a
+	connection get the same value. Anything else hashes to 0.
+*/
+uint32
+device_interface_flow_hash(net_buffer* buffer, size_t offset)
+{
+	if (buffer->size <= offset)
+		return 0;
+
+	uint32 header[10];
+	size_t length = min_c(buffer->size - offset, sizeof(header));
+	if (gNetBufferModule.read(buffer, offset, header, length) != B_OK)
+		return 0;
+
+	const uint8* bytes = (const uint8*)header;
+	uint32 hash = sFlowHashSeed;
+	size_t portsOffset;
+	uint8 protocol;
+
+	switch (bytes[0] >> 4) {
+		case 4:
+			if (length < sizeof(ip))
+				return 0;
+
+			// source and destination address
+			hash = flow_hash_add(hash, header[3]);
+			hash = flow_hash_add(hash, header[4]);
+
+			protocol = bytes[9];
+			portsOffset = (bytes[0] & 0xf) * 4;
+
+			// only the first fragment carries the ports, so that they
+			// can't be used for fragments at all
+			if ((ntohs(*(uint16*)&bytes[6]) & (IP_MF | IP_OFFMASK)) != 0)
+				portsOffset = 0;
+			break;
+
+		case 6:
+			if (length < 40)
+				return 0;
+
+			for (int32 i = 2; i < 10; i++)
+				hash = flow_hash_add(hash, header[i]);
+
+			// extension headers are not followed
+			protocol = bytes[6];
+			portsOffset = 40;
+			break;
+
+		default:
+			return 0;
+	}
+
+	hash = flow_hash_add(hash, protocol);
+
+	if (portsOffset != 0
+		&& (protocol == IPPROTO_TCP || protocol == IPPROTO_UDP)) {
+		uint32 ports;
+		if (gNetBufferModule.read(buffer, offset + portsOffset, &ports,
+				sizeof(ports)) == B_OK)
+			hash = flow_hash_add(hash, ports);
+	}
+
+	return flow_hash_finish(hash);
+}
+
+
 status_t
 up_device_interface(net_device_interface* interface)
 {
@@ -531,20 +832,45 @@ up_device_interface(net_device_interface* interface)
 		return status;
 
 	if (device->module->receive_data != NULL) {
-		// give the thread a nice name
-		char name[B_OS_NAME_LENGTH];
-		snprintf(name, sizeof(name), "%s reader", device->name);
+		for (uint32 i = 0; i < interface->reader_count; i++) {
+			net_device_reader& reader = interface->readers[i];
+
+			// give the thread a nice name
+			char name[B_OS_NAME_LENGTH];
+			if (interface->reader_count > 1) {
+				snprintf(name, sizeof(name), "%s reader %" B_PRIu32,
+					device->name, i);
+			} else
+				snprintf(name, sizeof(name), "%s reader", device->name);
+
+			reader.thread = spawn_kernel_thread(device_reader_thread,
+				name, B_REAL_TIME_DISPLAY_PRIORITY - 10, &reader);
+			if (reader.thread < B_OK) {
+				status = reader.thread;
+
+				// the device is not up, so the other readers leave at once
+				for (uint32 j = 0; j < i; j++) {
+					resume_thread(interface->readers[j].thread);
+					wait_for_thread(interface->readers[j].thread, NULL);
+				}
+				device->module->down(device);
+				return status;
+			}
 
-		interface->reader_thread = spawn_kernel_thread(device_reader_thread,
-			name, B_REAL_TIME_DISPLAY_PRIORITY - 10, interface);
-		if (interface->reader_thread < B_OK)
-			return interface->reader_thread;
+			// keep the reader of a hardware queue next to its consumer
+			if (interface->reader_count > 1 && interface->consumer_count > 1) {
+				pin_thread_to_cpu(reader.thread,
+					interface->consumers[i % interface->consumer_count].cpu);
+			}
+		}
 	}
 
 	device->flags |= IFF_UP;
 
-	if (device->module->receive_data != NULL)
-		resume_thread(interface->reader_thread);
+	if (device->module->receive_data != NULL) {
+		for (uint32 i = 0; i < interface->reader_count; i++)
+			resume_thread(interface->readers[i].thread);
+	}
 
 	interface->up_count = 1;
 	return B_OK;
@@ -578,12 +904,12 @@ down_device_interface(net_device_interface* interface)
 	notify_device_monitors(interface, B_DEVICE_GOING_DOWN);
 
 	if (device->module->receive_data != NULL) {
-		thread_id readerThread = interface->reader_thread;
-
-		// make sure the reader thread is gone before shutting down the interface
-		// (note that we may be the reader thread)
-		status_t status;
-		wait_for_thread(readerThread, &status);
+		// make sure the reader threads are gone before shutting down the
+		// interface (note that we may be one of them)
+		for (uint32 i = 0; i < interface->reader_count; i++) {
+			status_t status;
+			wait_for_thread(interface->readers[i].thread, &status);
+		}
 	}
 }
 
@@ -838,7 +1164,7 @@ device_enqueue_buffer(net_device* device, net_buffer* buffer)
 		return status;
 	}
 
-	status = fifo_enqueue_buffer(&interface->receive_queue, buffer);
+	status = device_interface_enqueue_buffer(interface, buffer);
 
 	put_device_interface(interface);
 	return status;
@@ -853,6 +1179,8 @@ init_device_interfaces()
 {
 	mutex_init(&sLock, "net device interfaces");
 
+	sFlowHashSeed = secure_get_random<uint32>();
+
 	new (&sInterfaces) DeviceInterfaceList;
 		// static C++ objects are not initialized in the module startup
 
@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2017, Haiku, Inc. All Rights Reserved.
+ * Copyright 2006-2026, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -26,9 +26,26 @@ typedef DoublyLinkedList<net_device_handler> DeviceHandlerList;
 typedef DoublyLinkedList<net_device_monitor,
 	DoublyLinkedListCLink<net_device_monitor> > DeviceMonitorList;
 
+struct net_device_interface;
+
+struct net_device_reader {
+	net_device_interface* interface;
+	uint32				queue;
+	thread_id			thread;
+};
+
+struct net_device_consumer {
+	net_device_interface* interface;
+	int32				cpu;
+	thread_id			thread;
+	net_fifo			queue;
+};
+
 struct net_device_interface : DoublyLinkedListLinkImpl<net_device_interface> {
 	struct net_device*	device;
-	thread_id			reader_thread;
+	uint32				reader_count;
+	net_device_reader*	readers;
+		// one per hardware receive queue
 	uint32				up_count;
 		// a device can be brought up by more than one interface
 	int32				ref_count;
@@ -44,8 +61,13 @@ struct net_device_interface : DoublyLinkedListLinkImpl<net_device_interface> {
 	DeviceHandlerList	receive_funcs;
 	recursive_lock		receive_lock;
 
-	thread_id			consumer_thread;
-	net_fifo			receive_queue;
+	rw_lock				filter_lock;
+	net_filter*			receive_filter;
+		// drops the received frames it does not accept
+
+	uint32				consumer_count;
+	net_device_consumer* consumers;
+		// one per CPU; a flow is always handled by the same one
 };
 
 typedef DoublyLinkedList<net_device_interface> DeviceInterfaceList;
@@ -63,6 +85,11 @@ struct net_device_interface* get_device_interface(const char* name,
 	bool create = true);
 void device_interface_monitor_receive(net_device_interface* interface,
 	net_buffer* buffer);
+status_t device_interface_enqueue_buffer(net_device_interface* interface,
+	net_buffer* buffer);
+uint32 device_interface_flow_hash(net_buffer* buffer, size_t offset);
+void set_device_interface_filter(net_device_interface* interface,
+	net_filter* filter);
 status_t up_device_interface(net_device_interface* interface);
 void down_device_interface(net_device_interface* interface);
 
@@ -132,12 +132,13 @@ register_domain(int family, const char* name,
 	if (domain == NULL)
 		return B_NO_MEMORY;
 
-	recursive_lock_init(&domain->lock, name);
+	rw_lock_init(&domain->lock, name);
 
 	domain->family = family;
 	domain->name = name;
 	domain->module = module;
 	domain->address_module = addressModule;
+	domain->route_generation = 0;
 
 	sDomains.Add(domain);
 
@@ -157,7 +158,7 @@ unregister_domain(net_domain* _domain)
 
 	sDomains.Remove(domain);
 
-	recursive_lock_destroy(&domain->lock);
+	rw_lock_destroy(&domain->lock);
 	delete domain;
 	return B_OK;
 }
@@ -21,7 +21,7 @@ struct net_device_interface;
 
 struct net_domain_private : net_domain,
 		DoublyLinkedListLinkImpl<net_domain_private> {
-	recursive_lock		lock;
+	rw_lock				lock;
 
 	RouteList			routes;
 	RouteInfoList		route_infos;
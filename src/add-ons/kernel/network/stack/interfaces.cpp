@@ -81,7 +81,7 @@ typedef BOpenHashTable<AddressHashDefinition, true, false> AddressTable;
 
 static recursive_lock sLock;
 static InterfaceList sInterfaces;
-static mutex sHashLock;
+static rw_lock sHashLock;
 static AddressTable sAddressTable;
 static uint32 sInterfaceIndex;
 
@@ -612,7 +612,7 @@ Interface::AddAddress(InterfaceAddress* address)
 	locker.Unlock();
 
 	if (address->LocalIsDefined()) {
-		MutexLocker hashLocker(sHashLock);
+		WriteLocker hashLocker(sHashLock);
 		sAddressTable.Insert(address);
 	}
 	return B_OK;
@@ -634,7 +634,7 @@ Interface::RemoveAddress(InterfaceAddress* address)
 	locker.Unlock();
 
 	if (address->LocalIsDefined()) {
-		MutexLocker hashLocker(sHashLock);
+		WriteLocker hashLocker(sHashLock);
 		sAddressTable.Remove(address);
 	}
 }
@@ -724,7 +724,7 @@ Interface::RemoveAddresses()
 		locker.Unlock();
 
 		if (address->LocalIsDefined()) {
-			MutexLocker hashLocker(sHashLock);
+			WriteLocker hashLocker(sHashLock);
 			sAddressTable.Remove(address);
 		}
 		address->ReleaseReference();
@@ -1345,7 +1345,7 @@ update_interface_address(InterfaceAddress* interfaceAddress, int32 option,
 		AddressString(interfaceAddress->domain, oldAddress).Data(),
 		AddressString(interfaceAddress->domain, newAddress).Data());
 
-	MutexLocker locker(sHashLock);
+	WriteLocker locker(sHashLock);
 
 	// set logical interface address
 	sockaddr** _address = interfaceAddress->AddressFor(option);
@@ -1531,7 +1531,7 @@ get_interface_address(const sockaddr* local)
 	if (local->sa_family == AF_UNSPEC)
 		return NULL;
 
-	MutexLocker locker(sHashLock);
+	ReadLocker locker(sHashLock);
 
 	InterfaceAddress* address = sAddressTable.Lookup(local);
 	if (address == NULL)
@@ -1665,7 +1665,7 @@ status_t
 init_interfaces()
 {
 	recursive_lock_init(&sLock, "net interfaces");
-	mutex_init(&sHashLock, "net local addresses");
+	rw_lock_init(&sHashLock, "net local addresses");
 
 	new (&sInterfaces) InterfaceList;
 	new (&sAddressTable) AddressTable;
@@ -1696,7 +1696,7 @@ uninit_interfaces()
 #endif
 
 	recursive_lock_destroy(&sLock);
-	mutex_destroy(&sHashLock);
+	rw_lock_destroy(&sHashLock);
 	return B_OK;
 }
 
@@ -30,6 +30,7 @@
 #include "device_interfaces.h"
 #include "domains.h"
 #include "interfaces.h"
+#include "packet_rings.h"
 #include "stack_private.h"
 #include "utility.h"
 
@@ -57,6 +58,11 @@ public:
 
 			size_t				MTU();
 
+			status_t			CreatePacketRing(packet_ring_request& request);
+			status_t			DeletePacketRing();
+			status_t			SendPacketRing();
+			ssize_t				AvailableData() const;
+
 protected:
 			status_t			SocketStatus(bool peek) const;
 
@@ -75,6 +81,7 @@ private:
 			net_device_interface* fMonitoredDevice;
 			net_device_interface* fBoundToDevice;
 			uint32				fBoundType;
+			PacketRing*			fRing;
 };
 
 
@@ -85,7 +92,8 @@ LinkProtocol::LinkProtocol(net_socket* socket)
 	:
 	LocalDatagramSocket("packet capture", socket),
 	fMonitoredDevice(NULL),
-	fBoundToDevice(NULL)
+	fBoundToDevice(NULL),
+	fRing(NULL)
 {
 	fMonitor.cookie = this;
 	fMonitor.receive = _MonitorData;
@@ -95,6 +103,8 @@ LinkProtocol::LinkProtocol(net_socket* socket)
 
 LinkProtocol::~LinkProtocol()
 {
+	delete fRing;
+
 	if (fMonitoredDevice != NULL) {
 		unregister_device_monitor(fMonitoredDevice->device, &fMonitor);
 		put_device_interface(fMonitoredDevice);
@@ -218,10 +228,90 @@ LinkProtocol::MTU()
 }
 
 
+status_t
+LinkProtocol::CreatePacketRing(packet_ring_request& request)
+{
+	net_device_interface* interface = get_device_interface(request.name);
+	if (interface == NULL)
+		return B_DEVICE_NOT_FOUND;
+
+	MutexLocker locker(fLock);
+
+	if (fRing != NULL) {
+		put_device_interface(interface);
+		return B_BUSY;
+	}
+
+	PacketRing* ring = new(std::nothrow) PacketRing(socket);
+	if (ring == NULL) {
+		put_device_interface(interface);
+		return B_NO_MEMORY;
+	}
+
+	// the ring owns the interface reference from here on
+	status_t status = ring->Init(interface, request);
+	if (status != B_OK) {
+		delete ring;
+		return status;
+	}
+
+	fRing = ring;
+	return B_OK;
+}
+
+
+status_t
+LinkProtocol::DeletePacketRing()
+{
+	MutexLocker locker(fLock);
+
+	PacketRing* ring = fRing;
+	if (ring == NULL)
+		return B_BAD_VALUE;
+
+	fRing = NULL;
+	locker.Unlock();
+
+	// detaching from the device may have to wait for its monitors
+	delete ring;
+	return B_OK;
+}
+
+
+status_t
+LinkProtocol::SendPacketRing()
+{
+	MutexLocker locker(fLock);
+
+	if (fRing == NULL)
+		return B_BAD_VALUE;
+
+	return fRing->Send();
+}
+
+
+ssize_t
+LinkProtocol::AvailableData() const
+{
+	MutexLocker locker(fLock);
+
+	// DeletePacketRing() may delete the ring as soon as we unlock
+	if (fRing != NULL)
+		return fRing->Available();
+
+	locker.Unlock();
+
+	return LocalDatagramSocket::AvailableData();
+}
+
+
+/*!	The DatagramSocket only calls this with fLock held. */
 status_t
 LinkProtocol::SocketStatus(bool peek) const
 {
-	if (fMonitoredDevice == NULL && !IsBound())
+	ASSERT_LOCKED_MUTEX(&fLock);
+
+	if (fMonitoredDevice == NULL && !IsBound() && fRing == NULL)
 		return B_DEVICE_NOT_FOUND;
 
 	return LocalDatagramSocket::SocketStatus(peek);
@@ -494,6 +584,35 @@ link_control(net_protocol* _protocol, int level, int option, void* value,
 
 			return protocol->StopMonitoring(request.ifr_name);
 		}
+
+		case SIOCSPACKETRING:
+		{
+			// Only root is allowed to see the packets of a device
+			if (geteuid() != 0)
+				return B_NOT_ALLOWED;
+
+			packet_ring_request request;
+			if (user_memcpy(&request, value, sizeof(request)) != B_OK)
+				return B_BAD_ADDRESS;
+
+			request.name[IF_NAMESIZE - 1] = '\0';
+
+			status_t status = protocol->CreatePacketRing(request);
+			if (status != B_OK)
+				return status;
+
+			if (user_memcpy(value, &request, sizeof(request)) != B_OK) {
+				protocol->DeletePacketRing();
+				return B_BAD_ADDRESS;
+			}
+			return B_OK;
+		}
+
+		case SIOCCPACKETRING:
+			return protocol->DeletePacketRing();
+
+		case SIOCFPACKETRING:
+			return protocol->SendPacketRing();
 	}
 
 	return gNetDatalinkModule.control(sDomain, option, value, _length);
@@ -523,6 +642,10 @@ link_setsockopt(net_protocol* protocol, int level, int option,
 			value, length);
 	}
 
+	if (level == SOL_SOCKET
+		&& (option == SO_ATTACH_FILTER || option == SO_DETACH_FILTER))
+		return ((LinkProtocol*)protocol)->SetFilter(option, value, length);
+
 	return gNetSocketModule.set_option(protocol->socket, level, option,
 		value, length);
 }
@@ -53,6 +53,11 @@
 #define DATA_NODE_READ_ONLY		0x1
 #define DATA_NODE_STORED_HEADER	0x2
 
+#define DATA_HEADER_EXTERNAL	0x1
+
+#define MAX_EXTERNAL_NODE_SIZE	(15 * B_PAGE_SIZE)
+	// must fit into data_node::used
+
 struct header_space {
 	uint16	size;
 	uint16	free;
@@ -70,6 +75,14 @@ struct data_header {
 	uint8*			data_end;
 	header_space	space;
 	uint16			tail_space;
+	uint16			flags;
+};
+
+// Refers to memory the buffer does not own, see append_external_data().
+struct external_data_header {
+	data_header		header;
+	net_buffer_release_func release;
+	void*			cookie;
 };
 
 struct data_node {
@@ -813,6 +826,7 @@ create_data_header(size_t headerSpace)
 	header->tail_space = (uint8*)header + BUFFER_SIZE - header->data_end
 		- headerSpace;
 	header->first_free = NULL;
+	header->flags = 0;
 
 	TRACE(("%d:   create new data header %p\n", find_thread(NULL), header));
 	T2(CreateDataHeader(header));
@@ -828,6 +842,12 @@ release_data_header(data_header* header)
 	if (refCount != 1)
 		return;
 
+	if ((header->flags & DATA_HEADER_EXTERNAL) != 0) {
+		external_data_header* external = (external_data_header*)header;
+		if (external->release != NULL)
+			external->release(external->cookie);
+	}
+
 	TRACE(("%d:   free header %p\n", find_thread(NULL), header));
 	free_data_header(header);
 }
@@ -1081,6 +1101,11 @@ copy_metadata(net_buffer* destination, const net_buffer* source)
 	destination->offset = source->offset;
 	destination->protocol = source->protocol;
 	destination->type = source->type;
+
+	destination->checksum_offset = source->checksum_offset;
+	destination->offload_flags = source->offload_flags;
+	destination->transport_size = source->transport_size;
+	destination->segment_size = source->segment_size;
 }
 
 
@@ -1128,6 +1153,8 @@ create_buffer(size_t headerSpace)
 	buffer->offset = 0;
 	buffer->flags = 0;
 	buffer->size = 0;
+	buffer->offload_flags = 0;
+	buffer->segment_size = 0;
 
 	CHECK_BUFFER(buffer);
 	CREATE_PARANOIA_CHECK_SET(buffer, "net_buffer");
@@ -2008,6 +2035,73 @@ append_cloned_data(net_buffer* _buffer, net_buffer* _source, uint32 offset,
 }
 
 
+/*!	Appends \a bytes of memory at \a data to the buffer without copying
+	them. The memory is referenced by the buffer, and by all buffers its data
+	is cloned into, and must stay valid and unchanged until \a release has
+	been called with \a cookie. That happens once, when the last of them is
+	gone. If this function fails, \a release is not called.
+*/
+static status_t
+append_external_data(net_buffer* _buffer, void* data, size_t bytes,
+	net_buffer_release_func release, void* cookie)
+{
+	net_buffer_private* buffer = (net_buffer_private*)_buffer;
+	TRACE(("%d: append_external_data(buffer %p, data %p, bytes = %ld)\n",
+		find_thread(NULL), buffer, data, bytes));
+
+	if (bytes == 0 || release == NULL)
+		return B_BAD_VALUE;
+
+	ParanoiaChecker _(buffer);
+
+	// the header is only used to count the references to the data
+	external_data_header* external
+		= (external_data_header*)allocate_data_header();
+	if (external == NULL)
+		return ENOBUFS;
+
+	data_header* header = &external->header;
+	header->ref_count = 1;
+	header->physical_address = 0;
+	header->first_free = NULL;
+	header->data_end = (uint8*)data;
+	header->space.size = header->space.free = 0;
+	header->tail_space = 0;
+	header->flags = DATA_HEADER_EXTERNAL;
+	external->release = release;
+	external->cookie = cookie;
+
+	size_t sizeAppended = 0;
+	while (sizeAppended < bytes) {
+		data_node* node = add_data_node(buffer, header);
+		if (node == NULL) {
+			remove_trailer(buffer, sizeAppended);
+			external->release = NULL;
+			release_data_header(header);
+			return ENOBUFS;
+		}
+
+		node->offset = buffer->size;
+		node->start = (uint8*)data + sizeAppended;
+		node->used = min_c(bytes - sizeAppended, MAX_EXTERNAL_NODE_SIZE);
+		node->flags = DATA_NODE_READ_ONLY;
+		list_add_item(&buffer->buffers, node);
+
+		buffer->size += node->used;
+		sizeAppended += node->used;
+	}
+
+	// the nodes keep the header alive from now on
+	release_data_header(header);
+
+	CHECK_BUFFER(buffer);
+	SET_PARANOIA_CHECK(PARANOIA_SUSPICIOUS, buffer, &buffer->size,
+		sizeof(buffer->size));
+
+	return B_OK;
+}
+
+
 void
 set_ancillary_data(net_buffer* buffer, ancillary_data_container* container)
 {
@@ -2377,6 +2471,7 @@ net_buffer_module_info gNetBufferModule = {
 	remove_trailer,
 	trim_data,
 	append_cloned_data,
+	append_external_data,
 
 	NULL,	// associate_data
 
@@ -1424,6 +1424,95 @@ socket_send(net_socket* socket, msghdr* header, const void* data, size_t length,
 }
 
 
+/*!	Sends memory the caller owns without copying it, see
+	net_buffer_module_info::append_external(). \a release is always called
+	once the stack no longer refers to the memory, even if nothing could be
+	sent. Only connected sockets of protocols that queue their buffers are
+	supported.
+*/
+ssize_t
+socket_send_external(net_socket* socket, void* data, size_t length, int flags,
+	net_buffer_release_func release, void* cookie)
+{
+	const bool nosignal = ((flags & MSG_NOSIGNAL) != 0);
+	flags &= ~MSG_NOSIGNAL;
+
+	if (length == 0 || length > SSIZE_MAX) {
+		release(cookie);
+		return length == 0 ? 0 : B_BAD_VALUE;
+	}
+
+	if (socket->first_info->send_data_no_buffer != NULL
+		|| (socket->first_info->flags & NET_PROTOCOL_ATOMIC_MESSAGES) != 0) {
+		release(cookie);
+		return B_NOT_SUPPORTED;
+	}
+	if (socket->peer.ss_len == 0 || socket->address.ss_len == 0) {
+		release(cookie);
+		return ENOTCONN;
+	}
+
+	// all buffers sent are cloned from this one
+	net_buffer* source = gNetBufferModule.create(0);
+	if (source == NULL) {
+		release(cookie);
+		return ENOBUFS;
+	}
+	if (gNetBufferModule.append_external(source, data, length, release,
+			cookie) != B_OK) {
+		gNetBufferModule.free(source);
+		release(cookie);
+		return ENOBUFS;
+	}
+
+	ssize_t bytesSent = 0;
+	status_t status = B_OK;
+
+	while ((size_t)bytesSent < length) {
+		size_t bufferSize = min_c(length - bytesSent, socket->send.buffer_size);
+
+		net_buffer* buffer = gNetBufferModule.create(256);
+		if (buffer == NULL) {
+			status = ENOBUFS;
+			break;
+		}
+		status = gNetBufferModule.append_cloned(buffer, source, bytesSent,
+			bufferSize);
+		if (status != B_OK) {
+			gNetBufferModule.free(buffer);
+			break;
+		}
+
+		buffer->flags = flags;
+		memcpy(buffer->source, &socket->address, socket->address.ss_len);
+		memcpy(buffer->destination, &socket->peer, socket->peer.ss_len);
+
+		status = socket->first_info->send_data(socket->first_protocol, buffer);
+		if (status != B_OK) {
+			// we only send signals when called from userland
+			if (status == EPIPE && is_syscall() && !nosignal)
+				send_signal(find_thread(NULL), SIGPIPE);
+
+			// the protocol might have taken part of the data
+			bytesSent += bufferSize - buffer->size;
+			gNetBufferModule.free(buffer);
+			break;
+		}
+
+		bytesSent += bufferSize;
+	}
+
+	gNetBufferModule.free(source);
+
+	if (bytesSent > 0
+		&& (status == B_OK || status == B_INTERRUPTED
+			|| status == B_WOULD_BLOCK)) {
+		return bytesSent;
+	}
+	return status;
+}
+
+
 status_t
 socket_set_option(net_socket* socket, int level, int option, const void* value,
 	int length)
@@ -1706,6 +1795,7 @@ net_socket_module_info gNetSocketModule = {
 	socket_listen,
 	socket_receive,
 	socket_send,
+	socket_send_external,
 	socket_setsockopt,
 	socket_shutdown,
 	socket_socketpair
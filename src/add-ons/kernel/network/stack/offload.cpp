@@ -0,0 +1,401 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "offload.h"
+
+#include "stack_private.h"
+#include "utility.h"
+
+#include <KernelExport.h>
+
+#include <NetUtilities.h>
+
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/ip6.h>
+#include <string.h>
+
+
+//#define TRACE_OFFLOAD
+#ifdef TRACE_OFFLOAD
+#	define TRACE(x) dprintf x
+#else
+#	define TRACE(x) ;
+#endif
+
+
+struct tcp_header {
+	uint16	source_port;
+	uint16	destination_port;
+	uint32	sequence;
+	uint32	acknowledge;
+	uint8	header_length;
+		// in 32 bit words, in the upper four bits
+	uint8	flags;
+	uint16	window;
+	uint16	checksum;
+	uint16	urgent_offset;
+
+	size_t HeaderLength() const { return (header_length >> 4) << 2; }
+} _PACKED;
+
+enum {
+	TCP_FLAG_FINISH				= 0x01,
+	TCP_FLAG_PUSH				= 0x08,
+	TCP_FLAG_ACKNOWLEDGE		= 0x10,
+	TCP_FLAG_WINDOW_REDUCED		= 0x80
+};
+
+static const size_t kMaxSegmentationHeaderLength = 192;
+	// link, network, and transport header of a buffer to be segmented
+static const size_t kMaxCoalesceHeaderLength = sizeof(ip6_hdr) + 60;
+	// IPv6 and the largest TCP header
+
+
+/*!	Adds the source and destination address of the IPv4 or IPv6 \a header
+	to \a checksum, as part of the TCP pseudo header.
+*/
+static void
+checksum_addresses(Checksum& checksum, const uint8* header)
+{
+	const uint16* words;
+	int32 count;
+	if ((header[0] >> 4) == 4) {
+		words = (const uint16*)&((const ip*)header)->ip_src;
+		count = 2 * sizeof(in_addr) / sizeof(uint16);
+	} else {
+		words = (const uint16*)&((const ip6_hdr*)header)->ip6_src;
+		count = 2 * sizeof(in6_addr) / sizeof(uint16);
+	}
+
+	for (int32 i = 0; i < count; i++)
+		checksum << words[i];
+}
+
+
+/*!	Updates the length, and the checksum of the IPv4 or IPv6 \a header for
+	a packet of \a size bytes.
+*/
+static void
+update_network_header(uint8* header, size_t size)
+{
+	if ((header[0] >> 4) == 4) {
+		ip* ipv4 = (ip*)header;
+		ipv4->ip_len = htons(size);
+		ipv4->ip_sum = 0;
+		ipv4->ip_sum = ~compute_checksum(header, ipv4->ip_hl << 2);
+	} else
+		((ip6_hdr*)header)->ip6_plen = htons(size - sizeof(ip6_hdr));
+}
+
+
+//	#pragma mark - segmentation
+
+
+/*!	Returns whether \a buffer is meant to be cut into TCP segments, and
+	\a device cannot do that itself.
+*/
+bool
+needs_software_segmentation(net_device* device, net_buffer* buffer)
+{
+	if ((buffer->offload_flags & NET_BUFFER_SEGMENT_TCP) == 0)
+		return false;
+
+	uint8 version;
+	if (gNetBufferModule.read(buffer, device->header_length, &version,
+			sizeof(version)) != B_OK)
+		return true;
+
+	uint32 required = (version >> 4) == 6
+		? NET_DEVICE_OFFLOAD_TSO6 : NET_DEVICE_OFFLOAD_TSO4;
+	return (device->offload & required) == 0;
+}
+
+
+/*!	Cuts the TCP data of \a buffer into segments of buffer::segment_size
+	bytes each, and adds them to \a segments. The headers in front of the
+	data are copied into every segment, and adjusted accordingly; the data
+	itself is shared with \a buffer.
+	The checksums are left to the device if it can compute them.
+*/
+status_t
+segment_buffer(net_device* device, net_buffer* buffer, struct list* segments)
+{
+	size_t networkOffset = device->header_length;
+	size_t transportOffset = buffer->size - buffer->transport_size;
+	if (buffer->segment_size == 0
+		|| buffer->transport_size < sizeof(tcp_header)
+		|| transportOffset < networkOffset + sizeof(ip))
+		return B_BAD_VALUE;
+
+	uint8 header[kMaxSegmentationHeaderLength];
+	if (gNetBufferModule.read(buffer, transportOffset, header,
+			sizeof(tcp_header)) != B_OK)
+		return B_BAD_DATA;
+
+	size_t transportHeaderLength = ((tcp_header*)header)->HeaderLength();
+	size_t headerLength = transportOffset + transportHeaderLength;
+	if (transportHeaderLength < sizeof(tcp_header)
+		|| headerLength > sizeof(header) || headerLength > buffer->size
+		|| gNetBufferModule.read(buffer, 0, header, headerLength) != B_OK)
+		return B_BAD_DATA;
+
+	uint8* networkHeader = header + networkOffset;
+	tcp_header& tcp = *(tcp_header*)(header + transportOffset);
+	bool ipv4 = (networkHeader[0] >> 4) == 4;
+	uint16 id = ipv4 ? ntohs(((ip*)networkHeader)->ip_id) : 0;
+	uint32 sequence = ntohl(tcp.sequence);
+	uint8 flags = tcp.flags;
+	bool deviceChecksum
+		= (device->offload & NET_DEVICE_OFFLOAD_TX_CHECKSUM) != 0;
+
+	TRACE(("segment_buffer(): %" B_PRIu32 " bytes, header %" B_PRIuSIZE
+		", segment size %" B_PRIu16 "\n", buffer->size, headerLength,
+		buffer->segment_size));
+
+	uint32 offset = headerLength;
+	for (uint16 index = 0; offset < buffer->size; index++) {
+		uint32 length = min_c(buffer->size - offset, buffer->segment_size);
+		uint16 transportLength = transportHeaderLength + length;
+
+		if (ipv4)
+			((ip*)networkHeader)->ip_id = htons(id + index);
+		update_network_header(networkHeader,
+			transportOffset - networkOffset + transportLength);
+
+		// FIN and PSH belong to the last segment, CWR to the first one only
+		tcp.sequence = htonl(sequence + offset - headerLength);
+		tcp.flags = flags;
+		if (offset + length < buffer->size)
+			tcp.flags &= ~(TCP_FLAG_FINISH | TCP_FLAG_PUSH);
+		if (index > 0)
+			tcp.flags &= ~TCP_FLAG_WINDOW_REDUCED;
+
+		Checksum pseudoHeader;
+		checksum_addresses(pseudoHeader, networkHeader);
+		pseudoHeader << (uint16)htons(IPPROTO_TCP)
+			<< (uint16)htons(transportLength);
+		tcp.checksum = pseudoHeader.Folded();
+
+		net_buffer* segment = gNetBufferModule.create(headerLength);
+		if (segment == NULL)
+			return B_NO_MEMORY;
+
+		list_add_item(segments, segment);
+
+		segment->offload_flags = NET_BUFFER_CHECKSUM_PARTIAL;
+		segment->checksum_offset = offsetof(tcp_header, checksum);
+		segment->transport_size = transportLength;
+
+		status_t status = gNetBufferModule.append_cloned(segment, buffer,
+			offset, length);
+		if (status == B_OK) {
+			status = gNetBufferModule.prepend(segment, header,
+				headerLength);
+		}
+		if (status == B_OK && !deviceChecksum)
+			status = complete_checksum(segment);
+		if (status != B_OK)
+			return status;
+
+		offset += length;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Computes the checksum left to the device in software. */
+status_t
+complete_checksum(net_buffer* buffer)
+{
+	return Checksum::CompletePartial(&gNetBufferModule, buffer);
+}
+
+
+//	#pragma mark - coalescing
+
+
+/*!	Reads the headers of \a buffer, and checks whether it is a TCP segment
+	with data that can be coalesced with others. Its checksums are verified
+	in software, unless the device has done so already.
+*/
+static bool
+read_tcp_segment(net_buffer* buffer, uint8* header, size_t& _networkLength,
+	size_t& _headerLength)
+{
+	size_t length = min_c(buffer->size, kMaxCoalesceHeaderLength);
+	if (length < sizeof(ip) + sizeof(tcp_header)
+		|| gNetBufferModule.read(buffer, 0, header, length) != B_OK)
+		return false;
+
+	size_t networkLength;
+	if (buffer->type == B_NET_FRAME_TYPE_IPV4) {
+		const ip* ipv4 = (const ip*)header;
+		if (ipv4->ip_v != 4 || ipv4->ip_hl != sizeof(ip) >> 2
+			|| ipv4->ip_p != IPPROTO_TCP
+			|| (ntohs(ipv4->ip_off) & (IP_MF | IP_OFFMASK)) != 0
+			|| ntohs(ipv4->ip_len) != buffer->size
+			|| compute_checksum(header, sizeof(ip)) != 0xffff)
+			return false;
+
+		networkLength = sizeof(ip);
+	} else if (buffer->type == B_NET_FRAME_TYPE_IPV6) {
+		const ip6_hdr* ipv6 = (const ip6_hdr*)header;
+		if ((header[0] >> 4) != 6 || ipv6->ip6_nxt != IPPROTO_TCP
+			|| ntohs(ipv6->ip6_plen) + sizeof(ip6_hdr) != buffer->size)
+			return false;
+
+		networkLength = sizeof(ip6_hdr);
+	} else
+		return false;
+
+	if (length < networkLength + sizeof(tcp_header))
+		return false;
+
+	const tcp_header& tcp = *(const tcp_header*)(header + networkLength);
+	size_t headerLength = networkLength + tcp.HeaderLength();
+	if (tcp.HeaderLength() < sizeof(tcp_header) || headerLength > length
+		|| headerLength >= buffer->size
+		|| tcp.flags != (tcp.flags & (TCP_FLAG_ACKNOWLEDGE | TCP_FLAG_PUSH))
+		|| (tcp.flags & TCP_FLAG_ACKNOWLEDGE) == 0)
+		return false;
+
+	if ((buffer->offload_flags & NET_BUFFER_CHECKSUM_VALID) == 0) {
+		uint16 transportLength = buffer->size - networkLength;
+		int32 dataSum = gNetBufferModule.checksum(buffer, networkLength,
+			transportLength, false);
+		if (dataSum < 0)
+			return false;
+
+		Checksum checksum;
+		checksum_addresses(checksum, header);
+		checksum << (uint16)htons(IPPROTO_TCP) << (uint16)htons(transportLength)
+			<< (uint16)dataSum;
+		if ((uint16)checksum != 0)
+			return false;
+
+		buffer->offload_flags |= NET_BUFFER_CHECKSUM_VALID;
+	}
+
+	_networkLength = networkLength;
+	_headerLength = headerLength;
+	return true;
+}
+
+
+/*!	Returns whether the segment with the \a next header directly follows the
+	one with the \a first header in the same flow, and carries the same
+	acknowledgement, window, and options.
+*/
+static bool
+is_next_segment(const uint8* first, const uint8* next, size_t networkLength,
+	size_t headerLength, uint32 nextSequence)
+{
+	if (networkLength == sizeof(ip)) {
+		const ip* firstIPv4 = (const ip*)first;
+		const ip* nextIPv4 = (const ip*)next;
+		if (firstIPv4->ip_tos != nextIPv4->ip_tos
+			|| firstIPv4->ip_ttl != nextIPv4->ip_ttl
+			|| memcmp(&firstIPv4->ip_src, &nextIPv4->ip_src,
+				2 * sizeof(in_addr)) != 0)
+			return false;
+	} else {
+		const ip6_hdr* firstIPv6 = (const ip6_hdr*)first;
+		const ip6_hdr* nextIPv6 = (const ip6_hdr*)next;
+		if (firstIPv6->ip6_flow != nextIPv6->ip6_flow
+			|| firstIPv6->ip6_hlim != nextIPv6->ip6_hlim
+			|| memcmp(&firstIPv6->ip6_src, &nextIPv6->ip6_src,
+				2 * sizeof(in6_addr)) != 0)
+			return false;
+	}
+
+	const tcp_header& firstTCP = *(const tcp_header*)(first + networkLength);
+	const tcp_header& nextTCP = *(const tcp_header*)(next + networkLength);
+	size_t optionsOffset = networkLength + sizeof(tcp_header);
+
+	return firstTCP.source_port == nextTCP.source_port
+		&& firstTCP.destination_port == nextTCP.destination_port
+		&& ntohl(nextTCP.sequence) == nextSequence
+		&& firstTCP.acknowledge == nextTCP.acknowledge
+		&& firstTCP.header_length == nextTCP.header_length
+		&& firstTCP.window == nextTCP.window
+		&& memcmp(first + optionsOffset, next + optionsOffset,
+			headerLength - optionsOffset) == 0;
+}
+
+
+/*!	Merges the TCP segments waiting in \a fifo that directly follow
+	\a buffer in the same flow into it, so that the protocols only see one
+	large segment. Only plain in-order data segments are coalesced; the
+	result is marked NET_BUFFER_CHECKSUM_VALID.
+	Returns the first buffer dequeued that could not be merged, if any; it
+	has to be processed next.
+*/
+net_buffer*
+coalesce_received_buffers(net_fifo* fifo, net_buffer* buffer)
+{
+	net_buffer* next;
+	if (fifo_dequeue_buffer(fifo, 0, 0, &next) != B_OK)
+		return NULL;
+
+	uint32 firstHeader[kMaxCoalesceHeaderLength / sizeof(uint32)];
+	uint8* first = (uint8*)firstHeader;
+	size_t networkLength;
+	size_t headerLength;
+	if (!read_tcp_segment(buffer, first, networkLength, headerLength))
+		return next;
+
+	tcp_header& tcp = *(tcp_header*)(first + networkLength);
+	uint32 nextSequence = ntohl(tcp.sequence) + buffer->size - headerLength;
+	int32 count = 1;
+
+	while ((tcp.flags & TCP_FLAG_PUSH) == 0) {
+		uint32 nextHeader[kMaxCoalesceHeaderLength / sizeof(uint32)];
+		size_t nextNetworkLength;
+		size_t nextHeaderLength;
+		if (next->interface_address != NULL || next->type != buffer->type
+			|| !read_tcp_segment(next, (uint8*)nextHeader, nextNetworkLength,
+				nextHeaderLength)
+			|| nextNetworkLength != networkLength
+			|| !is_next_segment(first, (uint8*)nextHeader, networkLength,
+				headerLength, nextSequence)
+			|| buffer->size + next->size - headerLength > IP_MAXPACKET)
+			break;
+
+		uint32 dataSize = next->size - headerLength;
+		uint8 nextFlags
+			= ((tcp_header*)((uint8*)nextHeader + networkLength))->flags;
+
+		if (gNetBufferModule.remove_header(next, headerLength) != B_OK
+			|| gNetBufferModule.merge(buffer, next, true) != B_OK) {
+			// the data will be retransmitted
+			gNetBufferModule.free(next);
+			next = NULL;
+			break;
+		}
+
+		tcp.flags |= nextFlags & TCP_FLAG_PUSH;
+		nextSequence += dataSize;
+		count++;
+
+		if (fifo_dequeue_buffer(fifo, 0, 0, &next) != B_OK) {
+			next = NULL;
+			break;
+		}
+	}
+
+	if (count > 1) {
+		TRACE(("coalesce_received_buffers(): merged %" B_PRId32 " segments "
+			"into %" B_PRIu32 " bytes\n", count, buffer->size));
+
+		// the TCP checksum is no longer valid, but has been verified
+		update_network_header(first, buffer->size);
+		gNetBufferModule.write(buffer, 0, first, headerLength);
+	}
+
+	return next;
+}
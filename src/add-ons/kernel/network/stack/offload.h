@@ -0,0 +1,25 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef OFFLOAD_H
+#define OFFLOAD_H
+
+
+#include <net_device.h>
+#include <net_stack.h>
+
+#include <util/list.h>
+
+
+// generic segmentation and checksum offload
+bool needs_software_segmentation(net_device* device, net_buffer* buffer);
+status_t segment_buffer(net_device* device, net_buffer* buffer,
+	struct list* segments);
+status_t complete_checksum(net_buffer* buffer);
+
+// generic receive offload
+net_buffer* coalesce_received_buffers(net_fifo* fifo, net_buffer* buffer);
+
+
+#endif	// OFFLOAD_H
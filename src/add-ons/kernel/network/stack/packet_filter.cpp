@@ -0,0 +1,178 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Packet filters, as attached to sockets with SO_ATTACH_FILTER, or to
+	devices with SIOCSIFFILTER. Their programs are verified when they are
+	created, and translated into machine code where possible; they are
+	interpreted otherwise.
+*/
+
+
+#include "packet_filter.h"
+
+#include "bpf.h"
+#include "stack_private.h"
+#include "utility.h"
+
+#include <KernelExport.h>
+
+#include <kernel.h>
+#include <net/bpf.h>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+
+//#define TRACE_PACKET_FILTER
+#ifdef TRACE_PACKET_FILTER
+#	define TRACE(x...) dprintf(STACK_DEBUG_PREFIX x)
+#else
+#	define TRACE(x...) ;
+#endif
+
+
+struct net_filter {
+	bpf_insn*			instructions;
+	uint32				count;
+	area_id				area;
+	bpf_jit_function	function;
+		// the translated program, if any
+};
+
+
+static status_t
+read_buffer(void* cookie, uint32 offset, void* data, size_t size)
+{
+	return gNetBufferModule.read((net_buffer*)cookie, offset, data, size);
+}
+
+
+/*!	Translates the program of the \a filter into machine code, and keeps
+	it in an area of its own, that cannot be written to anymore.
+*/
+static void
+compile_filter(net_filter* filter)
+{
+	size_t size;
+	if (bpf_jit_compile(filter->instructions, filter->count, NULL, &size)
+			!= B_OK)
+		return;
+
+	void* code;
+	area_id area = create_area("packet filter", &code, B_ANY_KERNEL_ADDRESS,
+		ROUNDUP(size, B_PAGE_SIZE), B_FULL_LOCK,
+		B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA);
+	if (area < 0)
+		return;
+
+	if (bpf_jit_compile(filter->instructions, filter->count, (uint8*)code,
+			&size) != B_OK
+		|| set_area_protection(area,
+			B_KERNEL_READ_AREA | B_KERNEL_EXECUTE_AREA) != B_OK) {
+		delete_area(area);
+		return;
+	}
+
+	TRACE("packet filter: %" B_PRIu32 " instructions compiled to %" B_PRIuSIZE
+		" bytes\n", filter->count, size);
+
+	filter->area = area;
+	filter->function = (bpf_jit_function)code;
+}
+
+
+//	#pragma mark -
+
+
+/*!	Creates a filter from the \a program. When called from a syscall, its
+	instructions have to live in userland.
+*/
+status_t
+create_filter(const bpf_program* program, net_filter** _filter)
+{
+	uint32 count = program->bf_len;
+	if (count == 0 || count > BPF_MAXINSNS || program->bf_insns == NULL)
+		return B_BAD_VALUE;
+
+	net_filter* filter = new(std::nothrow) net_filter;
+	if (filter == NULL)
+		return B_NO_MEMORY;
+
+	filter->count = count;
+	filter->area = -1;
+	filter->function = NULL;
+	filter->instructions = (bpf_insn*)malloc(count * sizeof(bpf_insn));
+	if (filter->instructions == NULL) {
+		delete filter;
+		return B_NO_MEMORY;
+	}
+
+	size_t size = count * sizeof(bpf_insn);
+	status_t status = B_OK;
+	if (is_syscall()) {
+		if (!IS_USER_ADDRESS(program->bf_insns)
+			|| user_memcpy(filter->instructions, program->bf_insns, size)
+				!= B_OK) {
+			status = B_BAD_ADDRESS;
+		}
+	} else
+		memcpy(filter->instructions, program->bf_insns, size);
+
+	if (status == B_OK)
+		status = bpf_validate(filter->instructions, count);
+	if (status != B_OK) {
+		delete_filter(filter);
+		return status;
+	}
+
+	compile_filter(filter);
+
+	*_filter = filter;
+	return B_OK;
+}
+
+
+void
+delete_filter(net_filter* filter)
+{
+	if (filter == NULL)
+		return;
+
+	if (filter->area >= 0)
+		delete_area(filter->area);
+
+	free(filter->instructions);
+	delete filter;
+}
+
+
+/*!	Runs the \a filter on the data of the \a buffer, and returns how many
+	bytes of it it accepts; 0 means it should be dropped.
+*/
+uint32
+run_filter(net_filter* filter, net_buffer* buffer)
+{
+	bpf_packet packet;
+	packet.length = buffer->size;
+	packet.read = read_buffer;
+	packet.cookie = buffer;
+
+	// usually, the headers the filter looks at are in the first node
+	iovec vec;
+	if (gNetBufferModule.get_iovecs(buffer, &vec, 1) == 1) {
+		packet.data = (const uint8*)vec.iov_base;
+		packet.data_length = min_c(vec.iov_len, buffer->size);
+	} else {
+		packet.data = NULL;
+		packet.data_length = 0;
+	}
+
+	if (filter->function != NULL)
+		return filter->function(&packet);
+
+	return bpf_interpret(filter->instructions, &packet);
+}
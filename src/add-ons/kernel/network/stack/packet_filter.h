@@ -0,0 +1,19 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef PACKET_FILTER_H
+#define PACKET_FILTER_H
+
+
+#include <net_buffer.h>
+#include <net_stack.h>
+
+
+status_t create_filter(const struct bpf_program* program,
+	net_filter** _filter);
+void delete_filter(net_filter* filter);
+uint32 run_filter(net_filter* filter, net_buffer* buffer);
+
+
+#endif	// PACKET_FILTER_H
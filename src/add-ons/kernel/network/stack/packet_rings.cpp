@@ -0,0 +1,492 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+//! Memory mapped packet rings for AF_LINK sockets, see packet_ring.h
+
+
+#include "packet_rings.h"
+
+#include <net/if.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Drivers.h>
+#include <KernelExport.h>
+
+#include <kernel.h>
+#include <team.h>
+#include <util/AutoLock.h>
+#include <vm/vm.h>
+
+#include "device_interfaces.h"
+#include "stack_private.h"
+#include "utility.h"
+
+
+static const uint32 kDefaultFrameSize = 2048;
+static const uint32 kMinFrameSize = 128;
+static const size_t kMaxRingAreaSize = 128 * 1024 * 1024;
+
+
+static inline bool
+is_valid_ring_size(uint32 size)
+{
+	return size <= PACKET_RING_MAX_SIZE && (size & (size - 1)) == 0;
+}
+
+
+PacketRing::PacketRing(net_socket* socket)
+	:
+	fSocket(socket),
+	fInterface(NULL),
+	fQueue(0),
+	fZeroCopy(false),
+	fDeviceGone(false),
+	fArea(-1),
+	fHeader(NULL),
+	fReceiveFrames(NULL),
+	fDeviceFrameArea(-1),
+	fTeam(-1),
+	fTeamArea(-1),
+	fTeamFrameArea(-1),
+	fReceiveProducer(0),
+	fTransmitConsumer(0)
+{
+	mutex_init(&fLock, "packet ring");
+
+	fMonitor.cookie = this;
+	fMonitor.receive = _MonitorData;
+	fMonitor.event = _MonitorEvent;
+}
+
+
+PacketRing::~PacketRing()
+{
+	_Detach();
+	_DeleteAreas();
+
+	mutex_destroy(&fLock);
+}
+
+
+/*!	Sets up the ring for the queue of the device described by \a request,
+	and maps it into the current team. The ring takes over the reference to
+	the \a interface, even if this fails.
+*/
+status_t
+PacketRing::Init(net_device_interface* interface,
+	packet_ring_request& request)
+{
+	fInterface = interface;
+
+	uint32 mode = request.flags & (PACKET_RING_COPY | PACKET_RING_ZERO_COPY);
+	if (request.flags != mode
+		|| mode == (PACKET_RING_COPY | PACKET_RING_ZERO_COPY))
+		return B_BAD_VALUE;
+
+	if (request.frame_size == 0)
+		request.frame_size = kDefaultFrameSize;
+	if (request.frame_size < kMinFrameSize
+		|| request.frame_size > B_PAGE_SIZE
+		|| (request.frame_size & (request.frame_size - 1)) != 0
+		|| !is_valid_ring_size(request.rx_size)
+		|| !is_valid_ring_size(request.tx_size)
+		|| (request.rx_size == 0 && request.tx_size == 0))
+		return B_BAD_VALUE;
+
+	net_device* device = interface->device;
+	if (request.queue >= max_c(device->receive_queue_count, 1U))
+		return B_BAD_INDEX;
+
+	fQueue = request.queue;
+	fFrameSize = request.frame_size;
+	fReceiveSize = request.rx_size;
+	fTransmitSize = request.tx_size;
+
+	// Zero copy takes the queue away from the stack, so it is only used
+	// when explicitly asked for
+	status_t status;
+	if (mode == PACKET_RING_ZERO_COPY) {
+		if (fReceiveSize == 0 || device->module->attach_packet_ring == NULL)
+			return B_NOT_SUPPORTED;
+
+		// the device brings the memory for the received frames
+		status = _CreateArea(false);
+		if (status == B_OK)
+			status = _AttachToDevice();
+		if (status != B_OK)
+			return status;
+
+		fZeroCopy = true;
+	} else {
+		status = _CreateArea(true);
+		if (status != B_OK)
+			return status;
+	}
+
+	fHeader->flags = fZeroCopy ? PACKET_RING_ZERO_COPY : PACKET_RING_COPY;
+
+	// In copy mode, the monitor feeds the receive ring, and thus sees the
+	// frames of all queues, in both directions, just like packet capture
+	// does. In either mode, it tells us when the device goes away.
+	status = register_device_monitor(device, &fMonitor);
+	if (status != B_OK)
+		return status;
+
+	status = _MapIntoTeam(request);
+	if (status != B_OK)
+		return status;
+
+	request.flags = fHeader->flags;
+	return B_OK;
+}
+
+
+/*!	Returns the number of frames in the receive ring. */
+ssize_t
+PacketRing::Available()
+{
+	uint32 available = fHeader->rx.producer - fHeader->rx.consumer;
+	if (available > fReceiveSize)
+		available = 0;
+	if (available == 0 && fDeviceGone)
+		return B_DEVICE_NOT_FOUND;
+
+	return available;
+}
+
+
+/*!	Sends the frames userland put into the transmit ring. Invalid
+	descriptors are skipped. The caller has to make sure this is not called
+	concurrently.
+*/
+status_t
+PacketRing::Send()
+{
+	if (fTransmitSize == 0)
+		return B_BAD_VALUE;
+
+	MutexLocker locker(fLock);
+	if (fDeviceGone)
+		return B_DEVICE_NOT_FOUND;
+
+	net_device_interface* interface = acquire_device_interface(fInterface);
+	locker.Unlock();
+	if (interface == NULL)
+		return B_DEVICE_NOT_FOUND;
+
+	net_device* device = interface->device;
+	if ((device->flags & IFF_UP) == 0) {
+		put_device_interface(interface);
+		return ENETDOWN;
+	}
+
+	uint32 producer = fHeader->tx.producer;
+	if (producer - fTransmitConsumer > fTransmitSize) {
+		put_device_interface(interface);
+		return B_BAD_DATA;
+	}
+
+	// the descriptors must not be read before the index that covers them
+	memory_read_barrier();
+
+	status_t status = B_OK;
+	uint32 mask = fTransmitSize - 1;
+	while (fTransmitConsumer != producer) {
+		// userland can change the descriptor at any time
+		packet_ring_descriptor descriptor
+			= fTransmitDescriptors[fTransmitConsumer & mask];
+
+		status = _SendFrame(device, descriptor);
+		if (status == ENOBUFS || status == B_WOULD_BLOCK) {
+			// leave the rest for the next time
+			break;
+		}
+
+		fTransmitConsumer++;
+	}
+
+	fHeader->tx.consumer = fTransmitConsumer;
+	put_device_interface(interface);
+
+	return status == ENOBUFS || status == B_WOULD_BLOCK ? ENOBUFS : B_OK;
+}
+
+
+status_t
+PacketRing::_CreateArea(bool withReceiveFrames)
+{
+	// header, descriptors, transmit frames, and receive frames (in copy mode)
+	size_t receiveDescriptorsOffset = ROUNDUP(sizeof(packet_ring_header), 64);
+	size_t transmitDescriptorsOffset = receiveDescriptorsOffset
+		+ fReceiveSize * sizeof(packet_ring_descriptor);
+	size_t transmitFramesOffset = ROUNDUP(transmitDescriptorsOffset
+		+ fTransmitSize * sizeof(packet_ring_descriptor), B_PAGE_SIZE);
+	size_t receiveFramesOffset = transmitFramesOffset
+		+ (size_t)fTransmitSize * fFrameSize;
+
+	size_t size = receiveFramesOffset;
+	if (withReceiveFrames)
+		size += (size_t)fReceiveSize * fFrameSize;
+	size = ROUNDUP(size, B_PAGE_SIZE);
+	if (size > kMaxRingAreaSize)
+		return B_NO_MEMORY;
+
+	// the ring is accessed from the receive path, it must never fault
+	uint8* base;
+	fArea = create_area("packet ring", (void**)&base, B_ANY_KERNEL_ADDRESS,
+		size, B_FULL_LOCK, B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA);
+	if (fArea < 0)
+		return fArea;
+
+	memset(base, 0, transmitFramesOffset);
+
+	fHeader = (packet_ring_header*)base;
+	fHeader->version = PACKET_RING_VERSION;
+	fHeader->frame_size = fFrameSize;
+	fHeader->rx_size = fReceiveSize;
+	fHeader->tx_size = fTransmitSize;
+	fHeader->rx_descriptors = receiveDescriptorsOffset;
+	fHeader->tx_descriptors = transmitDescriptorsOffset;
+
+	fReceiveDescriptors
+		= (packet_ring_descriptor*)(base + receiveDescriptorsOffset);
+	fTransmitDescriptors
+		= (packet_ring_descriptor*)(base + transmitDescriptorsOffset);
+	fTransmitFrames = base + transmitFramesOffset;
+	fReceiveFrames = withReceiveFrames ? base + receiveFramesOffset : NULL;
+
+	return B_OK;
+}
+
+
+void
+PacketRing::_DeleteAreas()
+{
+	if (fTeamFrameArea >= 0)
+		vm_delete_area(fTeam, fTeamFrameArea, true);
+	if (fTeamArea >= 0)
+		vm_delete_area(fTeam, fTeamArea, true);
+	if (fArea >= 0)
+		delete_area(fArea);
+
+	fTeamFrameArea = -1;
+	fTeamArea = -1;
+	fArea = -1;
+	fHeader = NULL;
+}
+
+
+status_t
+PacketRing::_AttachToDevice()
+{
+	net_device* device = fInterface->device;
+
+	net_device_packet_ring ring;
+	ring.descriptors = fReceiveDescriptors;
+	ring.size = fReceiveSize;
+	ring.index = &fHeader->rx;
+	ring.dropped = &fHeader->dropped;
+	ring.notify = &_DeviceNotify;
+	ring.cookie = this;
+	ring.frame_area = -1;
+
+	status_t status = device->module->attach_packet_ring(device, fQueue,
+		&ring);
+	if (status != B_OK)
+		return status;
+
+	fDeviceFrameArea = ring.frame_area;
+	return B_OK;
+}
+
+
+/*!	Maps the ring into the current team, the receive frames of the device
+	only read-only. Neither mapping can be removed from userland; they go
+	away with the ring.
+*/
+status_t
+PacketRing::_MapIntoTeam(packet_ring_request& request)
+{
+	fTeam = team_get_current_team_id();
+
+	uint8* address = NULL;
+	fTeamArea = vm_clone_area(fTeam, "packet ring", (void**)&address,
+		B_RANDOMIZED_ANY_ADDRESS, B_READ_AREA | B_WRITE_AREA | B_KERNEL_AREA,
+		REGION_NO_PRIVATE_MAP, fArea, true);
+	if (fTeamArea < 0)
+		return fTeamArea;
+
+	uint8* base = (uint8*)fHeader;
+	request.ring = (packet_ring_header*)address;
+	request.tx_frames = address + (fTransmitFrames - base);
+
+	if (fZeroCopy) {
+		void* frames = NULL;
+		fTeamFrameArea = vm_clone_area(fTeam, "packet ring frames", &frames,
+			B_RANDOMIZED_ANY_ADDRESS, B_READ_AREA | B_KERNEL_AREA,
+			REGION_NO_PRIVATE_MAP, fDeviceFrameArea, true);
+		if (fTeamFrameArea < 0)
+			return fTeamFrameArea;
+
+		request.rx_frames = frames;
+	} else if (fReceiveFrames != NULL)
+		request.rx_frames = address + (fReceiveFrames - base);
+	else
+		request.rx_frames = NULL;
+
+	return B_OK;
+}
+
+
+void
+PacketRing::_Detach()
+{
+	if (fInterface == NULL)
+		return;
+
+	net_device* device = fInterface->device;
+	if (fZeroCopy)
+		device->module->detach_packet_ring(device, fQueue);
+
+	// once this returns, the monitor is not called anymore
+	unregister_device_monitor(device, &fMonitor);
+
+	put_device_interface(fInterface);
+	fInterface = NULL;
+}
+
+
+/*!	Copies the \a buffer into the receive ring, or drops it, if there is no
+	room left.
+*/
+void
+PacketRing::_Receive(net_buffer* buffer)
+{
+	if (fZeroCopy || fReceiveSize == 0)
+		return;
+
+	MutexLocker locker(fLock);
+	if (fDeviceGone)
+		return;
+
+	// the consumer index is written by userland, and cannot be trusted
+	uint32 consumer = fHeader->rx.consumer;
+	if (fReceiveProducer - consumer >= fReceiveSize) {
+		atomic_add((int32*)&fHeader->dropped, 1);
+		return;
+	}
+
+	uint32 index = fReceiveProducer & (fReceiveSize - 1);
+	uint32 offset = index * fFrameSize;
+	size_t length = min_c(buffer->size, fFrameSize);
+	if (gNetBufferModule.read(buffer, 0, fReceiveFrames + offset, length)
+			!= B_OK) {
+		atomic_add((int32*)&fHeader->dropped, 1);
+		return;
+	}
+
+	packet_ring_descriptor& descriptor = fReceiveDescriptors[index];
+	descriptor.offset = offset;
+	descriptor.length = length;
+	descriptor.flags = 0;
+	if (length < buffer->size)
+		descriptor.flags |= PACKET_RING_TRUNCATED;
+	if ((buffer->offload_flags & NET_BUFFER_CHECKSUM_VALID) != 0)
+		descriptor.flags |= PACKET_RING_CHECKSUM_VALID;
+
+	// the frame needs to be visible before the index that covers it
+	memory_write_barrier();
+	fHeader->rx.producer = ++fReceiveProducer;
+
+	bool wasEmpty = fReceiveProducer - consumer == 1;
+	locker.Unlock();
+
+	if (wasEmpty)
+		_NotifyReadable();
+}
+
+
+status_t
+PacketRing::_SendFrame(net_device* device,
+	const packet_ring_descriptor& descriptor)
+{
+	size_t framesSize = (size_t)fTransmitSize * fFrameSize;
+	if (descriptor.length < device->header_length
+		|| descriptor.length > fFrameSize
+		|| descriptor.offset > framesSize - descriptor.length) {
+		atomic_add((int32*)&device->stats.send.errors, 1);
+		return B_BAD_VALUE;
+	}
+
+	net_buffer* buffer = gNetBufferModule.create(0);
+	if (buffer == NULL)
+		return ENOBUFS;
+
+	status_t status = gNetBufferModule.append(buffer,
+		fTransmitFrames + descriptor.offset, descriptor.length);
+	if (status == B_OK) {
+		if (device->transmit_queue_count > 1
+			&& device->module->send_queue_data != NULL) {
+			status = device->module->send_queue_data(device,
+				fQueue % device->transmit_queue_count, buffer);
+		} else
+			status = device->module->send_data(device, buffer);
+	}
+
+	if (status != B_OK) {
+		// the buffer is still ours
+		gNetBufferModule.free(buffer);
+		atomic_add((int32*)&device->stats.send.errors, 1);
+		return status;
+	}
+
+	atomic_add((int32*)&device->stats.send.packets, 1);
+	atomic_add64((int64*)&device->stats.send.bytes, descriptor.length);
+	return B_OK;
+}
+
+
+void
+PacketRing::_NotifyReadable()
+{
+	ssize_t available = Available();
+	if (available != 0)
+		notify_socket(fSocket, B_SELECT_READ, available);
+}
+
+
+/*static*/ status_t
+PacketRing::_MonitorData(net_device_monitor* monitor, net_buffer* buffer)
+{
+	((PacketRing*)monitor->cookie)->_Receive(buffer);
+	return B_OK;
+}
+
+
+/*static*/ void
+PacketRing::_MonitorEvent(net_device_monitor* monitor, int32 event)
+{
+	PacketRing* ring = (PacketRing*)monitor->cookie;
+
+	if (event == B_DEVICE_GOING_DOWN) {
+		// A device going down detaches the ring from the driver already; it
+		// keeps its reference to the device until it is deleted, though,
+		// as it cannot remove itself from here without racing with that.
+		MutexLocker locker(ring->fLock);
+		ring->fDeviceGone = true;
+		locker.Unlock();
+
+		notify_socket(ring->fSocket, B_SELECT_READ, B_DEVICE_NOT_FOUND);
+	}
+}
+
+
+/*static*/ void
+PacketRing::_DeviceNotify(void* cookie)
+{
+	((PacketRing*)cookie)->_NotifyReadable();
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef PACKET_RINGS_H
+#define PACKET_RINGS_H
+
+
+#include <net_device.h>
+#include <net_socket.h>
+#include <net_stack.h>
+#include <packet_ring.h>
+
+#include <lock.h>
+
+
+struct net_device_interface;
+
+
+class PacketRing {
+public:
+								PacketRing(net_socket* socket);
+								~PacketRing();
+
+			status_t			Init(net_device_interface* interface,
+									packet_ring_request& request);
+
+			ssize_t				Available();
+			status_t			Send();
+
+private:
+			status_t			_CreateArea(bool withReceiveFrames);
+			void				_DeleteAreas();
+			status_t			_AttachToDevice();
+			status_t			_MapIntoTeam(packet_ring_request& request);
+			void				_Detach();
+
+			void				_Receive(net_buffer* buffer);
+			status_t			_SendFrame(net_device* device,
+									const packet_ring_descriptor& descriptor);
+			void				_NotifyReadable();
+
+	static	status_t			_MonitorData(net_device_monitor* monitor,
+									net_buffer* buffer);
+	static	void				_MonitorEvent(net_device_monitor* monitor,
+									int32 event);
+	static	void				_DeviceNotify(void* cookie);
+
+private:
+			net_socket*			fSocket;
+			mutex				fLock;
+			net_device_interface* fInterface;
+			net_device_monitor	fMonitor;
+			uint32				fQueue;
+			bool				fZeroCopy;
+			bool				fDeviceGone;
+
+			uint32				fFrameSize;
+			uint32				fReceiveSize;
+			uint32				fTransmitSize;
+
+			area_id				fArea;
+			packet_ring_header*	fHeader;
+			packet_ring_descriptor* fReceiveDescriptors;
+			packet_ring_descriptor* fTransmitDescriptors;
+			uint8*				fTransmitFrames;
+			uint8*				fReceiveFrames;
+			area_id				fDeviceFrameArea;
+				// holds the received frames in zero copy mode
+
+			team_id				fTeam;
+			area_id				fTeamArea;
+			area_id				fTeamFrameArea;
+				// the mappings of the ring, and the device frames in the
+				// team that set it up
+
+			uint32				fReceiveProducer;
+			uint32				fTransmitConsumer;
+				// the kernel's own copies, as userland can write the ring
+};
+
+
+#endif	// PACKET_RINGS_H
@@ -187,11 +187,14 @@ find_route(net_domain* _domain, const sockaddr* address)
 }
 
 
+/*!	Releases a reference to \a _route. This does not need the domain lock:
+	the route list holds a reference of its own, so a route can only lose
+	its last one after it has been removed from the list, and is then no
+	longer reachable for anyone else.
+*/
 static void
 put_route_internal(struct net_domain_private* domain, net_route* _route)
 {
-	ASSERT_LOCKED_RECURSIVE(&domain->lock);
-
 	net_route_private* route = (net_route_private*)_route;
 	if (route == NULL || atomic_add(&route->ref_count, -1) != 1)
 		return;
@@ -208,7 +211,6 @@ static struct net_route*
 get_route_internal(struct net_domain_private* domain,
 	const struct sockaddr* address)
 {
-	ASSERT_LOCKED_RECURSIVE(&domain->lock);
 	net_route_private* route = NULL;
 
 	if (address->sa_family == AF_LINK) {
@@ -244,7 +246,7 @@ get_route_internal(struct net_domain_private* domain,
 static void
 update_route_infos(struct net_domain_private* domain)
 {
-	ASSERT_LOCKED_RECURSIVE(&domain->lock);
+	ASSERT_WRITE_LOCKED_RW_LOCK(&domain->lock);
 	RouteInfoList::Iterator iterator = domain->route_infos.GetIterator();
 
 	while (iterator.HasNext()) {
@@ -293,7 +295,7 @@ fill_route_entry(route_entry* target, void* _buffer, size_t bufferSize,
 uint32
 route_table_size(net_domain_private* domain)
 {
-	RecursiveLocker locker(domain->lock);
+	ReadLocker locker(domain->lock);
 	uint32 size = 0;
 
 	RouteList::Iterator iterator = domain->routes.GetIterator();
@@ -320,7 +322,7 @@ route_table_size(net_domain_private* domain)
 status_t
 list_routes(net_domain_private* domain, void* buffer, size_t size)
 {
-	RecursiveLocker _(domain->lock);
+	ReadLocker _(domain->lock);
 
 	RouteList::Iterator iterator = domain->routes.GetIterator();
 	const size_t kBaseSize = IF_NAMESIZE + sizeof(route_entry);
@@ -464,7 +466,7 @@ add_route(struct net_domain* _domain, const struct net_route* newRoute)
 		|| !domain->address_module->check_mask(newRoute->mask))
 		return B_BAD_VALUE;
 
-	RecursiveLocker _(domain->lock);
+	WriteLocker _(domain->lock);
 
 	net_route_private* route = find_route(domain, newRoute);
 	if (route != NULL)
@@ -514,6 +516,7 @@ add_route(struct net_domain* _domain, const struct net_route* newRoute)
 	}
 
 	domain->routes.InsertBefore(before, route);
+	atomic_add(&domain->route_generation, 1);
 	update_route_infos(domain);
 
 	return B_OK;
@@ -535,13 +538,14 @@ remove_route(struct net_domain* _domain, const struct net_route* removeRoute)
 			? removeRoute->gateway : NULL).Data(),
 		removeRoute->flags);
 
-	RecursiveLocker locker(domain->lock);
+	WriteLocker locker(domain->lock);
 
 	net_route_private* route = find_route(domain, removeRoute);
 	if (route == NULL)
 		return B_ENTRY_NOT_FOUND;
 
 	domain->routes.Remove(route);
+	atomic_add(&domain->route_generation, 1);
 
 	put_route_internal(domain, route);
 	update_route_infos(domain);
@@ -567,7 +571,7 @@ get_route_information(struct net_domain* _domain, void* value, size_t length)
 	if (status != B_OK)
 		return status;
 
-	RecursiveLocker locker(domain->lock);
+	ReadLocker locker(domain->lock);
 
 	net_route_private* route = find_route(domain, (sockaddr*)&destination);
 	if (route == NULL)
@@ -585,7 +589,7 @@ void
 invalidate_routes(net_domain* _domain, net_interface* interface)
 {
 	net_domain_private* domain = (net_domain_private*)_domain;
-	RecursiveLocker locker(domain->lock);
+	WriteLocker locker(domain->lock);
 
 	TRACE("invalidate_routes(%i, %s)\n", domain->family, interface->name);
 
@@ -607,7 +611,7 @@ invalidate_routes(InterfaceAddress* address)
 	TRACE("invalidate_routes(%s)\n",
 		AddressString(domain, address->local).Data());
 
-	RecursiveLocker locker(domain->lock);
+	WriteLocker locker(domain->lock);
 
 	RouteList::Iterator iterator = domain->routes.GetIterator();
 	while (iterator.HasNext()) {
@@ -623,7 +627,7 @@ struct net_route*
 get_route(struct net_domain* _domain, const struct sockaddr* address)
 {
 	struct net_domain_private* domain = (net_domain_private*)_domain;
-	RecursiveLocker locker(domain->lock);
+	ReadLocker locker(domain->lock);
 
 	return get_route_internal(domain, address);
 }
@@ -652,7 +656,7 @@ get_buffer_route(net_domain* _domain, net_buffer* buffer, net_route** _route)
 {
 	net_domain_private* domain = (net_domain_private*)_domain;
 
-	RecursiveLocker _(domain->lock);
+	ReadLocker _(domain->lock);
 
 	net_route* route = get_route_internal(domain, buffer->destination);
 	if (route == NULL)
@@ -686,8 +690,6 @@ put_route(struct net_domain* _domain, net_route* route)
 	if (domain == NULL || route == NULL)
 		return;
 
-	RecursiveLocker locker(domain->lock);
-
 	put_route_internal(domain, (net_route*)route);
 }
 
@@ -696,7 +698,7 @@ status_t
 register_route_info(struct net_domain* _domain, struct net_route_info* info)
 {
 	struct net_domain_private* domain = (net_domain_private*)_domain;
-	RecursiveLocker locker(domain->lock);
+	WriteLocker locker(domain->lock);
 
 	domain->route_infos.Add(info);
 	info->route = get_route_internal(domain, &info->address);
@@ -709,7 +711,7 @@ status_t
 unregister_route_info(struct net_domain* _domain, struct net_route_info* info)
 {
 	struct net_domain_private* domain = (net_domain_private*)_domain;
-	RecursiveLocker locker(domain->lock);
+	WriteLocker locker(domain->lock);
 
 	domain->route_infos.Remove(info);
 	if (info->route != NULL)
@@ -723,7 +725,7 @@ status_t
 update_route_info(struct net_domain* _domain, struct net_route_info* info)
 {
 	struct net_domain_private* domain = (net_domain_private*)_domain;
-	RecursiveLocker locker(domain->lock);
+	WriteLocker locker(domain->lock);
 
 	put_route_internal(domain, info->route);
 	info->route = get_route_internal(domain, &info->address);
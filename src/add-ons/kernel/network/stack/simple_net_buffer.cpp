@@ -83,6 +83,11 @@ copy_metadata(net_buffer *destination, const net_buffer *source)
 	destination->size = source->size;
 	destination->protocol = source->protocol;
 	destination->type = source->type;
+
+	destination->checksum_offset = source->checksum_offset;
+	destination->offload_flags = source->offload_flags;
+	destination->transport_size = source->transport_size;
+	destination->segment_size = source->segment_size;
 }
 
 
@@ -111,6 +116,8 @@ create_buffer(size_t headerSpace)
 	buffer->offset = 0;
 	buffer->flags = 0;
 	buffer->size = 0;
+	buffer->offload_flags = 0;
+	buffer->segment_size = 0;
 
 	buffer->type = -1;
 
@@ -427,6 +434,25 @@ append_cloned_data(net_buffer *_buffer, net_buffer *_source, uint32 offset,
 }
 
 
+/*!
+	Appends external data to the buffer. This implementation simply copies
+	it, so that \a release can be called right away.
+*/
+static status_t
+append_external_data(net_buffer *buffer, void *data, size_t bytes,
+	net_buffer_release_func release, void *cookie)
+{
+	if (bytes == 0 || release == NULL)
+		return B_BAD_VALUE;
+
+	status_t status = append_data(buffer, data, bytes);
+	if (status == B_OK)
+		release(cookie);
+
+	return status;
+}
+
+
 /*!
 	Attaches ancillary data to the given buffer. The data are completely
 	orthogonal to the data the buffer stores.
@@ -702,6 +728,7 @@ net_buffer_module_info gSimpleNetBufferModule = {
 	remove_trailer,
 	trim_data,
 	append_cloned_data,
+	append_external_data,
 
 	NULL,	// associate_data
 
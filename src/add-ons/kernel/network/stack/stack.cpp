@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2010, Haiku, Inc. All Rights Reserved.
+ * Copyright 2006-2026, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  *
  * Authors:
@@ -12,6 +12,7 @@
 #include "domains.h"
 #include "interfaces.h"
 #include "link.h"
+#include "packet_filter.h"
 #include "stack_private.h"
 #include "utility.h"
 
@@ -991,7 +992,11 @@ net_stack_module_info gNetStackModule = {
 	add_ancillary_data,
 	remove_ancillary_data,
 	move_ancillary_data,
-	next_ancillary_data
+	next_ancillary_data,
+
+	create_filter,
+	delete_filter,
+	run_filter
 };
 
 module_info* modules[] = {
@@ -41,6 +41,7 @@ command_create(int argc, const char* const* argv)
 	bool verbose = false;
 	int32 compressionLevel = BPackageKit::BHPKG::B_HPKG_COMPRESSION_LEVEL_BEST;
 	int32 compression = parse_compression_argument(NULL);
+	int32 threadCount = 0;
 
 	while (true) {
 		static struct option sLongOptions[] = {
@@ -51,7 +52,7 @@ command_create(int argc, const char* const* argv)
 		};
 
 		opterr = 0; // don't print errors
-		int c = getopt_long(argc, (char**)argv, "+b0123456789C:hi:I:z:qv",
+		int c = getopt_long(argc, (char**)argv, "+b0123456789C:hi:I:j:z:qv",
 			sLongOptions, NULL);
 		if (c == -1)
 			break;
@@ -90,6 +91,10 @@ command_create(int argc, const char* const* argv)
 				installPath = optarg;
 				break;
 
+			case 'j':
+				threadCount = parse_thread_count_argument(optarg);
+				break;
+
 			case 'z':
 				compression = parse_compression_argument(optarg);
 				break;
@@ -136,6 +141,7 @@ command_create(int argc, const char* const* argv)
 	// create package
 	BPackageWriterParameters writerParameters;
 	writerParameters.SetCompressionLevel(compressionLevel);
+	writerParameters.SetThreadCount(threadCount);
 	if (compressionLevel == 0) {
 		writerParameters.SetCompression(
 			BPackageKit::BHPKG::B_HPKG_COMPRESSION_NONE);
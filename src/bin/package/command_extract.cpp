@@ -30,7 +30,9 @@
 #include <package/hpkg/PackageDataReader.h>
 #include <package/hpkg/PackageEntry.h>
 #include <package/hpkg/PackageEntryAttribute.h>
+#include <package/hpkg/PackageFileHeapReader.h>
 #include <package/hpkg/PackageReader.h>
+#include <package/hpkg/ParallelHeapReader.h>
 #include <package/hpkg/StandardErrorOutput.h>
 #include <package/hpkg/v1/PackageContentHandler.h>
 #include <package/hpkg/v1/PackageDataReader.h>
@@ -50,6 +52,8 @@ using BPackageKit::BHPKG::BErrorOutput;
 using BPackageKit::BHPKG::BFDDataReader;
 using BPackageKit::BHPKG::BPackageInfoAttributeValue;
 using BPackageKit::BHPKG::BStandardErrorOutput;
+using BPackageKit::BHPKG::BPrivate::PackageFileHeapReader;
+using BPackageKit::BHPKG::BPrivate::ParallelHeapReader;
 
 
 struct VersionPolicyV1 {
@@ -89,7 +93,7 @@ struct VersionPolicyV1 {
 	}
 
 	static status_t GetHeapReader(PackageReader& packageReader,
-		HeapReaderBase*& _heapReader, bool& _mustDelete)
+		int32 threadCount, HeapReaderBase*& _heapReader, bool& _mustDelete)
 	{
 		_heapReader = new(std::nothrow) BFDDataReader(
 			packageReader.PackageFileFD());
@@ -143,10 +147,30 @@ struct VersionPolicyV2 {
 	}
 
 	static status_t GetHeapReader(PackageReader& packageReader,
-		HeapReaderBase*& _heapReader, bool& _mustDelete)
+		int32 threadCount, HeapReaderBase*& _heapReader, bool& _mustDelete)
 	{
 		_heapReader = packageReader.HeapReader();
 		_mustDelete = false;
+
+		// decompress the chunks ahead of the extraction on other threads
+		PackageFileHeapReader* rawHeapReader
+			= dynamic_cast<PackageFileHeapReader*>(_heapReader);
+		if (threadCount == 1 || rawHeapReader == NULL)
+			return B_OK;
+
+		ParallelHeapReader* parallelReader
+			= new(std::nothrow) ParallelHeapReader(rawHeapReader);
+		if (parallelReader == NULL)
+			return B_NO_MEMORY;
+
+		status_t error = parallelReader->Init(threadCount);
+		if (error != B_OK) {
+			delete parallelReader;
+			return error;
+		}
+
+		_heapReader = parallelReader;
+		_mustDelete = true;
 		return B_OK;
 	}
 
@@ -766,7 +790,7 @@ template<typename VersionPolicy>
 static void
 do_extract(const char* packageFileName, const char* changeToDirectory,
 	const char* packageInfoFileName, const char* const* explicitEntries,
-	int explicitEntryCount, bool ignoreVersionError)
+	int explicitEntryCount, int32 threadCount, bool ignoreVersionError)
 {
 	// open package
 	BStandardErrorOutput errorOutput;
@@ -786,8 +810,8 @@ do_extract(const char* packageFileName, const char* changeToDirectory,
 
 	typename VersionPolicy::HeapReaderBase* heapReader;
 	bool mustDeleteHeapReader;
-	error = VersionPolicy::GetHeapReader(packageReader, heapReader,
-		mustDeleteHeapReader);
+	error = VersionPolicy::GetHeapReader(packageReader, threadCount,
+		heapReader, mustDeleteHeapReader);
 	if (error != B_OK) {
 		fprintf(stderr, "Error: Failed to create heap reader: \"%s\"\n",
 			strerror(error));
@@ -861,6 +885,7 @@ command_extract(int argc, const char* const* argv)
 {
 	const char* changeToDirectory = NULL;
 	const char* packageInfoFileName = NULL;
+	int32 threadCount = 0;
 
 	while (true) {
 		static struct option sLongOptions[] = {
@@ -869,7 +894,7 @@ command_extract(int argc, const char* const* argv)
 		};
 
 		opterr = 0; // don't print errors
-		int c = getopt_long(argc, (char**)argv, "+C:hi:", sLongOptions, NULL);
+		int c = getopt_long(argc, (char**)argv, "+C:hi:j:", sLongOptions, NULL);
 		if (c == -1)
 			break;
 
@@ -886,6 +911,10 @@ command_extract(int argc, const char* const* argv)
 				packageInfoFileName = optarg;
 				break;
 
+			case 'j':
+				threadCount = parse_thread_count_argument(optarg);
+				break;
+
 			default:
 				print_usage_and_exit(true);
 				break;
@@ -901,9 +930,11 @@ command_extract(int argc, const char* const* argv)
 	const char* const* explicitEntries = argv + optind;
 	int explicitEntryCount = argc - optind;
 	do_extract<VersionPolicyV2>(packageFileName, changeToDirectory,
-		packageInfoFileName, explicitEntries, explicitEntryCount, true);
+		packageInfoFileName, explicitEntries, explicitEntryCount, threadCount,
+		true);
 	do_extract<VersionPolicyV1>(packageFileName, changeToDirectory,
-		packageInfoFileName, explicitEntries, explicitEntryCount, false);
+		packageInfoFileName, explicitEntries, explicitEntryCount, threadCount,
+		false);
 
 	return 0;
 }
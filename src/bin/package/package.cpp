@@ -37,6 +37,8 @@ static const char* kUsage =
 	"        -i <info>  - Use the package info file <info>. It will be added as\n"
 	"                     \".PackageInfo\", overriding a \".PackageInfo\" file,\n"
 	"                     existing.\n"
+	"        -j <count> - Use <count> threads for compressing the data. 0, the\n"
+	"                     default, means one per CPU.\n"
 	"        -q         - Be quiet (don't show any output except for errors).\n"
 	"        -v         - Be verbose (show more info about created package).\n"
 	"\n"
@@ -63,7 +65,11 @@ static const char* kUsage =
 	"                     an option only for use in package building. It will cause\n"
 	"                     the package .self link to point to <path>, which is useful\n"
 	"                     to redirect a \"make install\". Only allowed with -b.\n"
-	"        -z <type>  - Specify compression method to use.\n"
+	"        -j <count> - Use <count> threads for compressing the data. 0, the\n"
+	"                     default, means one per CPU.\n"
+	"        -z <type>  - Specify compression method to use: \"zlib\", \"zstd\",\n"
+	"                     or \"zstd-dict\", zstd with a dictionary trained on\n"
+	"                     the package's data.\n"
 	"        -q         - Be quiet (don't show any output except for errors).\n"
 	"        -v         - Be verbose (show more info about created package).\n"
 	"\n"
@@ -77,6 +83,8 @@ static const char* kUsage =
 	"        -C <dir>   - Change to directory <dir> before extracting the contents\n"
 	"                     of the archive.\n"
 	"        -i <info>  - Extract the .PackageInfo file to <info> instead.\n"
+	"        -j <count> - Use <count> threads for decompressing the data. 0, the\n"
+	"                     default, means one per CPU.\n"
 	"\n"
 	"    info [ <options> ] <package>\n"
 	"        Prints individual meta information of package file <package>.\n"
@@ -109,7 +117,11 @@ static const char* kUsage =
 	"\n"
 	"        -0 ... -9  - Use compression level 0 ... 9. 0 means no, 9 best\n"
 	"                     compression. Defaults to 9.\n"
-	"        -z <type>  - Specify compression method to use.\n"
+	"        -j <count> - Use <count> threads for compressing the data. 0, the\n"
+	"                     default, means one per CPU.\n"
+	"        -z <type>  - Specify compression method to use: \"zlib\", \"zstd\",\n"
+	"                     or \"zstd-dict\", zstd with a dictionary trained on\n"
+	"                     the package's data.\n"
 	"        -q         - Be quiet (don't show any output except for errors).\n"
 	"        -v         - Be verbose (show more info about created package).\n"
 	"\n"
@@ -140,6 +152,8 @@ parse_compression_argument(const char* arg)
 
 	if (strcmp(arg, "zstd") == 0) {
 		return BPackageKit::BHPKG::B_HPKG_COMPRESSION_ZSTD;
+	} else if (strcmp(arg, "zstd-dict") == 0) {
+		return BPackageKit::BHPKG::B_HPKG_COMPRESSION_ZSTD_DICTIONARY;
 	} else if (strcmp(arg, "zlib") == 0) {
 		return BPackageKit::BHPKG::B_HPKG_COMPRESSION_ZLIB;
 	} else {
@@ -149,6 +163,20 @@ parse_compression_argument(const char* arg)
 }
 
 
+int32
+parse_thread_count_argument(const char* arg)
+{
+	char* end;
+	long count = strtol(arg, &end, 10);
+	if (*arg == '\0' || *end != '\0' || count < 0 || count > 1024) {
+		fprintf(stderr, "error: invalid thread count '%s'\n", arg);
+		exit(1);
+	}
+
+	return count;
+}
+
+
 int
 main(int argc, const char* const* argv)
 {
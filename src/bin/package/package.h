@@ -10,6 +10,7 @@
 
 void	print_usage_and_exit(bool error);
 int32	parse_compression_argument(const char* arg);
+int32	parse_thread_count_argument(const char* arg);
 
 int		command_add(int argc, const char* const* argv);
 int		command_checksum(int argc, const char* const* argv);
@@ -15,6 +15,7 @@
 #include <Path.h>
 
 #include <package/hpkg/HPKGDefs.h>
+#include <package/hpkg/PackageWriter.h>
 #include <package/hpkg/RepositoryWriter.h>
 #include <package/PackageInfo.h>
 #include <package/RepositoryInfo.h>
@@ -22,6 +23,7 @@
 #include "package_repo.h"
 
 
+using BPackageKit::BHPKG::BPackageWriterParameters;
 using BPackageKit::BHPKG::BRepositoryWriterListener;
 using BPackageKit::BHPKG::BRepositoryWriter;
 using namespace BPackageKit;
@@ -117,6 +119,7 @@ command_create(int argc, const char* const* argv)
 	const char* changeToDirectory = NULL;
 	bool quiet = false;
 	bool verbose = false;
+	BPackageWriterParameters writerParameters;
 
 	while (true) {
 		static struct option sLongOptions[] = {
@@ -127,7 +130,7 @@ command_create(int argc, const char* const* argv)
 		};
 
 		opterr = 0; // don't print errors
-		int c = getopt_long(argc, (char**)argv, "+C:hqv", sLongOptions, NULL);
+		int c = getopt_long(argc, (char**)argv, "+C:hqvz:", sLongOptions, NULL);
 		if (c == -1)
 			break;
 
@@ -148,6 +151,11 @@ command_create(int argc, const char* const* argv)
 				verbose = true;
 				break;
 
+			case 'z':
+				writerParameters.SetCompression(
+					parse_compression_argument(optarg));
+				break;
+
 			default:
 				print_usage_and_exit(true);
 				break;
@@ -193,7 +201,8 @@ command_create(int argc, const char* const* argv)
 		return 1;
 	}
 	BRepositoryWriter repositoryWriter(&listener, &repositoryInfo);
-	if ((result = repositoryWriter.Init(repositoryPath.Path())) != B_OK) {
+	if ((result = repositoryWriter.Init(repositoryPath.Path(),
+			&writerParameters)) != B_OK) {
 		listener.PrintError("Error: can't initialize repository-writer : %s\n",
 			strerror(result));
 		return 1;
@@ -20,6 +20,7 @@
 
 #include <package/hpkg/HPKGDefs.h>
 #include <package/hpkg/PackageInfoAttributeValue.h>
+#include <package/hpkg/PackageWriter.h>
 #include <package/hpkg/RepositoryContentHandler.h>
 #include <package/hpkg/RepositoryReader.h>
 #include <package/hpkg/RepositoryWriter.h>
@@ -212,6 +213,7 @@ command_update(int argc, const char* const* argv)
 	const char* changeToDirectory = NULL;
 	bool quiet = false;
 	bool verbose = false;
+	BPackageWriterParameters writerParameters;
 
 	while (true) {
 		static struct option sLongOptions[] = {
@@ -222,7 +224,7 @@ command_update(int argc, const char* const* argv)
 		};
 
 		opterr = 0; // don't print errors
-		int c = getopt_long(argc, (char**)argv, "+C:hqv", sLongOptions, NULL);
+		int c = getopt_long(argc, (char**)argv, "+C:hqvz:", sLongOptions, NULL);
 		if (c == -1)
 			break;
 
@@ -243,6 +245,11 @@ command_update(int argc, const char* const* argv)
 				verbose = true;
 				break;
 
+			case 'z':
+				writerParameters.SetCompression(
+					parse_compression_argument(optarg));
+				break;
+
 			default:
 				print_usage_and_exit(true);
 				break;
@@ -306,8 +313,8 @@ command_update(int argc, const char* const* argv)
 	BRepositoryWriter repositoryWriter(&listener, &repositoryInfo);
 	BString tempRepositoryFileName(targetRepositoryFileName);
 	tempRepositoryFileName += ".___new___";
-	if ((result = repositoryWriter.Init(tempRepositoryFileName.String()))
-			!= B_OK) {
+	if ((result = repositoryWriter.Init(tempRepositoryFileName.String(),
+			&writerParameters)) != B_OK) {
 		listener.PrintError("Error: can't initialize repository-writer : %s\n",
 			strerror(result));
 		return 1;
@@ -12,6 +12,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <package/hpkg/HPKGDefs.h>
+
 extern const char* __progname;
 const char* kCommandName = __progname;
 
@@ -28,6 +30,9 @@ static const char* kUsage =
 	"    -C <dir>   - Change to directory <dir> before starting.\n"
 	"    -q         - be quiet (don't show any output except for errors).\n"
 	"    -v         - be verbose (list package attributes as encountered).\n"
+	"    -z <type>  - Specify compression method to use: \"zlib\" (default),\n"
+	"                 \"zstd\", or \"zstd-dict\", zstd with a dictionary\n"
+	"                 trained on the repository's data.\n"
 	"\n"
 	"  list [ <options> ] <package-repo>\n"
 	"    Lists the contents of package repository file <package-repo>.\n"
@@ -44,6 +49,9 @@ static const char* kUsage =
 	"    -C <dir>   - Change to directory <dir> before starting.\n"
 	"    -q         - be quiet (don't show any output except for errors).\n"
 	"    -v         - be verbose (list package attributes as encountered).\n"
+	"    -z <type>  - Specify compression method to use: \"zlib\" (default),\n"
+	"                 \"zstd\", or \"zstd-dict\", zstd with a dictionary\n"
+	"                 trained on the repository's data.\n"
 	"\n"
 	"Common Options:\n"
 	"  -h, --help   - Print this usage info.\n"
@@ -58,6 +66,21 @@ print_usage_and_exit(bool error)
 }
 
 
+uint32
+parse_compression_argument(const char* arg)
+{
+	if (strcmp(arg, "zlib") == 0)
+		return BPackageKit::BHPKG::B_HPKG_COMPRESSION_ZLIB;
+	if (strcmp(arg, "zstd") == 0)
+		return BPackageKit::BHPKG::B_HPKG_COMPRESSION_ZSTD;
+	if (strcmp(arg, "zstd-dict") == 0)
+		return BPackageKit::BHPKG::B_HPKG_COMPRESSION_ZSTD_DICTIONARY;
+
+	fprintf(stderr, "error: unknown compression method '%s'\n", arg);
+	exit(1);
+}
+
+
 int
 main(int argc, const char* const* argv)
 {
@@ -6,7 +6,11 @@
 #define PACKAGE_REPO_H
 
 
+#include <SupportDefs.h>
+
+
 void	print_usage_and_exit(bool error);
+uint32	parse_compression_argument(const char* arg);
 
 int		command_create(int argc, const char* const* argv);
 int		command_list(int argc, const char* const* argv);
@@ -8,6 +8,8 @@
 
 #include <algorithm>
 #include <new>
+#include <pthread.h>
+#include <unistd.h>
 
 #include <ByteOrder.h>
 #include <List.h>
@@ -19,11 +21,15 @@
 #include <package/hpkg/PackageFileHeapReader.h>
 #include <RangeArray.h>
 #include <CompressionAlgorithm.h>
+#include <ZstdCompressionAlgorithm.h>
 
 
 // minimum length of data we require before trying to compress them
 static const size_t kCompressionSizeThreshold = 64;
 
+// maximum number of compression threads
+static const int32 kMaxThreadCount = 64;
+
 
 namespace BPackageKit {
 
@@ -194,6 +200,212 @@ private:
 };
 
 
+struct PackageFileHeapWriter::CompressionJob {
+	void*		data;
+	void*		compressedData;
+	size_t		size;
+	size_t		compressedSize;
+	status_t	error;
+	bool		done;
+};
+
+
+/*!	Compresses full chunks on a number of worker threads. The jobs form a ring
+	buffer; they are submitted, compressed, and written in the same order, but
+	compression of later chunks can finish before that of earlier ones.
+	Writing is left to the writer's thread.
+*/
+struct PackageFileHeapWriter::CompressionPipeline {
+	CompressionPipeline(PackageFileHeapWriter* writer)
+		:
+		fWriter(writer),
+		fThreads(NULL),
+		fThreadCount(0),
+		fJobs(NULL),
+		fJobCount(0),
+		fWriteSequence(0),
+		fSubmitSequence(0),
+		fCompressSequence(0),
+		fQuitting(false)
+	{
+		pthread_mutex_init(&fLock, NULL);
+		pthread_cond_init(&fWorkCondition, NULL);
+		pthread_cond_init(&fDoneCondition, NULL);
+	}
+
+	~CompressionPipeline()
+	{
+		pthread_mutex_lock(&fLock);
+		fQuitting = true;
+		pthread_cond_broadcast(&fWorkCondition);
+		pthread_mutex_unlock(&fLock);
+
+		for (int32 i = 0; i < fThreadCount; i++)
+			pthread_join(fThreads[i], NULL);
+		delete[] fThreads;
+
+		for (int32 i = 0; i < fJobCount; i++) {
+			free(fJobs[i].data);
+			free(fJobs[i].compressedData);
+		}
+		delete[] fJobs;
+
+		pthread_cond_destroy(&fDoneCondition);
+		pthread_cond_destroy(&fWorkCondition);
+		pthread_mutex_destroy(&fLock);
+	}
+
+	bool Init(int32 threadCount)
+	{
+		// two jobs per thread, so that the threads don't run dry while the
+		// writer is busy
+		fJobCount = 2 * threadCount;
+		fJobs = new(std::nothrow) CompressionJob[fJobCount];
+		fThreads = new(std::nothrow) pthread_t[threadCount];
+		if (fJobs == NULL || fThreads == NULL) {
+			fJobCount = 0;
+			return false;
+		}
+
+		for (int32 i = 0; i < fJobCount; i++) {
+			fJobs[i].data = malloc(kChunkSize);
+			fJobs[i].compressedData = malloc(kChunkSize);
+			if (fJobs[i].data == NULL || fJobs[i].compressedData == NULL)
+				return false;
+		}
+
+		for (; fThreadCount < threadCount; fThreadCount++) {
+			if (pthread_create(&fThreads[fThreadCount], NULL, &_Worker, this)
+					!= 0) {
+				break;
+			}
+		}
+
+		return fThreadCount > 0;
+	}
+
+	bool IsEmpty() const
+	{
+		return fWriteSequence == fSubmitSequence;
+	}
+
+	//! Returns a job to fill in, or \c NULL, if all of them are in use.
+	CompressionJob* ReserveJob()
+	{
+		if (fSubmitSequence - fWriteSequence == (uint64)fJobCount)
+			return NULL;
+		return &fJobs[fSubmitSequence % fJobCount];
+	}
+
+	void Submit()
+	{
+		pthread_mutex_lock(&fLock);
+		CompressionJob& job = fJobs[fSubmitSequence % fJobCount];
+		job.done = false;
+		fSubmitSequence++;
+		pthread_cond_signal(&fWorkCondition);
+		pthread_mutex_unlock(&fLock);
+	}
+
+	/*!	Returns the oldest job, if it has been compressed. If \a wait is
+		\c true, waits for it. Returns \c NULL, if there is no such job.
+	*/
+	CompressionJob* FinishedJob(bool wait)
+	{
+		if (IsEmpty())
+			return NULL;
+
+		CompressionJob* job = &fJobs[fWriteSequence % fJobCount];
+
+		pthread_mutex_lock(&fLock);
+		while (wait && !job->done)
+			pthread_cond_wait(&fDoneCondition, &fLock);
+		bool done = job->done;
+		pthread_mutex_unlock(&fLock);
+
+		return done ? job : NULL;
+	}
+
+	void JobWritten()
+	{
+		fWriteSequence++;
+	}
+
+private:
+	static void* _Worker(void* data)
+	{
+		((CompressionPipeline*)data)->_Work();
+		return NULL;
+	}
+
+	void _Work()
+	{
+		pthread_mutex_lock(&fLock);
+
+		while (true) {
+			while (!fQuitting && fCompressSequence == fSubmitSequence)
+				pthread_cond_wait(&fWorkCondition, &fLock);
+			if (fQuitting)
+				break;
+
+			CompressionJob& job = fJobs[fCompressSequence++ % fJobCount];
+			pthread_mutex_unlock(&fLock);
+
+			job.error = fWriter->_CompressChunkData(job.data, job.size,
+				job.compressedData, job.compressedSize);
+
+			pthread_mutex_lock(&fLock);
+			job.done = true;
+			pthread_cond_broadcast(&fDoneCondition);
+		}
+
+		pthread_mutex_unlock(&fLock);
+	}
+
+private:
+	PackageFileHeapWriter*	fWriter;
+	pthread_mutex_t			fLock;
+	pthread_cond_t			fWorkCondition;
+	pthread_cond_t			fDoneCondition;
+	pthread_t*				fThreads;
+	int32					fThreadCount;
+	CompressionJob*			fJobs;
+	int32					fJobCount;
+	uint64					fWriteSequence;
+	uint64					fSubmitSequence;
+	uint64					fCompressSequence;
+	bool					fQuitting;
+};
+
+
+/*!	Writes everything still in the pipeline and disables it while in scope,
+	for operations that need the heap file to be up to date while writing.
+*/
+struct PackageFileHeapWriter::PipelineSuspender {
+	PipelineSuspender(PackageFileHeapWriter* writer)
+		:
+		fWriter(writer),
+		fPipeline(NULL)
+	{
+		status_t error = fWriter->_FlushPipeline();
+		if (error != B_OK)
+			throw status_t(error);
+
+		fPipeline = fWriter->fPipeline;
+		fWriter->fPipeline = NULL;
+	}
+
+	~PipelineSuspender()
+	{
+		fWriter->fPipeline = fPipeline;
+	}
+
+private:
+	PackageFileHeapWriter*	fWriter;
+	CompressionPipeline*	fPipeline;
+};
+
+
 PackageFileHeapWriter::PackageFileHeapWriter(BErrorOutput* errorOutput,
 	BPositionIO* file, off_t heapOffset,
 	CompressionAlgorithmOwner* compressionAlgorithm,
@@ -205,7 +417,10 @@ PackageFileHeapWriter::PackageFileHeapWriter(BErrorOutput* errorOutput,
 	fCompressedDataBuffer(NULL),
 	fPendingDataSize(0),
 	fOffsets(),
-	fCompressionAlgorithm(compressionAlgorithm)
+	fCompressionAlgorithm(compressionAlgorithm),
+	fPipeline(NULL),
+	fUseDictionary(false),
+	fDeferCompression(false)
 {
 	if (fCompressionAlgorithm != NULL)
 		fCompressionAlgorithm->AcquireReference();
@@ -221,14 +436,39 @@ PackageFileHeapWriter::~PackageFileHeapWriter()
 }
 
 
+/*!	\param threadCount The number of threads compressing chunks in parallel.
+		If \c 0, one per CPU is used.
+	\param useDictionary Whether to compress the chunks using a dictionary
+		trained on the heap's data (B_HPKG_COMPRESSION_ZSTD_DICTIONARY).
+		Since the data have to be known for that, the chunks are written
+		uncompressed first and compressed in place in Finish().
+*/
 void
-PackageFileHeapWriter::Init()
+PackageFileHeapWriter::Init(int32 threadCount, bool useDictionary)
 {
 	// allocate data buffers
 	fPendingDataBuffer = malloc(kChunkSize);
 	fCompressedDataBuffer = malloc(kChunkSize);
 	if (fPendingDataBuffer == NULL || fCompressedDataBuffer == NULL)
 		throw std::bad_alloc();
+
+	fUseDictionary = useDictionary && fCompressionAlgorithm != NULL;
+	fDeferCompression = fUseDictionary;
+
+	if (threadCount <= 0)
+		threadCount = sysconf(_SC_NPROCESSORS_ONLN);
+	threadCount = std::min(threadCount, kMaxThreadCount);
+
+	// Without compression, there's nothing to do in parallel. If we can't get
+	// the threads, we'll just compress in this one.
+	if (fCompressionAlgorithm == NULL || threadCount <= 1)
+		return;
+
+	fPipeline = new(std::nothrow) CompressionPipeline(this);
+	if (fPipeline != NULL && !fPipeline->Init(threadCount)) {
+		delete fPipeline;
+		fPipeline = NULL;
+	}
 }
 
 
@@ -250,6 +490,40 @@ PackageFileHeapWriter::Reinit(PackageFileHeapReader* heapReader)
 			fOffsets[i] = heapReader->Offsets()[i];
 	}
 
+	// The chunks are already compressed with the package's dictionary, so we
+	// keep using that one for the new chunks.
+	if (fUseDictionary) {
+		fDeferCompression = false;
+
+		BZstdDecompressionParameters* readerParameters
+			= heapReader->DecompressionAlgorithm() != NULL
+				? dynamic_cast<BZstdDecompressionParameters*>(
+					heapReader->DecompressionAlgorithm()->parameters)
+				: NULL;
+		BZstdCompressionParameters* compressionParameters
+			= dynamic_cast<BZstdCompressionParameters*>(
+				fCompressionAlgorithm->parameters);
+		BZstdDecompressionParameters* decompressionParameters
+			= fDecompressionAlgorithm != NULL
+				? dynamic_cast<BZstdDecompressionParameters*>(
+					fDecompressionAlgorithm->parameters)
+				: NULL;
+		if (readerParameters == NULL || compressionParameters == NULL
+			|| decompressionParameters == NULL) {
+			throw status_t(B_BAD_VALUE);
+		}
+
+		status_t error = compressionParameters->SetDictionary(
+			readerParameters->Dictionary(), readerParameters->DictionarySize());
+		if (error == B_OK) {
+			error = decompressionParameters->SetDictionary(
+				readerParameters->Dictionary(),
+				readerParameters->DictionarySize());
+		}
+		if (error != B_OK)
+			throw status_t(error);
+	}
+
 	_UnwriteLastPartialChunk();
 }
 
@@ -321,6 +595,9 @@ PackageFileHeapWriter::RemoveDataRanges(
 	if (status != B_OK)
 		throw status_t(status);
 
+	// The algorithm below relies on the data being written right away.
+	PipelineSuspender pipelineSuspender(this);
+
 	// We potentially have to recompress all data from the first affected chunk
 	// to the end (minus the removed ranges, of course). As a basic algorithm we
 	// can use our usual data writing strategy, i.e. read a chunk, decompress it
@@ -440,6 +717,10 @@ PackageFileHeapWriter::Finish()
 {
 	// flush pending data, if any
 	status_t error = _FlushPendingData();
+	if (error == B_OK && fDeferCompression)
+		error = _CompressDeferredChunks();
+	if (error == B_OK)
+		error = _FlushPipeline();
 	if (error != B_OK)
 		return error;
 
@@ -453,7 +734,7 @@ PackageFileHeapWriter::Finish()
 	// total size minus the sum of all other chunk sizes.
 	ssize_t offsetCount = fOffsets.Count();
 	if (offsetCount < 2)
-		return B_OK;
+		return fUseDictionary ? _WriteDictionary() : B_OK;
 
 	// Convert the offsets to 16 bit sizes and write them. We use the (no longer
 	// used) pending data buffer for the conversion.
@@ -473,7 +754,7 @@ PackageFileHeapWriter::Finish()
 			return error;
 	}
 
-	return B_OK;
+	return fUseDictionary ? _WriteDictionary() : B_OK;
 }
 
 
@@ -481,6 +762,10 @@ status_t
 PackageFileHeapWriter::ReadAndDecompressChunk(size_t chunkIndex,
 	void* compressedDataBuffer, void* uncompressedDataBuffer)
 {
+	status_t error = _FlushPipeline();
+	if (error != B_OK)
+		return error;
+
 	if (uint64(chunkIndex + 1) * kChunkSize > fUncompressedHeapSize) {
 		// The chunk has not been written to disk yet. Its data are still in the
 		// pending data buffer.
@@ -503,6 +788,9 @@ PackageFileHeapWriter::ReadAndDecompressChunk(size_t chunkIndex,
 void
 PackageFileHeapWriter::_Uninit()
 {
+	delete fPipeline;
+	fPipeline = NULL;
+
 	free(fPendingDataBuffer);
 	free(fCompressedDataBuffer);
 	fPendingDataBuffer = NULL;
@@ -516,7 +804,18 @@ PackageFileHeapWriter::_FlushPendingData()
 	if (fPendingDataSize == 0)
 		return B_OK;
 
-	status_t error = _WriteChunk(fPendingDataBuffer, fPendingDataSize, true);
+	// Full chunks are compressed in parallel. A partial one can only be the
+	// last one, for the time being, so the chunks before it are written first.
+	if (fPipeline != NULL && !fDeferCompression
+		&& fPendingDataSize == kChunkSize) {
+		return _QueuePendingData();
+	}
+
+	status_t error = _FlushPipeline();
+	if (error != B_OK)
+		return error;
+
+	error = _WriteChunk(fPendingDataBuffer, fPendingDataSize, true);
 	if (error == B_OK)
 		fPendingDataSize = 0;
 
@@ -524,61 +823,139 @@ PackageFileHeapWriter::_FlushPendingData()
 }
 
 
+status_t
+PackageFileHeapWriter::_QueuePendingData()
+{
+	CompressionJob* job;
+	while ((job = fPipeline->ReserveJob()) == NULL) {
+		bool written;
+		status_t error = _WriteNextQueuedChunk(true, written);
+		if (error != B_OK)
+			return error;
+	}
+
+	// hand the pending data buffer over to the job, instead of copying it
+	std::swap(job->data, fPendingDataBuffer);
+	job->size = fPendingDataSize;
+	fPipeline->Submit();
+	fPendingDataSize = 0;
+
+	// write what has been compressed in the mean time
+	bool written;
+	do {
+		status_t error = _WriteNextQueuedChunk(false, written);
+		if (error != B_OK)
+			return error;
+	} while (written);
+
+	return B_OK;
+}
+
+
+status_t
+PackageFileHeapWriter::_WriteNextQueuedChunk(bool wait, bool& _written)
+{
+	_written = false;
+
+	CompressionJob* job = fPipeline->FinishedJob(wait);
+	if (job == NULL)
+		return B_OK;
+
+	status_t error = _WriteChunkData(job->data, job->size, job->compressedData,
+		job->compressedSize, job->error);
+	fPipeline->JobWritten();
+	if (error != B_OK)
+		return error;
+
+	_written = true;
+	return B_OK;
+}
+
+
+status_t
+PackageFileHeapWriter::_FlushPipeline()
+{
+	if (fPipeline == NULL)
+		return B_OK;
+
+	while (!fPipeline->IsEmpty()) {
+		bool written;
+		status_t error = _WriteNextQueuedChunk(true, written);
+		if (error != B_OK)
+			return error;
+	}
+
+	return B_OK;
+}
+
+
 status_t
 PackageFileHeapWriter::_WriteChunk(const void* data, size_t size,
 	bool mayCompress)
 {
+	size_t compressedSize = 0;
+	status_t error = mayCompress
+		? _CompressChunkData(data, size, fCompressedDataBuffer, compressedSize)
+		: B_BUFFER_OVERFLOW;
+
+	return _WriteChunkData(data, size, fCompressedDataBuffer, compressedSize,
+		error);
+}
+
+
+/*!	Writes a chunk. If \a compressionError is \c B_OK, the compressed data
+	are written, if it is \c B_BUFFER_OVERFLOW, the uncompressed data.
+*/
+status_t
+PackageFileHeapWriter::_WriteChunkData(const void* data, size_t size,
+	const void* compressedData, size_t compressedSize,
+	status_t compressionError)
+{
+	if (compressionError != B_OK && compressionError != B_BUFFER_OVERFLOW) {
+		fErrorOutput->PrintError("Failed to compress chunk data: %s\n",
+			strerror(compressionError));
+		return compressionError;
+	}
+
 	// add offset
 	if (!fOffsets.Add(fCompressedHeapSize)) {
 		fErrorOutput->PrintError("Out of memory!\n");
 		return B_NO_MEMORY;
 	}
 
-	// Try to use compression only for data large enough.
-	bool compress = mayCompress && size >= (off_t)kCompressionSizeThreshold;
-	if (compress) {
-		status_t error = _WriteDataCompressed(data, size);
-		if (error != B_OK) {
-			if (error != B_BUFFER_OVERFLOW)
-				return error;
-			compress = false;
-		}
-	}
+	if (compressionError == B_OK)
+		return _WriteDataUncompressed(compressedData, compressedSize);
 
-	// Write uncompressed, if necessary.
-	if (!compress) {
-		status_t error = _WriteDataUncompressed(data, size);
-		if (error != B_OK)
-			return error;
-	}
-
-	return B_OK;
+	return _WriteDataUncompressed(data, size);
 }
 
 
+/*!	Compresses a chunk's data. Returns \c B_BUFFER_OVERFLOW, if the data
+	shall be stored uncompressed. Called by the compression threads, too.
+*/
 status_t
-PackageFileHeapWriter::_WriteDataCompressed(const void* data, size_t size)
+PackageFileHeapWriter::_CompressChunkData(const void* data, size_t size,
+	void* compressedData, size_t& _compressedSize) const
 {
-	if (fCompressionAlgorithm == NULL)
+	// Try to use compression only for data large enough.
+	if (fCompressionAlgorithm == NULL || fDeferCompression
+		|| size < kCompressionSizeThreshold) {
 		return B_BUFFER_OVERFLOW;
+	}
 
 	size_t compressedSize;
 	status_t error = fCompressionAlgorithm->algorithm->CompressBuffer(data,
-		size, fCompressedDataBuffer, size, compressedSize,
+		size, compressedData, size, compressedSize,
 		fCompressionAlgorithm->parameters);
-	if (error != B_OK) {
-		if (error != B_BUFFER_OVERFLOW) {
-			fErrorOutput->PrintError("Failed to compress chunk data: %s\n",
-				strerror(error));
-		}
+	if (error != B_OK)
 		return error;
-	}
 
 	// only use compressed data when we've actually saved space
 	if (compressedSize == size)
 		return B_BUFFER_OVERFLOW;
 
-	return _WriteDataUncompressed(fCompressedDataBuffer, compressedSize);
+	_compressedSize = compressedSize;
+	return B_OK;
 }
 
 
@@ -598,6 +975,124 @@ PackageFileHeapWriter::_WriteDataUncompressed(const void* data, size_t size)
 }
 
 
+/*!	Trains the dictionary on the chunks written uncompressed so far and
+	compresses them with it. The compressed chunks are written in place: a
+	chunk never grows, so it never overwrites data that haven't been read yet.
+*/
+status_t
+PackageFileHeapWriter::_CompressDeferredChunks()
+{
+	status_t error = _TrainDictionary();
+	if (error != B_OK)
+		return error;
+
+	fDeferCompression = false;
+
+	size_t chunkCount = fOffsets.Count();
+	fOffsets.Clear();
+	fCompressedHeapSize = 0;
+
+	for (size_t i = 0; i < chunkCount; i++) {
+		uint64 offset = (uint64)i * kChunkSize;
+		size_t size = std::min(fUncompressedHeapSize - offset,
+			(uint64)kChunkSize);
+
+		error = ReadFileData(offset, fPendingDataBuffer, size);
+		if (error != B_OK)
+			return error;
+
+		fPendingDataSize = size;
+		error = _FlushPendingData();
+		if (error != B_OK)
+			return error;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Trains a dictionary on samples evenly spread over the heap. Heaps too
+	small for a dictionary to pay off get none.
+*/
+status_t
+PackageFileHeapWriter::_TrainDictionary()
+{
+	static const size_t kDictionarySize = 64 * 1024;
+	static const size_t kSampleSize = 4 * 1024;
+	static const size_t kMaxSampleCount = 100 * kDictionarySize / kSampleSize;
+
+	if (fUncompressedHeapSize < 16 * kDictionarySize)
+		return B_OK;
+
+	size_t sampleCount = std::min((uint64)kMaxSampleCount,
+		fUncompressedHeapSize / kSampleSize);
+	uint64 stride = fUncompressedHeapSize / sampleCount;
+
+	uint8* samples = (uint8*)malloc(sampleCount * kSampleSize);
+	size_t* sampleSizes = (size_t*)malloc(sampleCount * sizeof(size_t));
+	void* dictionary = malloc(kDictionarySize);
+	MemoryDeleter samplesDeleter(samples);
+	MemoryDeleter sampleSizesDeleter(sampleSizes);
+	MemoryDeleter dictionaryDeleter(dictionary);
+	if (samples == NULL || sampleSizes == NULL || dictionary == NULL) {
+		fErrorOutput->PrintError("Out of memory!\n");
+		return B_NO_MEMORY;
+	}
+
+	for (size_t i = 0; i < sampleCount; i++) {
+		sampleSizes[i] = kSampleSize;
+		status_t error = ReadFileData(i * stride, samples + i * kSampleSize,
+			kSampleSize);
+		if (error != B_OK)
+			return error;
+	}
+
+	// If training fails -- the data might just be too uniform --, we go
+	// without a dictionary.
+	size_t dictionarySize = kDictionarySize;
+	if (BZstdCompressionAlgorithm::TrainDictionary(samples, sampleSizes,
+			sampleCount, dictionary, dictionarySize) != B_OK) {
+		return B_OK;
+	}
+
+	BZstdCompressionParameters* parameters
+		= dynamic_cast<BZstdCompressionParameters*>(
+			fCompressionAlgorithm->parameters);
+	if (parameters == NULL)
+		return B_BAD_VALUE;
+
+	status_t error = parameters->SetDictionary(dictionary, dictionarySize);
+	if (error != B_OK) {
+		fErrorOutput->PrintError("Failed to set dictionary: %s\n",
+			strerror(error));
+	}
+
+	return error;
+}
+
+
+status_t
+PackageFileHeapWriter::_WriteDictionary()
+{
+	BZstdCompressionParameters* parameters
+		= dynamic_cast<BZstdCompressionParameters*>(
+			fCompressionAlgorithm->parameters);
+	if (parameters == NULL)
+		return B_BAD_VALUE;
+
+	uint32 size = parameters->DictionarySize();
+	if (size > 0) {
+		status_t error = _WriteDataUncompressed(parameters->Dictionary(),
+			size);
+		if (error != B_OK)
+			return error;
+	}
+
+	size = B_HOST_TO_BENDIAN_INT32(size);
+	return _WriteDataUncompressed(&size, sizeof(size));
+}
+
+
 void
 PackageFileHeapWriter::_PushChunks(ChunkBuffer& chunkBuffer, uint64 startOffset,
 	uint64 endOffset)
@@ -797,6 +797,7 @@ PackageWriterImpl::_Recompress(BPositionIO* inputFile)
 
 	off_t totalSize = fHeapWriter->HeapOffset() + (off_t)compressedHeapSize;
 
+	header.minor_version = B_HOST_TO_BENDIAN_INT16(B_HPKG_MINOR_VERSION);
 	header.heap_compression = B_HOST_TO_BENDIAN_INT16(
 		Parameters().Compression());
 	header.heap_chunk_size = B_HOST_TO_BENDIAN_INT32(fHeapWriter->ChunkSize());
@@ -831,6 +832,15 @@ PackageWriterImpl::_Recompress(BPositionIO* inputFile)
 		header.heap_size_compressed = B_HOST_TO_BENDIAN_INT64(compressedHeapSize);
 		header.total_size = B_HOST_TO_BENDIAN_INT64(totalSize);
 
+		// The heap writer may have written more than that, when compressing
+		// in place with a dictionary.
+		error = File()->SetSize(totalSize);
+		if (error != B_OK) {
+			fListener->PrintError("Failed to truncate package file to new "
+				"size: %s\n", strerror(error));
+			return error;
+		}
+
 		// write the header
 		RawWriteBuffer(&header, sizeof(hpkg_header), 0);
 	}
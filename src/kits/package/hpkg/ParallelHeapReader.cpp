@@ -0,0 +1,294 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <package/hpkg/ParallelHeapReader.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <new>
+
+#include <DataIO.h>
+
+#include <package/hpkg/PackageFileHeapReader.h>
+
+
+namespace BPackageKit {
+
+namespace BHPKG {
+
+namespace BPrivate {
+
+
+static const size_t kChunkSize = PackageFileHeapAccessorBase::kChunkSize;
+
+// maximum number of decompression threads
+static const int32 kMaxThreadCount = 64;
+
+// number of chunks decompressed ahead per thread
+static const int32 kSlotsPerThread = 4;
+
+
+enum {
+	SLOT_EMPTY,
+	SLOT_QUEUED,
+	SLOT_DECOMPRESSING,
+	SLOT_READY
+};
+
+
+struct ParallelHeapReader::Slot {
+	size_t		chunkIndex;
+	int32		state;
+	status_t	error;
+	void*		data;
+};
+
+
+ParallelHeapReader::ParallelHeapReader(PackageFileHeapReader* heapReader)
+	:
+	fHeapReader(heapReader),
+	fThreads(NULL),
+	fThreadCount(0),
+	fSlots(NULL),
+	fSlotCount(0),
+	fChunkCount((heapReader->UncompressedHeapSize() + kChunkSize - 1)
+		/ kChunkSize),
+	fCompressedDataBuffer(NULL),
+	fQuitting(false)
+{
+	pthread_mutex_init(&fLock, NULL);
+	pthread_cond_init(&fWorkCondition, NULL);
+	pthread_cond_init(&fDoneCondition, NULL);
+}
+
+
+ParallelHeapReader::~ParallelHeapReader()
+{
+	pthread_mutex_lock(&fLock);
+	fQuitting = true;
+	pthread_cond_broadcast(&fWorkCondition);
+	pthread_mutex_unlock(&fLock);
+
+	for (int32 i = 0; i < fThreadCount; i++)
+		pthread_join(fThreads[i], NULL);
+	delete[] fThreads;
+
+	for (int32 i = 0; i < fSlotCount; i++)
+		free(fSlots[i].data);
+	delete[] fSlots;
+
+	free(fCompressedDataBuffer);
+
+	pthread_cond_destroy(&fDoneCondition);
+	pthread_cond_destroy(&fWorkCondition);
+	pthread_mutex_destroy(&fLock);
+}
+
+
+status_t
+ParallelHeapReader::Init(int32 threadCount)
+{
+	if (threadCount <= 0)
+		threadCount = sysconf(_SC_NPROCESSORS_ONLN);
+	threadCount = std::max((int32)1, std::min(threadCount, kMaxThreadCount));
+
+	fCompressedDataBuffer = malloc(kChunkSize);
+	if (fCompressedDataBuffer == NULL)
+		return B_NO_MEMORY;
+
+	fSlotCount = kSlotsPerThread * threadCount;
+	fSlots = new(std::nothrow) Slot[fSlotCount];
+	if (fSlots == NULL) {
+		fSlotCount = 0;
+		return B_NO_MEMORY;
+	}
+
+	for (int32 i = 0; i < fSlotCount; i++) {
+		fSlots[i].chunkIndex = 0;
+		fSlots[i].state = SLOT_EMPTY;
+		fSlots[i].error = B_OK;
+		fSlots[i].data = malloc(kChunkSize);
+		if (fSlots[i].data == NULL)
+			return B_NO_MEMORY;
+	}
+
+	fThreads = new(std::nothrow) pthread_t[threadCount];
+	if (fThreads == NULL)
+		return B_NO_MEMORY;
+
+	// If we don't get any threads, we simply read synchronously.
+	for (; fThreadCount < threadCount; fThreadCount++) {
+		if (pthread_create(&fThreads[fThreadCount], NULL, &_Worker, this) != 0)
+			break;
+	}
+
+	return B_OK;
+}
+
+
+status_t
+ParallelHeapReader::ReadDataToOutput(off_t offset, size_t size,
+	BDataIO* output)
+{
+	if (size == 0)
+		return B_OK;
+
+	uint64 heapSize = fHeapReader->UncompressedHeapSize();
+	if (offset < 0 || (uint64)offset > heapSize || size > heapSize - offset)
+		return B_BAD_VALUE;
+
+	size_t chunkIndex = size_t(offset / kChunkSize);
+	size_t inChunkOffset = (uint64)offset - (uint64)chunkIndex * kChunkSize;
+	size_t remainingBytes = size;
+
+	while (remainingBytes > 0) {
+		pthread_mutex_lock(&fLock);
+		Slot* slot;
+		status_t error = _GetChunk(chunkIndex, slot);
+		_ScheduleReadAhead(chunkIndex);
+		pthread_mutex_unlock(&fLock);
+
+		if (error != B_OK)
+			return error;
+
+		// The slot is ours until the next _GetChunk(), since the workers
+		// only touch queued slots.
+		size_t toWrite = std::min(kChunkSize - inChunkOffset, remainingBytes);
+		error = output->WriteExactly((char*)slot->data + inChunkOffset,
+			toWrite);
+		if (error != B_OK)
+			return error;
+
+		remainingBytes -= toWrite;
+		chunkIndex++;
+		inChunkOffset = 0;
+	}
+
+	return B_OK;
+}
+
+
+/*static*/ void*
+ParallelHeapReader::_Worker(void* data)
+{
+	((ParallelHeapReader*)data)->_Work();
+	return NULL;
+}
+
+
+void
+ParallelHeapReader::_Work()
+{
+	void* compressedDataBuffer = malloc(kChunkSize);
+	if (compressedDataBuffer == NULL)
+		return;
+
+	pthread_mutex_lock(&fLock);
+
+	while (!fQuitting) {
+		// decompress the queued chunk the reader will need first
+		Slot* slot = NULL;
+		for (int32 i = 0; i < fSlotCount; i++) {
+			if (fSlots[i].state == SLOT_QUEUED
+				&& (slot == NULL || fSlots[i].chunkIndex < slot->chunkIndex)) {
+				slot = &fSlots[i];
+			}
+		}
+
+		if (slot == NULL) {
+			pthread_cond_wait(&fWorkCondition, &fLock);
+			continue;
+		}
+
+		slot->state = SLOT_DECOMPRESSING;
+		pthread_mutex_unlock(&fLock);
+
+		status_t error = fHeapReader->ReadAndDecompressChunk(slot->chunkIndex,
+			compressedDataBuffer, slot->data);
+
+		pthread_mutex_lock(&fLock);
+		slot->error = error;
+		slot->state = SLOT_READY;
+		pthread_cond_broadcast(&fDoneCondition);
+	}
+
+	pthread_mutex_unlock(&fLock);
+	free(compressedDataBuffer);
+}
+
+
+/*!	Returns the slot containing the given chunk, decompressing it in this
+	thread, if no worker has started doing so yet. The lock must be held.
+*/
+status_t
+ParallelHeapReader::_GetChunk(size_t chunkIndex, Slot*& _slot)
+{
+	Slot* slot = &fSlots[chunkIndex % fSlotCount];
+
+	while (true) {
+		if (slot->state == SLOT_READY && slot->chunkIndex == chunkIndex) {
+			_slot = slot;
+			return slot->error;
+		}
+
+		// If a worker is busy with the slot -- be it with our chunk or another
+		// one --, we have to wait for it to finish.
+		if (slot->state == SLOT_DECOMPRESSING) {
+			pthread_cond_wait(&fDoneCondition, &fLock);
+			continue;
+		}
+
+		slot->chunkIndex = chunkIndex;
+		slot->state = SLOT_DECOMPRESSING;
+		pthread_mutex_unlock(&fLock);
+
+		status_t error = fHeapReader->ReadAndDecompressChunk(chunkIndex,
+			fCompressedDataBuffer, slot->data);
+
+		pthread_mutex_lock(&fLock);
+		slot->error = error;
+		slot->state = SLOT_READY;
+		pthread_cond_broadcast(&fDoneCondition);
+	}
+}
+
+
+/*!	Queues the chunks following the given one for decompression, as far as
+	there are free slots. The lock must be held.
+*/
+void
+ParallelHeapReader::_ScheduleReadAhead(size_t chunkIndex)
+{
+	if (fThreadCount == 0)
+		return;
+
+	size_t endIndex = std::min(chunkIndex + fSlotCount, fChunkCount);
+	bool queued = false;
+
+	for (size_t index = chunkIndex + 1; index < endIndex; index++) {
+		Slot* slot = &fSlots[index % fSlotCount];
+		if ((slot->state != SLOT_EMPTY && slot->chunkIndex == index)
+			|| slot->state == SLOT_DECOMPRESSING) {
+			continue;
+		}
+
+		slot->chunkIndex = index;
+		slot->state = SLOT_QUEUED;
+		queued = true;
+	}
+
+	if (queued)
+		pthread_cond_broadcast(&fWorkCondition);
+}
+
+
+}	// namespace BPrivate
+
+}	// namespace BHPKG
+
+}	// namespace BPackageKit
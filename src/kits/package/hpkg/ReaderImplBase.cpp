@@ -16,6 +16,7 @@
 #include <algorithm>
 #include <new>
 
+#include <AutoDeleter.h>
 #include <ByteOrder.h>
 #include <DataIO.h>
 
@@ -833,6 +834,8 @@ ReaderImplBase::InitHeapReader(uint32 compression, uint32 chunkSize,
 			}
 			break;
 		case B_HPKG_COMPRESSION_ZSTD:
+		case B_HPKG_COMPRESSION_ZSTD_DICTIONARY:
+		{
 			decompressionAlgorithm = DecompressionAlgorithmOwner::Create(
 				new(std::nothrow) BZstdCompressionAlgorithm,
 				new(std::nothrow) BZstdDecompressionParameters);
@@ -842,7 +845,16 @@ ReaderImplBase::InitHeapReader(uint32 compression, uint32 chunkSize,
 				|| decompressionAlgorithm->parameters == NULL) {
 				return B_NO_MEMORY;
 			}
+
+			if (compression == B_HPKG_COMPRESSION_ZSTD_DICTIONARY) {
+				status_t error = _ReadHeapDictionary(offset, compressedSize,
+					static_cast<BZstdDecompressionParameters*>(
+						decompressionAlgorithm->parameters));
+				if (error != B_OK)
+					return error;
+			}
 			break;
+		}
 		default:
 			fErrorOutput->PrintError("Error: Invalid heap compression\n");
 			return B_BAD_DATA;
@@ -878,6 +890,64 @@ ReaderImplBase::CreateCachedHeapReader(PackageFileHeapReader* heapReader,
 }
 
 
+/*!	Reads the dictionary stored at the end of a heap compressed with
+	B_HPKG_COMPRESSION_ZSTD_DICTIONARY and sets it on the decompression
+	parameters. Reduces \a _compressedHeapSize by the size of the dictionary
+	and its trailer, so that it covers the chunks and the chunk sizes table
+	only, like for the other compression types.
+*/
+status_t
+ReaderImplBase::_ReadHeapDictionary(off_t heapOffset,
+	uint64& _compressedHeapSize, BZstdDecompressionParameters* parameters)
+{
+	static const uint32 kMaxDictionarySize = 1024 * 1024;
+
+	uint32 dictionarySize;
+	if (_compressedHeapSize < sizeof(dictionarySize)) {
+		fErrorOutput->PrintError("Error: Invalid %s file: Heap too small for "
+			"dictionary\n", fFileType);
+		return B_BAD_DATA;
+	}
+
+	status_t error = ReadBuffer(heapOffset + (off_t)_compressedHeapSize
+		- (off_t)sizeof(dictionarySize), &dictionarySize,
+		sizeof(dictionarySize));
+	if (error != B_OK)
+		return error;
+
+	dictionarySize = B_BENDIAN_TO_HOST_INT32(dictionarySize);
+	uint64 trailerSize = (uint64)dictionarySize + sizeof(dictionarySize);
+	if (dictionarySize > kMaxDictionarySize
+		|| trailerSize > _compressedHeapSize) {
+		fErrorOutput->PrintError("Error: Invalid %s file: Invalid heap "
+			"dictionary size (%" B_PRIu32 ")\n", fFileType, dictionarySize);
+		return B_BAD_DATA;
+	}
+
+	_compressedHeapSize -= trailerSize;
+	if (dictionarySize == 0)
+		return B_OK;
+
+	void* dictionary = malloc(dictionarySize);
+	if (dictionary == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter dictionaryDeleter(dictionary);
+
+	error = ReadBuffer(heapOffset + (off_t)_compressedHeapSize, dictionary,
+		dictionarySize);
+	if (error != B_OK)
+		return error;
+
+	error = parameters->SetDictionary(dictionary, dictionarySize);
+	if (error != B_OK) {
+		fErrorOutput->PrintError("Error: Failed to load heap dictionary: %s\n",
+			strerror(error));
+	}
+
+	return error;
+}
+
+
 status_t
 ReaderImplBase::InitSection(PackageFileSection& section, uint64 endOffset,
 	uint64 length, uint64 maxSaneLength, uint64 stringsLength,
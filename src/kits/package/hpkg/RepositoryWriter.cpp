@@ -8,6 +8,7 @@
 
 #include <new>
 
+#include <package/hpkg/PackageWriter.h>
 #include <package/hpkg/RepositoryWriterImpl.h>
 #include <package/RepositoryInfo.h>
 
@@ -32,12 +33,16 @@ BRepositoryWriter::~BRepositoryWriter()
 
 
 status_t
-BRepositoryWriter::Init(const char* fileName)
+BRepositoryWriter::Init(const char* fileName,
+	const BPackageWriterParameters* parameters)
 {
 	if (fImpl == NULL)
 		return B_NO_MEMORY;
 
-	return fImpl->Init(fileName);
+	BPackageWriterParameters defaultParameters;
+
+	return fImpl->Init(fileName,
+		parameters != NULL ? *parameters : defaultParameters);
 }
 
 
@@ -329,6 +329,7 @@ WriterImplBase::InitHeapReader(size_t headerSize)
 			}
 			break;
 		case B_HPKG_COMPRESSION_ZSTD:
+		case B_HPKG_COMPRESSION_ZSTD_DICTIONARY:
 			compressionAlgorithm = CompressionAlgorithmOwner::Create(
 				new(std::nothrow) BZstdCompressionAlgorithm,
 				new(std::nothrow) BZstdCompressionParameters(
@@ -358,7 +359,8 @@ WriterImplBase::InitHeapReader(size_t headerSize)
 	// create heap writer
 	fHeapWriter = new PackageFileHeapWriter(fErrorOutput, fFile, headerSize,
 		compressionAlgorithm, decompressionAlgorithm);
-	fHeapWriter->Init();
+	fHeapWriter->Init(fParameters.ThreadCount(),
+		fParameters.Compression() == B_HPKG_COMPRESSION_ZSTD_DICTIONARY);
 
 	return B_OK;
 }
@@ -380,6 +380,19 @@ BDirectory::GetNextDirents(dirent* buf, size_t bufSize, int32 count)
 }
 
 
+int32
+BDirectory::GetNextDirentsWithStats(dirent* buf, size_t bufSize,
+	struct stat* stats, int32 count)
+{
+	if (buf == NULL || stats == NULL)
+		return B_BAD_VALUE;
+	if (InitCheck() != B_OK)
+		return B_FILE_ERROR;
+	return _kern_read_dir_stat(fDirFd, buf, bufSize, count, stats,
+		sizeof(struct stat));
+}
+
+
 status_t
 BDirectory::Rewind()
 {
@@ -8,6 +8,7 @@
 #include <ZstdCompressionAlgorithm.h>
 
 #include <errno.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <algorithm>
@@ -24,6 +25,7 @@
 // build compression support only for userland
 #if defined(ZSTD_ENABLED) && !defined(_KERNEL_MODE) && !defined(_BOOT_MODE)
 #	define B_ZSTD_COMPRESSION_SUPPORT 1
+#	include <zdict.h>
 #endif
 
 
@@ -41,6 +43,78 @@ sanitize_buffer_size(size_t size)
 }
 
 
+#ifdef ZSTD_ENABLED
+
+
+// Creating a context costs more than compressing or decompressing a single
+// buffer with it, so CompressBuffer() and DecompressBuffer() keep a few of
+// them around. They are not tied to any parameters or dictionary.
+static const int32 kCachedContextCount = 4;
+
+#ifdef B_ZSTD_COMPRESSION_SUPPORT
+static ZSTD_CCtx* sCompressionContexts[kCachedContextCount];
+#endif
+static ZSTD_DCtx* sDecompressionContexts[kCachedContextCount];
+
+
+static inline void*
+atomic_get_and_set_pointer(void** pointer, void* set)
+{
+#ifdef B_HAIKU_64_BIT
+	return (void*)atomic_get_and_set64((int64*)pointer, (int64)set);
+#else
+	return (void*)atomic_get_and_set((int32*)pointer, (int32)set);
+#endif
+}
+
+
+static inline void*
+atomic_test_and_set_pointer(void** pointer, void* set, void* test)
+{
+#ifdef B_HAIKU_64_BIT
+	return (void*)atomic_test_and_set64((int64*)pointer, (int64)set,
+		(int64)test);
+#else
+	return (void*)atomic_test_and_set((int32*)pointer, (int32)set,
+		(int32)test);
+#endif
+}
+
+
+//!	Returns a cached context, or \c NULL if there is none.
+template<typename Context>
+static Context*
+take_cached_context(Context** cache)
+{
+	for (int32 i = 0; i < kCachedContextCount; i++) {
+		Context* context = (Context*)atomic_get_and_set_pointer(
+			(void**)&cache[i], NULL);
+		if (context != NULL)
+			return context;
+	}
+
+	return NULL;
+}
+
+
+//!	Puts the \a context into the cache; returns \c false if it is full.
+template<typename Context>
+static bool
+cache_context(Context** cache, Context* context)
+{
+	for (int32 i = 0; i < kCachedContextCount; i++) {
+		if (atomic_test_and_set_pointer((void**)&cache[i], context, NULL)
+				== NULL)
+			return true;
+	}
+
+	return false;
+}
+
+
+#endif	// ZSTD_ENABLED
+
+
 // #pragma mark - BZstdCompressionParameters
 
 
@@ -49,13 +123,17 @@ BZstdCompressionParameters::BZstdCompressionParameters(
 	:
 	BCompressionParameters(),
 	fCompressionLevel(compressionLevel),
-	fBufferSize(kDefaultBufferSize)
+	fBufferSize(kDefaultBufferSize),
+	fDictionary(NULL),
+	fDictionarySize(0),
+	fCompressionDictionary(NULL)
 {
 }
 
 
 BZstdCompressionParameters::~BZstdCompressionParameters()
 {
+	SetDictionary(NULL, 0);
 }
 
 
@@ -70,6 +148,10 @@ void
 BZstdCompressionParameters::SetCompressionLevel(int32 level)
 {
 	fCompressionLevel = level;
+
+	// the digested dictionary depends on the compression level
+	if (fCompressionDictionary != NULL)
+		_CreateCompressionDictionary();
 }
 
 
@@ -87,19 +169,65 @@ BZstdCompressionParameters::SetBufferSize(size_t size)
 }
 
 
+/*!	Sets the dictionary to compress with. The data are copied. Passing
+	\c NULL unsets the dictionary.
+*/
+status_t
+BZstdCompressionParameters::SetDictionary(const void* dictionary, size_t size)
+{
+#ifdef B_ZSTD_COMPRESSION_SUPPORT
+	ZSTD_freeCDict(fCompressionDictionary);
+#endif
+	fCompressionDictionary = NULL;
+	free(fDictionary);
+	fDictionary = NULL;
+	fDictionarySize = 0;
+
+	if (dictionary == NULL || size == 0)
+		return B_OK;
+
+	fDictionary = malloc(size);
+	if (fDictionary == NULL)
+		return B_NO_MEMORY;
+
+	memcpy(fDictionary, dictionary, size);
+	fDictionarySize = size;
+
+	return _CreateCompressionDictionary();
+}
+
+
+status_t
+BZstdCompressionParameters::_CreateCompressionDictionary()
+{
+#ifdef B_ZSTD_COMPRESSION_SUPPORT
+	ZSTD_freeCDict(fCompressionDictionary);
+	fCompressionDictionary = ZSTD_createCDict(fDictionary, fDictionarySize,
+		fCompressionLevel);
+	return fCompressionDictionary != NULL ? B_OK : B_NO_MEMORY;
+#else
+	return B_NOT_SUPPORTED;
+#endif
+}
+
+
 // #pragma mark - BZstdDecompressionParameters
 
 
 BZstdDecompressionParameters::BZstdDecompressionParameters()
 	:
 	BDecompressionParameters(),
-	fBufferSize(kDefaultBufferSize)
+	fBufferSize(kDefaultBufferSize),
+	fDictionary(NULL),
+	fDictionarySize(0),
+	fDecompressionDictionary(NULL)
 {
 }
 
 
 BZstdDecompressionParameters::~BZstdDecompressionParameters()
 {
+	SetDictionary(NULL, 0);
 }
 
 
@@ -117,6 +245,46 @@ BZstdDecompressionParameters::SetBufferSize(size_t size)
 }
 
 
+/*!	Sets the dictionary the data to decompress have been compressed with. The
+	data are copied. Passing \c NULL unsets the dictionary.
+*/
+status_t
+BZstdDecompressionParameters::SetDictionary(const void* dictionary,
+	size_t size)
+{
+#ifdef ZSTD_ENABLED
+	ZSTD_freeDDict(fDecompressionDictionary);
+#endif
+	fDecompressionDictionary = NULL;
+	free(fDictionary);
+	fDictionary = NULL;
+	fDictionarySize = 0;
+
+	if (dictionary == NULL || size == 0)
+		return B_OK;
+
+#ifdef ZSTD_ENABLED
+	fDictionary = malloc(size);
+	if (fDictionary == NULL)
+		return B_NO_MEMORY;
+
+	memcpy(fDictionary, dictionary, size);
+	fDictionarySize = size;
+
+	// digest the dictionary once, not for every buffer
+	fDecompressionDictionary = ZSTD_createDDict(fDictionary, fDictionarySize);
+	if (fDecompressionDictionary == NULL) {
+		SetDictionary(NULL, 0);
+		return B_NO_MEMORY;
+	}
+
+	return B_OK;
+#else
+	return B_NOT_SUPPORTED;
+#endif
+}
+
+
 // #pragma mark - CompressionStrategy
 
 
@@ -378,8 +546,26 @@ BZstdCompressionAlgorithm::CompressBuffer(const void* input,
 		? zstdParameters->CompressionLevel()
 		: B_ZSTD_COMPRESSION_DEFAULT;
 
-	size_t zstdError = ZSTD_compress(output, outputSize, input,
-		inputSize, compressionLevel);
+	ZSTD_CCtx* context = take_cached_context(sCompressionContexts);
+	if (context == NULL) {
+		context = ZSTD_createCCtx();
+		if (context == NULL)
+			return B_NO_MEMORY;
+	}
+
+	size_t zstdError;
+	if (zstdParameters != NULL
+		&& zstdParameters->fCompressionDictionary != NULL) {
+		zstdError = ZSTD_compress_usingCDict(context, output, outputSize,
+			input, inputSize, zstdParameters->fCompressionDictionary);
+	} else {
+		zstdError = ZSTD_compressCCtx(context, output, outputSize, input,
+			inputSize, compressionLevel);
+	}
+
+	if (!cache_context(sCompressionContexts, context))
+		ZSTD_freeCCtx(context);
+
 	if (ZSTD_isError(zstdError))
 		return _TranslateZstdError(zstdError);
 
@@ -397,8 +583,29 @@ BZstdCompressionAlgorithm::DecompressBuffer(const void* input,
 	size_t& _uncompressedSize, const BDecompressionParameters* parameters)
 {
 #ifdef ZSTD_ENABLED
-	size_t zstdError = ZSTD_decompress(output, outputSize, input,
-		inputSize);
+	const BZstdDecompressionParameters* zstdParameters
+		= dynamic_cast<const BZstdDecompressionParameters*>(parameters);
+
+	ZSTD_DCtx* context = take_cached_context(sDecompressionContexts);
+	if (context == NULL) {
+		context = ZSTD_createDCtx();
+		if (context == NULL)
+			return B_NO_MEMORY;
+	}
+
+	size_t zstdError;
+	if (zstdParameters != NULL
+		&& zstdParameters->fDecompressionDictionary != NULL) {
+		zstdError = ZSTD_decompress_usingDDict(context, output, outputSize,
+			input, inputSize, zstdParameters->fDecompressionDictionary);
+	} else {
+		zstdError = ZSTD_decompressDCtx(context, output, outputSize, input,
+			inputSize);
+	}
+
+	if (!cache_context(sDecompressionContexts, context))
+		ZSTD_freeDCtx(context);
+
 	if (ZSTD_isError(zstdError))
 		return _TranslateZstdError(zstdError);
 
@@ -410,6 +617,46 @@ BZstdCompressionAlgorithm::DecompressBuffer(const void* input,
 }
 
 
+/*!	Trains a dictionary for compressing data similar to the given samples,
+	which are stored back to back in \a samples. Typically, the samples should
+	amount to about a hundred times the dictionary size.
+*/
+/*static*/ status_t
+BZstdCompressionAlgorithm::TrainDictionary(const void* samples,
+	const size_t* sampleSizes, uint32 sampleCount, void* dictionary,
+	size_t& _dictionarySize)
+{
+#ifdef B_ZSTD_COMPRESSION_SUPPORT
+	size_t size = ZDICT_trainFromBuffer(dictionary, _dictionarySize, samples,
+		sampleSizes, sampleCount);
+	if (ZDICT_isError(size))
+		return B_ERROR;
+
+	_dictionarySize = size;
+	return B_OK;
+#else
+	return B_NOT_SUPPORTED;
+#endif
+}
+
+
+/*!	Frees the contexts that CompressBuffer() and DecompressBuffer() keep
+	for reuse. Must only be called when neither of them can run anymore.
+*/
+/*static*/ void
+BZstdCompressionAlgorithm::FreeCachedContexts()
+{
+#ifdef ZSTD_ENABLED
+#ifdef B_ZSTD_COMPRESSION_SUPPORT
+	while (ZSTD_CCtx* context = take_cached_context(sCompressionContexts))
+		ZSTD_freeCCtx(context);
+#endif
+	while (ZSTD_DCtx* context = take_cached_context(sDecompressionContexts))
+		ZSTD_freeDCtx(context);
+#endif
+}
+
+
 /*static*/ status_t
 BZstdCompressionAlgorithm::_TranslateZstdError(size_t error)
 {
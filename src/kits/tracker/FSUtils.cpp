@@ -47,6 +47,7 @@ respective holders. All rights reserved.
 
 #include <ctype.h>
 #include <errno.h>
+#include <new>
 #include <strings.h>
 #include <unistd.h>
 
@@ -72,6 +73,7 @@ respective holders. All rights reserved.
 #include <fs_info.h>
 #include <sys/utsname.h>
 
+#include <AutoDeleter.h>
 #include <AutoLocker.h>
 #include <libroot/libroot_private.h>
 #include <system/syscalls.h>
@@ -2575,34 +2577,58 @@ status_t
 FSRecursiveCalcSize(BInfoWindow* window, CopyLoopControl* loopControl,
 	BDirectory* dir, off_t* _runningSize, int32* _fileCount, int32* _dirCount)
 {
+	// read the entries in batches, together with their stat data, instead
+	// of looking up and stat()ing every entry on its own
+	const int32 kBatchCount = 32;
+	const size_t kBufferSize = kBatchCount
+		* (sizeof(dirent) + B_FILE_NAME_LENGTH);
+
+	char* buffer = new(std::nothrow) char[kBufferSize];
+	struct stat* stats = new(std::nothrow) struct stat[kBatchCount];
+	ArrayDeleter<char> bufferDeleter(buffer);
+	ArrayDeleter<struct stat> statsDeleter(stats);
+	if (buffer == NULL || stats == NULL)
+		return B_NO_MEMORY;
+
 	dir->Rewind();
-	BEntry entry;
-	while (dir->GetNextEntry(&entry) == B_OK) {
-		// be sure window hasn't closed
-		if (window && window->StopCalc())
-			return B_OK;
 
-		if (loopControl->CheckUserCanceled())
-			return kUserCanceled;
+	int32 count;
+	while ((count = dir->GetNextDirentsWithStats((dirent*)buffer,
+			kBufferSize, stats, kBatchCount)) > 0) {
+		dirent* entry = (dirent*)buffer;
+		for (int32 i = 0; i < count; i++, entry = (dirent*)((char*)entry
+				+ entry->d_reclen)) {
+			// be sure window hasn't closed
+			if (window && window->StopCalc())
+				return B_OK;
 
-		StatStruct statbuf;
-		status_t status = entry.GetStat(&statbuf);
-		if (status != B_OK)
-			return status;
+			if (loopControl->CheckUserCanceled())
+				return kUserCanceled;
+
+			if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+				continue;
 
-		(*_runningSize) += statbuf.st_blocks * 512;
+			const struct stat& statbuf = stats[i];
+			if (statbuf.st_mode == 0) {
+				// the entry is gone already
+				continue;
+			}
 
-		if (S_ISDIR(statbuf.st_mode)) {
-			BDirectory subdir(&entry);
-			(*_dirCount)++;
-			status = FSRecursiveCalcSize(window, loopControl, &subdir,
-				_runningSize, _fileCount, _dirCount);
-			if (status != B_OK)
-				return status;
-		} else
-			(*_fileCount)++;
+			(*_runningSize) += statbuf.st_blocks * 512;
+
+			if (S_ISDIR(statbuf.st_mode)) {
+				BDirectory subdir(dir, entry->d_name);
+				(*_dirCount)++;
+				status_t status = FSRecursiveCalcSize(window, loopControl,
+					&subdir, _runningSize, _fileCount, _dirCount);
+				if (status != B_OK)
+					return status;
+			} else
+				(*_fileCount)++;
+		}
 	}
-	return B_OK;
+
+	return count < 0 ? (status_t)count : B_OK;
 }
 
 
@@ -295,6 +295,8 @@ struct ifnet {
 	sem_id				link_state_sem;
 	int32				open_count;
 	int32				flags;
+	uint32				offload;
+		/* enabled ETHER_OFFLOAD_* features */
 
 	/* WLAN specific additions */
 	sem_id				scan_done_sem;
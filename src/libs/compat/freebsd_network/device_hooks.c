@@ -2,6 +2,7 @@
  * Copyright 2007-2009, Axel Dörfler, axeld@pinc-software.de.
  * Copyright 2007, Hugo Santos. All Rights Reserved.
  * Copyright 2004, Marcus Overhagen. All Rights Reserved.
+ * Copyright 2026, Haiku, Inc. All Rights Reserved.
  * Distributed under the terms of the MIT License.
  */
 
@@ -22,6 +23,106 @@
 #include <compat/net/if_media.h>
 
 
+#define OFFLOAD_TCP_CHECKSUM_OFFSET	16
+#define OFFLOAD_IP_VERSION_OFFSET	ETHER_HDR_LEN
+
+
+static uint32
+compat_supported_offload(struct ifnet *ifp)
+{
+	uint32 offload = 0;
+	if ((ifp->if_capabilities & IFCAP_RXCSUM) != 0)
+		offload |= ETHER_OFFLOAD_RX_CHECKSUM;
+	// the stack leaves checksums to the device for both IPv4 and IPv6
+	if ((ifp->if_capabilities & (IFCAP_TXCSUM | IFCAP_TXCSUM_IPV6))
+			== (IFCAP_TXCSUM | IFCAP_TXCSUM_IPV6)) {
+		offload |= ETHER_OFFLOAD_TX_CHECKSUM;
+		if ((ifp->if_capabilities & IFCAP_TSO4) != 0)
+			offload |= ETHER_OFFLOAD_TSO4;
+		if ((ifp->if_capabilities & IFCAP_TSO6) != 0)
+			offload |= ETHER_OFFLOAD_TSO6;
+	}
+	return offload;
+}
+
+
+static status_t
+compat_set_offload(struct ifnet *ifp, uint32 offload)
+{
+	struct ifreq ifr;
+	status_t status = B_OK;
+	int capabilities = ifp->if_capenable
+		& ~(IFCAP_RXCSUM | IFCAP_RXCSUM_IPV6 | IFCAP_TXCSUM
+			| IFCAP_TXCSUM_IPV6 | IFCAP_TSO);
+
+	if ((offload & ETHER_OFFLOAD_RX_CHECKSUM) != 0) {
+		capabilities |= ifp->if_capabilities
+			& (IFCAP_RXCSUM | IFCAP_RXCSUM_IPV6);
+	}
+	if ((offload & ETHER_OFFLOAD_TX_CHECKSUM) != 0)
+		capabilities |= IFCAP_TXCSUM | IFCAP_TXCSUM_IPV6;
+	if ((offload & ETHER_OFFLOAD_TSO4) != 0)
+		capabilities |= IFCAP_TSO4;
+	if ((offload & ETHER_OFFLOAD_TSO6) != 0)
+		capabilities |= IFCAP_TSO6;
+
+	if (capabilities != ifp->if_capenable) {
+		memset(&ifr, 0, sizeof(ifr));
+		ifr.ifr_reqcap = capabilities;
+
+		IFF_LOCKGIANT(ifp);
+		status = ifp->if_ioctl(ifp, SIOCSIFCAP, (caddr_t)&ifr);
+		IFF_UNLOCKGIANT(ifp);
+	}
+
+	if (status == B_OK)
+		ifp->offload = offload;
+	return status;
+}
+
+
+/*!	Translates the offload header the stack passed with a frame into the
+	mbuf checksum and segmentation flags.
+*/
+static void
+compat_apply_offload(struct mbuf *mb, const ether_offload_header *header)
+{
+	uint8 version = 4;
+	if (mb->m_len > OFFLOAD_IP_VERSION_OFFSET)
+		version = mtod(mb, uint8 *)[OFFLOAD_IP_VERSION_OFFSET] >> 4;
+
+	if (header->segmentation != ETHER_OFFLOAD_SEGMENT_NONE) {
+		uint16 checksumOffset = header->checksum_start
+			+ header->checksum_offset;
+		uint16 length = htons(mb->m_pkthdr.len - header->checksum_start);
+
+		// drivers expect the pseudo header sum without the length
+		if (checksumOffset + sizeof(uint16) <= (size_t)mb->m_len) {
+			uint16 *checksum
+				= (uint16 *)(mtod(mb, uint8 *) + checksumOffset);
+			uint32 sum = *checksum + (uint16)~length;
+			sum = (sum & 0xffff) + (sum >> 16);
+			*checksum = sum;
+		}
+
+		mb->m_pkthdr.csum_flags = version == 6
+			? CSUM_IP6_TCP | CSUM_IP6_TSO : CSUM_IP_TCP | CSUM_IP_TSO;
+		mb->m_pkthdr.csum_data = header->checksum_offset;
+		mb->m_pkthdr.tso_segsz = header->segment_size;
+		return;
+	}
+
+	if ((header->flags & ETHER_OFFLOAD_NEEDS_CHECKSUM) == 0)
+		return;
+
+	if (header->checksum_offset == OFFLOAD_TCP_CHECKSUM_OFFSET)
+		mb->m_pkthdr.csum_flags = version == 6 ? CSUM_IP6_TCP : CSUM_IP_TCP;
+	else
+		mb->m_pkthdr.csum_flags = version == 6 ? CSUM_IP6_UDP : CSUM_IP_UDP;
+	mb->m_pkthdr.csum_data = header->checksum_offset;
+}
+
+
 static status_t
 compat_open(const char *name, uint32 flags, void **cookie)
 {
@@ -44,6 +145,8 @@ compat_open(const char *name, uint32 flags, void **cookie)
 	ifp = gDevices[i];
 	if_printf(ifp, "compat_open(0x%" B_PRIx32 ")\n", flags);
 
+	ifp->offload = 0;
+
 	if (atomic_or(&ifp->open_count, 1)) {
 		put_module(NET_STACK_MODULE_NAME);
 		return B_BUSY;
@@ -120,6 +223,7 @@ compat_read(void *cookie, off_t position, void *buffer, size_t *numBytes)
 	status_t status;
 	struct mbuf *mb;
 	size_t length = *numBytes;
+	size_t headerLength = 0;
 
 	//if_printf(ifp, "compat_read(%lld, %p, [%lu])\n", position,
 	//	buffer, *numBytes);
@@ -144,7 +248,10 @@ compat_read(void *cookie, off_t position, void *buffer, size_t *numBytes)
 		IF_DEQUEUE(&ifp->receive_queue, mb);
 	} while (mb == NULL);
 
-	if (mb->m_pkthdr.len > length) {
+	if (ifp->offload != 0)
+		headerLength = sizeof(ether_offload_header);
+
+	if (mb->m_pkthdr.len + headerLength > length) {
 		if_printf(ifp, "error reading packet: too large! (%d > %" B_PRIuSIZE ")\n",
 			mb->m_pkthdr.len, length);
 		m_freem(mb);
@@ -152,10 +259,24 @@ compat_read(void *cookie, off_t position, void *buffer, size_t *numBytes)
 		return E2BIG;
 	}
 
+	if (headerLength != 0) {
+		ether_offload_header header;
+		memset(&header, 0, sizeof(header));
+		if ((ifp->offload & ETHER_OFFLOAD_RX_CHECKSUM) != 0
+			&& (mb->m_pkthdr.csum_flags & (CSUM_DATA_VALID | CSUM_PSEUDO_HDR))
+				== (CSUM_DATA_VALID | CSUM_PSEUDO_HDR)
+			&& mb->m_pkthdr.csum_data == 0xffff)
+			header.flags = ETHER_OFFLOAD_CHECKSUM_VALID;
+
+		memcpy(buffer, &header, sizeof(header));
+		buffer = (uint8 *)buffer + headerLength;
+		length -= headerLength;
+	}
+
 	length = min_c(max_c((size_t)mb->m_pkthdr.len, 0), length);
 
 	m_copydata(mb, 0, length, buffer);
-	*numBytes = length;
+	*numBytes = headerLength + length;
 
 	m_freem(mb);
 	return B_OK;
@@ -169,16 +290,34 @@ compat_write(void *cookie, off_t position, const void *buffer,
 	struct ifnet *ifp = cookie;
 	struct mbuf *mb;
 	int length = *numBytes;
+	ether_offload_header header;
+	int headerLength = 0;
 
 	//if_printf(ifp, "compat_write(%lld, %p, [%lu])\n", position,
 	//	buffer, *numBytes);
 
+	if (ifp->offload != 0) {
+		headerLength = sizeof(ether_offload_header);
+		if (length < headerLength)
+			return B_BAD_VALUE;
+
+		memcpy(&header, buffer, sizeof(header));
+		buffer = (const uint8 *)buffer + headerLength;
+		length -= headerLength;
+	}
+	int totalLength = length;
+
 	if (length <= MHLEN) {
 		mb = m_gethdr(0, MT_DATA);
 		if (mb == NULL)
 			return ENOBUFS;
 	} else {
-		mb = m_get2(length, 0, MT_DATA, M_PKTHDR);
+		int allocationLength = length;
+		if (headerLength != 0
+			&& header.segmentation != ETHER_OFFLOAD_SEGMENT_NONE)
+			allocationLength = min_c(length, MJUMPAGESIZE);
+
+		mb = m_get2(allocationLength, 0, MT_DATA, M_PKTHDR);
 		if (mb == NULL)
 			return E2BIG;
 
@@ -189,7 +328,21 @@ compat_write(void *cookie, off_t position, const void *buffer,
 
 	mb->m_pkthdr.len = mb->m_len = length;
 	memcpy(mtod(mb, void *), buffer, mb->m_len);
-	*numBytes = length;
+
+	if (headerLength != 0) {
+		// a frame to be segmented does not need to fit into a single mbuf
+		if (header.segmentation != ETHER_OFFLOAD_SEGMENT_NONE
+			&& length < totalLength) {
+			if (m_append(mb, totalLength - length,
+					(c_caddr_t)buffer + length) == 0) {
+				m_freem(mb);
+				return ENOBUFS;
+			}
+			length = totalLength;
+		}
+		compat_apply_offload(mb, &header);
+	}
+	*numBytes = headerLength + length;
 
 	IFF_LOCKGIANT(ifp);
 	int result = ifp->if_output(ifp, mb, NULL, NULL);
@@ -322,6 +475,26 @@ compat_control(void *cookie, uint32 op, void *arg, size_t length)
 			return user_memcpy(arg, &state, sizeof(ether_link_state_t));
 		}
 
+		case ETHER_GET_OFFLOAD:
+		{
+			uint32 offload = compat_supported_offload(ifp);
+			if (length < sizeof(offload))
+				return B_BAD_VALUE;
+			return user_memcpy(arg, &offload, sizeof(offload));
+		}
+
+		case ETHER_SET_OFFLOAD:
+		{
+			uint32 offload;
+			if (length < sizeof(offload))
+				return B_BAD_VALUE;
+			if (user_memcpy(&offload, arg, sizeof(offload)) < B_OK)
+				return B_BAD_ADDRESS;
+			if ((offload & ~compat_supported_offload(ifp)) != 0)
+				return B_NOT_SUPPORTED;
+			return compat_set_offload(ifp, offload);
+		}
+
 		case ETHER_SET_LINK_STATE_SEM:
 			if (user_memcpy(&ifp->link_state_sem, arg, sizeof(sem_id)) < B_OK) {
 				ifp->link_state_sem = -1;
@@ -0,0 +1,29 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <sys/sendfile.h>
+
+#include <errno.h>
+#include <fcntl.h>
+
+#include <syscall_utils.h>
+#include <syscalls.h>
+
+
+ssize_t
+sendfile(int outFD, int inFD, off_t* offset, size_t count)
+{
+	RETURN_AND_SET_ERRNO_TEST_CANCEL(_kern_sendfile(outFD, inFD, offset, count));
+}
+
+
+ssize_t
+splice(int fdIn, off_t* offsetIn, int fdOut, off_t* offsetOut, size_t length,
+	unsigned int flags)
+{
+	RETURN_AND_SET_ERRNO_TEST_CANCEL(_kern_splice(fdIn, offsetIn, fdOut, offsetOut, length,
+		flags));
+}
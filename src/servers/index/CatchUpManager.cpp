@@ -8,9 +8,15 @@
 
 #include "CatchUpManager.h"
 
-#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <sys/stat.h>
 
+#include <Autolock.h>
 #include <Debug.h>
+#include <Entry.h>
+#include <fs_info.h>
+#include <InterfaceDefs.h>
 #include <Query.h>
 
 #include "IndexServer.h"
@@ -21,17 +27,165 @@ const uint32 kCatchUpDone = '&CUD';
 
 const bigtime_t kSecond = 1000000;
 
+//! entries analysed between two checkpoints
+const int32 kBatchSize = 1000;
+const int32 kMaxWorkers = 8;
+
+//! the user counts as active if there was input within this time
+const bigtime_t kUserIdleTime = 60 * kSecond;
+const bigtime_t kActivityCheckInterval = kSecond;
+const bigtime_t kPausePollInterval = kSecond;
+//! budget while the user is active
+const int32 kActiveDutyCycle = 20;
+const off_t kActiveBandwidth = 1024 * 1024;
+
+
+static bool
+entry_ref_less(const entry_ref& a, const entry_ref& b)
+{
+	if (a.directory != b.directory)
+		return a.directory < b.directory;
+	return strcmp(a.name, b.name) < 0;
+}
+
+
+/*!	Chooses the number of workers and the I/O bandwidth the catch up may use
+	when the user is idle. Solid state and memory backed devices get a worker
+	per CPU and no bandwidth limit, devices that might be rotating media get
+	two workers, so that one can compute while the other one waits for the
+	disk, and slow removable and network volumes only one.
+*/
+static void
+get_volume_budget(const BVolume& volume, int32& _workerCount,
+	off_t& _idleBandwidth)
+{
+	system_info systemInfo;
+	get_system_info(&systemInfo);
+	int32 cpuCount = std::min((int32)systemInfo.cpu_count, kMaxWorkers);
+
+	fs_info info;
+	if (fs_stat_dev(volume.Device(), &info) != 0)
+		info.device_name[0] = '\0';
+
+	if (!volume.IsPersistent()
+		|| strncmp(info.device_name, "/dev/disk/virtual/ram/", 22) == 0
+		|| strncmp(info.device_name, "/dev/disk/nvme/", 15) == 0) {
+		_workerCount = cpuCount;
+		_idleBandwidth = 0;
+	} else if (volume.IsShared()) {
+		_workerCount = 1;
+		_idleBandwidth = 4 * 1024 * 1024;
+	} else if (volume.IsRemovable()
+		|| strncmp(info.device_name, "/dev/disk/usb/", 14) == 0) {
+		_workerCount = 1;
+		_idleBandwidth = 8 * 1024 * 1024;
+	} else {
+		_workerCount = std::min(cpuCount, (int32)2);
+		_idleBandwidth = 32 * 1024 * 1024;
+	}
+}
+
+
+CatchUpThrottle::CatchUpThrottle(off_t idleBandwidth)
+	:
+	fLock("catch up throttle"),
+	fIdleBandwidth(idleBandwidth),
+	fLastActivityCheck(0),
+	fUserActive(false),
+	fTokens(0),
+	fLastRefill(system_time())
+{
+}
+
+
+bool
+CatchUpThrottle::Wait(int32 worker, AnalyserDispatcher* dispatcher)
+{
+	while (!dispatcher->Stopped()) {
+		if (worker == 0 || !_UserActive())
+			return true;
+		snooze(kPausePollInterval);
+	}
+	return false;
+}
+
+
+void
+CatchUpThrottle::Account(off_t bytes, bigtime_t busyTime)
+{
+	bool active = _UserActive();
+	if (active) {
+		// only use a fraction of a CPU
+		snooze(busyTime * (100 - kActiveDutyCycle) / kActiveDutyCycle);
+	}
+
+	off_t bandwidth = active ? kActiveBandwidth : fIdleBandwidth;
+	if (bandwidth <= 0)
+		return;
+
+	bigtime_t wait = 0;
+	{
+		BAutolock _(fLock);
+
+		// token bucket that allows bursts of up to a second
+		bigtime_t now = system_time();
+		fTokens = std::min(fTokens
+			+ (double)(now - fLastRefill) * bandwidth / kSecond,
+			(double)bandwidth);
+		fLastRefill = now;
+
+		fTokens -= bytes;
+		if (fTokens < 0)
+			wait = (bigtime_t)(-fTokens * kSecond / bandwidth);
+	}
+
+	if (wait > 0)
+		snooze(std::min(wait, 10 * kSecond));
+}
+
+
+bool
+CatchUpThrottle::_UserActive()
+{
+	BAutolock _(fLock);
+
+	bigtime_t now = system_time();
+	if (now - fLastActivityCheck >= kActivityCheckInterval) {
+		fUserActive = idle_time() < kUserIdleTime;
+		fLastActivityCheck = now;
+	}
+	return fUserActive;
+}
+
 
 CatchUpAnalyser::CatchUpAnalyser(const BVolume& volume, time_t start,
-	time_t end, BHandler* manager)
+	time_t end, int32 workerCount, off_t idleBandwidth, BHandler* manager)
 	:
 	AnalyserDispatcher("CatchUpAnalyser"),
 	fVolume(volume),
 	fStart(start),
 	fEnd(end),
-	fCatchUpManager(manager)
+	fCatchUpManager(manager),
+	fWorkerCount(workerCount),
+	fThrottle(idleBandwidth),
+	fNextEntry(0),
+	fBatchEnd(0)
 {
-	
+	fWorkers = new Worker[fWorkerCount];
+	for (int32 i = 0; i < fWorkerCount; i++) {
+		fWorkers[i].catchUpAnalyser = this;
+		fWorkers[i].analysers = i == 0
+			? &fFileAnalyserList : new FileAnalyserList(20, true);
+		fWorkers[i].index = i;
+	}
+}
+
+
+CatchUpAnalyser::~CatchUpAnalyser()
+{
+	for (int32 i = 1; i < fWorkerCount; i++)
+		delete fWorkers[i].analysers;
+	delete[] fWorkers;
 }
 
 
@@ -60,13 +214,39 @@ CatchUpAnalyser::StartAnalysing()
 void
 CatchUpAnalyser::AnalyseEntry(const entry_ref& ref)
 {
-	for (int i = 0; i < fFileAnalyserList.CountItems(); i++) {
-		FileAnalyser* analyser = fFileAnalyserList.ItemAt(i);
-		const analyser_settings& settings = analyser->CachedSettings();
-		if (settings.syncPosition / kSecond >= fStart
-			&& settings.watchingStart / kSecond <= fEnd)
-			analyser->AnalyseEntry(ref);
+	struct stat stat;
+	if (BEntry(&ref).GetStat(&stat) == B_OK)
+		_AnalyseEntry(fFileAnalyserList, ref, stat);
+}
+
+
+/*!	Adds a copy of one of the analysers for the given worker; every worker
+	needs its own set of analysers.
+*/
+bool
+CatchUpAnalyser::AddWorkerAnalyser(int32 worker, FileAnalyser* analyser)
+{
+	if (analyser == NULL || worker <= 0 || worker >= fWorkerCount)
+		return false;
+
+	BAutolock _(this);
+	return fWorkers[worker].analysers->AddItem(analyser);
+}
+
+
+bool
+CatchUpAnalyser::RemoveAnalyser(const BString& name)
+{
+	BAutolock _(this);
+	for (int32 i = 1; i < fWorkerCount; i++) {
+		FileAnalyserList* analysers = fWorkers[i].analysers;
+		for (int32 j = analysers->CountItems() - 1; j >= 0; j--) {
+			if (analysers->ItemAt(j)->Name() == name)
+				delete analysers->RemoveItemAt(j);
+		}
 	}
+
+	return AnalyserDispatcher::RemoveAnalyser(name);
 }
 
 
@@ -89,24 +269,27 @@ CatchUpAnalyser::_CatchUp()
 
 	query.Fetch();
 
-	std::vector<entry_ref> entryList;
+	fEntryList.clear();
 	entry_ref ref;
 	while (query.GetNextRef(&ref) == B_OK)
-		entryList.push_back(ref);
+		fEntryList.push_back(ref);
 
-	printf("CatchUpAnalyser:: entryList.size() %i\n", (int)entryList.size());
+	// The checkpoints rely on a stable order; going through the volume
+	// directory by directory is also easier on the disk.
+	std::sort(fEntryList.begin(), fEntryList.end(), entry_ref_less);
 
-	if (entryList.size() == 0)
-		return;
+	int32 count = fEntryList.size();
+	printf("CatchUpAnalyser:: entryList.size() %i, %i workers\n", (int)count,
+		(int)fWorkerCount);
 
-	for (uint32 i = 0; i < entryList.size(); i++) {
-		if (Stopped())
+	for (int32 start = 0; start < count; start += kBatchSize) {
+		int32 end = std::min(start + kBatchSize, count);
+		if (_RunBatch(start, end) != end || Stopped())
 			return;
-		if (i % 100 == 0)
-			printf("Catch up: %i/%i\n", (int)i,(int)entryList.size());
-		AnalyseEntry(entryList[i]);
+
+		_WriteCheckpoint(fEntryList[end - 1]);
+		printf("Catch up: %i/%i\n", (int)end, (int)count);
 	}
-	LastEntry();
 
 	_WriteSyncSatus(fEnd * kSecond);
 	printf("Catched up.\n");
@@ -118,6 +301,111 @@ CatchUpAnalyser::_CatchUp()
 }
 
 
+/*!	Lets the workers analyse the entries from \a start to \a end. The first
+	worker runs in the looper thread. Returns the index up to which all
+	entries have been analysed.
+*/
+int32
+CatchUpAnalyser::_RunBatch(int32 start, int32 end)
+{
+	fNextEntry = start;
+	fBatchEnd = end;
+
+	std::vector<thread_id> threads;
+	for (int32 i = 1; i < fWorkerCount; i++) {
+		// a worker that misses some of the analysers can't be used
+		if (fWorkers[i].analysers->CountItems()
+				!= fFileAnalyserList.CountItems())
+			continue;
+
+		thread_id thread = spawn_thread(&_WorkerThread, "catch up worker",
+			B_LOW_PRIORITY, &fWorkers[i]);
+		if (thread < 0)
+			continue;
+		threads.push_back(thread);
+		resume_thread(thread);
+	}
+
+	_Work(fWorkers[0]);
+
+	for (uint32 i = 0; i < threads.size(); i++) {
+		status_t result;
+		wait_for_thread(threads[i], &result);
+	}
+
+	return Stopped() ? start : end;
+}
+
+
+/*static*/ status_t
+CatchUpAnalyser::_WorkerThread(void* data)
+{
+	Worker* worker = (Worker*)data;
+	worker->catchUpAnalyser->_Work(*worker);
+	return B_OK;
+}
+
+
+void
+CatchUpAnalyser::_Work(Worker& worker)
+{
+	while (fThrottle.Wait(worker.index, this)) {
+		int32 index = atomic_add(&fNextEntry, 1);
+		if (index >= fBatchEnd)
+			break;
+
+		const entry_ref& ref = fEntryList[index];
+		struct stat stat;
+		if (BEntry(&ref).GetStat(&stat) != B_OK)
+			continue;
+
+		bigtime_t startTime = system_time();
+		_AnalyseEntry(*worker.analysers, ref, stat);
+		fThrottle.Account(stat.st_size, system_time() - startTime);
+	}
+
+	// make the results durable before the checkpoint is written
+	for (int i = 0; i < worker.analysers->CountItems(); i++)
+		worker.analysers->ItemAt(i)->LastEntry();
+}
+
+
+void
+CatchUpAnalyser::_AnalyseEntry(FileAnalyserList& analysers,
+	const entry_ref& ref, const struct stat& stat)
+{
+	for (int i = 0; i < analysers.CountItems(); i++) {
+		FileAnalyser* analyser = analysers.ItemAt(i);
+		const analyser_settings& settings = analyser->CachedSettings();
+		if (settings.syncPosition / kSecond < fStart
+			|| settings.watchingStart / kSecond > fEnd)
+			continue;
+
+		// skip what an earlier, interrupted catch up already did
+		if (settings.catchUpEnd != 0
+			&& stat.st_mtime <= settings.catchUpEnd / kSecond
+			&& (ref.directory < settings.catchUpDirectory
+				|| (ref.directory == settings.catchUpDirectory
+					&& strcmp(ref.name, settings.catchUpName.String()) <= 0)))
+			continue;
+
+		analyser->AnalyseEntry(ref);
+	}
+}
+
+
+void
+CatchUpAnalyser::_WriteCheckpoint(const entry_ref& ref)
+{
+	for (int i = 0; i < fFileAnalyserList.CountItems(); i++) {
+		AnalyserSettings* settings = fFileAnalyserList.ItemAt(i)->Settings();
+		ASSERT(settings);
+		settings->SetCatchUpCheckpoint(fEnd * kSecond, ref);
+		settings->WriteSettings();
+	}
+}
+
+
 void
 CatchUpAnalyser::_WriteSyncSatus(bigtime_t syncTime)
 {
@@ -125,6 +413,7 @@ CatchUpAnalyser::_WriteSyncSatus(bigtime_t syncTime)
 		AnalyserSettings* settings = fFileAnalyserList.ItemAt(i)->Settings();
 		ASSERT(settings);
 		settings->SetSyncPosition(syncTime);
+		settings->ClearCatchUpCheckpoint();
 		settings->WriteSettings();
 	}
 	
@@ -135,7 +424,7 @@ CatchUpManager::CatchUpManager(const BVolume& volume)
 	:
 	fVolume(volume)
 {
-
+	get_volume_budget(fVolume, fWorkerCount, fIdleBandwidth);
 }
 
 
@@ -203,6 +492,7 @@ bool
 CatchUpManager::CatchUp()
 {
 	STRACE("CatchUpManager::CatchUp()\n");
+	IndexServer* server = (IndexServer*)be_app;
 	bigtime_t startBig = real_time_clock_usecs();
 	bigtime_t endBig = 0;
 	for (int i = 0; i < fFileAnalyserQueue.CountItems(); i++) {
@@ -218,7 +508,8 @@ CatchUpManager::CatchUp()
 	}
 
 	CatchUpAnalyser* catchUpAnalyser = new CatchUpAnalyser(fVolume,
-		startBig / kSecond, endBig / kSecond, this);
+		startBig / kSecond, endBig / kSecond, fWorkerCount, fIdleBandwidth,
+		this);
 	if (!catchUpAnalyser)
 		return false;
 	if (!fCatchUpAnalyserList.AddItem(catchUpAnalyser)) {
@@ -229,9 +520,21 @@ CatchUpManager::CatchUp()
 	for (int i = 0; i < fFileAnalyserQueue.CountItems(); i++) {
 		FileAnalyser* analyser = fFileAnalyserQueue.ItemAt(i);
 		// if AddAnalyser fails at least don't leak
-		if (!catchUpAnalyser->AddAnalyser(analyser))
+		if (!catchUpAnalyser->AddAnalyser(analyser)) {
 			delete analyser;
-			
+			continue;
+		}
+
+		// the other workers need their own instances
+		for (int32 worker = 1; worker < fWorkerCount; worker++) {
+			FileAnalyser* copy = server->CreateFileAnalyser(analyser->Name(),
+				fVolume);
+			if (copy == NULL)
+				break;
+			copy->SetSettings(analyser->Settings());
+			if (!catchUpAnalyser->AddWorkerAnalyser(worker, copy))
+				delete copy;
+		}
 	}
 	fFileAnalyserQueue.MakeEmpty();
 
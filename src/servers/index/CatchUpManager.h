@@ -9,6 +9,10 @@
 #define CATCH_UP_MANAGER_H
 
 
+#include <vector>
+
+#include <Locker.h>
+
 #include "AnalyserDispatcher.h"
 
 
@@ -21,21 +25,68 @@
 #endif
 
 
+/*! Limits the I/O bandwidth and CPU time the catch up may use. While the user
+is active, only the first worker keeps running, and it only gets a small
+budget. The bandwidth budget is shared by all workers. */
+class CatchUpThrottle {
+public:
+								CatchUpThrottle(off_t idleBandwidth);
+
+			//! Blocks while the worker is paused, returns false if the
+			//! dispatcher has been stopped in the mean time.
+			bool				Wait(int32 worker,
+									AnalyserDispatcher* dispatcher);
+			//! Charges the work done for an entry, and waits if that used up
+			//! the budget.
+			void				Account(off_t bytes, bigtime_t busyTime);
+
+private:
+			bool				_UserActive();
+
+			BLocker				fLock;
+			off_t				fIdleBandwidth;
+			bigtime_t			fLastActivityCheck;
+			bool				fUserActive;
+			double				fTokens;
+			bigtime_t			fLastRefill;
+};
+
+
 class CatchUpAnalyser : public AnalyserDispatcher {
 public:
 								CatchUpAnalyser(const BVolume& volume,
 									time_t start, time_t end,
+									int32 workerCount, off_t idleBandwidth,
 									BHandler* manager);
+								~CatchUpAnalyser();
 
 			void				MessageReceived(BMessage *message);
 			void				StartAnalysing();
 
 			void				AnalyseEntry(const entry_ref& ref);
 
+			//! thread safe
+			bool				AddWorkerAnalyser(int32 worker,
+									FileAnalyser* analyser);
+			bool				RemoveAnalyser(const BString& name);
+
 			const BVolume&		Volume() { return fVolume; }
 
 private:
+			struct Worker {
+				CatchUpAnalyser*	catchUpAnalyser;
+				FileAnalyserList*	analysers;
+				int32				index;
+			};
+
 			void				_CatchUp();
+			int32				_RunBatch(int32 start, int32 end);
+	static	status_t			_WorkerThread(void* data);
+			void				_Work(Worker& worker);
+			void				_AnalyseEntry(FileAnalyserList& analysers,
+									const entry_ref& ref,
+									const struct stat& stat);
+			void				_WriteCheckpoint(const entry_ref& ref);
 			void				_WriteSyncSatus(bigtime_t syncTime);
 
 			BVolume				fVolume;
@@ -43,6 +94,14 @@ private:
 			time_t				fEnd;
 
 			BHandler*			fCatchUpManager;
+
+			int32				fWorkerCount;
+			Worker*				fWorkers;
+			CatchUpThrottle		fThrottle;
+
+			std::vector<entry_ref>	fEntryList;
+			int32				fNextEntry;
+			int32				fBatchEnd;
 };
 
 
@@ -69,6 +128,8 @@ public:
 
 private:
 			BVolume				fVolume;
+			int32				fWorkerCount;
+			off_t				fIdleBandwidth;
 
 			FileAnalyserList	fFileAnalyserQueue;
 			CatchUpAnalyserList	fCatchUpAnalyserList;
@@ -6,13 +6,25 @@
 
 #include "EntryCache.h"
 
+#include <algorithm>
 #include <new>
+
+#include <low_resource_manager.h>
 #include <vm/vm.h>
 
 
 static const int32 kEntryNotInArray = -1;
 static const int32 kEntryRemoved = -2;
 
+// All entry caches share a common budget of entries, which is derived from
+// the amount of memory available at the time the first cache is created.
+static int32 sEntryCount = 0;
+static int32 sMaxEntryCount = 0;
+
+typedef DoublyLinkedList<EntryCache> EntryCacheList;
+static mutex sEntryCachesLock = MUTEX_INITIALIZER("entry caches");
+static EntryCacheList sEntryCaches;
+
 
 // #pragma mark - EntryCacheGeneration
 
@@ -51,16 +63,28 @@ EntryCache::EntryCache()
 	:
 	fGenerationCount(0),
 	fGenerations(NULL),
-	fCurrentGeneration(0)
+	fCurrentGeneration(0),
+	fRegistered(false)
 {
 	rw_lock_init(&fLock, "entry cache");
 
 	new(&fEntries) EntryTable;
+
+	memset(&fStatistics, 0, sizeof(fStatistics));
 }
 
 
 EntryCache::~EntryCache()
 {
+	if (fRegistered) {
+		MutexLocker locker(sEntryCachesLock);
+		sEntryCaches.Remove(this);
+		if (sEntryCaches.IsEmpty()) {
+			unregister_low_resource_handler(&_LowMemoryHandler, NULL);
+			sMaxEntryCount = 0;
+		}
+	}
+
 	// delete entries
 	EntryCacheEntry* entry = fEntries.Clear(true);
 	while (entry != NULL) {
@@ -68,6 +92,7 @@ EntryCache::~EntryCache()
 		free(entry);
 		entry = next;
 	}
+	atomic_add(&sEntryCount, -fStatistics.entries);
 	delete[] fGenerations;
 
 	rw_lock_destroy(&fLock);
@@ -92,12 +117,33 @@ EntryCache::Init()
 	}
 
 	fGenerations = new(std::nothrow) EntryCacheGeneration[fGenerationCount];
+	if (fGenerations == NULL)
+		return B_NO_MEMORY;
+
 	for (int32 i = 0; i < fGenerationCount; i++) {
 		error = fGenerations[i].Init(entriesSize);
 		if (error != B_OK)
 			return error;
 	}
 
+	MutexLocker locker(sEntryCachesLock);
+
+	if (sEntryCaches.IsEmpty()) {
+		// Allow the entries of all caches to use up to about 1/256 of the
+		// available memory. An entry with a short name uses about 64 bytes,
+		// including the generation array slot.
+		sMaxEntryCount = std::max((off_t)entriesSize,
+			std::min(vm_available_memory() / 256 / 64, (off_t)1024 * 1024));
+
+		error = register_low_resource_handler(&_LowMemoryHandler, NULL,
+			B_KERNEL_RESOURCE_PAGES | B_KERNEL_RESOURCE_MEMORY, 0);
+		if (error != B_OK)
+			return error;
+	}
+
+	sEntryCaches.Add(this);
+	fRegistered = true;
+
 	return B_OK;
 }
 
@@ -107,13 +153,30 @@ EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
 {
 	EntryCacheKey key(dirID, name);
 
+	// Allocate the entry before locking, so that the low memory handler
+	// can't be blocked by us waiting for memory.
+	EntryCacheEntry* newEntry = (EntryCacheEntry*)malloc(
+		sizeof(EntryCacheEntry) + strlen(name));
+	if (newEntry == NULL)
+		return B_NO_MEMORY;
+
+	// If all caches together are over budget, make room in the largest one.
+	// This has to happen before we lock ourselves, as the caches are locked
+	// with the list lock held.
+	if (atomic_get(&sEntryCount) >= sMaxEntryCount)
+		_ClearLargestCache();
+
 	WriteLocker _(fLock);
 
-	if (fGenerationCount == 0)
+	if (fGenerationCount == 0) {
+		free(newEntry);
 		return B_NO_MEMORY;
+	}
 
 	EntryCacheEntry* entry = fEntries.Lookup(key);
 	if (entry != NULL) {
+		free(newEntry);
+
 		entry->node_id = nodeID;
 		entry->missing = missing;
 		if (entry->generation != fCurrentGeneration) {
@@ -125,10 +188,7 @@ EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
 		return B_OK;
 	}
 
-	entry = (EntryCacheEntry*)malloc(sizeof(EntryCacheEntry) + strlen(name));
-	if (entry == NULL)
-		return B_NO_MEMORY;
-
+	entry = newEntry;
 	entry->node_id = nodeID;
 	entry->dir_id = dirID;
 	entry->missing = missing;
@@ -137,6 +197,8 @@ EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
 	strcpy(entry->name, name);
 
 	fEntries.Insert(entry);
+	fStatistics.entries++;
+	atomic_add(&sEntryCount, 1);
 
 	_AddEntryToCurrentGeneration(entry);
 
@@ -156,6 +218,8 @@ EntryCache::Remove(ino_t dirID, const char* name)
 		return B_ENTRY_NOT_FOUND;
 
 	fEntries.Remove(entry);
+	fStatistics.entries--;
+	atomic_add(&sEntryCount, -1);
 
 	if (entry->index >= 0) {
 		// remove the entry from its generation and delete it
@@ -181,8 +245,12 @@ EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID,
 	ReadLocker readLocker(fLock);
 
 	EntryCacheEntry* entry = fEntries.Lookup(key);
-	if (entry == NULL)
+	if (entry == NULL) {
+		_UpdateStatistics(false, false);
 		return false;
+	}
+
+	_UpdateStatistics(true, entry->missing);
 
 	const int32 oldGeneration = atomic_get_and_set(&entry->generation,
 		fCurrentGeneration);
@@ -227,6 +295,33 @@ EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID,
 }
 
 
+void
+EntryCache::GetStatistics(entry_cache_statistics& statistics) const
+{
+	statistics = fStatistics;
+	statistics.max_entries = sMaxEntryCount;
+}
+
+
+/*static*/ void
+EntryCache::GetGlobalStatistics(entry_cache_statistics& statistics)
+{
+	memset(&statistics, 0, sizeof(statistics));
+
+	MutexLocker locker(sEntryCachesLock);
+
+	for (EntryCacheList::Iterator it = sEntryCaches.GetIterator();
+			EntryCache* cache = it.Next();) {
+		statistics.hits += cache->fStatistics.hits;
+		statistics.negative_hits += cache->fStatistics.negative_hits;
+		statistics.misses += cache->fStatistics.misses;
+		statistics.entries += cache->fStatistics.entries;
+	}
+
+	statistics.max_entries = sMaxEntryCount;
+}
+
+
 const char*
 EntryCache::DebugReverseLookup(ino_t nodeID, ino_t& _dirID)
 {
@@ -259,15 +354,7 @@ EntryCache::_AddEntryToCurrentGeneration(EntryCacheEntry* entry)
 
 	// we have to clear the oldest generation
 	const int32 newGeneration = (fCurrentGeneration + 1) % fGenerationCount;
-	for (int32 i = 0; i < fGenerations[newGeneration].entries_size; i++) {
-		EntryCacheEntry* otherEntry = fGenerations[newGeneration].entries[i];
-		if (otherEntry == NULL)
-			continue;
-
-		fGenerations[newGeneration].entries[i] = NULL;
-		fEntries.Remove(otherEntry);
-		free(otherEntry);
-	}
+	_ClearGeneration(newGeneration);
 
 	// set the new generation and add the entry
 	fCurrentGeneration = newGeneration;
@@ -276,3 +363,115 @@ EntryCache::_AddEntryToCurrentGeneration(EntryCacheEntry* entry)
 	entry->generation = newGeneration;
 	entry->index = 0;
 }
+
+
+int32
+EntryCache::_ClearGeneration(int32 generation)
+{
+	ASSERT_WRITE_LOCKED_RW_LOCK(&fLock);
+
+	int32 cleared = 0;
+	for (int32 i = 0; i < fGenerations[generation].entries_size; i++) {
+		EntryCacheEntry* entry = fGenerations[generation].entries[i];
+		if (entry == NULL)
+			continue;
+
+		fGenerations[generation].entries[i] = NULL;
+		fEntries.Remove(entry);
+		free(entry);
+		cleared++;
+	}
+
+	fStatistics.entries -= cleared;
+	atomic_add(&sEntryCount, -cleared);
+
+	return cleared;
+}
+
+
+/*!	Clears up to \a count of the oldest generations that contain entries.
+	The current generation is never cleared.
+	\return The number of entries removed from the cache.
+*/
+int32
+EntryCache::_ClearOldestGenerations(int32 count)
+{
+	ASSERT_WRITE_LOCKED_RW_LOCK(&fLock);
+
+	int32 cleared = 0;
+	for (int32 i = 1; i < fGenerationCount && count > 0; i++) {
+		int32 generation = (fCurrentGeneration + i) % fGenerationCount;
+		int32 clearedInGeneration = _ClearGeneration(generation);
+		if (clearedInGeneration > 0) {
+			cleared += clearedInGeneration;
+			count--;
+		}
+	}
+
+	return cleared;
+}
+
+
+/*!	Clears the oldest generation of the cache with the most entries. Must
+	not be called with the lock of any cache held.
+*/
+/*static*/ void
+EntryCache::_ClearLargestCache()
+{
+	MutexLocker locker(sEntryCachesLock);
+
+	EntryCache* largest = NULL;
+	for (EntryCacheList::Iterator it = sEntryCaches.GetIterator();
+			EntryCache* cache = it.Next();) {
+		if (largest == NULL
+			|| cache->fStatistics.entries > largest->fStatistics.entries)
+			largest = cache;
+	}
+
+	if (largest == NULL)
+		return;
+
+	WriteLocker cacheLocker(largest->fLock);
+	largest->_ClearOldestGenerations(1);
+}
+
+
+void
+EntryCache::_UpdateStatistics(bool found, bool missing)
+{
+	if (!found)
+		atomic_add64(&fStatistics.misses, 1);
+	else if (missing)
+		atomic_add64(&fStatistics.negative_hits, 1);
+	else
+		atomic_add64(&fStatistics.hits, 1);
+}
+
+
+/*static*/ void
+EntryCache::_LowMemoryHandler(void* /*data*/, uint32 resources, int32 level)
+{
+	MutexLocker locker(sEntryCachesLock);
+
+	for (EntryCacheList::Iterator it = sEntryCaches.GetIterator();
+			EntryCache* cache = it.Next();) {
+		int32 count;
+		switch (level) {
+			case B_NO_LOW_RESOURCE:
+				return;
+			case B_LOW_RESOURCE_NOTE:
+				count = cache->fGenerationCount / 4;
+				break;
+			case B_LOW_RESOURCE_WARNING:
+				count = cache->fGenerationCount / 2;
+				break;
+			case B_LOW_RESOURCE_CRITICAL:
+			default:
+				count = cache->fGenerationCount;
+				break;
+		}
+
+		WriteLocker cacheLocker(cache->fLock);
+		cache->_ClearOldestGenerations(count);
+	}
+}
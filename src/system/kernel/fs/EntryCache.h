@@ -12,6 +12,7 @@
 #include <util/DoublyLinkedList.h>
 #include <util/OpenHashTable.h>
 #include <util/StringHash.h>
+#include <vfs_defs.h>
 
 
 struct EntryCacheKey {
@@ -82,7 +83,7 @@ struct EntryCacheHashDefinition {
 };
 
 
-class EntryCache {
+class EntryCache : public DoublyLinkedListLinkImpl<EntryCache> {
 public:
 								EntryCache();
 								~EntryCache();
@@ -97,6 +98,11 @@ public:
 			bool				Lookup(ino_t dirID, const char* name,
 									ino_t& nodeID, bool& missing);
 
+			void				GetStatistics(
+									entry_cache_statistics& statistics) const;
+	static	void				GetGlobalStatistics(
+									entry_cache_statistics& statistics);
+
 			const char*			DebugReverseLookup(ino_t nodeID, ino_t& _dirID);
 
 private:
@@ -106,6 +112,14 @@ private:
 private:
 			void				_AddEntryToCurrentGeneration(
 									EntryCacheEntry* entry);
+			int32				_ClearGeneration(int32 generation);
+			int32				_ClearOldestGenerations(int32 count);
+			void				_UpdateStatistics(bool found, bool missing);
+
+	static	void				_ClearLargestCache();
+
+	static	void				_LowMemoryHandler(void* data,
+									uint32 resources, int32 level);
 
 private:
 			rw_lock				fLock;
@@ -113,6 +127,8 @@ private:
 			int32				fGenerationCount;
 			EntryCacheGeneration* fGenerations;
 			int32				fCurrentGeneration;
+			bool				fRegistered;
+			entry_cache_statistics fStatistics;
 };
 
 
@@ -7,6 +7,8 @@
 
 #include <sys/socket.h>
 
+#include <sys/stat.h>
+
 #include <errno.h>
 #include <limits.h>
 
@@ -32,6 +34,8 @@
 #define MAX_SOCKET_ADDRESS_LENGTH	(sizeof(sockaddr_storage))
 #define MAX_SOCKET_OPTION_LENGTH	128
 #define MAX_ANCILLARY_DATA_LENGTH	1024
+#define MAX_MESSAGE_VECTOR_COUNT	1024
+#define SPLICE_BUFFER_SIZE			(64 * 1024)
 
 #define GET_SOCKET_FD_OR_RETURN(fd, kernel, descriptor)	\
 	do {												\
@@ -670,6 +674,117 @@ common_get_next_socket_stat(int family, uint32 *cookie, struct net_stat *stat)
 }
 
 
+static bool
+is_file_type(file_descriptor* descriptor, mode_t type, off_t* _size = NULL)
+{
+	struct stat stat;
+	if (descriptor->ops->fd_read_stat == NULL
+		|| descriptor->ops->fd_read_stat(descriptor, &stat) != B_OK
+		|| (stat.st_mode & S_IFMT) != type) {
+		return false;
+	}
+
+	if (_size != NULL)
+		*_size = stat.st_size;
+	return true;
+}
+
+
+/*!	Returns the position to transfer data from or to: either the one given
+	by the user, or the descriptor's current one. Streams have a position
+	of -1.
+*/
+static status_t
+get_transfer_position(file_descriptor* descriptor, off_t* userOffset,
+	off_t& pos)
+{
+	if (userOffset == NULL) {
+		pos = descriptor->pos;
+		return B_OK;
+	}
+
+	if (descriptor->pos == -1)
+		return ESPIPE;
+	if (!IS_USER_ADDRESS(userOffset)
+		|| user_memcpy(&pos, userOffset, sizeof(off_t)) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	return pos >= 0 ? B_OK : B_BAD_VALUE;
+}
+
+
+static status_t
+set_transfer_position(file_descriptor* descriptor, off_t* userOffset,
+	off_t pos)
+{
+	if (userOffset != NULL)
+		return user_memcpy(userOffset, &pos, sizeof(off_t));
+
+	if (pos != -1)
+		descriptor->pos = pos;
+	return B_OK;
+}
+
+
+/*!	Copies up to \a count bytes from \a in to \a out through a kernel
+	buffer, so that the data never has to pass through userland. The
+	positions are advanced by the amount of data transferred, unless they
+	are -1.
+*/
+static ssize_t
+copy_descriptor_data(file_descriptor* in, off_t& inPos, file_descriptor* out,
+	off_t& outPos, size_t count)
+{
+	if (in->ops->fd_read == NULL || out->ops->fd_write == NULL)
+		return B_BAD_VALUE;
+
+	size_t bufferSize = min_c(count, SPLICE_BUFFER_SIZE);
+	void* buffer = malloc(bufferSize);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter bufferDeleter(buffer);
+
+	ssize_t bytesTransferred = 0;
+	status_t status = B_OK;
+
+	while ((size_t)bytesTransferred < count) {
+		size_t bytesRead = min_c(count - bytesTransferred, bufferSize);
+		status = in->ops->fd_read(in, inPos, buffer, &bytesRead);
+		if (status != B_OK || bytesRead == 0)
+			break;
+		if (inPos != -1)
+			inPos += bytesRead;
+
+		// Data read from a stream cannot be put back, so keep writing until
+		// all of it is gone, or an error occurs.
+		size_t bytesWritten = 0;
+		while (bytesWritten < bytesRead) {
+			size_t length = bytesRead - bytesWritten;
+			status = out->ops->fd_write(out, outPos,
+				(uint8*)buffer + bytesWritten, &length);
+			if (status != B_OK || length == 0)
+				break;
+
+			bytesWritten += length;
+			if (outPos != -1)
+				outPos += length;
+		}
+
+		bytesTransferred += bytesWritten;
+		if (bytesWritten < bytesRead) {
+			if (inPos != -1)
+				inPos -= bytesRead - bytesWritten;
+			break;
+		}
+	}
+
+	if (bytesTransferred > 0)
+		return bytesTransferred;
+	return status;
+}
+
+
 // #pragma mark - kernel sockets API
 
 
@@ -978,8 +1093,11 @@ _user_recvfrom(int socket, void *data, size_t length, int flags,
 }
 
 
-ssize_t
-_user_recvmsg(int socket, struct msghdr *userMessage, int flags)
+/*!	Does the work of _user_recvmsg(); the caller has to take care of syscall
+	restarts.
+*/
+static ssize_t
+user_recvmsg(int socket, struct msghdr *userMessage, int flags)
 {
 	// copy message from userland
 	msghdr message;
@@ -1013,9 +1131,7 @@ _user_recvmsg(int socket, struct msghdr *userMessage, int flags)
 	}
 
 	// recvmsg()
-	SyscallRestartWrapper<ssize_t> result;
-
-	result = common_recvmsg(socket, &message, flags, false);
+	ssize_t result = common_recvmsg(socket, &message, flags, false);
 	if (result < 0)
 		return result;
 
@@ -1036,6 +1152,67 @@ _user_recvmsg(int socket, struct msghdr *userMessage, int flags)
 }
 
 
+ssize_t
+_user_recvmsg(int socket, struct msghdr *userMessage, int flags)
+{
+	SyscallRestartWrapper<ssize_t> result;
+	return result = user_recvmsg(socket, userMessage, flags);
+}
+
+
+/*!	Receives up to \a count messages with a single syscall. Only the first
+	message is waited for if \c MSG_WAITFORONE is given; the \a timeout is
+	checked after each message, as is done on other systems.
+*/
+ssize_t
+_user_recvmmsg(int socket, struct mmsghdr *userMessages, unsigned int count,
+	int flags, bigtime_t timeout)
+{
+	if (count > MAX_MESSAGE_VECTOR_COUNT)
+		count = MAX_MESSAGE_VECTOR_COUNT;
+	if (userMessages == NULL
+		|| !is_user_address_range(userMessages, sizeof(mmsghdr) * count)) {
+		return B_BAD_ADDRESS;
+	}
+
+	bigtime_t deadline = B_INFINITE_TIMEOUT;
+	if (timeout >= 0 && timeout != B_INFINITE_TIMEOUT)
+		deadline = system_time() + timeout;
+
+	SyscallRestartWrapper<ssize_t> result;
+	bool waitForOne = (flags & MSG_WAITFORONE) != 0;
+	flags &= ~MSG_WAITFORONE;
+
+	unsigned int received = 0;
+	while (received < count) {
+		mmsghdr* userMessage = &userMessages[received];
+		ssize_t bytesReceived = user_recvmsg(socket, &userMessage->msg_hdr,
+			flags);
+		if (bytesReceived < 0) {
+			// errors are reported with the first message only; a datagram
+			// that has been received must not be lost
+			if (received == 0)
+				return result = bytesReceived;
+			break;
+		}
+
+		unsigned int length = bytesReceived;
+		if (user_memcpy(&userMessage->msg_len, &length, sizeof(length))
+				!= B_OK) {
+			return result = B_BAD_ADDRESS;
+		}
+
+		received++;
+		if (waitForOne)
+			flags |= MSG_DONTWAIT;
+		if (deadline != B_INFINITE_TIMEOUT && system_time() >= deadline)
+			break;
+	}
+
+	return result = received;
+}
+
+
 ssize_t
 _user_send(int socket, const void *data, size_t length, int flags)
 {
@@ -1078,8 +1255,11 @@ _user_sendto(int socket, const void *data, size_t length, int flags,
 }
 
 
-ssize_t
-_user_sendmsg(int socket, const struct msghdr *userMessage, int flags)
+/*!	Does the work of _user_sendmsg(); the caller has to take care of syscall
+	restarts.
+*/
+static ssize_t
+user_sendmsg(int socket, const struct msghdr *userMessage, int flags)
 {
 	// copy message from userland
 	msghdr message;
@@ -1122,9 +1302,55 @@ _user_sendmsg(int socket, const struct msghdr *userMessage, int flags)
 	}
 
 	// sendmsg()
+	return common_sendmsg(socket, &message, flags, false);
+}
+
+
+ssize_t
+_user_sendmsg(int socket, const struct msghdr *userMessage, int flags)
+{
 	SyscallRestartWrapper<ssize_t> result;
+	return result = user_sendmsg(socket, userMessage, flags);
+}
+
 
-	return result = common_sendmsg(socket, &message, flags, false);
+/*!	Sends up to \a count messages with a single syscall. Stops at the first
+	message that could not be sent, and only reports its error if it was the
+	first one.
+*/
+ssize_t
+_user_sendmmsg(int socket, struct mmsghdr *userMessages, unsigned int count,
+	int flags)
+{
+	if (count > MAX_MESSAGE_VECTOR_COUNT)
+		count = MAX_MESSAGE_VECTOR_COUNT;
+	if (userMessages == NULL
+		|| !is_user_address_range(userMessages, sizeof(mmsghdr) * count)) {
+		return B_BAD_ADDRESS;
+	}
+
+	SyscallRestartWrapper<ssize_t> result;
+
+	unsigned int sent = 0;
+	while (sent < count) {
+		mmsghdr* userMessage = &userMessages[sent];
+		ssize_t bytesSent = user_sendmsg(socket, &userMessage->msg_hdr, flags);
+		if (bytesSent < 0) {
+			if (sent == 0)
+				return result = bytesSent;
+			break;
+		}
+
+		unsigned int length = bytesSent;
+		if (user_memcpy(&userMessage->msg_len, &length, sizeof(length))
+				!= B_OK) {
+			return result = B_BAD_ADDRESS;
+		}
+
+		sent++;
+	}
+
+	return result = sent;
 }
 
 
@@ -1307,3 +1533,106 @@ _user_get_next_socket_stat(int family, uint32 *_cookie, struct net_stat *_stat)
 
 	return B_OK;
 }
+
+
+ssize_t
+_user_sendfile(int socket, int fd, off_t* userOffset, size_t count)
+{
+	if (count > SSIZE_MAX)
+		count = SSIZE_MAX;
+
+	FileDescriptorPutter descriptor(get_fd(get_current_io_context(false), fd));
+	if (!descriptor.IsSet())
+		return B_FILE_ERROR;
+	if ((descriptor->open_mode & O_RWMASK) == O_WRONLY)
+		return B_FILE_ERROR;
+
+	off_t size;
+	if (!is_file_type(descriptor.Get(), S_IFREG, &size))
+		return B_BAD_VALUE;
+
+	off_t offset;
+	status_t status = get_transfer_position(descriptor.Get(), userOffset,
+		offset);
+	if (status != B_OK)
+		return status;
+
+	FileDescriptorPutter target(get_fd(get_current_io_context(false), socket));
+	if (!target.IsSet())
+		return B_FILE_ERROR;
+	if ((target->open_mode & O_RWMASK) == O_RDONLY)
+		return B_FILE_ERROR;
+
+	if (offset >= size)
+		count = 0;
+	else
+		count = min_c((off_t)count, size - offset);
+
+	// The data is copied: file cache pages cannot be lent to the stack yet,
+	// as a truncation of the file would free them even if they are wired,
+	// while they might still be (re)transmitted.
+	SyscallRestartWrapper<ssize_t> result;
+	result = 0;
+
+	if (count > 0) {
+		off_t targetPos = target->pos;
+		result = copy_descriptor_data(descriptor.Get(), offset, target.Get(),
+			targetPos, count);
+		if (result > 0)
+			set_transfer_position(target.Get(), NULL, targetPos);
+	}
+
+	if (result >= 0
+		&& set_transfer_position(descriptor.Get(), userOffset, offset)
+			!= B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	return result;
+}
+
+
+ssize_t
+_user_splice(int fdIn, off_t* userOffsetIn, int fdOut, off_t* userOffsetOut,
+	size_t length, uint32 flags)
+{
+	if (length > SSIZE_MAX)
+		length = SSIZE_MAX;
+
+	FileDescriptorPutter in(get_fd(get_current_io_context(false), fdIn));
+	FileDescriptorPutter out(get_fd(get_current_io_context(false), fdOut));
+	if (!in.IsSet() || !out.IsSet())
+		return B_FILE_ERROR;
+	if ((in->open_mode & O_RWMASK) == O_WRONLY
+		|| (out->open_mode & O_RWMASK) == O_RDONLY) {
+		return B_FILE_ERROR;
+	}
+
+	// one end has to be a pipe
+	if (!is_file_type(in.Get(), S_IFIFO) && !is_file_type(out.Get(), S_IFIFO))
+		return B_BAD_VALUE;
+
+	off_t inPos;
+	off_t outPos;
+	status_t status = get_transfer_position(in.Get(), userOffsetIn, inPos);
+	if (status == B_OK)
+		status = get_transfer_position(out.Get(), userOffsetOut, outPos);
+	if (status != B_OK)
+		return status;
+
+	// The flags are only hints; pipes are ring buffers that always copy
+	// their data, so there are no pages that could be moved.
+	(void)flags;
+
+	SyscallRestartWrapper<ssize_t> result;
+	result = copy_descriptor_data(in.Get(), inPos, out.Get(), outPos, length);
+
+	if (result > 0
+		&& (set_transfer_position(in.Get(), userOffsetIn, inPos) != B_OK
+			|| set_transfer_position(out.Get(), userOffsetOut, outPos)
+				!= B_OK)) {
+		return B_BAD_ADDRESS;
+	}
+
+	return result;
+}
@@ -43,6 +43,7 @@
 #include <fd.h>
 #include <file_cache.h>
 #include <fs/node_monitor.h>
+#include <generic_syscall.h>
 #include <KPath.h>
 #include <lock.h>
 #include <low_resource_manager.h>
@@ -117,6 +118,10 @@ const static size_t kMaxPathLength = 65536;
 	// The absolute maximum path length (for getcwd() - this is not depending
 	// on PATH_MAX
 
+const static size_t kMaxReadDirStatBufferSize = 64 * 1024;
+	// limits the kernel buffers _user_read_dir_stat() allocates for both
+	// the dirents and the stat data
+
 
 typedef DoublyLinkedList<vnode> VnodeList;
 
@@ -1053,6 +1058,20 @@ free_vnode(struct vnode* vnode, bool reenter)
 static status_t
 dec_vnode_ref_count(struct vnode* vnode, bool alwaysFree, bool reenter)
 {
+	// Fast path: as long as we don't drop the last reference, the vnode's
+	// state doesn't change, so we don't need any locks.
+	int32 refCount = atomic_get(&vnode->ref_count);
+	while (refCount > 1) {
+		int32 previous = atomic_test_and_set(&vnode->ref_count, refCount - 1,
+			refCount);
+		if (previous == refCount) {
+			TRACE(("dec_vnode_ref_count: vnode %p, ref now %" B_PRId32 "\n",
+				vnode, refCount - 1));
+			return B_OK;
+		}
+		refCount = previous;
+	}
+
 	ReadLocker locker(sVnodeLock);
 	AutoLocker<Vnode> nodeLocker(vnode);
 
@@ -2114,6 +2133,118 @@ lookup_dir_entry(struct vnode* dir, const char* name, struct vnode** _vnode)
 }
 
 
+/*!	Optimistically resolves the leading directory components of \a path
+	using the entry cache only.
+
+	Instead of calling get_vnode() and put_vnode() for every component, which
+	each lock \c sVnodeLock, the entry cache hits are walked with \c sVnodeLock
+	read-locked just once. The walk stops at the first component that is not a
+	cached directory, at "." and "..", at mount points, at busy nodes, and
+	before the last component of the path; vnode_path_to_vnode() continues
+	from there the usual way. The file system's access() hook is called for
+	every directory passed through after the lock has been released.
+
+	\param vnode The vnode to start from. The caller holds a reference to it.
+		On return it is set to the directory the walk ended in.
+	\param path The path relative to \a vnode. On return it points to the
+		first component that has not been resolved. The buffer is left
+		unchanged.
+	\param _lastParentID Set to the ID of the parent directory of the vnode
+		returned in \a vnode, if the walk advanced at all.
+*/
+static void
+walk_cached_path(VnodePutter& vnode, char*& path, ino_t& _lastParentID)
+{
+	const int32 kMaxComponents = 8;
+	struct vnode* nodes[kMaxComponents + 1];
+	char* components[kMaxComponents + 1];
+	int32 count = 0;
+
+	nodes[0] = vnode.Get();
+	components[0] = path;
+
+	{
+		ReadLocker vnodeReadLocker(sVnodeLock);
+
+		char* component = path;
+		while (count < kMaxComponents) {
+			// only directories that aren't the last component are looked at
+			char* separator = strchr(component, '/');
+			if (separator == NULL)
+				break;
+
+			size_t length = separator - component;
+			if (length == 0 || length >= B_FILE_NAME_LENGTH
+				|| (component[0] == '.'
+					&& (length == 1 || (length == 2 && component[1] == '.')))) {
+				break;
+			}
+
+			char* end = separator;
+			while (*end == '/')
+				end++;
+			if (*end == '\0')
+				break;
+
+			struct vnode* dir = nodes[count];
+			if (!S_ISDIR(dir->Type()))
+				break;
+
+			// temporarily terminate the component for the lookup
+			ino_t id;
+			bool missing;
+			*separator = '\0';
+			bool found = dir->mount->entry_cache.Lookup(dir->id, component, id,
+				missing);
+			*separator = '/';
+			if (!found || missing)
+				break;
+
+			struct vnode* next = lookup_vnode(dir->device, id);
+			if (next == NULL)
+				break;
+
+			AutoLocker<Vnode> nodeLocker(next);
+			if (next->IsBusy() || next->IsCovered() || !S_ISDIR(next->Type()))
+				break;
+
+			if (next->ref_count == 0) {
+				// this vnode has been unused before
+				vnode_used(next);
+			}
+			inc_vnode_ref_count(next);
+
+			nodes[++count] = next;
+			components[count] = end;
+			component = end;
+		}
+	}
+
+	// check whether we're allowed to search the directories we passed through
+	int32 resolved = 0;
+	while (resolved < count) {
+		struct vnode* dir = nodes[resolved];
+		if (HAS_FS_CALL(dir, access) && FS_CALL(dir, access, X_OK) != B_OK)
+			break;
+		resolved++;
+	}
+
+	// put the nodes we don't need anymore
+	for (int32 i = resolved + 1; i <= count; i++)
+		put_vnode(nodes[i]);
+
+	if (resolved == 0)
+		return;
+
+	_lastParentID = nodes[resolved - 1]->id;
+	path = components[resolved];
+
+	for (int32 i = 1; i < resolved; i++)
+		put_vnode(nodes[i]);
+	vnode.SetTo(nodes[resolved]);
+}
+
+
 /*!	Returns the vnode for the relative \a path starting at the specified \a vnode.
 
 	\param[in,out] path The relative path being searched. Must not be NULL.
@@ -2150,6 +2281,10 @@ vnode_path_to_vnode(struct vnode* start, char* path, bool traverseLeafLink,
 
 	status_t status = B_OK;
 	ino_t lastParentID = vnode->id;
+
+	// resolve as much as we can from the entry cache
+	walk_cached_path(vnode, path, lastParentID);
+
 	while (true) {
 		char* nextPath;
 
@@ -3014,6 +3149,12 @@ _dump_mount(struct fs_mount* mount)
 	kprintf(" flags:        %s%s\n", mount->unmounting ? " unmounting" : "",
 		mount->owns_file_device ? " owns_file_device" : "");
 
+	entry_cache_statistics statistics;
+	mount->entry_cache.GetStatistics(statistics);
+	kprintf(" entry cache:   %" B_PRId32 " entries, %" B_PRId64 " hits, %"
+		B_PRId64 " negative hits, %" B_PRId64 " misses\n", statistics.entries,
+		statistics.hits, statistics.negative_hits, statistics.misses);
+
 	fs_volume* volume = mount->volume;
 	while (volume != NULL) {
 		kprintf(" volume %p:\n", volume);
@@ -3421,9 +3562,69 @@ dump_vnode_usage(int argc, char** argv)
 	return 0;
 }
 
+
+static int
+dump_entry_caches(int argc, char** argv)
+{
+	if (argc != 1) {
+		kprintf("usage: %s\n", argv[0]);
+		return 0;
+	}
+
+	kprintf("   id    entries         hits    neg. hits       misses   fs_name\n");
+
+	entry_cache_statistics total;
+	memset(&total, 0, sizeof(total));
+
+	MountTable::Iterator iterator(sMountsTable);
+	while (iterator.HasNext()) {
+		struct fs_mount* mount = iterator.Next();
+
+		entry_cache_statistics statistics;
+		mount->entry_cache.GetStatistics(statistics);
+		kprintf("%5" B_PRIdDEV " %10" B_PRId32 " %12" B_PRId64 " %12" B_PRId64
+			" %12" B_PRId64 "   %s\n", mount->id, statistics.entries,
+			statistics.hits, statistics.negative_hits, statistics.misses,
+			mount->volume->file_system_name);
+
+		total.entries += statistics.entries;
+		total.hits += statistics.hits;
+		total.negative_hits += statistics.negative_hits;
+		total.misses += statistics.misses;
+		total.max_entries = statistics.max_entries;
+	}
+
+	kprintf("total %10" B_PRId32 " %12" B_PRId64 " %12" B_PRId64 " %12" B_PRId64
+		"   (max %" B_PRId32 " entries)\n", total.entries, total.hits,
+		total.negative_hits, total.misses, total.max_entries);
+	return 0;
+}
+
 #endif	// ADD_DEBUGGER_COMMANDS
 
 
+static status_t
+entry_cache_control(const char* subsystem, uint32 function, void* buffer,
+	size_t bufferSize)
+{
+	switch (function) {
+		case ENTRY_CACHE_GET_STATISTICS:
+		{
+			if (bufferSize < sizeof(entry_cache_statistics))
+				return B_BAD_VALUE;
+			if (!IS_USER_ADDRESS(buffer))
+				return B_BAD_ADDRESS;
+
+			entry_cache_statistics statistics;
+			EntryCache::GetGlobalStatistics(statistics);
+			return user_memcpy(buffer, &statistics, sizeof(statistics));
+		}
+	}
+
+	return B_BAD_HANDLER;
+}
+
+
 /*!	Clears memory specified by an iovec array.
 */
 static void
@@ -5332,8 +5533,12 @@ vfs_init(kernel_args* args)
 		"info about the I/O context");
 	add_debugger_command("vnode_usage", &dump_vnode_usage,
 		"info about vnode usage");
+	add_debugger_command("entry_caches", &dump_entry_caches,
+		"list the entry cache statistics of all mounts");
 #endif
 
+	register_generic_syscall(ENTRY_CACHE_SYSCALLS, &entry_cache_control, 1, 0);
+
 	register_low_resource_handler(&vnode_low_resource_handler, NULL,
 		B_KERNEL_RESOURCE_PAGES | B_KERNEL_RESOURCE_MEMORY
 			| B_KERNEL_RESOURCE_ADDRESS_SPACE,
@@ -6736,6 +6941,53 @@ common_path_write_stat(int fd, char* path, bool traverseLeafLink,
 }
 
 
+/*!	Reads the next entries of the directory or query referred to by \a fd
+	into \a buffer, and fills in \a stats with the stat data of the node each
+	of them refers to.
+	Entries whose node could not be stat()ed (because they were removed in the
+	meantime, for example) get a zeroed stat; their \c st_mode is \c 0.
+	\a stats must have room for \a maxCount entries.
+*/
+static ssize_t
+common_read_dir_stat(int fd, struct dirent* buffer, size_t bufferSize,
+	uint32 maxCount, struct stat* stats, bool kernel)
+{
+	FUNCTION(("common_read_dir_stat: fd: %d, buffer %p, bufferSize %ld, "
+		"maxCount %" B_PRIu32 ", kernel %d\n", fd, buffer, bufferSize,
+		maxCount, kernel));
+
+	io_context* ioContext = get_current_io_context(kernel);
+	FileDescriptorPutter descriptor(get_fd(ioContext, fd));
+	if (!descriptor.IsSet())
+		return B_FILE_ERROR;
+
+	// only entries of directories and queries refer to nodes we can stat
+	if (descriptor->ops != &sDirectoryOps && descriptor->ops != &sQueryOps)
+		return B_BAD_VALUE;
+
+	uint32 count = maxCount;
+	status_t status = descriptor->ops->fd_read_dir(ioContext,
+		descriptor.Get(), buffer, bufferSize, &count);
+	if (status != B_OK)
+		return status;
+
+	// The FD is only needed for reading the entries. We also don't want to
+	// hold a reference to it while calling into the file system for every
+	// single entry.
+	descriptor.Unset();
+
+	struct dirent* entry = buffer;
+	for (uint32 i = 0; i < count; i++) {
+		if (vfs_stat_node_ref(entry->d_dev, entry->d_ino, &stats[i]) != B_OK)
+			memset(&stats[i], 0, sizeof(struct stat));
+
+		entry = (struct dirent*)((uint8*)entry + entry->d_reclen);
+	}
+
+	return count;
+}
+
+
 static int
 attr_dir_open(int fd, char* path, bool traverseLeafLink, bool kernel)
 {
@@ -8673,6 +8925,52 @@ _kern_read_stat(int fd, const char* path, bool traverseLeafLink,
 }
 
 
+/*!	\brief Reads the next entries of a directory or query along with the stat
+	data of the nodes they refer to.
+
+	This saves the caller a read_stat() call (and a path resolution) per
+	entry when listing a directory.
+
+	\param fd The directory or query FD.
+	\param buffer The buffer the dirents shall be written into.
+	\param bufferSize The size of \a buffer.
+	\param maxCount The maximum number of entries to be read.
+	\param stats An array of at least \a maxCount stat buffers, each
+		   \a statSize bytes in size.
+	\param statSize The size of a single stat buffer.
+	\return The number of entries read, \c 0 at the end of the directory, or
+			an error code. Entries whose node could not be stat()ed have an
+			\c st_mode of \c 0.
+*/
+ssize_t
+_kern_read_dir_stat(int fd, struct dirent* buffer, size_t bufferSize,
+	uint32 maxCount, struct stat* stats, size_t statSize)
+{
+	if (statSize == 0 || statSize > sizeof(struct stat))
+		return B_BAD_VALUE;
+
+	if (maxCount == 0)
+		return 0;
+
+	if (statSize == sizeof(struct stat)) {
+		return common_read_dir_stat(fd, buffer, bufferSize, maxCount, stats,
+			true);
+	}
+
+	// this supports different stat extensions
+	BStackOrHeapArray<struct stat, 8> completeStats(maxCount);
+	if (!completeStats.IsValid())
+		return B_NO_MEMORY;
+
+	ssize_t count = common_read_dir_stat(fd, buffer, bufferSize, maxCount,
+		completeStats, true);
+	for (ssize_t i = 0; i < count; i++)
+		memcpy((uint8*)stats + i * statSize, &completeStats[i], statSize);
+
+	return count;
+}
+
+
 /*!	\brief Writes stat data of an entity specified by a FD + path pair.
 
 	If only \a fd is given, the stat operation associated with the type
@@ -9699,6 +9997,69 @@ _user_read_stat(int fd, const char* userPath, bool traverseLink,
 }
 
 
+ssize_t
+_user_read_dir_stat(int fd, struct dirent* userBuffer, size_t bufferSize,
+	uint32 maxCount, struct stat* userStats, size_t statSize)
+{
+	if (statSize == 0 || statSize > sizeof(struct stat))
+		return B_BAD_VALUE;
+
+	if (maxCount == 0)
+		return 0;
+
+	if (userBuffer == NULL || !IS_USER_ADDRESS(userBuffer)
+		|| userStats == NULL || !IS_USER_ADDRESS(userStats))
+		return B_BAD_ADDRESS;
+
+	// restrict the buffer sizes and allocate heap buffers
+	if (bufferSize > kMaxReadDirStatBufferSize)
+		bufferSize = kMaxReadDirStatBufferSize;
+	if (maxCount > kMaxReadDirStatBufferSize / sizeof(struct stat))
+		maxCount = kMaxReadDirStatBufferSize / sizeof(struct stat);
+
+	struct dirent* buffer = (struct dirent*)malloc(bufferSize);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter bufferDeleter(buffer);
+
+	struct stat* stats = (struct stat*)malloc(maxCount * sizeof(struct stat));
+	if (stats == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter statsDeleter(stats);
+
+	ssize_t count = common_read_dir_stat(fd, buffer, bufferSize, maxCount,
+		stats, false);
+	if (count <= 0)
+		return count;
+
+	// copy the entries back -- determine their total size first
+	size_t sizeToCopy = 0;
+	struct dirent* entry = buffer;
+	for (ssize_t i = 0; i < count; i++) {
+		sizeToCopy += entry->d_reclen;
+		entry = (struct dirent*)((uint8*)entry + entry->d_reclen);
+	}
+
+	if (user_memcpy(userBuffer, buffer, sizeToCopy) != B_OK)
+		return B_BAD_ADDRESS;
+
+	// this supports different stat extensions
+	if (statSize == sizeof(struct stat)) {
+		if (user_memcpy(userStats, stats, count * statSize) != B_OK)
+			return B_BAD_ADDRESS;
+	} else {
+		for (ssize_t i = 0; i < count; i++) {
+			if (user_memcpy((uint8*)userStats + i * statSize, &stats[i],
+					statSize) != B_OK) {
+				return B_BAD_ADDRESS;
+			}
+		}
+	}
+
+	return count;
+}
+
+
 status_t
 _user_write_stat(int fd, const char* userPath, bool traverseLeafLink,
 	const struct stat* userStat, size_t statSize, int statMask)
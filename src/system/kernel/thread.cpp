@@ -2712,6 +2712,33 @@ thread_set_io_priority(int32 priority)
 }
 
 
+/*!	Restricts the thread with the given \a id to the CPUs in \a mask. */
+status_t
+thread_set_cpu_mask(thread_id id, const CPUSet& mask)
+{
+	CPUSet cpus;
+	cpus.SetAll();
+	for (int i = 0; i < smp_get_num_cpus(); i++)
+		cpus.ClearBit(i);
+	if (mask.Matches(cpus))
+		return B_BAD_VALUE;
+
+	// get the thread
+	Thread* thread = Thread::GetAndLock(id);
+	if (thread == NULL)
+		return B_BAD_THREAD_ID;
+	BReference<Thread> threadReference(thread, true);
+	ThreadLocker threadLocker(thread, true);
+	memcpy(&thread->cpumask, &mask, sizeof(mask));
+
+	// check if running on masked cpu
+	if (thread->cpu != NULL && !thread->cpumask.GetBit(thread->cpu->cpu_num))
+		thread_yield();
+
+	return B_OK;
+}
+
+
 status_t
 thread_init(kernel_args *args)
 {
@@ -3968,27 +3995,8 @@ _user_set_thread_affinity(thread_id id, const void* userMask, size_t size)
 	if (user_memcpy(&mask, userMask, min_c(sizeof(CPUSet), size)) < B_OK)
 		return B_BAD_ADDRESS;
 
-	CPUSet cpus;
-	cpus.SetAll();
-	for (int i = 0; i < smp_get_num_cpus(); i++)
-		cpus.ClearBit(i);
-	if (mask.Matches(cpus))
-		return B_BAD_VALUE;
-
 	if (id == 0)
 		id = thread_get_current_thread_id();
 
-	// get the thread
-	Thread* thread = Thread::GetAndLock(id);
-	if (thread == NULL)
-		return B_BAD_THREAD_ID;
-	BReference<Thread> threadReference(thread, true);
-	ThreadLocker threadLocker(thread, true);
-	memcpy(&thread->cpumask, &mask, sizeof(mask));
-
-	// check if running on masked cpu
-	if (!thread->cpumask.GetBit(thread->cpu->cpu_num))
-		thread_yield();
-
-	return B_OK;
+	return thread_set_cpu_mask(id, mask);
 }
@@ -2363,12 +2363,26 @@ area_id
 vm_map_file(team_id aid, const char* name, void** address, uint32 addressSpec,
 	addr_t size, uint32 protection, uint32 mapping, bool unmapAddressRange,
 	int fd, off_t offset)
+{
+	return vm_map_file_etc(aid, name, address, addressSpec, size, protection,
+		mapping, unmapAddressRange, fd, offset, true);
+}
+
+
+/*!	Like vm_map_file(), but \a kernel specifies whether \a fd belongs to the
+	kernel's or to the current team's I/O context. This allows the kernel to
+	map a file a userland FD refers to into its own address space.
+*/
+area_id
+vm_map_file_etc(team_id aid, const char* name, void** address,
+	uint32 addressSpec, addr_t size, uint32 protection, uint32 mapping,
+	bool unmapAddressRange, int fd, off_t offset, bool kernel)
 {
 	if (!arch_vm_supports_protection(protection))
 		return B_NOT_SUPPORTED;
 
 	return _vm_map_file(aid, name, address, addressSpec, size, protection,
-		mapping, unmapAddressRange, fd, offset, true);
+		mapping, unmapAddressRange, fd, offset, kernel);
 }
 
 
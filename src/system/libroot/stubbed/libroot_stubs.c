@@ -1230,6 +1230,7 @@ void _kern_process_info() {}
 void _kern_read() {}
 void _kern_read_attr() {}
 void _kern_read_dir() {}
+void _kern_read_dir_stat() {}
 void _kern_read_fs_info() {}
 void _kern_read_index_stat() {}
 void _kern_read_kernel_image_symbols() {}
@@ -1246,6 +1247,7 @@ void _kern_realtime_sem_wait() {}
 void _kern_receive_data() {}
 void _kern_recv() {}
 void _kern_recvfrom() {}
+void _kern_recvmmsg() {}
 void _kern_recvmsg() {}
 void _kern_register_file_device() {}
 void _kern_register_image() {}
@@ -1272,6 +1274,8 @@ void _kern_select() {}
 void _kern_send() {}
 void _kern_send_data() {}
 void _kern_send_signal() {}
+void _kern_sendfile() {}
+void _kern_sendmmsg() {}
 void _kern_sendmsg() {}
 void _kern_sendto() {}
 void _kern_set_area_protection() {}
@@ -1314,6 +1318,7 @@ void _kern_sockatmark() {}
 void _kern_socket() {}
 void _kern_socketpair() {}
 void _kern_spawn_thread() {}
+void _kern_splice() {}
 void _kern_start_watching() {}
 void _kern_start_watching_disks() {}
 void _kern_start_watching_system() {}
@@ -9,45 +9,38 @@
 
 #include "BeaconSearcher.h"
 
-#include <cstring>
+#include <algorithm>
 
 #include <Alert.h>
 #include <VolumeRoster.h>
 
+#include "FullTextQuery.h"
 #include "IndexServerPrivate.h"
-
-
-using namespace lucene::document ;
-using namespace lucene::search ;
-using namespace lucene::index ;
-using namespace lucene::queryParser ;
+#include "InvertedIndex.h"
 
 
 BeaconSearcher::BeaconSearcher()
+	:
+	fNextHit(0)
 {
 	BVolumeRoster volumeRoster ;
 	BVolume volume ;
-	IndexSearcher *indexSearcher ;
 
 	while(volumeRoster.GetNextVolume(&volume) == B_OK) {
 		BPath indexPath = GetIndexPath(&volume);
-		if(IndexReader::indexExists(indexPath.Path())) {
-			indexSearcher = new IndexSearcher(indexPath.Path());
-			fSearcherList.AddItem(indexSearcher);
-		}
+		InvertedIndex* index = new InvertedIndex(indexPath.Path());
+		if (index->Open(false) == B_OK)
+			fIndexList.AddItem(index);
+		else
+			delete index;
 	}
 }
 
 
 BeaconSearcher::~BeaconSearcher()
 {
-	IndexSearcher *indexSearcher;
-	while(fSearcherList.CountItems() > 0) {
-		indexSearcher = (IndexSearcher*)fSearcherList.ItemAt(0);
-		indexSearcher->close();
-		delete indexSearcher;
-		fSearcherList.RemoveItem((int32)0);
-	}
+	for (int32 i = 0; i < fIndexList.CountItems(); i++)
+		delete (InvertedIndex*)fIndexList.ItemAt(i);
 }
 
 
@@ -67,59 +60,33 @@ BeaconSearcher::GetIndexPath(BVolume *volume)
 void
 BeaconSearcher::Search(const char* stringQuery)
 {
-	// CLucene expects wide characters everywhere.
-	int size = strlen(stringQuery) * sizeof(wchar_t) ;
-	wchar_t *wStringQuery = new wchar_t[size] ;
-	if (mbstowcs(wStringQuery, stringQuery, size) == -1)
-		return ;
-
-	IndexSearcher *indexSearcher ;
-	Hits *hits ;
-	Query *luceneQuery ;
-	Document doc ;
-	Field *field ;
-	wchar_t *path ;
-	
-	/*
-	luceneQuery = QueryParser::parse(wStringQuery, _T("contents"),
-		&fStandardAnalyzer) ;
-
-	hits = fMultiSearcher->search(luceneQuery) ;
-	for(int j = 0 ; j < hits->length() ; j++) {
-		doc = hits->doc(j) ;
-		field = doc.getField(_T("path")) ;
-		path = new wchar_t[B_PATH_NAME_LENGTH * sizeof(wchar_t)] ;
-		wcscpy(path, field->stringValue()) ;
-		fHits.AddItem(path) ;
-	}*/
-	
-	for(int i = 0 ; (indexSearcher = (IndexSearcher*)fSearcherList.ItemAt(i))
+	fHits.clear();
+	fNextHit = 0;
+
+	InvertedIndex* index;
+	for(int i = 0 ; (index = (InvertedIndex*)fIndexList.ItemAt(i))
 		!= NULL ; i++) {
-		luceneQuery = QueryParser::parse(wStringQuery, _T("contents"),
-			&fStandardAnalyzer) ;
-
-		hits = indexSearcher->search(luceneQuery) ;
-
-		for(int j = 0 ; j < hits->length() ; j++) {
-			doc = hits->doc(j) ;
-			field = doc.getField(_T("path")) ;
-			path = new wchar_t[B_PATH_NAME_LENGTH * sizeof(wchar_t)] ;
-			wcscpy(path, field->stringValue()) ;
-			fHits.AddItem(path) ;
-		}
+		FullTextQuery query;
+		query.SetIndex(index);
+		if (query.SetPredicate(stringQuery) != B_OK || query.Fetch() != B_OK)
+			continue;
+
+		Hit hit;
+		while (query.GetNextHit(hit.path, &hit.score) == B_OK)
+			fHits.push_back(hit);
 	}
+
+	// the scores of the different volumes are comparable enough
+	std::stable_sort(fHits.begin(), fHits.end());
 }
 
 
-wchar_t*
-BeaconSearcher::GetNextHit()
+bool
+BeaconSearcher::GetNextHit(BString& path)
 {
-	if(fHits.CountItems() != 0) {
-		wchar_t* path = (wchar_t*)fHits.ItemAt(0) ;
-		fHits.RemoveItem((int32)0) ;
-		return path ;
-	}
-	
-	return NULL ;
-}
+	if (fNextHit >= fHits.size())
+		return false;
 
+	path = fHits[fNextHit++].path;
+	return true;
+}
@@ -9,33 +9,36 @@
 #ifndef _BEACON_SEARCHER_H_
 #define _BEACON_SEARCHER_H_
 
-#include <CLucene.h>
+#include <vector>
 
 #include <Directory.h>
 #include <List.h>
 #include <Path.h>
+#include <String.h>
 #include <Volume.h>
 
-// #include <CLucene/search/MultiSearcher.h>
-using namespace lucene::analysis::standard ;
-// using namespace lucene::search ;
-
 
 class BeaconSearcher {
 	public:
 							BeaconSearcher() ;
 							~BeaconSearcher() ;
-		wchar_t*			GetNextHit() ;
+		bool				GetNextHit(BString& path) ;
 		void				Search(const char* query) ;
 	
 	private:
+		struct Hit {
+			BString			path;
+			float			score;
+
+			bool operator<(const Hit& other) const
+				{ return score > other.score; }
+		};
+
 		BPath				GetIndexPath(BVolume *volume);
 
-		BList				fSearcherList;
-		BList				fHits;
-		StandardAnalyzer	fStandardAnalyzer;
-//		MultiSearcher		*fMultiSearcher ;
+		BList				fIndexList;
+		std::vector<Hit>	fHits;
+		uint32				fNextHit;
 } ;
 
 #endif /* _BEACON_SEARCHER_H_ */
-
@@ -74,13 +74,9 @@ SearchWindow::_Search()
 	fSearchResults->MakeEmpty();
 	BeaconSearcher searcher;
 	searcher.Search(fSearchField->Text());
-	wchar_t *wPath;
-	char *path;
-	while((wPath = searcher.GetNextHit()) != NULL) {
-		path = new char[wcslen(wPath)*sizeof(wchar_t)];
-		wcstombs(path, wPath, wcslen(wPath)*sizeof(wchar_t));
+	BString path;
+	while (searcher.GetNextHit(path))
 		fSearchResults->AddItem(new BStringItem(path));
-	}
 }
 
 
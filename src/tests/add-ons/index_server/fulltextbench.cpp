@@ -0,0 +1,293 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Full-text index benchmark.
+ *
+ * Indexes a synthetic corpus -- documents made of words drawn from a Zipf
+ * distributed vocabulary, like natural language text -- with the fulltext
+ * add-on's InvertedIndex, and measures how fast single term, all-terms and
+ * any-term queries are answered on the resulting read-only index.
+ */
+
+#include <dirent.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <OS.h>
+
+#include "FullTextQuery.h"
+#include "InvertedIndex.h"
+
+
+static const int32 kVocabularySize = 50000;
+static const int32 kCommitInterval = 10000;
+
+
+static std::vector<std::string> sVocabulary;
+static std::vector<double> sDistribution;
+static uint32 sSeed = 42;
+
+
+static void
+usage()
+{
+	printf("fulltextbench [-n documents] [-l length] [-q queries] [-k] "
+		"<directory>\n"
+		"  -n  the number of documents to index (default: 1000000)\n"
+		"  -l  the average number of words per document (default: 100)\n"
+		"  -q  the number of queries per query type (default: 1000)\n"
+		"  -k  keep the index\n");
+	exit(1);
+}
+
+
+static uint32
+random_number()
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return sSeed >> 8;
+}
+
+
+static void
+create_vocabulary()
+{
+	static const char* kSyllables[] = {
+		"ka", "to", "ri", "me", "su", "na", "lo", "pe", "di", "gu", "ba", "ve",
+		"xo", "qui", "zan", "tor"
+	};
+	static const int32 kSyllableCount
+		= sizeof(kSyllables) / sizeof(kSyllables[0]);
+
+	double sum = 0;
+	for (int32 i = 0; i < kVocabularySize; i++) {
+		std::string word;
+		int32 value = i;
+		do {
+			word += kSyllables[value % kSyllableCount];
+			value /= kSyllableCount;
+		} while (value > 0);
+
+		sVocabulary.push_back(word);
+		sum += 1.0 / (i + 1);
+		sDistribution.push_back(sum);
+	}
+
+	for (int32 i = 0; i < kVocabularySize; i++)
+		sDistribution[i] /= sum;
+}
+
+
+static int32
+random_word()
+{
+	double value = (random_number() % 1000000) / 1000000.0;
+	return std::lower_bound(sDistribution.begin(), sDistribution.end(), value)
+		- sDistribution.begin();
+}
+
+
+static void
+create_document(std::string& text, int32 averageLength)
+{
+	text.clear();
+
+	int32 length = averageLength / 2 + random_number() % (averageLength + 1);
+	for (int32 i = 0; i < length; i++) {
+		text += sVocabulary[random_word()];
+		text += i % 12 == 11 ? ". " : " ";
+	}
+}
+
+
+static off_t
+directory_size(const char* path)
+{
+	DIR* dir = opendir(path);
+	if (dir == NULL)
+		return 0;
+
+	off_t size = 0;
+	while (dirent* entry = readdir(dir)) {
+		std::string file = std::string(path) + "/" + entry->d_name;
+		struct stat st;
+		if (stat(file.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+			size += st.st_size;
+	}
+
+	closedir(dir);
+	return size;
+}
+
+
+static void
+remove_index(const char* path)
+{
+	DIR* dir = opendir(path);
+	if (dir == NULL)
+		return;
+
+	while (dirent* entry = readdir(dir)) {
+		std::string file = std::string(path) + "/" + entry->d_name;
+		unlink(file.c_str());
+	}
+
+	closedir(dir);
+	rmdir(path);
+}
+
+
+static void
+index_documents(const char* path, int32 count, int32 averageLength)
+{
+	InvertedIndex index(path);
+	status_t status = index.Open(true);
+	if (status != B_OK) {
+		fprintf(stderr, "fulltextbench: could not create the index in \"%s\": "
+			"%s\n", path, strerror(status));
+		exit(1);
+	}
+
+	std::string text;
+	uint64 bytes = 0;
+	bigtime_t generating = 0;
+	bigtime_t start = system_time();
+
+	for (int32 i = 0; i < count; i++) {
+		bigtime_t generationStart = system_time();
+		create_document(text, averageLength);
+		generating += system_time() - generationStart;
+		bytes += text.size();
+
+		char documentPath[B_PATH_NAME_LENGTH];
+		snprintf(documentPath, sizeof(documentPath),
+			"/boot/home/mail/%04" B_PRId32 "/mail%" B_PRId32, i / 1000, i);
+
+		status = index.AddDocument(documentPath, text.c_str(), text.size());
+		if (status == B_OK && (i + 1) % kCommitInterval == 0)
+			status = index.Commit();
+		if (status != B_OK) {
+			fprintf(stderr, "fulltextbench: indexing failed: %s\n",
+				strerror(status));
+			exit(1);
+		}
+	}
+
+	status = index.Commit();
+	if (status != B_OK) {
+		fprintf(stderr, "fulltextbench: commit failed: %s\n",
+			strerror(status));
+		exit(1);
+	}
+
+	bigtime_t time = system_time() - start - generating;
+	printf("indexed %" B_PRId32 " documents (%.1f MB) in %.3f s: "
+		"%.0f documents/s, %.2f MB/s\n", count, bytes / 1048576.0,
+		time / 1000000.0, count * 1000000.0 / time,
+		bytes / 1.048576 / time);
+
+	index.Lock();
+	printf("%" B_PRId32 " segments, index size %.1f MB\n",
+		index.CountSegments(), directory_size(path) / 1048576.0);
+	index.Unlock();
+}
+
+
+static void
+run_queries(InvertedIndex& index, const char* name, int32 count,
+	int32 termCount, bool matchAll, int32 firstWord, int32 wordRange)
+{
+	int64 hits = 0;
+	bigtime_t start = system_time();
+
+	for (int32 i = 0; i < count; i++) {
+		std::string predicate;
+		for (int32 term = 0; term < termCount; term++) {
+			predicate += sVocabulary[firstWord + random_number() % wordRange];
+			predicate += " ";
+		}
+
+		FullTextQuery query;
+		query.SetIndex(&index);
+		query.SetPredicate(predicate.c_str());
+		query.SetMatchAll(matchAll);
+		query.SetMaxHits(20);
+		if (query.Fetch() == B_OK)
+			hits += query.CountHits();
+	}
+
+	bigtime_t time = system_time() - start;
+	printf("%-36s %10.1f queries/s, %5.1f hits/query\n", name,
+		count * 1000000.0 / time, (double)hits / count);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 count = 1000000;
+	int32 averageLength = 100;
+	int32 queries = 1000;
+	bool keep = false;
+	int c;
+
+	while ((c = getopt(argc, argv, "hkl:n:q:")) != -1) {
+		switch (c) {
+			case 'k':
+				keep = true;
+				break;
+			case 'l':
+				averageLength = atoi(optarg);
+				break;
+			case 'n':
+				count = atoi(optarg);
+				break;
+			case 'q':
+				queries = atoi(optarg);
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (optind >= argc || count < 1 || averageLength < 1 || queries < 1)
+		usage();
+
+	std::string path = std::string(argv[optind]) + "/fulltextbench-index";
+
+	create_vocabulary();
+	index_documents(path.c_str(), count, averageLength);
+
+	// query a fresh, read-only mapping of the index, as a search would
+	InvertedIndex index(path.c_str());
+	status_t status = index.Open(false);
+	if (status != B_OK) {
+		fprintf(stderr, "fulltextbench: could not open the index: %s\n",
+			strerror(status));
+		return 1;
+	}
+
+	run_queries(index, "common term", queries, 1, true, 0, 100);
+	run_queries(index, "rare term", queries, 1, true, 10000, 40000);
+	run_queries(index, "two common terms, all", queries, 2, true, 0, 100);
+	run_queries(index, "common and rare term, all", queries, 2, true, 0,
+		kVocabularySize);
+	run_queries(index, "three terms, any", queries, 3, false, 0,
+		kVocabularySize);
+
+	if (!keep)
+		remove_index(path.c_str());
+
+	return 0;
+}
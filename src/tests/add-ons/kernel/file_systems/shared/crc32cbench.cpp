@@ -0,0 +1,104 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*!	Compares the CRC-32C implementation the file systems use with the
+	portable table based one, both for correctness and for throughput.
+
+	calculate_crc32c() uses the crc32 instruction when the CPU supports it;
+	on other CPUs, both columns should show about the same numbers.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include "CRCTable.h"
+
+
+static const size_t kMaxSize = 1024 * 1024;
+static const size_t kSizes[] = { 16, 64, 256, 512, 4096, 16384, 65536,
+	kMaxSize };
+static const size_t kTotalBytes = 256 * 1024 * 1024;
+
+
+typedef uint32 (*crc32c_function)(uint32 crc32c, const unsigned char* buffer,
+	unsigned int length);
+
+
+static double
+measure(crc32c_function function, const uint8* buffer, size_t size)
+{
+	size_t runs = kTotalBytes / size;
+	uint32 crc = 0;
+
+	bigtime_t start = system_time();
+	for (size_t i = 0; i < runs; i++)
+		crc = function(crc, buffer, size);
+	bigtime_t time = system_time() - start;
+
+	// make sure the result is used
+	if (crc == 0x12345678)
+		putchar(' ');
+
+	return (double)runs * size / 1.048576 / (time > 0 ? time : 1);
+}
+
+
+static bool
+verify(const uint8* buffer)
+{
+	// the check value of CRC-32C
+	uint32 crc = ~calculate_crc32c(~0U, (const uint8*)"123456789", 9);
+	if (crc != 0xe3069283) {
+		fprintf(stderr, "crc32cbench: check value is %#" B_PRIx32 "\n", crc);
+		return false;
+	}
+
+	for (int32 i = 0; i < 10000; i++) {
+		size_t offset = rand() % 64;
+		size_t length = i < 1000 ? i : rand() % (kMaxSize - 64);
+		uint32 seed = rand();
+
+		uint32 expected = calculate_crc32c_portable(seed, buffer + offset,
+			length);
+		uint32 result = calculate_crc32c(seed, buffer + offset, length);
+		if (result != expected) {
+			fprintf(stderr, "crc32cbench: mismatch at offset %zu, length "
+				"%zu: %#" B_PRIx32 " instead of %#" B_PRIx32 "\n", offset,
+				length, result, expected);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	uint8* buffer = (uint8*)malloc(kMaxSize);
+	if (buffer == NULL)
+		return 1;
+
+	srand(system_time());
+	for (size_t i = 0; i < kMaxSize; i++)
+		buffer[i] = rand();
+
+	if (!verify(buffer))
+		return 1;
+
+	printf("%10s %16s %16s\n", "size", "crc32c (MB/s)", "portable (MB/s)");
+	for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); i++) {
+		printf("%10zu %16.1f %16.1f\n", kSizes[i],
+			measure(calculate_crc32c, buffer, kSizes[i]),
+			measure(calculate_crc32c_portable, buffer, kSizes[i]));
+	}
+
+	free(buffer);
+	return 0;
+}
@@ -3,6 +3,7 @@
  * Distributed under the terms of the MIT License.
  */
 
+#include <stdarg.h>
 #include <stdio.h>
 
 #define DEBUG_QUERY
@@ -14,25 +15,228 @@
 #include <file_systems/QueryParser.h>
 
 
-class Entry;
+/*!	Without arguments, the test runs queries against an in-memory volume
+	whose indices return real node IDs, and compares their results with
+	matching every node of the volume against the query one by one.
+	Otherwise, it only parses the queries given on the command line.
+*/
+
+
+#define TEST_ASSERT(statement) \
+	if (!(statement)) { \
+		error(__LINE__, "Assertion failed: " #statement); \
+	}
+
+
+using QueryParser::Expression;
+using QueryParser::NodeIDSet;
+using QueryParser::Term;
+
+
+/*!	A node of the test volume. Its attributes are derived from its ID:
+	"a" is the ID itself, "b" is the ID modulo 7, "c" is a string made from
+	the ID modulo 100, and "d" is the ID modulo 3. All but "d" are indexed,
+	as is the name.
+*/
+struct Entry {
+	ino_t	id;
+	char	name[16];
+	int32	a;
+	int32	b;
+	char	c[8];
+	int32	d;
+};
+
+
+struct Index;
+
+
+class Volume {
+public:
+								Volume(int32 count);
+								~Volume();
+
+			int32				CountEntries() const { return fCount; }
+			Entry*				EntryAt(int32 index) const
+									{ return &fEntries[index]; }
+
+			Index*				FindIndex(const char* attribute);
+
+			void				EntryLoaded() { fLoadedEntries++; }
+			int32				LoadedEntries() const { return fLoadedEntries; }
+			void				ResetLoadedEntries() { fLoadedEntries = 0; }
+
+private:
+			Entry*				fEntries;
+			int32				fCount;
+			Index*				fIndices;
+			int32				fIndexCount;
+			int32				fLoadedEntries;
+};
+
+
+/*!	An index is just an array of all entries, sorted by their key for the
+	attribute of the index.
+*/
+struct Index {
+	const char*	attribute;
+	type_code	type;
+	Entry**		entries;
+	int32		count;
+};
+
+
+static const void*
+get_attribute(const Entry* entry, const char* attribute, size_t* _length,
+	type_code* _type)
+{
+	if (strcmp(attribute, "name") == 0 || strcmp(attribute, "c") == 0) {
+		const char* string = attribute[0] == 'n' ? entry->name : entry->c;
+		*_length = strlen(string);
+		*_type = B_STRING_TYPE;
+		return string;
+	}
+
+	const int32* value;
+	if (strcmp(attribute, "a") == 0)
+		value = &entry->a;
+	else if (strcmp(attribute, "b") == 0)
+		value = &entry->b;
+	else if (strcmp(attribute, "d") == 0)
+		value = &entry->d;
+	else
+		return NULL;
+
+	*_length = sizeof(int32);
+	*_type = B_INT32_TYPE;
+	return value;
+}
+
+
+static int
+compare_entries(const Index& index, const Entry* first, const Entry* second)
+{
+	size_t firstLength;
+	size_t secondLength;
+	type_code type;
+	const void* firstKey = get_attribute(first, index.attribute, &firstLength,
+		&type);
+	const void* secondKey = get_attribute(second, index.attribute,
+		&secondLength, &type);
+
+	int compare = QueryParser::compareKeys(index.type, firstKey, firstLength,
+		secondKey, secondLength);
+	if (compare != 0)
+		return compare;
+
+	return first->id < second->id ? -1 : (first->id > second->id ? 1 : 0);
+}
+
+
+struct EntryLess {
+	EntryLess(const Index& index)
+		:
+		fIndex(index)
+	{
+	}
+
+	bool operator()(const Entry* first, const Entry* second) const
+	{
+		return compare_entries(fIndex, first, second) < 0;
+	}
+
+	const Index& fIndex;
+};
+
+
+Volume::Volume(int32 count)
+	:
+	fCount(count),
+	fIndexCount(0),
+	fLoadedEntries(0)
+{
+	fEntries = new Entry[count];
+	for (int32 i = 0; i < count; i++) {
+		Entry& entry = fEntries[i];
+		entry.id = i + 1;
+		snprintf(entry.name, sizeof(entry.name), "file%" B_PRId32, i + 1);
+		entry.a = i + 1;
+		entry.b = (i + 1) % 7;
+		snprintf(entry.c, sizeof(entry.c), "c%" B_PRId32, (i + 1) % 100);
+		entry.d = (i + 1) % 3;
+	}
+
+	static const struct {
+		const char*	attribute;
+		type_code	type;
+	} kIndices[] = {
+		{"name", B_STRING_TYPE},
+		{"a", B_INT32_TYPE},
+		{"b", B_INT32_TYPE},
+		{"c", B_STRING_TYPE},
+	};
+
+	fIndexCount = B_COUNT_OF(kIndices);
+	fIndices = new Index[fIndexCount];
+	for (int32 i = 0; i < fIndexCount; i++) {
+		Index& index = fIndices[i];
+		index.attribute = kIndices[i].attribute;
+		index.type = kIndices[i].type;
+		index.count = count;
+		index.entries = new Entry*[count];
+		for (int32 j = 0; j < count; j++)
+			index.entries[j] = &fEntries[j];
+
+		std::sort(index.entries, index.entries + count, EntryLess(index));
+	}
+}
+
+
+Volume::~Volume()
+{
+	for (int32 i = 0; i < fIndexCount; i++)
+		delete[] fIndices[i].entries;
+
+	delete[] fIndices;
+	delete[] fEntries;
+}
+
+
+Index*
+Volume::FindIndex(const char* attribute)
+{
+	for (int32 i = 0; i < fIndexCount; i++) {
+		if (strcmp(fIndices[i].attribute, attribute) == 0)
+			return &fIndices[i];
+	}
+
+	return NULL;
+}
+
+
+//	#pragma mark -
 
 
 class Query {
 public:
-	static	status_t		Create(void* volume, const char* queryString,
+	static	status_t		Create(Volume* volume, const char* queryString,
 								uint32 flags, port_id port, uint32 token,
 								Query*& _query);
+							~Query();
+
+			status_t		GetNextEntry(struct dirent* dirent, size_t size);
+			bool			Matches(Entry* entry);
+
+			struct QueryPolicy;
 
 private:
-	struct QueryPolicy;
-	friend struct QueryPolicy;
 	typedef QueryParser::Query<QueryPolicy> QueryImpl;
 
 private:
 							Query();
 
-			status_t		_Init(const char* queryString, uint32 flags,
-								port_id port, uint32 token);
+			status_t		_Init(Volume* volume, const char* queryString,
+								uint32 flags, port_id port, uint32 token);
 
 private:
 			QueryImpl*		fImpl;
@@ -40,23 +244,28 @@ private:
 
 
 struct Query::QueryPolicy {
-	typedef Query Context;
+	typedef ::Volume Context;
 	typedef ::Entry Entry;
 	typedef ::Entry Node;
 	typedef void* NodeHolder;
 
 	struct Index {
-		Query*		query;
+		Volume*			volume;
+		::Index*		index;
 
 		Index(Context* context)
 			:
-			query(context)
+			volume(context),
+			index(NULL)
 		{
 		}
 	};
 
 	struct IndexIterator {
-		Entry* entry;
+		Volume*			volume;
+		::Index*		index;
+		int32			position;
+		Entry*			entry;
 	};
 
 	static const int32 kMaxFileNameLength = B_FILE_NAME_LENGTH;
@@ -65,7 +274,7 @@ struct Query::QueryPolicy {
 
 	static ino_t EntryGetParentID(Entry* entry)
 	{
-		return -1;
+		return 1;
 	}
 
 	static Node* EntryGetNode(Entry* entry)
@@ -75,48 +284,67 @@ struct Query::QueryPolicy {
 
 	static ino_t EntryGetNodeID(Entry* entry)
 	{
-		return -1;
+		return entry->id;
 	}
 
 	static ssize_t EntryGetName(Entry* entry, void* buffer, size_t bufferSize)
 	{
-		return B_ERROR;
+		size_t length = strlcpy((char*)buffer, entry->name, bufferSize);
+		if (length >= bufferSize)
+			return B_BUFFER_OVERFLOW;
+
+		return length;
 	}
 
 	static const char* EntryGetNameNoCopy(NodeHolder& holder, Entry* entry)
 	{
-		return NULL;
+		return entry->name;
 	}
 
 	// Index interface
 
 	static status_t IndexSetTo(Index& index, const char* attribute)
 	{
-		return B_ERROR;
+		index.index = index.volume->FindIndex(attribute);
+		return index.index != NULL ? B_OK : B_ENTRY_NOT_FOUND;
 	}
 
 	static void IndexUnset(Index& index)
 	{
+		index.index = NULL;
 	}
 
 	static int32 IndexGetWeightedScore(Index& index, int32 score)
 	{
-		return 0;
+		return score;
+	}
+
+	static int64 IndexGetEntryCount(Index& index)
+	{
+		return index.index->count;
 	}
 
 	static type_code IndexGetType(Index& index)
 	{
-		return 0;
+		return index.index->type;
 	}
 
 	static int32 IndexGetKeySize(Index& index)
 	{
-		return 0;
+		return index.index->type == B_INT32_TYPE ? sizeof(int32) : 0;
 	}
 
 	static IndexIterator* IndexCreateIterator(Index& index)
 	{
-		return NULL;
+		IndexIterator* iterator = new(std::nothrow) IndexIterator;
+		if (iterator == NULL)
+			return NULL;
+
+		iterator->volume = index.volume;
+		iterator->index = index.index;
+		iterator->position = 0;
+		iterator->entry = NULL;
+		return iterator;
 	}
 
 	// IndexIterator interface
@@ -126,25 +354,70 @@ struct Query::QueryPolicy {
 		delete indexIterator;
 	}
 
+	/*!	Moves the iterator to the first key that is not smaller than
+		\a value, and reports if that key is equal to it.
+	*/
 	static status_t IndexIteratorFind(IndexIterator* indexIterator,
 		const void* value, size_t size)
 	{
-		return B_ERROR;
+		::Index* index = indexIterator->index;
+		int32 lower = 0;
+		int32 upper = index->count;
+		while (lower < upper) {
+			int32 middle = (lower + upper) / 2;
+			if (_Compare(index, index->entries[middle], value, size) < 0)
+				lower = middle + 1;
+			else
+				upper = middle;
+		}
+
+		indexIterator->position = lower;
+		if (lower == index->count
+			|| _Compare(index, index->entries[lower], value, size) != 0)
+			return B_ENTRY_NOT_FOUND;
+
+		return B_OK;
 	}
 
 	static status_t IndexIteratorFetchNextEntry(IndexIterator* indexIterator,
 		void* value, size_t* _valueLength, size_t bufferSize, size_t* duplicate)
 	{
-		return B_ERROR;
+		::Index* index = indexIterator->index;
+		if (indexIterator->position >= index->count)
+			return B_ENTRY_NOT_FOUND;
+
+		Entry* entry = index->entries[indexIterator->position++];
+
+		size_t length;
+		type_code type;
+		const void* key = get_attribute(entry, index->attribute, &length,
+			&type);
+		if (length >= bufferSize)
+			return B_BUFFER_OVERFLOW;
+
+		memcpy(value, key, length);
+		if (type == B_STRING_TYPE)
+			((char*)value)[length] = '\0';
+
+		indexIterator->entry = entry;
+		*_valueLength = length;
+		*duplicate = 0;
+		return B_OK;
 	}
 
-	static status_t IndexIteratorGetEntry(Context* context, IndexIterator* indexIterator,
-		NodeHolder& holder, Entry** _entry)
+	static status_t IndexIteratorGetEntry(Context* context,
+		IndexIterator* indexIterator, NodeHolder& holder, Entry** _entry)
 	{
+		context->EntryLoaded();
 		*_entry = indexIterator->entry;
 		return B_OK;
 	}
 
+	static ino_t IndexIteratorGetNodeID(IndexIterator* indexIterator)
+	{
+		return indexIterator->entry->id;
+	}
+
 	static void IndexIteratorSkipDuplicates(IndexIterator* indexIterator)
 	{
 	}
@@ -172,7 +445,21 @@ struct Query::QueryPolicy {
 	static status_t NodeGetAttribute(NodeHolder& nodeHolder, Node* node,
 		const char* attribute, void* buffer, size_t* _size, int32* _type)
 	{
-		return B_ERROR;
+		size_t length;
+		type_code type;
+		const void* value = get_attribute(node, attribute, &length, &type);
+		if (value == NULL)
+			return B_ENTRY_NOT_FOUND;
+		if (length >= *_size)
+			return B_BUFFER_OVERFLOW;
+
+		memcpy(buffer, value, length);
+		if (type == B_STRING_TYPE)
+			((char*)buffer)[length] = '\0';
+
+		*_size = length;
+		*_type = type;
+		return B_OK;
 	}
 
 	static Entry* NodeGetFirstReferrer(Node* node)
@@ -189,20 +476,31 @@ struct Query::QueryPolicy {
 
 	static dev_t ContextGetVolumeID(Context* context)
 	{
-		return 0;
+		return 1;
+	}
+
+private:
+	static int _Compare(::Index* index, Entry* entry, const void* value,
+		size_t size)
+	{
+		size_t length;
+		type_code type;
+		const void* key = get_attribute(entry, index->attribute, &length,
+			&type);
+		return QueryParser::compareKeys(index->type, key, length, value, size);
 	}
 };
 
 
 /*static*/ status_t
-Query::Create(void* volume, const char* queryString, uint32 flags,
+Query::Create(Volume* volume, const char* queryString, uint32 flags,
 	port_id port, uint32 token, Query*& _query)
 {
 	Query* query = new(std::nothrow) Query();
 	if (query == NULL)
 		return B_NO_MEMORY;
 
-	status_t error = query->_Init(queryString, flags, port, token);
+	status_t error = query->_Init(volume, queryString, flags, port, token);
 	if (error != B_OK) {
 		delete query;
 		return error;
@@ -220,10 +518,17 @@ Query::Query()
 }
 
 
+Query::~Query()
+{
+	delete fImpl;
+}
+
+
 status_t
-Query::_Init(const char* queryString, uint32 flags, port_id port, uint32 token)
+Query::_Init(Volume* volume, const char* queryString, uint32 flags,
+	port_id port, uint32 token)
 {
-	status_t error = QueryImpl::Create(this, queryString, flags, port, token,
+	status_t error = QueryImpl::Create(volume, queryString, flags, port, token,
 		fImpl);
 	if (error != B_OK)
 		return error;
@@ -232,9 +537,290 @@ Query::_Init(const char* queryString, uint32 flags, port_id port, uint32 token)
 }
 
 
+status_t
+Query::GetNextEntry(struct dirent* dirent, size_t size)
+{
+	return fImpl->GetNextEntry(dirent, size);
+}
+
+
+/*!	Matches \a entry against the whole query, without using any index. */
+bool
+Query::Matches(Entry* entry)
+{
+	return fImpl->GetExpression()->Root()->Match(entry, entry)
+		== QueryParser::MATCH_OK;
+}
+
+
+//	#pragma mark - tests
+
+
+typedef Query::QueryPolicy TestPolicy;
+
+
+static const char* sTestName;
+
+
+static void
+error(int32 line, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+
+	fprintf(stderr, "ERROR IN TEST LINE %" B_PRId32 " (%s): ", line,
+		sTestName);
+	vfprintf(stderr, format, args);
+	fprintf(stderr, "\n");
+
+	va_end(args);
+
+	exit(1);
+}
+
+
+static void
+test_node_id_set()
+{
+	sTestName = "NodeIDSet";
+
+	NodeIDSet first;
+	static const ino_t kFirst[] = {9, 3, 7, 3, 1, 9, 5};
+	for (size_t i = 0; i < B_COUNT_OF(kFirst); i++)
+		TEST_ASSERT(first.Add(kFirst[i]) == B_OK);
+	first.Sort();
+
+	TEST_ASSERT(first.Count() == 5);
+	for (ino_t id = 0; id <= 10; id++)
+		TEST_ASSERT(first.Contains(id) == (id % 2 == 1));
+
+	// a set that has to grow a few times
+	NodeIDSet second;
+	for (ino_t id = 1000; id > 0; id -= 3)
+		TEST_ASSERT(second.Add(id) == B_OK);
+	second.Sort();
+	TEST_ASSERT(second.Count() == 334);
+
+	NodeIDSet empty;
+	TEST_ASSERT(second.UniteWith(empty) == B_OK);
+	TEST_ASSERT(second.Count() == 334);
+
+	// only 1 and 7 are in both sets
+	NodeIDSet intersection;
+	for (ino_t id = 1; id <= 10; id++)
+		TEST_ASSERT(intersection.Add(id) == B_OK);
+	intersection.Sort();
+	intersection.IntersectWith(first);
+	intersection.IntersectWith(second);
+	TEST_ASSERT(intersection.Count() == 2);
+	TEST_ASSERT(intersection.Contains(1) && intersection.Contains(7));
+	TEST_ASSERT(!intersection.Contains(3) && !intersection.Contains(4)
+		&& !intersection.Contains(9));
+
+	TEST_ASSERT(first.UniteWith(second) == B_OK);
+	TEST_ASSERT(first.Count() == 334 + 3);
+	TEST_ASSERT(first.Contains(3) && first.Contains(9) && first.Contains(4)
+		&& first.Contains(1000));
+	TEST_ASSERT(!first.Contains(2) && !first.Contains(6));
+
+	intersection.IntersectWith(empty);
+	TEST_ASSERT(intersection.Count() == 0);
+	TEST_ASSERT(!intersection.Contains(1));
+
+	TEST_ASSERT(empty.UniteWith(first) == B_OK);
+	TEST_ASSERT(empty.Count() == first.Count());
+}
+
+
+/*!	Checks EstimateMatchCount() and CollectMatchingNodes() of the expression
+	\a queryString. \a expectedStatus is the result expected from
+	CollectMatchingNodes(); if it succeeds, the set must contain exactly the
+	nodes that match the expression.
+*/
+static void
+test_collect(Volume& volume, const char* queryString, bool estimated,
+	status_t expectedStatus)
+{
+	sTestName = queryString;
+
+	Expression<TestPolicy> expression;
+	const char* position;
+	TEST_ASSERT(expression.Init(queryString, &position) == B_OK);
+	Term<TestPolicy>* term = expression.Root();
+
+	TestPolicy::Index index(&volume);
+	int64 estimate = term->EstimateMatchCount(index);
+	TestPolicy::IndexUnset(index);
+	TEST_ASSERT((estimate >= 0) == estimated);
+
+	NodeIDSet nodes;
+	status_t status = term->CollectMatchingNodes(&volume, nodes);
+	if (status != expectedStatus) {
+		error(__LINE__, "CollectMatchingNodes() returned %s instead of %s",
+			strerror(status), strerror(expectedStatus));
+	}
+	if (status != B_OK)
+		return;
+
+	int32 matching = 0;
+	for (int32 i = 0; i < volume.CountEntries(); i++) {
+		Entry* entry = volume.EntryAt(i);
+		bool matches = term->Match(entry, entry) == QueryParser::MATCH_OK;
+		if (matches != nodes.Contains(entry->id)) {
+			error(__LINE__, "node %" B_PRIdINO " %s in the set", entry->id,
+				matches ? "missing" : "wrongly");
+		}
+		if (matches)
+			matching++;
+	}
+	TEST_ASSERT(nodes.Count() == matching);
+}
+
+
+enum plan {
+	USES_NODE_SETS,
+		// only nodes in the node sets are loaded, all of them match
+	MATCHES_NODES
+		// at least some nodes have to be loaded to be matched
+};
+
+
+/*!	Runs the query \a queryString, and compares its results with matching
+	every node of the volume against it one by one. If \a expectedPlan is
+	\c USES_NODE_SETS, every node that was loaded by the query must also
+	have been returned.
+*/
+static void
+test_query(Volume& volume, const char* queryString, plan expectedPlan)
+{
+	sTestName = queryString;
+
+	Query* query;
+	TEST_ASSERT(Query::Create(&volume, queryString, 0, -1, 0, query) == B_OK);
+
+	volume.ResetLoadedEntries();
+
+	int32 count = volume.CountEntries();
+	uint8* found = new uint8[count + 1];
+	memset(found, 0, count + 1);
+	int32 returned = 0;
+
+	char buffer[sizeof(struct dirent) + B_FILE_NAME_LENGTH];
+	struct dirent* dirent = (struct dirent*)buffer;
+	while (query->GetNextEntry(dirent, sizeof(buffer)) == B_OK) {
+		TEST_ASSERT(dirent->d_ino > 0 && dirent->d_ino <= count);
+		TEST_ASSERT(strcmp(dirent->d_name,
+			volume.EntryAt(dirent->d_ino - 1)->name) == 0);
+		found[dirent->d_ino] = 1;
+		returned++;
+	}
+
+	int32 loaded = volume.LoadedEntries();
+
+	// The results of several ||-operands can overlap, so only the set
+	// of returned nodes is compared
+	int32 matching = 0;
+	for (int32 i = 0; i < count; i++) {
+		Entry* entry = volume.EntryAt(i);
+		bool matches = query->Matches(entry);
+		if (matches != (found[entry->id] != 0)) {
+			error(__LINE__, "node %" B_PRIdINO " %s returned", entry->id,
+				matches ? "not" : "wrongly");
+		}
+		if (matches)
+			matching++;
+	}
+
+	delete[] found;
+	delete query;
+
+	TEST_ASSERT(matching > 0);
+	if (expectedPlan == USES_NODE_SETS)
+		TEST_ASSERT(loaded == returned);
+	if (expectedPlan == MATCHES_NODES)
+		TEST_ASSERT(loaded > returned);
+}
+
+
+static void
+test_node_sets()
+{
+	Volume volume(1000);
+
+	test_collect(volume, "b==3", true, B_OK);
+	test_collect(volume, "a<=250", true, B_OK);
+	test_collect(volume, "a>990", true, B_OK);
+	test_collect(volume, "c==\"c1*\"", true, B_OK);
+	test_collect(volume, "(b==3)&&(c==\"c1*\")", true, B_OK);
+	test_collect(volume, "(b==3)||(a>=900)", true, B_OK);
+	test_collect(volume, "c==\"c12\"", true, B_OK);
+	test_collect(volume, "c==\"none\"", true, B_OK);
+	test_collect(volume, "!((b!=3)||(a<500))", true, B_OK);
+
+	// neither unequal, nor not indexed equations can be collected
+	test_collect(volume, "b!=3", false, B_UNSUPPORTED);
+	test_collect(volume, "d==1", false, B_UNSUPPORTED);
+	test_collect(volume, "(b==3)&&(d==1)", false, B_UNSUPPORTED);
+	test_collect(volume, "!(b==3)", false, B_UNSUPPORTED);
+
+	// the other side of the && is turned into a node set
+	test_query(volume, "(b==3)&&(c==\"c12*\")", USES_NODE_SETS);
+	test_query(volume, "(c==\"c1*\")&&(a>=100)", USES_NODE_SETS);
+	test_query(volume, "(b==3)&&((c==\"c5\")||(c==\"c6\"))", USES_NODE_SETS);
+	test_query(volume, "((b==3)&&(c==\"c12\"))||((b==4)&&(c==\"c13\"))",
+		USES_NODE_SETS);
+	test_query(volume, "!((c!=\"c12\")||(b!=3))", USES_NODE_SETS);
+
+	// only the inner && can use a node set
+	test_query(volume, "(a>=100)&&((b==3)&&(c==\"c17\"))", MATCHES_NODES);
+
+	// reading the attributes is expected to be cheaper
+	test_query(volume, "(b==3)&&(a>=500)", MATCHES_NODES);
+
+	// the other side cannot be resolved into a node set
+	test_query(volume, "(b==3)&&!(c==\"c12\")", MATCHES_NODES);
+	test_query(volume, "(b==3)&&(d==1)", MATCHES_NODES);
+	test_query(volume, "(b==3)&&(name==\"file1*\")", MATCHES_NODES);
+	test_query(volume, "(c==\"c12\")&&((b==3)||(d==1))", MATCHES_NODES);
+}
+
+
+static void
+test_node_set_limit()
+{
+	// the estimates of a range are half of the index size, and those
+	// of an equal comparison 1/64th of it
+	Volume volume(131000);
+
+	// the estimate alone exceeds the limit
+	test_query(volume, "(c==\"c1*\")&&((a>=10)||(b==3))", MATCHES_NODES);
+
+	// the estimate is within the limit, but too many nodes match
+	test_collect(volume, "a>=10", true, B_BUFFER_OVERFLOW);
+	test_query(volume, "(c==\"c1*\")&&(a>=10)", MATCHES_NODES);
+
+	// only the union of the sets exceeds the limit
+	test_collect(volume, "(b==1)||(b==2)||(b==3)||(b==4)", true,
+		B_BUFFER_OVERFLOW);
+	test_query(volume, "(c==\"c12\")&&((b==1)||(b==2)||(b==3)||(b==4))",
+		MATCHES_NODES);
+
+	test_query(volume, "(c==\"c12\")&&((b==1)||(b==2))", USES_NODE_SETS);
+}
+
+
 int
 main(int argc, char* argv[])
 {
+	if (argc < 2) {
+		test_node_id_set();
+		test_node_sets();
+		test_node_set_limit();
+
+		printf("All tests passed.\n");
+		return 0;
+	}
+
 	for (int i = 1; i < argc; i++) {
 		Query* query;
 		status_t error = Query::Create(NULL, argv[i], 0, 0, 0, query);
@@ -0,0 +1,191 @@
+#!/bin/sh
+
+# Tests writing to XFS images with xfs_shell, and checks the results with
+# xfs_repair. Runs on Linux, and needs the xfsprogs. Build xfs_shell first:
+#	jam "<build>xfs_shell"
+# As root, the test also crashes xfs_shell in the middle of its work, and lets
+# the Linux kernel recover the log.
+#
+# Usage: xfs_write_test.sh <path to xfs_shell>
+
+XFS_SHELL=${1}
+TEST_DIR=${TMPDIR:-/tmp}/xfs_write_test.$$
+TEST_IMAGE="${TEST_DIR}/fs.img"
+TEST_MP="${TEST_DIR}/mount"
+
+if [ -z "${XFS_SHELL}" ] || [ ! -x "${XFS_SHELL}" ]; then
+	echo "Usage: $0 <path to xfs_shell>"
+	exit 1
+fi
+
+for tool in mkfs.xfs xfs_repair xfs_logprint cmp; do
+	if ! command -v ${tool} > /dev/null; then
+		echo "Can not find ${tool}, install the xfsprogs"
+		exit 1
+	fi
+done
+
+mkdir -p ${TEST_DIR}/data ${TEST_DIR}/result
+trap 'rm -rf ${TEST_DIR}' EXIT
+
+# files to copy onto the image: empty, smaller than a block, several extents
+: > ${TEST_DIR}/data/empty
+echo "small file" > ${TEST_DIR}/data/small
+dd if=/dev/urandom of=${TEST_DIR}/data/large bs=64k count=40 2> /dev/null
+
+fail() # ${1} => message
+{
+	echo "FAILED: ${1}"
+	exit 1
+}
+
+make_image() # ${1} => mkfs.xfs options
+{
+	rm -f ${TEST_IMAGE}
+	truncate -s 512M ${TEST_IMAGE}
+
+	# newer mkfs.xfs defaults to large extent counters, the driver does not
+	# know them
+	EXTRA=""
+	if mkfs.xfs -N -f -i nrext64=0 ${TEST_IMAGE} > /dev/null 2>&1; then
+		EXTRA="-i nrext64=0"
+	fi
+
+	mkfs.xfs -q -f ${1} ${EXTRA} ${TEST_IMAGE} || fail "mkfs.xfs ${1}"
+}
+
+# xfs_shell mounts the image at /myfs. It only reports failed commands on
+# its error output.
+run_shell() # ${1} => commands
+{
+	printf 'cd /myfs\n%s\nquit\n' "${1}" \
+		| ${XFS_SHELL} --mount-parameters write ${TEST_IMAGE} \
+			> /dev/null 2> ${TEST_DIR}/shell.log
+	if [ "$?" -ne "0" ] || grep -q Error ${TEST_DIR}/shell.log; then
+		cat ${TEST_DIR}/shell.log
+		fail "xfs_shell"
+	fi
+}
+
+check_image() # ${1} => description
+{
+	xfs_repair -n ${TEST_IMAGE} > ${TEST_DIR}/repair.log 2>&1
+	if [ "$?" -ne "0" ]; then
+		cat ${TEST_DIR}/repair.log
+		fail "xfs_repair after ${1}"
+	fi
+}
+
+check_file() # ${1} => file on the image ${2} => expected contents
+{
+	rm -f ${TEST_DIR}/result/file
+	run_shell "cp ${1} :${TEST_DIR}/result/file"
+	cmp -s ${TEST_DIR}/result/file ${2} || fail "contents of ${1}"
+}
+
+# Creates, writes, shrinks, renames and removes files and directories, in
+# several steps, so that every step has to work on what the last one wrote.
+run_write_test() # ${1} => mkfs.xfs options
+{
+	echo "Run write test with ${1} ..."
+	make_image "${1}"
+	DATA=":${TEST_DIR}/data"
+
+	# new files and directories; the short form directory has to be
+	# converted into a block directory on the way. It has to stay a single
+	# block even with 1 KB blocks, as leaf directories cannot be written yet.
+	COMMANDS="mkdir dir
+		cp ${DATA}/empty empty
+		cp ${DATA}/small small
+		cp ${DATA}/large large
+		cp ${DATA}/large dir/large"
+	for i in $(seq 1 15); do
+		COMMANDS="${COMMANDS}
+			touch dir/file_with_a_long_name_${i}"
+	done
+	run_shell "${COMMANDS}"
+	check_image "creating entries"
+	check_file large ${TEST_DIR}/data/large
+	check_file dir/large ${TEST_DIR}/data/large
+
+	# shrinks a file by copying a smaller one over it, and renames
+	run_shell "cp ${DATA}/small large
+		mv small dir/moved
+		mkdir dir/sub
+		mv dir/sub sub
+		mv dir/moved empty"
+	check_image "shrinking and renaming"
+	check_file large ${TEST_DIR}/data/small
+	check_file empty ${TEST_DIR}/data/small
+
+	# removes everything again, which frees the blocks and inodes
+	COMMANDS="rm large
+		rm empty
+		rm -r sub
+		rm dir/large"
+	for i in $(seq 1 15); do
+		COMMANDS="${COMMANDS}
+			rm dir/file_with_a_long_name_${i}"
+	done
+	COMMANDS="${COMMANDS}
+		rm -r dir"
+	run_shell "${COMMANDS}"
+	check_image "removing entries"
+}
+
+# Kills xfs_shell without unmounting, and lets Linux replay the log.
+run_recovery_test() # ${1} => mkfs.xfs options
+{
+	echo "Run recovery test with ${1} ..."
+	make_image "${1}"
+
+	mkfifo ${TEST_DIR}/commands
+	${XFS_SHELL} --mount-parameters write ${TEST_IMAGE} \
+		< ${TEST_DIR}/commands > /dev/null &
+	SHELL_PID=$!
+	exec 3> ${TEST_DIR}/commands
+
+	echo "cd /myfs" >&3
+	echo "mkdir dir" >&3
+	for i in $(seq 1 20); do
+		echo "cp :${TEST_DIR}/data/large dir/file${i}" >&3
+	done
+	echo "rm dir/file1" >&3
+	echo "mv dir/file2 file2" >&3
+	sleep 5
+
+	kill -9 ${SHELL_PID}
+	wait ${SHELL_PID} 2> /dev/null
+	exec 3>&-
+	rm -f ${TEST_DIR}/commands
+
+	xfs_logprint -t ${TEST_IMAGE} > /dev/null 2>&1 \
+		|| fail "xfs_logprint can not read the log"
+
+	mkdir -p ${TEST_MP}
+	mount -o loop -t xfs ${TEST_IMAGE} ${TEST_MP} || fail "log recovery"
+	umount ${TEST_MP} || fail "unmounting"
+
+	check_image "log recovery"
+}
+
+CONFIGS="-m crc=0 -n ftype=0
+-m crc=0 -n ftype=1
+-m crc=1,finobt=0,reflink=0,rmapbt=0
+-m crc=1,finobt=1,reflink=0,rmapbt=0
+-m crc=1,finobt=1,reflink=0,rmapbt=0 -i sparse=1
+-m crc=1,finobt=1,reflink=0,rmapbt=0 -b size=1024"
+
+echo "${CONFIGS}" | while read -r OPTIONS; do
+	run_write_test "${OPTIONS}"
+
+	if [ "$(id -u)" -eq "0" ]; then
+		run_recovery_test "${OPTIONS}"
+	fi
+done || exit 1
+
+if [ "$(id -u)" -ne "0" ]; then
+	echo "Not root, the log recovery tests have been skipped"
+fi
+
+echo PASSED
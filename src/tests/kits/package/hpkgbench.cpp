@@ -0,0 +1,247 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Package writing and reading benchmark.
+ *
+ * Recompresses a given package with zlib, zstd, and zstd with a trained
+ * dictionary at a few compression levels, using one and several compression
+ * threads, and measures the time needed.
+ * Each resulting package's heap is then read back -- like "package extract"
+ * does, but without writing the files -- sequentially and with parallel
+ * decompression.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <DataIO.h>
+#include <File.h>
+#include <OS.h>
+#include <String.h>
+
+#include <package/hpkg/HPKGDefs.h>
+#include <package/hpkg/PackageFileHeapReader.h>
+#include <package/hpkg/PackageReader.h>
+#include <package/hpkg/PackageWriter.h>
+#include <package/hpkg/ParallelHeapReader.h>
+#include <package/hpkg/StandardErrorOutput.h>
+
+
+using namespace BPackageKit::BHPKG;
+using BPackageKit::BHPKG::BPrivate::PackageFileHeapReader;
+using BPackageKit::BHPKG::BPrivate::ParallelHeapReader;
+
+
+struct QuietWriterListener : BPackageWriterListener {
+	virtual void PrintErrorVarArgs(const char* format, va_list args)
+	{
+		vfprintf(stderr, format, args);
+	}
+
+	virtual void OnEntryAdded(const char* path)
+	{
+	}
+
+	virtual void OnTOCSizeInfo(uint64 uncompressedStringsSize,
+		uint64 uncompressedMainSize, uint64 uncompressedTOCSize)
+	{
+	}
+
+	virtual void OnPackageAttributesSizeInfo(uint32 stringCount,
+		uint32 uncompressedSize)
+	{
+	}
+
+	virtual void OnPackageSizeInfo(uint32 headerSize, uint64 heapSize,
+		uint64 tocSize, uint32 packageAttributesSize, uint64 totalSize)
+	{
+	}
+};
+
+
+struct NullOutput : BDataIO {
+	virtual ssize_t Write(const void* buffer, size_t size)
+	{
+		return size;
+	}
+};
+
+
+static void
+usage()
+{
+	printf("hpkgbench [-j threads] <package> <scratch directory>\n"
+		"  -j  the number of threads for the parallel runs (default: one per "
+		"CPU)\n");
+	exit(1);
+}
+
+
+static bigtime_t
+write_package(const char* inputPath, const char* outputPath,
+	uint32 compression, int32 level, int32 threadCount, off_t& _size)
+{
+	BFile inputFile;
+	status_t error = inputFile.SetTo(inputPath, B_READ_ONLY);
+	if (error != B_OK) {
+		fprintf(stderr, "hpkgbench: could not open \"%s\": %s\n", inputPath,
+			strerror(error));
+		exit(1);
+	}
+
+	BPackageWriterParameters parameters;
+	parameters.SetCompression(compression);
+	parameters.SetCompressionLevel(level);
+	parameters.SetThreadCount(threadCount);
+
+	bigtime_t start = system_time();
+
+	QuietWriterListener listener;
+	BPackageWriter writer(&listener);
+	error = writer.Init(outputPath, &parameters);
+	if (error == B_OK)
+		error = writer.Recompress(&inputFile);
+	if (error != B_OK) {
+		fprintf(stderr, "hpkgbench: could not write \"%s\": %s\n", outputPath,
+			strerror(error));
+		exit(1);
+	}
+
+	bigtime_t time = system_time() - start;
+
+	BFile outputFile(outputPath, B_READ_ONLY);
+	if (outputFile.GetSize(&_size) != B_OK)
+		_size = 0;
+
+	return time;
+}
+
+
+static bigtime_t
+read_package(const char* path, int32 threadCount)
+{
+	bigtime_t start = system_time();
+
+	BStandardErrorOutput errorOutput;
+	BPackageReader reader(&errorOutput);
+	status_t error = reader.Init(path);
+	if (error != B_OK)
+		exit(1);
+
+	PackageFileHeapReader* heapReader
+		= dynamic_cast<PackageFileHeapReader*>(reader.HeapReader());
+	if (heapReader == NULL) {
+		fprintf(stderr, "hpkgbench: unexpected heap reader\n");
+		exit(1);
+	}
+
+	BAbstractBufferedDataReader* dataReader = heapReader;
+	ParallelHeapReader parallelReader(heapReader);
+	if (threadCount != 1) {
+		error = parallelReader.Init(threadCount);
+		if (error != B_OK) {
+			fprintf(stderr, "hpkgbench: could not create the parallel "
+				"reader: %s\n", strerror(error));
+			exit(1);
+		}
+		dataReader = &parallelReader;
+	}
+
+	// read the heap in pieces of typical file sizes
+	static const size_t kReadSize = 20000;
+	uint64 heapSize = heapReader->UncompressedHeapSize();
+	NullOutput output;
+	for (uint64 offset = 0; offset < heapSize; offset += kReadSize) {
+		size_t toRead = std::min((uint64)kReadSize, heapSize - offset);
+		error = dataReader->ReadDataToOutput(offset, toRead, &output);
+		if (error != B_OK) {
+			fprintf(stderr, "hpkgbench: reading \"%s\" failed: %s\n", path,
+				strerror(error));
+			exit(1);
+		}
+	}
+
+	return system_time() - start;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 threadCount = 0;
+	int c;
+
+	while ((c = getopt(argc, argv, "hj:")) != -1) {
+		switch (c) {
+			case 'j':
+				threadCount = atoi(optarg);
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (argc - optind != 2 || threadCount < 0)
+		usage();
+
+	const char* inputPath = argv[optind];
+	BString outputPath = BString(argv[optind + 1]) << "/hpkgbench.hpkg";
+
+	if (threadCount == 0)
+		threadCount = sysconf(_SC_NPROCESSORS_ONLN);
+
+	static const struct {
+		const char*	name;
+		uint32		compression;
+	} kCompressions[] = {
+		{ "zlib", B_HPKG_COMPRESSION_ZLIB },
+		{ "zstd", B_HPKG_COMPRESSION_ZSTD },
+		{ "zdict", B_HPKG_COMPRESSION_ZSTD_DICTIONARY }
+	};
+	static const int32 kLevels[] = { 1, 6, 9 };
+	const int32 threadCounts[] = { 1, threadCount };
+
+	// The throughput is relative to the input package's size, which is good
+	// enough for a comparison.
+	off_t inputSize;
+	BFile inputFile(inputPath, B_READ_ONLY);
+	if (inputFile.GetSize(&inputSize) != B_OK || inputSize == 0)
+		usage();
+
+	printf("%-5s %5s %7s %10s %12s %12s\n", "algo", "level", "threads",
+		"size (MB)", "write (MB/s)", "read (MB/s)");
+
+	for (size_t i = 0; i < sizeof(kCompressions) / sizeof(kCompressions[0]);
+			i++) {
+		for (size_t k = 0; k < sizeof(kLevels) / sizeof(kLevels[0]); k++) {
+			for (int32 t = 0; t < 2; t++) {
+				if (t > 0 && threadCounts[t] == 1)
+					continue;
+
+				off_t size;
+				bigtime_t writeTime = write_package(inputPath,
+					outputPath.String(), kCompressions[i].compression,
+					kLevels[k], threadCounts[t], size);
+				bigtime_t readTime = read_package(outputPath.String(),
+					threadCounts[t]);
+
+				printf("%-5s %5" B_PRId32 " %7" B_PRId32 " %10.2f %12.2f "
+					"%12.2f\n", kCompressions[i].name, kLevels[k],
+					threadCounts[t], size / 1048576.0,
+					inputSize / 1.048576 / writeTime,
+					inputSize / 1.048576 / readTime);
+			}
+		}
+	}
+
+	unlink(outputPath.String());
+	return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Application start benchmark.
+ *
+ * Launches an application -- WebPositive by default -- and measures the time
+ * until it shows its first window, then quits it again. The first run after
+ * booting (or after the application's package has been activated) is a cold
+ * start that has to read and decompress everything from the package; the
+ * following runs show the warm start time.
+ *
+ * With -f, the files in the given directories are read instead, which shows
+ * the raw packagefs read throughput.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <Application.h>
+#include <Messenger.h>
+#include <OS.h>
+#include <Roster.h>
+
+
+static const char* kDefaultSignature = "application/x-vnd.Haiku-WebPositive";
+static const bigtime_t kTimeout = 60000000;
+static const size_t kReadSize = 64 * 1024;
+
+
+static void
+usage()
+{
+	printf("appstartbench [-r runs] [-s signature]\n"
+		"appstartbench -f <directory> ...\n"
+		"  -r  the number of runs (default: 3)\n"
+		"  -s  the application to start (default: %s)\n"
+		"  -f  read the files in the directories instead\n",
+		kDefaultSignature);
+	exit(1);
+}
+
+
+static int32
+count_windows(const BMessenger& messenger)
+{
+	BMessage request(B_COUNT_PROPERTIES);
+	request.AddSpecifier("Window");
+
+	BMessage reply;
+	if (messenger.SendMessage(&request, &reply, 100000, 100000) != B_OK)
+		return -1;
+
+	int32 count;
+	if (reply.FindInt32("result", &count) != B_OK)
+		return -1;
+	return count;
+}
+
+
+static bigtime_t
+start_application(const char* signature)
+{
+	bigtime_t start = system_time();
+
+	team_id team;
+	status_t status = be_roster->Launch(signature, (BMessage*)NULL, &team);
+	if (status != B_OK) {
+		fprintf(stderr, "appstartbench: could not launch %s: %s\n", signature,
+			strerror(status));
+		exit(1);
+	}
+
+	// wait for the first window
+	BMessenger messenger(NULL, team);
+	while (!messenger.IsValid() || count_windows(messenger) <= 0) {
+		if (system_time() - start > kTimeout) {
+			fprintf(stderr, "appstartbench: %s did not show a window\n",
+				signature);
+			exit(1);
+		}
+		snooze(5000);
+		if (!messenger.IsValid())
+			messenger = BMessenger(NULL, team);
+	}
+
+	bigtime_t time = system_time() - start;
+
+	// quit it again, and wait until it's gone (the main thread has the ID
+	// of the team)
+	messenger.SendMessage(B_QUIT_REQUESTED);
+	status_t result;
+	wait_for_thread(team, &result);
+
+	return time;
+}
+
+
+static void
+read_files(const char* path, off_t& bytes, int32& files, char* buffer)
+{
+	DIR* dir = opendir(path);
+	if (dir == NULL)
+		return;
+
+	while (dirent* entry = readdir(dir)) {
+		if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+			continue;
+
+		char file[B_PATH_NAME_LENGTH];
+		snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+
+		struct stat st;
+		if (lstat(file, &st) != 0)
+			continue;
+
+		if (S_ISDIR(st.st_mode)) {
+			read_files(file, bytes, files, buffer);
+			continue;
+		}
+		if (!S_ISREG(st.st_mode))
+			continue;
+
+		int fd = open(file, O_RDONLY);
+		if (fd < 0)
+			continue;
+
+		ssize_t bytesRead;
+		while ((bytesRead = read(fd, buffer, kReadSize)) > 0)
+			bytes += bytesRead;
+
+		close(fd);
+		files++;
+	}
+
+	closedir(dir);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	const char* signature = kDefaultSignature;
+	int32 runs = 3;
+	bool readMode = false;
+	int c;
+
+	while ((c = getopt(argc, argv, "fhr:s:")) != -1) {
+		switch (c) {
+			case 'f':
+				readMode = true;
+				break;
+			case 'r':
+				runs = atoi(optarg);
+				break;
+			case 's':
+				signature = optarg;
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (runs < 1 || (readMode && optind >= argc))
+		usage();
+
+	if (readMode) {
+		char* buffer = (char*)malloc(kReadSize);
+		if (buffer == NULL)
+			return 1;
+
+		off_t bytes = 0;
+		int32 files = 0;
+		bigtime_t start = system_time();
+		for (int i = optind; i < argc; i++)
+			read_files(argv[i], bytes, files, buffer);
+		bigtime_t time = system_time() - start;
+
+		printf("read %" B_PRId32 " files (%.1f MB) in %.3f s: %.2f MB/s\n",
+			files, bytes / 1048576.0, time / 1000000.0,
+			bytes / 1.048576 / time);
+		free(buffer);
+		return 0;
+	}
+
+	BApplication application("application/x-vnd.Haiku-appstartbench");
+
+	for (int32 run = 0; run < runs; run++) {
+		bigtime_t time = start_application(signature);
+		printf("run %" B_PRId32 "%s: %.3f s\n", run + 1,
+			run == 0 ? " (cold, if first since boot)" : "", time / 1000000.0);
+	}
+
+	return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Directory listing benchmark.
+ *
+ * Lists a directory the way a file manager does -- reading the entries and
+ * stat()ing each of them -- once with BDirectory::GetNextDirents() plus
+ * GetStatFor(), and once with BDirectory::GetNextDirentsWithStats().
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <Directory.h>
+#include <OS.h>
+
+
+static const int32 kEntriesPerCall = 64;
+static const size_t kBufferSize = kEntriesPerCall
+	* (sizeof(dirent) + B_FILE_NAME_LENGTH);
+
+
+static void
+usage()
+{
+	printf("dirlistbench [-i iterations] <directory>\n");
+	exit(1);
+}
+
+
+static int32
+list_separately(BDirectory& directory, dirent* buffer, struct stat* stats)
+{
+	int32 total = 0;
+
+	directory.Rewind();
+	while (true) {
+		int32 count = directory.GetNextDirents(buffer, kBufferSize,
+			kEntriesPerCall);
+		if (count <= 0)
+			break;
+
+		dirent* entry = buffer;
+		for (int32 i = 0; i < count; i++) {
+			directory.GetStatFor(entry->d_name, &stats[i]);
+			entry = (dirent*)((uint8*)entry + entry->d_reclen);
+		}
+
+		total += count;
+	}
+
+	return total;
+}
+
+
+static int32
+list_with_stats(BDirectory& directory, dirent* buffer, struct stat* stats)
+{
+	int32 total = 0;
+
+	directory.Rewind();
+	while (true) {
+		int32 count = directory.GetNextDirentsWithStats(buffer, kBufferSize,
+			stats, kEntriesPerCall);
+		if (count <= 0)
+			break;
+
+		total += count;
+	}
+
+	return total;
+}
+
+
+static void
+measure(const char* name, int32 (*list)(BDirectory&, dirent*, struct stat*),
+	BDirectory& directory, int iterations)
+{
+	dirent* buffer = (dirent*)malloc(kBufferSize);
+	struct stat* stats = new struct stat[kEntriesPerCall];
+
+	// warm up the caches
+	int32 entries = list(directory, buffer, stats);
+
+	bigtime_t start = system_time();
+	for (int i = 0; i < iterations; i++)
+		list(directory, buffer, stats);
+	bigtime_t time = system_time() - start;
+
+	printf("%-28s %6" B_PRId32 " entries, %8.1f us per listing\n", name,
+		entries, (double)time / iterations);
+
+	delete[] stats;
+	free(buffer);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int iterations = 100;
+	int c;
+
+	while ((c = getopt(argc, argv, "hi:")) != -1) {
+		switch (c) {
+			case 'i':
+				iterations = atoi(optarg);
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (optind >= argc || iterations < 1)
+		usage();
+
+	BDirectory directory(argv[optind]);
+	status_t status = directory.InitCheck();
+	if (status != B_OK) {
+		fprintf(stderr, "dirlistbench: could not open \"%s\": %s\n",
+			argv[optind], strerror(status));
+		return 1;
+	}
+
+	measure("GetNextDirents+GetStatFor", list_separately, directory,
+		iterations);
+	measure("GetNextDirentsWithStats", list_with_stats, directory,
+		iterations);
+
+	return 0;
+}
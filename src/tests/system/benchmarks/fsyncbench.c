@@ -0,0 +1,165 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*
+ * fsync() throughput benchmark.
+ *
+ * Lets a number of threads append small records to their own file, and
+ * fsync() it after every one, like a mail server or a database does when
+ * committing. Reports the total number of fsync()s per second.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+#define MAX_THREADS		64
+#define RECORD_SIZE		512
+
+static char sBase[PATH_MAX];
+static int sSeconds = 5;
+static volatile int sStop = 0;
+
+struct thread_data {
+	pthread_t		thread;
+	int				fd;
+	unsigned long	count;
+	int				error;
+};
+
+
+static void
+usage(void)
+{
+	printf("fsyncbench [-t threads] [-s seconds] [directory]\n");
+	exit(1);
+}
+
+
+static void*
+writer_thread(void* _data)
+{
+	struct thread_data* data = (struct thread_data*)_data;
+	char record[RECORD_SIZE];
+
+	memset(record, 'x', sizeof(record));
+
+	while (!sStop) {
+		if (write(data->fd, record, sizeof(record)) != sizeof(record)
+			|| fsync(data->fd) != 0) {
+			data->error = errno;
+			break;
+		}
+		data->count++;
+	}
+
+	return NULL;
+}
+
+
+static unsigned long
+run(int threadCount)
+{
+	struct thread_data threads[MAX_THREADS];
+	unsigned long total = 0;
+	int i;
+
+	memset(threads, 0, sizeof(threads));
+	sStop = 0;
+
+	for (i = 0; i < threadCount; i++) {
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s/file%d", sBase, i);
+
+		threads[i].fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+		if (threads[i].fd < 0) {
+			fprintf(stderr, "fsyncbench: could not create \"%s\": %s\n",
+				path, strerror(errno));
+			exit(1);
+		}
+	}
+
+	for (i = 0; i < threadCount; i++)
+		pthread_create(&threads[i].thread, NULL, writer_thread, &threads[i]);
+
+	sleep(sSeconds);
+	sStop = 1;
+
+	for (i = 0; i < threadCount; i++) {
+		char path[PATH_MAX];
+
+		pthread_join(threads[i].thread, NULL);
+		total += threads[i].count;
+
+		if (threads[i].error != 0) {
+			fprintf(stderr, "fsyncbench: thread %d failed: %s\n", i,
+				strerror(threads[i].error));
+		}
+
+		close(threads[i].fd);
+		snprintf(path, sizeof(path), "%s/file%d", sBase, i);
+		unlink(path);
+	}
+
+	return total;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int maxThreads = 16;
+	int threads;
+	int c;
+
+	while ((c = getopt(argc, argv, "ht:s:")) != -1) {
+		switch (c) {
+			case 't':
+				maxThreads = atoi(optarg);
+				break;
+			case 's':
+				sSeconds = atoi(optarg);
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (maxThreads < 1 || maxThreads > MAX_THREADS || sSeconds < 1)
+		usage();
+
+	snprintf(sBase, sizeof(sBase), "%s/fsyncbench-%" B_PRId32,
+		optind < argc ? argv[optind] : "/tmp", find_thread(NULL));
+	if (mkdir(sBase, 0755) != 0) {
+		fprintf(stderr, "fsyncbench: could not create \"%s\": %s\n", sBase,
+			strerror(errno));
+		return 1;
+	}
+
+	printf("%d byte records, fsync() after every one\n", RECORD_SIZE);
+
+	threads = 1;
+	while (true) {
+		unsigned long total = run(threads);
+		printf("%3d writers: %8lu fsync()s/s\n", threads, total / sSeconds);
+
+		if (threads == maxThreads)
+			break;
+		threads = threads * 2 < maxThreads ? threads * 2 : maxThreads;
+	}
+
+	rmdir(sBase);
+	return 0;
+}
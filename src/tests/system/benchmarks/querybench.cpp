@@ -0,0 +1,193 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Query benchmark.
+ *
+ * Generates a mail corpus -- empty files with MAIL:from and MAIL:when
+ * attributes -- on the volume of the given directory, and measures how long
+ * a few typical queries combining both attributes take.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fs_attr.h>
+#include <fs_index.h>
+#include <fs_query.h>
+#include <OS.h>
+#include <TypeConstants.h>
+
+
+static const int32 kSenders = 256;
+static const int32 kStartTime = 1000000000;
+static const int32 kTimeStep = 60;
+
+
+static void
+usage()
+{
+	printf("querybench [-n mails] [-k] <directory>\n"
+		"  -n  the number of mails to generate (default: 100000)\n"
+		"  -k  keep the generated mails\n");
+	exit(1);
+}
+
+
+static void
+ensure_index(dev_t device, const char* name, uint32 type)
+{
+	if (fs_create_index(device, name, type, 0) != 0 && errno != B_FILE_EXISTS) {
+		fprintf(stderr, "querybench: could not create index \"%s\": %s\n",
+			name, strerror(errno));
+		exit(1);
+	}
+}
+
+
+static void
+sender_name(int32 index, char* buffer, size_t size)
+{
+	snprintf(buffer, size, "sender%" B_PRId32 "@example.com", index);
+}
+
+
+static void
+create_mails(const char* base, int32 count)
+{
+	for (int32 i = 0; i < count; i++) {
+		char path[B_PATH_NAME_LENGTH];
+		snprintf(path, sizeof(path), "%s/mail%" B_PRId32, base, i);
+
+		int fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+		if (fd < 0) {
+			fprintf(stderr, "querybench: could not create \"%s\": %s\n",
+				path, strerror(errno));
+			exit(1);
+		}
+
+		// a few senders write most of the mails
+		char from[64];
+		sender_name((i * 7919) % (i % 4 == 0 ? kSenders : 8), from,
+			sizeof(from));
+		int32 when = kStartTime + i * kTimeStep;
+
+		fs_write_attr(fd, "MAIL:from", B_STRING_TYPE, 0, from,
+			strlen(from) + 1);
+		fs_write_attr(fd, "MAIL:when", B_INT32_TYPE, 0, &when, sizeof(when));
+		close(fd);
+	}
+}
+
+
+static void
+remove_mails(const char* base, int32 count)
+{
+	for (int32 i = 0; i < count; i++) {
+		char path[B_PATH_NAME_LENGTH];
+		snprintf(path, sizeof(path), "%s/mail%" B_PRId32, base, i);
+		unlink(path);
+	}
+}
+
+
+static void
+run_query(dev_t device, const char* query)
+{
+	bigtime_t start = system_time();
+
+	DIR* dir = fs_open_query(device, query, 0);
+	if (dir == NULL) {
+		fprintf(stderr, "querybench: could not open query \"%s\": %s\n",
+			query, strerror(errno));
+		return;
+	}
+
+	int32 count = 0;
+	while (fs_read_query(dir) != NULL)
+		count++;
+
+	fs_close_query(dir);
+
+	bigtime_t time = system_time() - start;
+	printf("%8" B_PRId32 " results, %10.3f ms: %s\n", count, time / 1000.0,
+		query);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int32 count = 100000;
+	bool keep = false;
+	int c;
+
+	while ((c = getopt(argc, argv, "hkn:")) != -1) {
+		switch (c) {
+			case 'k':
+				keep = true;
+				break;
+			case 'n':
+				count = atoi(optarg);
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (optind >= argc || count < 1)
+		usage();
+
+	const char* base = argv[optind];
+	struct stat st;
+	if (stat(base, &st) != 0 || !S_ISDIR(st.st_mode)) {
+		fprintf(stderr, "querybench: \"%s\" is not a directory\n", base);
+		return 1;
+	}
+
+	dev_t device = st.st_dev;
+	ensure_index(device, "MAIL:from", B_STRING_TYPE);
+	ensure_index(device, "MAIL:when", B_INT32_TYPE);
+
+	printf("generating %" B_PRId32 " mails...\n", count);
+	create_mails(base, count);
+
+	char from[64];
+	sender_name(3, from, sizeof(from));
+	char rareFrom[64];
+	sender_name(kSenders - 1, rareFrom, sizeof(rareFrom));
+	int32 recent = kStartTime + (count - count / 100) * kTimeStep;
+	int32 middle = kStartTime + count / 2 * kTimeStep;
+
+	char query[256];
+	snprintf(query, sizeof(query), "(MAIL:from==\"%s\")", from);
+	run_query(device, query);
+
+	snprintf(query, sizeof(query), "(MAIL:when>%" B_PRId32 ")", recent);
+	run_query(device, query);
+
+	snprintf(query, sizeof(query),
+		"((MAIL:from==\"%s\")&&(MAIL:when>%" B_PRId32 "))", from, recent);
+	run_query(device, query);
+
+	snprintf(query, sizeof(query),
+		"((MAIL:from==\"%s\")&&(MAIL:when>%" B_PRId32 "))", rareFrom, middle);
+	run_query(device, query);
+
+	snprintf(query, sizeof(query),
+		"((MAIL:when>%" B_PRId32 ")&&((MAIL:from==\"%s\")"
+			"||(MAIL:from==\"%s\")))", middle, from, rareFrom);
+	run_query(device, query);
+
+	if (!keep)
+		remove_mails(base, count);
+
+	return 0;
+}
@@ -0,0 +1,206 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Multi-threaded stat() benchmark.
+ *
+ * Creates a directory tree resembling a compiler's include path and lets a
+ * number of threads stat() files in it (and files that don't exist) for a
+ * given time, as a parallel build's header search does.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+#define DEPTH			6
+#define FILES			64
+#define MAX_THREADS		64
+
+static char sBase[PATH_MAX];
+static char sPaths[FILES * 2][PATH_MAX];
+static int sSeconds = 5;
+static volatile int sStop = 0;
+
+struct thread_data {
+	pthread_t		thread;
+	unsigned long	count;
+	unsigned long	failed;
+};
+
+
+static void
+usage(void)
+{
+	printf("statbench [-t threads] [-s seconds] [directory]\n");
+	exit(1);
+}
+
+
+static void
+create_tree(void)
+{
+	char path[PATH_MAX];
+	int i;
+
+	strlcpy(path, sBase, sizeof(path));
+	mkdir(path, 0755);
+
+	for (i = 0; i < DEPTH; i++) {
+		char component[32];
+		snprintf(component, sizeof(component), "/level%d", i);
+		strlcat(path, component, sizeof(path));
+		if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+			fprintf(stderr, "statbench: could not create \"%s\": %s\n", path,
+				strerror(errno));
+			exit(1);
+		}
+	}
+
+	for (i = 0; i < FILES; i++) {
+		int fd;
+
+		snprintf(sPaths[i], PATH_MAX, "%s/header%d.h", path, i);
+		fd = open(sPaths[i], O_CREAT | O_WRONLY, 0644);
+		if (fd < 0) {
+			fprintf(stderr, "statbench: could not create \"%s\": %s\n",
+				sPaths[i], strerror(errno));
+			exit(1);
+		}
+		close(fd);
+
+		// and one that doesn't exist for every one that does
+		snprintf(sPaths[FILES + i], PATH_MAX, "%s/missing%d.h", path, i);
+	}
+}
+
+
+static void
+remove_tree(void)
+{
+	char path[PATH_MAX];
+	int i;
+
+	for (i = 0; i < FILES; i++)
+		unlink(sPaths[i]);
+
+	for (i = DEPTH; i >= 0; i--) {
+		int j;
+
+		strlcpy(path, sBase, sizeof(path));
+		for (j = 0; j < i; j++) {
+			char component[32];
+			snprintf(component, sizeof(component), "/level%d", j);
+			strlcat(path, component, sizeof(path));
+		}
+		rmdir(path);
+	}
+}
+
+
+static void*
+stat_thread(void* _data)
+{
+	struct thread_data* data = (struct thread_data*)_data;
+	struct stat st;
+	unsigned int seed = (unsigned int)find_thread(NULL);
+
+	while (!sStop) {
+		int i;
+		for (i = 0; i < 64; i++) {
+			seed = seed * 1103515245 + 12345;
+			if (stat(sPaths[(seed >> 8) % (FILES * 2)], &st) != 0)
+				data->failed++;
+			data->count++;
+		}
+	}
+
+	return NULL;
+}
+
+
+static unsigned long
+run(int threadCount)
+{
+	struct thread_data threads[MAX_THREADS];
+	unsigned long total = 0;
+	int i;
+
+	memset(threads, 0, sizeof(threads));
+	sStop = 0;
+
+	for (i = 0; i < threadCount; i++)
+		pthread_create(&threads[i].thread, NULL, stat_thread, &threads[i]);
+
+	sleep(sSeconds);
+	sStop = 1;
+
+	for (i = 0; i < threadCount; i++) {
+		pthread_join(threads[i].thread, NULL);
+		total += threads[i].count;
+	}
+
+	return total;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	system_info info;
+	int maxThreads;
+	int threads;
+	int c;
+
+	get_system_info(&info);
+	maxThreads = info.cpu_count;
+
+	while ((c = getopt(argc, argv, "ht:s:")) != -1) {
+		switch (c) {
+			case 't':
+				maxThreads = atoi(optarg);
+				break;
+			case 's':
+				sSeconds = atoi(optarg);
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (maxThreads < 1 || maxThreads > MAX_THREADS || sSeconds < 1)
+		usage();
+
+	snprintf(sBase, sizeof(sBase), "%s/statbench-%" B_PRId32,
+		optind < argc ? argv[optind] : "/tmp", find_thread(NULL));
+
+	create_tree();
+
+	printf("%d levels deep, half of the lookups fail\n", DEPTH);
+
+	threads = 1;
+	while (true) {
+		unsigned long total = run(threads);
+		printf("%3d threads: %10lu stat()s/s\n", threads, total / sSeconds);
+
+		if (threads == maxThreads)
+			break;
+		threads = threads * 2 < maxThreads ? threads * 2 : maxThreads;
+	}
+
+	remove_tree();
+	return 0;
+}
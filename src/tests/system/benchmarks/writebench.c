@@ -0,0 +1,195 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Concurrent large write benchmark.
+ *
+ * Lets a number of threads each write a large file at the same time, and
+ * reports the combined throughput. With -k, the files are kept afterwards,
+ * so that their layout on disk can be inspected (with "bfsinfo -i" on BFS,
+ * for example) to see how fragmented concurrent writing left them.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+#define MAX_THREADS		64
+#define CHUNK_SIZE		(64 * 1024)
+
+static char sBase[PATH_MAX];
+static off_t sFileSize = 64 * 1024 * 1024;
+static bool sKeepFiles = false;
+
+struct thread_data {
+	pthread_t		thread;
+	int				index;
+	int				error;
+};
+
+
+static void
+usage(void)
+{
+	printf("writebench [-t threads] [-m megabytes per file] [-k] "
+		"[directory]\n");
+	exit(1);
+}
+
+
+static void*
+writer_thread(void* _data)
+{
+	struct thread_data* data = (struct thread_data*)_data;
+	char path[PATH_MAX];
+	char* chunk;
+	off_t written = 0;
+	int fd;
+
+	chunk = malloc(CHUNK_SIZE);
+	if (chunk == NULL) {
+		data->error = ENOMEM;
+		return NULL;
+	}
+	memset(chunk, data->index, CHUNK_SIZE);
+
+	snprintf(path, sizeof(path), "%s/file%d", sBase, data->index);
+	fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+	if (fd < 0) {
+		data->error = errno;
+		free(chunk);
+		return NULL;
+	}
+
+	while (written < sFileSize) {
+		if (write(fd, chunk, CHUNK_SIZE) != CHUNK_SIZE) {
+			data->error = errno;
+			break;
+		}
+		written += CHUNK_SIZE;
+	}
+
+	if (data->error == 0 && fsync(fd) != 0)
+		data->error = errno;
+
+	close(fd);
+	free(chunk);
+	return NULL;
+}
+
+
+static void
+remove_files(int threadCount)
+{
+	int i;
+
+	for (i = 0; i < threadCount; i++) {
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s/file%d", sBase, i);
+		unlink(path);
+	}
+}
+
+
+static void
+run(int threadCount)
+{
+	struct thread_data threads[MAX_THREADS];
+	bigtime_t start;
+	bigtime_t time;
+	int i;
+
+	memset(threads, 0, sizeof(threads));
+
+	start = system_time();
+
+	for (i = 0; i < threadCount; i++) {
+		threads[i].index = i;
+		pthread_create(&threads[i].thread, NULL, writer_thread, &threads[i]);
+	}
+
+	for (i = 0; i < threadCount; i++) {
+		pthread_join(threads[i].thread, NULL);
+
+		if (threads[i].error != 0) {
+			fprintf(stderr, "writebench: writer %d failed: %s\n", i,
+				strerror(threads[i].error));
+		}
+	}
+
+	time = system_time() - start;
+
+	printf("%3d writers: %8.1f MB/s\n", threadCount,
+		(double)sFileSize * threadCount / time);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int maxThreads = 8;
+	int threads;
+	int c;
+
+	while ((c = getopt(argc, argv, "hkm:t:")) != -1) {
+		switch (c) {
+			case 'k':
+				sKeepFiles = true;
+				break;
+			case 'm':
+				sFileSize = (off_t)atoi(optarg) * 1024 * 1024;
+				break;
+			case 't':
+				maxThreads = atoi(optarg);
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (maxThreads < 1 || maxThreads > MAX_THREADS || sFileSize <= 0)
+		usage();
+
+	snprintf(sBase, sizeof(sBase), "%s/writebench-%" B_PRId32,
+		optind < argc ? argv[optind] : "/tmp", find_thread(NULL));
+	if (mkdir(sBase, 0755) != 0) {
+		fprintf(stderr, "writebench: could not create \"%s\": %s\n", sBase,
+			strerror(errno));
+		return 1;
+	}
+
+	printf("%" B_PRIdOFF " MB per file, written in %d KB chunks\n",
+		sFileSize / 1024 / 1024, CHUNK_SIZE / 1024);
+
+	threads = 1;
+	while (true) {
+		run(threads);
+
+		if (threads == maxThreads)
+			break;
+
+		remove_files(threads);
+		threads = threads * 2 < maxThreads ? threads * 2 : maxThreads;
+	}
+
+	if (sKeepFiles) {
+		printf("files of the last run kept in \"%s\"\n", sBase);
+		return 0;
+	}
+
+	remove_files(threads);
+	rmdir(sBase);
+	return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+#include <generic_syscall.h>
+#include <syscalls.h>
+#include <vfs_defs.h>
+
+
+extern const char* __progname;
+
+
+static status_t
+get_statistics(entry_cache_statistics& statistics)
+{
+	return _kern_generic_syscall(ENTRY_CACHE_SYSCALLS,
+		ENTRY_CACHE_GET_STATISTICS, &statistics, sizeof(statistics));
+}
+
+
+static void
+print_statistics(const entry_cache_statistics& statistics,
+	const entry_cache_statistics* before)
+{
+	int64 hits = statistics.hits;
+	int64 negativeHits = statistics.negative_hits;
+	int64 misses = statistics.misses;
+	if (before != NULL) {
+		hits -= before->hits;
+		negativeHits -= before->negative_hits;
+		misses -= before->misses;
+	}
+
+	int64 lookups = hits + negativeHits + misses;
+	printf("entries:       %10" B_PRId32 " (max %" B_PRId32 ")\n",
+		statistics.entries, statistics.max_entries);
+	printf("hits:          %10" B_PRId64 "\n", hits);
+	printf("negative hits: %10" B_PRId64 "\n", negativeHits);
+	printf("misses:        %10" B_PRId64 "\n", misses);
+	if (lookups > 0) {
+		printf("hit rate:      %10.1f%%\n",
+			100.0 * (hits + negativeHits) / lookups);
+	}
+}
+
+
+int
+main(int argc, char** argv)
+{
+	uint32 version = 0;
+	if (_kern_generic_syscall(ENTRY_CACHE_SYSCALLS, B_SYSCALL_INFO, &version,
+			sizeof(version)) != B_OK) {
+		fprintf(stderr, "%s: The entry cache syscalls are not available on "
+			"this system.\n", __progname);
+		return 1;
+	}
+
+	entry_cache_statistics before;
+	status_t status = get_statistics(before);
+	if (status != B_OK) {
+		fprintf(stderr, "%s: Could not get statistics: %s\n", __progname,
+			strerror(status));
+		return 1;
+	}
+
+	if (argc < 2) {
+		print_statistics(before, NULL);
+		return 0;
+	}
+
+	// run the given command and print the statistics for its run only
+	pid_t child = fork();
+	if (child == 0) {
+		execvp(argv[1], argv + 1);
+		fprintf(stderr, "%s: Could not execute \"%s\": %s\n", __progname,
+			argv[1], strerror(errno));
+		exit(1);
+	}
+
+	bigtime_t startTime = system_time();
+	int childStatus;
+	waitpid(child, &childStatus, 0);
+	bigtime_t totalTime = system_time() - startTime;
+
+	entry_cache_statistics after;
+	get_statistics(after);
+
+	printf("\n%s took %.2f s\n", argv[1], totalTime / 1000000.0);
+	print_statistics(after, &before);
+	return 0;
+}
@@ -0,0 +1,405 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Compares the throughput of the packet filter interpreter of the network
+	stack against its translated code. Before that, it makes sure that both
+	come to the same results, for a few typical filters, as well as for
+	random programs that pass the verifier.
+*/
+
+
+#include <OS.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bpf.h"
+
+
+static const bpf_insn kTcpPort80[] = {
+	// tcpdump -dd "tcp port 80"
+	BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x86dd, 0, 6),
+	BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 20),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 6, 0, 15),
+	BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 54),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 80, 12, 0),
+	BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 56),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 80, 10, 11),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x800, 0, 10),
+	BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 23),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 6, 0, 8),
+	BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 20),
+	BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1fff, 6, 0),
+	BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 14),
+	BPF_STMT(BPF_LD | BPF_H | BPF_IND, 14),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 80, 2, 0),
+	BPF_STMT(BPF_LD | BPF_H | BPF_IND, 16),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 80, 0, 1),
+	BPF_STMT(BPF_RET | BPF_K, 262144),
+	BPF_STMT(BPF_RET | BPF_K, 0),
+};
+
+static const bpf_insn kAcceptAll[] = {
+	BPF_STMT(BPF_RET | BPF_K, 0xffffffff),
+};
+
+static const bpf_insn kChecksum[] = {
+	// sums up the 16 bit words of the IPv4 header, and accepts the packet
+	// if it adds up
+	BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 14),
+	BPF_STMT(BPF_LD | BPF_W | BPF_IMM, 0),
+	BPF_STMT(BPF_ST, 0),
+	BPF_STMT(BPF_LD | BPF_W | BPF_IMM, 14),
+	BPF_STMT(BPF_ST, 1),
+	// loop, unrolled for the 10 words of a header without options
+#define ADD_WORD(index) \
+	BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 14 + 2 * index), \
+	BPF_STMT(BPF_LDX | BPF_W | BPF_MEM, 0), \
+	BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0), \
+	BPF_STMT(BPF_ST, 0)
+	ADD_WORD(0), ADD_WORD(1), ADD_WORD(2), ADD_WORD(3), ADD_WORD(4),
+	ADD_WORD(5), ADD_WORD(6), ADD_WORD(7), ADD_WORD(8), ADD_WORD(9),
+#undef ADD_WORD
+	// fold the carries
+	BPF_STMT(BPF_MISC | BPF_TAX, 0),
+	BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 16),
+	BPF_STMT(BPF_ST, 2),
+	BPF_STMT(BPF_MISC | BPF_TXA, 0),
+	BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xffff),
+	BPF_STMT(BPF_LDX | BPF_W | BPF_MEM, 2),
+	BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+	BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, 0x10000),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0xffff, 0, 1),
+	BPF_STMT(BPF_RET | BPF_A, 0),
+	BPF_STMT(BPF_RET | BPF_K, 0),
+};
+
+struct filter_info {
+	const char*		name;
+	const bpf_insn*	instructions;
+	uint32			count;
+};
+
+static const filter_info kFilters[] = {
+	{ "tcp port 80", kTcpPort80, sizeof(kTcpPort80) / sizeof(bpf_insn) },
+	{ "accept all", kAcceptAll, sizeof(kAcceptAll) / sizeof(bpf_insn) },
+	{ "ip checksum", kChecksum, sizeof(kChecksum) / sizeof(bpf_insn) },
+};
+static const uint32 kFilterCount = sizeof(kFilters) / sizeof(kFilters[0]);
+
+static const size_t kMaxPacketSize = 128;
+static const uint32 kPacketCount = 4;
+static const int kRandomPrograms = 20000;
+static const uint32 kMaxRandomInstructions = 64;
+
+static uint8 sPackets[kPacketCount][kMaxPacketSize];
+static uint32 sPacketSizes[kPacketCount];
+
+static int64 sIterations = 10000000;
+
+
+static double
+current_time()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+static void
+set_word(uint8* data, uint32 offset, uint16 value)
+{
+	data[offset] = value >> 8;
+	data[offset + 1] = value & 0xff;
+}
+
+
+static void
+fill_ipv4_checksum(uint8* data)
+{
+	uint32 sum = 0;
+	for (uint32 i = 0; i < 20; i += 2)
+		sum += (data[14 + i] << 8) | data[14 + i + 1];
+	sum = (sum & 0xffff) + (sum >> 16);
+	set_word(data, 14 + 10, ~sum & 0xffff);
+}
+
+
+static void
+create_packets()
+{
+	// IPv4 TCP to port 80
+	uint8* data = sPackets[0];
+	set_word(data, 12, 0x800);
+	data[14] = 0x45;
+	set_word(data, 16, 40);
+	data[22] = 64;
+	data[23] = 6;
+	memcpy(data + 26, "\x0a\x00\x00\x01\x0a\x00\x00\x02", 8);
+	set_word(data, 34, 43210);
+	set_word(data, 36, 80);
+	fill_ipv4_checksum(data);
+	sPacketSizes[0] = 54;
+
+	// IPv4 UDP
+	data = sPackets[1];
+	memcpy(data, sPackets[0], 54);
+	data[23] = 17;
+	fill_ipv4_checksum(data);
+	sPacketSizes[1] = 60;
+
+	// IPv6 TCP to port 80
+	data = sPackets[2];
+	set_word(data, 12, 0x86dd);
+	data[14] = 0x60;
+	data[20] = 6;
+	set_word(data, 56, 80);
+	sPacketSizes[2] = 74;
+
+	// a runt
+	data = sPackets[3];
+	set_word(data, 12, 0x800);
+	sPacketSizes[3] = 16;
+}
+
+
+static status_t
+read_packet(void* cookie, uint32 offset, void* data, size_t size)
+{
+	memcpy(data, (const uint8*)cookie + offset, size);
+	return B_OK;
+}
+
+
+static bpf_packet
+make_packet(uint32 index, bool split)
+{
+	bpf_packet packet;
+	packet.data = sPackets[index];
+	packet.length = sPacketSizes[index];
+	packet.data_length = split ? min_c(packet.length, 14) : packet.length;
+	packet.read = read_packet;
+	packet.cookie = sPackets[index];
+	return packet;
+}
+
+
+static bpf_jit_function
+compile(const bpf_insn* instructions, uint32 count, area_id& area)
+{
+	size_t size;
+	if (bpf_jit_compile(instructions, count, NULL, &size) != B_OK)
+		return NULL;
+
+	void* code;
+	area = create_area("bpf filter", &code, B_ANY_ADDRESS,
+		(size + B_PAGE_SIZE - 1) & ~(B_PAGE_SIZE - 1), B_NO_LOCK,
+		B_READ_AREA | B_WRITE_AREA);
+	if (area < 0)
+		return NULL;
+
+	if (bpf_jit_compile(instructions, count, (uint8*)code, &size) != B_OK
+		|| set_area_protection(area, B_READ_AREA | B_EXECUTE_AREA) != B_OK) {
+		delete_area(area);
+		return NULL;
+	}
+
+	return (bpf_jit_function)code;
+}
+
+
+static bool
+compare(const char* name, const bpf_insn* instructions, uint32 count)
+{
+	area_id area;
+	bpf_jit_function function = compile(instructions, count, area);
+	if (function == NULL) {
+		fprintf(stderr, "%s: could not compile\n", name);
+		return false;
+	}
+
+	bool success = true;
+	for (uint32 i = 0; i < kPacketCount && success; i++) {
+		for (int split = 0; split < 2; split++) {
+			bpf_packet packet = make_packet(i, split != 0);
+			uint32 expected = bpf_interpret(instructions, &packet);
+			uint32 result = function(&packet);
+			if (result != expected) {
+				fprintf(stderr, "%s: packet %" B_PRIu32 "%s: interpreted %"
+					B_PRIu32 ", compiled %" B_PRIu32 "\n", name, i,
+					split ? " (split)" : "", expected, result);
+				success = false;
+			}
+		}
+	}
+
+	delete_area(area);
+	return success;
+}
+
+
+static void
+random_instruction(bpf_insn& instruction, uint32 remaining)
+{
+	static const uint16 kCodes[] = {
+		BPF_LD | BPF_W | BPF_IMM, BPF_LD | BPF_W | BPF_ABS,
+		BPF_LD | BPF_H | BPF_ABS, BPF_LD | BPF_B | BPF_ABS,
+		BPF_LD | BPF_W | BPF_IND, BPF_LD | BPF_H | BPF_IND,
+		BPF_LD | BPF_B | BPF_IND, BPF_LD | BPF_W | BPF_LEN,
+		BPF_LD | BPF_W | BPF_MEM, BPF_LDX | BPF_W | BPF_IMM,
+		BPF_LDX | BPF_W | BPF_LEN, BPF_LDX | BPF_W | BPF_MEM,
+		BPF_LDX | BPF_B | BPF_MSH, BPF_ST, BPF_STX,
+		BPF_ALU | BPF_ADD | BPF_K, BPF_ALU | BPF_SUB | BPF_K,
+		BPF_ALU | BPF_MUL | BPF_K, BPF_ALU | BPF_DIV | BPF_K,
+		BPF_ALU | BPF_MOD | BPF_K, BPF_ALU | BPF_OR | BPF_K,
+		BPF_ALU | BPF_AND | BPF_K, BPF_ALU | BPF_XOR | BPF_K,
+		BPF_ALU | BPF_LSH | BPF_K, BPF_ALU | BPF_RSH | BPF_K,
+		BPF_ALU | BPF_NEG, BPF_ALU | BPF_ADD | BPF_X,
+		BPF_ALU | BPF_SUB | BPF_X, BPF_ALU | BPF_MUL | BPF_X,
+		BPF_ALU | BPF_DIV | BPF_X, BPF_ALU | BPF_MOD | BPF_X,
+		BPF_ALU | BPF_OR | BPF_X, BPF_ALU | BPF_AND | BPF_X,
+		BPF_ALU | BPF_XOR | BPF_X, BPF_ALU | BPF_LSH | BPF_X,
+		BPF_ALU | BPF_RSH | BPF_X, BPF_JMP | BPF_JA,
+		BPF_JMP | BPF_JEQ | BPF_K, BPF_JMP | BPF_JGT | BPF_K,
+		BPF_JMP | BPF_JGE | BPF_K, BPF_JMP | BPF_JSET | BPF_K,
+		BPF_JMP | BPF_JEQ | BPF_X, BPF_JMP | BPF_JGT | BPF_X,
+		BPF_JMP | BPF_JGE | BPF_X, BPF_JMP | BPF_JSET | BPF_X,
+		BPF_RET | BPF_K, BPF_RET | BPF_A, BPF_MISC | BPF_TAX,
+		BPF_MISC | BPF_TXA
+	};
+
+	instruction.code = kCodes[rand() % (sizeof(kCodes) / sizeof(kCodes[0]))];
+	instruction.jt = remaining > 0 ? rand() % remaining : 0;
+	instruction.jf = remaining > 0 ? rand() % remaining : 0;
+
+	switch (BPF_CLASS(instruction.code)) {
+		case BPF_LD:
+		case BPF_LDX:
+			// mostly within the packets, sometimes beyond
+			instruction.k = rand() % 8 == 0 ? rand() : rand() % 80;
+			if (BPF_MODE(instruction.code) == BPF_MEM)
+				instruction.k %= BPF_MEMWORDS;
+			break;
+		case BPF_ST:
+		case BPF_STX:
+			instruction.k = rand() % BPF_MEMWORDS;
+			break;
+		case BPF_ALU:
+			instruction.k = rand() % 4 == 0 ? rand() % 33 : rand();
+			break;
+		case BPF_JMP:
+			instruction.k = remaining > 0 ? rand() % remaining : 0;
+			if (BPF_OP(instruction.code) != BPF_JA && rand() % 2 == 0)
+				instruction.k = rand() % 256;
+			break;
+		default:
+			instruction.k = rand();
+			break;
+	}
+}
+
+
+static bool
+compare_random_programs()
+{
+	bpf_insn instructions[kMaxRandomInstructions];
+	int valid = 0;
+
+	for (int i = 0; i < kRandomPrograms; i++) {
+		uint32 count = 1 + rand() % kMaxRandomInstructions;
+		for (uint32 pc = 0; pc < count; pc++)
+			random_instruction(instructions[pc], count - pc - 1);
+		instructions[count - 1].code = rand() % 2 == 0
+			? BPF_RET | BPF_A : BPF_RET | BPF_K;
+
+		if (bpf_validate(instructions, count) != B_OK)
+			continue;
+
+		valid++;
+		if (!compare("random program", instructions, count))
+			return false;
+	}
+
+	printf("%d random programs, %d valid, all agree\n", kRandomPrograms,
+		valid);
+	return true;
+}
+
+
+static void
+benchmark(const filter_info& filter)
+{
+	area_id area;
+	bpf_jit_function function = compile(filter.instructions, filter.count,
+		area);
+
+	bpf_packet packets[kPacketCount];
+	for (uint32 i = 0; i < kPacketCount; i++)
+		packets[i] = make_packet(i, false);
+
+	uint32 accepted = 0;
+	double start = current_time();
+	for (int64 i = 0; i < sIterations; i++) {
+		accepted += bpf_interpret(filter.instructions,
+			&packets[i % kPacketCount]) != 0;
+	}
+	double interpreted = current_time() - start;
+
+	start = current_time();
+	for (int64 i = 0; i < sIterations; i++)
+		accepted += function(&packets[i % kPacketCount]) != 0;
+	double compiled = current_time() - start;
+
+	printf("%-12s %3" B_PRIu32 " instructions: interpreted %7.2f ns, "
+		"compiled %7.2f ns per packet (%4.1fx, %" B_PRIu32 ")\n", filter.name,
+		filter.count, interpreted * 1e9 / sIterations,
+		compiled * 1e9 / sIterations, interpreted / compiled, accepted);
+
+	delete_area(area);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	if (argc > 1)
+		sIterations = atoll(argv[1]);
+	if (sIterations <= 0) {
+		fprintf(stderr, "Usage: %s [<iterations>]\n", argv[0]);
+		return 1;
+	}
+
+	size_t size;
+	if (bpf_jit_compile(kAcceptAll, 1, NULL, &size) != B_OK) {
+		fprintf(stderr, "Filters are not translated on this architecture.\n");
+		return 1;
+	}
+
+	create_packets();
+	srand(0);
+
+	for (uint32 i = 0; i < kFilterCount; i++) {
+		if (bpf_validate(kFilters[i].instructions, kFilters[i].count) != B_OK) {
+			fprintf(stderr, "%s: invalid filter\n", kFilters[i].name);
+			return 1;
+		}
+		if (!compare(kFilters[i].name, kFilters[i].instructions,
+				kFilters[i].count))
+			return 1;
+	}
+	if (!compare_random_programs())
+		return 1;
+
+	for (uint32 i = 0; i < kFilterCount; i++)
+		benchmark(kFilters[i]);
+
+	return 0;
+}
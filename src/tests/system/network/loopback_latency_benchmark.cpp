@@ -0,0 +1,265 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures the round trip time of small messages bounced between two
+	threads over the loopback interface, using connected UDP sockets, and
+	a TCP connection, and reports its percentiles.
+*/
+
+
+#include <algorithm>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+
+static const size_t kMaxMessageSize = 65536;
+static const int kWarmUpRounds = 100;
+
+static int sRounds = 100000;
+static size_t sMessageSize = 32;
+
+
+static int64_t
+current_time()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+
+static bool
+receive_message(int fd, char* buffer, bool stream)
+{
+	size_t received = 0;
+	do {
+		ssize_t bytesRead = recv(fd, buffer + received,
+			sMessageSize - received, 0);
+		if (bytesRead < 0 && errno == EINTR)
+			continue;
+		if (bytesRead <= 0)
+			return false;
+
+		received += bytesRead;
+	} while (stream && received < sMessageSize);
+
+	return true;
+}
+
+
+static bool
+send_message(int fd, const char* buffer)
+{
+	while (true) {
+		ssize_t bytesWritten = send(fd, buffer, sMessageSize, 0);
+		if (bytesWritten < 0 && errno == EINTR)
+			continue;
+
+		// the messages are small enough to always be sent completely
+		return bytesWritten == (ssize_t)sMessageSize;
+	}
+}
+
+
+struct echo_context {
+	int		socket;
+	bool	stream;
+};
+
+
+static void*
+echo_thread(void* _context)
+{
+	echo_context& context = *(echo_context*)_context;
+	char buffer[kMaxMessageSize];
+
+	while (receive_message(context.socket, buffer, context.stream)) {
+		if (!send_message(context.socket, buffer))
+			break;
+	}
+
+	return NULL;
+}
+
+
+static bool
+create_udp_pair(int& client, int& server)
+{
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	sockaddr_in clientAddress = address;
+	socklen_t addressLength = sizeof(address);
+
+	client = socket(AF_INET, SOCK_DGRAM, 0);
+	server = socket(AF_INET, SOCK_DGRAM, 0);
+	if (client < 0 || server < 0
+		|| bind(server, (sockaddr*)&address, addressLength) != 0
+		|| getsockname(server, (sockaddr*)&address, &addressLength) != 0
+		|| bind(client, (sockaddr*)&clientAddress, addressLength) != 0
+		|| getsockname(client, (sockaddr*)&clientAddress, &addressLength) != 0
+		|| connect(client, (sockaddr*)&address, addressLength) != 0
+		|| connect(server, (sockaddr*)&clientAddress, addressLength) != 0)
+		return false;
+
+	return true;
+}
+
+
+static bool
+create_tcp_pair(int& client, int& server)
+{
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+	if (listener < 0)
+		return false;
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addressLength = sizeof(address);
+
+	client = -1;
+	server = -1;
+	if (bind(listener, (sockaddr*)&address, addressLength) == 0
+		&& listen(listener, 1) == 0
+		&& getsockname(listener, (sockaddr*)&address, &addressLength) == 0) {
+		client = socket(AF_INET, SOCK_STREAM, 0);
+		if (client >= 0
+			&& connect(client, (sockaddr*)&address, addressLength) == 0)
+			server = accept(listener, NULL, NULL);
+	}
+	close(listener);
+
+	if (client < 0 || server < 0)
+		return false;
+
+	int value = 1;
+	setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+	setsockopt(server, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+	return true;
+}
+
+
+static bool
+run(const char* name, bool stream)
+{
+	int client, server;
+	bool created = stream
+		? create_tcp_pair(client, server) : create_udp_pair(client, server);
+	if (!created) {
+		fprintf(stderr, "%s: could not create sockets: %s\n", name,
+			strerror(errno));
+		return false;
+	}
+
+	echo_context context = { server, stream };
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, &echo_thread, &context) != 0) {
+		fprintf(stderr, "%s: could not start echo thread\n", name);
+		return false;
+	}
+
+	int64_t* roundTrips = new int64_t[sRounds];
+	char buffer[kMaxMessageSize];
+	memset(buffer, 'x', sMessageSize);
+
+	bool success = true;
+	for (int i = -kWarmUpRounds; i < sRounds; i++) {
+		int64_t start = current_time();
+		if (!send_message(client, buffer)
+			|| !receive_message(client, buffer, stream)) {
+			fprintf(stderr, "%s: round %d failed: %s\n", name, i,
+				strerror(errno));
+			success = false;
+			break;
+		}
+		if (i >= 0)
+			roundTrips[i] = current_time() - start;
+	}
+
+	// closing our end makes the echo thread stop
+	shutdown(client, SHUT_RDWR);
+	close(client);
+	if (!stream)
+		shutdown(server, SHUT_RDWR);
+	pthread_join(thread, NULL);
+	close(server);
+
+	if (success) {
+		std::sort(roundTrips, roundTrips + sRounds);
+
+		int64_t total = 0;
+		for (int i = 0; i < sRounds; i++)
+			total += roundTrips[i];
+
+		printf("%-4s %7d rounds of %5zu bytes: min %7.2f, avg %7.2f, "
+			"p50 %7.2f, p99 %7.2f, max %8.2f us\n", name, sRounds,
+			sMessageSize, roundTrips[0] / 1000.0,
+			total / 1000.0 / sRounds, roundTrips[sRounds / 2] / 1000.0,
+			roundTrips[(int64_t)sRounds * 99 / 100] / 1000.0,
+			roundTrips[sRounds - 1] / 1000.0);
+	}
+
+	delete[] roundTrips;
+	return success;
+}
+
+
+static void
+usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [-n <rounds>] [-s <message size>] "
+		"[-t udp|tcp]\n", program);
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	bool runUDP = true;
+	bool runTCP = true;
+
+	int option;
+	while ((option = getopt(argc, argv, "n:s:t:h")) != -1) {
+		switch (option) {
+			case 'n':
+				sRounds = atoi(optarg);
+				break;
+			case 's':
+				sMessageSize = atoi(optarg);
+				break;
+			case 't':
+				runUDP = !strcmp(optarg, "udp");
+				runTCP = !strcmp(optarg, "tcp");
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (sRounds <= 0 || sMessageSize == 0 || sMessageSize > kMaxMessageSize
+		|| (!runUDP && !runTCP)) {
+		usage(argv[0]);
+	}
+
+	if (runUDP && !run("UDP", false))
+		return 1;
+	if (runTCP && !run("TCP", true))
+		return 1;
+
+	return 0;
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Counts the frames a device receives through a memory mapped packet
+	ring, or through packet capture with one recv() per frame, and reports
+	how many per second could be seen.
+*/
+
+
+#include <errno.h>
+#include <net/if.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/sockio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <packet_ring.h>
+
+
+static const size_t kMaxFrameSize = 65536;
+
+static uint32 sRingSize = 4096;
+static uint32 sFlags = 0;
+static double sDuration = 5.0;
+
+static volatile uint8 sTouched;
+
+
+static double
+current_time()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+static void
+report(const char* mode, int64_t frames, int64_t bytes, uint32 dropped,
+	double elapsed)
+{
+	printf("%-10s %10.0f frames/s, %8.2f MB/s, %u dropped\n", mode,
+		frames / elapsed, bytes / elapsed / 1e6, dropped);
+}
+
+
+static bool
+run_ring(int socket, const char* device)
+{
+	packet_ring_request request;
+	memset(&request, 0, sizeof(request));
+	strlcpy(request.name, device, IF_NAMESIZE);
+	request.flags = sFlags;
+	request.rx_size = sRingSize;
+
+	if (ioctl(socket, SIOCSPACKETRING, &request, sizeof(request)) != 0) {
+		fprintf(stderr, "could not set up the packet ring: %s\n",
+			strerror(errno));
+		return false;
+	}
+
+	packet_ring_header* header = request.ring;
+	packet_ring_descriptor* descriptors = (packet_ring_descriptor*)
+		((uint8*)header + header->rx_descriptors);
+	uint32 mask = header->rx_size - 1;
+	const char* mode = (header->flags & PACKET_RING_ZERO_COPY) != 0
+		? "zero copy" : "copy";
+
+	int64_t frames = 0;
+	int64_t bytes = 0;
+	double start = current_time();
+	double end = start + sDuration;
+
+	while (current_time() < end) {
+		uint32 consumer = header->rx.consumer;
+		uint32 producer = header->rx.producer;
+		if (consumer == producer) {
+			pollfd poller = { socket, POLLIN, 0 };
+			if (poll(&poller, 1, 100) < 0 && errno != EINTR)
+				break;
+			continue;
+		}
+
+		// the descriptors must not be read before the index that covers them
+		__sync_synchronize();
+
+		for (; consumer != producer; consumer++) {
+			const packet_ring_descriptor& descriptor
+				= descriptors[consumer & mask];
+			const uint8* frame = (const uint8*)request.rx_frames
+				+ descriptor.offset;
+
+			// touch the frame, as a real consumer would
+			if (descriptor.length > 0)
+				sTouched += frame[0];
+
+			bytes += descriptor.length;
+			frames++;
+		}
+
+		__sync_synchronize();
+		header->rx.consumer = consumer;
+	}
+
+	report(mode, frames, bytes, header->dropped, current_time() - start);
+
+	ioctl(socket, SIOCCPACKETRING, NULL, 0);
+	return true;
+}
+
+
+static bool
+run_capture(int socket, const char* device)
+{
+	ifreq request;
+	memset(&request, 0, sizeof(request));
+	strlcpy(request.ifr_name, device, IF_NAMESIZE);
+
+	if (ioctl(socket, SIOCSPACKETCAP, &request, sizeof(request)) != 0) {
+		fprintf(stderr, "could not start capturing: %s\n", strerror(errno));
+		return false;
+	}
+
+	// the receiver must not block forever when there is no traffic
+	timeval timeout = { 0, 100000 };
+	setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	static uint8 buffer[kMaxFrameSize];
+	int64_t frames = 0;
+	int64_t bytes = 0;
+	double start = current_time();
+	double end = start + sDuration;
+
+	while (current_time() < end) {
+		ssize_t bytesReceived = recv(socket, buffer, sizeof(buffer), 0);
+		if (bytesReceived < 0) {
+			if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+				continue;
+			break;
+		}
+
+		bytes += bytesReceived;
+		frames++;
+	}
+
+	report("capture", frames, bytes, 0, current_time() - start);
+
+	ioctl(socket, SIOCCPACKETCAP, &request, sizeof(request));
+	return true;
+}
+
+
+static void
+usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [-c|-z|-r] [-n <ring size>] [-t <seconds>] "
+		"<device>\n"
+		"  -c  copy frames into the ring (the default)\n"
+		"  -z  let the device receive into the ring, taking the queue away\n"
+		"      from the stack\n"
+		"  -r  use packet capture and recv() instead of a ring\n", program);
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	bool capture = false;
+
+	int option;
+	while ((option = getopt(argc, argv, "czrn:t:h")) != -1) {
+		switch (option) {
+			case 'c':
+				sFlags = PACKET_RING_COPY;
+				break;
+			case 'z':
+				sFlags = PACKET_RING_ZERO_COPY;
+				break;
+			case 'r':
+				capture = true;
+				break;
+			case 'n':
+				sRingSize = atoi(optarg);
+				break;
+			case 't':
+				sDuration = atof(optarg);
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1 || sRingSize == 0 || sDuration <= 0
+		|| (sRingSize & (sRingSize - 1)) != 0)
+		usage(argv[0]);
+
+	int socket = ::socket(AF_LINK, SOCK_DGRAM, 0);
+	if (socket < 0) {
+		fprintf(stderr, "could not create socket: %s\n", strerror(errno));
+		return 1;
+	}
+
+	bool success = capture
+		? run_capture(socket, argv[optind]) : run_ring(socket, argv[optind]);
+
+	close(socket);
+	return success ? 0 : 1;
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures the rate at which connections are accepted by a number of
+	threads, once sharing a single listening socket, and once each with its
+	own socket bound to the same port by means of SO_REUSEPORT.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+
+static const int kMaxListeners = 64;
+
+struct listener_context {
+	int				socket;
+	pthread_t		thread;
+	int32_t			accepted;
+};
+
+static listener_context sListeners[kMaxListeners];
+static int sListenerCount = 4;
+static int sClientCount = 4;
+static int sConnections = 5000;
+
+static volatile int32_t sConnectionsLeft;
+static volatile int32_t sAccepted;
+static sockaddr_in sAddress;
+
+
+static double
+current_time()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+static int
+create_listener(bool reusePort, uint16_t port)
+{
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+
+	int value = 1;
+	if (reusePort)
+		setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &value, sizeof(value));
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = port;
+	socklen_t addressLength = sizeof(address);
+	if (bind(fd, (sockaddr*)&address, addressLength) != 0
+		|| listen(fd, 128) != 0
+		|| getsockname(fd, (sockaddr*)&sAddress, &addressLength) != 0) {
+		close(fd);
+		return -1;
+	}
+
+	// several threads may wait for the same socket
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+	return fd;
+}
+
+
+static void*
+accept_thread(void* _context)
+{
+	listener_context& context = *(listener_context*)_context;
+
+	while (__sync_fetch_and_add(&sAccepted, 0) < sConnections) {
+		pollfd pollInfo = { context.socket, POLLIN, 0 };
+		if (poll(&pollInfo, 1, 100) <= 0)
+			continue;
+
+		int fd = accept(context.socket, NULL, NULL);
+		if (fd < 0)
+			continue;
+
+		// closing first leaves the TIME_WAIT state to us, not to the
+		// client's ephemeral ports
+		close(fd);
+		context.accepted++;
+		__sync_fetch_and_add(&sAccepted, 1);
+	}
+
+	return NULL;
+}
+
+
+static void*
+client_thread(void*)
+{
+	while (__sync_fetch_and_sub(&sConnectionsLeft, 1) > 0) {
+		int fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0) {
+			perror("socket");
+			exit(1);
+		}
+		if (connect(fd, (sockaddr*)&sAddress, sizeof(sAddress)) != 0) {
+			perror("connect");
+			exit(1);
+		}
+
+		// wait for the server to close the connection
+		char buffer[16];
+		while (read(fd, buffer, sizeof(buffer)) > 0)
+			;
+		close(fd);
+	}
+
+	return NULL;
+}
+
+
+static bool
+run(bool reusePort)
+{
+	sConnectionsLeft = sConnections;
+	sAccepted = 0;
+
+	for (int i = 0; i < sListenerCount; i++) {
+		sListeners[i].accepted = 0;
+		if (i == 0 || reusePort) {
+			sListeners[i].socket = create_listener(reusePort,
+				i == 0 ? 0 : sAddress.sin_port);
+			if (sListeners[i].socket < 0) {
+				fprintf(stderr, "Could not create listener: %s\n",
+					strerror(errno));
+				return false;
+			}
+		} else
+			sListeners[i].socket = sListeners[0].socket;
+	}
+
+	double start = current_time();
+
+	for (int i = 0; i < sListenerCount; i++)
+		pthread_create(&sListeners[i].thread, NULL, &accept_thread,
+			&sListeners[i]);
+
+	pthread_t clients[kMaxListeners];
+	for (int i = 0; i < sClientCount; i++)
+		pthread_create(&clients[i], NULL, &client_thread, NULL);
+	for (int i = 0; i < sClientCount; i++)
+		pthread_join(clients[i], NULL);
+	for (int i = 0; i < sListenerCount; i++)
+		pthread_join(sListeners[i].thread, NULL);
+
+	double elapsed = current_time() - start;
+
+	printf("%-12s %6d connections in %7.3f s: %9.1f accepts/s\n",
+		reusePort ? "SO_REUSEPORT" : "shared", sConnections, elapsed,
+		sConnections / elapsed);
+	printf("  per thread:");
+	for (int i = 0; i < sListenerCount; i++)
+		printf(" %d", sListeners[i].accepted);
+	printf("\n");
+
+	for (int i = 0; i < sListenerCount; i++) {
+		if (i == 0 || reusePort)
+			close(sListeners[i].socket);
+	}
+	return true;
+}
+
+
+static void
+usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [-l <listener threads>] [-c <client threads>] "
+		"[-n <connections>]\n", program);
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int option;
+	while ((option = getopt(argc, argv, "l:c:n:h")) != -1) {
+		switch (option) {
+			case 'l':
+				sListenerCount = atoi(optarg);
+				break;
+			case 'c':
+				sClientCount = atoi(optarg);
+				break;
+			case 'n':
+				sConnections = atoi(optarg);
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (sListenerCount <= 0 || sListenerCount > kMaxListeners
+		|| sClientCount <= 0 || sClientCount > kMaxListeners
+		|| sConnections <= 0) {
+		usage(argv[0]);
+	}
+
+	if (!run(false) || !run(true))
+		return 1;
+
+	return 0;
+}
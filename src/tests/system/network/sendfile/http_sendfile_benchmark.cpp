@@ -0,0 +1,327 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures the throughput of a minimal HTTP server that serves a static
+	file over the loopback interface, once copying the file through a
+	userland buffer, and once using sendfile().
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+
+static const size_t kBufferSize = 64 * 1024;
+
+enum transfer_mode {
+	READ_WRITE,
+	SEND_FILE
+};
+
+struct server_context {
+	int				listener;
+	int				file;
+	off_t			size;
+	transfer_mode	mode;
+};
+
+
+static double
+current_time()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+static bool
+write_fully(int fd, const void* data, size_t length)
+{
+	const char* buffer = (const char*)data;
+	while (length > 0) {
+		ssize_t bytesWritten = write(fd, buffer, length);
+		if (bytesWritten < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+
+		buffer += bytesWritten;
+		length -= bytesWritten;
+	}
+	return true;
+}
+
+
+static bool
+send_body(server_context& context, int socket)
+{
+	off_t offset = 0;
+
+	if (context.mode == SEND_FILE) {
+		while (offset < context.size) {
+			ssize_t bytesSent = sendfile(socket, context.file, &offset,
+				context.size - offset);
+			if (bytesSent < 0 && errno != EINTR) {
+				fprintf(stderr, "sendfile() failed: %s\n", strerror(errno));
+				return false;
+			}
+			if (bytesSent == 0)
+				break;
+		}
+		return true;
+	}
+
+	static char buffer[kBufferSize];
+	while (offset < context.size) {
+		ssize_t bytesRead = pread(context.file, buffer, kBufferSize, offset);
+		if (bytesRead <= 0)
+			return false;
+		if (!write_fully(socket, buffer, bytesRead))
+			return false;
+
+		offset += bytesRead;
+	}
+	return true;
+}
+
+
+static void*
+server_thread(void* _context)
+{
+	server_context& context = *(server_context*)_context;
+
+	while (true) {
+		int socket = accept(context.listener, NULL, NULL);
+		if (socket < 0)
+			break;
+
+		// read the request; we serve the same file no matter what is asked
+		char request[1024];
+		size_t requestLength = 0;
+		while (requestLength < sizeof(request) - 1) {
+			ssize_t bytesRead = read(socket, request + requestLength,
+				sizeof(request) - 1 - requestLength);
+			if (bytesRead <= 0)
+				break;
+
+			requestLength += bytesRead;
+			request[requestLength] = '\0';
+			if (strstr(request, "\r\n\r\n") != NULL)
+				break;
+		}
+
+		char header[256];
+		int headerLength = snprintf(header, sizeof(header),
+			"HTTP/1.0 200 OK\r\n"
+			"Content-Type: application/octet-stream\r\n"
+			"Content-Length: %lld\r\n"
+			"\r\n", (long long)context.size);
+
+		if (write_fully(socket, header, headerLength))
+			send_body(context, socket);
+
+		close(socket);
+	}
+
+	return NULL;
+}
+
+
+static off_t
+fetch(const sockaddr_in& address)
+{
+	int socket = ::socket(AF_INET, SOCK_STREAM, 0);
+	if (socket < 0)
+		return -1;
+
+	if (connect(socket, (const sockaddr*)&address, sizeof(address)) < 0) {
+		close(socket);
+		return -1;
+	}
+
+	static const char kRequest[] = "GET /file HTTP/1.0\r\n\r\n";
+	write_fully(socket, kRequest, sizeof(kRequest) - 1);
+
+	static char buffer[kBufferSize];
+	off_t total = 0;
+	off_t bodyStart = -1;
+	while (true) {
+		ssize_t bytesRead = read(socket, buffer, kBufferSize);
+		if (bytesRead < 0 && errno == EINTR)
+			continue;
+		if (bytesRead <= 0)
+			break;
+
+		if (bodyStart < 0) {
+			// the header is short enough to arrive in the first read
+			char* end = (char*)memmem(buffer, bytesRead, "\r\n\r\n", 4);
+			if (end != NULL)
+				bodyStart = total + end + 4 - buffer;
+		}
+		total += bytesRead;
+	}
+
+	close(socket);
+	return bodyStart >= 0 ? total - bodyStart : -1;
+}
+
+
+static bool
+run(server_context& context, const sockaddr_in& address, int requests,
+	const char* name)
+{
+	double start = current_time();
+
+	for (int i = 0; i < requests; i++) {
+		off_t size = fetch(address);
+		if (size != context.size) {
+			fprintf(stderr, "%s: request %d returned %lld instead of %lld "
+				"bytes\n", name, i, (long long)size, (long long)context.size);
+			return false;
+		}
+	}
+
+	double elapsed = current_time() - start;
+	printf("%-10s %6d requests in %7.3f s: %9.2f MB/s, %8.1f requests/s\n",
+		name, requests, elapsed,
+		context.size * (double)requests / elapsed / (1024 * 1024),
+		requests / elapsed);
+	return true;
+}
+
+
+static int
+create_test_file(const char* path, off_t size)
+{
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return -1;
+
+	static char buffer[kBufferSize];
+	for (size_t i = 0; i < kBufferSize; i++)
+		buffer[i] = (char)(i * 7 + 3);
+
+	for (off_t offset = 0; offset < size; offset += kBufferSize) {
+		size_t length = size - offset < (off_t)kBufferSize
+			? size - offset : kBufferSize;
+		if (!write_fully(fd, buffer, length)) {
+			close(fd);
+			return -1;
+		}
+	}
+
+	return fd;
+}
+
+
+static void
+usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [-n <requests>] [-s <size in KB>] [file]\n"
+		"Serves the file (or a generated one of the given size) over HTTP on "
+		"the\nloopback interface, using read()/write() and sendfile().\n",
+		program);
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int requests = 100;
+	off_t size = 16 * 1024 * 1024;
+
+	int option;
+	while ((option = getopt(argc, argv, "n:s:h")) != -1) {
+		switch (option) {
+			case 'n':
+				requests = atoi(optarg);
+				break;
+			case 's':
+				size = atoll(optarg) * 1024;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (requests <= 0 || size <= 0 || argc - optind > 1)
+		usage(argv[0]);
+
+	server_context context;
+	char tempPath[] = "/tmp/http_sendfile_benchmark.XXXXXX";
+
+	if (optind < argc) {
+		context.file = open(argv[optind], O_RDONLY);
+		struct stat stat;
+		if (context.file < 0 || fstat(context.file, &stat) != 0) {
+			fprintf(stderr, "Could not open \"%s\": %s\n", argv[optind],
+				strerror(errno));
+			return 1;
+		}
+		context.size = stat.st_size;
+	} else {
+		int fd = mkstemp(tempPath);
+		if (fd >= 0)
+			close(fd);
+		context.file = fd >= 0 ? create_test_file(tempPath, size) : -1;
+		if (context.file < 0) {
+			fprintf(stderr, "Could not create test file: %s\n",
+				strerror(errno));
+			return 1;
+		}
+		unlink(tempPath);
+		context.size = size;
+	}
+
+	context.listener = socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addressLength = sizeof(address);
+	if (context.listener < 0
+		|| bind(context.listener, (sockaddr*)&address, addressLength) != 0
+		|| listen(context.listener, 16) != 0
+		|| getsockname(context.listener, (sockaddr*)&address,
+			&addressLength) != 0) {
+		fprintf(stderr, "Could not create listener: %s\n", strerror(errno));
+		return 1;
+	}
+
+	printf("Serving %lld bytes on port %d\n", (long long)context.size,
+		ntohs(address.sin_port));
+
+	context.mode = READ_WRITE;
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, &server_thread, &context) != 0) {
+		fprintf(stderr, "Could not start server thread\n");
+		return 1;
+	}
+
+	// the server only picks up the mode between requests
+	bool success = run(context, address, requests, "read/write");
+	context.mode = SEND_FILE;
+	success = success && run(context, address, requests, "sendfile");
+
+	shutdown(context.listener, SHUT_RDWR);
+	close(context.listener);
+	pthread_join(thread, NULL);
+	close(context.file);
+
+	return success ? 0 : 1;
+}
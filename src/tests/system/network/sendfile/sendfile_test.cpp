@@ -0,0 +1,206 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: check failed: %s (%s)\n", __FILE__, \
+				__LINE__, #condition, strerror(errno)); \
+			exit(1); \
+		} \
+	} while (false)
+
+
+static const size_t kFileSize = 3 * 1024 * 1024 + 1234;
+
+
+static char
+data_at(off_t offset)
+{
+	return (char)(offset * 7 + 3);
+}
+
+
+static int
+create_file()
+{
+	char path[] = "/tmp/sendfile_test.XXXXXX";
+	int fd = mkstemp(path);
+	CHECK(fd >= 0);
+	unlink(path);
+
+	char buffer[4096];
+	for (off_t offset = 0; offset < (off_t)kFileSize;) {
+		size_t length = kFileSize - offset < sizeof(buffer)
+			? kFileSize - offset : sizeof(buffer);
+		for (size_t i = 0; i < length; i++)
+			buffer[i] = data_at(offset + i);
+		CHECK(write(fd, buffer, length) == (ssize_t)length);
+		offset += length;
+	}
+
+	CHECK(lseek(fd, 0, SEEK_SET) == 0);
+	return fd;
+}
+
+
+static void
+create_connection(int& client, int& server)
+{
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+	CHECK(listener >= 0);
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addressLength = sizeof(address);
+	CHECK(bind(listener, (sockaddr*)&address, addressLength) == 0);
+	CHECK(listen(listener, 1) == 0);
+	CHECK(getsockname(listener, (sockaddr*)&address, &addressLength) == 0);
+
+	client = socket(AF_INET, SOCK_STREAM, 0);
+	CHECK(client >= 0);
+	CHECK(connect(client, (sockaddr*)&address, addressLength) == 0);
+	server = accept(listener, NULL, NULL);
+	CHECK(server >= 0);
+	close(listener);
+}
+
+
+/*!	Reads \a length bytes from \a fd, and checks that they match the file
+	contents starting at \a offset.
+*/
+static void
+check_received(int fd, off_t offset, size_t length)
+{
+	char buffer[65536];
+	while (length > 0) {
+		ssize_t bytesRead = read(fd, buffer,
+			length < sizeof(buffer) ? length : sizeof(buffer));
+		CHECK(bytesRead > 0);
+
+		for (ssize_t i = 0; i < bytesRead; i++)
+			CHECK(buffer[i] == data_at(offset + i));
+
+		offset += bytesRead;
+		length -= bytesRead;
+	}
+}
+
+
+static void
+test_sendfile_socket(int file)
+{
+	int client, server;
+	create_connection(client, server);
+
+	// with an explicit offset, the file position stays where it is
+	off_t offset = 1000;
+	ssize_t bytesSent = sendfile(server, file, &offset, 200000);
+	CHECK(bytesSent == 200000);
+	CHECK(offset == 201000);
+	CHECK(lseek(file, 0, SEEK_CUR) == 0);
+	check_received(client, 1000, 200000);
+
+	// without one, the file position is used, and updated; more than is left
+	// in the file only sends what there is
+	CHECK(lseek(file, 5, SEEK_SET) == 5);
+	off_t sent = 0;
+	while (sent < (off_t)kFileSize - 5) {
+		bytesSent = sendfile(server, file, NULL, kFileSize);
+		CHECK(bytesSent > 0);
+		check_received(client, 5 + sent, bytesSent);
+		sent += bytesSent;
+	}
+	CHECK(lseek(file, 0, SEEK_CUR) == (off_t)kFileSize);
+
+	// at the end of the file, there is nothing left to send
+	CHECK(sendfile(server, file, NULL, 100) == 0);
+
+	close(client);
+	close(server);
+}
+
+
+static void
+test_sendfile_fallback(int file)
+{
+	// a pipe cannot take any file pages, the data is copied instead
+	int pipes[2];
+	CHECK(pipe(pipes) == 0);
+
+	off_t offset = 12345;
+	CHECK(sendfile(pipes[1], file, &offset, 1000) == 1000);
+	CHECK(offset == 13345);
+	check_received(pipes[0], 12345, 1000);
+
+	// the source has to be a regular file
+	errno = 0;
+	CHECK(sendfile(pipes[1], pipes[0], NULL, 1000) == -1 && errno == EINVAL);
+
+	close(pipes[0]);
+	close(pipes[1]);
+}
+
+
+static void
+test_splice(int file)
+{
+	int client, server;
+	create_connection(client, server);
+
+	int pipes[2];
+	CHECK(pipe(pipes) == 0);
+
+	// file -> pipe -> socket
+	off_t offset = 4096;
+	CHECK(splice(file, &offset, pipes[1], NULL, 30000, 0) == 30000);
+	CHECK(offset == 4096 + 30000);
+	CHECK(splice(pipes[0], NULL, server, NULL, 30000, SPLICE_F_MORE)
+		== 30000);
+	check_received(client, 4096, 30000);
+
+	// pipes have no position
+	errno = 0;
+	CHECK(splice(file, &offset, pipes[1], &offset, 10, 0) == -1
+		&& errno == ESPIPE);
+
+	// one end has to be a pipe
+	errno = 0;
+	CHECK(splice(file, &offset, server, NULL, 10, 0) == -1 && errno == EINVAL);
+
+	close(pipes[0]);
+	close(pipes[1]);
+	close(client);
+	close(server);
+}
+
+
+int
+main()
+{
+	int file = create_file();
+
+	test_sendfile_socket(file);
+	test_sendfile_fallback(file);
+	test_splice(file);
+
+	close(file);
+	printf("All tests passed.\n");
+	return 0;
+}
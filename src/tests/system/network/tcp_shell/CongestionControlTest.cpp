@@ -0,0 +1,214 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "BBRCongestionControl.h"
+#include "CubicCongestionControl.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+static const uint32 kSegmentSize = 1000;
+
+
+/*!	Acknowledges a full window in segment sized steps, spread evenly over
+	one round trip starting at \a now.
+*/
+static void
+acknowledge_window(CongestionControl& control, uint32& window,
+	bigtime_t now, bigtime_t roundTripTime)
+{
+	uint32 segments = window / kSegmentSize;
+	for (uint32 i = 0; i < segments; i++) {
+		control.Acknowledged(kSegmentSize, window,
+			now + roundTripTime * i / segments);
+	}
+}
+
+
+static void
+test_registry()
+{
+	uint32 window = 0;
+	uint32 threshold = 0;
+	CongestionControl* control;
+
+	ASSERT(create_congestion_control(NULL, window, threshold, &control)
+		== B_OK);
+	ASSERT(strcmp(control->Name(), "reno") == 0);
+	delete control;
+
+	ASSERT(create_congestion_control("vegas", window, threshold, &control)
+		== B_ENTRY_NOT_FOUND);
+	ASSERT(set_default_congestion_control("vegas") == B_ENTRY_NOT_FOUND);
+
+	ASSERT(set_default_congestion_control("cubic") == B_OK);
+	ASSERT(strcmp(default_congestion_control(), "cubic") == 0);
+	ASSERT(create_congestion_control(NULL, window, threshold, &control)
+		== B_OK);
+	ASSERT(strcmp(control->Name(), "cubic") == 0);
+	delete control;
+
+	ASSERT(create_congestion_control("bbr", window, threshold, &control)
+		== B_OK);
+	ASSERT(strcmp(control->Name(), "bbr") == 0);
+	delete control;
+
+	set_default_congestion_control("reno");
+}
+
+
+static void
+test_cube_root()
+{
+	ASSERT(CubicCongestionControl::CubeRoot(0) == 0);
+	ASSERT(CubicCongestionControl::CubeRoot(1) == 1);
+	ASSERT(CubicCongestionControl::CubeRoot(7) == 1);
+	ASSERT(CubicCongestionControl::CubeRoot(8) == 2);
+	ASSERT(CubicCongestionControl::CubeRoot(999999) == 99);
+	ASSERT(CubicCongestionControl::CubeRoot(1000000) == 100);
+	ASSERT(CubicCongestionControl::CubeRoot(75000000000ULL) == 4217);
+	ASSERT(CubicCongestionControl::CubeRoot(UINT64_MAX) == 2642245);
+}
+
+
+static void
+test_cubic()
+{
+	uint32 window = 0;
+	uint32 threshold = UINT32_MAX;
+	CubicCongestionControl cubic(window, threshold);
+	cubic.SetMaxSegmentSize(kSegmentSize);
+	cubic.Start();
+	ASSERT(window == 4 * kSegmentSize);
+
+	// a loss at a window of 100 segments reduces it by 30%
+	const bigtime_t kRoundTripTime = 100000;
+	window = 100 * kSegmentSize;
+	cubic.RoundTripTimeSample(kRoundTripTime, 0);
+	cubic.LossDetected(window, 0);
+	ASSERT(threshold == 70 * kSegmentSize);
+	cubic.RecoveryFinished(window);
+	ASSERT(window == 70 * kSegmentSize);
+
+	// K = cbrt(W_max * (1 - beta) / C) = cbrt(100 * 0.3 / 0.4) = 4.2 s; the
+	// window grows quickly at first, and then levels off around W_max
+	bigtime_t now = kRoundTripTime;
+	uint32 previous = window;
+	uint32 firstGrowth = 0;
+	for (; now < 4000000; now += kRoundTripTime) {
+		acknowledge_window(cubic, window, now, kRoundTripTime);
+		ASSERT(window >= previous);
+		if (firstGrowth == 0)
+			firstGrowth = window - previous;
+		previous = window;
+	}
+	ASSERT(window > 95 * kSegmentSize && window <= 100 * kSegmentSize);
+
+	acknowledge_window(cubic, window, now, kRoundTripTime);
+	now += kRoundTripTime;
+	ASSERT(window - previous < firstGrowth);
+
+	// and then probes beyond it, faster and faster
+	for (; now < 8000000; now += kRoundTripTime)
+		acknowledge_window(cubic, window, now, kRoundTripTime);
+	ASSERT(window > 110 * kSegmentSize);
+
+	// fast convergence: a loss below the previous maximum lowers it further
+	cubic.LossDetected(window, now);
+	cubic.RecoveryFinished(window);
+	uint32 reduced = window;
+	cubic.LossDetected(window, now);
+	cubic.RecoveryFinished(window);
+	ASSERT(window == reduced * 7 / 10);
+
+	// a timeout restarts with slow start up to the new threshold
+	cubic.RetransmitTimeout(window);
+	ASSERT(window == kSegmentSize);
+	cubic.Acknowledged(kSegmentSize, window, now);
+	ASSERT(window == 2 * kSegmentSize);
+}
+
+
+static void
+test_bbr()
+{
+	uint32 window = 0;
+	uint32 threshold = 0;
+	BBRCongestionControl bbr(window, threshold);
+	bbr.SetMaxSegmentSize(kSegmentSize);
+	bbr.Start();
+	ASSERT(threshold == UINT32_MAX);
+	ASSERT(bbr.TargetWindow() == 0);
+
+	// a path of 1 MB/s and 50 ms, ie. a bandwidth-delay product of 50 KB,
+	// in front of a large buffer
+	const uint64 kBandwidth = 1000000;
+	const bigtime_t kRoundTripTime = 50000;
+	const uint32 kBandwidthDelayProduct = 50000;
+
+	bigtime_t now = 1000000;
+	uint32 delivered = 0;
+	bbr.Delivered(delivered, window, now);
+
+	for (int32 round = 0; round < 40; round++) {
+		// everything beyond the bandwidth-delay product queues up
+		uint32 flightSize = window;
+		bigtime_t roundTripTime = max_c(kRoundTripTime,
+			(bigtime_t)((uint64)flightSize * 1000000 / kBandwidth));
+		uint32 segments = flightSize / kSegmentSize;
+
+		for (uint32 i = 1; i <= segments; i++) {
+			bigtime_t time = now + roundTripTime * i / segments;
+			delivered += kSegmentSize;
+			flightSize -= kSegmentSize;
+
+			bbr.RoundTripTimeSample(roundTripTime, time);
+			bbr.Delivered(delivered, flightSize, time);
+			bbr.Acknowledged(kSegmentSize, flightSize, time);
+		}
+		now += roundTripTime;
+	}
+
+	ASSERT(bbr.MinRoundTripTime() == kRoundTripTime);
+	ASSERT(bbr.Bandwidth() > kBandwidth * 9 / 10
+		&& bbr.Bandwidth() <= kBandwidth * 11 / 10);
+
+	// in PROBE_BW, the window stays within 1.5 to 2.5 times the
+	// bandwidth-delay product
+	ASSERT(bbr.TargetWindow() >= kBandwidthDelayProduct * 3 / 2
+		&& bbr.TargetWindow() <= kBandwidthDelayProduct * 5 / 2);
+	ASSERT(window <= kBandwidthDelayProduct * 5 / 2);
+
+	// losses don't change the model
+	uint64 bandwidth = bbr.Bandwidth();
+	uint32 previous = window;
+	bbr.LossDetected(window, now);
+	ASSERT(bbr.Bandwidth() == bandwidth);
+	bbr.RecoveryFinished(window / 2);
+	ASSERT(window == previous);
+
+	// after ten seconds without a lower round trip time, the window is
+	// reduced to drain the queue
+	now += 10 * 1000000;
+	bbr.RoundTripTimeSample(kRoundTripTime, now);
+	ASSERT(bbr.TargetWindow() == 4 * kSegmentSize);
+	bbr.Acknowledged(kSegmentSize, window, now);
+	ASSERT(window == 4 * kSegmentSize);
+}
+
+
+int
+main()
+{
+	test_registry();
+	test_cube_root();
+	test_cubic();
+	test_bbr();
+
+	printf("All tests passed.\n");
+	return 0;
+}
@@ -0,0 +1,286 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "offload.h"
+#include "utility.h"
+
+#include <net_socket.h>
+#include <NetUtilities.h>
+
+#include <net/if_types.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <stdio.h>
+#include <string.h>
+
+
+extern "C" status_t _add_builtin_module(module_info *info);
+
+extern struct net_buffer_module_info gNetBufferModule;
+	// from net_buffer.cpp
+
+struct net_socket_module_info gNetSocketModule;
+
+
+static const size_t kLinkHeaderLength = 14;
+static const size_t kTransportHeaderLength = 32;
+	// with the timestamp option
+static const size_t kHeaderLength = kLinkHeaderLength + sizeof(ip)
+	+ kTransportHeaderLength;
+static const uint16 kSegmentSize = 1000;
+static const uint32 kDataSize = 3500;
+static const uint32 kSequence = 100000;
+
+enum {
+	kPush = 0x08,
+	kAcknowledge = 0x10,
+	kWindowReduced = 0x80
+};
+
+
+static uint8
+data_at(uint32 offset)
+{
+	return (uint8)(offset * 7 + 3);
+}
+
+
+static uint16
+tcp_checksum(net_buffer* buffer, size_t networkOffset)
+{
+	ip header;
+	gNetBufferModule.read(buffer, networkOffset, &header, sizeof(ip));
+	size_t transportOffset = networkOffset + sizeof(ip);
+	uint16 length = buffer->size - transportOffset;
+
+	Checksum checksum;
+	checksum << (uint32)header.ip_src.s_addr << (uint32)header.ip_dst.s_addr
+		<< (uint16)htons(IPPROTO_TCP) << (uint16)htons(length)
+		<< (uint16)gNetBufferModule.checksum(buffer, transportOffset, length,
+			false);
+	return checksum;
+}
+
+
+/*!	Creates a buffer as TCP passes it on for segmentation, including the
+	link header.
+*/
+static net_buffer*
+create_large_segment(uint16 port, uint32 sequence, uint32 dataSize,
+	uint8 flags)
+{
+	uint8 header[kHeaderLength];
+	memset(header, 0, sizeof(header));
+
+	ip& ipv4 = *(ip*)(header + kLinkHeaderLength);
+	ipv4.ip_v = 4;
+	ipv4.ip_hl = sizeof(ip) >> 2;
+	ipv4.ip_len = htons(sizeof(ip) + kTransportHeaderLength + dataSize);
+	ipv4.ip_id = htons(42);
+	ipv4.ip_ttl = 64;
+	ipv4.ip_p = IPPROTO_TCP;
+	ipv4.ip_src.s_addr = htonl(0xc0a80001);
+	ipv4.ip_dst.s_addr = htonl(0xc0a80002);
+	ipv4.ip_sum = ~compute_checksum((uint8*)&ipv4, sizeof(ip));
+
+	uint8* tcp = header + kLinkHeaderLength + sizeof(ip);
+	*(uint16*)tcp = htons(port);
+	*(uint16*)(tcp + 2) = htons(80);
+	*(uint32*)(tcp + 4) = htonl(sequence);
+	*(uint32*)(tcp + 8) = htonl(1);
+	tcp[12] = (kTransportHeaderLength >> 2) << 4;
+	tcp[13] = flags;
+	*(uint16*)(tcp + 14) = htons(8192);
+	// timestamp option
+	tcp[20] = tcp[21] = 1;
+	tcp[22] = 8;
+	tcp[23] = 10;
+	*(uint32*)(tcp + 24) = htonl(12345);
+
+	net_buffer* buffer = gNetBufferModule.create(256);
+	gNetBufferModule.append(buffer, header, sizeof(header));
+	for (uint32 i = 0; i < dataSize; i++) {
+		uint8 value = data_at(sequence - kSequence + i);
+		gNetBufferModule.append(buffer, &value, 1);
+	}
+
+	// the pseudo header sum, as set by TCP
+	Checksum checksum;
+	checksum << (uint32)ipv4.ip_src.s_addr << (uint32)ipv4.ip_dst.s_addr
+		<< (uint16)htons(IPPROTO_TCP)
+		<< (uint16)htons(kTransportHeaderLength + dataSize);
+	uint16 partial = checksum.Folded();
+	gNetBufferModule.write(buffer, kLinkHeaderLength + sizeof(ip) + 16,
+		&partial, sizeof(partial));
+
+	buffer->offload_flags = NET_BUFFER_SEGMENT_TCP
+		| NET_BUFFER_CHECKSUM_PARTIAL;
+	buffer->segment_size = kSegmentSize;
+	buffer->checksum_offset = 16;
+	buffer->transport_size = kTransportHeaderLength + dataSize;
+	return buffer;
+}
+
+
+static void
+check_data(net_buffer* buffer, size_t headerLength, uint32 dataOffset)
+{
+	for (uint32 i = headerLength; i < buffer->size; i++) {
+		uint8 value;
+		gNetBufferModule.read(buffer, i, &value, 1);
+		ASSERT(value == data_at(dataOffset + i - headerLength));
+	}
+}
+
+
+static void
+test_segmentation(net_device& device, net_buffer** segments,
+	int32& segmentCount)
+{
+	net_buffer* buffer = create_large_segment(1024, kSequence, kDataSize,
+		kAcknowledge | kPush);
+
+	device.offload = NET_DEVICE_OFFLOAD_TSO4;
+	ASSERT(!needs_software_segmentation(&device, buffer));
+	device.offload = NET_DEVICE_OFFLOAD_TSO6 | NET_DEVICE_OFFLOAD_GSO;
+	ASSERT(needs_software_segmentation(&device, buffer));
+
+	struct list list;
+	list_init(&list);
+	ASSERT(segment_buffer(&device, buffer, &list) == B_OK);
+
+	segmentCount = 0;
+	net_buffer* segment;
+	while ((segment = (net_buffer*)list_remove_head_item(&list)) != NULL) {
+		int32 index = segmentCount;
+		uint32 dataSize = min_c(kDataSize - index * kSegmentSize,
+			kSegmentSize);
+		ASSERT(segment->size == kHeaderLength + dataSize);
+		ASSERT((segment->offload_flags & NET_BUFFER_CHECKSUM_PARTIAL) == 0);
+
+		uint8 header[kHeaderLength];
+		gNetBufferModule.read(segment, 0, header, sizeof(header));
+		ip& ipv4 = *(ip*)(header + kLinkHeaderLength);
+		ASSERT(ntohs(ipv4.ip_len) == segment->size - kLinkHeaderLength);
+		ASSERT(ntohs(ipv4.ip_id) == 42 + index);
+		ASSERT(compute_checksum((uint8*)&ipv4, sizeof(ip)) == 0xffff);
+
+		uint8* tcp = header + kLinkHeaderLength + sizeof(ip);
+		ASSERT(ntohl(*(uint32*)(tcp + 4))
+			== kSequence + index * kSegmentSize);
+		ASSERT(tcp[13] == (kAcknowledge | (index == 3 ? kPush : 0)));
+		ASSERT(*(uint32*)(tcp + 24) == htonl(12345));
+		ASSERT(tcp_checksum(segment, kLinkHeaderLength) == 0);
+
+		check_data(segment, kHeaderLength, index * kSegmentSize);
+		segments[segmentCount++] = segment;
+	}
+	ASSERT(segmentCount == 4);
+
+	gNetBufferModule.free(buffer);
+
+	// with checksum offload, the segments are left to the device
+	device.offload |= NET_DEVICE_OFFLOAD_TX_CHECKSUM;
+	buffer = create_large_segment(1024, kSequence, kDataSize,
+		kAcknowledge | kWindowReduced);
+	list_init(&list);
+	ASSERT(segment_buffer(&device, buffer, &list) == B_OK);
+	for (int32 index = 0; (segment
+			= (net_buffer*)list_remove_head_item(&list)) != NULL; index++) {
+		uint8 flags;
+		gNetBufferModule.read(segment, kLinkHeaderLength + sizeof(ip) + 13,
+			&flags, sizeof(flags));
+		ASSERT(flags == (kAcknowledge | (index == 0 ? kWindowReduced : 0)));
+		ASSERT((segment->offload_flags & NET_BUFFER_CHECKSUM_PARTIAL) != 0);
+		ASSERT(segment->transport_size
+			== segment->size - kLinkHeaderLength - sizeof(ip));
+		ASSERT(complete_checksum(segment) == B_OK);
+		ASSERT(tcp_checksum(segment, kLinkHeaderLength) == 0);
+		gNetBufferModule.free(segment);
+	}
+	gNetBufferModule.free(buffer);
+}
+
+
+static net_buffer*
+received(net_buffer* buffer)
+{
+	// as after deframing
+	gNetBufferModule.remove_header(buffer, kLinkHeaderLength);
+	buffer->offload_flags = 0;
+	buffer->type = B_NET_FRAME_TYPE_IPV4;
+	return buffer;
+}
+
+
+static void
+test_coalescing(net_buffer** segments)
+{
+	net_fifo fifo;
+	ASSERT(init_fifo(&fifo, "offload test", 1024 * 1024) == B_OK);
+
+	for (int32 i = 0; i < 4; i++)
+		received(segments[i]);
+
+	// nothing to coalesce with
+	ASSERT(coalesce_received_buffers(&fifo, segments[0]) == NULL);
+
+	// out of order, and of another flow
+	net_buffer* other = create_large_segment(1025, kSequence + kSegmentSize,
+		kSegmentSize, kAcknowledge);
+	ASSERT(complete_checksum(other) == B_OK);
+	received(other);
+	ASSERT(fifo_enqueue_buffer(&fifo, segments[2]) == B_OK);
+	ASSERT(coalesce_received_buffers(&fifo, segments[0]) == segments[2]);
+	ASSERT(segments[0]->size == kHeaderLength - kLinkHeaderLength
+		+ kSegmentSize);
+	ASSERT(fifo_enqueue_buffer(&fifo, other) == B_OK);
+	ASSERT(coalesce_received_buffers(&fifo, segments[1]) == other);
+	ASSERT(segments[1]->size == kHeaderLength - kLinkHeaderLength
+		+ kSegmentSize);
+	gNetBufferModule.free(other);
+
+	// in order: the segments are merged into the first one
+	ASSERT(fifo_enqueue_buffer(&fifo, segments[1]) == B_OK);
+	ASSERT(fifo_enqueue_buffer(&fifo, segments[2]) == B_OK);
+	ASSERT(fifo_enqueue_buffer(&fifo, segments[3]) == B_OK);
+	ASSERT(coalesce_received_buffers(&fifo, segments[0]) == NULL);
+
+	net_buffer* buffer = segments[0];
+	ASSERT(buffer->size == kHeaderLength - kLinkHeaderLength + kDataSize);
+	ASSERT((buffer->offload_flags & NET_BUFFER_CHECKSUM_VALID) != 0);
+
+	uint8 header[kHeaderLength - kLinkHeaderLength];
+	gNetBufferModule.read(buffer, 0, header, sizeof(header));
+	ip& ipv4 = *(ip*)header;
+	ASSERT(ntohs(ipv4.ip_len) == buffer->size);
+	ASSERT(compute_checksum(header, sizeof(ip)) == 0xffff);
+	ASSERT(header[sizeof(ip) + 13] == (kAcknowledge | kPush));
+	check_data(buffer, sizeof(header), 0);
+
+	gNetBufferModule.free(buffer);
+	uninit_fifo(&fifo);
+}
+
+
+int
+main()
+{
+	_add_builtin_module((module_info*)&gNetBufferModule);
+
+	net_device device;
+	memset(&device, 0, sizeof(device));
+	device.type = IFT_ETHER;
+	device.header_length = kLinkHeaderLength;
+
+	net_buffer* segments[4];
+	int32 segmentCount;
+	test_segmentation(device, segments, segmentCount);
+	test_coalescing(segments);
+
+	printf("All tests passed.\n");
+	return 0;
+}
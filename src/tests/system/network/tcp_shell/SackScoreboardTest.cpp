@@ -0,0 +1,182 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "SackScoreboard.h"
+#include "TransmitTimeline.h"
+
+#include <stdio.h>
+
+
+static const uint32 kSegmentSize = 1000;
+
+
+static bool
+update(SackScoreboard& scoreboard, uint32 acknowledge, uint32 sendMax,
+	uint32 left, uint32 right)
+{
+	tcp_sack sack;
+	sack.left_edge = left;
+	sack.right_edge = right;
+	return scoreboard.Update(acknowledge, sendMax, &sack, 1);
+}
+
+
+static void
+test_loss_detection()
+{
+	SackScoreboard scoreboard;
+
+	// ten segments in flight from 1000, the first two are lost, as are the
+	// ones at 5000 and 7000
+	ASSERT(update(scoreboard, 1000, 11000, 3000, 5000));
+	ASSERT(update(scoreboard, 1000, 11000, 6000, 7000));
+	ASSERT(update(scoreboard, 1000, 11000, 8000, 9000));
+	ASSERT(!update(scoreboard, 1000, 11000, 8000, 9000));
+	ASSERT(scoreboard.SackedBytes() == 4000);
+
+	ASSERT(scoreboard.IsSacked(3500));
+	ASSERT(!scoreboard.IsSacked(2000));
+	ASSERT(!scoreboard.IsSacked(9000));
+
+	// three discontiguous blocks above
+	ASSERT(scoreboard.IsLost(1000, kSegmentSize));
+	// two blocks, and not more than two segments above
+	ASSERT(!scoreboard.IsLost(5000, kSegmentSize));
+	ASSERT(!scoreboard.IsLost(3000, kSegmentSize));
+
+	// the holes that are not lost, and the unSACKed data at the end
+	ASSERT(scoreboard.Pipe(1000, 11000, 1000, kSegmentSize) == 4000);
+	// the retransmitted data is in the pipe, too
+	ASSERT(scoreboard.Pipe(1000, 11000, 3000, kSegmentSize) == 6000);
+
+	tcp_sequence start;
+	uint32 length;
+	ASSERT(scoreboard.NextLost(1000, 1000, kSegmentSize, start, length));
+	ASSERT(start == 1000 && length == 1000);
+	ASSERT(scoreboard.NextLost(1000, 2000, kSegmentSize, start, length));
+	ASSERT(start == 2000 && length == 1000);
+	ASSERT(!scoreboard.NextLost(1000, 3000, kSegmentSize, start, length));
+
+	scoreboard.Dump();
+}
+
+
+static void
+test_merge_and_acknowledge()
+{
+	SackScoreboard scoreboard;
+
+	update(scoreboard, 1000, 11000, 3000, 5000);
+	update(scoreboard, 1000, 11000, 6000, 7000);
+	update(scoreboard, 1000, 11000, 8000, 9000);
+
+	// fills the hole between the first two blocks
+	ASSERT(update(scoreboard, 1000, 11000, 5000, 6000));
+	ASSERT(scoreboard.SackedBytes() == 5000);
+	ASSERT(scoreboard.IsSacked(5500));
+	ASSERT(!scoreboard.IsSacked(7500));
+
+	// overlaps both remaining blocks
+	ASSERT(update(scoreboard, 1000, 11000, 4000, 8500));
+	ASSERT(scoreboard.SackedBytes() == 6000);
+	ASSERT(scoreboard.IsSacked(7500));
+
+	scoreboard.RemoveUntil(4000);
+	ASSERT(scoreboard.SackedBytes() == 5000);
+	ASSERT(!scoreboard.IsSacked(3500));
+
+	// D-SACKs and blocks beyond the data sent are ignored
+	ASSERT(!update(scoreboard, 4000, 11000, 2000, 3000));
+	ASSERT(!update(scoreboard, 4000, 11000, 10000, 12000));
+	ASSERT(scoreboard.SackedBytes() == 5000);
+
+	scoreboard.RemoveUntil(11000);
+	ASSERT(scoreboard.IsEmpty());
+	ASSERT(scoreboard.SackedBytes() == 0);
+}
+
+
+static void
+test_wrap_around()
+{
+	SackScoreboard scoreboard;
+
+	ASSERT(update(scoreboard, 0xfffff800, 0x1000, 0xfffffc00, 0x400));
+	ASSERT(scoreboard.SackedBytes() == 0x800);
+	ASSERT(scoreboard.IsSacked(0));
+	ASSERT(!scoreboard.IsSacked(0xfffffa00));
+	// more than two segments are SACKed above the hole, so it is lost
+	ASSERT(scoreboard.Pipe(0xfffff800, 0x1000, 0xfffff800, kSegmentSize)
+		== 0xc00);
+
+	scoreboard.RemoveUntil(0x200);
+	ASSERT(scoreboard.SackedBytes() == 0x200);
+}
+
+
+static void
+test_lost_by_time()
+{
+	SackScoreboard scoreboard;
+	TransmitTimeline timeline;
+
+	// one segment every 10 ms, from 1000 to 6000; the first two are lost
+	for (uint32 i = 1; i <= 4; i++)
+		timeline.Sent(1000 + i * 1000, i * 10000);
+	timeline.Sent(6000, 40100);
+		// merged with the previous record
+	timeline.Sent(6000, 60000);
+		// nothing new
+
+	bigtime_t time;
+	ASSERT(timeline.TimeOf(1500, time) && time == 10000);
+	ASSERT(timeline.TimeOf(4500, time) && time == 40100);
+	ASSERT(!timeline.TimeOf(6000, time));
+
+	// a single SACKed segment is not enough for RFC 6675
+	ASSERT(update(scoreboard, 1000, 6000, 3000, 4000));
+	ASSERT(!scoreboard.IsLost(1000, kSegmentSize));
+	ASSERT(timeline.TimeOf(scoreboard.HighestSacked() - 1, time));
+	ASSERT(time == 30000);
+
+	// but everything that was sent 5 ms before the SACKed data is lost
+	tcp_sequence lostBelow;
+	ASSERT(timeline.SentBefore(time - 5000, lostBelow));
+	ASSERT(lostBelow == 3000);
+	scoreboard.MarkLostBelow(lostBelow);
+	ASSERT(scoreboard.IsLost(1000, kSegmentSize));
+	ASSERT(scoreboard.IsLost(2500, kSegmentSize));
+	ASSERT(!scoreboard.IsLost(4000, kSegmentSize));
+
+	// the lost holes leave the pipe, the data above the SACK stays
+	ASSERT(scoreboard.Pipe(1000, 6000, 1000, kSegmentSize) == 2000);
+
+	tcp_sequence start;
+	uint32 length;
+	ASSERT(scoreboard.NextLost(1000, 1000, kSegmentSize, start, length));
+	ASSERT(start == 1000 && length == 1000);
+	ASSERT(scoreboard.NextLost(1000, 2000, kSegmentSize, start, length));
+	ASSERT(start == 2000 && length == 1000);
+	ASSERT(!scoreboard.NextLost(1000, 3000, kSegmentSize, start, length));
+
+	timeline.RemoveUntil(3000);
+	ASSERT(!timeline.SentBefore(20000, lostBelow));
+	scoreboard.RemoveUntil(4000);
+	ASSERT(!scoreboard.IsLost(4000, kSegmentSize));
+}
+
+
+int
+main()
+{
+	test_loss_detection();
+	test_merge_and_acknowledge();
+	test_wrap_around();
+	test_lost_by_time();
+
+	printf("All tests passed.\n");
+	return 0;
+}
@@ -30,8 +30,10 @@
 
 #include <netinet/in.h>
 #include <netinet/ip.h>
+#include <netinet/tcp.h>
 
 #include <ctype.h>
+#include <deque>
 #include <errno.h>
 #include <new>
 #include <set>
@@ -40,10 +42,19 @@
 #include <string.h>
 
 
+struct delivery {
+	bigtime_t	time;
+	bool		overflow;
+};
+
 struct context {
 	BLocker		lock;
 	sem_id		wait_sem;
 	struct list list;
+	std::deque<delivery> deliveries;
+		// when each packet in the list arrives
+	bigtime_t	last_departure;
+	bigtime_t	last_arrival;
 	net_route	route;
 	bool		server;
 	thread_id	thread;
@@ -100,6 +111,11 @@ static std::set<uint32> sDropList;
 static bigtime_t sRoundTripTime = 0;
 static bool sIncreasingRoundTrip = false;
 static bool sRandomRoundTrip = false;
+static uint32 sRate = 0;
+	// of the bottleneck in kbit/s, 0 is unlimited
+static uint32 sQueueLimit = 0;
+	// in packets waiting for the bottleneck, 0 is unlimited
+static unsigned int sSeed;
 static void (*sPacketMonitor)(net_buffer *, int32, bool) = NULL;
 static int sPcapFD = -1;
 static bigtime_t sStartTime;
@@ -692,6 +708,7 @@ net_socket_module_info gNetSocketModule = {
 	NULL, // listen,
 	NULL, // receive,
 	NULL, // send,
+	NULL, // send_external,
 	NULL, // setsockopt,
 	NULL, // shutdown,
 	NULL, // socketpair
@@ -734,6 +751,51 @@ close_protocol(net_protocol* protocol)
 //	#pragma mark - datalink
 
 
+/*!	Works out when a packet that is sent now arrives, like a network
+	emulator would: it first has to pass the bottleneck, if a rate is set,
+	and then takes half the round trip time. Packets never overtake each
+	other here; use the reorder command for that.
+*/
+static delivery
+schedule_delivery(struct context& context, uint32 size)
+{
+	bigtime_t now = system_time();
+	delivery result;
+	result.overflow = false;
+
+	bigtime_t departure = now;
+	if (sRate > 0) {
+		bigtime_t transmitTime = (bigtime_t)size * 8000 / sRate;
+		if (context.last_departure > now)
+			departure = context.last_departure;
+
+		if (sQueueLimit > 0
+			&& departure - now > (bigtime_t)sQueueLimit * transmitTime) {
+			// tail drop
+			result.overflow = true;
+			result.time = now;
+			return result;
+		}
+
+		departure += transmitTime;
+		context.last_departure = departure;
+	}
+
+	bigtime_t delay = sRoundTripTime / 2;
+	if (sRandomRoundTrip)
+		delay += (bigtime_t)(1.0 * rand() / RAND_MAX * 500000) - 250000;
+	if (sIncreasingRoundTrip)
+		sRoundTripTime += (bigtime_t)(1.0 * rand() / RAND_MAX * 150000);
+
+	result.time = departure + max_c(delay, 0);
+	if (result.time < context.last_arrival)
+		result.time = context.last_arrival;
+	context.last_arrival = result.time;
+
+	return result;
+}
+
+
 status_t
 datalink_send_data(struct net_route *route, net_buffer *buffer)
 {
@@ -743,6 +805,7 @@ datalink_send_data(struct net_route *route, net_buffer *buffer)
 
 	context->lock.Lock();
 	list_add_item(&context->list, buffer);
+	context->deliveries.push_back(schedule_delivery(*context, buffer->size));
 	context->lock.Unlock();
 
 	release_sem(context->wait_sem);
@@ -955,19 +1018,9 @@ domain_receive_data(net_buffer *buffer)
 
 	bool drop = false;
 	if (sDropList.find(packetNumber) != sDropList.end()
-		|| (sRandomDrop > 0.0 && (1.0 * rand() / RAND_MAX) > sRandomDrop))
+		|| (sRandomDrop > 0.0 && (1.0 * rand() / RAND_MAX) < sRandomDrop))
 		drop = true;
 
-	if (!drop && (sRoundTripTime > 0 || sRandomRoundTrip || sIncreasingRoundTrip)) {
-		bigtime_t add = 0;
-		if (sRandomRoundTrip)
-			add = (bigtime_t)(1.0 * rand() / RAND_MAX * 500000) - 250000;
-		if (sIncreasingRoundTrip)
-			sRoundTripTime += (bigtime_t)(1.0 * rand() / RAND_MAX * 150000);
-
-		snooze(sRoundTripTime / 2 + add);
-	}
-
 	if (sPacketMonitor != NULL) {
 		sPacketMonitor(buffer, packetNumber, drop);
 	} else if (drop)
@@ -1239,11 +1292,30 @@ receiving_thread(void* _data)
 			context->lock.Lock();
 			net_buffer* buffer = (net_buffer*)list_remove_head_item(
 				&context->list);
+			delivery next;
+			if (buffer != NULL) {
+				next = context->deliveries.front();
+				context->deliveries.pop_front();
+			}
 			context->lock.Unlock();
 
 			if (buffer == NULL)
 				break;
 
+			if (next.overflow) {
+				uint32 packetNumber = atomic_add(&sPacketNumber, 1);
+				if (sPacketMonitor != NULL)
+					sPacketMonitor(buffer, packetNumber, true);
+				else
+					printf("<**** QUEUE OVERFLOW %ld ****>\n", packetNumber);
+
+				gNetBufferModule.free(buffer);
+				continue;
+			}
+
+			if (next.time > system_time())
+				snooze_until(next.time, B_SYSTEM_TIMEBASE);
+
 			if (sSimultaneousConnect && context->server && is_syn(buffer)) {
 				// delay getting the SYN request, and connect as well
 				sockaddr_in address;
@@ -1366,6 +1438,8 @@ void
 setup_context(struct context& context, bool server)
 {
 	list_init(&context.list);
+	context.last_departure = 0;
+	context.last_arrival = 0;
 	context.route.interface_address = &gInterfaceAddress;
 	context.route.gateway = (sockaddr *)&context;
 		// backpointer to the context
@@ -1600,19 +1674,24 @@ do_drop(int argc, char** argv)
 		else if (sRandomDrop > 1.0)
 			sRandomDrop = 1.0;
 	} else if (isdigit(argv[1][0])) {
-		// add to drop list
+		// add to drop list, "first-last" drops a burst of packets
 		for (int i = 1; i < argc; i++) {
-			uint32 packet = strtoul(argv[i], NULL, 0);
-			if (packet == 0) {
+			char* end;
+			uint32 packet = strtoul(argv[i], &end, 0);
+			uint32 last = packet;
+			if (end[0] == '-')
+				last = strtoul(end + 1, &end, 0);
+			if (packet == 0 || last < packet || end[0] != '\0') {
 				fprintf(stderr, "invalid packet number: %s\n", argv[i]);
 				break;
 			}
 
-			sDropList.insert(packet);
+			for (; packet <= last; packet++)
+				sDropList.insert(packet);
 		}
 	} else {
 		// print usage
-		puts("usage: drop <packet-number> [...]\n"
+		puts("usage: drop <packet-number>[-<last-packet-number>] [...]\n"
 			"   or: drop -r <probability>\n\n"
 			"   or: drop [-f]\n\n"
 			"Specifiying -f flushes the drop list, -r sets the probability a packet\n"
@@ -1706,6 +1785,68 @@ do_round_trip_time(int argc, char** argv)
 }
 
 
+static void
+do_rate(int argc, char** argv)
+{
+	if (argc == 1) {
+		if (sRate == 0)
+			printf("The rate is unlimited.\n");
+		else {
+			printf("Rate: %" B_PRIu32 " kbit/s, queue limit: %" B_PRIu32
+				" packets\n", sRate, sQueueLimit);
+		}
+	} else if (isdigit(argv[1][0])) {
+		sRate = strtoul(argv[1], NULL, 0);
+		sQueueLimit = argc > 2 ? strtoul(argv[2], NULL, 0) : 0;
+	} else {
+		puts("usage: rate [<kbit/s> [<queue limit>]]\n\n"
+			"Limits the rate in each direction, and optionally how many packets\n"
+			"may wait for the bottleneck before the following ones are dropped.\n"
+			"A rate of 0 removes the limit.");
+	}
+}
+
+
+static void
+do_seed(int argc, char** argv)
+{
+	if (argc > 1 && isdigit(argv[1][0])) {
+		sSeed = strtoul(argv[1], NULL, 0);
+		srand(sSeed);
+	} else if (argc > 1) {
+		puts("usage: seed [<seed>]\n\n"
+			"Restarts the random numbers for drops, reordering, and delays, so\n"
+			"that a run can be repeated.");
+		return;
+	}
+
+	printf("Random seed: %u\n", sSeed);
+}
+
+
+static void
+do_congestion_control(int argc, char** argv)
+{
+	net_protocol* protocol = gClientSocket->first_protocol;
+
+	if (argc > 1) {
+		status_t status = gTCPModule->setsockopt(protocol, IPPROTO_TCP,
+			TCP_CONGESTION, argv[1], strlen(argv[1]));
+		if (status != B_OK) {
+			fprintf(stderr, "Could not set congestion control: %s\n",
+				strerror(status));
+			return;
+		}
+	}
+
+	char name[TCP_CA_NAME_MAX];
+	int length = sizeof(name);
+	if (gTCPModule->getsockopt(protocol, IPPROTO_TCP, TCP_CONGESTION, name,
+			&length) == B_OK)
+		printf("Client congestion control: %s\n", name);
+}
+
+
 static void
 do_dprintf(int argc, char** argv)
 {
@@ -1728,6 +1869,10 @@ static cmd_entry sBuiltinCommands[] = {
 	{"reorder", do_reorder, "Lets you reorder packets during transfer"},
 	{"help", do_help, "prints this help text"},
 	{"rtt", do_round_trip_time, "Specifies the round trip time"},
+	{"rate", do_rate, "Limits the bandwidth, and the bottleneck queue"},
+	{"seed", do_seed, "Sets the random seed, to make runs reproducible"},
+	{"cc", do_congestion_control,
+		"Shows or sets the congestion control of the client"},
 	{"quit", NULL, "exits the application"},
 	{NULL, NULL, NULL},
 };
@@ -1750,13 +1895,18 @@ do_help(int argc, char** argv)
 int
 main(int argc, char* argv[])
 {
+	sSeed = (unsigned int)system_time();
 	for (int i = 1; i < argc; i++) {
 		if (strcmp(argv[i], "-w") == 0 && (i + 1) < argc) {
 			if (!setup_dump_pcap(argv[++i]))
 				return 1;
-		}
+		} else if (strcmp(argv[i], "-s") == 0 && (i + 1) < argc)
+			sSeed = strtoul(argv[++i], NULL, 0);
 	}
 
+	srand(sSeed);
+	printf("Random seed: %u\n", sSeed);
+
 	if (sPacketMonitor == NULL)
 		sPacketMonitor = dump_printf;
 
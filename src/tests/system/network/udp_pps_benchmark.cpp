@@ -0,0 +1,288 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures how many small datagrams per second can be moved between two
+	threads over the loopback interface: one per send()/recv() call, in
+	batches with sendmmsg()/recvmmsg(), and in batches that are segmented
+	by UDP_SEGMENT and coalesced again by UDP_GRO.
+*/
+
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+
+static const int kMaxBatchSize = 64;
+static const size_t kMaxDatagramSize = 1472;
+static const size_t kReceiveBufferSize = 65536;
+
+enum transfer_mode {
+	SINGLE,
+	BATCH,
+	SEGMENT
+};
+
+static const char* kModeNames[] = { "send/recv", "mmsg", "segment/gro" };
+
+static int sBatchSize = 32;
+static size_t sDatagramSize = 64;
+static double sDuration = 2.0;
+
+static volatile bool sSending;
+
+
+struct receiver_context {
+	int				socket;
+	transfer_mode	mode;
+	int64_t			received;
+};
+
+
+static double
+current_time()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+static void*
+receiver_thread(void* _context)
+{
+	receiver_context& context = *(receiver_context*)_context;
+
+	static char buffers[kMaxBatchSize][kReceiveBufferSize];
+	iovec vecs[kMaxBatchSize];
+	mmsghdr messages[kMaxBatchSize];
+	memset(messages, 0, sizeof(messages));
+	for (int i = 0; i < kMaxBatchSize; i++) {
+		vecs[i].iov_base = buffers[i];
+		vecs[i].iov_len = kReceiveBufferSize;
+		messages[i].msg_hdr.msg_iov = &vecs[i];
+		messages[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	while (true) {
+		ssize_t count = 0;
+		switch (context.mode) {
+			case SINGLE:
+				count = recv(context.socket, buffers[0], kReceiveBufferSize,
+					0) < 0 ? -1 : 1;
+				break;
+
+			case BATCH:
+				count = recvmmsg(context.socket, messages, sBatchSize,
+					MSG_WAITFORONE, NULL);
+				break;
+
+			case SEGMENT:
+			{
+				// a coalesced buffer holds as many datagrams as fit
+				ssize_t bytesReceived = recv(context.socket, buffers[0],
+					kReceiveBufferSize, 0);
+				count = bytesReceived < 0 ? -1
+					: (bytesReceived + sDatagramSize - 1) / sDatagramSize;
+				break;
+			}
+		}
+
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN || errno == EWOULDBLOCK) && sSending)
+				continue;
+			break;
+		}
+
+		context.received += count;
+	}
+
+	return NULL;
+}
+
+
+static int64_t
+send_datagrams(int socket, transfer_mode mode)
+{
+	static char data[kMaxBatchSize * kMaxDatagramSize];
+	memset(data, 'x', sizeof(data));
+
+	iovec vecs[kMaxBatchSize];
+	mmsghdr messages[kMaxBatchSize];
+	memset(messages, 0, sizeof(messages));
+	for (int i = 0; i < kMaxBatchSize; i++) {
+		vecs[i].iov_base = data + i * sDatagramSize;
+		vecs[i].iov_len = sDatagramSize;
+		messages[i].msg_hdr.msg_iov = &vecs[i];
+		messages[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	int64_t sent = 0;
+	double end = current_time() + sDuration;
+	while (current_time() < end) {
+		// check the time only every so often
+		for (int round = 0; round < 64; round++) {
+			ssize_t count = 0;
+			switch (mode) {
+				case SINGLE:
+					count = send(socket, data, sDatagramSize, 0) < 0 ? -1 : 1;
+					break;
+
+				case BATCH:
+					count = sendmmsg(socket, messages, sBatchSize, 0);
+					break;
+
+				case SEGMENT:
+					count = send(socket, data, sDatagramSize * sBatchSize, 0)
+						< 0 ? -1 : sBatchSize;
+					break;
+			}
+
+			if (count < 0) {
+				// the receiver does not keep up, and the send queue is full
+				if (errno == ENOBUFS || errno == EAGAIN || errno == EINTR)
+					continue;
+
+				fprintf(stderr, "%s: sending failed: %s\n", kModeNames[mode],
+					strerror(errno));
+				return -1;
+			}
+			sent += count;
+		}
+	}
+
+	return sent;
+}
+
+
+static bool
+create_sockets(transfer_mode mode, int& sender, int& receiver)
+{
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addressLength = sizeof(address);
+
+	receiver = socket(AF_INET, SOCK_DGRAM, 0);
+	sender = socket(AF_INET, SOCK_DGRAM, 0);
+	if (receiver < 0 || sender < 0
+		|| bind(receiver, (sockaddr*)&address, addressLength) != 0
+		|| getsockname(receiver, (sockaddr*)&address, &addressLength) != 0
+		|| connect(sender, (sockaddr*)&address, addressLength) != 0)
+		return false;
+
+	int size = 4 * 1024 * 1024;
+	setsockopt(receiver, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+	setsockopt(sender, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+	// the receiver must not block forever once the sender is done
+	timeval timeout = { 0, 200000 };
+	setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	if (mode == SEGMENT) {
+		int segmentSize = sDatagramSize;
+		int enable = 1;
+		if (setsockopt(sender, IPPROTO_UDP, UDP_SEGMENT, &segmentSize,
+				sizeof(segmentSize)) != 0
+			|| setsockopt(receiver, IPPROTO_UDP, UDP_GRO, &enable,
+				sizeof(enable)) != 0)
+			return false;
+	}
+
+	return true;
+}
+
+
+static bool
+run(transfer_mode mode)
+{
+	int sender, receiver;
+	if (!create_sockets(mode, sender, receiver)) {
+		fprintf(stderr, "%s: could not create sockets: %s\n", kModeNames[mode],
+			strerror(errno));
+		return false;
+	}
+
+	receiver_context context = { receiver, mode, 0 };
+	sSending = true;
+
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, &receiver_thread, &context) != 0) {
+		fprintf(stderr, "%s: could not start receiver\n", kModeNames[mode]);
+		return false;
+	}
+
+	double start = current_time();
+	int64_t sent = send_datagrams(sender, mode);
+	double elapsed = current_time() - start;
+
+	sSending = false;
+	pthread_join(thread, NULL);
+	close(sender);
+	close(receiver);
+
+	if (sent < 0)
+		return false;
+
+	printf("%-12s %4zu bytes, batches of %2d: sent %10.0f/s, received "
+		"%10.0f/s (%5.1f%% lost)\n", kModeNames[mode], sDatagramSize,
+		mode == SINGLE ? 1 : sBatchSize, sent / elapsed,
+		context.received / elapsed,
+		sent > 0 ? 100.0 * (sent - context.received) / sent : 0.0);
+	return true;
+}
+
+
+static void
+usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [-b <batch size>] [-s <datagram size>] "
+		"[-t <seconds>]\n", program);
+	exit(1);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	int option;
+	while ((option = getopt(argc, argv, "b:s:t:h")) != -1) {
+		switch (option) {
+			case 'b':
+				sBatchSize = atoi(optarg);
+				break;
+			case 's':
+				sDatagramSize = atoi(optarg);
+				break;
+			case 't':
+				sDuration = atof(optarg);
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (sBatchSize <= 0 || sBatchSize > kMaxBatchSize || sDatagramSize == 0
+		|| sDatagramSize > kMaxDatagramSize || sDuration <= 0
+		|| sDatagramSize * sBatchSize > 65507) {
+		usage(argv[0]);
+	}
+
+	bool success = true;
+	for (int mode = SINGLE; mode <= SEGMENT; mode++)
+		success &= run((transfer_mode)mode);
+
+	return success ? 0 : 1;
+}
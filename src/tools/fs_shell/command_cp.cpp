@@ -1140,6 +1140,7 @@ copy_entry(FSDomain *sourceDomain, const char *source,
 						target);
 					return error;
 				}
+				targetDeleter.SetTo(targetNode);
 			} else {
 				// 1.2.1.2. !/force/, source or target isn't a file
 				//          -> fail
@@ -434,7 +434,7 @@ create_file(const char* path)
 
 	// create the file
 	int fd_or_error = _kern_open(-1, path, FSSH_O_CREAT, 0);
-	if (fd_or_error <= 0) {
+	if (fd_or_error < 0) {
 		fprintf(stderr, "Error: Failed to make file \"%s\": %s\n", path,
 			fssh_strerror(fd_or_error));
 		return fd_or_error;
@@ -1599,10 +1599,13 @@ input_loop(bool interactive)
 
 
 static int
-standard_session(const char* device, const char* fsName, bool interactive)
+standard_session(const char* device, const char* fsName, bool interactive,
+	const char* mountParameters)
 {
 	// mount FS
-	fssh_dev_t fsDev = _kern_mount(kMountPoint, device, fsName, 0, NULL, 0);
+	fssh_dev_t fsDev = _kern_mount(kMountPoint, device, fsName, 0,
+		mountParameters,
+		mountParameters != NULL ? strlen(mountParameters) + 1 : 0);
 	if (fsDev < 0) {
 		fprintf(stderr, "Error: Mounting FS failed: %s\n",
 			fssh_strerror(fsDev));
@@ -1650,7 +1653,8 @@ print_usage(bool error)
 {
 	fprintf((error ? stderr : stdout),
 		"Usage: %s [ --start-offset <startOffset>]\n"
-		"          [ --end-offset <endOffset>] [-n] <device>\n"
+		"          [ --end-offset <endOffset>]\n"
+		"          [ --mount-parameters <parameters>] [-n] <device>\n"
 		"       %s [ --start-offset <startOffset>]\n"
 		"          [ --end-offset <endOffset>]\n"
 		"          --initialize [-n] <device> <volume name> "
@@ -1686,6 +1690,7 @@ main(int argc, const char* const* argv)
 	const char* device = NULL;
 	const char* volumeName = NULL;
 	const char* initParameters = NULL;
+	const char* mountParameters = NULL;
 	fssh_off_t startOffset = 0;
 	fssh_off_t endOffset = -1;
 
@@ -1707,6 +1712,10 @@ main(int argc, const char* const* argv)
 			if (argi >= argc)
 				print_usage_and_exit(true);
 			endOffset = atoll(argv[argi++]);
+		} else if (strcmp(arg, "--mount-parameters") == 0) {
+			if (argi >= argc)
+				print_usage_and_exit(true);
+			mountParameters = argv[argi++];
 		} else {
 			print_usage_and_exit(true);
 		}
@@ -1760,7 +1769,8 @@ main(int argc, const char* const* argv)
 		result = initialization_session(device, fsName, volumeName,
 			initParameters);
 	} else
-		result = standard_session(device, fsName, interactive);
+		result = standard_session(device, fsName, interactive,
+			mountParameters);
 
 	return result;
 }